@@ -37,6 +37,7 @@
 *
 ******************************************************************************/
 /* Standard C Libraries */
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -48,6 +49,13 @@
 /* Receive entry pointer to keep track of read items */
 rfc_dataEntryGeneral_t* readEntry;
 
+/* rxStream.h lays partial read entries out as the RF core reads them */
+typedef char RFQueue_partialLayoutCheck[(RX_STREAM_TYPE_PARTIAL == DATA_ENTRY_TYPE_PARTIAL &&
+                                         offsetof(rfc_dataEntryPartial_t, length) == offsetof(RxStreamEntry, length) &&
+                                         offsetof(rfc_dataEntryPartial_t, pktStatus) == offsetof(RxStreamEntry, pktStatus) &&
+                                         offsetof(rfc_dataEntryPartial_t, nextIndex) == offsetof(RxStreamEntry, nextIndex) &&
+                                         offsetof(rfc_dataEntryPartial_t, rxData) == offsetof(RxStreamEntry, data)) ? 1 : -1];
+
 //*****************************************************************************
 //
 //! Get the current dataEntry
@@ -103,8 +111,8 @@ RFQueue_defineQueue(dataQueue_t *dataQueue, uint8_t *buf, uint16_t buf_len, uint
     return (1);
   }
 
-  /* Padding needed for 4-byte alignment? */
-  uint8_t pad = 4-((length + RF_QUEUE_DATA_ENTRY_HEADER_SIZE)%4);
+  /* Padding needed for alignment? */
+  uint8_t pad = RF_QUEUE_QUEUE_ALIGN_PADDING(length);
 
   /* Set the Data Entries common configuration */
   uint8_t *first_entry = buf;
@@ -131,3 +139,52 @@ RFQueue_defineQueue(dataQueue_t *dataQueue, uint8_t *buf, uint16_t buf_len, uint
 
   return (0);
 }
+
+//*****************************************************************************
+//
+//! Define a queue of partial read entries
+//!
+//! \param dataQueue is a pointer to the queue to use
+//! \param stream is the reader of the queue (rxStream.h)
+//! \param buf is the prealocated byte buffer to use, 4 byte aligned
+//! \param buf_len is the number of preallocated bytes
+//! \param numEntries are the number of dataEntries to split the buffer into, at least 2
+//! \param dataSize is the number of data bytes in every dataEntry
+//! \param assembly is where packets spanning entries are put together
+//! \param assembly_len is its size, the longest packet with its appended bytes
+//!
+//! \return uint8_t
+//
+//*****************************************************************************
+uint8_t
+RFQueue_definePartialQueue(dataQueue_t *dataQueue, RxStream *stream, uint8_t *buf, uint16_t buf_len,
+                           uint8_t numEntries, uint16_t dataSize, uint8_t *assembly, uint16_t assembly_len)
+{
+  if (rxStreamDefine(stream, buf, buf_len, numEntries, dataSize, assembly, assembly_len))
+  {
+    /* queue does not fit into buffer */
+    return (1);
+  }
+
+  dataQueue->pCurrEntry = buf;
+  dataQueue->pLastEntry = NULL;
+
+  return (0);
+}
+
+//*****************************************************************************
+//
+//! Empty a queue of partial read entries after PROP_ERROR_RXFULL, before the
+//! next RX command
+//!
+//! \param dataQueue is a pointer to the queue to use
+//! \param stream is the reader of the queue
+//!
+//! \return None
+//
+//*****************************************************************************
+void
+RFQueue_flushPartialQueue(dataQueue_t *dataQueue, RxStream *stream)
+{
+  dataQueue->pCurrEntry = rxStreamFlush(stream);
+}
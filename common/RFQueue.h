@@ -47,19 +47,31 @@
 #ifndef RF_QUEUE_H
 #define RF_QUEUE_H
 
+#include <stddef.h>
 #include <ti/devices/DeviceFamily.h>
 #include DeviceFamily_constructPath(driverlib/rf_data_entry.h)
+#include "rxStream.h"
 
-#define RF_QUEUE_DATA_ENTRY_HEADER_SIZE  8 // Contant header size of a Generic Data Entry
+/* Header size of a Generic Data Entry: 8 on the RF core, more with a host's wider pointers */
+#define RF_QUEUE_DATA_ENTRY_HEADER_SIZE  offsetof(rfc_dataEntryGeneral_t, data)
 
-#define RF_QUEUE_QUEUE_ALIGN_PADDING(length)  (4-((length + RF_QUEUE_DATA_ENTRY_HEADER_SIZE)%4)) // Padding offset
+/* Entries are aligned to a pointer, 4 bytes on the RF core */
+#define RF_QUEUE_ALIGN                   sizeof(uint8_t *)
+
+#define RF_QUEUE_QUEUE_ALIGN_PADDING(length)  (RF_QUEUE_ALIGN-((length + RF_QUEUE_DATA_ENTRY_HEADER_SIZE)%RF_QUEUE_ALIGN)) // Padding offset
 
 #define RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(numEntries, dataSize, appendedBytes)                                                    \
 (numEntries*(RF_QUEUE_DATA_ENTRY_HEADER_SIZE + dataSize + appendedBytes + RF_QUEUE_QUEUE_ALIGN_PADDING(dataSize + appendedBytes)))
 
+/* Partial read entries: dataSize data bytes each, a packet may span several (rxStream.h) */
+#define RF_QUEUE_PARTIAL_ENTRY_BUFFER_SIZE(numEntries, dataSize) RX_STREAM_BUFFER_SIZE(numEntries, dataSize)
+
 extern uint8_t RFQueue_nextEntry();
 extern rfc_dataEntryGeneral_t* RFQueue_getDataEntry();
 extern uint8_t RFQueue_defineQueue(dataQueue_t *queue ,uint8_t *buf, uint16_t buf_len, uint8_t numEntries, uint16_t length);
+extern uint8_t RFQueue_definePartialQueue(dataQueue_t *queue, RxStream *stream, uint8_t *buf, uint16_t buf_len,
+                                          uint8_t numEntries, uint16_t dataSize, uint8_t *assembly, uint16_t assembly_len);
+extern void RFQueue_flushPartialQueue(dataQueue_t *queue, RxStream *stream);
 
 #endif
 
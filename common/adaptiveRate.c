@@ -0,0 +1,87 @@
+//
+//  adaptiveRate.c
+//  Adaptive data rate of the TDMA slots
+//
+
+#include "adaptiveRate.h"
+
+static void adrSlotReset(AdrSlot * s, uint8_t owner) {
+
+    s->owner    = owner;
+    s->rate     = PHY_PROFILE;
+    s->rssiQ4   = ADR_NO_RSSI;
+    s->upFrames = 0;
+    s->misses   = 0;
+}
+
+/* Above the sensitivity of a profile, INT8_MIN for one that does not exist */
+static int16_t adrMarginDb(int16_t rssi, uint8_t rate) {
+
+    return rate < PHY_NUM_PROFILES ? rssi - phyProfiles[rate].sensitivityDbm : INT8_MIN;
+}
+
+void adrGatewayInit(AdrGateway * adr, uint8_t maxRate) {
+
+    uint8_t i;
+    for (i = 0; i < TDMA_MAX_SLOTS; ++i)
+        adrSlotReset(&adr->slot[i], TDMA_FREE_SLOT);
+
+    adr->maxRate = maxRate < PHY_NUM_PROFILES ? maxRate : PHY_NUM_PROFILES - 1;
+}
+
+void adrGatewayJoin(AdrGateway * adr, const TdmaGateway * gw, uint8_t slot) {
+
+    if (slot < gw->cfg.numSlots)
+        adrSlotReset(&adr->slot[slot], gw->owner[slot]);
+}
+
+void adrGatewayHeard(AdrGateway * adr, uint8_t slot, int8_t rssiDbm) {
+
+    if (slot >= TDMA_MAX_SLOTS)
+        return;
+
+    AdrSlot * s = &adr->slot[slot];
+
+    if (s->rssiQ4 == ADR_NO_RSSI)
+        s->rssiQ4 = (int16_t)(rssiDbm * 16);
+    else
+        s->rssiQ4 = (int16_t)(s->rssiQ4 + (rssiDbm * 16 - s->rssiQ4) / ADR_RSSI_WEIGHT);
+    s->misses = 0;
+
+    int16_t rssi = s->rssiQ4 / 16;
+
+    if (s->rate > PHY_PROFILE && adrMarginDb(rssi, s->rate) < ADR_DOWN_MARGIN_DB) {
+        --s->rate;
+        s->upFrames = 0;
+    } else if (s->rate < adr->maxRate && adrMarginDb(rssi, s->rate + 1) >= ADR_UP_MARGIN_DB) {
+        if (++s->upFrames >= ADR_UP_FRAMES) {
+            ++s->rate;
+            s->upFrames = 0;
+        }
+    } else {
+        s->upFrames = 0;
+    }
+}
+
+void adrGatewayEndFrame(AdrGateway * adr, TdmaGateway * gw) {
+
+    uint8_t i;
+    for (i = 0; i < gw->cfg.numSlots; ++i) {
+
+        AdrSlot * s = &adr->slot[i];
+
+        if (gw->owner[i] != s->owner)
+            adrSlotReset(s, gw->owner[i]);
+
+        /* Not heard in this superframe */
+        if (s->owner != TDMA_FREE_SLOT && gw->idleFrames[i] > 0) {
+            s->upFrames = 0;
+            if (++s->misses >= ADR_FALLBACK_MISSES && s->rate != PHY_PROFILE) {
+                s->rate = PHY_PROFILE;
+                s->misses = 0;
+            }
+        }
+
+        gw->cfg.rate[i] = s->rate;
+    }
+}
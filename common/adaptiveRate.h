@@ -0,0 +1,67 @@
+//
+//  adaptiveRate.h
+//  Adaptive data rate: the gateway picks the PHY profile of every TDMA slot by its link
+//
+//  The gateway smooths the RSSI of the frames each slot owner sends. A link that stays
+//  ADR_UP_MARGIN_DB above the sensitivity of the next faster profile for ADR_UP_FRAMES
+//  frames in a row moves up one profile; one that falls below ADR_DOWN_MARGIN_DB above
+//  the sensitivity of its own profile moves down one. An owner not heard for
+//  ADR_FALLBACK_MISSES superframes in a row goes back to PHY_PROFILE, where its frames
+//  reach furthest.
+//
+//  Rates change only between superframes: the gateway writes them into the slot rates
+//  of the next beacon (tdmaMac.h), and every tracker sends at the rate its beacon gives.
+//  A tracker that loses the beacons re-joins at PHY_PROFILE.
+//
+
+#ifndef adaptiveRate_h
+#define adaptiveRate_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "phyProfile.h"
+#include "tdmaMac.h"
+
+#define ADR_UP_MARGIN_DB        10  // above the next profile's sensitivity to move up
+#define ADR_UP_FRAMES           4   // frames in a row with that margin
+#define ADR_DOWN_MARGIN_DB      5   // below this margin over the own sensitivity, move down
+#define ADR_FALLBACK_MISSES     3   // superframes without a frame, back to PHY_PROFILE
+#define ADR_RSSI_WEIGHT         4   // new RSSI counts 1/4 in the average
+
+#define ADR_NO_RSSI             INT16_MIN
+
+typedef struct {
+    uint8_t  owner;         // node the state is about, TDMA_FREE_SLOT if none
+    uint8_t  rate;          // PHY_PROFILE_* from the next superframe on
+    int16_t  rssiQ4;        // smoothed RSSI in 1/16 dBm, ADR_NO_RSSI before the first frame
+    uint8_t  upFrames;      // frames in a row with margin for the next faster profile
+    uint8_t  misses;        // superframes in a row without a frame
+} AdrSlot;
+
+typedef struct {
+    AdrSlot slot[TDMA_MAX_SLOTS];
+    uint8_t maxRate;        // fastest profile handed out
+} AdrGateway;
+
+/// maxRate caps the profiles handed out, PHY_NUM_PROFILES - 1 for all of them.
+void adrGatewayInit(AdrGateway * adr, uint8_t maxRate);
+
+/// Call with the slot tdmaGatewayJoin() granted: the owner starts over at PHY_PROFILE.
+void adrGatewayJoin(AdrGateway * adr, const TdmaGateway * gw, uint8_t slot);
+
+/// Call with the slot tdmaGatewayHeard() returned and the RSSI of the frame.
+void adrGatewayHeard(AdrGateway * adr, uint8_t slot, int8_t rssiDbm);
+
+/// Call at the end of the superframe, before tdmaGatewayEndFrame(): counts the slots not
+/// heard and writes the rates of the next superframe into gw->cfg.
+void adrGatewayEndFrame(AdrGateway * adr, TdmaGateway * gw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* adaptiveRate_h */
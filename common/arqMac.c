@@ -0,0 +1,241 @@
+//
+//  arqMac.c
+//  Acknowledged delivery with selective retransmission
+//
+
+#include "arqMac.h"
+#include "packetCodec.h"
+#include <string.h>
+
+void arqDefaultConfig(ArqConfig * cfg) {
+
+    cfg->maxTries   = ARQ_DEFAULT_MAX_TRIES;
+    cfg->rxWindowUs = ARQ_DEFAULT_RX_WINDOW_US;
+}
+
+/***** Tracker *****/
+
+void arqNodeInit(ArqNode * node, const ArqConfig * cfg) {
+
+    memset(node, 0, sizeof(*node));
+    node->cfg = *cfg;
+    node->ackRssi = ARQ_NO_RSSI;
+}
+
+uint8_t arqNodeQueue(ArqNode * node, const uint8_t * frame, uint8_t length) {
+
+    PacketHeader hdr;
+
+    if (length > ARQ_MAX_FRAME_LENGTH || pktDecodeHeader(&hdr, frame, length))
+        return ARQ_NONE;
+
+    uint8_t slot = ARQ_NONE;
+    uint8_t i;
+
+    for (i = 0; i < ARQ_RETRY_SLOTS; ++i) {
+
+        if (node->entry[i].length == 0) {
+            slot = i;
+            break;
+        }
+
+        if (slot == ARQ_NONE || (int16_t)(node->entry[i].seq - node->entry[slot].seq) < 0)
+            slot = i;
+    }
+
+    if (node->entry[slot].length != 0)
+        ++node->evicted;
+
+    ArqEntry * e = &node->entry[slot];
+    memcpy(e->frame, frame, length);
+    e->length = length;
+    e->tries  = 0;
+    e->due    = 0;
+    e->seq    = hdr.seq;
+
+    return slot;
+}
+
+void arqNodeStartRound(ArqNode * node) {
+
+    uint8_t i;
+    for (i = 0; i < ARQ_RETRY_SLOTS; ++i)
+        node->entry[i].due = node->entry[i].length != 0;
+}
+
+uint8_t arqNodeNext(const ArqNode * node) {
+
+    uint8_t slot = ARQ_NONE;
+    uint8_t i;
+
+    /* Newest first, the latest fix is the one worth most */
+    for (i = 0; i < ARQ_RETRY_SLOTS; ++i) {
+
+        if (node->entry[i].length == 0 || !node->entry[i].due)
+            continue;
+
+        if (slot == ARQ_NONE || (int16_t)(node->entry[i].seq - node->entry[slot].seq) > 0)
+            slot = i;
+    }
+
+    return slot;
+}
+
+void arqNodeSent(ArqNode * node, uint8_t slot) {
+
+    ArqEntry * e = &node->entry[slot];
+
+    e->due = 0;
+
+    /* Freed already if the ACK window brought the ACK */
+    if (e->length == 0)
+        return;
+
+    if (node->unanswered < ARQ_LINK_LOSS_FRAMES)
+        ++node->unanswered;
+
+    if (++e->tries >= node->cfg.maxTries) {
+        e->length = 0;
+        ++node->expired;
+    }
+}
+
+uint8_t arqNodeOnAck(ArqNode * node, uint16_t newest, const uint8_t * payload, uint8_t length) {
+
+    if (length < ARQ_ACK_PAYLOAD_LENGTH)
+        return 1;
+
+    node->ackSeen = 1;
+    node->lastNewest = newest;
+    node->lastBitmap = (uint16_t)((payload[0] << 8) | payload[1]);
+    node->ackRssi = (int8_t)payload[2];
+    node->unanswered = 0;
+
+    uint8_t i;
+    for (i = 0; i < ARQ_RETRY_SLOTS; ++i) {
+
+        ArqEntry * e = &node->entry[i];
+
+        if (e->length != 0 && arqNodeAcked(node, e->seq)) {
+            e->length = 0;
+            ++node->acked;
+        }
+    }
+
+    return 0;
+}
+
+uint8_t arqNodeAcked(const ArqNode * node, uint16_t seq) {
+
+    if (!node->ackSeen)
+        return 0;
+
+    int16_t behind = (int16_t)(node->lastNewest - seq);
+
+    return behind == 0 ||
+           (behind > 0 && behind <= ARQ_BITMAP_BITS && (node->lastBitmap & (1u << (behind - 1))));
+}
+
+uint8_t arqNodePending(const ArqNode * node, uint16_t seq) {
+
+    uint8_t i;
+    for (i = 0; i < ARQ_RETRY_SLOTS; ++i) {
+        if (node->entry[i].length != 0 && node->entry[i].seq == seq)
+            return 1;
+    }
+
+    return 0;
+}
+
+uint8_t arqNodeLinkUp(const ArqNode * node) {
+
+    return node->unanswered < ARQ_LINK_LOSS_FRAMES;
+}
+
+/***** Gateway *****/
+
+void arqGatewayInit(ArqGateway * gw) {
+
+    memset(gw, 0, sizeof(*gw));
+}
+
+static ArqPeer * arqGatewayFind(const ArqGateway * gw, uint8_t nodeId) {
+
+    uint8_t i;
+    for (i = 0; i < ARQ_MAX_PEERS; ++i) {
+        if (gw->peer[i].nodeId == nodeId)
+            return (ArqPeer *)&gw->peer[i];
+    }
+
+    return NULL;
+}
+
+uint8_t arqGatewayReceive(ArqGateway * gw, uint8_t nodeId, uint16_t seq) {
+
+    if (nodeId == PKT_GATEWAY_ID)
+        return 0;
+
+    ArqPeer * p = arqGatewayFind(gw, nodeId);
+
+    if (p == NULL) {
+        p = arqGatewayFind(gw, PKT_GATEWAY_ID);
+        if (p == NULL) {
+            p = &gw->peer[gw->nextVictim];
+            gw->nextVictim = (gw->nextVictim + 1) % ARQ_MAX_PEERS;
+        }
+        p->nodeId = nodeId;
+        p->newest = seq;
+        p->bitmap = 0;
+        return 1;
+    }
+
+    int16_t ahead = (int16_t)(seq - p->newest);
+
+    /* Retransmissions are never more than a retry buffer behind; anything older
+     * means the tracker restarted its sequence numbers */
+    if (ahead < -ARQ_BITMAP_BITS) {
+        p->newest = seq;
+        p->bitmap = 0;
+        return 1;
+    }
+
+    /* The bitmap moves with the newest frame, what falls out of it is no longer reported */
+    if (ahead > 0) {
+        p->bitmap = ahead > ARQ_BITMAP_BITS ? 0 : (uint16_t)((p->bitmap << ahead) | (1u << (ahead - 1)));
+        p->newest = seq;
+        return 1;
+    }
+
+    if (ahead == 0)
+        return 0;
+
+    uint16_t bit = (uint16_t)(1u << (-ahead - 1));
+    if (p->bitmap & bit)
+        return 0;
+
+    p->bitmap |= bit;
+
+    return 1;
+}
+
+uint8_t arqGatewayBuildAck(const ArqGateway * gw, uint8_t nodeId, int8_t rssiDbm,
+                           uint8_t * buf, uint8_t maxLen) {
+
+    const ArqPeer * p = arqGatewayFind(gw, nodeId);
+
+    if (p == NULL || nodeId == PKT_GATEWAY_ID || maxLen < PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH)
+        return 0;
+
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_ACK;
+    hdr.flags  = 0;
+    hdr.nodeId = nodeId;
+    hdr.seq    = p->newest;
+
+    uint8_t * q = buf + pktEncodeHeader(&hdr, buf);
+    *q++ = (uint8_t)(p->bitmap >> 8);
+    *q++ = (uint8_t)(p->bitmap);
+    *q++ = (uint8_t)rssiDbm;
+
+    return PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH;
+}
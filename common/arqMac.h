@@ -0,0 +1,133 @@
+//
+//  arqMac.h
+//  Acknowledged delivery: selective retransmission of DATA frames with a bounded retry budget
+//
+//  After every DATA frame the tracker listens for rxWindowUs (CMD_PROP_RX chained to the
+//  CMD_PROP_TX). The gateway answers with an ACK frame for that tracker:
+//
+//      header seq  newest: the newest sequence number received from the tracker
+//      byte 0..1   bitmap, big endian: bit i set if newest - 1 - i was received
+//      byte 2      RSSI in dBm of the frame being answered, ARQ_NO_RSSI if unknown
+//
+//  An ACK only reports frames the gateway has. What lies further back than the bitmap is
+//  not reported, nor is anything from before the first frame it heard from a tracker, so
+//  a restarted gateway claims nothing it never received. The RSSI tells the tracker the
+//  margin its frames arrive with (txPower.h).
+//
+//  Frames wait in a small retry buffer until an ACK covers them. On every transmit
+//  opportunity each unacknowledged frame is sent once, newest first; a frame is given up
+//  after maxTries transmissions, and the oldest one is evicted when a new frame finds the
+//  buffer full. The gateway uses the same state to drop retransmissions it already has.
+//
+
+#ifndef arqMac_h
+#define arqMac_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "phyProfile.h"
+
+#define ARQ_RETRY_SLOTS             4
+#define ARQ_MAX_FRAME_LENGTH        102     // PAYLOAD_LENGTH of the tracker
+#define ARQ_BITMAP_BITS             16
+#define ARQ_ACK_PAYLOAD_LENGTH      3
+#define ARQ_MAX_PEERS               32      // trackers the gateway keeps ACK state for
+#define ARQ_NONE                    0xFF
+#define ARQ_NO_RSSI                 127
+#define ARQ_LINK_LOSS_FRAMES        6       // unanswered frames in a row that mean no gateway
+
+#define ARQ_DEFAULT_MAX_TRIES       3
+#define ARQ_GATEWAY_TURNAROUND_US   30000   // frame received to ACK on the air
+#define ARQ_DEFAULT_RX_WINDOW_US    (ARQ_GATEWAY_TURNAROUND_US + PHY_SYNC_US)
+
+typedef struct {
+    uint8_t  maxTries;      // transmissions of a frame before it is given up
+    uint32_t rxWindowUs;    // ACK window after every transmission
+} ArqConfig;
+
+typedef struct {
+    uint8_t  length;        // 0 if the entry is free
+    uint8_t  tries;
+    uint8_t  due;           // still to be sent in the current round
+    uint16_t seq;
+    uint8_t  frame[ARQ_MAX_FRAME_LENGTH];
+} ArqEntry;
+
+typedef struct {
+    ArqConfig cfg;
+    ArqEntry  entry[ARQ_RETRY_SLOTS];
+    uint32_t  acked;
+    uint32_t  expired;      // given up after maxTries
+    uint32_t  evicted;      // pushed out by newer frames
+    uint8_t   ackSeen;      // lastNewest and lastBitmap are valid
+    uint16_t  lastNewest;
+    uint16_t  lastBitmap;
+    uint8_t   unanswered;   // transmissions since the last ACK
+    int8_t    ackRssi;      // what the latest ACK reported, ARQ_NO_RSSI before the first
+} ArqNode;
+
+typedef struct {
+    uint8_t  nodeId;        // PKT_GATEWAY_ID if the entry is free
+    uint16_t newest;        // newest sequence number received
+    uint16_t bitmap;        // bit i set if newest - 1 - i was received
+} ArqPeer;
+
+typedef struct {
+    ArqPeer peer[ARQ_MAX_PEERS];
+    uint8_t nextVictim;     // round robin replacement once every entry is taken
+} ArqGateway;
+
+void arqDefaultConfig(ArqConfig * cfg);
+
+/* Tracker */
+
+void arqNodeInit(ArqNode * node, const ArqConfig * cfg);
+
+/// Copies a complete DATA frame (header included) into the retry buffer. Returns its entry,
+/// ARQ_NONE if the frame is too long or malformed.
+uint8_t arqNodeQueue(ArqNode * node, const uint8_t * frame, uint8_t length);
+
+/// Starts a transmit opportunity: every frame still waiting for an ACK becomes due once.
+void arqNodeStartRound(ArqNode * node);
+
+/// Entry to send next in this round, ARQ_NONE when the round is over.
+uint8_t arqNodeNext(const ArqNode * node);
+
+/// Call after the entry was sent and its ACK window closed.
+void arqNodeSent(ArqNode * node, uint8_t slot);
+
+/// Takes the sequence number of a received ACK frame and its payload. Frees every
+/// acknowledged entry. Returns 0 on success, 1 if the payload is malformed.
+uint8_t arqNodeOnAck(ArqNode * node, uint16_t newest, const uint8_t * payload, uint8_t length);
+
+/// 1 if the latest ACK reports seq, as its newest frame or in its bitmap. Once a frame is
+/// more than ARQ_BITMAP_BITS behind the newest it is no longer reported: check before.
+uint8_t arqNodeAcked(const ArqNode * node, uint16_t seq);
+
+/// 1 while the frame with seq waits in the retry buffer.
+uint8_t arqNodePending(const ArqNode * node, uint16_t seq);
+
+/// 0 after ARQ_LINK_LOSS_FRAMES transmissions in a row went unanswered.
+uint8_t arqNodeLinkUp(const ArqNode * node);
+
+/* Gateway */
+
+void arqGatewayInit(ArqGateway * gw);
+
+/// Records a DATA or LOG frame. Returns 1 if it is new, 0 for a retransmission already received.
+uint8_t arqGatewayReceive(ArqGateway * gw, uint8_t nodeId, uint16_t seq);
+
+/// Writes the ACK frame for nodeId into buf, reporting rssiDbm for the frame it answers.
+/// Returns its length, 0 if the tracker is unknown or maxLen is too small.
+uint8_t arqGatewayBuildAck(const ArqGateway * gw, uint8_t nodeId, int8_t rssiDbm,
+                           uint8_t * buf, uint8_t maxLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* arqMac_h */
@@ -0,0 +1,34 @@
+//
+//  channelHop.c
+//  Channel sequence and frequencies of multi-channel operation
+//
+
+#include "channelHop.h"
+
+uint8_t hopChannel(uint8_t nodeId, uint16_t seq, uint8_t numChannels) {
+
+    /* Integer hash (lowbias32), every input bit reaches every output bit */
+    uint32_t x = (uint32_t)nodeId << 16 | seq;
+
+    x ^= x >> 16;
+    x *= 0x7FEB352DUL;
+    x ^= x >> 15;
+    x *= 0x846CA68BUL;
+    x ^= x >> 16;
+
+    return numChannels > 1 ? (uint8_t)(x % numChannels) : 0;
+}
+
+uint32_t hopChannelKhz(uint8_t channel) {
+
+    return HOP_BASE_KHZ + (uint32_t)channel * HOP_SPACING_KHZ;
+}
+
+void hopFsFrequency(uint8_t channel, uint16_t * frequency, uint16_t * fractFreq) {
+
+    uint32_t khz = hopChannelKhz(channel);
+
+    /* Whole MHz, and the rest in 1/65536 MHz */
+    *frequency = (uint16_t)(khz / 1000);
+    *fractFreq = (uint16_t)(((khz % 1000) << 16) / 1000);
+}
@@ -0,0 +1,55 @@
+//
+//  channelHop.h
+//  Multi-channel operation: the channel of every frame and the frequencies, shared by Tx and Rx
+//
+//  With PHY_CHANNELS > 1 a tracker sends each frame on a channel drawn from a pseudo-random
+//  sequence seeded by its node ID and the frame's sequence number. A retransmission keeps the
+//  channel of its frame, and two trackers rarely meet on the same channel twice in a row.
+//  Channels are HOP_SPACING_KHZ apart from HOP_BASE_KHZ, inside the 433.05 - 434.79 MHz band.
+//
+//  The gateway needs no schedule. With one radio it scans: a ring of CMD_FS -> CMD_PROP_CS ->
+//  CMD_PROP_RX per channel runs on the RF core without the CPU. The sense skips the RX while
+//  the channel is quiet; the RX ends after one frame, or HOP_RX_TIMEOUT_US without a sync
+//  word, and the ring moves on to the next channel. The preamble of every frame spans a
+//  scan round (phyProfile.h). The synthesizer cannot be programmed while it receives, so
+//  CMD_FS follows each RX as the next command in the ring. The tracker chains CMD_FS ahead of
+//  its TX, or of the CSMA backoff.
+//
+//  Sensing costs range: the RSSI has to reach HOP_SENSE_MARGIN_DB over the sensitivity.
+//
+
+#ifndef channelHop_h
+#define channelHop_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "phyProfile.h"
+
+#define HOP_MAX_CHANNELS        8
+#define HOP_BASE_KHZ            433200
+#define HOP_SPACING_KHZ         200
+#define HOP_SENSE_MARGIN_DB     8       // CMD_PROP_CS threshold over the sensitivity
+#define HOP_RX_TIMEOUT_US       PHY_SYNC_US
+
+#if PHY_CHANNELS > HOP_MAX_CHANNELS
+#error "PHY_CHANNELS: at most HOP_MAX_CHANNELS fit the band"
+#endif
+
+/// Channel of the frame with seq from nodeId, 0 to numChannels - 1.
+uint8_t hopChannel(uint8_t nodeId, uint16_t seq, uint8_t numChannels);
+
+/// Centre frequency of a channel in kHz.
+uint32_t hopChannelKhz(uint8_t channel);
+
+/// The frequency and fractFreq fields of CMD_FS for a channel.
+void hopFsFrequency(uint8_t channel, uint16_t * frequency, uint16_t * fractFreq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* channelHop_h */
@@ -0,0 +1,26 @@
+//
+//  csmaMac.c
+//  Listen-before-talk (non-persistent CSMA) parameters and backoff
+//
+
+#include "csmaMac.h"
+
+void csmaDefaultConfig(CsmaConfig * cfg) {
+
+    cfg->rssiThresholdDbm = CSMA_DEFAULT_RSSI_THRESHOLD_DBM;
+    cfg->senseUs          = CSMA_DEFAULT_SENSE_US;
+    cfg->backoffUnitUs    = CSMA_DEFAULT_BACKOFF_UNIT_US;
+    cfg->minBe            = CSMA_DEFAULT_MIN_BE;
+    cfg->maxBe            = CSMA_DEFAULT_MAX_BE;
+    cfg->maxAttempts      = CSMA_DEFAULT_MAX_ATTEMPTS;
+}
+
+uint32_t csmaBackoffUs(const CsmaConfig * cfg, uint8_t attempt, uint32_t random) {
+
+    uint8_t be = cfg->minBe + attempt;
+
+    if (be > cfg->maxBe || be < cfg->minBe)
+        be = cfg->maxBe;
+
+    return (random & ((1UL << be) - 1)) * cfg->backoffUnitUs;
+}
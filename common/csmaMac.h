@@ -0,0 +1,49 @@
+//
+//  csmaMac.h
+//  Listen-before-talk (non-persistent CSMA) parameters and backoff, for deployments without a gateway schedule
+//
+//  Before every transmission the tracker waits a random backoff, then senses the channel
+//  for senseUs. If the RSSI stays below rssiThresholdDbm the frame goes out right away;
+//  the firmware chains CMD_NOP -> CMD_PROP_CS -> CMD_PROP_TX on the RF core so no CPU
+//  latency sits between the sense and the transmit. A busy channel retries with a binary
+//  exponential backoff, and the frame is dropped after maxAttempts.
+//
+
+#ifndef csmaMac_h
+#define csmaMac_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "phyProfile.h"
+
+#define CSMA_DEFAULT_RSSI_THRESHOLD_DBM -90
+#define CSMA_DEFAULT_SENSE_US           1000
+#define CSMA_DEFAULT_BACKOFF_UNIT_US    ((PHY_SYNC_US + 999) / 1000 * 1000) // preamble and sync word
+#define CSMA_DEFAULT_MIN_BE             3
+#define CSMA_DEFAULT_MAX_BE             6
+#define CSMA_DEFAULT_MAX_ATTEMPTS       5
+
+typedef struct {
+    int8_t   rssiThresholdDbm;  // channel is busy at or above this level
+    uint16_t senseUs;           // length of the carrier sense window
+    uint16_t backoffUnitUs;
+    uint8_t  minBe;             // backoff exponent of the first attempt
+    uint8_t  maxBe;
+    uint8_t  maxAttempts;       // carrier sense attempts before the frame is dropped
+} CsmaConfig;
+
+void csmaDefaultConfig(CsmaConfig * cfg);
+
+/// Random backoff before attempt (0 based): a whole number of backoff units below 2^BE,
+/// where BE grows from minBe by one per attempt up to maxBe.
+uint32_t csmaBackoffUs(const CsmaConfig * cfg, uint8_t attempt, uint32_t random);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* csmaMac_h */
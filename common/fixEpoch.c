@@ -0,0 +1,222 @@
+//
+//  fixEpoch.c
+//  Epoch assembler for GGA and RMC
+//
+
+#include "fixEpoch.h"
+#include <string.h>
+
+#define DAY_MS  86400000UL
+
+/* Is time of day a after b? Less than half a day ahead counts as after. */
+static uint8_t isAfter(uint32_t a, uint32_t b) {
+
+    uint32_t d = (a + DAY_MS - b) % DAY_MS;
+    return d != 0 && d < DAY_MS / 2;
+}
+
+static void putLe16(uint8_t * buf, uint16_t v) {
+
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t getLe16(const uint8_t * buf) {
+
+    return (uint16_t)(buf[0] | (buf[1] << 8));
+}
+
+void fixEpochDefaultConfig(FixEpochConfig * config) {
+
+    config->expected = FIX_EPOCH_GGA | FIX_EPOCH_RMC;
+    config->waitMs   = 500;
+}
+
+void fixEpochInit(FixEpoch * a, const FixEpochConfig * config) {
+
+    memset(a, 0, sizeof(*a));
+    a->config = *config;
+}
+
+static void merge(EpochFix * e, const EpochFix * part) {
+
+    /* The GGA position wins, it comes with the quality that describes it */
+    if ((part->have & FIX_EPOCH_POSITION) &&
+        (!(e->have & FIX_EPOCH_POSITION) || (part->sources & FIX_EPOCH_GGA))) {
+        e->fix.latE7 = part->fix.latE7;
+        e->fix.lonE7 = part->fix.lonE7;
+        e->have |= FIX_EPOCH_POSITION;
+    }
+
+    if (part->sources & FIX_EPOCH_GGA) {
+        e->quality    = part->quality;
+        e->satellites = part->satellites;
+        e->hdop       = part->hdop;
+        if (part->have & FIX_EPOCH_ALTITUDE) {
+            e->fix.altM = part->fix.altM;
+            e->have |= FIX_EPOCH_ALTITUDE;
+        }
+    }
+    else if (!(e->sources & FIX_EPOCH_GGA))
+        e->quality = part->quality;
+
+    if (part->have & FIX_EPOCH_MOTION) {
+        e->speedCmS   = part->speedCmS;
+        e->courseCdeg = part->courseCdeg;
+        e->have |= FIX_EPOCH_MOTION;
+    }
+
+    e->sources |= part->sources;
+}
+
+/* The open epoch with the oldest time, or -1 */
+static int8_t oldestSlot(const FixEpoch * a) {
+
+    int8_t oldest = -1;
+    uint8_t i;
+
+    for (i = 0; i < FIX_EPOCH_SLOTS; ++i) {
+        if (a->slots[i].used && (oldest < 0 ||
+            isAfter(a->slots[oldest].epoch.fix.timeMs, a->slots[i].epoch.fix.timeMs)))
+            oldest = (int8_t)i;
+    }
+    return oldest;
+}
+
+static void emit(FixEpoch * a, FixEpochSlot * s, EpochFix * out) {
+
+    *out = s->epoch;
+    s->used = 0;
+    a->emitted = 1;
+    a->lastTimeMs = s->epoch.fix.timeMs;
+    ++a->epochs;
+}
+
+/* Emits slot s, after every open epoch older than it. Returns the number emitted. */
+static uint8_t emitThrough(FixEpoch * a, FixEpochSlot * s, EpochFix * out) {
+
+    uint8_t n = 0;
+    int8_t i;
+
+    while ((i = oldestSlot(a)) >= 0 && &a->slots[i] != s) {
+        emit(a, &a->slots[i], out + n++);
+        ++a->displaced;
+    }
+    emit(a, s, out + n++);
+
+    return n;
+}
+
+uint8_t fixEpochPoll(FixEpoch * a, uint32_t nowMs, EpochFix * out) {
+
+    uint8_t n = 0;
+    uint8_t i;
+
+    for (;;) {
+        /* Oldest first, so that an expired epoch does not push out an older one that expired too */
+        FixEpochSlot * expired = NULL;
+        for (i = 0; i < FIX_EPOCH_SLOTS; ++i) {
+            FixEpochSlot * s = &a->slots[i];
+            if (s->used && nowMs - s->firstMs >= a->config.waitMs &&
+                (expired == NULL || isAfter(expired->epoch.fix.timeMs, s->epoch.fix.timeMs)))
+                expired = s;
+        }
+        if (expired == NULL)
+            return n;
+
+        n += emitThrough(a, expired, out + n);
+        ++a->timedOut;
+    }
+}
+
+uint8_t fixEpochPush(FixEpoch * a, const EpochFix * part, uint32_t nowMs, EpochFix * out) {
+
+    uint32_t timeMs = part->fix.timeMs;
+    FixEpochSlot * s = NULL;
+    uint8_t n = fixEpochPoll(a, nowMs, out);
+    uint8_t i;
+
+    ++a->sentences;
+    if (a->emitted && !isAfter(timeMs, a->lastTimeMs)) {
+        ++a->late;
+        return n;
+    }
+
+    for (i = 0; i < FIX_EPOCH_SLOTS && s == NULL; ++i) {
+        if (a->slots[i].used && a->slots[i].epoch.fix.timeMs == timeMs)
+            s = &a->slots[i];
+    }
+
+    if (s == NULL) {
+        /* A new epoch; with every slot taken the oldest goes out as it is */
+        int8_t oldest = oldestSlot(a);
+        for (i = 0; i < FIX_EPOCH_SLOTS && a->slots[i].used; ++i)
+            ;
+        if (i == FIX_EPOCH_SLOTS) {
+            /* Older than every open epoch: it would have to go out first, but is just begun */
+            if (!isAfter(timeMs, a->slots[oldest].epoch.fix.timeMs)) {
+                ++a->late;
+                return n;
+            }
+            i = (uint8_t)oldest;
+            emit(a, &a->slots[i], out + n++);
+            ++a->displaced;
+        }
+
+        s = &a->slots[i];
+        memset(s, 0, sizeof(*s));
+        s->used = 1;
+        s->firstMs = nowMs;
+        s->epoch.fix.timeMs = timeMs;
+    }
+
+    /* A second sentence of the same type adds nothing */
+    if (s->epoch.sources & part->sources)
+        return n;
+    merge(&s->epoch, part);
+
+    if ((s->epoch.sources & a->config.expected) == a->config.expected) {
+        n += emitThrough(a, s, out + n);
+        ++a->complete;
+    }
+
+    return n;
+}
+
+uint8_t fixEpochFlush(FixEpoch * a, EpochFix * out) {
+
+    uint8_t n = 0;
+    int8_t i;
+
+    while ((i = oldestSlot(a)) >= 0)
+        emit(a, &a->slots[i], out + n++);
+
+    return n;
+}
+
+void fixEpochEncode(const EpochFix * e, uint8_t * buf) {
+
+    fixRecordEncode(&e->fix, buf);
+    buf += FIX_RECORD_WIRE_LENGTH;
+
+    putLe16(buf, e->speedCmS);
+    putLe16(buf + 2, e->courseCdeg);
+    putLe16(buf + 4, e->hdop);
+    buf[6] = e->quality;
+    buf[7] = e->satellites;
+    buf[8] = e->have;
+}
+
+void fixEpochDecode(EpochFix * e, const uint8_t * buf) {
+
+    fixRecordDecode(&e->fix, buf);
+    buf += FIX_RECORD_WIRE_LENGTH;
+
+    e->speedCmS   = getLe16(buf);
+    e->courseCdeg = getLe16(buf + 2);
+    e->hdop       = getLe16(buf + 4);
+    e->quality    = buf[6];
+    e->satellites = buf[7];
+    e->have       = buf[8];
+    e->sources    = 0;
+}
@@ -0,0 +1,102 @@
+//
+//  fixEpoch.h
+//  Epoch assembler: merges the GGA and RMC a receiver outputs for the same second into one
+//  fix with position, altitude, quality, speed and course
+//
+//  Sentences are grouped by their UTC time. An epoch is complete once every expected
+//  sentence type has arrived; it is given up and emitted with what it has waitMs after its
+//  first sentence, timed on a local clock, so a lost sentence costs a delay and not the fix.
+//  Up to FIX_EPOCH_SLOTS epochs are open at once, so a sentence may arrive after one of the
+//  next second. Epochs go out in time order: one that completes first pushes the older
+//  open ones out ahead of it. A sentence of an epoch already emitted is dropped.
+//
+//  Epochs without a fix are emitted too, with quality 0 and no position, so that a tracker
+//  keeps its once a second frame.
+//
+
+#ifndef fixEpoch_h
+#define fixEpoch_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "fixLog.h"
+
+#define FIX_EPOCH_SLOTS         2
+#define FIX_EPOCH_MAX_OUT       (FIX_EPOCH_SLOTS + 1)   // epochs one call can emit
+#define FIX_EPOCH_WIRE_LENGTH   (FIX_RECORD_WIRE_LENGTH + 9)
+
+// Sentence types, in sources and FixEpochConfig.expected
+#define FIX_EPOCH_GGA           0x01
+#define FIX_EPOCH_RMC           0x02
+
+// Fields an EpochFix carries, in have
+#define FIX_EPOCH_POSITION      0x01    // fix.latE7, fix.lonE7
+#define FIX_EPOCH_ALTITUDE      0x02    // fix.altM, from a GGA with a fix
+#define FIX_EPOCH_MOTION        0x04    // speedCmS, courseCdeg, from an RMC with a fix
+
+#define FIX_EPOCH_NO_DOP        0xFFFF  // hdop not known (a NAV-PVT without its NAV-DOP)
+
+/// A merged fix, or what one sentence contributes to it
+typedef struct {
+    FixRecord fix;          // timeMs always, the rest as have says
+    uint16_t  speedCmS;
+    uint16_t  courseCdeg;   // 0.01 degrees clockwise from true north
+    uint16_t  hdop;         // 0.01, from the GGA, FIX_EPOCH_NO_DOP if unknown
+    uint8_t   quality;      // GGA fix quality; 1 for an RMC with a fix and no GGA; 0 no fix
+    uint8_t   satellites;   // in use, from the GGA
+    uint8_t   have;         // FIX_EPOCH_POSITION | FIX_EPOCH_ALTITUDE | FIX_EPOCH_MOTION
+    uint8_t   sources;      // FIX_EPOCH_GGA | FIX_EPOCH_RMC, as pushed (not on the wire)
+} EpochFix;
+
+typedef struct {
+    uint8_t  expected;      // sentences that complete an epoch
+    uint16_t waitMs;        // after the first sentence of an epoch, on the local clock
+} FixEpochConfig;
+
+typedef struct {
+    EpochFix epoch;
+    uint32_t firstMs;       // local clock at its first sentence
+    uint8_t  used;
+} FixEpochSlot;
+
+typedef struct {
+    FixEpochConfig config;
+    FixEpochSlot   slots[FIX_EPOCH_SLOTS];
+    uint8_t        emitted;         // lastTimeMs is valid
+    uint32_t       lastTimeMs;      // UTC time of day of the newest epoch emitted
+    /* Statistics */
+    uint32_t sentences;
+    uint32_t epochs;                // emitted
+    uint32_t complete;              // emitted with every expected sentence
+    uint32_t timedOut;              // emitted after waitMs
+    uint32_t displaced;             // emitted early, pushed out by a newer epoch
+    uint32_t late;                  // sentences of an epoch already emitted, dropped
+} FixEpoch;
+
+/// GGA and RMC, waiting up to 500 ms.
+void fixEpochDefaultConfig(FixEpochConfig * config);
+
+void fixEpochInit(FixEpoch * a, const FixEpochConfig * config);
+
+/// Takes what one sentence contributes (sources is FIX_EPOCH_GGA or FIX_EPOCH_RMC) at
+/// nowMs on the local clock. Returns the number of epochs now emitted, oldest first in
+/// out, which must hold FIX_EPOCH_MAX_OUT.
+uint8_t fixEpochPush(FixEpoch * a, const EpochFix * part, uint32_t nowMs, EpochFix * out);
+
+/// Emits the epochs whose wait has run out at nowMs, as fixEpochPush().
+uint8_t fixEpochPoll(FixEpoch * a, uint32_t nowMs, EpochFix * out);
+
+/// Emits every open epoch, as fixEpochPush().
+uint8_t fixEpochFlush(FixEpoch * a, EpochFix * out);
+
+void fixEpochEncode(const EpochFix * e, uint8_t * buf);
+void fixEpochDecode(EpochFix * e, const uint8_t * buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* fixEpoch_h */
@@ -0,0 +1,224 @@
+//
+//  fixFilter.c
+//  Fixed-point constant velocity Kalman filter for the tracker's GPS fixes
+//
+
+#include "fixFilter.h"
+#include <string.h>
+
+#define DAY_MS              86400000UL
+#define START_SPEED_CMS     2000        // velocity uncertainty of a restart without RMC
+#define FAR_CM              (1L << 24)  // innovations beyond this are outliers unseen
+
+/***** Projection *****/
+
+void fixFilterPosition(const FixFilter * f, int32_t * latE7, int32_t * lonE7) {
+
+    geoUnproject(&f->plane, f->east.pos, f->north.pos, latE7, lonE7);
+}
+
+/* The flat projection drifts with distance: move the origin to the current position */
+static void recentre(FixFilter * f) {
+
+    int32_t latE7, lonE7;
+
+    fixFilterPosition(f, &latE7, &lonE7);
+    geoPlaneInit(&f->plane, latE7, lonE7);
+
+    f->sentEast  -= f->east.pos;
+    f->sentNorth -= f->north.pos;
+    f->east.pos  = 0;
+    f->north.pos = 0;
+}
+
+/***** Kalman filter, one axis *****/
+
+/* Constant velocity over dt, acceleration noise with variance accelVar */
+static void axisPredict(FixFilterAxis * a, int64_t dtMs, int64_t accelVar) {
+
+    int64_t qvv = accelVar * dtMs * dtMs / 1000000;
+    int64_t qpv = qvv * dtMs / 2000;
+    int64_t qpp = qpv * dtMs / 2000;
+
+    a->pos += (int32_t)(a->vel * dtMs / 1000);
+    a->ppp += 2 * a->ppv * dtMs / 1000 + a->pvv * dtMs * dtMs / 1000000 + qpp;
+    a->ppv += a->pvv * dtMs / 1000 + qpv;
+    a->pvv += qvv;
+}
+
+static void axisUpdatePosition(FixFilterAxis * a, int64_t z, int64_t r) {
+
+    int64_t s = a->ppp + r;
+    int64_t y = z - a->pos;
+
+    a->pos += (int32_t)(a->ppp * y / s);
+    a->vel += (int32_t)(a->ppv * y / s);
+    a->pvv -= a->ppv * a->ppv / s;
+    a->ppv  = a->ppv * r / s;
+    a->ppp  = a->ppp * r / s;
+}
+
+static void axisUpdateVelocity(FixFilterAxis * a, int64_t z, int64_t r) {
+
+    int64_t s = a->pvv + r;
+    int64_t y = z - a->vel;
+
+    a->pos += (int32_t)(a->ppv * y / s);
+    a->vel += (int32_t)(a->pvv * y / s);
+    a->ppp -= a->ppv * a->ppv / s;
+    a->ppv  = a->ppv * r / s;
+    a->pvv  = a->pvv * r / s;
+}
+
+static void axisStart(FixFilterAxis * a, int32_t vel, int64_t posVar, int64_t velVar) {
+
+    a->pos = 0;
+    a->vel = vel;
+    a->ppp = posVar;
+    a->ppv = 0;
+    a->pvv = velVar;
+}
+
+/***** Filter *****/
+
+void fixFilterDefaultConfig(FixFilterConfig * config) {
+
+    config->posSigmaCm     = 500;
+    config->speedSigmaCmS  = 50;
+    config->accelSigmaCmS2 = 100;
+    config->gate           = 16;
+    config->maxRejects     = 5;
+    config->toleranceCm    = 1500;
+    config->maxSilenceS    = 30;
+}
+
+void fixFilterInit(FixFilter * f, const FixFilterConfig * config) {
+
+    memset(f, 0, sizeof(*f));
+    f->config = *config;
+}
+
+static void velocityOf(const FixMeasurement * m, int32_t * east, int32_t * north) {
+
+    *east  = (int32_t)m->speedCmS * geoSineQ15(m->courseCdeg) / 32768;
+    *north = (int32_t)m->speedCmS * geoCosineQ15(m->courseCdeg) / 32768;
+}
+
+static FixFilterVerdict send(FixFilter * f) {
+
+    f->sentTimeMs   = f->timeMs;
+    f->sentEast     = f->east.pos;
+    f->sentNorth    = f->north.pos;
+    f->sentVelEast  = f->east.vel;
+    f->sentVelNorth = f->north.vel;
+    ++f->sent;
+
+    return FIX_FILTER_SEND;
+}
+
+static FixFilterVerdict restart(FixFilter * f, const FixMeasurement * m) {
+
+    int64_t posVar = (int64_t)f->config.posSigmaCm * f->config.posSigmaCm;
+    int64_t velVar = (int64_t)START_SPEED_CMS * START_SPEED_CMS;
+    int32_t velEast = 0, velNorth = 0;
+
+    if (m->speedCmS != FIX_FILTER_NO_SPEED) {
+        velocityOf(m, &velEast, &velNorth);
+        velVar = (int64_t)f->config.speedSigmaCmS * f->config.speedSigmaCmS;
+    }
+
+    geoPlaneInit(&f->plane, m->latE7, m->lonE7);
+    axisStart(&f->east, velEast, posVar, velVar);
+    axisStart(&f->north, velNorth, posVar, velVar);
+    f->timeMs = m->timeMs;
+    f->started = 1;
+    f->rejects = 0;
+    f->epochRejected = 0;
+    ++f->restarts;
+
+    return send(f);
+}
+
+FixFilterVerdict fixFilterUpdate(FixFilter * f, const FixMeasurement * m) {
+
+    int64_t posVar = (int64_t)f->config.posSigmaCm * f->config.posSigmaCm;
+    int64_t velVar = (int64_t)f->config.speedSigmaCmS * f->config.speedSigmaCmS;
+    int32_t velEast, velNorth;
+
+    ++f->updates;
+
+    if (!f->started)
+        return restart(f, m);
+
+    uint32_t dtMs = (m->timeMs + DAY_MS - f->timeMs) % DAY_MS;
+
+    /* GGA and RMC of the same epoch: the position is in already */
+    if (dtMs == 0) {
+        if (!f->epochRejected && m->speedCmS != FIX_FILTER_NO_SPEED) {
+            velocityOf(m, &velEast, &velNorth);
+            axisUpdateVelocity(&f->east, velEast, velVar);
+            axisUpdateVelocity(&f->north, velNorth, velVar);
+        }
+        ++f->duplicates;
+        return FIX_FILTER_DUPLICATE;
+    }
+
+    if (dtMs > FIX_FILTER_MAX_GAP_MS)
+        return restart(f, m);
+
+    int64_t accelVar = (int64_t)f->config.accelSigmaCmS2 * f->config.accelSigmaCmS2;
+    axisPredict(&f->east, dtMs, accelVar);
+    axisPredict(&f->north, dtMs, accelVar);
+    f->timeMs = m->timeMs;
+
+    /* Innovation gate: y^2 / S summed over both axes, in 1/256 */
+    int64_t east, north;
+    geoProject(&f->plane, m->latE7, m->lonE7, &east, &north);
+
+    int64_t yEast  = east - f->east.pos;
+    int64_t yNorth = north - f->north.pos;
+
+    if (yEast > FAR_CM || yEast < -FAR_CM || yNorth > FAR_CM || yNorth < -FAR_CM ||
+        yEast * yEast * 256 / (f->east.ppp + posVar) + yNorth * yNorth * 256 / (f->north.ppp + posVar) >
+        (int64_t)f->config.gate * 256) {
+
+        f->epochRejected = 1;
+        if (++f->rejects >= f->config.maxRejects)
+            return restart(f, m);
+
+        ++f->outliers;
+        return FIX_FILTER_OUTLIER;
+    }
+
+    f->rejects = 0;
+    f->epochRejected = 0;
+
+    axisUpdatePosition(&f->east, east, posVar);
+    axisUpdatePosition(&f->north, north, posVar);
+
+    if (m->speedCmS != FIX_FILTER_NO_SPEED) {
+        velocityOf(m, &velEast, &velNorth);
+        axisUpdateVelocity(&f->east, velEast, velVar);
+        axisUpdateVelocity(&f->north, velNorth, velVar);
+    }
+
+    if (f->east.pos > FIX_FILTER_RECENTRE_CM || f->east.pos < -FIX_FILTER_RECENTRE_CM ||
+        f->north.pos > FIX_FILTER_RECENTRE_CM || f->north.pos < -FIX_FILTER_RECENTRE_CM)
+        recentre(f);
+
+    /* Would the last sent fix, extrapolated, still do? */
+    uint32_t elapsedMs = (f->timeMs + DAY_MS - f->sentTimeMs) % DAY_MS;
+
+    if (elapsedMs >= (uint32_t)f->config.maxSilenceS * 1000)
+        return send(f);
+
+    int64_t dEast  = f->east.pos - (f->sentEast + (int64_t)f->sentVelEast * elapsedMs / 1000);
+    int64_t dNorth = f->north.pos - (f->sentNorth + (int64_t)f->sentVelNorth * elapsedMs / 1000);
+    int64_t tolerance = f->config.toleranceCm;
+
+    if (dEast * dEast + dNorth * dNorth > tolerance * tolerance)
+        return send(f);
+
+    ++f->suppressed;
+    return FIX_FILTER_SUPPRESS;
+}
@@ -0,0 +1,110 @@
+//
+//  fixFilter.h
+//  Fixed-point constant velocity Kalman filter for the tracker's GPS fixes, with outlier
+//  rejection and dead reckoning suppression
+//
+//  Fixes are projected onto a flat east/north plane around the first fix, in centimetres.
+//  East and north are filtered independently, each with a position/velocity state and
+//  a white acceleration process model. GGA gives a position, RMC a position and a
+//  velocity from speed and course. All arithmetic is integer; covariances are 64 bit.
+//
+//  Each fix gets a verdict:
+//
+//      FIX_FILTER_OUTLIER      the position innovation failed the chi-square gate (2 degrees
+//                              of freedom), e.g. a multipath jump; the state is not touched.
+//                              After maxRejects outliers in a row the filter restarts on the
+//                              new position, since the tracker really did move there.
+//      FIX_FILTER_DUPLICATE    second sentence of a fix epoch already seen; only its velocity
+//                              is used
+//      FIX_FILTER_SUPPRESS     extrapolating the last sent fix at its velocity still lands
+//                              within toleranceCm of the filtered position
+//      FIX_FILTER_SEND         anything else, and at least every maxSilenceS seconds
+//
+
+#ifndef fixFilter_h
+#define fixFilter_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "geoPlane.h"
+
+#define FIX_FILTER_NO_SPEED     0xFFFF      // speedCmS of sentences without velocity (GGA)
+#define FIX_FILTER_MAX_GAP_MS   30000       // longer gaps restart the filter
+#define FIX_FILTER_RECENTRE_CM  10000000    // 100 km from the origin moves the origin
+
+typedef struct {
+    uint32_t timeMs;        // UTC time of day
+    int32_t  latE7;         // degrees * 1e7, north positive
+    int32_t  lonE7;         // degrees * 1e7, east positive
+    uint16_t speedCmS;      // over ground, FIX_FILTER_NO_SPEED if unknown
+    uint16_t courseCdeg;    // true course in 0.01 degrees
+} FixMeasurement;
+
+typedef struct {
+    uint16_t posSigmaCm;        // receiver position noise
+    uint16_t speedSigmaCmS;     // receiver velocity noise, per axis
+    uint16_t accelSigmaCmS2;    // process noise
+    uint8_t  gate;              // innovation limit, normalized and squared (chi-square, 2 dof)
+    uint8_t  maxRejects;
+    uint16_t toleranceCm;       // dead reckoning error that is still suppressed
+    uint16_t maxSilenceS;
+} FixFilterConfig;
+
+typedef enum {
+    FIX_FILTER_SEND = 0,
+    FIX_FILTER_SUPPRESS,
+    FIX_FILTER_DUPLICATE,
+    FIX_FILTER_OUTLIER
+} FixFilterVerdict;
+
+typedef struct {
+    int32_t pos;            // cm from the origin
+    int32_t vel;            // cm/s
+    int64_t ppp;            // covariance, cm^2
+    int64_t ppv;            // cm^2/s
+    int64_t pvv;            // cm^2/s^2
+} FixFilterAxis;
+
+typedef struct {
+    FixFilterConfig config;
+    uint8_t  started;
+    uint8_t  rejects;           // outliers in a row
+    uint8_t  epochRejected;     // the position of the current epoch was an outlier
+    GeoPlane plane;             // around the first fix
+    uint32_t timeMs;            // epoch of the state
+    FixFilterAxis east;
+    FixFilterAxis north;
+    /* Dead reckoning reference: the filtered state when a fix was last sent */
+    uint32_t sentTimeMs;
+    int32_t  sentEast;
+    int32_t  sentNorth;
+    int32_t  sentVelEast;
+    int32_t  sentVelNorth;
+    /* Statistics */
+    uint32_t updates;
+    uint32_t sent;
+    uint32_t suppressed;
+    uint32_t duplicates;
+    uint32_t outliers;
+    uint32_t restarts;
+} FixFilter;
+
+/// 5 m and 0.5 m/s receiver noise, 1 m/s^2 process noise, gate 16, restart after 5
+/// outliers, 15 m tolerance, a fix at least every 30 s.
+void fixFilterDefaultConfig(FixFilterConfig * config);
+
+void fixFilterInit(FixFilter * f, const FixFilterConfig * config);
+
+FixFilterVerdict fixFilterUpdate(FixFilter * f, const FixMeasurement * m);
+
+/// Filtered position of the last epoch.
+void fixFilterPosition(const FixFilter * f, int32_t * latE7, int32_t * lonE7);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* fixFilter_h */
@@ -0,0 +1,71 @@
+//
+//  fixGate.c
+//  Fix quality gate
+//
+
+#include "fixGate.h"
+#include <string.h>
+
+#define DAY_MS  86400000UL
+
+void fixGateDefaultConfig(FixGateConfig * config) {
+
+    config->minSatellites   = 5;
+    config->minFixMode      = 3;
+    config->acceptEstimated = 0;
+    config->maxHdop         = 250;
+    config->maxPdop         = 400;
+    config->maxVdop         = 0;
+    config->maxSilenceS     = 300;
+}
+
+void fixGateInit(FixGate * gate, const FixGateConfig * config) {
+
+    memset(gate, 0, sizeof(*gate));
+    gate->config = *config;
+}
+
+FixGateVerdict fixGateJudge(const FixGateConfig * config, const FixQuality * q) {
+
+    if (q->quality == 0 || (q->quality == 6 && !config->acceptEstimated))
+        return FIX_GATE_NO_FIX;
+    if (q->satellites < config->minSatellites)
+        return FIX_GATE_SATELLITES;
+    if (config->minFixMode && q->fixMode && q->fixMode < config->minFixMode)
+        return FIX_GATE_FIX_MODE;
+    if (config->maxHdop && q->hdop != FIX_GATE_NO_DOP && q->hdop > config->maxHdop)
+        return FIX_GATE_HDOP;
+    if (config->maxPdop && q->pdop != FIX_GATE_NO_DOP && q->pdop > config->maxPdop)
+        return FIX_GATE_PDOP;
+    if (config->maxVdop && q->vdop != FIX_GATE_NO_DOP && q->vdop > config->maxVdop)
+        return FIX_GATE_VDOP;
+
+    return FIX_GATE_PASS;
+}
+
+uint8_t fixGateCheck(FixGate * gate, const FixQuality * q, uint32_t timeMs) {
+
+    FixGateVerdict verdict = fixGateJudge(&gate->config, q);
+
+    ++gate->checked;
+    if (!gate->started) {
+        gate->started = 1;
+        gate->lastPassMs = timeMs;
+    }
+
+    if (verdict != FIX_GATE_PASS) {
+        ++gate->rejected[verdict];
+
+        /* Nothing passed for too long: a poor fix beats silence, as long as it is one */
+        if (verdict == FIX_GATE_NO_FIX || !gate->config.maxSilenceS ||
+            (timeMs + DAY_MS - gate->lastPassMs) % DAY_MS < (uint32_t)gate->config.maxSilenceS * 1000)
+            return 0;
+
+        ++gate->forced;
+    }
+    else
+        ++gate->passed;
+
+    gate->lastPassMs = timeMs;
+    return 1;
+}
@@ -0,0 +1,79 @@
+//
+//  fixGate.h
+//  Fix quality gate: keeps fixes the receiver itself marks as poor off the air
+//
+//  A fix passes if the GGA fix quality and the satellites in use, and where they are known
+//  the HDOP, fix mode, PDOP and VDOP, all meet the thresholds. Thresholds of 0 are
+//  not checked. DOPs are in hundredths. So that a tracker stuck indoors is not mistaken for
+//  a dead one, a failing fix is still let through once nothing has passed for maxSilenceS.
+//
+
+#ifndef fixGate_h
+#define fixGate_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define FIX_GATE_NO_DOP     0xFFFF      // DOP not known (no GSA or NAV-DOP yet)
+
+typedef struct {
+    uint8_t  quality;       // GGA: 0 none, 1 GPS, 2 DGPS, 4 RTK fixed, 5 RTK float, 6 estimated
+    uint8_t  satellites;    // in use
+    uint8_t  fixMode;       // GSA: 1 none, 2 2D, 3 3D, 0 unknown
+    uint16_t hdop;          // 0.01, FIX_GATE_NO_DOP if unknown
+    uint16_t pdop;          // 0.01, FIX_GATE_NO_DOP if unknown
+    uint16_t vdop;          // 0.01, FIX_GATE_NO_DOP if unknown
+} FixQuality;
+
+typedef struct {
+    uint8_t  minSatellites;
+    uint8_t  minFixMode;
+    uint8_t  acceptEstimated;   // dead reckoned fixes (quality 6) count as fixes
+    uint16_t maxHdop;
+    uint16_t maxPdop;
+    uint16_t maxVdop;
+    uint16_t maxSilenceS;
+} FixGateConfig;
+
+typedef enum {
+    FIX_GATE_PASS = 0,
+    FIX_GATE_NO_FIX,            // quality 0, or estimated
+    FIX_GATE_SATELLITES,
+    FIX_GATE_FIX_MODE,
+    FIX_GATE_HDOP,
+    FIX_GATE_PDOP,
+    FIX_GATE_VDOP,
+    FIX_GATE_REASONS
+} FixGateVerdict;
+
+typedef struct {
+    FixGateConfig config;
+    uint8_t  started;
+    uint32_t lastPassMs;        // UTC time of day of the last fix let through, or the first one seen
+    /* Statistics */
+    uint32_t checked;
+    uint32_t passed;
+    uint32_t forced;            // failing fixes let through after maxSilenceS
+    uint32_t rejected[FIX_GATE_REASONS];
+} FixGate;
+
+/// 5 satellites, a 3D fix, HDOP 2.5, PDOP 4.0, VDOP unchecked, no estimated fixes, and a
+/// fix at least every 5 minutes.
+void fixGateDefaultConfig(FixGateConfig * config);
+
+void fixGateInit(FixGate * gate, const FixGateConfig * config);
+
+/// What is wrong with a fix, the first failing threshold, or FIX_GATE_PASS.
+FixGateVerdict fixGateJudge(const FixGateConfig * config, const FixQuality * q);
+
+/// Returns 1 if the fix at timeMs (UTC time of day) should be sent.
+uint8_t fixGateCheck(FixGate * gate, const FixQuality * q, uint32_t timeMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* fixGate_h */
@@ -0,0 +1,315 @@
+//
+//  fixLog.c
+//  Store-and-forward log of compact fix records on NOR flash
+//
+
+#include "fixLog.h"
+#include <string.h>
+
+#define FIXLOG_MAGIC        0x474F4C46  // "FLOG"
+
+/***** Record format *****/
+
+static void putLe32(uint8_t * buf, uint32_t v) {
+
+    buf[0] = (uint8_t)(v);
+    buf[1] = (uint8_t)(v >> 8);
+    buf[2] = (uint8_t)(v >> 16);
+    buf[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getLe32(const uint8_t * buf) {
+
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static uint8_t crc8(const uint8_t * buf, uint8_t length) {
+
+    uint8_t crc = 0;
+    uint8_t i, bit;
+
+    for (i = 0; i < length; ++i) {
+        crc ^= buf[i];
+        for (bit = 0; bit < 8; ++bit)
+            crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+
+    return crc;
+}
+
+void fixRecordEncode(const FixRecord * rec, uint8_t * buf) {
+
+    putLe32(buf, rec->timeMs);
+    putLe32(buf + 4, (uint32_t)rec->latE7);
+    putLe32(buf + 8, (uint32_t)rec->lonE7);
+    buf[12] = (uint8_t)(rec->altM);
+    buf[13] = (uint8_t)((uint16_t)rec->altM >> 8);
+}
+
+void fixRecordDecode(FixRecord * rec, const uint8_t * buf) {
+
+    rec->timeMs = getLe32(buf);
+    rec->latE7  = (int32_t)getLe32(buf + 4);
+    rec->lonE7  = (int32_t)getLe32(buf + 8);
+    rec->altM   = (int16_t)(buf[12] | (buf[13] << 8));
+}
+
+/***** Flash layout *****/
+
+static uint32_t slotOffset(const FixLog * log, uint16_t sector, uint16_t slot) {
+
+    return (uint32_t)sector * log->flash->sectorSize + (uint32_t)slot * FIXLOG_SLOT_SIZE;
+}
+
+static uint8_t flashWrite(FixLog * log, uint32_t offset, const void * buf, uint32_t length) {
+
+    ++log->programs;
+    log->programmedBytes += length;
+
+    return log->flash->write(log->flash->ctx, offset, buf, length);
+}
+
+/// Reads a sector header. Returns 0 if it is one of ours.
+static uint8_t readHeader(const FixLog * log, uint16_t sector, uint32_t * lap, uint32_t * eraseCount) {
+
+    uint8_t hdr[FIXLOG_SLOT_SIZE];
+
+    if (log->flash->read(log->flash->ctx, slotOffset(log, sector, 0), hdr, sizeof(hdr)) ||
+        getLe32(hdr) != FIXLOG_MAGIC)
+        return 1;
+
+    *lap = getLe32(hdr + 4);
+    *eraseCount = getLe32(hdr + 8);
+
+    return 0;
+}
+
+/// Erases the sector after the head and makes it the new head
+static uint8_t openNextSector(FixLog * log) {
+
+    uint16_t next = (uint16_t)((log->headSector + 1) % log->numSectors);
+    uint32_t lap, eraseCount = 0;
+
+    if (fixLogFlush(log))
+        return 1;
+
+    /* Ring full: the oldest sector goes */
+    if (log->count > 0 && next == log->tailSector) {
+
+        uint16_t lost = (uint16_t)(log->slotsPerSector - log->tailSlot);
+
+        log->count -= lost;
+        log->dropped += lost;
+        log->tailSector = (uint16_t)((next + 1) % log->numSectors);
+        log->tailSlot = 1;
+    }
+
+    readHeader(log, next, &lap, &eraseCount);
+
+    ++log->erases;
+    if (log->flash->erase(log->flash->ctx, slotOffset(log, next, 0), log->flash->sectorSize))
+        return 1;
+
+    uint8_t hdr[FIXLOG_SLOT_SIZE];
+    memset(hdr, 0xFF, sizeof(hdr));
+    putLe32(hdr, FIXLOG_MAGIC);
+    putLe32(hdr + 4, ++log->headLap);
+    putLe32(hdr + 8, eraseCount + 1);
+
+    if (flashWrite(log, slotOffset(log, next, 0), hdr, sizeof(hdr)))
+        return 1;
+
+    log->headSector = next;
+    log->headSlot = 1;
+
+    if (log->count == 0) {
+        log->tailSector = next;
+        log->tailSlot = 1;
+    }
+
+    return 0;
+}
+
+/***** Log *****/
+
+uint8_t fixLogMount(FixLog * log, const FixLogFlash * flash) {
+
+    memset(log, 0, sizeof(*log));
+    log->flash = flash;
+
+    if (flash->sectorSize % FIXLOG_SLOT_SIZE || flash->pageSize % FIXLOG_SLOT_SIZE ||
+        flash->pageSize == 0 || flash->pageSize > FIXLOG_MAX_PAGE ||
+        flash->sectorSize % flash->pageSize || flash->size / flash->sectorSize < 2)
+        return 1;
+
+    log->numSectors = (uint16_t)(flash->size / flash->sectorSize);
+    log->slotsPerSector = (uint16_t)(flash->sectorSize / FIXLOG_SLOT_SIZE);
+
+    /* Head: the sector of the latest lap */
+    uint8_t found = 0;
+    uint16_t sector;
+    uint32_t lap, eraseCount;
+
+    for (sector = 0; sector < log->numSectors; ++sector) {
+        if (readHeader(log, sector, &lap, &eraseCount) == 0 &&
+            (!found || (int32_t)(lap - log->headLap) > 0)) {
+            log->headLap = lap;
+            log->headSector = sector;
+            found = 1;
+        }
+    }
+
+    if (!found) {
+        log->headSector = (uint16_t)(log->numSectors - 1);
+        return openNextSector(log);
+    }
+
+    /* Walk the ring from the oldest sector: the first valid record is the tail */
+    uint8_t tailFound = 0;
+    uint16_t i, slot;
+
+    log->headSlot = log->slotsPerSector;
+
+    for (i = 1; i <= log->numSectors; ++i) {
+
+        sector = (uint16_t)((log->headSector + i) % log->numSectors);
+        if (readHeader(log, sector, &lap, &eraseCount))
+            continue;
+
+        for (slot = 1; slot < log->slotsPerSector; ++slot) {
+
+            uint8_t state;
+            if (flash->read(flash->ctx, slotOffset(log, sector, slot), &state, 1))
+                return 1;
+
+            if (state == FIXLOG_STATE_FREE) {
+                if (sector == log->headSector)
+                    log->headSlot = slot;
+                break;
+            }
+
+            if (state == FIXLOG_STATE_CONSUMED)
+                continue;
+
+            if (!tailFound) {
+                log->tailSector = sector;
+                log->tailSlot = slot;
+                tailFound = 1;
+            }
+            ++log->count;
+        }
+    }
+
+    if (!tailFound) {
+        log->tailSector = log->headSector;
+        log->tailSlot = log->headSlot;
+    }
+
+    log->pageOffset = slotOffset(log, log->headSector, log->headSlot);
+
+    return 0;
+}
+
+uint8_t fixLogFlush(FixLog * log) {
+
+    if (log->pageFlushed == log->pageFill)
+        return 0;
+
+    if (flashWrite(log, log->pageOffset + log->pageFlushed, log->page + log->pageFlushed,
+                   log->pageFill - log->pageFlushed))
+        return 1;
+
+    log->pageFlushed = log->pageFill;
+
+    return 0;
+}
+
+uint8_t fixLogAppend(FixLog * log, const FixRecord * rec) {
+
+    if (log->headSlot >= log->slotsPerSector && openNextSector(log))
+        return 1;
+
+    uint32_t offset = slotOffset(log, log->headSector, log->headSlot);
+
+    /* Start a new page buffer at a page boundary or after a sector change */
+    if (offset != log->pageOffset + log->pageFill || offset % log->flash->pageSize == 0) {
+        if (fixLogFlush(log))
+            return 1;
+        log->pageOffset = offset;
+        log->pageFill = 0;
+        log->pageFlushed = 0;
+    }
+
+    uint8_t * slot = log->page + log->pageFill;
+    slot[0] = FIXLOG_STATE_VALID;
+    fixRecordEncode(rec, slot + 2);
+    slot[1] = crc8(slot + 2, FIX_RECORD_WIRE_LENGTH);
+
+    log->pageFill += FIXLOG_SLOT_SIZE;
+    ++log->headSlot;
+    ++log->count;
+    ++log->appended;
+
+    /* Page complete */
+    if ((offset + FIXLOG_SLOT_SIZE) % log->flash->pageSize == 0)
+        return fixLogFlush(log);
+
+    return 0;
+}
+
+uint8_t fixLogPeek(FixLog * log, FixRecord * recs, uint8_t max) {
+
+    uint16_t sector = log->tailSector;
+    uint16_t slot = log->tailSlot;
+    uint32_t left = log->count;
+    uint8_t n = 0;
+
+    if (fixLogFlush(log))
+        return 0;
+
+    while (n < max && left > 0) {
+
+        if (slot >= log->slotsPerSector) {
+            sector = (uint16_t)((sector + 1) % log->numSectors);
+            slot = 1;
+        }
+
+        uint8_t buf[FIXLOG_SLOT_SIZE];
+        if (log->flash->read(log->flash->ctx, slotOffset(log, sector, slot), buf, sizeof(buf)))
+            break;
+
+        /* A torn or corrupted record still takes its place in the order, it reads as
+         * an all zero fix the gateway can recognise */
+        if (buf[0] != FIXLOG_STATE_VALID || buf[1] != crc8(buf + 2, FIX_RECORD_WIRE_LENGTH))
+            memset(&recs[n], 0, sizeof(recs[n]));
+        else
+            fixRecordDecode(&recs[n], buf + 2);
+
+        ++n;
+        ++slot;
+        --left;
+    }
+
+    return n;
+}
+
+uint8_t fixLogConsume(FixLog * log, uint8_t n) {
+
+    static const uint8_t consumed = FIXLOG_STATE_CONSUMED;
+
+    while (n-- > 0 && log->count > 0) {
+
+        if (log->tailSlot >= log->slotsPerSector) {
+            log->tailSector = (uint16_t)((log->tailSector + 1) % log->numSectors);
+            log->tailSlot = 1;
+        }
+
+        if (flashWrite(log, slotOffset(log, log->tailSector, log->tailSlot), &consumed, 1))
+            return 1;
+
+        ++log->tailSlot;
+        --log->count;
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+//
+//  fixLog.h
+//  Store-and-forward log of compact fix records on NOR flash
+//
+//  The flash region is a ring of sectors written strictly in order, so every sector is
+//  erased once per lap and wear is spread evenly. Each sector starts with a header slot
+//  (magic, lap sequence number, erase count) followed by fixed size record slots:
+//
+//      byte 0      state: 0xFF free, FIXLOG_STATE_VALID written, 0x00 consumed
+//      byte 1      CRC-8 of the record
+//      byte 2..15  FixRecord in wire format (FIX_RECORD_WIRE_LENGTH)
+//
+//  Appended records collect in a RAM page buffer and are programmed one flash page at a
+//  time; fixLogFlush() writes a partial page. Records are only ever programmed from 1 to 0
+//  bits, the consumed mark included, so nothing but whole sectors is ever erased. When
+//  the ring is full the oldest sector is erased and its records are dropped.
+//
+//  The flash is reached through FixLogFlash: NVS on the tracker, a file on the host.
+//
+
+#ifndef fixLog_h
+#define fixLog_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define FIX_RECORD_WIRE_LENGTH  14
+#define FIXLOG_SLOT_SIZE        16
+#define FIXLOG_MAX_PAGE         256
+#define FIXLOG_STATE_FREE       0xFF
+#define FIXLOG_STATE_VALID      0xA5
+#define FIXLOG_STATE_CONSUMED   0x00
+
+typedef struct {
+    uint32_t timeMs;        // UTC time of day
+    int32_t  latE7;         // degrees * 1e7, north positive
+    int32_t  lonE7;         // degrees * 1e7, east positive
+    int16_t  altM;          // above mean sea level
+} FixRecord;
+
+/// Flash access. All functions return 0 on success. write only clears bits, erase sets a
+/// whole sector to 0xFF.
+typedef struct {
+    void *   ctx;
+    uint32_t size;          // a multiple of sectorSize
+    uint32_t sectorSize;
+    uint16_t pageSize;      // program granularity of the RAM buffer, at most FIXLOG_MAX_PAGE
+    uint8_t (*read)(void * ctx, uint32_t offset, void * buf, uint32_t length);
+    uint8_t (*write)(void * ctx, uint32_t offset, const void * buf, uint32_t length);
+    uint8_t (*erase)(void * ctx, uint32_t offset, uint32_t length);
+} FixLogFlash;
+
+typedef struct {
+    const FixLogFlash * flash;
+    uint16_t numSectors;
+    uint16_t slotsPerSector;    // header slot included
+    uint32_t headLap;           // lap sequence number of the sector being written
+    uint16_t headSector;
+    uint16_t headSlot;
+    uint16_t tailSector;
+    uint16_t tailSlot;
+    uint32_t count;             // records not consumed yet
+    uint8_t  page[FIXLOG_MAX_PAGE];
+    uint32_t pageOffset;        // flash offset of page[0]
+    uint16_t pageFill;          // bytes in page[]
+    uint16_t pageFlushed;       // bytes of page[] already programmed
+    /* Statistics */
+    uint32_t appended;
+    uint32_t dropped;           // overwritten before they were drained
+    uint32_t programs;          // flash program operations
+    uint32_t programmedBytes;
+    uint32_t erases;
+} FixLog;
+
+void fixRecordEncode(const FixRecord * rec, uint8_t * buf);
+void fixRecordDecode(FixRecord * rec, const uint8_t * buf);
+
+/// Finds head and tail of an existing log, or starts a new one on blank or foreign flash.
+/// Returns 0 on success, 1 if the flash geometry is unusable or the flash fails.
+uint8_t fixLogMount(FixLog * log, const FixLogFlash * flash);
+
+/// Returns 0 on success, 1 if the flash fails.
+uint8_t fixLogAppend(FixLog * log, const FixRecord * rec);
+
+/// Programs the records still waiting in the page buffer.
+uint8_t fixLogFlush(FixLog * log);
+
+/// Copies up to max of the oldest records to recs without consuming them. Returns how many.
+uint8_t fixLogPeek(FixLog * log, FixRecord * recs, uint8_t max);
+
+/// Marks the n oldest records consumed, once the gateway has them.
+uint8_t fixLogConsume(FixLog * log, uint8_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* fixLog_h */
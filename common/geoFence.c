@@ -0,0 +1,353 @@
+//
+//  geoFence.c
+//  Geofences: grid index, point in polygon and circle, enter, exit and dwell events
+//
+
+#include "geoFence.h"
+#include "geoPlane.h"
+#include <string.h>
+
+#define DAY_MS              86400000UL
+#define LAT_CM_PER_E7_1E5   111133      // as in geoPlane.c
+
+static uint32_t elapsedMs(uint32_t from, uint32_t to) {
+
+    return (to + DAY_MS - from) % DAY_MS;
+}
+
+void geoFenceEventEncode(const GeoFenceEvent * event, uint8_t * buf) {
+
+    buf[0] = (uint8_t)(event->fenceId >> 8);
+    buf[1] = (uint8_t)(event->fenceId);
+    buf[2] = event->type;
+}
+
+void geoFenceEventDecode(GeoFenceEvent * event, const uint8_t * buf) {
+
+    event->fenceId = (uint16_t)(buf[0] << 8 | buf[1]);
+    event->type    = buf[2];
+}
+
+/***** Shapes *****/
+
+static void fenceBox(const GeoFenceSet * set, uint16_t index, GeoFenceBox * box) {
+
+    const GeoFence * f = &set->fences[index];
+    const GeoPoint * v = &set->vertices[f->first];
+    uint8_t i;
+
+    if (f->shape == GEOFENCE_CIRCLE) {
+        int64_t dLat = (int64_t)f->radiusCm * 100000 / LAT_CM_PER_E7_1E5 + 1;
+        int32_t cosLat = geoCosineQ15(v->latE7 / 100000);
+        int64_t dLon = dLat * 32768 / (cosLat < 1 ? 1 : cosLat) + 1;
+        box->minLatE7 = (int32_t)(v->latE7 - dLat);
+        box->maxLatE7 = (int32_t)(v->latE7 + dLat);
+        box->minLonE7 = (int32_t)(v->lonE7 - dLon);
+        box->maxLonE7 = (int32_t)(v->lonE7 + dLon);
+        return;
+    }
+
+    box->minLatE7 = box->maxLatE7 = v[0].latE7;
+    box->minLonE7 = box->maxLonE7 = v[0].lonE7;
+    for (i = 1; i < f->numVertices; ++i) {
+        if (v[i].latE7 < box->minLatE7) box->minLatE7 = v[i].latE7;
+        if (v[i].latE7 > box->maxLatE7) box->maxLatE7 = v[i].latE7;
+        if (v[i].lonE7 < box->minLonE7) box->minLonE7 = v[i].lonE7;
+        if (v[i].lonE7 > box->maxLonE7) box->maxLonE7 = v[i].lonE7;
+    }
+}
+
+static uint8_t inBox(const GeoFenceBox * box, int32_t latE7, int32_t lonE7) {
+
+    return latE7 >= box->minLatE7 && latE7 <= box->maxLatE7 &&
+           lonE7 >= box->minLonE7 && lonE7 <= box->maxLonE7;
+}
+
+/* Crossing number: count the edges a ray from the point towards the east crosses */
+static uint8_t inPolygon(const GeoPoint * v, uint8_t n, int32_t latE7, int32_t lonE7) {
+
+    uint8_t inside = 0;
+    uint8_t i, j;
+
+    for (i = 0, j = n - 1; i < n; j = i++) {
+
+        if ((v[i].latE7 > latE7) == (v[j].latE7 > latE7))
+            continue;
+
+        /* East of the point if (lon - lon_i) / (lon_j - lon_i) < (lat - lat_i) / (lat_j - lat_i) */
+        int64_t dLat  = (int64_t)v[j].latE7 - v[i].latE7;
+        int64_t cross = ((int64_t)lonE7 - v[i].lonE7) * dLat -
+                        ((int64_t)v[j].lonE7 - v[i].lonE7) * ((int64_t)latE7 - v[i].latE7);
+
+        if (dLat > 0 ? cross < 0 : cross > 0)
+            inside ^= 1;
+    }
+
+    return inside;
+}
+
+static uint8_t inCircle(const GeoPoint * centre, uint32_t radiusCm, int32_t latE7, int32_t lonE7) {
+
+    GeoPlane plane;
+    int64_t east, north, r = radiusCm;
+
+    geoPlaneInit(&plane, centre->latE7, centre->lonE7);
+    geoProject(&plane, latE7, lonE7, &east, &north);
+
+    if (east > r || east < -r || north > r || north < -r)
+        return 0;
+
+    return east * east + north * north <= r * r;
+}
+
+uint8_t geoFenceContains(const GeoFenceSet * set, uint16_t index, int32_t latE7, int32_t lonE7) {
+
+    const GeoFence * f = &set->fences[index];
+
+    if (f->shape == GEOFENCE_CIRCLE)
+        return inCircle(&set->vertices[f->first], f->radiusCm, latE7, lonE7);
+
+    return inPolygon(&set->vertices[f->first], f->numVertices, latE7, lonE7);
+}
+
+/***** Grid index *****/
+
+static void setBounds(const GeoFenceSet * set, GeoFenceBox * bounds, int32_t * cellLatE7, int32_t * cellLonE7) {
+
+    GeoFenceBox box;
+    uint16_t i;
+
+    for (i = 0; i < set->numFences; ++i) {
+        fenceBox(set, i, &box);
+        if (i == 0 || box.minLatE7 < bounds->minLatE7) bounds->minLatE7 = box.minLatE7;
+        if (i == 0 || box.maxLatE7 > bounds->maxLatE7) bounds->maxLatE7 = box.maxLatE7;
+        if (i == 0 || box.minLonE7 < bounds->minLonE7) bounds->minLonE7 = box.minLonE7;
+        if (i == 0 || box.maxLonE7 > bounds->maxLonE7) bounds->maxLonE7 = box.maxLonE7;
+    }
+
+    *cellLatE7 = (int32_t)(((int64_t)bounds->maxLatE7 - bounds->minLatE7) / GEOFENCE_GRID + 1);
+    *cellLonE7 = (int32_t)(((int64_t)bounds->maxLonE7 - bounds->minLonE7) / GEOFENCE_GRID + 1);
+}
+
+/* Row or column of a coordinate, clamped to the grid */
+static uint8_t cellOf(int32_t value, int32_t min, int32_t cell) {
+
+    int64_t k = ((int64_t)value - min) / cell;
+
+    if (k < 0)
+        return 0;
+    if (k >= GEOFENCE_GRID)
+        return GEOFENCE_GRID - 1;
+    return (uint8_t)k;
+}
+
+uint32_t geoFenceIndexSize(const GeoFenceSet * set) {
+
+    GeoFenceBox bounds, box;
+    int32_t cellLat, cellLon;
+    uint32_t size = 0;
+    uint16_t i;
+
+    if (set->numFences == 0)
+        return 0;
+
+    setBounds(set, &bounds, &cellLat, &cellLon);
+
+    for (i = 0; i < set->numFences; ++i) {
+        fenceBox(set, i, &box);
+        size += (uint32_t)(cellOf(box.maxLatE7, bounds.minLatE7, cellLat) -
+                           cellOf(box.minLatE7, bounds.minLatE7, cellLat) + 1) *
+                (uint32_t)(cellOf(box.maxLonE7, bounds.minLonE7, cellLon) -
+                           cellOf(box.minLonE7, bounds.minLonE7, cellLon) + 1);
+    }
+
+    return size;
+}
+
+void geoFenceDefaultConfig(GeoFenceConfig * config) {
+
+    config->confirmFixes = 2;
+    config->dwellS       = 600;
+    config->heartbeatS   = 900;
+}
+
+uint8_t geoFenceInit(GeoFencer * g, const GeoFenceConfig * config, const GeoFenceSet * set,
+                     GeoFenceBox * boxes, uint16_t * entries, uint32_t maxEntries) {
+
+    uint32_t size = geoFenceIndexSize(set);
+    uint16_t i, cell;
+    uint8_t r, c;
+
+    memset(g, 0, sizeof(*g));
+    g->config  = *config;
+    g->set     = set;
+    g->boxes   = boxes;
+    g->entries = entries;
+
+    if (size > maxEntries || size > 0xFFFF)
+        return 1;
+    if (set->numFences == 0)
+        return 0;
+
+    setBounds(set, &g->bounds, &g->cellLatE7, &g->cellLonE7);
+
+    /* Count the fences of each cell, turn the counts into start offsets, then fill the
+     * cells, moving each start along; the starts end up one cell late, shift them back */
+    for (i = 0; i < set->numFences; ++i) {
+        fenceBox(set, i, &boxes[i]);
+        for (r = cellOf(boxes[i].minLatE7, g->bounds.minLatE7, g->cellLatE7);
+             r <= cellOf(boxes[i].maxLatE7, g->bounds.minLatE7, g->cellLatE7); ++r)
+            for (c = cellOf(boxes[i].minLonE7, g->bounds.minLonE7, g->cellLonE7);
+                 c <= cellOf(boxes[i].maxLonE7, g->bounds.minLonE7, g->cellLonE7); ++c)
+                ++g->cellStart[r * GEOFENCE_GRID + c + 1];
+    }
+
+    for (cell = 1; cell <= GEOFENCE_GRID * GEOFENCE_GRID; ++cell)
+        g->cellStart[cell] += g->cellStart[cell - 1];
+
+    for (i = 0; i < set->numFences; ++i)
+        for (r = cellOf(boxes[i].minLatE7, g->bounds.minLatE7, g->cellLatE7);
+             r <= cellOf(boxes[i].maxLatE7, g->bounds.minLatE7, g->cellLatE7); ++r)
+            for (c = cellOf(boxes[i].minLonE7, g->bounds.minLonE7, g->cellLonE7);
+                 c <= cellOf(boxes[i].maxLonE7, g->bounds.minLonE7, g->cellLonE7); ++c)
+                entries[g->cellStart[r * GEOFENCE_GRID + c]++] = i;
+
+    for (cell = GEOFENCE_GRID * GEOFENCE_GRID; cell > 0; --cell)
+        g->cellStart[cell] = g->cellStart[cell - 1];
+    g->cellStart[0] = 0;
+
+    return 0;
+}
+
+static uint8_t isMember(const GeoFencer * g, uint16_t fence) {
+
+    uint8_t i;
+
+    for (i = 0; i < g->numMembers; ++i)
+        if (g->member[i].fence == fence)
+            return 1;
+
+    return 0;
+}
+
+/* Fences of the point's cell that contain it, members left out if skipMembers */
+static uint8_t scan(GeoFencer * g, int32_t latE7, int32_t lonE7, uint16_t * fences, uint8_t max,
+                    uint8_t skipMembers) {
+
+    uint16_t k, cell;
+    uint8_t n = 0;
+
+    if (g->set->numFences == 0 || !inBox(&g->bounds, latE7, lonE7))
+        return 0;
+
+    cell = cellOf(latE7, g->bounds.minLatE7, g->cellLatE7) * GEOFENCE_GRID +
+           cellOf(lonE7, g->bounds.minLonE7, g->cellLonE7);
+
+    for (k = g->cellStart[cell]; k < g->cellStart[cell + 1] && n < max; ++k) {
+
+        uint16_t i = g->entries[k];
+
+        ++g->boxTests;
+        if (!inBox(&g->boxes[i], latE7, lonE7) || (skipMembers && isMember(g, i)))
+            continue;
+
+        ++g->shapeTests;
+        if (geoFenceContains(g->set, i, latE7, lonE7))
+            fences[n++] = i;
+    }
+
+    return n;
+}
+
+uint8_t geoFenceLookup(GeoFencer * g, int32_t latE7, int32_t lonE7, uint16_t * fences, uint8_t max) {
+
+    return scan(g, latE7, lonE7, fences, max, 0);
+}
+
+/***** Events *****/
+
+static void addEvent(const GeoFencer * g, GeoFenceEvent * events, uint8_t * n, uint16_t fence, uint8_t type) {
+
+    events[*n].fenceId = fence == GEOFENCE_NO_FENCE ? GEOFENCE_NO_FENCE : g->set->fences[fence].id;
+    events[*n].type    = type;
+    ++*n;
+}
+
+uint8_t geoFenceCheck(GeoFencer * g, const FixRecord * fix, GeoFenceEvent * events) {
+
+    uint8_t confirm = g->config.confirmFixes ? g->config.confirmFixes : 1;
+    uint16_t entered[GEOFENCE_MAX_INSIDE];
+    uint8_t n = 0, numEntered, i;
+
+    ++g->checks;
+
+    /* Fences followed already: tested directly, they may not be the first ones of the cell */
+    for (i = 0; i < g->numMembers; ) {
+
+        GeoFenceMember * m = &g->member[i];
+        uint8_t in = geoFenceContains(g->set, m->fence, fix->latE7, fix->lonE7);
+
+        ++g->shapeTests;
+
+        if (m->inside) {
+            if (in) {
+                m->streak = 0;
+                if (g->config.dwellS && !m->dwelt &&
+                    elapsedMs(m->sinceMs, fix->timeMs) >= (uint32_t)g->config.dwellS * 1000) {
+                    m->dwelt = 1;
+                    addEvent(g, events, &n, m->fence, GEOFENCE_DWELL);
+                }
+            }
+            else if (++m->streak >= confirm) {
+                addEvent(g, events, &n, m->fence, GEOFENCE_EXIT);
+                *m = g->member[--g->numMembers];
+                continue;
+            }
+        }
+        else {
+            if (!in) {
+                *m = g->member[--g->numMembers];
+                continue;
+            }
+            if (++m->streak >= confirm) {
+                m->inside = 1;
+                m->streak = 0;
+                m->sinceMs = fix->timeMs;
+                addEvent(g, events, &n, m->fence, GEOFENCE_ENTER);
+            }
+        }
+        ++i;
+    }
+
+    /* Fences the fix just got into */
+    numEntered = scan(g, fix->latE7, fix->lonE7, entered, GEOFENCE_MAX_INSIDE - g->numMembers, 1);
+
+    for (i = 0; i < numEntered; ++i) {
+
+        GeoFenceMember * m = &g->member[g->numMembers++];
+
+        m->fence   = entered[i];
+        m->inside  = 0;
+        m->dwelt   = 0;
+        m->streak  = 1;
+        m->sinceMs = fix->timeMs;
+
+        if (confirm <= 1) {
+            m->inside = 1;
+            m->streak = 0;
+            addEvent(g, events, &n, m->fence, GEOFENCE_ENTER);
+        }
+    }
+
+    if (n == 0 && g->config.heartbeatS &&
+        (!g->reported || elapsedMs(g->lastReportMs, fix->timeMs) >= (uint32_t)g->config.heartbeatS * 1000))
+        addEvent(g, events, &n, GEOFENCE_NO_FENCE, GEOFENCE_HEARTBEAT);
+
+    if (n) {
+        g->reported = 1;
+        g->lastReportMs = fix->timeMs;
+        g->events += n;
+    }
+
+    return n;
+}
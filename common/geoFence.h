@@ -0,0 +1,142 @@
+//
+//  geoFence.h
+//  Geofences on the tracker: which polygons and circles a fix is in, and enter, exit and
+//  dwell events with a slow heartbeat in between
+//
+//  The fence set is constant data, so on the tracker it stays in flash. A polygon is a run
+//  of vertices in GeoFenceSet.vertices, a circle a centre there and a radius. Polygons are
+//  tested in degrees * 1e7 with 64 bit cross products (crossing number); they must not span
+//  the antimeridian or more than 90 degrees. Circles are tested in cm on a plane around
+//  their centre.
+//
+//  geoFenceInit() builds an index in RAM: a bounding box per fence and a
+//  GEOFENCE_GRID x GEOFENCE_GRID grid over the whole set, each cell listing the fences whose
+//  box overlaps it. A fix only tests the fences of its own cell, box first.
+//
+//  A fence counts as entered or left once confirmFixes fixes in a row agree, so a fix
+//  wandering across an edge does not flap. At most GEOFENCE_MAX_INSIDE fences are followed
+//  at a time, further overlapping ones are ignored until a slot frees up.
+//
+
+#ifndef geoFence_h
+#define geoFence_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "fixLog.h"
+
+#define GEOFENCE_GRID           16
+#define GEOFENCE_MAX_INSIDE     8
+#define GEOFENCE_MAX_EVENTS     (2 * GEOFENCE_MAX_INSIDE)   // per fix: exits, then enters
+#define GEOFENCE_NO_FENCE       0xFFFF                      // fenceId of heartbeats
+#define GEOFENCE_EVENT_WIRE_LENGTH  3                       // fence id big endian, type
+
+typedef enum {
+    GEOFENCE_CIRCLE = 0,
+    GEOFENCE_POLYGON
+} GeoFenceShape;
+
+typedef struct {
+    int32_t latE7;
+    int32_t lonE7;
+} GeoPoint;
+
+typedef struct {
+    uint16_t id;            // reported in events
+    uint8_t  shape;         // GeoFenceShape
+    uint8_t  numVertices;   // polygon, at least 3
+    uint32_t first;         // polygon: first vertex, circle: centre, in GeoFenceSet.vertices
+    uint32_t radiusCm;      // circle
+} GeoFence;
+
+typedef struct {
+    const GeoFence * fences;
+    uint16_t         numFences;
+    const GeoPoint * vertices;
+} GeoFenceSet;
+
+typedef struct {
+    uint8_t  confirmFixes;  // fixes in a row that make an enter or exit
+    uint16_t dwellS;        // inside this long raises GEOFENCE_DWELL, 0 never
+    uint16_t heartbeatS;    // without events, report at least this often, 0 never
+} GeoFenceConfig;
+
+typedef enum {
+    GEOFENCE_ENTER = 0,
+    GEOFENCE_EXIT,
+    GEOFENCE_DWELL,
+    GEOFENCE_HEARTBEAT
+} GeoFenceEventType;
+
+typedef struct {
+    uint16_t fenceId;       // GEOFENCE_NO_FENCE for a heartbeat
+    uint8_t  type;          // GeoFenceEventType
+} GeoFenceEvent;
+
+typedef struct {
+    int32_t minLatE7;
+    int32_t minLonE7;
+    int32_t maxLatE7;
+    int32_t maxLonE7;
+} GeoFenceBox;
+
+typedef struct {
+    uint16_t fence;         // index in the set
+    uint8_t  inside;        // else about to enter
+    uint8_t  dwelt;
+    uint8_t  streak;        // fixes in a row against the state
+    uint32_t sinceMs;       // entered
+} GeoFenceMember;
+
+typedef struct {
+    GeoFenceConfig      config;
+    const GeoFenceSet * set;
+    GeoFenceBox *       boxes;      // numFences, from the caller
+    uint16_t *          entries;    // fence indices by cell, from the caller
+    uint16_t            cellStart[GEOFENCE_GRID * GEOFENCE_GRID + 1];
+    GeoFenceBox         bounds;     // of all boxes
+    int32_t             cellLatE7;
+    int32_t             cellLonE7;
+    GeoFenceMember      member[GEOFENCE_MAX_INSIDE];
+    uint8_t             numMembers;
+    uint8_t             reported;   // lastReportMs is valid
+    uint32_t            lastReportMs;
+    /* Statistics */
+    uint32_t            checks;
+    uint32_t            boxTests;
+    uint32_t            shapeTests;
+    uint32_t            events;
+} GeoFencer;
+
+void geoFenceEventEncode(const GeoFenceEvent * event, uint8_t * buf);
+void geoFenceEventDecode(GeoFenceEvent * event, const uint8_t * buf);
+
+/// Enter and exit after 2 fixes, dwell after 10 minutes, a heartbeat every 15 minutes.
+void geoFenceDefaultConfig(GeoFenceConfig * config);
+
+/// Grid entries the index of set needs.
+uint32_t geoFenceIndexSize(const GeoFenceSet * set);
+
+/// boxes holds set->numFences boxes, entries maxEntries fence indices. Returns 0 on
+/// success, 1 if entries is too small (see geoFenceIndexSize()).
+uint8_t geoFenceInit(GeoFencer * g, const GeoFenceConfig * config, const GeoFenceSet * set,
+                     GeoFenceBox * boxes, uint16_t * entries, uint32_t maxEntries);
+
+/// Is the point in fence number index of the set? No prefiltering.
+uint8_t geoFenceContains(const GeoFenceSet * set, uint16_t index, int32_t latE7, int32_t lonE7);
+
+/// Indices of the fences the point is in, up to max of them. Returns how many.
+uint8_t geoFenceLookup(GeoFencer * g, int32_t latE7, int32_t lonE7, uint16_t * fences, uint8_t max);
+
+/// Takes the next fix. Returns the number of events it raised (at most GEOFENCE_MAX_EVENTS),
+/// then in events. A fix with nothing to report returns 0.
+uint8_t geoFenceCheck(GeoFencer * g, const FixRecord * fix, GeoFenceEvent * events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* geoFence_h */
@@ -0,0 +1,87 @@
+//
+//  geoPlane.c
+//  Flat east/north plane around an origin, in centimetres, and a table sine
+//
+
+#include "geoPlane.h"
+
+/* sin() at whole degrees 0..90, Q15 */
+static const int16_t sineTable[91] = {
+        0,   572,  1144,  1715,  2286,  2856,  3425,  3993,  4560,  5126,  5690,  6252,
+     6813,  7371,  7927,  8481,  9032,  9580, 10126, 10668, 11207, 11743, 12275, 12803,
+    13328, 13848, 14364, 14876, 15383, 15886, 16383, 16876, 17364, 17846, 18323, 18794,
+    19260, 19720, 20173, 20621, 21062, 21497, 21925, 22347, 22762, 23170, 23571, 23964,
+    24351, 24730, 25101, 25465, 25821, 26169, 26509, 26841, 27165, 27481, 27788, 28087,
+    28377, 28659, 28932, 29196, 29451, 29697, 29934, 30162, 30381, 30591, 30791, 30982,
+    31163, 31335, 31498, 31650, 31794, 31927, 32051, 32165, 32269, 32364, 32448, 32523,
+    32587, 32642, 32687, 32722, 32747, 32762, 32767
+};
+
+/* sin() of an angle in 0.01 degrees, Q15, interpolated between whole degrees */
+int32_t geoSineQ15(int32_t cdeg) {
+
+    int32_t sign = 1;
+
+    cdeg %= 36000;
+    if (cdeg < 0)
+        cdeg += 36000;
+    if (cdeg >= 18000) {
+        cdeg -= 18000;
+        sign = -1;
+    }
+    if (cdeg > 9000)
+        cdeg = 18000 - cdeg;
+
+    int32_t deg = cdeg / 100;
+    int32_t value = sineTable[deg];
+    if (deg < 90)
+        value += (sineTable[deg + 1] - value) * (cdeg % 100) / 100;
+
+    return sign * value;
+}
+
+int32_t geoCosineQ15(int32_t cdeg) {
+
+    return geoSineQ15(cdeg + 9000);
+}
+
+/***** Projection *****/
+
+/* 1e-7 degrees of latitude are 1.11133 cm, of longitude 1.11320 cm * cos(lat) */
+#define LAT_CM_PER_E7_1E5   111133
+#define LON_CM_PER_E7_1E5   111320
+
+void geoPlaneInit(GeoPlane * plane, int32_t latE7, int32_t lonE7) {
+
+    plane->originLatE7 = latE7;
+    plane->originLonE7 = lonE7;
+    plane->cosLatQ15 = geoCosineQ15(latE7 / 100000);
+    if (plane->cosLatQ15 < 1)
+        plane->cosLatQ15 = 1;
+}
+
+void geoProject(const GeoPlane * plane, int32_t latE7, int32_t lonE7, int64_t * east, int64_t * north) {
+
+    int64_t dLon = (int64_t)lonE7 - plane->originLonE7;
+
+    if (dLon > 1800000000)
+        dLon -= 3600000000LL;
+    else if (dLon < -1800000000)
+        dLon += 3600000000LL;
+
+    *north = ((int64_t)latE7 - plane->originLatE7) * LAT_CM_PER_E7_1E5 / 100000;
+    *east  = dLon * LON_CM_PER_E7_1E5 / 100000 * plane->cosLatQ15 / 32768;
+}
+
+void geoUnproject(const GeoPlane * plane, int64_t east, int64_t north, int32_t * latE7, int32_t * lonE7) {
+
+    int64_t lon = plane->originLonE7 + east * 100000 * 32768 / ((int64_t)LON_CM_PER_E7_1E5 * plane->cosLatQ15);
+
+    if (lon > 1800000000)
+        lon -= 3600000000LL;
+    else if (lon < -1800000000)
+        lon += 3600000000LL;
+
+    *latE7 = plane->originLatE7 + (int32_t)(north * 100000 / LAT_CM_PER_E7_1E5);
+    *lonE7 = (int32_t)lon;
+}
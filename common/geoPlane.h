@@ -0,0 +1,40 @@
+//
+//  geoPlane.h
+//  Flat east/north plane around an origin, in centimetres, and a table sine
+//
+//  Good to a few centimetres within the 100 km or so a tracker moves around one origin;
+//  users move the origin along beyond that.
+//
+
+#ifndef geoPlane_h
+#define geoPlane_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+    int32_t originLatE7;
+    int32_t originLonE7;
+    int32_t cosLatQ15;      // east scale at the origin
+} GeoPlane;
+
+/// sin() and cos() of an angle in 0.01 degrees, Q15.
+int32_t geoSineQ15(int32_t cdeg);
+int32_t geoCosineQ15(int32_t cdeg);
+
+void geoPlaneInit(GeoPlane * plane, int32_t latE7, int32_t lonE7);
+
+/// Degrees * 1e7 to cm east and north of the origin.
+void geoProject(const GeoPlane * plane, int32_t latE7, int32_t lonE7, int64_t * east, int64_t * north);
+
+/// And back.
+void geoUnproject(const GeoPlane * plane, int64_t east, int64_t north, int32_t * latE7, int32_t * lonE7);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* geoPlane_h */
@@ -0,0 +1,171 @@
+//
+//  gnssBaud.c
+//  Boot time baud rate negotiation with the GNSS receiver
+//
+
+#include "gnssBaud.h"
+#include <string.h>
+
+#define READ_CHUNK  32
+
+enum {
+    NMEA_WAIT_START,
+    NMEA_BODY,
+    NMEA_CHECK_1,
+    NMEA_CHECK_2
+};
+
+static const uint32_t baudRates[GNSS_BAUD_RATES] = {
+    4800, 9600, 19200, 38400, 57600, 115200, 230400
+};
+
+void gnssBaudDefaultConfig(GnssBaudConfig * config) {
+
+    config->defaultBaud = 4800;
+    config->targetBaud  = 38400;
+    config->listenMs    = 1500;
+    config->minFrames   = 2;
+}
+
+static int8_t hexValue(uint8_t c) {
+
+    if (c >= '0' && c <= '9')
+        return (int8_t)(c - '0');
+    if (c >= 'A' && c <= 'F')
+        return (int8_t)(c - 'A' + 10);
+    if (c >= 'a' && c <= 'f')
+        return (int8_t)(c - 'a' + 10);
+    return -1;
+}
+
+/* Counts NMEA sentences with a good checksum; nothing is kept */
+static void nmeaCount(GnssBaud * b, uint8_t byte) {
+
+    switch (b->nmeaState) {
+
+        case NMEA_BODY:
+            if (byte == '*') {
+                b->nmeaState = NMEA_CHECK_1;
+                return;
+            }
+            if (byte >= ' ' && byte < 0x7F && byte != '$') {
+                b->nmeaChecksum ^= byte;
+                return;
+            }
+            break;
+
+        case NMEA_CHECK_1:
+            if (hexValue(byte) == b->nmeaChecksum >> 4) {
+                b->nmeaState = NMEA_CHECK_2;
+                return;
+            }
+            break;
+
+        case NMEA_CHECK_2:
+            if (hexValue(byte) == (b->nmeaChecksum & 0x0F) && b->nmeaFrames < 0xFF)
+                ++b->nmeaFrames;
+            break;
+    }
+
+    b->nmeaState = NMEA_WAIT_START;
+    if (byte == '$') {
+        b->nmeaChecksum = 0;
+        b->nmeaState = NMEA_BODY;
+    }
+}
+
+/* Listens for listenMs or until minFrames of protocols arrive. Returns 1 if they did. */
+static uint8_t listen(GnssBaud * b, const GnssUart * uart, uint8_t protocols) {
+
+    uint8_t buf[READ_CHUNK];
+    uint32_t start = uart->nowMs(uart->ctx);
+    uint32_t elapsed;
+    uint16_t n, i;
+
+    ubxFramerInit(&b->ubx, b->ubxBuf, sizeof(b->ubxBuf));
+    b->nmeaState = NMEA_WAIT_START;
+    b->nmeaFrames = 0;
+    b->ubxFrames = 0;
+
+    while ((elapsed = uart->nowMs(uart->ctx) - start) < b->config.listenMs) {
+        n = uart->read(uart->ctx, buf, sizeof(buf), (uint16_t)(b->config.listenMs - elapsed));
+        for (i = 0; i < n; ++i) {
+            UbxFrame frame;
+            nmeaCount(b, buf[i]);
+            if (ubxFramerPush(&b->ubx, buf[i], &frame) && b->ubxFrames < 0xFF)
+                ++b->ubxFrames;
+        }
+        if (((protocols & GNSS_PROTOCOL_NMEA) && b->nmeaFrames >= b->config.minFrames) ||
+            ((protocols & GNSS_PROTOCOL_UBX) && b->ubxFrames >= b->config.minFrames))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Target rate, factory rate, then the others. Returns the rate answered at, or 0. */
+static uint32_t scan(GnssBaud * b, const GnssUart * uart) {
+
+    uint32_t order[GNSS_BAUD_RATES + 2];
+    uint8_t n = 0, i, j;
+
+    order[n++] = b->config.targetBaud;
+    if (b->config.defaultBaud != b->config.targetBaud)
+        order[n++] = b->config.defaultBaud;
+    for (i = 0; i < GNSS_BAUD_RATES; ++i) {
+        for (j = 0; j < n && order[j] != baudRates[i]; ++j)
+            ;
+        if (j == n)
+            order[n++] = baudRates[i];
+    }
+
+    for (i = 0; i < n; ++i) {
+        uart->setBaud(uart->ctx, order[i]);
+        ++b->tried;
+        if (listen(b, uart, GNSS_PROTOCOL_NMEA | GNSS_PROTOCOL_UBX))
+            return order[i];
+    }
+
+    return 0;
+}
+
+GnssBaudOutcome gnssBaudNegotiate(GnssBaud * b, const GnssBaudConfig * config, const GnssUart * uart,
+                                  const GnssInput * in) {
+
+    uint8_t command[GNSS_COMMAND_MAX];
+    uint32_t start = uart->nowMs(uart->ctx);
+    uint8_t length;
+    GnssBaudOutcome outcome;
+
+    memset(b, 0, sizeof(*b));
+    b->config = *config;
+
+    b->baud = scan(b, uart);
+    if (b->baud == 0) {
+        uart->setBaud(uart->ctx, config->defaultBaud);
+        b->elapsedMs = uart->nowMs(uart->ctx) - start;
+        return GNSS_BAUD_SILENT;
+    }
+
+    /* The rate change is the last command, whatever follows it would be lost */
+    while ((length = gnssInputCommand(in, b->commands, config->targetBaud, command)) > 0) {
+        uart->write(uart->ctx, command, length);
+        ++b->commands;
+    }
+
+    uart->setBaud(uart->ctx, config->targetBaud);
+    if (listen(b, uart, in->backend->protocol)) {
+        b->baud = config->targetBaud;
+        outcome = GNSS_BAUD_CONFIGURED;
+    }
+    else {
+        /* It did not follow: back to wherever it answers */
+        b->baud = scan(b, uart);
+        outcome = b->baud ? GNSS_BAUD_UNCHANGED : GNSS_BAUD_SILENT;
+        if (b->baud == 0)
+            uart->setBaud(uart->ctx, config->defaultBaud);
+    }
+
+    b->elapsedMs = uart->nowMs(uart->ctx) - start;
+    return outcome;
+}
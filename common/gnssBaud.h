@@ -0,0 +1,81 @@
+//
+//  gnssBaud.h
+//  Boot time configuration of the GNSS receiver: finds the baud rate it talks at, sends it
+//  the startup commands of the input layer's backend and moves it to a faster rate
+//
+//  A baud rate is taken as the receiver's once minFrames NMEA sentences or UBX frames with
+//  good checksums arrive within listenMs; at a wrong rate the UART only sees framing
+//  garbage. The target rate is tried first (the receiver kept its configuration over a
+//  reset of ours), then the factory rate, then the rest of the usual ones. At the rate
+//  found the commands go out, the rate change last, and the receiver has to answer at the
+//  target rate in the backend's protocol. If it does not (not a u-blox, or it rejected the
+//  commands), the rates are scanned again and the receiver is left at whichever it answers.
+//
+//  Blocking; the UART is reached through GnssUart so that the host tests can put a
+//  simulated receiver behind it.
+//
+
+#ifndef gnssBaud_h
+#define gnssBaud_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "gnssInput.h"
+#include "ubxProtocol.h"
+
+#define GNSS_BAUD_RATES     7       // 4800 to 230400
+
+typedef struct {
+    uint32_t (*nowMs)(void * ctx);
+    void     (*setBaud)(void * ctx, uint32_t baud);
+    void     (*write)(void * ctx, const uint8_t * data, uint16_t length);
+    /// Returns once max bytes are in buf or timeoutMs has passed, with the number read.
+    uint16_t (*read)(void * ctx, uint8_t * buf, uint16_t max, uint16_t timeoutMs);
+    void *   ctx;
+} GnssUart;
+
+typedef struct {
+    uint32_t defaultBaud;       // the receiver's factory rate
+    uint32_t targetBaud;
+    uint16_t listenMs;          // at each rate, longer than the gap between two epochs
+    uint8_t  minFrames;         // good frames that prove a rate
+} GnssBaudConfig;
+
+typedef enum {
+    GNSS_BAUD_CONFIGURED = 0,   // answering at targetBaud in the backend's protocol
+    GNSS_BAUD_UNCHANGED,        // answering at baud, did not take the commands
+    GNSS_BAUD_SILENT            // never answered, the UART is left at defaultBaud
+} GnssBaudOutcome;
+
+typedef struct {
+    GnssBaudConfig config;
+    /* Frame counting while listening */
+    UbxFramer ubx;
+    uint8_t   ubxBuf[4 + UBX_NAV_PVT_LENGTH];
+    uint8_t   nmeaState;
+    uint8_t   nmeaChecksum;
+    uint8_t   nmeaFrames;
+    uint8_t   ubxFrames;
+    /* Result */
+    uint32_t  baud;             // the receiver answered at, 0 if never
+    uint8_t   tried;            // rates listened at
+    uint8_t   commands;         // startup commands sent
+    uint32_t  elapsedMs;
+} GnssBaud;
+
+/// 4800 baud factory rate, 38400 target, listen 1500 ms for 2 frames.
+void gnssBaudDefaultConfig(GnssBaudConfig * config);
+
+/// Configures the receiver for in's backend; the UART is left at the rate in b->baud (or
+/// defaultBaud if silent).
+GnssBaudOutcome gnssBaudNegotiate(GnssBaud * b, const GnssBaudConfig * config, const GnssUart * uart,
+                                  const GnssInput * in);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* gnssBaud_h */
@@ -0,0 +1,340 @@
+//
+//  gnssInput.c
+//  GNSS input layer with NMEA and UBX backends
+//
+
+#include "gnssInput.h"
+#include <string.h>
+
+enum {
+    NMEA_WAIT_START,
+    NMEA_BODY,
+    NMEA_CHECK_1,
+    NMEA_CHECK_2
+};
+
+void gnssInputInit(GnssInput * in, const GnssBackend * backend) {
+
+    memset(in, 0, sizeof(*in));
+    in->backend = backend;
+    in->pdop = GNSS_NO_DOP;
+    in->vdop = GNSS_NO_DOP;
+    backend->reset(in);
+}
+
+uint8_t gnssInputPush(GnssInput * in, uint8_t byte, uint32_t nowMs, EpochFix * fixes) {
+
+    uint8_t n;
+
+    ++in->bytes;
+    n = in->backend->push(in, byte, nowMs, fixes);
+    in->fixes += n;
+
+    return n;
+}
+
+uint8_t gnssInputCommand(const GnssInput * in, uint8_t step, uint32_t baud, uint8_t * out) {
+
+    return in->backend->command(step, baud, out);
+}
+
+/* DOP in hundredths, as GGA and GSA give it */
+static uint16_t nmeaDop(double dop) {
+
+    return dop < 600 ? (uint16_t)(dop * 100 + 0.5) : 60000;
+}
+
+/* NMEA ddmm.mmmm to degrees * 1e7 */
+static int32_t nmeaDegreesE7(double value, char direction) {
+
+    double degrees = (int32_t)(value / 100);
+    degrees += (value - degrees * 100) / 60;
+
+    int32_t e7 = (int32_t)(degrees * 1e7 + 0.5);
+    return (direction == 'S' || direction == 'W') ? -e7 : e7;
+}
+
+static int8_t hexValue(uint8_t c) {
+
+    if (c >= '0' && c <= '9')
+        return (int8_t)(c - '0');
+    if (c >= 'A' && c <= 'F')
+        return (int8_t)(c - 'A' + 10);
+    if (c >= 'a' && c <= 'f')
+        return (int8_t)(c - 'a' + 10);
+    return -1;
+}
+
+static void nmeaReset(GnssInput * in) {
+
+    nmeaDataInit(&in->u.nmea.data);
+
+    FixEpochConfig config;
+    fixEpochDefaultConfig(&config);
+    fixEpochInit(&in->u.nmea.epoch, &config);
+    in->u.nmea.state = NMEA_WAIT_START;
+}
+
+/* What the GGA or RMC in data contributes to its epoch */
+static void nmeaPart(const GPSData * d, EpochFix * part) {
+
+    uint32_t hhmmss = (uint32_t)d->time;
+    uint8_t hasPosition = (d->latDirection == 'N' || d->latDirection == 'S') &&
+                          (d->longDirection == 'E' || d->longDirection == 'W');
+
+    memset(part, 0, sizeof(*part));
+    part->fix.timeMs = ((hhmmss / 10000) * 3600 + (hhmmss / 100 % 100) * 60 + hhmmss % 100) * 1000 +
+                       (uint32_t)((d->time - hhmmss) * 1000 + 0.5);
+    if (hasPosition) {
+        part->fix.latE7 = nmeaDegreesE7(d->latitude, d->latDirection);
+        part->fix.lonE7 = nmeaDegreesE7(d->longitude, d->longDirection);
+        part->have = FIX_EPOCH_POSITION;
+    }
+
+    if (d->nmeaData.msgType == NMEA_GGA) {
+        part->sources    = FIX_EPOCH_GGA;
+        part->quality    = d->fixQuality;
+        part->satellites = d->numSatellites;
+        part->hdop       = nmeaDop(d->hdop);
+        if (hasPosition) {
+            part->fix.altM = (int16_t)d->altitude;
+            part->have |= FIX_EPOCH_ALTITUDE;
+        }
+    }
+    else {
+        part->sources = FIX_EPOCH_RMC;
+        if (d->status == 'A') {
+            part->quality    = 1;
+            part->speedCmS   = d->groundSpeed < 1000 ? (uint16_t)(d->groundSpeed * 51.4444 + 0.5) : 0xFFFF;
+            part->courseCdeg = (uint16_t)(d->trueCourse * 100 + 0.5);
+            part->have |= FIX_EPOCH_MOTION;
+        }
+    }
+}
+
+/* A sentence with a good checksum, framed in data.nmeaData.sentence */
+static uint8_t nmeaSentence(GnssInput * in, uint32_t nowMs, EpochFix * fixes) {
+
+    GPSData * d = &in->u.nmea.data;
+    EpochFix part;
+
+    d->nmeaData.msgType = nmeaClassify(d->nmeaData.sentence, d->nmeaData.talker);
+    switch (d->nmeaData.msgType) {
+
+        case NMEA_GSA:
+            nmeaParseGSA(d);
+            in->fixMode = d->fixMode;
+            in->pdop    = nmeaDop(d->pdop);
+            in->vdop    = nmeaDop(d->vdop);
+            return fixEpochPoll(&in->u.nmea.epoch, nowMs, fixes);
+
+        case NMEA_GGA:
+        case NMEA_RMC:
+            /* Empty fields keep what the last sentence left: clear those that tell of a fix */
+            d->time = -1;
+            d->latDirection = d->longDirection = ' ';
+            d->status = ' ';
+            d->fixQuality = 0;
+            d->numSatellites = 0;
+            d->hdop = 0;
+            if (d->nmeaData.msgType == NMEA_GGA)
+                nmeaParseGGA(d);
+            else
+                nmeaParseRMC(d);
+            if (d->time < 0)
+                return fixEpochPoll(&in->u.nmea.epoch, nowMs, fixes);
+            nmeaPart(d, &part);
+            return fixEpochPush(&in->u.nmea.epoch, &part, nowMs, fixes);
+
+        default:
+            /* Not decoded: GSV, VTG, GLL, ZDA and proprietary sentences */
+            return fixEpochPoll(&in->u.nmea.epoch, nowMs, fixes);
+    }
+}
+
+static uint8_t nmeaPush(GnssInput * in, uint8_t byte, uint32_t nowMs, EpochFix * fixes) {
+
+    char * sentence = in->u.nmea.data.nmeaData.sentence;
+
+    switch (in->u.nmea.state) {
+
+        case NMEA_WAIT_START:
+            break;
+
+        case NMEA_BODY:
+            if (byte == '*') {
+                sentence[in->u.nmea.fill] = '\0';
+                in->u.nmea.state = NMEA_CHECK_1;
+                return 0;
+            }
+            if (byte >= ' ' && byte != '$' && in->u.nmea.fill < SENTENCE_LENGTH - 1) {
+                sentence[in->u.nmea.fill++] = (char)byte;
+                in->u.nmea.checksum ^= byte;
+                return 0;
+            }
+            /* Cut short, or too long */
+            ++in->badFrames;
+            in->u.nmea.state = NMEA_WAIT_START;
+            break;
+
+        case NMEA_CHECK_1:
+            if (hexValue(byte) == in->u.nmea.checksum >> 4) {
+                in->u.nmea.state = NMEA_CHECK_2;
+                return 0;
+            }
+            ++in->badFrames;
+            in->u.nmea.state = NMEA_WAIT_START;
+            break;
+
+        case NMEA_CHECK_2:
+            in->u.nmea.state = NMEA_WAIT_START;
+            if (hexValue(byte) == (in->u.nmea.checksum & 0x0F)) {
+                ++in->frames;
+                return nmeaSentence(in, nowMs, fixes);
+            }
+            ++in->badFrames;
+            break;
+    }
+
+    /* Waiting for a sentence, or for the next one after an error */
+    if (byte == '$') {
+        sentence[0] = '$';
+        in->u.nmea.fill = 1;
+        in->u.nmea.checksum = 0;
+        in->u.nmea.state = NMEA_BODY;
+    }
+    return 0;
+}
+
+/* "$<body>*hh\r\n" into out. Returns its length. */
+static uint8_t nmeaCommand(const char * body, uint8_t * out) {
+
+    static const char hex[] = "0123456789ABCDEF";
+    uint8_t checksum = 0;
+    uint8_t n = 0;
+
+    out[n++] = '$';
+    while (*body) {
+        checksum ^= (uint8_t)*body;
+        out[n++] = (uint8_t)*body++;
+    }
+    out[n++] = '*';
+    out[n++] = (uint8_t)hex[checksum >> 4];
+    out[n++] = (uint8_t)hex[checksum & 0x0F];
+    out[n++] = '\r';
+    out[n++] = '\n';
+
+    return n;
+}
+
+/* u-blox proprietary PUBX,40 (output rate of a sentence on each port) and PUBX,41 (port
+ * settings). GSA stays, the quality gate wants it. */
+static uint8_t nmeaStartupCommand(uint8_t step, uint32_t baud, uint8_t * out) {
+
+    static const char * const off[] = { "GSV", "GLL", "VTG" };
+    char body[GNSS_COMMAND_MAX];
+
+    if (step < sizeof(off) / sizeof(off[0])) {
+        /* Rates on DDC, UART1, UART2, USB, SPI */
+        strcpy(body, "PUBX,40,");
+        strcat(body, off[step]);
+        strcat(body, ",0,0,0,0,0,0");
+        return nmeaCommand(body, out);
+    }
+    if (step == sizeof(off) / sizeof(off[0])) {
+        /* UART1 in UBX and NMEA, out NMEA, no autobauding */
+        char digits[11];
+        uint8_t n = 0, i;
+        do {
+            digits[n++] = (char)('0' + baud % 10);
+            baud /= 10;
+        } while (baud > 0);
+
+        strcpy(body, "PUBX,41,1,0003,0002,");
+        i = (uint8_t)strlen(body);
+        while (n > 0)
+            body[i++] = digits[--n];
+        strcpy(body + i, ",0");
+        return nmeaCommand(body, out);
+    }
+
+    return 0;
+}
+
+static void ubxReset(GnssInput * in) {
+
+    ubxFramerInit(&in->u.ubx.framer, in->u.ubx.buf, sizeof(in->u.ubx.buf));
+    in->u.ubx.haveDop = 0;
+}
+
+static uint8_t ubxPush(GnssInput * in, uint8_t byte, uint32_t nowMs, EpochFix * fixes) {
+
+    UbxFramer * f = &in->u.ubx.framer;
+    uint32_t bad = f->badChecksums + f->oversize;
+    UbxFrame frame;
+    uint8_t complete = ubxFramerPush(f, byte, &frame);
+
+    (void)nowMs;
+    in->badFrames += f->badChecksums + f->oversize - bad;
+    if (!complete)
+        return 0;
+    ++in->frames;
+
+    if (frame.msgClass == UBX_ACK) {
+        if (frame.id == UBX_ACK_ACK)
+            ++in->acks;
+        else if (frame.id == UBX_ACK_NAK)
+            ++in->naks;
+        return 0;
+    }
+    if (frame.msgClass != UBX_NAV)
+        return 0;
+
+    if (frame.id == UBX_NAV_DOP) {
+        in->u.ubx.haveDop = ubxDecodeNavDop(&frame, &in->u.ubx.dop) == 0;
+        return 0;
+    }
+    if (frame.id != UBX_NAV_PVT || ubxDecodeNavPvt(&frame, &fixes[0], &in->fixMode, &in->pdop))
+        return 0;
+
+    /* The receiver sends NAV-DOP ahead of the NAV-PVT of its epoch */
+    if (in->u.ubx.haveDop && in->u.ubx.dop.iTow == ubxNavTow(&frame)) {
+        fixes[0].hdop = in->u.ubx.dop.hdop;
+        in->pdop = in->u.ubx.dop.pdop;
+        in->vdop = in->u.ubx.dop.vdop;
+    }
+    else {
+        fixes[0].hdop = GNSS_NO_DOP;
+        in->vdop = GNSS_NO_DOP;
+    }
+    fixes[0].sources = FIX_EPOCH_GGA | FIX_EPOCH_RMC;
+
+    return 1;
+}
+
+/* CFG-MSG: no NMEA, NAV-DOP and NAV-PVT each solution; then CFG-PRT: UART1 in UBX and
+ * NMEA, out UBX */
+static uint8_t ubxStartupCommand(uint8_t step, uint32_t baud, uint8_t * out) {
+
+    static const uint8_t nmeaOff[] = { UBX_NMEA_GGA, UBX_NMEA_GLL, UBX_NMEA_GSA,
+                                       UBX_NMEA_GSV, UBX_NMEA_RMC, UBX_NMEA_VTG };
+    static const uint8_t navOn[] = { UBX_NAV_DOP, UBX_NAV_PVT };
+    const uint8_t numOff = sizeof(nmeaOff), numOn = sizeof(navOn);
+
+    if (step < numOff)
+        return (uint8_t)ubxCfgMsg(UBX_NMEA, nmeaOff[step], 0, out);
+    if (step < numOff + numOn)
+        return (uint8_t)ubxCfgMsg(UBX_NAV, navOn[step - numOff], 1, out);
+    if (step == numOff + numOn)
+        return (uint8_t)ubxCfgPrtUart(baud, UBX_PROTO_UBX | UBX_PROTO_NMEA, UBX_PROTO_UBX, out);
+
+    return 0;
+}
+
+const GnssBackend gnssNmeaBackend = {
+    "NMEA", GNSS_PROTOCOL_NMEA, nmeaReset, nmeaPush, nmeaStartupCommand
+};
+
+const GnssBackend gnssUbxBackend = {
+    "UBX", GNSS_PROTOCOL_UBX, ubxReset, ubxPush, ubxStartupCommand
+};
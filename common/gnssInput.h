@@ -0,0 +1,98 @@
+//
+//  gnssInput.h
+//  GNSS input layer: turns the byte stream of a receiver into merged fixes, whichever
+//  protocol the receiver speaks
+//
+//  A backend frames its protocol byte by byte, checks each frame's checksum and decodes
+//  it where it lies, in the GnssInput, without copying it anywhere first:
+//
+//      gnssNmeaBackend     NMEA 0183 text; the GGA and RMC of a second are merged by a
+//                          FixEpoch, GSA gives fix mode and DOPs
+//      gnssUbxBackend      u-blox UBX binary; one NAV-PVT is a whole fix, the NAV-DOP
+//                          of the same epoch adds the DOPs
+//
+//  Both give the same EpochFix, so what comes after them does not know which one it was.
+//
+//  Each backend also has the commands that make a u-blox receiver output only what it
+//  decodes, at a higher baud rate. They are sent at the receiver's current rate, the
+//  baud rate change last; the UART is then reopened at the new rate.
+//
+
+#ifndef gnssInput_h
+#define gnssInput_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "fixEpoch.h"
+#include "gpsParser.h"
+#include "ubxProtocol.h"
+
+#define GNSS_INPUT_MAX_FIXES    FIX_EPOCH_MAX_OUT   // fixes one byte can complete
+#define GNSS_COMMAND_MAX        48                  // longest startup command
+#define GNSS_NO_DOP             0xFFFF              // as FIX_GATE_NO_DOP and FIX_EPOCH_NO_DOP
+
+// What a backend decodes, in GnssBackend.protocol
+#define GNSS_PROTOCOL_NMEA      0x01
+#define GNSS_PROTOCOL_UBX       0x02
+
+typedef struct GnssInput GnssInput;
+
+typedef struct {
+    const char * name;
+    uint8_t protocol;
+    void    (*reset)(GnssInput * in);
+    uint8_t (*push)(GnssInput * in, uint8_t byte, uint32_t nowMs, EpochFix * fixes);
+    uint8_t (*command)(uint8_t step, uint32_t baud, uint8_t * out);
+} GnssBackend;
+
+struct GnssInput {
+    const GnssBackend * backend;
+    /* From the latest GSA or NAV-DOP, for the quality gate */
+    uint8_t  fixMode;           // 1 none, 2 2D, 3 3D, 0 unknown
+    uint16_t pdop;              // 0.01, GNSS_NO_DOP if unknown
+    uint16_t vdop;
+    union {
+        struct {
+            GPSData  data;      // the sentence is framed into data.nmeaData.sentence
+            FixEpoch epoch;
+            uint8_t  fill;
+            uint8_t  checksum;
+            uint8_t  state;
+        } nmea;
+        struct {
+            UbxFramer framer;
+            uint8_t   buf[4 + UBX_NAV_PVT_LENGTH];
+            UbxDop    dop;      // of the latest NAV-DOP, matched to NAV-PVT by iTow
+            uint8_t   haveDop;
+        } ubx;
+    } u;
+    /* Statistics */
+    uint32_t bytes;
+    uint32_t frames;            // with a good checksum
+    uint32_t badFrames;         // bad checksum, or too long
+    uint32_t fixes;             // EpochFix given out, with a position or not
+    uint32_t acks;
+    uint32_t naks;
+};
+
+extern const GnssBackend gnssNmeaBackend;
+extern const GnssBackend gnssUbxBackend;
+
+void gnssInputInit(GnssInput * in, const GnssBackend * backend);
+
+/// Takes the next byte from the receiver at nowMs on the local clock. Returns the number of
+/// fixes completed, oldest first in fixes, which must hold GNSS_INPUT_MAX_FIXES.
+uint8_t gnssInputPush(GnssInput * in, uint8_t byte, uint32_t nowMs, EpochFix * fixes);
+
+/// Startup command number step, for a receiver to go on at baud. Returns its length in out,
+/// which must hold GNSS_COMMAND_MAX, or 0 after the last one.
+uint8_t gnssInputCommand(const GnssInput * in, uint8_t step, uint32_t baud, uint8_t * out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* gnssInput_h */
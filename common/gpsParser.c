@@ -0,0 +1,523 @@
+//
+//  gpsParser.c
+//  GPS Parser
+//
+
+#include "gpsParser.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define MAX_FIELDS  20  // GSV: 3 + 4 satellites * 4, GSA: 18
+
+// Pointers to the fields after the address field, up to max of them; each ends at the next
+// ',' or at the end of the sentence. Returns how many there are.
+static uint8_t nmeaFields(const char * sentence, const char ** fields, uint8_t max) {
+
+    const char * comma = strchr(sentence, ',');
+    uint8_t n = 0;
+
+    while (comma != NULL && n < max) {
+        fields[n++] = comma + 1;
+        comma = strchr(comma + 1, ',');
+    }
+
+    return n;
+}
+
+static bool nmeaFieldPresent(const char * const * fields, uint8_t numFields, uint8_t i) {
+
+    return i < numFields && fields[i][0] != ',' && fields[i][0] != '\0';
+}
+
+// Constellation of a satellite: by talker where it tells, else by NMEA satellite number
+static NMEASystem nmeaSystemOf(char talker, uint8_t prn) {
+
+    switch (talker) {
+        case 'P':
+            return NMEA_SYS_GPS;
+        case 'L':
+            return NMEA_SYS_GLONASS;
+        case 'A':
+            return NMEA_SYS_GALILEO;
+        case 'B':
+        case 'D':
+            return NMEA_SYS_BEIDOU;
+    }
+
+    if (prn >= 1 && prn <= 64)
+        return NMEA_SYS_GPS;
+    if (prn >= 65 && prn <= 96)
+        return NMEA_SYS_GLONASS;
+    if (prn >= 201 && prn <= 237)
+        return NMEA_SYS_BEIDOU;
+    return NMEA_SYS_OTHER;
+}
+
+// parses GGA type messages (called from nmeaParse())
+uint8_t nmeaParseGGA(GPSData * data) {
+
+    const char * f[MAX_FIELDS];
+    uint8_t n = nmeaFields(data->nmeaData.text, f, MAX_FIELDS);
+
+    if (nmeaFieldPresent(f, n, 0)) // UTC Time
+        data->time = strtod(f[0], NULL);
+    if (nmeaFieldPresent(f, n, 1)) // Latitude
+        data->latitude = strtod(f[1], NULL);
+    if (nmeaFieldPresent(f, n, 2)) // N or S
+        data->latDirection = f[2][0];
+    if (nmeaFieldPresent(f, n, 3)) // Longitude
+        data->longitude = strtod(f[3], NULL);
+    if (nmeaFieldPresent(f, n, 4)) // E or W
+        data->longDirection = f[4][0];
+    if (nmeaFieldPresent(f, n, 5)) // Fix quality
+        data->fixQuality = (uint8_t)atoi(f[5]);
+    if (nmeaFieldPresent(f, n, 6)) // Satellites in use
+        data->numSatellites = (uint8_t)atoi(f[6]);
+    if (nmeaFieldPresent(f, n, 7)) // HDOP
+        data->hdop = strtod(f[7], NULL);
+    if (nmeaFieldPresent(f, n, 8)) // Altitude
+        data->altitude = strtod(f[8], NULL);
+
+    return 0;
+}
+
+// parses GSA type messages (called from nmeaParse())
+uint8_t nmeaParseGSA(GPSData * data) {
+
+    const char * f[MAX_FIELDS];
+    uint8_t n = nmeaFields(data->nmeaData.text, f, MAX_FIELDS);
+
+    uint8_t i;
+    if (nmeaFieldPresent(f, n, 1)) // 1 none, 2 2D, 3 3D
+        data->fixMode = (uint8_t)atoi(f[1]);
+
+    data->numUsed = 0;
+    for (i = 2; i < 2 + NMEA_MAX_USED; ++i) {
+        if (nmeaFieldPresent(f, n, i))
+            data->usedPrn[data->numUsed++] = (uint8_t)atoi(f[i]);
+    }
+
+    // One GSA per constellation with $GN: NMEA 4.1 names it in field 17, else the talker
+    // or the first satellite tells
+    NMEASystem system = nmeaSystemOf(data->nmeaData.talker[1], data->numUsed ? data->usedPrn[0] : 0);
+    if (nmeaFieldPresent(f, n, 17)) {
+        static const NMEASystem systemIds[] = { NMEA_SYS_OTHER, NMEA_SYS_GPS, NMEA_SYS_GLONASS,
+                                                NMEA_SYS_GALILEO, NMEA_SYS_BEIDOU };
+        uint8_t id = (uint8_t)atoi(f[17]);
+        system = id < sizeof(systemIds) / sizeof(systemIds[0]) ? systemIds[id] : NMEA_SYS_OTHER;
+    }
+    data->usedBySystem[system] = data->numUsed;
+
+    if (nmeaFieldPresent(f, n, 14))
+        data->pdop = strtod(f[14], NULL);
+    if (nmeaFieldPresent(f, n, 15))
+        data->hdop = strtod(f[15], NULL);
+    if (nmeaFieldPresent(f, n, 16))
+        data->vdop = strtod(f[16], NULL);
+
+    return 0;
+}
+
+// parses RMC type messages (called from nmeaParse())
+uint8_t nmeaParseRMC(GPSData * data) {
+
+    const char * f[MAX_FIELDS];
+    uint8_t n = nmeaFields(data->nmeaData.text, f, MAX_FIELDS);
+
+    if (nmeaFieldPresent(f, n, 0)) // UTC Time
+        data->time = strtod(f[0], NULL);
+    if (nmeaFieldPresent(f, n, 1)) // A valid, V void
+        data->status = f[1][0];
+    if (nmeaFieldPresent(f, n, 2)) // Latitude
+        data->latitude = strtod(f[2], NULL);
+    if (nmeaFieldPresent(f, n, 3)) // N or S
+        data->latDirection = f[3][0];
+    if (nmeaFieldPresent(f, n, 4)) // Longitude
+        data->longitude = strtod(f[4], NULL);
+    if (nmeaFieldPresent(f, n, 5)) // E or W
+        data->longDirection = f[5][0];
+    if (nmeaFieldPresent(f, n, 6)) // Ground Speed, knots
+        data->groundSpeed = strtod(f[6], NULL);
+    if (nmeaFieldPresent(f, n, 7)) // True Course
+        data->trueCourse = strtod(f[7], NULL);
+    if (nmeaFieldPresent(f, n, 8)) { // Date, ddmmyy
+        uint32_t date = (uint32_t)atol(f[8]);
+        data->day   = (uint8_t)(date / 10000);
+        data->month = (uint8_t)(date / 100 % 100);
+        data->year  = (uint16_t)(2000 + date % 100);
+    }
+
+    return 0;
+}
+
+// parses GSV type messages (called from nmeaParse()). The sentences of one talker replace
+// what its previous GSV series left in inView.
+uint8_t nmeaParseGSV(GPSData * data) {
+
+    const char * f[MAX_FIELDS];
+    uint8_t n = nmeaFields(data->nmeaData.text, f, MAX_FIELDS);
+    char talker = data->nmeaData.talker[1];
+
+    uint8_t i, kept;
+    if (!nmeaFieldPresent(f, n, 1))
+        return 1;
+
+    // First sentence of a series: drop this talker's satellites
+    if (atoi(f[1]) == 1) {
+        for (i = 0, kept = 0; i < data->numInView; ++i) {
+            if (data->inView[i].talker != talker)
+                data->inView[kept++] = data->inView[i];
+        }
+        data->numInView = kept;
+    }
+
+    // Blocks of prn, elevation, azimuth, SNR; NMEA 4.1 appends a signal id after them
+    for (i = 3; i + 4 <= n; i += 4) {
+
+        if (data->numInView == NMEA_MAX_SATELLITES || !nmeaFieldPresent(f, n, i))
+            break;
+
+        NMEASatellite * sat = &data->inView[data->numInView++];
+        sat->talker    = talker;
+        sat->prn       = (uint8_t)atoi(f[i]);
+        sat->elevation = nmeaFieldPresent(f, n, i + 1) ? (uint8_t)atoi(f[i + 1]) : 0;
+        sat->azimuth   = nmeaFieldPresent(f, n, i + 2) ? (uint16_t)atoi(f[i + 2]) : 0;
+        sat->snr       = nmeaFieldPresent(f, n, i + 3) ? (uint8_t)atoi(f[i + 3]) : 0;
+    }
+
+    return 0;
+}
+
+// parses VTG type messages (called from nmeaParse())
+uint8_t nmeaParseVTG(GPSData * data) {
+
+    const char * f[MAX_FIELDS];
+    uint8_t n = nmeaFields(data->nmeaData.text, f, MAX_FIELDS);
+
+    if (nmeaFieldPresent(f, n, 0)) // True Course
+        data->trueCourse = strtod(f[0], NULL);
+    if (nmeaFieldPresent(f, n, 4)) // Ground Speed, knots
+        data->groundSpeed = strtod(f[4], NULL);
+
+    return 0;
+}
+
+// parses GLL type messages (called from nmeaParse()); a position marked void is left out
+uint8_t nmeaParseGLL(GPSData * data) {
+
+    const char * f[MAX_FIELDS];
+    uint8_t n = nmeaFields(data->nmeaData.text, f, MAX_FIELDS);
+
+    if (nmeaFieldPresent(f, n, 4)) // UTC Time
+        data->time = strtod(f[4], NULL);
+    data->status = nmeaFieldPresent(f, n, 5) ? f[5][0] : 'V';
+    if (data->status != 'A')
+        return 1;
+
+    if (nmeaFieldPresent(f, n, 0)) // Latitude
+        data->latitude = strtod(f[0], NULL);
+    if (nmeaFieldPresent(f, n, 1)) // N or S
+        data->latDirection = f[1][0];
+    if (nmeaFieldPresent(f, n, 2)) // Longitude
+        data->longitude = strtod(f[2], NULL);
+    if (nmeaFieldPresent(f, n, 3)) // E or W
+        data->longDirection = f[3][0];
+
+    return 0;
+}
+
+// parses ZDA type messages (called from nmeaParse())
+uint8_t nmeaParseZDA(GPSData * data) {
+
+    const char * f[MAX_FIELDS];
+    uint8_t n = nmeaFields(data->nmeaData.text, f, MAX_FIELDS);
+
+    if (nmeaFieldPresent(f, n, 0)) // UTC Time
+        data->time = strtod(f[0], NULL);
+    if (nmeaFieldPresent(f, n, 1))
+        data->day = (uint8_t)atoi(f[1]);
+    if (nmeaFieldPresent(f, n, 2))
+        data->month = (uint8_t)atoi(f[2]);
+    if (nmeaFieldPresent(f, n, 3))
+        data->year = (uint16_t)atoi(f[3]);
+
+    return 0;
+}
+
+// initializes the data struct to default values
+void nmeaDataInit(GPSData * data) {
+
+    uint32_t i;
+    for (i = 0; i < SENTENCE_LENGTH - 1; ++i) {
+        data->nmeaData.sentence[i] = ' ';
+    }
+
+    data->nmeaData.sentence[ SENTENCE_LENGTH - 1 ] = '\0';
+    data->nmeaData.text = data->nmeaData.sentence;
+    data->nmeaData.msgType = NMEA_UNKNOWN;
+    data->nmeaData.talker[0] = '\0';
+
+    data->latitude = 0;
+    data->latDirection = ' ';
+
+    data->longitude = 0;
+    data->longDirection = ' ';
+
+    data->time = 0;
+    data->altitude = 0;
+    data->groundSpeed = 0;
+    data->trueCourse = 0;
+
+    data->status = ' ';
+    data->day = 0;
+    data->month = 0;
+    data->year = 0;
+    data->fixQuality = 0;
+    data->numSatellites = 0;
+    data->fixMode = 0;
+    data->numUsed = 0;
+    data->pdop = 0;
+    data->hdop = 0;
+    data->vdop = 0;
+    data->numInView = 0;
+    for (i = 0; i < NMEA_SYSTEMS; ++i) {
+        data->usedBySystem[i] = 0;
+    }
+
+}
+
+// Classifies a sentence by its formatter, ignoring the talker
+NMEAType nmeaClassify(const char * sentence, char * talker) {
+
+    uint8_t i;
+    for (i = 0; i < 6; ++i) {
+        if (sentence[i] == '\0')
+            return NMEA_UNKNOWN;
+    }
+
+    if (talker != NULL) {
+        talker[0] = sentence[1] == 'P' ? '\0' : sentence[1];
+        talker[1] = sentence[2];
+        talker[2] = '\0';
+    }
+
+    // Proprietary sentences ($P...) have no talker, the formatter is not where we look
+    if (sentence[0] != '$' || sentence[1] == 'P')
+        return NMEA_UNKNOWN;
+
+    switch (NMEA_KEY(sentence[3], sentence[4], sentence[5])) {
+
+        case NMEA_KEY('G', 'G', 'A'):
+            return NMEA_GGA;
+        case NMEA_KEY('G', 'S', 'A'):
+            return NMEA_GSA;
+        case NMEA_KEY('R', 'M', 'C'):
+            return NMEA_RMC;
+        case NMEA_KEY('G', 'S', 'V'):
+            return NMEA_GSV;
+        case NMEA_KEY('V', 'T', 'G'):
+            return NMEA_VTG;
+        case NMEA_KEY('G', 'L', 'L'):
+            return NMEA_GLL;
+        case NMEA_KEY('Z', 'D', 'A'):
+            return NMEA_ZDA;
+        default:
+            return NMEA_UNKNOWN;
+
+    }
+
+}
+
+static const NMEAHandler defaultHandlers[] = {
+    { NMEA_GGA, nmeaParseGGA },
+    { NMEA_RMC, nmeaParseRMC },
+};
+
+static const NMEAHandler * handlers = defaultHandlers;
+static uint8_t numHandlers = sizeof(defaultHandlers) / sizeof(defaultHandlers[0]);
+
+void nmeaRegisterHandlers(const NMEAHandler * table, uint8_t count) {
+
+    if (count == 0) {
+        handlers = defaultHandlers;
+        numHandlers = sizeof(defaultHandlers) / sizeof(defaultHandlers[0]);
+        return;
+    }
+
+    handlers = table;
+    numHandlers = count;
+}
+
+// Takes in an NMEA sentence and places is it into the data struct if the msg is valid.
+// Verifies the checksum is valid and determines the msg type
+uint8_t nmeaReceiveSentence(GPSData * data, char * sentIn) {
+
+    char * start = strchr(sentIn, '$');
+    size_t length = start != NULL ? strlen(start) : 0;
+
+    if (start == NULL || length >= SENTENCE_LENGTH) {
+        strcpy(data->nmeaData.sentence, "INVALID SENTENCE");
+        data->nmeaData.text = data->nmeaData.sentence;
+        data->nmeaData.msgType = NMEA_UNKNOWN;
+        return 1;
+    }
+
+    // The checks of the view, on the copy
+    memcpy(data->nmeaData.sentence, start, length + 1);
+    return nmeaReceiveView(data, data->nmeaData.sentence, (uint8_t)length);
+
+}
+
+static int8_t nmeaHexValue(char c) {
+
+    if (c >= '0' && c <= '9')
+        return (int8_t)(c - '0');
+    if (c >= 'A' && c <= 'F')
+        return (int8_t)(c - 'A' + 10);
+    if (c >= 'a' && c <= 'f')
+        return (int8_t)(c - 'a' + 10);
+    return -1;
+}
+
+// The checks of nmeaReceiveSentence() on the sentence where it lies: '$', then '*' and two
+// hex digits, all within length bytes. The parsers are pointed at it.
+uint8_t nmeaReceiveView(GPSData * data, char * buf, uint8_t length) {
+
+    char * end = buf + length;
+    char * start = memchr(buf, '$', length);
+    char * checksumPtr = start != NULL ? memchr(start, '*', (size_t)(end - start)) : NULL;
+    const char * ptr;
+    uint8_t checksum = 0;
+
+    data->nmeaData.text = data->nmeaData.sentence;
+
+    // 82 characters at most with CR LF
+    if (checksumPtr == NULL || end - checksumPtr < 3 || checksumPtr - start > SENTENCE_LENGTH - 6) {
+        strcpy(data->nmeaData.sentence, "INVALID SENTENCE");
+        data->nmeaData.msgType = NMEA_UNKNOWN;
+        return 1;
+    }
+
+    for (ptr = start + 1; ptr != checksumPtr; ++ptr) {
+        checksum ^= (uint8_t)*ptr;
+    }
+
+    if (nmeaHexValue(checksumPtr[1]) != checksum >> 4 || nmeaHexValue(checksumPtr[2]) != (checksum & 0x0F)) {
+        strcpy(data->nmeaData.sentence, "INVALID SENTENCE");
+        data->nmeaData.msgType = NMEA_UNKNOWN;
+        return 1;
+    }
+
+    *checksumPtr = '\0';
+
+    data->nmeaData.text = start;
+    data->nmeaData.msgType = nmeaClassify(start, data->nmeaData.talker);
+
+    return 0;
+
+}
+
+///  NMEA Data Parser: returns 0 if data parsing is successful, 1 otherwise, also if no
+///  parser is registered for the sentence type.
+/// @param data address to a GPSData struct (defined in GPS_parser.h)
+uint8_t nmeaParse(GPSData * data) {
+
+    uint8_t i;
+    for (i = 0; i < numHandlers; ++i) {
+        if (handlers[i].type == data->nmeaData.msgType)
+            return handlers[i].parse(data);
+    }
+
+    return 1;
+
+}
+
+void nmeaSystemSummary(const GPSData * data, NMEASystemSummary * summary) {
+
+    uint16_t snrSum[NMEA_SYSTEMS] = { 0 };
+    uint8_t i;
+
+    for (i = 0; i < NMEA_SYSTEMS; ++i) {
+        summary[i].inView = 0;
+        summary[i].tracked = 0;
+        summary[i].used = data->usedBySystem[i];
+        summary[i].meanSnr = 0;
+    }
+
+    for (i = 0; i < data->numInView; ++i) {
+        NMEASystem system = nmeaSystemOf(data->inView[i].talker, data->inView[i].prn);
+        ++summary[system].inView;
+        if (data->inView[i].snr) {
+            ++summary[system].tracked;
+            snrSum[system] += data->inView[i].snr;
+        }
+    }
+
+    for (i = 0; i < NMEA_SYSTEMS; ++i) {
+        if (summary[i].tracked)
+            summary[i].meanSnr = (uint8_t)(snrSum[i] / summary[i].tracked);
+    }
+}
+
+/* Some useful char to print */
+const char  latitude[] = "latitude:\t";
+const char  longitude[] = "longitude:\t";
+const char  groundSpeed[] = "ground speed:\t";
+const char  trueCourse[] = "true course:\t";
+const char  colon[] = ":" ;
+const char  period[] = ".";
+const char  newline[] = "\r\n";
+const char  tab[] = "\t";
+const char  deg[] = " ";
+
+// value within [0, max], NaN as 0: whatever the sentence said, the line stays within
+// NMEA_STRING_LENGTH and the casts below are defined
+static double nmeaClamp(double value, double max) {
+
+    return value > 0 ? (value < max ? value : max) : 0;
+}
+
+void nmeaToString(GPSData * data, char * strOut) {
+
+    char * infoptr = strOut;
+    uint32_t length = 0;
+    double time = nmeaClamp(data->time, 999999);
+    double lat = nmeaClamp(data->latitude, 9000);
+    double lon = nmeaClamp(data->longitude, 18000);
+
+    /* time */
+    length += sprintf(infoptr + length, "%02d", (uint32_t)(time) / 10000 % 100);
+    length += sprintf(infoptr + length, "%s", colon);
+    length += sprintf(infoptr + length, "%02d", (uint32_t)(time) / 100     % 100);
+    length += sprintf(infoptr + length, "%s", colon);
+    length += sprintf(infoptr + length, "%02d", (uint32_t)(time) / 1   % 100);
+    length += sprintf(infoptr + length, "%s", tab);
+
+    /* latitude */
+    length += sprintf(infoptr + length, "%s", latitude);
+    length += sprintf(infoptr + length, "%d", (int32_t)(lat) / 100);
+    length += sprintf(infoptr + length, "%s", " ");
+    length += sprintf(infoptr + length, "%lf", lat - ((uint32_t)(lat) / 100) * 100);
+    length += sprintf(infoptr + length, "%c", data->latDirection);
+    length += sprintf(infoptr + length, "%s", tab);
+
+    /* latitude */
+    length += sprintf(infoptr + length, "%s", longitude);
+    length += sprintf(infoptr + length, "%d", (int32_t)(lon) / 100);
+    length += sprintf(infoptr + length, "%s", " ");
+    length += sprintf(infoptr + length, "%lf", lon - ((uint32_t)(lon) / 100) * 100);
+    length += sprintf(infoptr + length, "%c", data->longDirection);
+    length += sprintf(infoptr + length, "%s", tab);
+
+    /* ground speed */
+    length += sprintf(infoptr + length, "%s", groundSpeed);
+    length += sprintf(infoptr + length, "%lf", nmeaClamp(data->groundSpeed, 99999));
+    length += sprintf(infoptr + length, "%s", tab);
+
+    /* true course */
+    length += sprintf(infoptr + length, "%s", trueCourse);
+    length += sprintf(infoptr + length, "%lf", nmeaClamp(data->trueCourse, 360));
+    length += sprintf(infoptr + length, "%s", newline);
+
+}
@@ -0,0 +1,170 @@
+//
+//  gpsParser.h
+//  GPS Parser
+//
+//  Sentences are classified by their three letter formatter whatever the talker ($GP GPS,
+//  $GL GLONASS, $GA Galileo, $GB/$BD BeiDou, $GN combined, ...). nmeaParse() hands a
+//  classified sentence to the parser registered for its type with nmeaRegisterHandlers();
+//  parsers that are never registered are never referenced and cost no flash. Until a table
+//  is registered GGA and RMC are parsed.
+//
+
+#ifndef gpsParser_h
+#define gpsParser_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define SENTENCE_LENGTH 83 // 82 + 1 = sentence + null terminator
+#define NMEA_STRING_LENGTH  120 // room nmeaToString() needs
+
+#define NMEA_MAX_SATELLITES 32  // satellites in view kept from GSV, all talkers together
+#define NMEA_MAX_USED       12  // satellites in use listed by one GSA
+
+// Formatter of a sentence packed into an integer, the key nmeaClassify() switches on
+#define NMEA_KEY(a, b, c)   ((uint32_t)(a) << 16 | (uint32_t)(b) << 8 | (uint32_t)(c))
+
+// NMEA sentence types
+typedef enum {
+    NMEA_GGA,       // fix: time, position, quality, satellites, HDOP, altitude
+    NMEA_GSA,       // fix mode, satellites in use, DOPs
+    NMEA_RMC,       // time, date, position, speed, course
+    NMEA_GSV,       // satellites in view, up to 4 per sentence
+    NMEA_VTG,       // course and speed
+    NMEA_GLL,       // position and time
+    NMEA_ZDA,       // time and date
+    NMEA_UNKNOWN
+} NMEAType;
+
+// Constellations, from the talker or the satellite number
+typedef enum {
+    NMEA_SYS_GPS,       // SBAS included
+    NMEA_SYS_GLONASS,
+    NMEA_SYS_GALILEO,
+    NMEA_SYS_BEIDOU,
+    NMEA_SYS_OTHER,
+    NMEA_SYSTEMS
+} NMEASystem;
+
+typedef struct {
+    char sentence[SENTENCE_LENGTH];
+    const char * text;  // what the parsers read: sentence, or the view of nmeaReceiveView()
+    NMEAType msgType;
+    char talker[3];     // e.g. "GN", "" for proprietary sentences
+
+} NMEASentence;
+
+typedef struct {
+    char    talker;     // second letter of the talker: 'P' GPS, 'L' GLONASS, 'A' Galileo, ...
+    uint8_t prn;
+    uint8_t elevation;  // degrees
+    uint16_t azimuth;   // degrees
+    uint8_t snr;        // dB-Hz, 0 if not tracked
+} NMEASatellite;
+
+typedef struct {
+
+    NMEASentence nmeaData;
+
+    double latitude;
+    char latDirection;
+
+    double longitude;
+    char longDirection;
+
+    double time;
+
+    double altitude;
+
+    double groundSpeed;
+
+    double trueCourse;
+
+    /* RMC, GLL */
+    char status;            // 'A' valid, 'V' void
+
+    /* RMC, ZDA */
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+
+    /* GGA */
+    uint8_t fixQuality;     // 0 none, 1 GPS, 2 DGPS, 4 RTK fixed, 5 RTK float, 6 estimated
+    uint8_t numSatellites;  // in use
+
+    /* GSA */
+    uint8_t fixMode;        // 1 none, 2 2D, 3 3D
+    uint8_t numUsed;
+    uint8_t usedPrn[NMEA_MAX_USED];
+    uint8_t usedBySystem[NMEA_SYSTEMS];     // from the latest GSA of each system
+    double pdop;
+    double hdop;            // GGA too
+    double vdop;
+
+    /* GSV */
+    uint8_t numInView;
+    NMEASatellite inView[NMEA_MAX_SATELLITES];
+
+} GPSData;
+
+typedef struct {
+    uint8_t inView;
+    uint8_t tracked;        // in view with an SNR
+    uint8_t used;
+    uint8_t meanSnr;        // dB-Hz, of the tracked ones
+} NMEASystemSummary;
+
+typedef uint8_t (*NMEAParser)(GPSData * data);
+
+typedef struct {
+    NMEAType   type;
+    NMEAParser parse;
+} NMEAHandler;
+
+void nmeaDataInit(GPSData * data);
+
+/// Type of the sentence starting at sentence ('$'); copies the talker into talker (3 chars)
+/// unless it is NULL. Reads no further than the formatter.
+NMEAType nmeaClassify(const char * sentence, char * talker);
+
+/// table must stay valid; count 0 goes back to GGA and RMC.
+void nmeaRegisterHandlers(const NMEAHandler * table, uint8_t count);
+
+uint8_t nmeaReceiveSentence(GPSData * data, char * sentIn);
+
+/// Zero copy nmeaReceiveSentence(): checks the sentence in the first length bytes of buf
+/// where it lies, nothing is read beyond them and nothing needs a terminator. The '*' is
+/// overwritten with '\0' and the parsers read buf, which must not change until they ran.
+uint8_t nmeaReceiveView(GPSData * data, char * buf, uint8_t length);
+
+uint8_t nmeaParse(GPSData * data);
+
+/// The parsers, for handler tables.
+uint8_t nmeaParseGGA(GPSData * data);
+uint8_t nmeaParseGSA(GPSData * data);
+uint8_t nmeaParseRMC(GPSData * data);
+uint8_t nmeaParseGSV(GPSData * data);
+uint8_t nmeaParseVTG(GPSData * data);
+uint8_t nmeaParseGLL(GPSData * data);
+uint8_t nmeaParseZDA(GPSData * data);
+
+/// Satellites in view (GSV) and in use (GSA) per constellation, NMEA_SYSTEMS entries.
+void nmeaSystemSummary(const GPSData * data, NMEASystemSummary * summary);
+
+/// The gateway's output line of a fix into strOut, at most NMEA_STRING_LENGTH bytes with the
+/// terminator whatever the sentences held.
+void nmeaToString(GPSData * data, char * strOut);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* gpsParser_h */
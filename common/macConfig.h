@@ -0,0 +1,106 @@
+//
+//  macConfig.h
+//  Build-time selection of the medium access scheme, shared by Tx and Rx
+//
+//  Tracker and gateway must be built with the same MAC_MODE.
+//
+
+#ifndef macConfig_h
+#define macConfig_h
+
+#include "phyProfile.h"
+
+#define MAC_MODE_ALOHA  0   // transmit as soon as a sentence is complete
+#define MAC_MODE_TDMA   1   // beacon based TDMA, gateway assigns the slots (tdmaMac.h)
+#define MAC_MODE_CSMA   2   // listen before talk with random backoff, no coordinator (csmaMac.h)
+
+#ifndef MAC_MODE
+#define MAC_MODE        MAC_MODE_TDMA
+#endif
+
+#if PHY_CHANNELS > 1 && MAC_MODE == MAC_MODE_TDMA
+#error "PHY_CHANNELS needs MAC_MODE_ALOHA or MAC_MODE_CSMA, TDMA slots do not collide and one gateway radio hears one channel"
+#endif
+
+/* 1: the gateway acknowledges DATA frames and trackers retransmit the missing ones (arqMac.h) */
+#ifndef MAC_ACK
+#define MAC_ACK         0
+#endif
+
+#if MAC_ACK && MAC_MODE == MAC_MODE_TDMA
+#error "MAC_ACK needs MAC_MODE_ALOHA or MAC_MODE_CSMA, TDMA slots carry only the latest sentence"
+#endif
+
+/* 1: trackers turn their TX power down to what their link needs, by the RSSI the gateway
+ * reports in every ACK, and back to maximum when ACKs stop coming (txPower.h) */
+#ifndef TX_POWER_CONTROL
+#define TX_POWER_CONTROL    0
+#endif
+
+#if TX_POWER_CONTROL && !MAC_ACK
+#error "TX_POWER_CONTROL needs MAC_ACK, the ACKs carry the RSSI it works from"
+#endif
+
+/* Margin over the sensitivity of PHY_PROFILE a tracker's frames should arrive with. More
+ * for trackers on the move, less for parked ones. */
+#ifndef TX_POWER_TARGET_MARGIN_DB
+#define TX_POWER_TARGET_MARGIN_DB   TXP_DEFAULT_TARGET_MARGIN_DB
+#endif
+
+/* 1: the gateway moves every TDMA slot to the fastest PHY profile its link carries, by the
+ * RSSI of the owner's frames, and back when it fades (adaptiveRate.h) */
+#ifndef MAC_ADR
+#define MAC_ADR         0
+#endif
+
+#if MAC_ADR && MAC_MODE != MAC_MODE_TDMA
+#error "MAC_ADR needs MAC_MODE_TDMA, only there the gateway knows which PHY the next frame uses"
+#endif
+
+/* 1: trackers seal DATA and LOG frames with AES-CCM, the gateway drops anything that is not
+ * authentic or was seen before (secureLink.h) */
+#ifndef SECURE_LINK
+#define SECURE_LINK     0
+#endif
+
+#if SECURE_LINK && MAC_MODE == MAC_MODE_TDMA
+#error "SECURE_LINK needs MAC_MODE_ALOHA or MAC_MODE_CSMA, the TDMA gateway handles frames in the RF callback"
+#endif
+
+/* Gateway role: 0 for the root, which prints what it hears, N for a relay N hops out that
+ * sends the trackers' frames on toward it (meshRelay.h). Trackers do not need to know. */
+#ifndef MESH_LEVEL
+#define MESH_LEVEL      0
+#endif
+
+#if MESH_LEVEL > 15
+#error "MESH_LEVEL goes up to MESH_MAX_LEVEL, 15"
+#endif
+
+#if MESH_LEVEL && (MAC_MODE == MAC_MODE_TDMA || PHY_CHANNELS > 1)
+#error "MESH_LEVEL needs MAC_MODE_ALOHA or MAC_MODE_CSMA on one channel, a relay that owns no slots and keeps its radio on one frequency"
+#endif
+
+/* Node ID a relay sends its RELAY frames with, from PKT_RELAY_ID_FIRST to PKT_RELAY_ID_LAST
+ * (packetCodec.h), which trackers never take. Give every relay of a deployment its own. */
+#ifndef MESH_NODE_ID
+#define MESH_NODE_ID    (0xF0 | MESH_LEVEL)
+#endif
+
+/* Network key, the same on every tracker and gateway of a deployment: 16 bytes as an array
+ * initializer, given to the build, e.g. -DSECURE_NETWORK_KEY="{ 0x.., ... }". There is no
+ * default. SECURE_DEV_KEY 1 takes the key below, which anyone can read here: bench work only. */
+#ifndef SECURE_DEV_KEY
+#define SECURE_DEV_KEY  0
+#endif
+
+#if SECURE_DEV_KEY && !defined(SECURE_NETWORK_KEY)
+#define SECURE_NETWORK_KEY  { 0x6d, 0x61, 0x70, 0x6c, 0x65, 0x73, 0x65, 0x65, \
+                              0x64, 0x2d, 0x64, 0x65, 0x76, 0x2d, 0x6b, 0x79 }
+#endif
+
+#if SECURE_LINK && !defined(SECURE_NETWORK_KEY)
+#error "SECURE_LINK needs SECURE_NETWORK_KEY, the deployment's own key; SECURE_DEV_KEY 1 takes the published one for bench work"
+#endif
+
+#endif /* macConfig_h */
@@ -0,0 +1,210 @@
+//
+//  meshRelay.c
+//  Multi-hop relaying of tracker frames toward the root gateway
+//
+
+#include <string.h>
+
+#include "meshRelay.h"
+
+void meshDefaultConfig(MeshConfig * cfg) {
+
+    cfg->holdMs   = MESH_DEFAULT_HOLD_MS;
+    cfg->jitterMs = MESH_DEFAULT_JITTER_MS;
+    cfg->ttl      = MESH_DEFAULT_TTL;
+}
+
+void meshDedupInit(MeshDedup * dedup) {
+
+    memset(dedup, 0, sizeof(*dedup));
+}
+
+uint8_t meshDedupCheck(MeshDedup * dedup, uint8_t nodeId, uint16_t seq) {
+
+    uint8_t i;
+
+    for (i = 0; i < dedup->count; ++i) {
+        if (dedup->nodeId[i] == nodeId && dedup->seq[i] == seq)
+            return 1;
+    }
+
+    dedup->nodeId[dedup->next] = nodeId;
+    dedup->seq[dedup->next]    = seq;
+    dedup->next = (uint8_t)((dedup->next + 1) % MESH_DEDUP_ENTRIES);
+    if (dedup->count < MESH_DEDUP_ENTRIES)
+        ++dedup->count;
+
+    return 0;
+}
+
+/* The frames relays carry: the ones with fixes */
+static uint8_t meshRelayable(const PacketHeader * hdr) {
+
+    return hdr->type == PKT_TYPE_DATA || hdr->type == PKT_TYPE_LOG || hdr->type == PKT_TYPE_FIX;
+}
+
+uint8_t meshNextEntry(const uint8_t * frame, uint8_t length, uint8_t * offset, MeshEntry * entry) {
+
+    PacketHeader hdr;
+
+    if (*offset == 0)
+        *offset = MESH_RELAY_HEADER_LENGTH;
+
+    if (*offset + MESH_ENTRY_HEADER_LENGTH > length)
+        return 1;
+
+    const uint8_t * p = frame + *offset;
+    uint8_t frameLength = p[1];
+
+    if (*offset + MESH_ENTRY_HEADER_LENGTH + frameLength > length ||
+        pktDecodeHeader(&hdr, p + MESH_ENTRY_HEADER_LENGTH, frameLength) || !meshRelayable(&hdr)) {
+        *offset = length;
+        return 1;
+    }
+
+    entry->hops   = p[0] >> 4;
+    entry->ttl    = p[0] & 0x0F;
+    entry->nodeId = hdr.nodeId;
+    entry->seq    = hdr.seq;
+    entry->frame  = p + MESH_ENTRY_HEADER_LENGTH;
+    entry->length = frameLength;
+
+    *offset += MESH_ENTRY_HEADER_LENGTH + frameLength;
+    return 0;
+}
+
+void meshRelayInit(MeshRelay * relay, const MeshConfig * cfg, uint8_t nodeId, uint8_t level) {
+
+    memset(relay, 0, sizeof(*relay));
+    relay->cfg    = *cfg;
+    relay->nodeId = nodeId;
+    relay->level  = level;
+    meshDedupInit(&relay->seen);
+}
+
+/* Returns 1 if the frame was queued */
+static uint8_t meshQueue(MeshRelay * relay, uint8_t hops, uint8_t ttl, const uint8_t * frame, uint8_t length,
+                         uint32_t nowMs, uint32_t random) {
+
+    MeshQueued * q;
+
+    if (length > MESH_MAX_ENTRY_LENGTH) {
+        ++relay->overflows;
+        return 0;
+    }
+
+    /* Full: the oldest goes, the newest fix is worth more */
+    if (relay->count == MESH_QUEUE_ENTRIES) {
+        q = &relay->queue[relay->head];
+        relay->queuedBytes -= MESH_ENTRY_HEADER_LENGTH + q->length;
+        relay->head = (uint8_t)((relay->head + 1) % MESH_QUEUE_ENTRIES);
+        --relay->count;
+        ++relay->overflows;
+    }
+
+    if (relay->count == 0)
+        relay->dueMs = nowMs + relay->cfg.holdMs + random % (relay->cfg.jitterMs + 1UL);
+
+    q = &relay->queue[(relay->head + relay->count) % MESH_QUEUE_ENTRIES];
+    q->hopsTtl = (uint8_t)((hops > 15 ? 15 : hops) << 4 | (ttl & 0x0F));
+    q->length  = length;
+    memcpy(q->frame, frame, length);
+
+    ++relay->count;
+    relay->queuedBytes += MESH_ENTRY_HEADER_LENGTH + length;
+    return 1;
+}
+
+uint8_t meshRelayAccept(MeshRelay * relay, const uint8_t * frame, uint8_t length, uint32_t nowMs,
+                        uint32_t random) {
+
+    PacketHeader hdr;
+    MeshEntry entry;
+    uint8_t offset = 0;
+    uint8_t queued = 0;
+
+    if (pktDecodeHeader(&hdr, frame, length))
+        return 0;
+
+    /* One of our trackers: the first relay hop */
+    if (meshRelayable(&hdr)) {
+        if (meshDedupCheck(&relay->seen, hdr.nodeId, hdr.seq)) {
+            ++relay->duplicates;
+            return 0;
+        }
+        if (relay->cfg.ttl == 0) {
+            ++relay->expired;
+            return 0;
+        }
+        return meshQueue(relay, 1, relay->cfg.ttl - 1, frame, length, nowMs, random);
+    }
+
+    /* Only from further out, or frames would go round in circles */
+    if (hdr.type != PKT_TYPE_RELAY || length < MESH_RELAY_HEADER_LENGTH || frame[PKT_HEADER_LENGTH] <= relay->level)
+        return 0;
+
+    while (meshNextEntry(frame, length, &offset, &entry) == 0) {
+
+        if (meshDedupCheck(&relay->seen, entry.nodeId, entry.seq)) {
+            ++relay->duplicates;
+            continue;
+        }
+        if (entry.ttl == 0) {
+            ++relay->expired;
+            continue;
+        }
+        queued += meshQueue(relay, entry.hops + 1, entry.ttl - 1, entry.frame, entry.length, nowMs, random);
+    }
+
+    return queued;
+}
+
+uint32_t meshRelayWaitMs(const MeshRelay * relay, uint32_t nowMs) {
+
+    if (relay->count == 0)
+        return MESH_FOREVER;
+
+    /* A full RELAY frame does not wait */
+    if (MESH_RELAY_HEADER_LENGTH + relay->queuedBytes >= MESH_MAX_FRAME_LENGTH)
+        return 0;
+
+    return (int32_t)(relay->dueMs - nowMs) > 0 ? relay->dueMs - nowMs : 0;
+}
+
+uint8_t meshRelayBuild(MeshRelay * relay, uint8_t * buf, uint8_t maxLen) {
+
+    PacketHeader hdr;
+    uint8_t length;
+
+    if (relay->count == 0 ||
+        MESH_RELAY_HEADER_LENGTH + MESH_ENTRY_HEADER_LENGTH + relay->queue[relay->head].length > maxLen)
+        return 0;
+
+    hdr.type   = PKT_TYPE_RELAY;
+    hdr.flags  = 0;
+    hdr.nodeId = relay->nodeId;
+    hdr.seq    = relay->seq++;
+    length = pktEncodeHeader(&hdr, buf);
+    buf[length++] = relay->level;
+
+    /* Oldest first, while they fit; what is left keeps the time it was due */
+    while (relay->count > 0) {
+
+        MeshQueued * q = &relay->queue[relay->head];
+
+        if (length + MESH_ENTRY_HEADER_LENGTH + q->length > maxLen)
+            break;
+
+        buf[length++] = q->hopsTtl;
+        buf[length++] = q->length;
+        memcpy(buf + length, q->frame, q->length);
+        length += q->length;
+
+        relay->queuedBytes -= MESH_ENTRY_HEADER_LENGTH + q->length;
+        relay->head = (uint8_t)((relay->head + 1) % MESH_QUEUE_ENTRIES);
+        --relay->count;
+        ++relay->forwarded;
+    }
+
+    return length;
+}
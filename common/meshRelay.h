@@ -0,0 +1,134 @@
+//
+//  meshRelay.h
+//  Relays that carry trackers' fixes to the root gateway over several hops, shared by the
+//  relays and the root (Rx) and the host benchmark
+//
+//  Every gateway board is built with a MESH_LEVEL (macConfig.h): 0 for the root, which prints
+//  what it hears, N for a relay N hops out. A relay takes the DATA, LOG and FIX frames of the
+//  trackers around it and the RELAY frames of relays further out (a higher level), and sends
+//  them on in RELAY frames of its own. Whatever is one level closer to the root takes them
+//  from there. There are no routes: the level is all a relay knows of the network.
+//
+//  A RELAY frame (PKT_TYPE_RELAY) carries the relay's node ID and its own sequence number in
+//  the header, then
+//
+//      byte 0      level of the relay that sent it
+//      entries     one per tracker frame, as many as fit in MESH_MAX_FRAME_LENGTH:
+//          byte 0      hops (high nibble, relays passed) | TTL (low nibble, relays still allowed)
+//          byte 1      length of the frame
+//          byte 2..    the tracker's frame as it was received, header included; sealed frames
+//                      stay sealed and are opened by the root
+//
+//  Frames are known by the node ID and sequence number in their header. A bounded cache of
+//  the last MESH_DEDUP_ENTRIES drops the copies that arrive over two relays, or both
+//  directly and relayed; the root keeps one as well. Each relay hop takes one off the TTL,
+//  and a frame whose TTL is spent is dropped rather than relayed.
+//
+//  A relay holds what it takes for up to holdMs, plus a random jitter so neighbouring relays
+//  do not send at the same moment, so that several fixes share one RELAY frame, and sends
+//  at once when one is full. When the queue is full the oldest frame goes. Relays do not
+//  acknowledge each other; with MAC_ACK a relay acknowledges its trackers as the gateway
+//  they hear.
+//
+
+#ifndef meshRelay_h
+#define meshRelay_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "packetCodec.h"
+
+#define MESH_MAX_LEVEL              15
+#define MESH_DEFAULT_TTL            4       // relays a tracker's frame may pass
+#define MESH_DEFAULT_HOLD_MS        500
+#define MESH_DEFAULT_JITTER_MS      250
+#define MESH_DEDUP_ENTRIES          32
+#define MESH_QUEUE_ENTRIES          8
+#define MESH_MAX_FRAME_LENGTH       102     // MAX_LENGTH of the gateway's RX
+#define MESH_RELAY_HEADER_LENGTH    (PKT_HEADER_LENGTH + 1)
+#define MESH_ENTRY_HEADER_LENGTH    2
+#define MESH_MAX_ENTRY_LENGTH       (MESH_MAX_FRAME_LENGTH - MESH_RELAY_HEADER_LENGTH - MESH_ENTRY_HEADER_LENGTH)
+#define MESH_FOREVER                0xFFFFFFFF
+
+typedef struct {
+    uint16_t holdMs;        // longest a frame waits for others to share a RELAY frame with
+    uint16_t jitterMs;      // random, on top of holdMs
+    uint8_t  ttl;           // given to the frames of the relay's own trackers
+} MeshConfig;
+
+/* The node IDs and sequence numbers seen last, oldest replaced first */
+typedef struct {
+    uint8_t  nodeId[MESH_DEDUP_ENTRIES];
+    uint16_t seq[MESH_DEDUP_ENTRIES];
+    uint8_t  count;
+    uint8_t  next;
+} MeshDedup;
+
+/* One tracker frame of a RELAY frame */
+typedef struct {
+    uint8_t         hops;
+    uint8_t         ttl;
+    uint8_t         nodeId;     // of the tracker, from the frame's header
+    uint16_t        seq;
+    const uint8_t * frame;
+    uint8_t         length;
+} MeshEntry;
+
+typedef struct {
+    uint8_t hopsTtl;
+    uint8_t length;
+    uint8_t frame[MESH_MAX_ENTRY_LENGTH];
+} MeshQueued;
+
+typedef struct {
+    MeshConfig cfg;
+    uint8_t    nodeId;
+    uint8_t    level;
+    uint16_t   seq;
+    MeshDedup  seen;
+    MeshQueued queue[MESH_QUEUE_ENTRIES];
+    uint8_t    head;
+    uint8_t    count;
+    uint16_t   queuedBytes;     // entries with their headers
+    uint32_t   dueMs;           // the next RELAY frame goes out, while count > 0
+    uint32_t   forwarded;       // frames sent on
+    uint32_t   duplicates;
+    uint32_t   expired;         // TTL spent
+    uint32_t   overflows;       // dropped from a full queue, or too long to relay
+} MeshRelay;
+
+void meshDefaultConfig(MeshConfig * cfg);
+
+void meshDedupInit(MeshDedup * dedup);
+
+/// Returns 1 if the frame of nodeId with seq was seen before, otherwise 0 and remembers it.
+uint8_t meshDedupCheck(MeshDedup * dedup, uint8_t nodeId, uint16_t seq);
+
+/// The next entry of a RELAY frame: *offset starts at 0. Returns 0 and fills entry, 1 at the
+/// end of the frame or at a malformed entry, which ends it too.
+uint8_t meshNextEntry(const uint8_t * frame, uint8_t length, uint8_t * offset, MeshEntry * entry);
+
+/// level 1 to MESH_MAX_LEVEL, hops from the root.
+void meshRelayInit(MeshRelay * relay, const MeshConfig * cfg, uint8_t nodeId, uint8_t level);
+
+/// Takes a frame the relay received: a tracker's DATA, LOG or FIX frame, or a RELAY frame
+/// from further out. random draws the jitter. Returns the number of tracker frames queued.
+uint8_t meshRelayAccept(MeshRelay * relay, const uint8_t * frame, uint8_t length, uint32_t nowMs,
+                        uint32_t random);
+
+/// Milliseconds until a RELAY frame is due, 0 if it is, MESH_FOREVER with nothing queued.
+uint32_t meshRelayWaitMs(const MeshRelay * relay, uint32_t nowMs);
+
+/// Writes the next RELAY frame, the oldest queued frames that fit, into buf. Returns its
+/// length, 0 if nothing is queued or maxLen is too short for the oldest.
+uint8_t meshRelayBuild(MeshRelay * relay, uint8_t * buf, uint8_t maxLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* meshRelay_h */
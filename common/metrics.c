@@ -0,0 +1,291 @@
+//
+//  metrics.c
+//  Static metrics registry and its telemetry record
+//
+
+#include "metrics.h"
+#include <stdio.h>
+#include <string.h>
+
+MetricsRegistry metrics;
+
+static const char * const counterNames[METRIC_COUNTERS] = {
+    "rx frames", "crc errors", "rx ignored", "rx overflows", "rx rejected", "sentences",
+    "bad sentences", "parse errors", "uart errors", "uart dropped", "tx frames", "tx failed",
+    "rf errors"
+};
+
+static const char * const gaugeNames[METRIC_GAUGES] = {
+    "rf last error", "rx queue high", "log backlog", "main stack peak", "system stack peak",
+    "heap peak"
+};
+
+static const char * const histogramNames[METRIC_HISTOGRAMS] = {
+    "rssi", "frame bytes"
+};
+
+// Upper bounds of all buckets but the last
+static const int16_t histogramBounds[METRIC_HISTOGRAMS][METRIC_BUCKETS - 1] = {
+    { -110, -100, -90, -80, -70, -60, -50 },
+    { 16, 24, 32, 48, 64, 96, 128 }
+};
+
+static void atomicAdd(volatile uint32_t * p, uint32_t n) {
+
+#if defined(__TI_COMPILER_VERSION__)
+    uint32_t v;
+    do {
+        v = __ldrex((void *)p) + n;
+    } while (__strex(v, (void *)p));
+#else
+    __atomic_fetch_add(p, n, __ATOMIC_RELAXED);
+#endif
+}
+
+static void atomicMax(volatile uint32_t * p, uint32_t value) {
+
+#if defined(__TI_COMPILER_VERSION__)
+    do {
+        if (__ldrex((void *)p) >= value)
+            return;
+    } while (__strex(value, (void *)p));
+#else
+    uint32_t old = *p;
+    while (old < value &&
+           !__atomic_compare_exchange_n(p, &old, value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+#endif
+}
+
+void metricsInit(void) {
+
+    memset((void *)&metrics, 0, sizeof(metrics));
+}
+
+void metricAdd(uint8_t counter, uint32_t n) {
+
+    if (counter < METRIC_COUNTERS)
+        atomicAdd(&metrics.counters[counter], n);
+}
+
+void metricSet(uint8_t gauge, uint32_t value) {
+
+    if (gauge < METRIC_GAUGES)
+        metrics.gauges[gauge] = value;
+}
+
+void metricMax(uint8_t gauge, uint32_t value) {
+
+    if (gauge < METRIC_GAUGES)
+        atomicMax(&metrics.gauges[gauge], value);
+}
+
+void metricObserve(uint8_t histogram, int32_t value) {
+
+    uint8_t b = 0;
+
+    if (histogram >= METRIC_HISTOGRAMS)
+        return;
+    while (b < METRIC_BUCKETS - 1 && value >= histogramBounds[histogram][b])
+        ++b;
+    atomicAdd(&metrics.histograms[histogram][b], 1);
+}
+
+void metricsSnapshot(MetricsSnapshot * s, uint32_t uptimeS) {
+
+    uint8_t i, b;
+
+    s->flags = 0;
+    s->uptimeS = uptimeS;
+    for (i = 0; i < METRIC_COUNTERS; ++i)
+        s->counters[i] = metrics.counters[i];
+    for (i = 0; i < METRIC_GAUGES; ++i)
+        s->gauges[i] = metrics.gauges[i];
+    for (i = 0; i < METRIC_HISTOGRAMS; ++i)
+        for (b = 0; b < METRIC_BUCKETS; ++b)
+            s->histograms[i][b] = metrics.histograms[i][b];
+}
+
+static uint8_t varintLength(uint32_t v) {
+
+    uint8_t n = 1;
+
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+static uint8_t putVarint(uint8_t * out, uint32_t v) {
+
+    uint8_t n = 0;
+
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Returns the bytes read, 0 if the varint runs past end or over 32 bits */
+static uint8_t getVarint(const uint8_t * in, const uint8_t * end, uint32_t * v) {
+
+    uint8_t n = 0;
+
+    *v = 0;
+    while (in + n < end && n < 5) {
+        *v |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n++] & 0x80))
+            return n;
+    }
+    return 0;
+}
+
+/* One metric at out + *length, if it fits into size. Returns 0 if it did not. */
+static uint8_t putMetric(uint8_t * out, uint8_t * length, uint8_t size, uint8_t key,
+                         const uint32_t * values, uint8_t numValues, uint8_t histogram) {
+
+    uint16_t need = 1 + (histogram ? 1 : 0);
+    uint8_t bitmap = 0, b;
+
+    for (b = 0; b < numValues; ++b) {
+        if (values[b] == 0)
+            continue;
+        bitmap |= (uint8_t)(1 << b);
+        need += varintLength(values[b]);
+    }
+    if (bitmap == 0)
+        return 1;
+    if (*length + need > size)
+        return 0;
+
+    out[(*length)++] = key;
+    if (histogram)
+        out[(*length)++] = bitmap;
+    for (b = 0; b < numValues; ++b)
+        if (values[b] != 0)
+            *length += putVarint(out + *length, values[b]);
+    return 1;
+}
+
+uint8_t metricsEncode(const MetricsSnapshot * s, uint8_t * out, uint8_t size) {
+
+    uint8_t length = METRICS_HEADER_LENGTH, i, fits = 1;
+
+    if (size < METRICS_HEADER_LENGTH)
+        return 0;
+
+    for (i = 0; i < METRIC_COUNTERS && fits; ++i)
+        fits = putMetric(out, &length, size, METRIC_KIND_COUNTER << 6 | i, &s->counters[i], 1, 0);
+    for (i = 0; i < METRIC_GAUGES && fits; ++i)
+        fits = putMetric(out, &length, size, METRIC_KIND_GAUGE << 6 | i, &s->gauges[i], 1, 0);
+    for (i = 0; i < METRIC_HISTOGRAMS && fits; ++i)
+        fits = putMetric(out, &length, size, METRIC_KIND_HISTOGRAM << 6 | i, s->histograms[i],
+                         METRIC_BUCKETS, 1);
+
+    out[0] = METRICS_VERSION;
+    out[1] = (uint8_t)(s->flags | (fits ? 0 : METRICS_TRUNCATED));
+    out[2] = (uint8_t)(s->uptimeS >> 24);
+    out[3] = (uint8_t)(s->uptimeS >> 16);
+    out[4] = (uint8_t)(s->uptimeS >> 8);
+    out[5] = (uint8_t)s->uptimeS;
+
+    return length;
+}
+
+uint8_t metricsDecode(MetricsSnapshot * s, const uint8_t * in, uint8_t length) {
+
+    const uint8_t * end = in + length;
+    const uint8_t * p = in + METRICS_HEADER_LENGTH;
+    uint32_t v;
+    uint8_t n, b;
+
+    if (length < METRICS_HEADER_LENGTH || in[0] != METRICS_VERSION)
+        return 1;
+
+    memset(s, 0, sizeof(*s));
+    s->flags = in[1];
+    s->uptimeS = (uint32_t)in[2] << 24 | (uint32_t)in[3] << 16 | (uint32_t)in[4] << 8 | in[5];
+
+    while (p < end) {
+        uint8_t kind = *p >> 6, id = *p & 0x3F;
+        ++p;
+
+        if (kind == METRIC_KIND_HISTOGRAM) {
+            if (p == end)
+                return 1;
+            uint8_t bitmap = *p++;
+            for (b = 0; b < 8; ++b) {
+                if (!(bitmap & (1 << b)))
+                    continue;
+                if ((n = getVarint(p, end, &v)) == 0)
+                    return 1;
+                p += n;
+                if (id < METRIC_HISTOGRAMS && b < METRIC_BUCKETS)
+                    s->histograms[id][b] = v;
+            }
+            continue;
+        }
+
+        if ((n = getVarint(p, end, &v)) == 0)
+            return 1;
+        p += n;
+        if (kind == METRIC_KIND_COUNTER && id < METRIC_COUNTERS)
+            s->counters[id] = v;
+        else if (kind == METRIC_KIND_GAUGE && id < METRIC_GAUGES)
+            s->gauges[id] = v;
+    }
+
+    return 0;
+}
+
+/* Appends at out + *length while there is room */
+static void append(char * out, uint16_t * length, uint16_t size, const char * name, const char * value) {
+
+    int n = snprintf(out + *length, size - *length, "%s%s:\t%s", *length ? "\t" : "", name, value);
+
+    if (n > 0)
+        *length = (uint16_t)(*length + n < size ? *length + n : size - 1);
+}
+
+uint16_t metricsFormat(const MetricsSnapshot * s, char * out, uint16_t size) {
+
+    char value[METRIC_BUCKETS * 11];
+    uint16_t length = 0;
+    uint8_t i, b;
+
+    if (size == 0)
+        return 0;
+    out[0] = '\0';
+
+    snprintf(value, sizeof(value), "%lu%s", (unsigned long)s->uptimeS,
+             (s->flags & METRICS_TRUNCATED) ? " (truncated)" : "");
+    append(out, &length, size, "uptime", value);
+
+    for (i = 0; i < METRIC_COUNTERS; ++i)
+        if (s->counters[i] != 0) {
+            snprintf(value, sizeof(value), "%lu", (unsigned long)s->counters[i]);
+            append(out, &length, size, counterNames[i], value);
+        }
+    for (i = 0; i < METRIC_GAUGES; ++i)
+        if (s->gauges[i] != 0) {
+            snprintf(value, sizeof(value), (i == METRIC_RF_LAST_ERROR) ? "0x%04lx" : "%lu",
+                     (unsigned long)s->gauges[i]);
+            append(out, &length, size, gaugeNames[i], value);
+        }
+    for (i = 0; i < METRIC_HISTOGRAMS; ++i) {
+        uint32_t total = 0;
+        int n = 0;
+        for (b = 0; b < METRIC_BUCKETS; ++b) {
+            total += s->histograms[i][b];
+            n += snprintf(value + n, sizeof(value) - n, "%s%lu", b ? "/" : "",
+                          (unsigned long)s->histograms[i][b]);
+        }
+        if (total != 0)
+            append(out, &length, size, histogramNames[i], value);
+    }
+
+    return length;
+}
@@ -0,0 +1,131 @@
+//
+//  metrics.h
+//  Runtime metrics of both firmwares: counters, gauges and fixed bucket histograms in one
+//  static registry, and a compact binary telemetry record of a snapshot
+//
+//  The registry is a fixed set of metrics, the same on tracker and gateway; each firmware
+//  updates the ones that apply to it. Updates are an atomic add, set or max on a 32 bit
+//  word, safe from the RF callback, HWIs and tasks alike, and nothing is allocated.
+//
+//  Telemetry record, big endian:
+//
+//      byte 0      METRICS_VERSION
+//      byte 1      flags (METRICS_TRUNCATED)
+//      byte 2..5   uptime, s
+//      then, for every metric that is not zero, in id order:
+//      1 byte      kind << 6 | id (METRIC_KIND_*)
+//      counter, gauge: the value as a varint (7 bits a byte, least significant first,
+//                  high bit set on all but the last)
+//      histogram:  a bitmap of the buckets that are not zero, bucket 0 in bit 0, then
+//                  their counts as varints
+//
+//  Metrics a reader does not know are skipped, so ids can be added. A record that would not
+//  fit is cut after the last metric that does, and flagged.
+//
+
+#ifndef metrics_h
+#define metrics_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define METRICS_VERSION         1
+#define METRICS_TRUNCATED       0x01
+#define METRICS_HEADER_LENGTH   6
+
+#define METRIC_KIND_COUNTER     0
+#define METRIC_KIND_GAUGE       1
+#define METRIC_KIND_HISTOGRAM   2
+
+#define METRIC_BUCKETS          8
+
+typedef enum {
+    METRIC_RX_FRAMES,           // gateway: frames handled
+    METRIC_RX_CRC_ERRORS,       // RF core: received with a CRC error, flushed
+    METRIC_RX_IGNORED,          // RF core: ignored, longer than the RX command takes
+    METRIC_RX_OVERFLOWS,        // RF core: no RX entry free for a frame
+    METRIC_RX_REJECTED,         // gateway: bad header, not authentic or replayed
+    METRIC_SENTENCES,           // NMEA sentences or UBX frames with a good checksum
+    METRIC_BAD_SENTENCES,       // no sentence, or a checksum mismatch
+    METRIC_PARSE_ERRORS,        // checked, but the parser failed
+    METRIC_UART_ERRORS,         // tracker: UART read failed (overrun, framing)
+    METRIC_UART_DROPPED,        // tracker: line longer than any sentence
+    METRIC_TX_FRAMES,           // RF TX commands run
+    METRIC_TX_FAILED,           // TX ended other than PROP_DONE_OK (channel busy, error)
+    METRIC_RF_ERRORS,           // RF commands ended with a PROP_ERROR_* status
+    METRIC_COUNTERS
+} MetricCounter;
+
+typedef enum {
+    METRIC_RF_LAST_ERROR,       // status of the last RF command that failed
+    METRIC_RX_QUEUE_HIGH,       // most RX entries waiting for the gateway at once
+    METRIC_LOG_BACKLOG,         // tracker: fixes waiting on flash (fixLog.h)
+    METRIC_MAIN_STACK_PEAK,     // most bytes of the main task's stack ever used
+    METRIC_SYSTEM_STACK_PEAK,   // most bytes of the system stack (HWIs, SWIs, RF callbacks) used
+    METRIC_HEAP_PEAK,           // most bytes of the HeapMem heap in use when sampled
+    METRIC_GAUGES
+} MetricGauge;
+
+typedef enum {
+    METRIC_RSSI,                // dBm of frames received: < -110, -100, ... -50, >= -50
+    METRIC_FRAME_LENGTH,        // bytes of frames sent or received: < 16, 24, 32, 48, 64, 96, 128, >= 128
+    METRIC_HISTOGRAMS
+} MetricHistogram;
+
+typedef struct {
+    volatile uint32_t counters[METRIC_COUNTERS];
+    volatile uint32_t gauges[METRIC_GAUGES];
+    volatile uint32_t histograms[METRIC_HISTOGRAMS][METRIC_BUCKETS];
+} MetricsRegistry;
+
+typedef struct {
+    uint8_t   flags;
+    uint32_t  uptimeS;
+    uint32_t  counters[METRIC_COUNTERS];
+    uint32_t  gauges[METRIC_GAUGES];
+    uint32_t  histograms[METRIC_HISTOGRAMS][METRIC_BUCKETS];
+} MetricsSnapshot;
+
+// Longest record, every metric at its largest
+#define METRICS_RECORD_MAX_LENGTH \
+    (METRICS_HEADER_LENGTH + (METRIC_COUNTERS + METRIC_GAUGES) * 6 + METRIC_HISTOGRAMS * (2 + METRIC_BUCKETS * 5))
+
+extern MetricsRegistry metrics;
+
+/// All metrics back to 0.
+void metricsInit(void);
+
+/// Adds n to a counter.
+void metricAdd(uint8_t counter, uint32_t n);
+#define metricInc(counter)  metricAdd((counter), 1)
+
+/// Sets a gauge.
+void metricSet(uint8_t gauge, uint32_t value);
+
+/// Raises a gauge to value if it is lower: a high-water mark.
+void metricMax(uint8_t gauge, uint32_t value);
+
+/// Counts value into its bucket of a histogram.
+void metricObserve(uint8_t histogram, int32_t value);
+
+/// Copies the registry into s. Each metric is read at once, but they are not frozen together.
+void metricsSnapshot(MetricsSnapshot * s, uint32_t uptimeS);
+
+/// Writes the telemetry record of s into out, at most size bytes. Returns its length.
+uint8_t metricsEncode(const MetricsSnapshot * s, uint8_t * out, uint8_t size);
+
+/// Reads a telemetry record. Returns 0 on success, 1 if it is malformed or of another version.
+uint8_t metricsDecode(MetricsSnapshot * s, const uint8_t * in, uint8_t length);
+
+/// The metrics of s that are not zero as tab separated "name:\tvalue" text, a histogram's
+/// counts joined by '/'. Returns the length written, at most size - 1.
+uint16_t metricsFormat(const MetricsSnapshot * s, char * out, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* metrics_h */
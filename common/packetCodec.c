@@ -0,0 +1,53 @@
+//
+//  packetCodec.c
+//  Over-the-air frame header shared by the tracker (Tx) and gateway (Rx)
+//
+
+#include "packetCodec.h"
+
+uint8_t pktEncodeHeader(const PacketHeader * hdr, uint8_t * buf) {
+
+    buf[0] = (uint8_t)((hdr->flags << 4) | (hdr->type & 0x0F));
+    buf[1] = hdr->nodeId;
+    buf[2] = (uint8_t)(hdr->seq >> 8);
+    buf[3] = (uint8_t)(hdr->seq);
+
+    return PKT_HEADER_LENGTH;
+}
+
+uint8_t pktTrackerId(uint8_t raw) {
+
+    if (raw == PKT_GATEWAY_ID || raw == PKT_BROADCAST_ID ||
+        (raw >= PKT_RELAY_ID_FIRST && raw <= PKT_RELAY_ID_LAST))
+        raw ^= 0x5A;
+
+    return raw;
+}
+
+uint8_t pktDecodeHeader(PacketHeader * hdr, const uint8_t * buf, uint8_t length) {
+
+    if (length < PKT_HEADER_LENGTH)
+        return 1;
+
+    hdr->type   = buf[0] & 0x0F;
+    hdr->flags  = buf[0] >> 4;
+    hdr->nodeId = buf[1];
+    hdr->seq    = (uint16_t)((buf[2] << 8) | buf[3]);
+
+    switch (hdr->type) {
+
+        case PKT_TYPE_DATA:
+        case PKT_TYPE_BEACON:
+        case PKT_TYPE_JOIN:
+        case PKT_TYPE_LEAVE:
+        case PKT_TYPE_ACK:
+        case PKT_TYPE_LOG:
+        case PKT_TYPE_FIX:
+        case PKT_TYPE_TELEMETRY:
+        case PKT_TYPE_RELAY:
+            return 0;
+        default:
+            return 1;
+
+    }
+}
@@ -0,0 +1,72 @@
+//
+//  packetCodec.h
+//  Over-the-air frame header shared by the tracker (Tx) and gateway (Rx)
+//
+//  Every radio frame starts with a fixed 4 byte header:
+//
+//      byte 0      frame type (low nibble) | flags (high nibble)
+//      byte 1      node id of the sender (PKT_GATEWAY_ID for the gateway, the relay's own for
+//                  a relay); ACK frames carry the tracker they acknowledge instead
+//      byte 2..3   sequence number, big endian
+//
+//  The payload that follows depends on the frame type.
+//
+
+#ifndef packetCodec_h
+#define packetCodec_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define PKT_HEADER_LENGTH   4
+
+#define PKT_GATEWAY_ID      0x00 // reserved node id of the gateway
+#define PKT_BROADCAST_ID    0xFF // reserved, never assigned to a tracker
+#define PKT_RELAY_ID_FIRST  0xF0 // first of the ids reserved for relays (MESH_NODE_ID)
+#define PKT_RELAY_ID_LAST   0xFE // last of them
+
+// Frame types (4 bits)
+typedef enum {
+    PKT_TYPE_DATA   = 0x1,  // NMEA sentence from a tracker
+    PKT_TYPE_BEACON = 0x2,  // TDMA beacon with the slot map, from the gateway
+    PKT_TYPE_JOIN   = 0x3,  // tracker asks the gateway for a TDMA slot
+    PKT_TYPE_LEAVE  = 0x4,  // tracker gives its TDMA slot back
+    PKT_TYPE_ACK    = 0x5,  // gateway acknowledges DATA and LOG frames of one tracker (arqMac.h)
+    PKT_TYPE_LOG    = 0x6,  // batch of fixes the tracker stored while out of range (fixLog.h)
+    PKT_TYPE_FIX    = 0x7,  // GGA and RMC of one epoch merged into one fix (fixEpoch.h)
+    PKT_TYPE_TELEMETRY = 0x8,   // snapshot of the tracker's metrics (metrics.h)
+    PKT_TYPE_RELAY  = 0x9   // trackers' frames a relay carries toward the root gateway (meshRelay.h)
+} PacketType;
+
+// Flags of DATA, LOG and FIX frames
+#define PKT_FLAG_SECURE     0x1  // payload encrypted, MIC appended (secureLink.h)
+#define PKT_FLAG_EPOCH      0x2  // sealed frame announces the sender's epoch after the header
+#define PKT_FLAG_TRACK      0x4  // LOG frame: vertices of the simplified track (trackCompress.h)
+#define PKT_FLAG_FENCE      0x8  // LOG frame: one fix, then the geofence events it raised (geoFence.h)
+
+typedef struct {
+    uint8_t  type;      // PacketType
+    uint8_t  flags;     // 4 bits, meaning depends on the type
+    uint8_t  nodeId;
+    uint16_t seq;
+} PacketHeader;
+
+/// Writes the header into buf (PKT_HEADER_LENGTH bytes). Returns the number of bytes written.
+uint8_t pktEncodeHeader(const PacketHeader * hdr, uint8_t * buf);
+
+/// A tracker's node id from a raw one, such as the low byte of its factory address: the
+/// gateway, broadcast and relay ids are moved out of the way with ^ 0x5A.
+uint8_t pktTrackerId(uint8_t raw);
+
+/// Reads the header from a received frame. Returns 0 on success, 1 if the frame is too short
+/// or carries an unknown type.
+uint8_t pktDecodeHeader(PacketHeader * hdr, const uint8_t * buf, uint8_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* packetCodec_h */
@@ -0,0 +1,54 @@
+//
+//  phyProfile.c
+//  Radio PHY profiles and their airtime
+//
+
+#include "phyProfile.h"
+#include <stddef.h>
+
+const PhyProfile phyProfiles[PHY_NUM_PROFILES] = {
+    { "long-range", PHY_LONG_RANGE_BAUD, PHY_LONG_RANGE_CODING, PHY_LONG_RANGE_PREAMBLE,
+      PHY_LONG_RANGE_SENSITIVITY, PHY_LONG_RANGE_DEVIATION, PHY_LONG_RANGE_RATE_WORD,
+      PHY_LONG_RANGE_RX_BW, PHY_LONG_RANGE_FEC_MODE },
+    { "50kbps", PHY_50KBPS_BAUD, PHY_50KBPS_CODING, PHY_50KBPS_PREAMBLE,
+      PHY_50KBPS_SENSITIVITY, PHY_50KBPS_DEVIATION, PHY_50KBPS_RATE_WORD,
+      PHY_50KBPS_RX_BW, PHY_50KBPS_FEC_MODE },
+    { "high-rate", PHY_HIGH_RATE_BAUD, PHY_HIGH_RATE_CODING, PHY_HIGH_RATE_PREAMBLE,
+      PHY_HIGH_RATE_SENSITIVITY, PHY_HIGH_RATE_DEVIATION, PHY_HIGH_RATE_RATE_WORD,
+      PHY_HIGH_RATE_RX_BW, PHY_HIGH_RATE_FEC_MODE }
+};
+
+const PhyProfile * phyProfileGet(uint8_t id) {
+
+    return id < PHY_NUM_PROFILES ? &phyProfiles[id] : NULL;
+}
+
+uint32_t phyBitNs(const PhyProfile * phy) {
+
+    return PHY_BIT_NS_OF(phy->baud, phy->coding);
+}
+
+uint32_t phyAirtimeUs(const PhyProfile * phy, uint8_t length) {
+
+    return ((uint32_t)length + PHY_OVERHEAD_OF(phy->preambleLength)) * 8 * phyBitNs(phy) / 1000;
+}
+
+uint32_t phySyncUs(const PhyProfile * phy) {
+
+    return (uint32_t)PHY_SYNC_LENGTH_OF(phy->preambleLength) * 8 * phyBitNs(phy) / 1000;
+}
+
+uint32_t phySenseUs(const PhyProfile * phy) {
+
+    return PHY_SENSE_US_OF(phy->baud);
+}
+
+uint32_t phyScanUs(const PhyProfile * phy, uint8_t channels) {
+
+    return PHY_SCAN_US_OF(phy->baud, channels);
+}
+
+uint8_t phyScanPreambleLength(const PhyProfile * phy, uint8_t channels) {
+
+    return (uint8_t)PHY_SCAN_PREAMBLE_OF(phy->baud, phy->coding, phy->preambleLength, channels);
+}
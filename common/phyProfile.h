@@ -0,0 +1,168 @@
+//
+//  phyProfile.h
+//  Build-time selection of the radio PHY, shared by Tx and Rx, and its airtime
+//
+//  Tracker and gateway must be built with the same PHY_PROFILE. The profile sets the
+//  modulation fields of CMD_PROP_RADIO_DIV_SETUP in common/smartrf_settings and, through
+//  PHY_AIRTIME_US(), the default slot, backoff and ACK window lengths of the MAC layers.
+//  Slower profiles reach further, faster ones take less airtime and energy per frame.
+//
+//  Airtime counts preamble, sync word, length byte, payload and CRC at the profile's bit
+//  rate. In the long range profile every bit takes 4 symbols (FEC 1/2, DSSS 2).
+//
+//  PHY_CHANNELS > 1 spreads the frames over that many channels (channelHop.h). A gateway
+//  with one radio finds them by scanning: on each channel in turn it programs the
+//  synthesizer (PHY_FS_US) and senses the RSSI (PHY_SENSE_US, 16 symbols). Every frame
+//  then carries enough extra preamble to last one scan round, so the gateway comes
+//  around to its channel while the preamble is still on the air.
+//
+//  phyProfiles[] holds every profile, for the host benchmarks that compare them. Their
+//  preamble is the one of a single channel.
+//
+
+#ifndef phyProfile_h
+#define phyProfile_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define PHY_PROFILE_LONG_RANGE  0   // 5 kbps SimpleLink long range, 20 kBaud, 49 kHz RX bandwidth
+#define PHY_PROFILE_50KBPS      1   // 50 kbps 2-GFSK, 25 kHz deviation, 98 kHz RX bandwidth
+#define PHY_PROFILE_HIGH_RATE   2   // 100 kbps 2-GFSK, 50 kHz deviation, 247 kHz RX bandwidth
+#define PHY_NUM_PROFILES        3
+
+#ifndef PHY_PROFILE
+#define PHY_PROFILE             PHY_PROFILE_LONG_RANGE
+#endif
+
+#ifndef PHY_CHANNELS
+#define PHY_CHANNELS            1
+#endif
+
+#define PHY_SYNC_BITS           32
+#define PHY_CRC_LENGTH          2
+#define PHY_MAX_PREAMBLE_LENGTH 30      // nPreamBytes of CMD_PROP_RADIO_DIV_SETUP
+#define PHY_FS_US               250     // CMD_FS, synthesizer programmed and settled
+
+/* Radio timer (RAT) ticks, for the trigger times of RF commands: it runs at 4 MHz */
+#define RAT_US(us)              ((uint32_t)(us) * 4)
+#define RAT_MS(ms)              ((uint32_t)(ms) * 4000)
+
+/* Per profile: symbol rate in Baud, symbols per bit, preamble bytes, sensitivity in dBm at
+ * 1 % packet error rate (CC1310 datasheet), and the CMD_PROP_RADIO_DIV_SETUP fields
+ * deviation (250 Hz steps), symbolRate.rateWord (prescaler 15), rxBw and fecMode */
+#define PHY_LONG_RANGE_BAUD         20000
+#define PHY_LONG_RANGE_CODING       4
+#define PHY_LONG_RANGE_PREAMBLE     2
+#define PHY_LONG_RANGE_SENSITIVITY  -124
+#define PHY_LONG_RANGE_DEVIATION    0x14
+#define PHY_LONG_RANGE_RATE_WORD    0x3333
+#define PHY_LONG_RANGE_RX_BW        0x21
+#define PHY_LONG_RANGE_FEC_MODE     0x8     // convolutional FEC with DSSS
+
+#define PHY_50KBPS_BAUD             50000
+#define PHY_50KBPS_CODING           1
+#define PHY_50KBPS_PREAMBLE         4
+#define PHY_50KBPS_SENSITIVITY      -110
+#define PHY_50KBPS_DEVIATION        0x64
+#define PHY_50KBPS_RATE_WORD        0x8000
+#define PHY_50KBPS_RX_BW            0x24
+#define PHY_50KBPS_FEC_MODE         0x0
+
+#define PHY_HIGH_RATE_BAUD          100000
+#define PHY_HIGH_RATE_CODING        1
+#define PHY_HIGH_RATE_PREAMBLE      4
+#define PHY_HIGH_RATE_SENSITIVITY   -105
+#define PHY_HIGH_RATE_DEVIATION     0xC8
+#define PHY_HIGH_RATE_RATE_WORD     0x10000
+#define PHY_HIGH_RATE_RX_BW         0x28
+#define PHY_HIGH_RATE_FEC_MODE      0x0
+
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
+#define PHY_BAUD                PHY_LONG_RANGE_BAUD
+#define PHY_CODING              PHY_LONG_RANGE_CODING
+#define PHY_BASE_PREAMBLE       PHY_LONG_RANGE_PREAMBLE
+#define PHY_DEVIATION           PHY_LONG_RANGE_DEVIATION
+#define PHY_RATE_WORD           PHY_LONG_RANGE_RATE_WORD
+#define PHY_RX_BW               PHY_LONG_RANGE_RX_BW
+#define PHY_FEC_MODE            PHY_LONG_RANGE_FEC_MODE
+#elif PHY_PROFILE == PHY_PROFILE_50KBPS
+#define PHY_BAUD                PHY_50KBPS_BAUD
+#define PHY_CODING              PHY_50KBPS_CODING
+#define PHY_BASE_PREAMBLE       PHY_50KBPS_PREAMBLE
+#define PHY_DEVIATION           PHY_50KBPS_DEVIATION
+#define PHY_RATE_WORD           PHY_50KBPS_RATE_WORD
+#define PHY_RX_BW               PHY_50KBPS_RX_BW
+#define PHY_FEC_MODE            PHY_50KBPS_FEC_MODE
+#elif PHY_PROFILE == PHY_PROFILE_HIGH_RATE
+#define PHY_BAUD                PHY_HIGH_RATE_BAUD
+#define PHY_CODING              PHY_HIGH_RATE_CODING
+#define PHY_BASE_PREAMBLE       PHY_HIGH_RATE_PREAMBLE
+#define PHY_DEVIATION           PHY_HIGH_RATE_DEVIATION
+#define PHY_RATE_WORD           PHY_HIGH_RATE_RATE_WORD
+#define PHY_RX_BW               PHY_HIGH_RATE_RX_BW
+#define PHY_FEC_MODE            PHY_HIGH_RATE_FEC_MODE
+#else
+#error "PHY_PROFILE must be PHY_PROFILE_LONG_RANGE, PHY_PROFILE_50KBPS or PHY_PROFILE_HIGH_RATE"
+#endif
+
+/* Airtime of the profile in use, constant expressions */
+#define PHY_BIT_NS_OF(baud, coding)         (1000000000UL / (baud) * (coding))
+#define PHY_SYNC_LENGTH_OF(preamble)        ((preamble) + PHY_SYNC_BITS / 8)
+#define PHY_OVERHEAD_OF(preamble)           (PHY_SYNC_LENGTH_OF(preamble) + 1 + PHY_CRC_LENGTH)
+
+/* Channel scan of a one radio gateway, and the preamble that spans it */
+#define PHY_SENSE_US_OF(baud)               (16 * 1000000UL / (baud))
+#define PHY_SCAN_US_OF(baud, channels)      ((channels) * (PHY_FS_US + PHY_SENSE_US_OF(baud)))
+#define PHY_SCAN_PREAMBLE_OF(baud, coding, preamble, channels) \
+    ((channels) > 1 ? (preamble) + (PHY_SCAN_US_OF(baud, channels) * 1000 + 8 * PHY_BIT_NS_OF(baud, coding) - 1) \
+                                   / (8 * PHY_BIT_NS_OF(baud, coding)) : (preamble))
+
+#define PHY_BIT_NS              PHY_BIT_NS_OF(PHY_BAUD, PHY_CODING)
+#define PHY_PREAMBLE_LENGTH     PHY_SCAN_PREAMBLE_OF(PHY_BAUD, PHY_CODING, PHY_BASE_PREAMBLE, PHY_CHANNELS)
+#define PHY_SENSE_US            PHY_SENSE_US_OF(PHY_BAUD)
+#define PHY_SCAN_US             PHY_SCAN_US_OF(PHY_BAUD, PHY_CHANNELS)
+#define PHY_FRAME_OVERHEAD      PHY_OVERHEAD_OF(PHY_PREAMBLE_LENGTH)  // bytes around the payload
+/// Airtime of a frame with length bytes after the length byte (header and payload).
+#define PHY_AIRTIME_US(length)  (((uint32_t)(length) + PHY_FRAME_OVERHEAD) * 8 * PHY_BIT_NS / 1000)
+/// Preamble and sync word, after which a receiver keeps the frame.
+#define PHY_SYNC_US             ((uint32_t)PHY_SYNC_LENGTH_OF(PHY_PREAMBLE_LENGTH) * 8 * PHY_BIT_NS / 1000)
+
+#if PHY_PREAMBLE_LENGTH > PHY_MAX_PREAMBLE_LENGTH
+#error "PHY_CHANNELS: the scan takes more preamble than the radio sends at this PHY_PROFILE, use fewer channels"
+#endif
+
+typedef struct {
+    const char * name;
+    uint32_t baud;              // symbol rate
+    uint8_t  coding;            // symbols per bit
+    uint8_t  preambleLength;    // bytes
+    int8_t   sensitivityDbm;
+    uint16_t deviation;         // CMD_PROP_RADIO_DIV_SETUP fields
+    uint32_t rateWord;
+    uint8_t  rxBw;
+    uint8_t  fecMode;
+} PhyProfile;
+
+extern const PhyProfile phyProfiles[PHY_NUM_PROFILES];
+
+/// The profile with the given PHY_PROFILE_* id, NULL if there is none.
+const PhyProfile * phyProfileGet(uint8_t id);
+uint32_t phyBitNs(const PhyProfile * phy);
+/// Airtime of a frame with length bytes after the length byte, as PHY_AIRTIME_US().
+uint32_t phyAirtimeUs(const PhyProfile * phy, uint8_t length);
+uint32_t phySyncUs(const PhyProfile * phy);
+uint32_t phySenseUs(const PhyProfile * phy);
+/// One round of a gateway's scan over channels, as PHY_SCAN_US.
+uint32_t phyScanUs(const PhyProfile * phy, uint8_t channels);
+/// Preamble bytes that span that scan, as PHY_PREAMBLE_LENGTH.
+uint8_t phyScanPreambleLength(const PhyProfile * phy, uint8_t channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* phyProfile_h */
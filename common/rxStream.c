@@ -0,0 +1,160 @@
+//
+//  rxStream.c
+//  Reader of a queue of RF core partial read RX entries
+//
+
+#include "rxStream.h"
+#include <string.h>
+
+enum {
+    PACKET_IDLE,
+    PACKET_ASSEMBLING,
+    PACKET_DROPPING
+};
+
+uint8_t rxStreamDefine(RxStream * s, uint8_t * buf, uint16_t bufLength, uint8_t numEntries,
+                       uint16_t dataSize, uint8_t * assembly, uint16_t assemblySize) {
+
+    uint16_t size = (uint16_t)RX_STREAM_ENTRY_SIZE(dataSize);
+    RxStreamEntry * e = NULL;
+    uint8_t i;
+
+    if (numEntries < 2 || dataSize <= RX_STREAM_LEN_SZ || (uint32_t)numEntries * size > bufLength)
+        return 1;
+
+    memset(s, 0, sizeof(*s));
+    for (i = 0; i < numEntries; ++i) {
+        e = (RxStreamEntry *)(buf + i * size);
+        e->pNextEntry = buf + (i + 1) * size;
+        e->status     = RX_STREAM_PENDING;
+        e->config     = RX_STREAM_TYPE_PARTIAL | RX_STREAM_LEN_SZ << 2;
+        e->length     = (uint16_t)(dataSize + 4);
+        e->pktStatus  = 0;
+        e->nextIndex  = 0;
+    }
+    e->pNextEntry = buf;
+
+    s->first = (RxStreamEntry *)buf;
+    s->entry = s->first;
+    s->assembly = assembly;
+    s->assemblySize = assembly != NULL ? assemblySize : 0;
+
+    return 0;
+}
+
+uint8_t rxStreamNext(RxStream * s, RxChunk * chunk) {
+
+    for (;;) {
+        volatile RxStreamEntry * e = s->entry;
+
+        /* The status first: once finished, pktStatus no longer changes */
+        uint8_t status = e->status;
+        if (status != RX_STREAM_ACTIVE && status != RX_STREAM_FINISHED)
+            return 0;
+
+        uint16_t pktStatus = e->pktStatus;
+        uint16_t elements = pktStatus & RX_STREAM_NUM_ELEMENTS;
+
+        if (s->element < elements) {
+            uint8_t last = s->element == elements - 1;
+            if (last && (pktStatus & RX_STREAM_ENTRY_OPEN))
+                return 0;
+
+            const uint8_t * at = (const uint8_t *)e->data + s->offset;
+            chunk->length = (uint16_t)(at[0] | at[1] << 8);
+            chunk->data = at + RX_STREAM_LEN_SZ;
+            chunk->flags = 0;
+            if (s->element > 0 || !(pktStatus & RX_STREAM_FIRST_CONT))
+                chunk->flags |= RX_STREAM_FIRST;
+            if (!last || !(pktStatus & RX_STREAM_LAST_CONT))
+                chunk->flags |= RX_STREAM_LAST;
+
+            s->offset += RX_STREAM_LEN_SZ + chunk->length;
+            ++s->element;
+            return 1;
+        }
+
+        if (status != RX_STREAM_FINISHED)
+            return 0;
+
+        /* All read: back to the RF core */
+        e->status = RX_STREAM_PENDING;
+        s->entry = (RxStreamEntry *)e->pNextEntry;
+        s->offset = 0;
+        s->element = 0;
+    }
+}
+
+uint16_t rxStreamPacket(RxStream * s, const uint8_t ** packet) {
+
+    RxChunk chunk;
+    uint16_t length;
+
+    while (rxStreamNext(s, &chunk)) {
+
+        if (chunk.flags & RX_STREAM_FIRST) {
+            /* A start while assembling: the rest of that one was flushed */
+            if (s->state == PACKET_ASSEMBLING)
+                ++s->broken;
+            s->state = PACKET_IDLE;
+
+            if (chunk.flags & RX_STREAM_LAST) {
+                ++s->packets;
+                *packet = chunk.data;
+                return chunk.length;
+            }
+            s->state = PACKET_ASSEMBLING;
+            s->assembled = 0;
+        }
+        else if (s->state == PACKET_IDLE) {
+            ++s->broken;
+            s->state = PACKET_DROPPING;
+        }
+
+        if (s->state == PACKET_ASSEMBLING && s->assembled + chunk.length > s->assemblySize) {
+            ++s->tooLong;
+            s->state = PACKET_DROPPING;
+        }
+
+        if (s->state == PACKET_ASSEMBLING) {
+            memcpy(s->assembly + s->assembled, chunk.data, chunk.length);
+            s->assembled += chunk.length;
+            s->copied += chunk.length;
+        }
+
+        if (chunk.flags & RX_STREAM_LAST) {
+            uint8_t complete = s->state == PACKET_ASSEMBLING;
+            s->state = PACKET_IDLE;
+            if (complete) {
+                ++s->packets;
+                ++s->spanning;
+                length = s->assembled;
+                *packet = s->assembly;
+                return length;
+            }
+        }
+    }
+
+    return 0;
+}
+
+uint8_t * rxStreamFlush(RxStream * s) {
+
+    RxStreamEntry * e = s->first;
+
+    do {
+        e->status = RX_STREAM_PENDING;
+        e->pktStatus = 0;
+        e->nextIndex = 0;
+        e = (RxStreamEntry *)e->pNextEntry;
+    } while (e != s->first);
+
+    if (s->state == PACKET_ASSEMBLING)
+        ++s->broken;
+    s->entry = s->first;
+    s->offset = 0;
+    s->element = 0;
+    s->state = PACKET_IDLE;
+
+    return (uint8_t *)s->first;
+}
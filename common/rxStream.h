@@ -0,0 +1,114 @@
+//
+//  rxStream.h
+//  Reader of a queue of RF core partial read RX entries: packets of any length up to 255
+//  bytes streamed through a small pool of fixed size buffers
+//
+//  The RF core writes received packets one after another into the entry it is on, each as
+//  an element: a 2 byte length indicator (little endian, the bytes that follow in this
+//  entry), then the packet as configured (length byte, payload, appended status byte).
+//  When an entry is full, the element is closed with bLastCont, the entry is finished and
+//  the packet goes on as the first element of the next entry, marked bFirstCont. A packet
+//  then needs no entry of its own size, and short packets share an entry.
+//
+//  The reader hands out the closed elements of the entry it is on, finished or still being
+//  filled, as chunks marked as first and last of their packet, and gives an entry back to
+//  the RF core once it has read all of a finished one. rxStreamPacket() does the same per
+//  packet: in place when the packet lies in one entry, copied into the assembly buffer
+//  when it spans entries.
+//
+//  RxStreamEntry has the layout of the RF core's rfc_dataEntryPartial_t (RFQueue.c checks
+//  it), so the reader builds and runs on the host against a model of the RF core.
+//
+
+#ifndef rxStream_h
+#define rxStream_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Entry status, as DATA_ENTRY_* of rf_data_entry.h
+#define RX_STREAM_PENDING       0
+#define RX_STREAM_ACTIVE        1
+#define RX_STREAM_BUSY          2
+#define RX_STREAM_FINISHED      3
+
+#define RX_STREAM_TYPE_PARTIAL  3       // DATA_ENTRY_TYPE_PARTIAL
+#define RX_STREAM_LEN_SZ        2       // bytes of the length indicator of an element
+
+// pktStatus of an entry
+#define RX_STREAM_NUM_ELEMENTS  0x1FFF
+#define RX_STREAM_ENTRY_OPEN    0x2000  // the last element is still being written
+#define RX_STREAM_FIRST_CONT    0x4000  // the first element continues the previous entry's last
+#define RX_STREAM_LAST_CONT     0x8000  // the last element goes on in the next entry
+
+// Chunk flags
+#define RX_STREAM_FIRST         0x01
+#define RX_STREAM_LAST          0x02
+
+typedef struct {
+    uint8_t * pNextEntry;
+    uint8_t   status;
+    uint8_t   config;           // type | lenSz << 2 | irqIntv << 4
+    uint16_t  length;           // of pktStatus, nextIndex and data
+    uint16_t  pktStatus;
+    uint16_t  nextIndex;        // in data, of the next byte the RF core writes
+    uint8_t   data[];
+} RxStreamEntry;
+
+// Entries are aligned to a pointer, 4 bytes on the RF core
+#define RX_STREAM_ALIGN                 sizeof(uint8_t *)
+#define RX_STREAM_ENTRY_SIZE(dataSize) \
+    ((offsetof(RxStreamEntry, data) + (dataSize) + RX_STREAM_ALIGN - 1) / RX_STREAM_ALIGN * RX_STREAM_ALIGN)
+#define RX_STREAM_BUFFER_SIZE(numEntries, dataSize)     ((numEntries) * RX_STREAM_ENTRY_SIZE(dataSize))
+
+typedef struct {
+    const uint8_t * data;
+    uint16_t        length;
+    uint8_t         flags;      // RX_STREAM_FIRST | RX_STREAM_LAST
+} RxChunk;
+
+typedef struct {
+    RxStreamEntry * first;
+    RxStreamEntry * entry;      // being read
+    uint16_t  offset;           // in entry->data, of the next element
+    uint16_t  element;          // elements of entry read
+    /* Packets spanning entries */
+    uint8_t * assembly;
+    uint16_t  assemblySize;
+    uint16_t  assembled;
+    uint8_t   state;
+    /* Statistics */
+    uint32_t  packets;
+    uint32_t  spanning;         // copied into the assembly buffer
+    uint32_t  copied;           // bytes
+    uint32_t  tooLong;          // for the assembly buffer, dropped
+    uint32_t  broken;           // continuations without their start, dropped
+} RxStream;
+
+/// Lays numEntries entries of dataSize data bytes out in buf (aligned to RX_STREAM_ALIGN,
+/// RX_STREAM_BUFFER_SIZE bytes), in a ring, all pending. assembly may be NULL if only
+/// rxStreamNext() is used. Returns 0 on success, 1 if buf is too small.
+uint8_t rxStreamDefine(RxStream * s, uint8_t * buf, uint16_t bufLength, uint8_t numEntries,
+                       uint16_t dataSize, uint8_t * assembly, uint16_t assemblySize);
+
+/// Next closed element. Returns 1 with it in chunk, 0 if there is none yet. The chunk stays
+/// valid until the next call.
+uint8_t rxStreamNext(RxStream * s, RxChunk * chunk);
+
+/// Next whole packet, as the RF core wrote it without the length indicator. Returns its
+/// length with it in packet, 0 if none is complete yet. It stays valid until the next call.
+uint16_t rxStreamPacket(RxStream * s, const uint8_t ** packet);
+
+/// After the RF core ran out of entries (PROP_ERROR_RXFULL): everything received is
+/// dropped and all entries are pending again. Returns the entry the RF core starts at.
+uint8_t * rxStreamFlush(RxStream * s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* rxStream_h */
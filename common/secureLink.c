@@ -0,0 +1,269 @@
+//
+//  secureLink.c
+//  Authenticated encryption of tracker frames with AES-CCM and replay protection
+//
+
+#include "secureLink.h"
+#include "packetCodec.h"
+#include <string.h>
+
+static void buildNonce(uint8_t * nonce, uint8_t nodeId, uint16_t epoch, uint16_t seq) {
+
+    memset(nonce, 0, SECURE_NONCE_LENGTH);
+    nonce[0] = nodeId;
+    nonce[1] = (uint8_t)(epoch >> 8);
+    nonce[2] = (uint8_t)(epoch);
+    nonce[3] = (uint8_t)(seq >> 8);
+    nonce[4] = (uint8_t)(seq);
+}
+
+/***** Self test *****/
+
+typedef struct {
+    uint8_t nonceLength;
+    uint8_t aadLength;
+    uint8_t length;
+    uint8_t micLength;
+    uint8_t nonce[13];
+    uint8_t aad[20];
+    uint8_t plain[24];
+    uint8_t sealed[32];     // ciphertext followed by the MIC
+} CcmVector;
+
+/* NIST SP 800-38C, appendix C, examples 1 to 3 */
+static const uint8_t testKey[SECURE_KEY_LENGTH] = {
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f
+};
+
+static const CcmVector testVectors[] = {
+    { 7, 8, 4, 4,
+      { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16 },
+      { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 },
+      { 0x20, 0x21, 0x22, 0x23 },
+      { 0x71, 0x62, 0x01, 0x5b, 0x4d, 0xac, 0x25, 0x5d } },
+    { 8, 16, 16, 6,
+      { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17 },
+      { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+      { 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f },
+      { 0xd2, 0xa1, 0xf0, 0xe0, 0x51, 0xea, 0x5f, 0x62, 0x08, 0x1a, 0x77, 0x92, 0x07, 0x3d, 0x59, 0x3d,
+        0x1f, 0xc6, 0x4f, 0xbf, 0xac, 0xcd } },
+    { 12, 20, 24, 8,
+      { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b },
+      { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13 },
+      { 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+        0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37 },
+      { 0xe3, 0xb2, 0x01, 0xa9, 0xf5, 0xb7, 0x1a, 0x7a, 0x9b, 0x1c, 0xea, 0xec, 0xcd, 0x97, 0xe7, 0x0b,
+        0x61, 0x76, 0xaa, 0xd9, 0xa4, 0x42, 0x8a, 0xa5, 0x48, 0x43, 0x92, 0xfb, 0xc1, 0xb0, 0x99, 0x51 } },
+};
+
+uint8_t secureSelfTest(const SecureCipher * cipher) {
+
+    uint8_t data[24];
+    uint8_t mic[8];
+    uint8_t i;
+
+    if (cipher->setKey(cipher->ctx, testKey))
+        return 1;
+
+    for (i = 0; i < sizeof(testVectors) / sizeof(testVectors[0]); ++i) {
+
+        const CcmVector * v = &testVectors[i];
+
+        memcpy(data, v->plain, v->length);
+        if (cipher->encrypt(cipher->ctx, v->nonce, v->nonceLength, v->aad, v->aadLength,
+                            data, v->length, mic, v->micLength) ||
+            memcmp(data, v->sealed, v->length) || memcmp(mic, v->sealed + v->length, v->micLength))
+            return 1;
+
+        if (cipher->decrypt(cipher->ctx, v->nonce, v->nonceLength, v->aad, v->aadLength,
+                            data, v->length, mic, v->micLength) ||
+            memcmp(data, v->plain, v->length))
+            return 1;
+
+        /* A flipped MIC bit must not pass */
+        memcpy(data, v->sealed, v->length);
+        mic[0] ^= 0x01;
+        if (cipher->decrypt(cipher->ctx, v->nonce, v->nonceLength, v->aad, v->aadLength,
+                            data, v->length, mic, v->micLength) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/***** Tracker *****/
+
+uint8_t secureNodeInit(SecureNode * node, const SecureCipher * cipher, const uint8_t * key, uint16_t epoch) {
+
+    memset(node, 0, sizeof(*node));
+    node->cipher = cipher;
+    node->epoch = epoch;
+    node->announce = SECURE_EPOCH_ANNOUNCE;
+
+    return cipher->setKey(cipher->ctx, key);
+}
+
+uint8_t secureSeal(SecureNode * node, uint8_t * buf, uint8_t length, uint8_t maxLength) {
+
+    PacketHeader hdr;
+
+    if (pktDecodeHeader(&hdr, buf, length))
+        return 0;
+
+    /* The sequence number wrapped or restarted: a new epoch keeps the counter unique */
+    if (node->sealedAny && hdr.seq <= node->lastSeq) {
+        if (node->epoch == 0xFFFF)
+            return 0;
+        ++node->epoch;
+        node->announce = SECURE_EPOCH_ANNOUNCE;
+    }
+
+    node->lastSeq = hdr.seq;
+    node->sealedAny = 1;
+
+    uint8_t withEpoch = 0;
+    if (node->announce > 0) {
+        --node->announce;
+        withEpoch = 1;
+    }
+    else if (++node->sinceAnnounce >= SECURE_EPOCH_INTERVAL) {
+        withEpoch = 1;
+    }
+
+    uint8_t aadLength = PKT_HEADER_LENGTH + (withEpoch ? SECURE_EPOCH_LENGTH : 0);
+    uint8_t payloadLength = length - PKT_HEADER_LENGTH;
+
+    if ((uint16_t)aadLength + payloadLength + SECURE_MIC_LENGTH > maxLength)
+        return 0;
+
+    if (withEpoch) {
+        node->sinceAnnounce = 0;
+        memmove(buf + aadLength, buf + PKT_HEADER_LENGTH, payloadLength);
+        buf[PKT_HEADER_LENGTH]     = (uint8_t)(node->epoch >> 8);
+        buf[PKT_HEADER_LENGTH + 1] = (uint8_t)(node->epoch);
+    }
+
+    hdr.flags |= PKT_FLAG_SECURE | (withEpoch ? PKT_FLAG_EPOCH : 0);
+    pktEncodeHeader(&hdr, buf);
+
+    uint8_t nonce[SECURE_NONCE_LENGTH];
+    buildNonce(nonce, hdr.nodeId, node->epoch, hdr.seq);
+
+    if (node->cipher->encrypt(node->cipher->ctx, nonce, SECURE_NONCE_LENGTH, buf, aadLength,
+                              buf + aadLength, payloadLength, buf + aadLength + payloadLength,
+                              SECURE_MIC_LENGTH))
+        return 0;
+
+    return aadLength + payloadLength + SECURE_MIC_LENGTH;
+}
+
+/***** Gateway *****/
+
+uint8_t secureGatewayInit(SecureGateway * gw, const SecureCipher * cipher, const uint8_t * key) {
+
+    memset(gw, 0, sizeof(*gw));
+    gw->cipher = cipher;
+
+    return cipher->setKey(cipher->ctx, key);
+}
+
+static SecurePeer * secureGatewayFind(const SecureGateway * gw, uint8_t nodeId) {
+
+    uint8_t i;
+    for (i = 0; i < SECURE_MAX_PEERS; ++i) {
+        if (gw->peer[i].nodeId == nodeId)
+            return (SecurePeer *)&gw->peer[i];
+    }
+
+    return NULL;
+}
+
+static SecureStatus reject(SecureGateway * gw) {
+
+    ++gw->rejected;
+    return SECURE_REJECTED;
+}
+
+SecureStatus secureOpen(SecureGateway * gw, uint8_t * buf, uint8_t * length) {
+
+    PacketHeader hdr;
+
+    if (pktDecodeHeader(&hdr, buf, *length) || !(hdr.flags & PKT_FLAG_SECURE) ||
+        hdr.nodeId == PKT_GATEWAY_ID)
+        return reject(gw);
+
+    uint8_t aadLength = PKT_HEADER_LENGTH + ((hdr.flags & PKT_FLAG_EPOCH) ? SECURE_EPOCH_LENGTH : 0);
+
+    if (*length < aadLength + SECURE_MIC_LENGTH)
+        return reject(gw);
+
+    SecurePeer * p = secureGatewayFind(gw, hdr.nodeId);
+    uint16_t epoch;
+
+    if (hdr.flags & PKT_FLAG_EPOCH)
+        epoch = (uint16_t)((buf[PKT_HEADER_LENGTH] << 8) | buf[PKT_HEADER_LENGTH + 1]);
+    else if (p != NULL)
+        epoch = (uint16_t)(p->highest >> 16);
+    else
+        return reject(gw);
+
+    uint32_t counter = ((uint32_t)epoch << 16) | hdr.seq;
+
+    /* Too old to tell a retransmission from a replay; also spares the cipher */
+    if (p != NULL && counter < p->highest && p->highest - counter >= SECURE_REPLAY_WINDOW)
+        return reject(gw);
+
+    /* A peer that lost its entry comes back with a newer frame only */
+    if (p == NULL && gw->forgotten[hdr.nodeId] != 0 && counter <= gw->forgotten[hdr.nodeId])
+        return reject(gw);
+
+    uint8_t payloadLength = *length - aadLength - SECURE_MIC_LENGTH;
+    uint8_t nonce[SECURE_NONCE_LENGTH];
+    buildNonce(nonce, hdr.nodeId, epoch, hdr.seq);
+
+    if (gw->cipher->decrypt(gw->cipher->ctx, nonce, SECURE_NONCE_LENGTH, buf, aadLength,
+                            buf + aadLength, payloadLength, buf + aadLength + payloadLength,
+                            SECURE_MIC_LENGTH))
+        return reject(gw);
+
+    /* Authentic: only now does the frame move the replay window */
+    SecureStatus status = SECURE_NEW;
+
+    if (p == NULL) {
+        p = secureGatewayFind(gw, PKT_GATEWAY_ID);
+        if (p == NULL) {
+            p = &gw->peer[gw->nextVictim];
+            gw->nextVictim = (gw->nextVictim + 1) % SECURE_MAX_PEERS;
+            gw->forgotten[p->nodeId] = p->highest;
+        }
+        p->nodeId = hdr.nodeId;
+        p->highest = counter;
+        p->window = 1;
+
+        /* What it had when it was forgotten counts as seen */
+        uint32_t behind = counter - gw->forgotten[hdr.nodeId];
+        if (gw->forgotten[hdr.nodeId] != 0 && behind < SECURE_REPLAY_WINDOW)
+            p->window |= 0xFFFFFFFFu << behind;
+    }
+    else if (counter > p->highest) {
+        uint32_t shift = counter - p->highest;
+        p->window = shift >= SECURE_REPLAY_WINDOW ? 1 : (p->window << shift) | 1;
+        p->highest = counter;
+    }
+    else {
+        uint32_t bit = 1u << (p->highest - counter);
+        if (p->window & bit) {
+            ++gw->duplicates;
+            status = SECURE_DUPLICATE;
+        }
+        p->window |= bit;
+    }
+
+    /* Back to the plain frame */
+    buf[0] &= (uint8_t)~((PKT_FLAG_SECURE | PKT_FLAG_EPOCH) << 4);
+    memmove(buf + PKT_HEADER_LENGTH, buf + aadLength, payloadLength);
+    *length = PKT_HEADER_LENGTH + payloadLength;
+
+    return status;
+}
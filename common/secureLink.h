@@ -0,0 +1,127 @@
+//
+//  secureLink.h
+//  Authenticated encryption of tracker frames with AES-CCM and replay protection
+//
+//  A sealed frame keeps its header in the clear and sets PKT_FLAG_SECURE:
+//
+//      byte 0..3   header (PacketHeader)
+//      byte 4..5   epoch, big endian, only if PKT_FLAG_EPOCH is set
+//      ...         payload, encrypted
+//      last 4      MIC (SECURE_MIC_LENGTH)
+//
+//  Header and epoch are authenticated as associated data. The 13 byte nonce is never sent:
+//
+//      byte 0      node id
+//      byte 1..2   epoch
+//      byte 3..4   sequence number from the header
+//      byte 5..12  0
+//
+//  Epoch and sequence number together form a 32 bit frame counter that must never repeat
+//  under one key. The tracker keeps the epoch in non-volatile memory, advances it on every
+//  boot and when the sequence number wraps, and announces it on the first
+//  SECURE_EPOCH_ANNOUNCE frames after a change and on every SECURE_EPOCH_INTERVAL-th frame
+//  after that. The gateway learns a tracker's epoch from those frames and accepts a counter
+//  once, within a SECURE_REPLAY_WINDOW sliding window. Retransmissions of a counter it
+//  already has come back as SECURE_DUPLICATE so they can still be acknowledged.
+//
+//  Windows are kept for SECURE_MAX_PEERS trackers. A tracker whose window goes to another
+//  leaves its newest counter behind, and only newer frames bring it back. What a gateway
+//  knows is lost when it restarts, though: until a tracker's next frame, the gateway takes
+//  any recorded frame of it that carries an epoch, of an old epoch too, and the frames
+//  within SECURE_REPLAY_WINDOW after it. Counters in RAM cannot tell that apart from a
+//  tracker that booted while the gateway was down.
+//
+//  The AES-CCM engine is reached through SecureCipher: the crypto core on the CC1310,
+//  a software stand-in on the host.
+//
+
+#ifndef secureLink_h
+#define secureLink_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SECURE_KEY_LENGTH       16
+#define SECURE_NONCE_LENGTH     13
+#define SECURE_MIC_LENGTH       4
+#define SECURE_EPOCH_LENGTH     2
+#define SECURE_MAX_OVERHEAD     (SECURE_EPOCH_LENGTH + SECURE_MIC_LENGTH)
+
+#define SECURE_EPOCH_ANNOUNCE   4       // frames that carry a new epoch
+#define SECURE_EPOCH_INTERVAL   16      // then every 16th frame, for gateways that restarted
+#define SECURE_REPLAY_WINDOW    32
+#define SECURE_MAX_PEERS        32      // trackers the gateway keeps a replay window for
+
+typedef enum {
+    SECURE_NEW = 0,         // authentic, first time seen
+    SECURE_DUPLICATE,       // authentic, counter already seen
+    SECURE_REJECTED         // MIC wrong, unknown epoch or counter too old
+} SecureStatus;
+
+/// AES-CCM engine. data is encrypted and decrypted in place; decrypt returns 0 only if the
+/// MIC matches. All functions return 0 on success.
+typedef struct {
+    void * ctx;
+    uint8_t (*setKey)(void * ctx, const uint8_t * key);
+    uint8_t (*encrypt)(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                       const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                       uint8_t * mic, uint8_t micLength);
+    uint8_t (*decrypt)(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                       const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                       const uint8_t * mic, uint8_t micLength);
+} SecureCipher;
+
+typedef struct {
+    const SecureCipher * cipher;
+    uint16_t epoch;
+    uint16_t lastSeq;
+    uint8_t  sealedAny;     // lastSeq is valid
+    uint8_t  announce;      // frames left that carry the epoch
+    uint8_t  sinceAnnounce;
+} SecureNode;
+
+typedef struct {
+    uint8_t  nodeId;        // PKT_GATEWAY_ID if the entry is free
+    uint32_t highest;       // epoch << 16 | seq of the newest authentic frame
+    uint32_t window;        // bit i set if highest - i was received
+} SecurePeer;
+
+typedef struct {
+    const SecureCipher * cipher;
+    SecurePeer peer[SECURE_MAX_PEERS];
+    uint8_t    nextVictim;
+    uint32_t   forgotten[256];  // by node id: highest of a peer whose entry was taken, 0 if none
+    uint32_t   rejected;
+    uint32_t   duplicates;
+} SecureGateway;
+
+/// Runs the NIST SP 800-38C CCM examples through the cipher. Returns 0 if all match.
+/// Leaves the test key loaded.
+uint8_t secureSelfTest(const SecureCipher * cipher);
+
+/* Tracker */
+
+/// epoch must be larger than any epoch used with this key before, see above.
+uint8_t secureNodeInit(SecureNode * node, const SecureCipher * cipher, const uint8_t * key, uint16_t epoch);
+
+/// Seals the plain frame in buf (header included) in place. Returns the sealed length, 0 if
+/// it does not fit into maxLength, the cipher fails or the key ran out of epochs. Check
+/// node->epoch afterwards: if it changed, it must be stored before the next boot.
+uint8_t secureSeal(SecureNode * node, uint8_t * buf, uint8_t length, uint8_t maxLength);
+
+/* Gateway */
+
+uint8_t secureGatewayInit(SecureGateway * gw, const SecureCipher * cipher, const uint8_t * key);
+
+/// Verifies and decrypts a sealed frame in place. Unless the frame is rejected, buf then
+/// holds the plain frame (flags cleared, epoch and MIC removed) and *length its length.
+SecureStatus secureOpen(SecureGateway * gw, uint8_t * buf, uint8_t * length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* secureLink_h */
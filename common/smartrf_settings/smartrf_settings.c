@@ -3,6 +3,15 @@
 // The applied template is compatible with CC13x0 SDK version 2.10.xx.xx or newer.
 // Device: CC1310 Rev. B (2.1). 
 //
+// Shared by tracker and gateway. The modulation is the one of PHY_PROFILE
+// (phyProfile.h): the SimpleLink long range export below, or the 2-GFSK profiles
+// with the generic FSK patches and overrides. Paste a new SmartRF Studio export
+// into the block of its profile, and its modulation fields into phyProfile.h.
+//
+// With MAC_ADR a second RF client sends and receives the slots at the 2-GFSK profiles
+// above PHY_PROFILE: RF_propFast, pOverridesFast and RF_cmdPropRadioDivSetupFast, whose
+// modulation fields the firmware sets from phyProfiles[] when the rate changes.
+//
 //*********************************************************************************
 
 
@@ -13,39 +22,57 @@
 // RX Address Mode: No address check 
 // Frequency: 433.92032 MHz
 // Data Format: Serial mode disable 
-// Deviation: 5.000 kHz
+// Deviation, Symbol Rate, RX Filter BW: see phyProfile.h
 // Packet Length Config: Variable 
 // Max Packet Length: 255 
 // Packet Length: 20 
 // Packet Data: 255 
-// RX Filter BW: 49 kHz
-// Symbol Rate: 19.99969 kBaud
 // Sync Word Length: 32 Bits 
 // TX Power: 15 dBm (requires define CCFG_FORCE_VDDR_HH = 1 in ccfg.c, see CC13xx/CC26xx Technical Reference Manual)
 // Whitening: CC1101/CC2500 compatible 
 
 #include "smartrf_settings.h"
+#include "macConfig.h"
+#include "phyProfile.h"
 
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
 #include DeviceFamily_constructPath(rf_patches/rf_patch_cpe_sl_longrange.h)
 #include DeviceFamily_constructPath(rf_patches/rf_patch_rfe_sl_longrange.h)
 #include DeviceFamily_constructPath(rf_patches/rf_patch_mce_sl_longrange.h)
+#endif
+#if PHY_PROFILE != PHY_PROFILE_LONG_RANGE || MAC_ADR
+#include DeviceFamily_constructPath(rf_patches/rf_patch_cpe_genfsk.h)
+#include DeviceFamily_constructPath(rf_patches/rf_patch_rfe_genfsk.h)
+#endif
 
 // TI-RTOS RF Mode Object
 RF_Mode RF_prop =
 {
     .rfMode = RF_MODE_PROPRIETARY_SUB_1,
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
     .cpePatchFxn = &rf_patch_cpe_sl_longrange,
     .mcePatchFxn = &rf_patch_mce_sl_longrange,
     .rfePatchFxn = &rf_patch_rfe_sl_longrange
+#else
+    .cpePatchFxn = &rf_patch_cpe_genfsk,
+    .mcePatchFxn = 0,
+    .rfePatchFxn = &rf_patch_rfe_genfsk
+#endif
 };
 
 
 // Overrides for CMD_PROP_RADIO_DIV_SETUP
 uint32_t pOverrides[] =
 {
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
     // override_use_patch_simplelink_long_range.xml
     // PHY: Use MCE RAM patch, RFE RAM patch
     MCE_RFE_OVERRIDE(1,0,0,1,0,0),
+#else
+    // override_use_patch_prop_genfsk.xml
+    // PHY: Use MCE ROM bank 4, RFE RAM patch
+    MCE_RFE_OVERRIDE(0,4,0,1,0,0),
+#endif
     // override_synth_prop_430_510_div10_lbw60k.xml
     // Synth: Set recommended RTRIM to 7
     HW_REG_OVERRIDE(0x4038,0x0037),
@@ -59,12 +86,19 @@ uint32_t pOverrides[] =
     (uint32_t)0xB1070503,
     // Synth: Configure fine calibration setting
     (uint32_t)0x05330523,
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
     // Synth: Set loop bandwidth after lock to 60 kHz
     (uint32_t)0x40410583,
     // Synth: Set loop bandwidth after lock to 60 kHz
     (uint32_t)0x32CC0603,
     // Synth: Set loop bandwidth after lock to 60 kHz
     (uint32_t)0x00010623,
+#else
+    // Synth: Set loop bandwidth after lock to 20 kHz
+    (uint32_t)0x0A480583,
+    // Synth: Set loop bandwidth after lock to 20 kHz
+    (uint32_t)0x7AB80603,
+#endif
     // Synth: Configure VCO LDO (in ADI1, set VCOLDOCFG=0x9F to use voltage input reference)
     ADI_REG_OVERRIDE(1,4,0x9F),
     // Synth: Configure synth LDO (in ADI1, set SLDOCTL0.COMP_CAP=1)
@@ -88,6 +122,7 @@ uint32_t pOverrides[] =
     (uint32_t)0x00038883,
     // Rx: Freeze RSSI on sync found event
     HW_REG_OVERRIDE(0x6084,0x35F1),
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
     // override_phy_gfsk_pa_ramp_agc_reflevel_0x16.xml
     // Tx: Configure PA ramping setting (0x41). Rx: Set AGC reference level to 0x16.
     HW_REG_OVERRIDE(0x6088,0x4116),
@@ -96,6 +131,13 @@ uint32_t pOverrides[] =
     // override_phy_long_range_dsss2.xml
     // PHY: Configure DSSS SF=2
     HW_REG_OVERRIDE(0x505C,0x0100),
+#else
+    // override_phy_gfsk_pa_ramp_agc_reflevel_0x1a.xml
+    // Tx: Configure PA ramping setting (0x41). Rx: Set AGC reference level to 0x1A.
+    HW_REG_OVERRIDE(0x6088,0x411A),
+    // Tx: Configure PA ramping setting
+    HW_REG_OVERRIDE(0x608C,0x8213),
+#endif
     // override_phy_rx_rssi_offset_neg2db.xml
     // Rx: Set RSSI offset to adjust reported RSSI by -2 dB (default: 0), trimmed for external bias and differential configuration
     (uint32_t)0x000288A3,
@@ -121,17 +163,17 @@ rfc_CMD_PROP_RADIO_DIV_SETUP_t RF_cmdPropRadioDivSetup =
     .condition.rule = 0x1,
     .condition.nSkip = 0x0,
     .modulation.modType = 0x1,
-    .modulation.deviation = 0x14,
+    .modulation.deviation = PHY_DEVIATION,
     .symbolRate.preScale = 0xF,
-    .symbolRate.rateWord = 0x3333,
+    .symbolRate.rateWord = PHY_RATE_WORD,
     .symbolRate.decimMode = 0x0,
-    .rxBw = 0x21,
-    .preamConf.nPreamBytes = 0x2,
+    .rxBw = PHY_RX_BW,
+    .preamConf.nPreamBytes = PHY_PREAMBLE_LENGTH,
     .preamConf.preamMode = 0x0,
-    .formatConf.nSwBits = 0x20,
+    .formatConf.nSwBits = PHY_SYNC_BITS,
     .formatConf.bBitReversal = 0x0,
     .formatConf.bMsbFirst = 0x0,
-    .formatConf.fecMode = 0x8,
+    .formatConf.fecMode = PHY_FEC_MODE,
     .formatConf.whitenMode = 0x1,
     .config.frontEndMode = 0x0,
     .config.biasMode = 0x1,
@@ -145,6 +187,117 @@ rfc_CMD_PROP_RADIO_DIV_SETUP_t RF_cmdPropRadioDivSetup =
 };
 
 
+#if MAC_ADR
+// TI-RTOS RF Mode Object of the faster profiles
+RF_Mode RF_propFast =
+{
+    .rfMode = RF_MODE_PROPRIETARY_SUB_1,
+    .cpePatchFxn = &rf_patch_cpe_genfsk,
+    .mcePatchFxn = 0,
+    .rfePatchFxn = &rf_patch_rfe_genfsk
+};
+
+
+// Overrides for CMD_PROP_RADIO_DIV_SETUP of the faster profiles
+uint32_t pOverridesFast[] =
+{
+    // override_use_patch_prop_genfsk.xml
+    // PHY: Use MCE ROM bank 4, RFE RAM patch
+    MCE_RFE_OVERRIDE(0,4,0,1,0,0),
+    // override_synth_prop_430_510_div10.xml
+    // Synth: Set recommended RTRIM to 7
+    HW_REG_OVERRIDE(0x4038,0x0037),
+    // Synth: Set Fref to 4 MHz
+    (uint32_t)0x000684A3,
+    // Synth: Configure fine calibration setting
+    HW_REG_OVERRIDE(0x4020,0x7F00),
+    // Synth: Configure fine calibration setting
+    HW_REG_OVERRIDE(0x4064,0x0040),
+    // Synth: Configure fine calibration setting
+    (uint32_t)0xB1070503,
+    // Synth: Configure fine calibration setting
+    (uint32_t)0x05330523,
+    // Synth: Set loop bandwidth after lock to 20 kHz
+    (uint32_t)0x0A480583,
+    // Synth: Set loop bandwidth after lock to 20 kHz
+    (uint32_t)0x7AB80603,
+    // Synth: Configure VCO LDO (in ADI1, set VCOLDOCFG=0x9F to use voltage input reference)
+    ADI_REG_OVERRIDE(1,4,0x9F),
+    // Synth: Configure synth LDO (in ADI1, set SLDOCTL0.COMP_CAP=1)
+    ADI_HALFREG_OVERRIDE(1,7,0x4,0x4),
+    // Synth: Use 24 MHz XOSC as synth clock, enable extra PLL filtering
+    (uint32_t)0x02010403,
+    // Synth: Configure extra PLL filtering
+    (uint32_t)0x00108463,
+    // Synth: Increase synth programming timeout (0x04B0 RAT ticks = 300 us)
+    (uint32_t)0x04B00243,
+    // override_synth_disable_bias_div10.xml
+    // Synth: Set divider bias to disabled
+    HW32_ARRAY_OVERRIDE(0x405C,1),
+    // Synth: Set divider bias to disabled (specific for loDivider=10)
+    (uint32_t)0x18000280,
+    // override_phy_rx_aaf_bw_0xd.xml
+    // Rx: Set anti-aliasing filter bandwidth to 0xD (in ADI0, set IFAMPCTL3[7:4]=0xD)
+    ADI_HALFREG_OVERRIDE(0,61,0xF,0xD),
+    // override_phy_gfsk_rx.xml
+    // Rx: Set LNA bias current trim offset to 3
+    (uint32_t)0x00038883,
+    // Rx: Freeze RSSI on sync found event
+    HW_REG_OVERRIDE(0x6084,0x35F1),
+    // override_phy_gfsk_pa_ramp_agc_reflevel_0x1a.xml
+    // Tx: Configure PA ramping setting (0x41). Rx: Set AGC reference level to 0x1A.
+    HW_REG_OVERRIDE(0x6088,0x411A),
+    // Tx: Configure PA ramping setting
+    HW_REG_OVERRIDE(0x608C,0x8213),
+    // override_phy_rx_rssi_offset_neg2db.xml
+    // Rx: Set RSSI offset to adjust reported RSSI by -2 dB (default: 0), trimmed for external bias and differential configuration
+    (uint32_t)0x000288A3,
+    // TX power override
+    // Tx: Set PA trim to max (in ADI0, set PACTL0=0xF8)
+    ADI_REG_OVERRIDE(0,12,0xF8),
+    (uint32_t)0xFFFFFFFF
+};
+
+
+// CMD_PROP_RADIO_DIV_SETUP of the faster profiles, 50 kbps until the firmware sets another
+rfc_CMD_PROP_RADIO_DIV_SETUP_t RF_cmdPropRadioDivSetupFast =
+{
+    .commandNo = 0x3807,
+    .status = 0x0000,
+    .pNextOp = 0, // INSERT APPLICABLE POINTER: (uint8_t*)&xxx
+    .startTime = 0x00000000,
+    .startTrigger.triggerType = 0x0,
+    .startTrigger.bEnaCmd = 0x0,
+    .startTrigger.triggerNo = 0x0,
+    .startTrigger.pastTrig = 0x0,
+    .condition.rule = 0x1,
+    .condition.nSkip = 0x0,
+    .modulation.modType = 0x1,
+    .modulation.deviation = PHY_50KBPS_DEVIATION,
+    .symbolRate.preScale = 0xF,
+    .symbolRate.rateWord = PHY_50KBPS_RATE_WORD,
+    .symbolRate.decimMode = 0x0,
+    .rxBw = PHY_50KBPS_RX_BW,
+    .preamConf.nPreamBytes = PHY_50KBPS_PREAMBLE,
+    .preamConf.preamMode = 0x0,
+    .formatConf.nSwBits = PHY_SYNC_BITS,
+    .formatConf.bBitReversal = 0x0,
+    .formatConf.bMsbFirst = 0x0,
+    .formatConf.fecMode = PHY_50KBPS_FEC_MODE,
+    .formatConf.whitenMode = 0x1,
+    .config.frontEndMode = 0x0,
+    .config.biasMode = 0x1,
+    .config.analogCfgMode = 0x0,
+    .config.bNoFsPowerUp = 0x0,
+    .txPower = 0x913F,
+    .pRegOverride = pOverridesFast,
+    .centerFreq = 0x01B1,
+    .intFreq = 0x8000,
+    .loDivider = 0x0A
+};
+#endif
+
+
 // CMD_FS
 // Frequency Synthesizer Programming Command
 rfc_CMD_FS_t RF_cmdFs =
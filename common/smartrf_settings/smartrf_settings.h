@@ -26,4 +26,9 @@ extern rfc_CMD_PROP_TX_t RF_cmdPropTx;
 // RF Core API Overrides
 extern uint32_t pOverrides[];
 
+// Second RF client of the faster profiles, MAC_ADR only
+extern RF_Mode RF_propFast;
+extern rfc_CMD_PROP_RADIO_DIV_SETUP_t RF_cmdPropRadioDivSetupFast;
+extern uint32_t pOverridesFast[];
+
 #endif // _SMARTRF_SETTINGS_H_
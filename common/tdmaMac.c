@@ -0,0 +1,311 @@
+//
+//  tdmaMac.c
+//  Beacon based TDMA medium access
+//
+
+#include "tdmaMac.h"
+#include "packetCodec.h"
+#include <string.h>
+
+void tdmaDefaultConfig(TdmaFrameConfig * cfg) {
+
+    cfg->slotMs       = TDMA_DEFAULT_SLOT_MS;
+    cfg->beaconMs     = TDMA_DEFAULT_BEACON_MS;
+    cfg->numSlots     = TDMA_DEFAULT_NUM_SLOTS;
+    cfg->numJoinSlots = TDMA_DEFAULT_JOIN_SLOTS;
+    memset(cfg->rate, PHY_PROFILE, sizeof(cfg->rate));
+}
+
+/* Rate of a slot, PHY_PROFILE for join slots */
+static uint8_t tdmaRate(const TdmaFrameConfig * cfg, uint8_t slot) {
+
+    if (slot >= cfg->numSlots || cfg->rate[slot] >= PHY_NUM_PROFILES)
+        return PHY_PROFILE;
+
+    return cfg->rate[slot];
+}
+
+/* Slots before slot (all if TDMA_NO_SLOT) with the given rate, join slots at PHY_PROFILE */
+static uint8_t tdmaSlotsAt(const TdmaFrameConfig * cfg, uint8_t rate, uint8_t before) {
+
+    uint8_t end = before < cfg->numSlots ? before : cfg->numSlots;
+    uint8_t i, n = 0;
+
+    for (i = 0; i < end; ++i)
+        n += tdmaRate(cfg, i) == rate;
+    if (rate == PHY_PROFILE && before > cfg->numSlots)
+        n += (uint8_t)((before == TDMA_NO_SLOT ? cfg->numSlots + cfg->numJoinSlots : before) - cfg->numSlots);
+
+    return n;
+}
+
+/* Rate of the group'th group of slots: PHY_PROFILE, then the others in profile order */
+static uint8_t tdmaGroupRate(uint8_t group) {
+
+    if (group == 0)
+        return PHY_PROFILE;
+
+    return group <= PHY_PROFILE ? group - 1 : group;
+}
+
+/* Offset at which the group of slots at rate starts, a valid rate */
+static uint32_t tdmaGroupStartUs(const TdmaFrameConfig * cfg, uint8_t rate) {
+
+    uint32_t t = (uint32_t)cfg->beaconMs * 1000;
+    uint8_t group, r;
+
+    for (group = 0; (r = tdmaGroupRate(group)) != rate; ++group) {
+        uint8_t n = tdmaSlotsAt(cfg, r, TDMA_NO_SLOT);
+        if (group > 0 && n > 0)
+            t += TDMA_PHY_SWITCH_US;
+        t += (uint32_t)n * tdmaSlotMs(cfg, r) * 1000;
+    }
+    if (rate != PHY_PROFILE)
+        t += TDMA_PHY_SWITCH_US;
+
+    return t;
+}
+
+uint32_t tdmaFrameLengthUs(const TdmaFrameConfig * cfg) {
+
+    uint32_t t = (uint32_t)cfg->beaconMs * 1000;
+    uint8_t r;
+
+    for (r = 0; r < PHY_NUM_PROFILES; ++r) {
+        uint32_t end = tdmaRateEndUs(cfg, r);
+        if (end > t)
+            t = end;
+    }
+    /* Back to PHY_PROFILE for the beacon */
+    if (t > tdmaRateEndUs(cfg, PHY_PROFILE) && t > (uint32_t)cfg->beaconMs * 1000)
+        t += TDMA_PHY_SWITCH_US;
+
+    return t;
+}
+
+uint16_t tdmaSlotMs(const TdmaFrameConfig * cfg, uint8_t rate) {
+
+    if (rate == PHY_PROFILE || rate >= PHY_NUM_PROFILES)
+        return cfg->slotMs;
+
+    /* The longest frame slotMs holds at PHY_PROFILE */
+    const PhyProfile * base = &phyProfiles[PHY_PROFILE];
+    uint32_t frameUs = cfg->slotMs * 1000UL > 2 * TDMA_GUARD_US ? cfg->slotMs * 1000UL - 2 * TDMA_GUARD_US : 0;
+    uint32_t bytes = (uint32_t)((uint64_t)frameUs * 1000 / (8 * phyBitNs(base)));
+    uint32_t overhead = PHY_OVERHEAD_OF(base->preambleLength);
+    uint32_t length = bytes > overhead ? bytes - overhead : 0;
+
+    if (length > 255)
+        length = 255;
+
+    return (uint16_t)((phyAirtimeUs(&phyProfiles[rate], (uint8_t)length) + 2 * TDMA_GUARD_US + 999) / 1000);
+}
+
+uint32_t tdmaSlotOffsetUs(const TdmaFrameConfig * cfg, uint8_t slot) {
+
+    uint8_t rate = tdmaRate(cfg, slot);
+
+    return tdmaGroupStartUs(cfg, rate) + (uint32_t)tdmaSlotsAt(cfg, rate, slot) * tdmaSlotMs(cfg, rate) * 1000;
+}
+
+uint32_t tdmaRateEndUs(const TdmaFrameConfig * cfg, uint8_t rate) {
+
+    if (rate >= PHY_NUM_PROFILES)
+        return 0;
+
+    uint8_t n = tdmaSlotsAt(cfg, rate, TDMA_NO_SLOT);
+
+    return n ? tdmaGroupStartUs(cfg, rate) + (uint32_t)n * tdmaSlotMs(cfg, rate) * 1000 : 0;
+}
+
+/***** Gateway *****/
+
+void tdmaGatewayInit(TdmaGateway * gw, const TdmaFrameConfig * cfg) {
+
+    gw->cfg = *cfg;
+    if (gw->cfg.numSlots > TDMA_MAX_SLOTS)
+        gw->cfg.numSlots = TDMA_MAX_SLOTS;
+
+    memset(gw->owner, TDMA_FREE_SLOT, sizeof(gw->owner));
+    memset(gw->idleFrames, 0, sizeof(gw->idleFrames));
+    gw->beaconSeq = 0;
+}
+
+static uint8_t tdmaGatewayFind(const TdmaGateway * gw, uint8_t nodeId) {
+
+    uint8_t i;
+    for (i = 0; i < gw->cfg.numSlots; ++i) {
+        if (gw->owner[i] == nodeId)
+            return i;
+    }
+
+    return TDMA_NO_SLOT;
+}
+
+uint8_t tdmaGatewayJoin(TdmaGateway * gw, uint8_t nodeId) {
+
+    if (nodeId == TDMA_FREE_SLOT || nodeId == PKT_BROADCAST_ID)
+        return TDMA_NO_SLOT;
+
+    uint8_t slot = tdmaGatewayFind(gw, nodeId);
+
+    if (slot == TDMA_NO_SLOT)
+        slot = tdmaGatewayFind(gw, TDMA_FREE_SLOT);
+
+    if (slot != TDMA_NO_SLOT) {
+        gw->owner[slot] = nodeId;
+        gw->idleFrames[slot] = 0;
+    }
+
+    return slot;
+}
+
+void tdmaGatewayLeave(TdmaGateway * gw, uint8_t nodeId) {
+
+    uint8_t slot = tdmaGatewayFind(gw, nodeId);
+
+    if (slot != TDMA_NO_SLOT && nodeId != TDMA_FREE_SLOT)
+        gw->owner[slot] = TDMA_FREE_SLOT;
+}
+
+uint8_t tdmaGatewayHeard(TdmaGateway * gw, uint8_t nodeId) {
+
+    uint8_t slot = tdmaGatewayFind(gw, nodeId);
+
+    if (slot != TDMA_NO_SLOT && nodeId != TDMA_FREE_SLOT)
+        gw->idleFrames[slot] = 0;
+
+    return slot;
+}
+
+void tdmaGatewayEndFrame(TdmaGateway * gw) {
+
+    uint8_t i;
+    for (i = 0; i < gw->cfg.numSlots; ++i) {
+
+        if (gw->owner[i] == TDMA_FREE_SLOT)
+            continue;
+
+        if (++gw->idleFrames[i] > TDMA_EXPIRY_FRAMES) {
+            gw->owner[i] = TDMA_FREE_SLOT;
+            gw->cfg.rate[i] = PHY_PROFILE;
+        }
+    }
+}
+
+uint8_t tdmaGatewayBuildBeacon(TdmaGateway * gw, uint8_t * buf, uint8_t maxLen) {
+
+    uint8_t length = PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(gw->cfg.numSlots);
+
+    if (maxLen < length)
+        return 0;
+
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_BEACON;
+    hdr.flags  = 0;
+    hdr.nodeId = PKT_GATEWAY_ID;
+    hdr.seq    = gw->beaconSeq++;
+
+    uint8_t * p = buf + pktEncodeHeader(&hdr, buf);
+
+    *p++ = (uint8_t)(gw->cfg.slotMs >> 8);
+    *p++ = (uint8_t)(gw->cfg.slotMs);
+    *p++ = (uint8_t)(gw->cfg.beaconMs >> 8);
+    *p++ = (uint8_t)(gw->cfg.beaconMs);
+    *p++ = gw->cfg.numSlots;
+    *p++ = gw->cfg.numJoinSlots;
+    memcpy(p, gw->owner, gw->cfg.numSlots);
+    p += gw->cfg.numSlots;
+
+    /* 2 bits a slot, slot 0 in the low bits of the first byte */
+    memset(p, 0, (gw->cfg.numSlots + 3) / 4);
+    uint8_t i;
+    for (i = 0; i < gw->cfg.numSlots; ++i)
+        p[i / 4] |= (uint8_t)((gw->cfg.rate[i] & 0x03) << (2 * (i % 4)));
+
+    return length;
+}
+
+/***** Tracker *****/
+
+void tdmaNodeInit(TdmaNode * node, uint8_t nodeId) {
+
+    tdmaDefaultConfig(&node->cfg);
+    node->nodeId = nodeId;
+    node->slot = TDMA_NO_SLOT;
+    node->synced = 0;
+    node->missedBeacons = 0;
+    node->joinAttempts = 0;
+    node->joinBackoff = 0;
+}
+
+uint8_t tdmaNodeOnBeacon(TdmaNode * node, const uint8_t * payload, uint8_t length) {
+
+    if (length < TDMA_BEACON_PAYLOAD_LENGTH(0))
+        return 1;
+
+    TdmaFrameConfig cfg;
+    cfg.slotMs       = (uint16_t)((payload[0] << 8) | payload[1]);
+    cfg.beaconMs     = (uint16_t)((payload[2] << 8) | payload[3]);
+    cfg.numSlots     = payload[4];
+    cfg.numJoinSlots = payload[5];
+
+    if (cfg.slotMs == 0 || cfg.numSlots > TDMA_MAX_SLOTS ||
+        length < TDMA_BEACON_PAYLOAD_LENGTH(cfg.numSlots))
+        return 1;
+
+    const uint8_t * rates = payload + 6 + cfg.numSlots;
+    uint8_t i;
+    for (i = 0; i < cfg.numSlots; ++i) {
+        cfg.rate[i] = (uint8_t)((rates[i / 4] >> (2 * (i % 4))) & 0x03);
+        if (cfg.rate[i] >= PHY_NUM_PROFILES)
+            return 1;
+    }
+    memset(cfg.rate + cfg.numSlots, PHY_PROFILE, sizeof(cfg.rate) - cfg.numSlots);
+
+    node->cfg = cfg;
+    node->slot = TDMA_NO_SLOT;
+
+    for (i = 0; i < cfg.numSlots; ++i) {
+        if (payload[6 + i] == node->nodeId) {
+            node->slot = i;
+            node->joinAttempts = 0;
+            node->joinBackoff = 0;
+            break;
+        }
+    }
+
+    node->synced = 1;
+    node->missedBeacons = 0;
+
+    return 0;
+}
+
+void tdmaNodeBeaconMissed(TdmaNode * node) {
+
+    if (++node->missedBeacons >= TDMA_MAX_MISSED_BEACONS) {
+        node->synced = 0;
+        node->slot = TDMA_NO_SLOT;
+    }
+}
+
+uint8_t tdmaNodeJoinSlot(TdmaNode * node, uint32_t random) {
+
+    if (node->cfg.numJoinSlots == 0)
+        return TDMA_NO_SLOT;
+
+    if (node->joinBackoff > 0) {
+        --node->joinBackoff;
+        return TDMA_NO_SLOT;
+    }
+
+    uint8_t slot = node->cfg.numSlots + (uint8_t)(random % node->cfg.numJoinSlots);
+
+    /* Low bits picked the slot, the next ones the backoff in case this JOIN is lost */
+    random >>= 8;
+    node->joinBackoff = (uint8_t)(random % (1u << node->joinAttempts));
+    if (node->joinAttempts < TDMA_MAX_JOIN_BACKOFF)
+        ++node->joinAttempts;
+
+    return slot;
+}
@@ -0,0 +1,146 @@
+//
+//  tdmaMac.h
+//  Beacon based TDMA medium access: slot allocation on the gateway, slot tracking on the tracker
+//
+//  A superframe starts with a beacon sent by the gateway, followed by numSlots data slots
+//  and numJoinSlots contention slots:
+//
+//      | beacon | slot 0 | slot 1 | ... | slot n-1 | join 0 | ... | join k-1 |
+//
+//  The beacon carries the frame layout and the slot map (the node id owning every data
+//  slot). A tracker that does not find its id in the map sends a JOIN frame in a random
+//  join slot; the gateway grants a slot by putting the id into the next beacon. Slots are
+//  given back with a LEAVE frame or expire when the owner stays silent for
+//  TDMA_EXPIRY_FRAMES superframes.
+//
+//  Every data slot also has a rate, the PHY profile its owner sends at (phyProfile.h).
+//  Beacon, join slots and new slots use PHY_PROFILE; with MAC_ADR the gateway moves owners
+//  with a strong link to faster profiles (adaptiveRate.h). Slots are laid out grouped by
+//  rate, the other profiles in PHY_PROFILE_* order, so the gateway switches PHY once per
+//  group, TDMA_PHY_SWITCH_US ahead, and once more back for the beacon:
+//
+//      | beacon | slots at PHY_PROFILE | joins | switch | slots at 50 kbps | switch | ... |
+//
+//  A faster slot is as much shorter as its frame, so the superframe shrinks and every
+//  tracker gets its slot more often.
+//
+//  All times are offsets from the start of the beacon in microseconds; the firmware turns
+//  them into absolute radio timer (RAT) trigger times with RAT_US() (phyProfile.h).
+//
+
+#ifndef tdmaMac_h
+#define tdmaMac_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "packetCodec.h"
+#include "phyProfile.h"
+
+#define TDMA_MAX_SLOTS          32
+#define TDMA_NO_SLOT            0xFF
+#define TDMA_FREE_SLOT          0x00    // PKT_GATEWAY_ID never owns a data slot
+
+#define TDMA_GUARD_US           4000    // tracker starts listening this early for the beacon
+#define TDMA_PHY_SWITCH_US      2000    // RF core loads another PHY before a group of slots
+#define TDMA_MAX_FRAME_LENGTH   102     // PAYLOAD_LENGTH of the tracker
+
+/* A frame of the PHY in use plus guard time on both sides, rounded up to 25 ms */
+#define TDMA_FRAME_MS(length)   ((PHY_AIRTIME_US(length) + 2 * TDMA_GUARD_US + 24999) / 25000 * 25)
+
+#define TDMA_DEFAULT_SLOT_MS    TDMA_FRAME_MS(TDMA_MAX_FRAME_LENGTH)    // 200 at 5 kbps
+#define TDMA_DEFAULT_BEACON_MS  TDMA_FRAME_MS(PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS))
+#define TDMA_DEFAULT_NUM_SLOTS  16
+#define TDMA_DEFAULT_JOIN_SLOTS 2
+
+#define TDMA_EXPIRY_FRAMES      8       // silent superframes before a slot is reclaimed
+#define TDMA_MAX_MISSED_BEACONS 4       // missed beacons before a tracker drops sync
+#define TDMA_MAX_JOIN_BACKOFF   4       // JOIN retries back off over up to 2^4 superframes
+
+/* Layout, slot map, then the rate of every slot in 2 bits, slot 0 in the low bits */
+#define TDMA_BEACON_PAYLOAD_LENGTH(numSlots)   (6 + (numSlots) + ((numSlots) + 3) / 4)
+
+typedef struct {
+    uint16_t slotMs;        // length of one slot including guard time
+    uint16_t beaconMs;      // time reserved for the beacon at the start of the frame
+    uint8_t  numSlots;      // data slots, at most TDMA_MAX_SLOTS
+    uint8_t  numJoinSlots;  // contention slots for JOIN frames
+    uint8_t  rate[TDMA_MAX_SLOTS];  // PHY_PROFILE_* of every data slot
+} TdmaFrameConfig;
+
+typedef struct {
+    TdmaFrameConfig cfg;
+    uint8_t  owner[TDMA_MAX_SLOTS];         // node id per data slot, TDMA_FREE_SLOT if free
+    uint8_t  idleFrames[TDMA_MAX_SLOTS];    // superframes since the owner was last heard
+    uint16_t beaconSeq;
+} TdmaGateway;
+
+typedef struct {
+    TdmaFrameConfig cfg;
+    uint8_t nodeId;
+    uint8_t slot;           // assigned data slot or TDMA_NO_SLOT
+    uint8_t synced;         // 1 once a beacon was received and fewer than
+                            // TDMA_MAX_MISSED_BEACONS were missed since
+    uint8_t missedBeacons;
+    uint8_t joinAttempts;   // unanswered JOIN frames since the last grant
+    uint8_t joinBackoff;    // superframes to sit out before the next JOIN
+} TdmaNode;
+
+void tdmaDefaultConfig(TdmaFrameConfig * cfg);
+
+uint32_t tdmaFrameLengthUs(const TdmaFrameConfig * cfg);
+
+/// Length of a data slot at the given rate: slotMs at PHY_PROFILE, else the frame that
+/// fits slotMs at PHY_PROFILE plus guard time, at that rate.
+uint16_t tdmaSlotMs(const TdmaFrameConfig * cfg, uint8_t rate);
+
+/// Offset of a slot from the start of the beacon. Join slots follow the data slots,
+/// so slot numSlots is the first join slot.
+uint32_t tdmaSlotOffsetUs(const TdmaFrameConfig * cfg, uint8_t slot);
+
+/// Offset at which the group of slots at the given rate ends, the join slots included at
+/// PHY_PROFILE; 0 if no slot has that rate.
+uint32_t tdmaRateEndUs(const TdmaFrameConfig * cfg, uint8_t rate);
+
+/* Gateway */
+
+void tdmaGatewayInit(TdmaGateway * gw, const TdmaFrameConfig * cfg);
+
+/// Grants a slot to nodeId (or returns the one it already owns). TDMA_NO_SLOT if the frame is full.
+uint8_t tdmaGatewayJoin(TdmaGateway * gw, uint8_t nodeId);
+
+void tdmaGatewayLeave(TdmaGateway * gw, uint8_t nodeId);
+
+/// Records traffic from nodeId so its slot does not expire. Returns the slot or TDMA_NO_SLOT.
+uint8_t tdmaGatewayHeard(TdmaGateway * gw, uint8_t nodeId);
+
+/// Ages every slot by one superframe and frees the ones whose owner went silent.
+void tdmaGatewayEndFrame(TdmaGateway * gw);
+
+/// Writes a complete beacon frame (header + payload) into buf. Returns its length, 0 if
+/// maxLen is too small.
+uint8_t tdmaGatewayBuildBeacon(TdmaGateway * gw, uint8_t * buf, uint8_t maxLen);
+
+/* Tracker */
+
+void tdmaNodeInit(TdmaNode * node, uint8_t nodeId);
+
+/// Takes the payload of a received beacon (after the frame header). Returns 0 on success,
+/// 1 if the beacon is malformed.
+uint8_t tdmaNodeOnBeacon(TdmaNode * node, const uint8_t * payload, uint8_t length);
+
+void tdmaNodeBeaconMissed(TdmaNode * node);
+
+/// Join slot to send a JOIN frame in during this superframe, TDMA_NO_SLOT while backing off.
+/// Call once per beacon without a grant. Unanswered JOINs back off exponentially so a crowd
+/// of trackers powering up together does not keep colliding in the join slots.
+uint8_t tdmaNodeJoinSlot(TdmaNode * node, uint32_t random);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* tdmaMac_h */
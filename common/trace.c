@@ -0,0 +1,119 @@
+//
+//  trace.c
+//  Lock-free trace ring with the DWT cycle counter or clock_gettime() as its clock
+//
+
+#include "trace.h"
+#include <string.h>
+
+#if !defined(__TI_ARM__) && !defined(__arm__)
+#include <time.h>
+#endif
+
+#if defined(__TI_ARM__) || defined(__arm__)
+// Cortex-M3 debug registers
+#define DEMCR           (*(volatile uint32_t *)0xE000EDFCUL)
+#define DEMCR_TRCENA    (1UL << 24)
+#define DWT_CTRL        (*(volatile uint32_t *)0xE0001000UL)
+#define DWT_CYCCNTENA   (1UL << 0)
+#define DWT_CYCCNT      (*(volatile uint32_t *)0xE0001004UL)
+#endif
+
+TraceRing traceRing;
+
+/* Index of the next record; the previous value is returned */
+static uint32_t takeIndex(void) {
+
+#if defined(__TI_COMPILER_VERSION__)
+    uint32_t i;
+    do {
+        i = __ldrex((void *)&traceRing.head);
+    } while (__strex(i + 1, (void *)&traceRing.head));
+    return i;
+#else
+    return __atomic_fetch_add(&traceRing.head, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static void putU32(uint8_t * p, uint32_t v) {
+
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+void traceInit(void) {
+
+#if defined(__TI_ARM__) || defined(__arm__)
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CYCCNTENA;
+#endif
+    memset(&traceRing, 0, sizeof(traceRing));
+    /* No slot holds a valid record yet: index 0 is expected at slot 0 */
+    traceRing.records[0].seq = 0xFFFF;
+}
+
+uint32_t traceNow(void) {
+
+#if defined(__TI_ARM__) || defined(__arm__)
+    return DWT_CYCCNT;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+void traceRecord(uint8_t point, uint8_t kind) {
+
+    uint32_t time = traceNow();
+    uint32_t i = takeIndex();
+    volatile TraceRecord * r = &traceRing.records[i & (TRACE_RING_SIZE - 1)];
+
+    r->seq   = (uint16_t)~i;
+    r->time  = time;
+    r->point = point;
+    r->kind  = kind;
+    r->seq   = (uint16_t)i;
+}
+
+uint16_t traceDump(void (*write)(void * ctx, const uint8_t * data, uint16_t length), void * ctx) {
+
+    uint8_t out[TRACE_HEADER_LENGTH];
+    uint32_t head = traceRing.head;
+    uint32_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    uint32_t i;
+    uint16_t written = 0;
+
+    putU32(out, TRACE_MAGIC);
+    putU32(out + 4, TRACE_HZ);
+    putU32(out + 8, head);
+    out[12] = (uint8_t)((head - first) >> 8);
+    out[13] = (uint8_t)(head - first);
+    write(ctx, out, TRACE_HEADER_LENGTH);
+
+    for (i = first; i != head; ++i) {
+        volatile TraceRecord * r = &traceRing.records[i & (TRACE_RING_SIZE - 1)];
+
+        /* The index before and after the copy: a writer in between changes it */
+        uint16_t seq = r->seq;
+        TraceRecord rec;
+        rec.time  = r->time;
+        rec.point = r->point;
+        rec.kind  = r->kind;
+        if (seq != (uint16_t)i || r->seq != seq)
+            continue;
+
+        putU32(out, rec.time);
+        out[4] = (uint8_t)(seq >> 8);
+        out[5] = (uint8_t)seq;
+        out[6] = rec.point;
+        out[7] = rec.kind;
+        write(ctx, out, TRACE_RECORD_LENGTH);
+        ++written;
+    }
+
+    return written;
+}
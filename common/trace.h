@@ -0,0 +1,115 @@
+//
+//  trace.h
+//  Hot path latency tracing: named trace points record timestamps into a lock-free ring,
+//  dumped in binary on demand and turned into latency histograms and a timeline on the
+//  host (host/tools/traceTool.c)
+//
+//  A record is 8 bytes: the time, the point, begin, end or mark, and the low 16 bits of
+//  its index in the ring. Writers take an index with one atomic add, mark the slot busy
+//  and write the index last: the RF callback, an HWI and the task all record without a
+//  lock, and a record being written or overwritten is skipped by the dump rather than read
+//  torn. The ring keeps the last TRACE_RING_SIZE records.
+//
+//  On the CC1310 the time is the Cortex-M3 DWT cycle counter (CYCCNT, 48 MHz, wraps after
+//  89 s), which stops while the CPU sleeps: a firmware that traces keeps it awake. On the
+//  host it is clock_gettime() in ns. Both wrap at 32 bits, the host tool unwraps them in
+//  index order.
+//
+//  The TRACE_* macros compile to nothing unless TRACE_ENABLED is 1, set like MAC_MODE for
+//  the build of either firmware.
+//
+
+#ifndef trace_h
+#define trace_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* 1: the firmware records its trace points and dumps the ring when BTN-1 is pressed */
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED   0
+#endif
+
+// Records kept, a power of 2: 1 KB on the CC1310
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 128
+#endif
+
+#if TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)
+#error "TRACE_RING_SIZE must be a power of 2"
+#endif
+
+#if defined(__TI_ARM__) || defined(__arm__)
+#define TRACE_HZ        48000000UL      // CPU clock, DWT CYCCNT
+#else
+#define TRACE_HZ        1000000000UL    // clock_gettime() ns
+#endif
+
+// Trace points of both firmwares; their names are in host/tools/traceTool.c
+typedef enum {
+    TRACE_RX_CALLBACK,      // gateway RF callback
+    TRACE_RX_FRAME,         // gateway handling of one frame, ACK and output included
+    TRACE_NMEA_PARSE,       // sentence checked and parsed
+    TRACE_FORMAT,           // output line formatted
+    TRACE_UART_WRITE,       // UART_write() of a line or frame
+    TRACE_RF_CMD,           // RF command posted until it completed
+    TRACE_RF_DONE,          // mark: RF command completion in its callback
+    TRACE_TX_SELECT,        // tracker: sentence or epoch complete until it is framed or dropped
+    TRACE_TX_BUILD,         // tracker: frame built (and sealed)
+    TRACE_POINTS
+} TracePoint;
+
+#define TRACE_KIND_BEGIN    0
+#define TRACE_KIND_END      1
+#define TRACE_KIND_MARK     2
+
+typedef struct {
+    uint32_t  time;         // TRACE_HZ ticks
+    uint16_t  seq;          // low bits of the index, written last; its complement while busy
+    uint8_t   point;
+    uint8_t   kind;
+} TraceRecord;
+
+// Dump: header, then the records still in the ring, oldest first, all big endian
+#define TRACE_MAGIC             0x54524331UL    // "TRC1"
+#define TRACE_HEADER_LENGTH     14              // magic, hz, index of the next record, records
+#define TRACE_RECORD_LENGTH     8               // time, seq, point, kind
+
+typedef struct {
+    volatile uint32_t head;     // index of the next record
+    TraceRecord records[TRACE_RING_SIZE];
+} TraceRing;
+
+extern TraceRing traceRing;
+
+/// Starts the clock (the DWT cycle counter on the CC1310) and empties the ring.
+void traceInit(void);
+
+/// The clock, in TRACE_HZ ticks.
+uint32_t traceNow(void);
+
+/// Records point. Safe from any context, costs a clock read and an atomic add.
+void traceRecord(uint8_t point, uint8_t kind);
+
+/// Writes the ring through write(ctx, data, length), a header and then a record at a time.
+/// Returns the records written; those being written meanwhile are skipped.
+uint16_t traceDump(void (*write)(void * ctx, const uint8_t * data, uint16_t length), void * ctx);
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(point)  traceRecord((point), TRACE_KIND_BEGIN)
+#define TRACE_END(point)    traceRecord((point), TRACE_KIND_END)
+#define TRACE_MARK(point)   traceRecord((point), TRACE_KIND_MARK)
+#else
+#define TRACE_BEGIN(point)  ((void)0)
+#define TRACE_END(point)    ((void)0)
+#define TRACE_MARK(point)   ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* trace_h */
@@ -0,0 +1,112 @@
+//
+//  trackCompress.c
+//  Online trajectory simplification (opening window, synchronized euclidean distance)
+//
+
+#include "trackCompress.h"
+#include <string.h>
+
+#define DAY_MS  86400000UL
+
+static uint32_t elapsedMs(uint32_t from, uint32_t to) {
+
+    return (to + DAY_MS - from) % DAY_MS;
+}
+
+static void setAnchor(TrackCompressor * c, const FixRecord * fix) {
+
+    c->anchor = *fix;
+    geoPlaneInit(&c->plane, fix->latE7, fix->lonE7);
+    ++c->vertices;
+}
+
+/* Does every held fix stay within the tolerance of the segment from the anchor to fix? */
+static uint8_t withinTolerance(const TrackCompressor * c, const FixRecord * fix) {
+
+    int64_t endEast, endNorth, east, north;
+    int64_t tolerance = c->config.toleranceCm;
+    int64_t span = elapsedMs(c->anchor.timeMs, fix->timeMs);
+    uint8_t i;
+
+    geoProject(&c->plane, fix->latE7, fix->lonE7, &endEast, &endNorth);
+
+    for (i = 0; i < c->count; ++i) {
+
+        int64_t t = elapsedMs(c->anchor.timeMs, c->held[i].timeMs);
+
+        geoProject(&c->plane, c->held[i].latE7, c->held[i].lonE7, &east, &north);
+        east  -= endEast * t / span;
+        north -= endNorth * t / span;
+
+        if (east * east + north * north > tolerance * tolerance)
+            return 0;
+    }
+
+    return 1;
+}
+
+void trackCompressDefaultConfig(TrackCompressConfig * config) {
+
+    config->toleranceCm = 1000;
+    config->window      = TRACK_COMPRESS_MAX_WINDOW;
+    config->maxGapS     = 300;
+}
+
+void trackCompressInit(TrackCompressor * c, const TrackCompressConfig * config) {
+
+    memset(c, 0, sizeof(*c));
+    c->config = *config;
+    if (c->config.window > TRACK_COMPRESS_MAX_WINDOW)
+        c->config.window = TRACK_COMPRESS_MAX_WINDOW;
+}
+
+uint8_t trackCompressPush(TrackCompressor * c, const FixRecord * fix, FixRecord * vertex) {
+
+    if (!c->started) {
+        c->started = 1;
+        ++c->fixes;
+        setAnchor(c, fix);
+        *vertex = *fix;
+        return 1;
+    }
+
+    const FixRecord * last = c->count ? &c->held[c->count - 1] : &c->anchor;
+    if (fix->timeMs == last->timeMs)
+        return 0;
+
+    ++c->fixes;
+
+    if (c->count < c->config.window &&
+        elapsedMs(c->anchor.timeMs, fix->timeMs) < (uint32_t)c->config.maxGapS * 1000 &&
+        withinTolerance(c, fix)) {
+        c->held[c->count++] = *fix;
+        return 0;
+    }
+
+    /* Nothing held back: the fix itself is due */
+    if (c->count == 0) {
+        setAnchor(c, fix);
+        *vertex = *fix;
+        return 1;
+    }
+
+    /* The window opened too far: the fix before this one is a vertex */
+    *vertex = c->held[c->count - 1];
+    setAnchor(c, vertex);
+    c->held[0] = *fix;
+    c->count = 1;
+
+    return 1;
+}
+
+uint8_t trackCompressFlush(TrackCompressor * c, FixRecord * vertex) {
+
+    if (c->count == 0)
+        return 0;
+
+    *vertex = c->held[c->count - 1];
+    setAnchor(c, vertex);
+    c->count = 0;
+
+    return 1;
+}
@@ -0,0 +1,64 @@
+//
+//  trackCompress.h
+//  Online trajectory simplification: keeps only the fixes needed to redraw the track
+//  within a distance bound
+//
+//  Opening window algorithm with the synchronized euclidean distance: a held back fix may
+//  be dropped if the position linearly interpolated in time between its neighbouring
+//  vertices is within toleranceCm of it, so a receiver that interpolates between vertices
+//  by their timestamps never draws the track further off than that. Once the newest fix
+//  breaks the bound for any fix held back since the last vertex, the fix before it becomes
+//  the next vertex. At most window fixes are held back, and a vertex goes out at least
+//  every maxGapS seconds; vertices are therefore delayed by up to min(window, maxGapS) fixes.
+//
+//  Distances are worked out in integer centimetres on a plane around the last vertex.
+//
+
+#ifndef trackCompress_h
+#define trackCompress_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "fixLog.h"
+#include "geoPlane.h"
+
+#define TRACK_COMPRESS_MAX_WINDOW   32
+
+typedef struct {
+    uint16_t toleranceCm;
+    uint8_t  window;            // at most TRACK_COMPRESS_MAX_WINDOW
+    uint16_t maxGapS;
+} TrackCompressConfig;
+
+typedef struct {
+    TrackCompressConfig config;
+    uint8_t   started;
+    FixRecord anchor;           // last vertex
+    GeoPlane  plane;            // around the anchor
+    FixRecord held[TRACK_COMPRESS_MAX_WINDOW];  // fixes since the anchor, oldest first
+    uint8_t   count;
+    /* Statistics */
+    uint32_t  fixes;
+    uint32_t  vertices;
+} TrackCompressor;
+
+/// 10 m, a window of 32 fixes, a vertex at least every 5 minutes.
+void trackCompressDefaultConfig(TrackCompressConfig * config);
+
+void trackCompressInit(TrackCompressor * c, const TrackCompressConfig * config);
+
+/// Takes the next fix. Returns 1 if that made a vertex final, then in vertex. A fix with
+/// the time of the one before is ignored.
+uint8_t trackCompressPush(TrackCompressor * c, const FixRecord * fix, FixRecord * vertex);
+
+/// Ends the track: returns 1 and the newest fix held back as the last vertex, if any.
+uint8_t trackCompressFlush(TrackCompressor * c, FixRecord * vertex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* trackCompress_h */
@@ -0,0 +1,80 @@
+//
+//  txPower.c
+//  Closed-loop TX power control
+//
+
+#include "txPower.h"
+
+const TxPowerLevel txPowerLevels[TXP_NUM_LEVELS] = {
+    {  15, 0x913F, 26000 },
+    {  14, 0xA73F, 24000 },
+    {  12, 0xB818, 17500 },
+    {  10, 0x38D3, 13400 },
+    {   8, 0x24CB, 11300 },
+    {   6, 0x1CC7, 10000 },
+    {   4, 0x18C5,  9000 },
+    {   2, 0x1042,  8300 },
+    {   0, 0x0041,  7700 },
+    { -10, 0x08C0,  5900 }
+};
+
+void txpInit(TxPowerControl * ctl, int8_t sensitivityDbm, int8_t targetMarginDb) {
+
+    ctl->sensitivityDbm = sensitivityDbm;
+    ctl->targetMarginDb = targetMarginDb;
+    ctl->level          = TXP_MAX_LEVEL;
+    ctl->misses         = 0;
+}
+
+uint8_t txpLevelFor(int16_t dbm) {
+
+    uint8_t level = TXP_NUM_LEVELS;
+
+    while (level > TXP_MAX_LEVEL + 1 && txPowerLevels[level - 1].dbm < dbm)
+        --level;
+
+    return level - 1;
+}
+
+uint8_t txpReport(TxPowerControl * ctl, int8_t rssiDbm) {
+
+    int16_t dbm = txPowerLevels[ctl->level].dbm;
+    int16_t excess = rssiDbm - ctl->sensitivityDbm - ctl->targetMarginDb;
+    uint8_t level = ctl->level;
+
+    ctl->misses = 0;
+
+    if (excess < 0)
+        level = txpLevelFor(dbm - excess);
+    else if (excess > TXP_HYSTERESIS_DB) {
+        level = txpLevelFor(dbm - (excess < TXP_MAX_STEP_DOWN_DB ? excess : TXP_MAX_STEP_DOWN_DB));
+
+        /* Where the table steps further than that, one level at a time once the excess covers it */
+        if (level == ctl->level && level + 1 < TXP_NUM_LEVELS && dbm - txPowerLevels[level + 1].dbm <= excess)
+            ++level;
+    }
+
+    if (level == ctl->level)
+        return 0;
+
+    ctl->level = level;
+    return 1;
+}
+
+uint8_t txpMissed(TxPowerControl * ctl) {
+
+    if (++ctl->misses < TXP_FALLBACK_MISSES)
+        return 0;
+
+    ctl->misses = 0;
+    if (ctl->level == TXP_MAX_LEVEL)
+        return 0;
+
+    ctl->level = TXP_MAX_LEVEL;
+    return 1;
+}
+
+const TxPowerLevel * txpLevel(const TxPowerControl * ctl) {
+
+    return &txPowerLevels[ctl->level];
+}
@@ -0,0 +1,73 @@
+//
+//  txPower.h
+//  Closed-loop TX power control of the tracker, by the RSSI the gateway reports
+//
+//  Every ACK carries the RSSI the gateway measured for the frame it answers (arqMac.h).
+//  Its margin over the sensitivity of PHY_PROFILE is held near a per-tracker target:
+//
+//      margin below target             up by the shortfall at once, to the next level
+//                                      that covers it
+//      more than TXP_HYSTERESIS_DB     down by the excess, at most TXP_MAX_STEP_DOWN_DB
+//      above target                    per report, to a level that still covers it
+//
+//  A link that fails rises quickly and decays slowly. TXP_FALLBACK_MISSES frames in a row
+//  without an ACK put the tracker back at maximum power, where it started.
+//
+//  txPowerLevels[] runs from the highest power down: dBm, the txPower word of
+//  CMD_PROP_RADIO_DIV_SETUP and the radio supply current in TX at 3.0 V. Words and
+//  currents are the SmartRF Studio / datasheet figures of the CC1310 at 433 MHz;
+//  recheck them against a PA table exported for the board in use.
+//
+
+#ifndef txPower_h
+#define txPower_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define TXP_NUM_LEVELS                  10
+#define TXP_MAX_LEVEL                   0   // index of the highest power
+#define TXP_DEFAULT_TARGET_MARGIN_DB    10  // above sensitivity, covers shadowing of a few dB
+#define TXP_HYSTERESIS_DB               3   // margin over target before power goes down
+#define TXP_MAX_STEP_DOWN_DB            6   // per report
+#define TXP_FALLBACK_MISSES             3   // unanswered frames in a row, back to max power
+
+typedef struct {
+    int8_t   dbm;
+    uint16_t txPower;           // CMD_PROP_RADIO_DIV_SETUP.txPower
+    uint16_t supplyUa;          // radio supply current in TX
+} TxPowerLevel;
+
+typedef struct {
+    int8_t  sensitivityDbm;     // of the PHY the frames are sent with
+    int8_t  targetMarginDb;
+    uint8_t level;              // into txPowerLevels[]
+    uint8_t misses;             // frames in a row without an ACK
+} TxPowerControl;
+
+extern const TxPowerLevel txPowerLevels[TXP_NUM_LEVELS];
+
+/// Starts at maximum power. targetMarginDb is the tracker's own, e.g.
+/// TXP_DEFAULT_TARGET_MARGIN_DB; a tracker on the move wants more than a parked one.
+void txpInit(TxPowerControl * ctl, int8_t sensitivityDbm, int8_t targetMarginDb);
+
+/// Call with the RSSI an ACK reported for a frame sent at the current level. Returns 1 if
+/// the level changed.
+uint8_t txpReport(TxPowerControl * ctl, int8_t rssiDbm);
+
+/// Call when a frame's ACK window closed empty. Returns 1 if the level changed.
+uint8_t txpMissed(TxPowerControl * ctl);
+
+const TxPowerLevel * txpLevel(const TxPowerControl * ctl);
+
+/// Lowest level with at least dbm, TXP_MAX_LEVEL if none reaches it.
+uint8_t txpLevelFor(int16_t dbm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* txPower_h */
@@ -0,0 +1,247 @@
+//
+//  ubxProtocol.c
+//  u-blox UBX binary protocol
+//
+
+#include "ubxProtocol.h"
+
+#define DAY_MS  86400000UL
+
+enum {
+    UBX_WAIT_SYNC_1,
+    UBX_WAIT_SYNC_2,
+    UBX_HEADER,
+    UBX_PAYLOAD,
+    UBX_CHECK_A,
+    UBX_CHECK_B
+};
+
+static uint16_t getLe16(const uint8_t * buf) {
+
+    return (uint16_t)(buf[0] | (buf[1] << 8));
+}
+
+static uint32_t getLe32(const uint8_t * buf) {
+
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static void putLe16(uint8_t * buf, uint16_t v) {
+
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static void putLe32(uint8_t * buf, uint32_t v) {
+
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+    buf[2] = (uint8_t)(v >> 16);
+    buf[3] = (uint8_t)(v >> 24);
+}
+
+void ubxFramerInit(UbxFramer * f, uint8_t * buf, uint16_t size) {
+
+    f->buf = buf;
+    f->size = size;
+    f->fill = 0;
+    f->length = 0;
+    f->state = UBX_WAIT_SYNC_1;
+    f->ckA = f->ckB = 0;
+    f->frames = 0;
+    f->badChecksums = 0;
+    f->oversize = 0;
+}
+
+uint8_t ubxFramerPush(UbxFramer * f, uint8_t byte, UbxFrame * frame) {
+
+    switch (f->state) {
+
+        case UBX_WAIT_SYNC_1:
+            if (byte == UBX_SYNC_1)
+                f->state = UBX_WAIT_SYNC_2;
+            return 0;
+
+        case UBX_WAIT_SYNC_2:
+            if (byte == UBX_SYNC_2) {
+                f->state = UBX_HEADER;
+                f->fill = 0;
+                f->ckA = f->ckB = 0;
+            }
+            else if (byte != UBX_SYNC_1)
+                f->state = UBX_WAIT_SYNC_1;
+            return 0;
+
+        case UBX_HEADER:
+        case UBX_PAYLOAD:
+            f->buf[f->fill++] = byte;
+            f->ckA += byte;
+            f->ckB += f->ckA;
+
+            if (f->state == UBX_HEADER && f->fill == 4) {
+                f->length = getLe16(f->buf + 2);
+                if (f->length > f->size - 4) {
+                    /* Too long to keep, or a sync pattern inside other data */
+                    ++f->oversize;
+                    f->state = UBX_WAIT_SYNC_1;
+                    return 0;
+                }
+                f->state = UBX_PAYLOAD;
+            }
+            if (f->state == UBX_PAYLOAD && f->fill == 4 + f->length)
+                f->state = UBX_CHECK_A;
+            return 0;
+
+        case UBX_CHECK_A:
+            if (byte != f->ckA) {
+                ++f->badChecksums;
+                f->state = byte == UBX_SYNC_1 ? UBX_WAIT_SYNC_2 : UBX_WAIT_SYNC_1;
+                return 0;
+            }
+            f->state = UBX_CHECK_B;
+            return 0;
+
+        case UBX_CHECK_B:
+            f->state = UBX_WAIT_SYNC_1;
+            if (byte != f->ckB) {
+                ++f->badChecksums;
+                if (byte == UBX_SYNC_1)
+                    f->state = UBX_WAIT_SYNC_2;
+                return 0;
+            }
+            ++f->frames;
+            frame->msgClass = f->buf[0];
+            frame->id       = f->buf[1];
+            frame->length   = f->length;
+            frame->payload  = f->buf + 4;
+            return 1;
+    }
+
+    f->state = UBX_WAIT_SYNC_1;
+    return 0;
+}
+
+uint16_t ubxBuild(uint8_t msgClass, uint8_t id, const uint8_t * payload, uint16_t length, uint8_t * out) {
+
+    uint8_t ckA = 0, ckB = 0;
+    uint16_t i;
+
+    out[0] = UBX_SYNC_1;
+    out[1] = UBX_SYNC_2;
+    out[2] = msgClass;
+    out[3] = id;
+    putLe16(out + 4, length);
+    for (i = 0; i < length; ++i)
+        out[6 + i] = payload[i];
+
+    for (i = 2; i < 6 + length; ++i) {
+        ckA += out[i];
+        ckB += ckA;
+    }
+    out[6 + length] = ckA;
+    out[7 + length] = ckB;
+
+    return length + UBX_OVERHEAD;
+}
+
+uint16_t ubxCfgMsg(uint8_t msgClass, uint8_t id, uint8_t rate, uint8_t * out) {
+
+    uint8_t payload[UBX_CFG_MSG_LENGTH];
+
+    payload[0] = msgClass;
+    payload[1] = id;
+    payload[2] = rate;
+
+    return ubxBuild(UBX_CFG, UBX_CFG_MSG, payload, sizeof(payload), out);
+}
+
+uint16_t ubxCfgPrtUart(uint32_t baud, uint16_t inProto, uint16_t outProto, uint8_t * out) {
+
+    uint8_t payload[UBX_CFG_PRT_LENGTH] = { 0 };
+
+    payload[0] = 1;                     // UART1
+    putLe32(payload + 4, 0x000008D0);   // 8 data bits, no parity, 1 stop bit
+    putLe32(payload + 8, baud);
+    putLe16(payload + 12, inProto);
+    putLe16(payload + 14, outProto);
+
+    return ubxBuild(UBX_CFG, UBX_CFG_PRT, payload, sizeof(payload), out);
+}
+
+uint32_t ubxNavTow(const UbxFrame * frame) {
+
+    return frame->length >= 4 ? getLe32(frame->payload) : 0;
+}
+
+uint8_t ubxDecodeNavPvt(const UbxFrame * frame, EpochFix * fix, uint8_t * fixMode, uint16_t * pdop) {
+
+    const uint8_t * p = frame->payload;
+
+    if (frame->length < UBX_NAV_PVT_LENGTH || !(p[11] & 0x02))
+        return 1;
+
+    uint8_t fixType = p[20];
+    uint8_t flags   = p[21];
+    int32_t nano    = (int32_t)getLe32(p + 16);
+    int32_t ms      = ((p[8] * 3600L + p[9] * 60L + p[10]) * 1000L) + nano / 1000000L;
+
+    fix->fix.timeMs = (uint32_t)((ms + (int32_t)DAY_MS) % (int32_t)DAY_MS);
+    fix->satellites = p[23];
+    fix->hdop       = FIX_EPOCH_NO_DOP;     // NAV-DOP has it
+    fix->sources    = 0;
+    fix->have       = 0;
+    *pdop           = getLe16(p + 76);
+
+    /* fixType 1 dead reckoning, 2 2D, 3 3D, 4 GNSS and dead reckoning, 5 time only */
+    *fixMode = fixType == 2 ? 2 : (fixType == 3 || fixType == 4) ? 3 : 1;
+    if (!(flags & 0x01) || fixType == 0 || fixType == 5) {
+        fix->quality = 0;
+        fix->fix.latE7 = fix->fix.lonE7 = 0;
+        fix->fix.altM = 0;
+        fix->speedCmS = fix->courseCdeg = 0;
+        return 0;
+    }
+
+    /* As GGA: 6 estimated, 4 RTK fixed, 5 RTK float, 2 differential, else 1 */
+    switch (flags >> 6) {
+        case 1:
+            fix->quality = 5;
+            break;
+        case 2:
+            fix->quality = 4;
+            break;
+        default:
+            fix->quality = fixType == 1 ? 6 : (flags & 0x02) ? 2 : 1;
+            break;
+    }
+
+    int32_t hMsl   = (int32_t)getLe32(p + 36);
+    int32_t gSpeed = (int32_t)getLe32(p + 60);
+    int32_t head   = (int32_t)getLe32(p + 64);
+
+    fix->fix.lonE7  = (int32_t)getLe32(p + 24);
+    fix->fix.latE7  = (int32_t)getLe32(p + 28);
+    fix->fix.altM   = (int16_t)(hMsl / 1000);
+    fix->speedCmS   = gSpeed / 10 > 0xFFFF ? 0xFFFF : (uint16_t)(gSpeed / 10);
+    fix->courseCdeg = (uint16_t)(((head / 1000) % 36000 + 36000) % 36000);
+    fix->have = FIX_EPOCH_POSITION | FIX_EPOCH_MOTION;
+    if (fixType != 2)
+        fix->have |= FIX_EPOCH_ALTITUDE;
+
+    return 0;
+}
+
+uint8_t ubxDecodeNavDop(const UbxFrame * frame, UbxDop * dop) {
+
+    const uint8_t * p = frame->payload;
+
+    if (frame->length < UBX_NAV_DOP_LENGTH)
+        return 1;
+
+    dop->iTow = getLe32(p);
+    dop->pdop = getLe16(p + 6);
+    dop->vdop = getLe16(p + 10);
+    dop->hdop = getLe16(p + 12);
+
+    return 0;
+}
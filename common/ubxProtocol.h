@@ -0,0 +1,124 @@
+//
+//  ubxProtocol.h
+//  u-blox UBX binary protocol: frame parser, the few messages the tracker needs, and the
+//  configuration commands that turn a module's output into them
+//
+//  A frame is
+//
+//      byte 0..1   sync 0xB5 0x62
+//      byte 2      class
+//      byte 3      id
+//      byte 4..5   payload length, little endian
+//      ...         payload
+//      last 2      Fletcher-8 checksum over class to the end of the payload
+//
+//  UbxFramer takes one byte at a time and checksums as it goes; each byte is stored once,
+//  into the caller's buffer, and decoders read their fields from there. A frame that does
+//  not fit is skipped without being stored. After a bad checksum the framer looks for the
+//  next sync, so NMEA text or noise between frames costs nothing but the bytes.
+//
+//  Only NAV-PVT (fix, time, speed, course, accuracy) and NAV-DOP are decoded; ACK-ACK and
+//  ACK-NAK are recognised. Configuration uses the CFG-PRT and CFG-MSG messages of protocol
+//  versions up to 23 (u-blox 6, 7 and 8); modules from generation 9 on take CFG-VALSET.
+//
+
+#ifndef ubxProtocol_h
+#define ubxProtocol_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "fixEpoch.h"
+
+#define UBX_SYNC_1              0xB5
+#define UBX_SYNC_2              0x62
+#define UBX_OVERHEAD            8       // sync, class, id, length, checksum
+
+// Classes and ids
+#define UBX_NAV                 0x01
+#define UBX_NAV_DOP             0x04
+#define UBX_NAV_PVT             0x07
+#define UBX_ACK                 0x05
+#define UBX_ACK_NAK             0x00
+#define UBX_ACK_ACK             0x01
+#define UBX_CFG                 0x06
+#define UBX_CFG_PRT             0x00
+#define UBX_CFG_MSG             0x01
+#define UBX_NMEA                0xF0    // standard NMEA sentences, for CFG-MSG
+#define UBX_NMEA_GGA            0x00
+#define UBX_NMEA_GLL            0x01
+#define UBX_NMEA_GSA            0x02
+#define UBX_NMEA_GSV            0x03
+#define UBX_NMEA_RMC            0x04
+#define UBX_NMEA_VTG            0x05
+
+#define UBX_NAV_PVT_LENGTH      92
+#define UBX_NAV_DOP_LENGTH      18
+#define UBX_CFG_PRT_LENGTH      20
+#define UBX_CFG_MSG_LENGTH      3
+
+// Protocol masks of CFG-PRT
+#define UBX_PROTO_UBX           0x0001
+#define UBX_PROTO_NMEA          0x0002
+
+typedef struct {
+    uint8_t *   buf;            // class, id, length and payload of the frame being received
+    uint16_t    size;
+    uint16_t    fill;           // bytes of the current frame seen, sync excluded
+    uint16_t    length;         // payload length of the current frame
+    uint8_t     state;
+    uint8_t     ckA, ckB;
+    /* Statistics */
+    uint32_t    frames;
+    uint32_t    badChecksums;
+    uint32_t    oversize;       // frames too long for buf, skipped
+} UbxFramer;
+
+/// Frame as received, pointing into the framer's buffer until the next byte is pushed
+typedef struct {
+    uint8_t         msgClass;
+    uint8_t         id;
+    uint16_t        length;
+    const uint8_t * payload;
+} UbxFrame;
+
+/// DOPs of NAV-DOP, in 0.01
+typedef struct {
+    uint32_t iTow;              // GPS time of week, ms
+    uint16_t pdop, vdop, hdop;
+} UbxDop;
+
+/// buf must hold 4 bytes plus the longest payload to be decoded.
+void ubxFramerInit(UbxFramer * f, uint8_t * buf, uint16_t size);
+
+/// Takes the next byte. Returns 1 when it completed a frame with a good checksum, then in
+/// frame.
+uint8_t ubxFramerPush(UbxFramer * f, uint8_t byte, UbxFrame * frame);
+
+/// Writes a whole frame into out (length + UBX_OVERHEAD bytes). Returns its length.
+uint16_t ubxBuild(uint8_t msgClass, uint8_t id, const uint8_t * payload, uint16_t length, uint8_t * out);
+
+/// CFG-MSG: rate (per navigation solution) of a message on the current port.
+uint16_t ubxCfgMsg(uint8_t msgClass, uint8_t id, uint8_t rate, uint8_t * out);
+
+/// CFG-PRT for UART1: 8N1 at baud, with the input and output protocol masks.
+uint16_t ubxCfgPrtUart(uint32_t baud, uint16_t inProto, uint16_t outProto, uint8_t * out);
+
+/// NAV-PVT into a fix as the GGA and RMC of its epoch would give it. Returns 1 if the
+/// payload is too short or the UTC time is not valid. fixMode and pdop come along for the
+/// quality gate.
+uint8_t ubxDecodeNavPvt(const UbxFrame * frame, EpochFix * fix, uint8_t * fixMode, uint16_t * pdop);
+
+/// Returns 1 if the payload is too short.
+uint8_t ubxDecodeNavDop(const UbxFrame * frame, UbxDop * dop);
+
+/// GPS time of week of a NAV-PVT or NAV-DOP, which both start with it.
+uint32_t ubxNavTow(const UbxFrame * frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ubxProtocol_h */
@@ -0,0 +1,246 @@
+//
+//  adrBench.c
+//  Delivered fixes per second and tracker energy per fix of TDMA with adaptive data rate
+//  (adaptiveRate.c) against TDMA at PHY_PROFILE only
+//
+//  Trackers sit at random distances from the gateway, 100 m to 3 km. Every frame is
+//  received if its RSSI reaches the sensitivity of its profile: +14 dBm from the tracker
+//  and the gateway, log-distance path loss (25 dB at 1 m, exponent 3) and 4 dB of
+//  shadowing drawn per frame. TDMA data slots do not collide, so the superframe is run
+//  as a whole: the beacon, every tracker's latest fix in its slot at the rate the beacon
+//  gave it, and JOIN frames, which are lost when two pick the same join slot.
+//
+//  Energy counts the tracker radio only: TX airtime at its rate and the beacon window
+//  (TDMA_GUARD_US on both sides of the beacon), at the CC1310 supply currents in
+//  channelSim.h.
+//
+//  usage: adrBench [seconds] [seed]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptiveRate.h"
+#include "channelSim.h"
+#include "packetCodec.h"
+#include "tdmaMac.h"
+
+#define MAX_NODES           32
+#define WARMUP_US           300000000ULL    // trackers join and the rates settle first
+#define NO_EPOCH            0xFFFFFFFF
+#define TX_DBM              14
+#define PATH_LOSS_1M_DB     25.0
+#define PATH_LOSS_EXPONENT  3.0
+#define SHADOWING_DB        4.0
+#define MIN_DISTANCE_M      100.0
+#define MAX_DISTANCE_M      3000.0
+#define PI                  3.14159265358979
+
+typedef struct {
+    double   pathLossDb;
+    uint32_t lastDelivered;     // epoch of the last delivered fix
+    TdmaNode tdma;
+} BenchNode;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t lost;
+    uint32_t fixes;
+    uint32_t frames;            // superframes
+    uint64_t frameUs;           // sum of their lengths
+    uint32_t atRate[PHY_NUM_PROFILES];
+    uint64_t txUs;
+    uint64_t rxUs;
+} BenchResult;
+
+typedef struct {
+    uint8_t     adr;
+    uint16_t    numNodes;
+    uint64_t    endUs;
+    uint32_t    rng;
+    BenchNode   nodes[MAX_NODES];
+    TdmaGateway gateway;
+    AdrGateway  adrGateway;
+    BenchResult result;
+} Bench;
+
+static double uniform(uint32_t * rng) {
+
+    return (simRandom(rng) + 0.5) / 4294967296.0;
+}
+
+static double gaussian(uint32_t * rng) {
+
+    return sqrt(-2.0 * log(uniform(rng))) * cos(2.0 * PI * uniform(rng));
+}
+
+/* RSSI of one frame between tracker n and the gateway, either way */
+static int8_t frameRssi(Bench * b, uint16_t n) {
+
+    double rssi = TX_DBM - b->nodes[n].pathLossDb + SHADOWING_DB * gaussian(&b->rng);
+
+    return (int8_t)(rssi < -128 ? -128 : rssi > 0 ? 0 : floor(rssi));
+}
+
+static void runFrame(Bench * b, uint64_t t) {
+
+    uint8_t beacon[PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS)];
+    uint8_t length = tdmaGatewayBuildBeacon(&b->gateway, beacon, sizeof(beacon));
+    const TdmaFrameConfig * cfg = &b->gateway.cfg;
+    uint8_t measured = t >= WARMUP_US;
+    uint16_t joiner[TDMA_MAX_SLOTS];
+    uint8_t joiners[TDMA_MAX_SLOTS];
+    uint16_t n;
+
+    memset(joiners, 0, sizeof(joiners));
+
+    for (n = 0; n < b->numNodes; ++n) {
+
+        BenchNode * node = &b->nodes[n];
+
+        if (measured)
+            b->result.rxUs += 2 * TDMA_GUARD_US + phyAirtimeUs(&phyProfiles[PHY_PROFILE], length);
+
+        if (frameRssi(b, n) < phyProfiles[PHY_PROFILE].sensitivityDbm ||
+            tdmaNodeOnBeacon(&node->tdma, beacon + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH)) {
+            tdmaNodeBeaconMissed(&node->tdma);
+            continue;
+        }
+
+        uint8_t slot = node->tdma.slot;
+
+        if (slot == TDMA_NO_SLOT) {
+            slot = tdmaNodeJoinSlot(&node->tdma, simRandom(&b->rng));
+            if (slot == TDMA_NO_SLOT)
+                continue;
+            if (measured)
+                b->result.txUs += phyAirtimeUs(&phyProfiles[PHY_PROFILE], PKT_HEADER_LENGTH);
+            if (frameRssi(b, n) >= phyProfiles[PHY_PROFILE].sensitivityDbm) {
+                joiner[slot - cfg->numSlots] = n;
+                ++joiners[slot - cfg->numSlots];
+            }
+            continue;
+        }
+
+        /* The latest fix, in our slot at the slot's rate */
+        uint8_t rate = node->tdma.cfg.rate[slot];
+        uint32_t epoch = (uint32_t)((t + tdmaSlotOffsetUs(&node->tdma.cfg, slot)) / SIM_FIX_PERIOD_US);
+        int8_t rssi = frameRssi(b, n);
+        uint8_t lost = rssi < phyProfiles[rate].sensitivityDbm;
+
+        if (!lost) {
+            uint8_t heard = tdmaGatewayHeard(&b->gateway, n + 1);
+            if (b->adr)
+                adrGatewayHeard(&b->adrGateway, heard, rssi);
+        }
+
+        if (measured) {
+            ++b->result.sent;
+            b->result.lost += lost;
+            ++b->result.atRate[rate];
+            b->result.txUs += phyAirtimeUs(&phyProfiles[rate], PKT_HEADER_LENGTH + SIM_GGA_LENGTH);
+            if (!lost && epoch != node->lastDelivered)
+                ++b->result.fixes;
+        }
+        if (!lost)
+            node->lastDelivered = epoch;
+    }
+
+    for (n = 0; n < cfg->numJoinSlots; ++n) {
+        if (joiners[n] == 1) {
+            uint8_t slot = tdmaGatewayJoin(&b->gateway, joiner[n] + 1);
+            if (b->adr)
+                adrGatewayJoin(&b->adrGateway, &b->gateway, slot);
+        }
+    }
+}
+
+static void benchRun(Bench * b, uint8_t adr, uint16_t numNodes, uint32_t seconds, uint32_t seed) {
+
+    memset(b, 0, sizeof(*b));
+    b->adr = adr;
+    b->numNodes = numNodes;
+    b->endUs = WARMUP_US + (uint64_t)seconds * 1000000ULL;
+    b->rng = seed;
+
+    /* One data slot per tracker, each long enough for a GGA frame at PHY_PROFILE */
+    TdmaFrameConfig cfg;
+    tdmaDefaultConfig(&cfg);
+    cfg.numSlots = (uint8_t)numNodes;
+    cfg.slotMs   = (uint16_t)((simAirtimeUs(PKT_HEADER_LENGTH + SIM_GGA_LENGTH) + 2 * TDMA_GUARD_US + 999) / 1000);
+    cfg.beaconMs = (uint16_t)((simAirtimeUs(PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(numNodes))
+                               + 2 * TDMA_GUARD_US + 999) / 1000);
+    tdmaGatewayInit(&b->gateway, &cfg);
+    adrGatewayInit(&b->adrGateway, PHY_NUM_PROFILES - 1);
+
+    uint16_t n;
+    for (n = 0; n < numNodes; ++n) {
+        /* Uniform over the area of the ring around the gateway */
+        double r2 = MIN_DISTANCE_M * MIN_DISTANCE_M +
+                    uniform(&b->rng) * (MAX_DISTANCE_M * MAX_DISTANCE_M - MIN_DISTANCE_M * MIN_DISTANCE_M);
+        b->nodes[n].pathLossDb = PATH_LOSS_1M_DB + 10.0 * PATH_LOSS_EXPONENT * log10(sqrt(r2));
+        b->nodes[n].lastDelivered = NO_EPOCH;
+        tdmaNodeInit(&b->nodes[n].tdma, n + 1);
+    }
+
+    uint64_t t = 0;
+    while (t < b->endUs) {
+
+        runFrame(b, t);
+
+        uint32_t frameUs = tdmaFrameLengthUs(&b->gateway.cfg);
+        if (t >= WARMUP_US) {
+            ++b->result.frames;
+            b->result.frameUs += frameUs;
+        }
+        t += frameUs;
+
+        if (adr)
+            adrGatewayEndFrame(&b->adrGateway, &b->gateway);
+        tdmaGatewayEndFrame(&b->gateway);
+    }
+}
+
+int main(int argc, char * argv[]) {
+
+    static const uint16_t nodeCounts[] = { 8, 16, 32 };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 3600;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    static Bench bench;
+    uint32_t i, r;
+    uint8_t adr;
+
+    if (seconds == 0 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# %u s measured after %llu s warm-up, base PHY %s, trackers %.0f m to %.0f m out\n",
+           seconds, (unsigned long long)(WARMUP_US / 1000000), phyProfiles[PHY_PROFILE].name,
+           MIN_DISTANCE_M, MAX_DISTANCE_M);
+    printf("%-6s %6s %10s %8s %10s %10s", "rate", "nodes", "fixes/s", "loss%", "frame ms", "mJ/fix");
+    for (r = 0; r < PHY_NUM_PROFILES; ++r)
+        printf(" %10s", phyProfiles[r].name);
+    printf("\n");
+
+    for (adr = 0; adr <= 1; ++adr) {
+        for (i = 0; i < sizeof(nodeCounts) / sizeof(nodeCounts[0]); ++i) {
+
+            benchRun(&bench, adr, nodeCounts[i], seconds, seed);
+
+            const BenchResult * res = &bench.result;
+            printf("%-6s %6u %10.3f %8.1f %10.1f %10.2f", adr ? "adr" : "fixed", nodeCounts[i],
+                   (double)res->fixes / seconds,
+                   res->sent ? 100.0 * res->lost / res->sent : 0.0,
+                   res->frames ? (double)res->frameUs / res->frames / 1000 : 0.0,
+                   res->fixes ? (double)simEnergyNj(res->txUs, res->rxUs) / res->fixes / 1e6 : 0.0);
+            for (r = 0; r < PHY_NUM_PROFILES; ++r)
+                printf(" %9.1f%%", res->sent ? 100.0 * res->atRate[r] / res->sent : 0.0);
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
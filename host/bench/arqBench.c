@@ -0,0 +1,398 @@
+//
+//  arqBench.c
+//  Delivery ratio versus radio energy of the acknowledged mode (arqMac.c) on top of CSMA
+//
+//  Trackers run the MAC_MODE_CSMA firmware loop: take a sentence when idle, echo it on the
+//  UART, send it after backoff and carrier sense, sleep PACKET_INTERVAL. With MAC_ACK every
+//  transmission is followed by the ACK window, and each transmit opportunity also resends
+//  the frames the gateway has not acknowledged yet. Besides collisions, every frame (DATA
+//  and ACK) is lost with a fixed link error rate, standing in for fading at range.
+//
+//  Energy counts the radio only: TX airtime, ACK windows and carrier sense at the CC1310
+//  supply currents in channelSim.h.
+//
+//  usage: arqBench [seconds] [seed]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arqMac.h"
+#include "channelSim.h"
+#include "csmaMac.h"
+#include "packetCodec.h"
+
+#define MAX_NODES           16
+#define GATEWAY             MAX_NODES       // medium source id of the gateway
+#define WARMUP_US           10000000ULL
+#define SLEEP_US            500000ULL       // PACKET_INTERVAL in rfPacketTx.c
+#define NO_EPOCH            0xFFFFFFFF
+#define CS_TURNAROUND_US    150             // CMD_PROP_CS end to CMD_PROP_TX start
+#define RX_TURNAROUND_US    150             // CMD_PROP_TX end to the chained CMD_PROP_RX
+#define GW_TURNAROUND_US    3000            // gateway: RX done, task wakes up, ACK on the air
+
+typedef enum {
+    EV_NODE_START,
+    EV_SENTENCE,    // arg: epoch << 1 | sentence
+    EV_READY,
+    EV_SENSE,       // arg: retry buffer entry
+    EV_TX_START,    // arg: retry buffer entry
+    EV_TX_END,      // arg: medium id
+    EV_ACK_START,   // node: tracker the ACK is for
+    EV_ACK_END,     // node: tracker the ACK is for, arg: medium id
+    EV_WINDOW_END
+} BenchEventType;
+
+typedef struct {
+    uint8_t  started;
+    uint8_t  ready;
+    uint16_t seq;
+    uint8_t  slot;              // retry buffer entry being sent
+    uint8_t  csmaAttempt;
+    uint8_t  windowOpen;
+    uint8_t  ackIncoming;       // an ACK found sync inside the window
+    uint64_t windowStart;
+    uint64_t windowEnd;
+    uint32_t lastDelivered;
+    ArqNode  arq;
+} BenchNode;
+
+typedef struct {
+    const char * name;
+    uint8_t      ack;
+    uint8_t      maxTries;
+    uint32_t     rxWindowUs;
+} BenchConfig;
+
+typedef struct {
+    uint32_t epochs;            // fixes the trackers had during the window
+    uint32_t fixes;             // fixes delivered at least once
+    uint32_t transmissions;
+    uint64_t txUs;
+    uint64_t rxUs;
+} BenchResult;
+
+typedef struct {
+    const BenchConfig * cfg;
+    uint16_t      numNodes;
+    uint32_t      linkLossPpm;
+    uint64_t      endUs;
+    uint32_t      rng;
+    SimEventQueue queue;
+    SimMedium     medium;
+    BenchNode     nodes[MAX_NODES];
+    BenchResult   result;
+    CsmaConfig    csma;
+    ArqGateway    gateway;
+} Bench;
+
+static uint8_t inWindow(const Bench * b, uint64_t t) {
+
+    return t >= WARMUP_US && t < b->endUs;
+}
+
+static uint8_t linkLost(Bench * b) {
+
+    return simRandomBelow(&b->rng, 1000000) < b->linkLossPpm;
+}
+
+/* Start the next transmission of this round, or go to sleep when it is over */
+static void nextFrame(Bench * b, uint16_t n, uint64_t t) {
+
+    BenchNode * node = &b->nodes[n];
+
+    node->slot = arqNodeNext(&node->arq);
+    if (node->slot == ARQ_NONE) {
+        simQueuePush(&b->queue, t + SLEEP_US, n, EV_READY, 0);
+        return;
+    }
+
+    node->csmaAttempt = 0;
+    simQueuePush(&b->queue, t + csmaBackoffUs(&b->csma, 0, simRandom(&b->rng)), n, EV_SENSE, node->slot);
+}
+
+static void closeWindow(Bench * b, uint16_t n, uint64_t t) {
+
+    BenchNode * node = &b->nodes[n];
+
+    if (inWindow(b, t))
+        b->result.rxUs += t - node->windowStart;
+
+    node->windowOpen = 0;
+    node->ackIncoming = 0;
+    arqNodeSent(&node->arq, node->slot);
+    nextFrame(b, n, t);
+}
+
+static void onSentence(Bench * b, uint16_t n, uint64_t t, uint32_t arg) {
+
+    BenchNode * node = &b->nodes[n];
+    uint32_t epoch = arg >> 1;
+    uint8_t sentence = arg & 1;
+
+    if (sentence == 0)
+        simQueuePush(&b->queue, t + (uint64_t)SIM_RMC_LENGTH * SIM_UART_BYTE_US, n, EV_SENTENCE, arg | 1);
+    else
+        simQueuePush(&b->queue, simSentenceDoneUs(epoch + 1, 0, &b->rng), n, EV_SENTENCE, (epoch + 1) << 1);
+
+    if (sentence == 0 && inWindow(b, t))
+        ++b->result.epochs;
+
+    if (!node->started || !node->ready)
+        return;
+
+    node->ready = 0;
+
+    /* The payload starts with the epoch so the gateway side knows which fix it carries */
+    uint8_t frame[ARQ_MAX_FRAME_LENGTH];
+    uint8_t length = PKT_HEADER_LENGTH + simSentenceLength(sentence);
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_DATA;
+    hdr.flags  = 0;
+    hdr.nodeId = (uint8_t)(n + 1);
+    hdr.seq    = node->seq++;
+
+    memset(frame, 0, sizeof(frame));
+    pktEncodeHeader(&hdr, frame);
+    memcpy(frame + PKT_HEADER_LENGTH, &epoch, sizeof(epoch));
+
+    arqNodeQueue(&node->arq, frame, length);
+    arqNodeStartRound(&node->arq);
+
+    nextFrame(b, n, t + (uint64_t)(length + 2) * SIM_UART_BYTE_US);
+}
+
+static void onSense(Bench * b, uint16_t n, uint64_t t, uint32_t slot) {
+
+    BenchNode * node = &b->nodes[n];
+    uint64_t senseEnd = t + b->csma.senseUs;
+
+    if (inWindow(b, t))
+        b->result.rxUs += b->csma.senseUs;
+
+    if (!simMediumBusy(&b->medium, 0, t, senseEnd)) {
+        simQueuePush(&b->queue, senseEnd + CS_TURNAROUND_US, n, EV_TX_START, slot);
+        return;
+    }
+
+    if (++node->csmaAttempt >= b->csma.maxAttempts) {
+        /* Counts against the retry budget like a transmission without ACK */
+        arqNodeSent(&node->arq, node->slot);
+        nextFrame(b, n, senseEnd);
+        return;
+    }
+
+    simQueuePush(&b->queue, senseEnd + csmaBackoffUs(&b->csma, node->csmaAttempt, simRandom(&b->rng)),
+                 n, EV_SENSE, slot);
+}
+
+static void onTxStart(Bench * b, uint16_t n, uint64_t t, uint32_t slot) {
+
+    uint64_t airtime = simAirtimeUs(b->nodes[n].arq.entry[slot].length);
+    uint32_t id = simMediumTransmit(&b->medium, n, 0, t, airtime);
+
+    simQueuePush(&b->queue, t + airtime, n, EV_TX_END, id);
+
+    if (inWindow(b, t)) {
+        ++b->result.transmissions;
+        b->result.txUs += airtime;
+    }
+}
+
+static void onTxEnd(Bench * b, uint16_t n, uint64_t t, uint32_t id) {
+
+    BenchNode * node = &b->nodes[n];
+    const ArqEntry * e = &node->arq.entry[node->slot];
+    uint8_t lost = simMediumCollided(&b->medium, id) || linkLost(b);
+
+    if (!lost) {
+        PacketHeader hdr;
+        uint32_t epoch;
+
+        pktDecodeHeader(&hdr, e->frame, e->length);
+        memcpy(&epoch, e->frame + PKT_HEADER_LENGTH, sizeof(epoch));
+
+        if (arqGatewayReceive(&b->gateway, hdr.nodeId, hdr.seq) && epoch != node->lastDelivered) {
+            node->lastDelivered = epoch;
+            if (inWindow(b, t))
+                ++b->result.fixes;
+        }
+
+        if (b->cfg->ack)
+            simQueuePush(&b->queue, t + GW_TURNAROUND_US, n, EV_ACK_START, 0);
+    }
+
+    if (!b->cfg->ack) {
+        arqNodeSent(&node->arq, node->slot);
+        nextFrame(b, n, t);
+    }
+    else {
+        node->windowOpen  = 1;
+        node->windowStart = t + RX_TURNAROUND_US;
+        node->windowEnd   = node->windowStart + b->cfg->rxWindowUs;
+        simQueuePush(&b->queue, node->windowEnd, n, EV_WINDOW_END, 0);
+    }
+
+    if (t > 1000000)
+        simMediumPrune(&b->medium, t - 1000000);
+}
+
+static void onAckStart(Bench * b, uint16_t n, uint64_t t) {
+
+    BenchNode * node = &b->nodes[n];
+    uint64_t airtime = simAirtimeUs(PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH);
+    uint32_t id = simMediumTransmit(&b->medium, GATEWAY, 0, t, airtime);
+
+    simQueuePush(&b->queue, t + airtime, n, EV_ACK_END, id);
+
+    if (node->windowOpen && t >= node->windowStart && t + simSyncUs() <= node->windowEnd)
+        node->ackIncoming = 1;
+}
+
+static void onAckEnd(Bench * b, uint16_t n, uint64_t t, uint32_t id) {
+
+    BenchNode * node = &b->nodes[n];
+
+    if (!node->ackIncoming)
+        return;
+
+    if (!simMediumCollided(&b->medium, id) && !linkLost(b)) {
+        uint8_t ack[PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH];
+        PacketHeader hdr;
+
+        arqGatewayBuildAck(&b->gateway, (uint8_t)(n + 1), ARQ_NO_RSSI, ack, sizeof(ack));
+        pktDecodeHeader(&hdr, ack, sizeof(ack));
+        arqNodeOnAck(&node->arq, hdr.seq, ack + PKT_HEADER_LENGTH, ARQ_ACK_PAYLOAD_LENGTH);
+    }
+
+    /* CMD_PROP_RX ends with the first frame, good or not */
+    closeWindow(b, n, t);
+}
+
+static void onWindowEnd(Bench * b, uint16_t n, uint64_t t) {
+
+    BenchNode * node = &b->nodes[n];
+
+    if (node->windowOpen && !node->ackIncoming && t >= node->windowEnd)
+        closeWindow(b, n, t);
+}
+
+static void benchRun(Bench * b, const BenchConfig * cfg, uint16_t numNodes, uint32_t linkLossPpm,
+                     uint32_t seconds, uint32_t seed) {
+
+    memset(b, 0, sizeof(*b));
+    b->cfg = cfg;
+    b->numNodes = numNodes;
+    b->linkLossPpm = linkLossPpm;
+    b->endUs = WARMUP_US + (uint64_t)seconds * 1000000ULL;
+    b->rng = seed;
+
+    simQueueInit(&b->queue, 1024);
+    simMediumInit(&b->medium, 256);
+    csmaDefaultConfig(&b->csma);
+    arqGatewayInit(&b->gateway);
+
+    /* Without ACKs every frame is sent exactly once */
+    ArqConfig arq;
+    arqDefaultConfig(&arq);
+    arq.maxTries   = cfg->ack ? cfg->maxTries : 1;
+    arq.rxWindowUs = cfg->rxWindowUs;
+
+    uint16_t n;
+    for (n = 0; n < numNodes; ++n) {
+        b->nodes[n].ready = 1;
+        b->nodes[n].lastDelivered = NO_EPOCH;
+        arqNodeInit(&b->nodes[n].arq, &arq);
+        simQueuePush(&b->queue, simRandomBelow(&b->rng, 5000000), n, EV_NODE_START, 0);
+        simQueuePush(&b->queue, simSentenceDoneUs(0, 0, &b->rng), n, EV_SENTENCE, 0);
+    }
+
+    SimEvent ev;
+
+    while (simQueuePop(&b->queue, &ev) == 0 && ev.time < b->endUs) {
+
+        switch (ev.type) {
+
+            case EV_NODE_START:
+                b->nodes[ev.node].started = 1;
+                break;
+            case EV_SENTENCE:
+                onSentence(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_READY:
+                b->nodes[ev.node].ready = 1;
+                break;
+            case EV_SENSE:
+                onSense(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_TX_START:
+                onTxStart(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_TX_END:
+                onTxEnd(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_ACK_START:
+                onAckStart(b, ev.node, ev.time);
+                break;
+            case EV_ACK_END:
+                onAckEnd(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_WINDOW_END:
+                onWindowEnd(b, ev.node, ev.time);
+                break;
+
+        }
+    }
+
+    simQueueFree(&b->queue);
+    simMediumFree(&b->medium);
+}
+
+int main(int argc, char * argv[]) {
+
+    static const BenchConfig configs[] = {
+        { "off",      0, 1,  0     },
+        { "2/40ms",   1, 2,  40000 },
+        { "3/40ms",   1, 3,  40000 },
+        { "5/40ms",   1, 5,  40000 },
+        { "3/20ms",   1, 3,  20000 },
+        { "3/10ms",   1, 3,  10000 },
+    };
+    static const uint16_t nodeCounts[] = { 1, 8, 16 };
+    static const uint32_t linkLoss[]   = { 0, 200000 };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 600;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    static Bench bench;
+
+    if (seconds == 0 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# %u s measured, csma, ack = tries/window, energy is radio only\n", seconds);
+    printf("%-8s %6s %6s %10s %8s %10s %10s\n",
+           "ack", "nodes", "per%", "delivery%", "tx/fix", "mJ/fix", "mW/node");
+
+    uint32_t c, i, p;
+    for (p = 0; p < sizeof(linkLoss) / sizeof(linkLoss[0]); ++p) {
+        for (i = 0; i < sizeof(nodeCounts) / sizeof(nodeCounts[0]); ++i) {
+            for (c = 0; c < sizeof(configs) / sizeof(configs[0]); ++c) {
+
+                benchRun(&bench, &configs[c], nodeCounts[i], linkLoss[p], seconds, seed);
+
+                const BenchResult * r = &bench.result;
+                double energyMj = (double)simEnergyNj(r->txUs, r->rxUs) / 1e6;
+
+                printf("%-8s %6u %6.0f %10.1f %8.2f %10.2f %10.3f\n", configs[c].name, nodeCounts[i],
+                       linkLoss[p] / 10000.0,
+                       r->epochs ? 100.0 * r->fixes / r->epochs : 0.0,
+                       r->fixes ? (double)r->transmissions / r->fixes : 0.0,
+                       r->fixes ? energyMj / r->fixes : 0.0,
+                       energyMj / seconds / nodeCounts[i]);
+            }
+        }
+    }
+
+    return 0;
+}
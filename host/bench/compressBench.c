@@ -0,0 +1,205 @@
+//
+//  compressBench.c
+//  Trajectory simplification (trackCompress.c) on simulated GPS tracks: how many fixes
+//  become vertices and how far the track redrawn from the vertices is off
+//
+//  Tracks come from trackSim.h, one GGA fix per second as the tracker reports it. The
+//  receiver redraws the track by interpolating linearly in time between vertices; "max err"
+//  is the largest distance of a reported fix from that, "rms true" the error against the
+//  ground truth (the receiver noise included). A dead-band reporter, which sends a fix
+//  whenever it is more than the tolerance away from the last one sent, is the baseline.
+//
+//  usage: compressBench [seconds] [seed]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trackCompress.h"
+#include "trackSim.h"
+
+typedef struct {
+    const char * name;
+    SimTrackKind kind;
+} TrackProfile;
+
+typedef struct {
+    uint32_t fixes;
+    uint32_t vertices;
+    uint64_t ns;
+    double   maxError;          // m, against the reported fixes
+    double   trueSq;            // m^2, against the truth
+} CompressResult;
+
+static uint64_t nowNs(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Track redrawn from the vertices, compared with what was reported and with the truth */
+static void score(const FixRecord * fixes, const SimFix * truth, uint32_t n,
+                  const FixRecord * vertices, uint32_t numVertices, CompressResult * res) {
+
+    uint32_t i, v = 0;
+
+    res->maxError = 0;
+    res->trueSq = 0;
+
+    for (i = 0; i < n; ++i) {
+
+        double east, north, e0, n0, e1, n1;
+
+        while (v + 1 < numVertices && vertices[v + 1].timeMs <= fixes[i].timeMs)
+            ++v;
+
+        simTrackFromLatLon(vertices[v].latE7, vertices[v].lonE7, &e0, &n0);
+        if (v + 1 < numVertices) {
+            double f = (double)(fixes[i].timeMs - vertices[v].timeMs) /
+                       (vertices[v + 1].timeMs - vertices[v].timeMs);
+            simTrackFromLatLon(vertices[v + 1].latE7, vertices[v + 1].lonE7, &e1, &n1);
+            east  = e0 + (e1 - e0) * f;
+            north = n0 + (n1 - n0) * f;
+        }
+        else {
+            east  = e0;
+            north = n0;
+        }
+
+        double fe, fn;
+        simTrackFromLatLon(fixes[i].latE7, fixes[i].lonE7, &fe, &fn);
+
+        double err = hypot(east - fe, north - fn);
+        if (err > res->maxError)
+            res->maxError = err;
+
+        res->trueSq += (east - truth[i].trueEast) * (east - truth[i].trueEast) +
+                       (north - truth[i].trueNorth) * (north - truth[i].trueNorth);
+    }
+
+    res->fixes = n;
+    res->vertices = numVertices;
+}
+
+static void runCompressor(const FixRecord * fixes, const SimFix * truth, uint32_t n,
+                          const TrackCompressConfig * config, FixRecord * vertices, CompressResult * res) {
+
+    TrackCompressor c;
+    uint32_t i, numVertices = 0;
+    uint64_t ns = 0;
+
+    trackCompressInit(&c, config);
+
+    for (i = 0; i < n; ++i) {
+        uint64_t t0 = nowNs();
+        uint8_t got = trackCompressPush(&c, &fixes[i], &vertices[numVertices]);
+        ns += nowNs() - t0;
+        numVertices += got;
+    }
+    numVertices += trackCompressFlush(&c, &vertices[numVertices]);
+
+    score(fixes, truth, n, vertices, numVertices, res);
+    res->ns = ns;
+}
+
+static void runDeadBand(const FixRecord * fixes, const SimFix * truth, uint32_t n, uint16_t toleranceCm,
+                        FixRecord * vertices, CompressResult * res) {
+
+    uint32_t i, numVertices = 0;
+    double lastEast = 0, lastNorth = 0;
+
+    for (i = 0; i < n; ++i) {
+
+        double east, north;
+        simTrackFromLatLon(fixes[i].latE7, fixes[i].lonE7, &east, &north);
+
+        if (i == 0 || i == n - 1 || hypot(east - lastEast, north - lastNorth) > toleranceCm / 100.0) {
+            vertices[numVertices++] = fixes[i];
+            lastEast = east;
+            lastNorth = north;
+        }
+    }
+
+    score(fixes, truth, n, vertices, numVertices, res);
+    res->ns = 0;
+}
+
+static void printRow(const char * track, const char * method, uint16_t toleranceCm, uint8_t window,
+                     const CompressResult * r) {
+
+    char windowText[8];
+
+    snprintf(windowText, sizeof(windowText), window ? "%u" : "-", window);
+    printf("%-8s %-10s %6.0fm %6s %8u %9u %7.1f %8.1fm %9.2fm %8.0f\n", track, method, toleranceCm / 100.0,
+           windowText, r->fixes, r->vertices, (double)r->fixes / r->vertices, r->maxError,
+           sqrt(r->trueSq / r->fixes), r->ns ? (double)r->ns / r->fixes : 0.0);
+}
+
+int main(int argc, char * argv[]) {
+
+    static const TrackProfile profiles[] = {
+        { "parked", SIM_TRACK_PARKED },
+        { "walk",   SIM_TRACK_WALK },
+        { "drive",  SIM_TRACK_DRIVE },
+    };
+    static const uint16_t tolerances[] = { 500, 1000, 2500, 5000 };
+    static const uint8_t windows[] = { 8, TRACK_COMPRESS_MAX_WINDOW };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 7200;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    uint32_t k, i, t, w;
+
+    if (seconds == 0 || seconds > 86400 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds up to 86400] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    FixRecord * fixes = malloc(seconds * sizeof(FixRecord));
+    FixRecord * vertices = malloc(seconds * sizeof(FixRecord));
+    SimFix * truth = malloc(seconds * sizeof(SimFix));
+
+    printf("# %u s per track, seed %u, max gap 300 s\n", seconds, seed);
+    printf("%-8s %-10s %7s %6s %8s %9s %7s %9s %10s %8s\n", "track", "method", "tol", "window",
+           "fixes", "vertices", "ratio", "max err", "rms true", "ns/fix");
+
+    for (k = 0; k < sizeof(profiles) / sizeof(profiles[0]); ++k) {
+
+        SimTrack track;
+        simTrackInit(&track, profiles[k].kind, seed + k);
+
+        for (i = 0; i < seconds; ++i) {
+            simTrackStep(&track, &truth[i]);
+            fixes[i].timeMs = i * 1000;
+            fixes[i].altM = 0;
+            simTrackToLatLon(truth[i].measEast, truth[i].measNorth, &fixes[i].latE7, &fixes[i].lonE7);
+        }
+
+        for (t = 0; t < sizeof(tolerances) / sizeof(tolerances[0]); ++t) {
+
+            CompressResult r;
+
+            runDeadBand(fixes, truth, seconds, tolerances[t], vertices, &r);
+            printRow(profiles[k].name, "dead-band", tolerances[t], 0, &r);
+
+            for (w = 0; w < sizeof(windows) / sizeof(windows[0]); ++w) {
+
+                TrackCompressConfig config;
+                trackCompressDefaultConfig(&config);
+                config.toleranceCm = tolerances[t];
+                config.window = windows[w];
+
+                runCompressor(fixes, truth, seconds, &config, vertices, &r);
+                printRow(profiles[k].name, "window", tolerances[t], windows[w], &r);
+            }
+        }
+    }
+
+    free(fixes);
+    free(vertices);
+    free(truth);
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+//
+//  fenceBench.c
+//  Geofence engine (geoFence.c) on a simulated driving track: fence checks per second with
+//  the grid index against testing every fence, and the reports the events leave
+//
+//  Fence sets of 10 to 1000 fences are scattered over the area the track covers, 70 %
+//  star shaped polygons of 4 to 12 vertices and 100 to 600 m across, 30 % circles of 50 to
+//  300 m radius. Each fix of the track is looked up
+//
+//      all     geoFenceContains() on every fence
+//      box     every fence's bounding box first, then the shape
+//      grid    geoFenceLookup(): the fences of the fix's grid cell, box first
+//
+//  and the three must agree. "tests" are shape tests per check. The tracker then runs
+//  geoFenceCheck() with the default config; "reports" are fixes that raised an event,
+//  heartbeats included, which is what goes out instead of one frame per fix.
+//
+//  usage: fenceBench [seconds] [seed]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "channelSim.h"
+#include "geoFence.h"
+#include "trackSim.h"
+
+#define MAX_VERTICES        12
+#define MAX_HITS            64
+#define MARGIN_M            500.0
+#define PASSES              5
+
+static uint64_t nowNs(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double randomBetween(uint32_t * rng, double lo, double hi) {
+
+    return lo + (hi - lo) * simRandomBelow(rng, 1000000) / 1000000.0;
+}
+
+/* numFences fences within the box, in fences[] and vertices[] */
+static void makeFences(uint16_t numFences, uint32_t * rng, double minEast, double minNorth,
+                       double maxEast, double maxNorth, GeoFence * fences, GeoPoint * vertices) {
+
+    uint32_t next = 0;
+    uint16_t i;
+    uint8_t k;
+
+    for (i = 0; i < numFences; ++i) {
+
+        double east  = randomBetween(rng, minEast, maxEast);
+        double north = randomBetween(rng, minNorth, maxNorth);
+
+        fences[i].id = i;
+        fences[i].first = next;
+
+        if (simRandomBelow(rng, 10) < 3) {
+            fences[i].shape = GEOFENCE_CIRCLE;
+            fences[i].numVertices = 0;
+            fences[i].radiusCm = (uint32_t)(randomBetween(rng, 50, 300) * 100);
+            simTrackToLatLon(east, north, &vertices[next].latE7, &vertices[next].lonE7);
+            ++next;
+            continue;
+        }
+
+        /* Star shaped: vertices at increasing angles, each at its own distance */
+        fences[i].shape = GEOFENCE_POLYGON;
+        fences[i].numVertices = (uint8_t)(4 + simRandomBelow(rng, MAX_VERTICES - 3));
+        fences[i].radiusCm = 0;
+
+        double size = randomBetween(rng, 50, 300);
+        for (k = 0; k < fences[i].numVertices; ++k) {
+            double angle = 2 * M_PI * (k + randomBetween(rng, 0.1, 0.9)) / fences[i].numVertices;
+            double r = size * randomBetween(rng, 0.4, 1.0);
+            simTrackToLatLon(east + r * sin(angle), north + r * cos(angle),
+                             &vertices[next].latE7, &vertices[next].lonE7);
+            ++next;
+        }
+    }
+}
+
+int main(int argc, char * argv[]) {
+
+    static const uint16_t sizes[] = { 10, 30, 100, 300, 1000 };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 7200;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    double minEast = 0, minNorth = 0, maxEast = 0, maxNorth = 0;
+    uint32_t s, p, k;
+    uint16_t i;
+
+    if (seconds == 0 || seconds > 86400 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds up to 86400] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    /* The track, and the area the fences go into */
+    FixRecord * fixes = malloc(seconds * sizeof(FixRecord));
+    SimTrack track;
+    simTrackInit(&track, SIM_TRACK_DRIVE, seed);
+
+    for (s = 0; s < seconds; ++s) {
+        SimFix fix;
+        simTrackStep(&track, &fix);
+        fixes[s].timeMs = s * 1000;
+        fixes[s].altM = 0;
+        simTrackToLatLon(fix.measEast, fix.measNorth, &fixes[s].latE7, &fixes[s].lonE7);
+        if (fix.trueEast < minEast) minEast = fix.trueEast;
+        if (fix.trueEast > maxEast) maxEast = fix.trueEast;
+        if (fix.trueNorth < minNorth) minNorth = fix.trueNorth;
+        if (fix.trueNorth > maxNorth) maxNorth = fix.trueNorth;
+    }
+
+    printf("# %u s drive over %.1f x %.1f km, seed %u, %u passes, default GeoFenceConfig\n", seconds,
+           (maxEast - minEast + 2 * MARGIN_M) / 1000, (maxNorth - minNorth + 2 * MARGIN_M) / 1000, seed, PASSES);
+    printf("%6s %10s %10s %10s %7s %9s %9s %8s %8s\n", "fences", "all/s", "box/s", "grid/s",
+           "tests", "index B", "mismatch", "events", "reports");
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+
+        uint16_t numFences = sizes[k];
+        uint32_t rng = seed * 7919 + k;
+        GeoFence * fences = malloc(numFences * sizeof(GeoFence));
+        GeoPoint * vertices = malloc(numFences * MAX_VERTICES * sizeof(GeoPoint));
+
+        makeFences(numFences, &rng, minEast - MARGIN_M, minNorth - MARGIN_M, maxEast + MARGIN_M,
+                   maxNorth + MARGIN_M, fences, vertices);
+
+        GeoFenceSet set = { fences, numFences, vertices };
+        GeoFenceConfig config;
+        GeoFencer fencer;
+        uint32_t indexSize = geoFenceIndexSize(&set);
+        GeoFenceBox * boxes = malloc(numFences * sizeof(GeoFenceBox));
+        uint16_t * entries = malloc((indexSize + 1) * sizeof(uint16_t));
+
+        geoFenceDefaultConfig(&config);
+        if (geoFenceInit(&fencer, &config, &set, boxes, entries, indexSize)) {
+            fprintf(stderr, "index of %u fences too large\n", numFences);
+            return 1;
+        }
+
+        /* The three lookups, hit counts compared fix by fix */
+        uint32_t hitsAll[2] = { 0, 0 }, hitsBox = 0, hitsGrid = 0, mismatches = 0;
+        uint64_t nsAll = 0, nsBox = 0, nsGrid = 0;
+        uint16_t hits[MAX_HITS];
+
+        for (p = 0; p < PASSES; ++p) {
+
+            uint64_t t0 = nowNs();
+            for (s = 0; s < seconds; ++s)
+                for (i = 0; i < numFences; ++i)
+                    hitsAll[s & 1] += geoFenceContains(&set, i, fixes[s].latE7, fixes[s].lonE7);
+            uint64_t t1 = nowNs();
+            for (s = 0; s < seconds; ++s)
+                for (i = 0; i < numFences; ++i)
+                    if (fixes[s].latE7 >= boxes[i].minLatE7 && fixes[s].latE7 <= boxes[i].maxLatE7 &&
+                        fixes[s].lonE7 >= boxes[i].minLonE7 && fixes[s].lonE7 <= boxes[i].maxLonE7)
+                        hitsBox += geoFenceContains(&set, i, fixes[s].latE7, fixes[s].lonE7);
+            uint64_t t2 = nowNs();
+            for (s = 0; s < seconds; ++s)
+                hitsGrid += geoFenceLookup(&fencer, fixes[s].latE7, fixes[s].lonE7, hits, MAX_HITS);
+            uint64_t t3 = nowNs();
+
+            nsAll += t1 - t0;
+            nsBox += t2 - t1;
+            nsGrid += t3 - t2;
+        }
+
+        for (s = 0; s < seconds; ++s) {
+            uint8_t all = 0;
+            for (i = 0; i < numFences; ++i)
+                all += geoFenceContains(&set, i, fixes[s].latE7, fixes[s].lonE7);
+            if (all != geoFenceLookup(&fencer, fixes[s].latE7, fixes[s].lonE7, hits, MAX_HITS))
+                ++mismatches;
+        }
+        if (hitsAll[0] + hitsAll[1] != hitsBox || hitsBox != hitsGrid)
+            ++mismatches;
+
+        /* What the tracker reports */
+        uint32_t events = 0, reports = 0;
+        GeoFenceEvent fenceEvents[GEOFENCE_MAX_EVENTS];
+
+        geoFenceInit(&fencer, &config, &set, boxes, entries, indexSize);
+        for (s = 0; s < seconds; ++s) {
+            uint8_t n = geoFenceCheck(&fencer, &fixes[s], fenceEvents);
+            events += n;
+            reports += n > 0;
+        }
+
+        double checks = (double)seconds * PASSES;
+        printf("%6u %10.0f %10.0f %10.0f %7.2f %9lu %9u %8u %8u\n", numFences,
+               checks * 1e9 / nsAll, checks * 1e9 / nsBox, checks * 1e9 / nsGrid,
+               (double)fencer.shapeTests / seconds,
+               (unsigned long)(sizeof(GeoFencer) + numFences * sizeof(GeoFenceBox) + indexSize * sizeof(uint16_t)),
+               mismatches, events, reports);
+
+        free(fences);
+        free(vertices);
+        free(boxes);
+        free(entries);
+    }
+
+    free(fixes);
+
+    return 0;
+}
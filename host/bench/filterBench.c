@@ -0,0 +1,189 @@
+//
+//  filterBench.c
+//  The tracker's fix filter (fixFilter.c) on simulated GPS tracks: cost per update,
+//  position error before and after filtering, outliers caught and sentences saved
+//
+//  Tracks come from trackSim.h. Every epoch yields a GGA (position) and an RMC (position,
+//  speed, course) sentence, as the firmware sees them; without the filter both are sent.
+//
+//  "DR" is the track a receiver gets back by extrapolating each sent fix at its velocity
+//  until the next one, compared with the truth.
+//
+//  usage: filterBench [seconds] [seed]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC    1
+#endif
+
+#include "channelSim.h"
+#include "fixFilter.h"
+#include "trackSim.h"
+
+typedef struct {
+    const char * name;
+    SimTrackKind kind;
+} TrackProfile;
+
+typedef struct {
+    uint32_t epochs;
+    uint32_t sentences;
+    uint32_t sent;
+    uint32_t jumps;             // epochs with a multipath jump
+    uint32_t caught;            // of those flagged as outliers
+    uint32_t falseRejects;      // good epochs flagged as outliers
+    uint64_t ns;
+    uint64_t cycles;
+    double   rawSq, rawMax;
+    double   filteredSq, filteredMax;
+    double   drSq, drMax;
+} TrackResult;
+
+static uint64_t nowNs(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t cycleCount(void) {
+
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void addError(double * sq, double * max, double dEast, double dNorth) {
+
+    double e2 = dEast * dEast + dNorth * dNorth;
+    *sq += e2;
+    if (sqrt(e2) > *max)
+        *max = sqrt(e2);
+}
+
+static void runTrack(const TrackProfile * profile, uint32_t seconds, uint32_t seed, TrackResult * res) {
+
+    FixFilterConfig config;
+    FixFilter filter;
+    SimTrack track;
+    SimFix fix;
+    double drEast = 0, drNorth = 0, drVelEast = 0, drVelNorth = 0;
+    uint32_t drTime = 0;
+    uint8_t haveDr = 0;
+    uint32_t s;
+    uint8_t k;
+
+    memset(res, 0, sizeof(*res));
+    simTrackInit(&track, profile->kind, seed);
+
+    fixFilterDefaultConfig(&config);
+    fixFilterInit(&filter, &config);
+
+    for (s = 0; s < seconds; ++s) {
+
+        simTrackStep(&track, &fix);
+        if (fix.jumped)
+            ++res->jumps;
+
+        FixMeasurement m;
+        m.timeMs = (s * 1000) % 86400000;
+        simTrackToLatLon(fix.measEast, fix.measNorth, &m.latE7, &m.lonE7);
+
+        /* GGA, then RMC of the same epoch */
+        uint8_t flagged = 0;
+        for (k = 0; k < SIM_SENTENCES_PER_FIX; ++k) {
+
+            m.speedCmS   = FIX_FILTER_NO_SPEED;
+            m.courseCdeg = 0;
+            if (k == 1)
+                simTrackSpeedCourse(fix.velEast, fix.velNorth, &m.speedCmS, &m.courseCdeg);
+
+            uint64_t c0 = cycleCount();
+            uint64_t t0 = nowNs();
+            FixFilterVerdict verdict = fixFilterUpdate(&filter, &m);
+            uint64_t t1 = nowNs();
+            uint64_t c1 = cycleCount();
+
+            res->ns += t1 - t0;
+            res->cycles += c1 - c0;
+            ++res->sentences;
+
+            if (verdict == FIX_FILTER_OUTLIER)
+                flagged = 1;
+
+            if (verdict == FIX_FILTER_SEND) {
+                ++res->sent;
+                int32_t latE7, lonE7;
+                fixFilterPosition(&filter, &latE7, &lonE7);
+                simTrackFromLatLon(latE7, lonE7, &drEast, &drNorth);
+                drVelEast = filter.east.vel / 100.0;
+                drVelNorth = filter.north.vel / 100.0;
+                drTime = s;
+                haveDr = 1;
+            }
+        }
+
+        ++res->epochs;
+        if (fix.jumped && flagged)
+            ++res->caught;
+        if (!fix.jumped && flagged)
+            ++res->falseRejects;
+
+        int32_t latE7, lonE7;
+        double estEast, estNorth;
+        fixFilterPosition(&filter, &latE7, &lonE7);
+        simTrackFromLatLon(latE7, lonE7, &estEast, &estNorth);
+
+        addError(&res->rawSq, &res->rawMax, fix.measEast - fix.trueEast, fix.measNorth - fix.trueNorth);
+        addError(&res->filteredSq, &res->filteredMax, estEast - fix.trueEast, estNorth - fix.trueNorth);
+        if (haveDr)
+            addError(&res->drSq, &res->drMax, drEast + drVelEast * (s - drTime) - fix.trueEast,
+                     drNorth + drVelNorth * (s - drTime) - fix.trueNorth);
+    }
+}
+
+int main(int argc, char * argv[]) {
+
+    static const TrackProfile profiles[] = {
+        { "parked", SIM_TRACK_PARKED },
+        { "walk",   SIM_TRACK_WALK },
+        { "drive",  SIM_TRACK_DRIVE },
+    };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 7200;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    uint32_t k;
+
+    if (seconds == 0 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# %u s per track, seed %u, default FixFilterConfig\n", seconds, seed);
+    printf("%-8s %8s %8s %9s %9s %9s %9s %8s %8s %8s %7s %7s\n", "track", "ns/upd", "cyc/upd",
+           "raw rms", "raw max", "filt rms", "filt max", "DR rms", "DR max", "caught", "false", "saved");
+
+    for (k = 0; k < sizeof(profiles) / sizeof(profiles[0]); ++k) {
+
+        TrackResult r;
+        runTrack(&profiles[k], seconds, seed + k, &r);
+
+        char caught[16];
+        snprintf(caught, sizeof(caught), "%u/%u", r.caught, r.jumps);
+
+        printf("%-8s %8.0f %8.0f %8.2fm %8.1fm %8.2fm %8.1fm %7.2fm %7.1fm %8s %7u %6.1f%%\n",
+               profiles[k].name, (double)r.ns / r.sentences, (double)r.cycles / r.sentences,
+               sqrt(r.rawSq / r.epochs), r.rawMax, sqrt(r.filteredSq / r.epochs), r.filteredMax,
+               sqrt(r.drSq / r.epochs), r.drMax, caught, r.falseRejects,
+               100.0 * (r.sentences - r.sent) / r.sentences);
+    }
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+//
+//  gateBench.c
+//  Fix quality gate (fixGate.c) on NMEA streams: how many GGA/RMC frames the tracker no
+//  longer sends, and how far off the ones it still sends are
+//
+//  Each stream goes through gpsParser.c and the gate the way the FIX_GATE tracker runs them:
+//  every sentence updates the quality state, a GGA or RMC is sent if the gate passes it.
+//  Without the gate every GGA and RMC is sent, with or without a position.
+//
+//  Simulated streams come from nmeaSim.h: a walking and a driving track (trackSim.h) under a
+//  sky that moves between open sky, urban canyon and indoors, position noise scaled with the
+//  conditions. The error is that of the fixes sent against the truth. A recorded log (any
+//  receiver's NMEA output, one sentence per line) can be run instead; it has no truth.
+//
+//  usage: gateBench [seconds] [seed]
+//         gateBench -f log.nmea
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fixGate.h"
+#include "gpsParser.h"
+#include "nmeaSim.h"
+#include "trackSim.h"
+
+static const char * const reasonNames[FIX_GATE_REASONS] = {
+    "pass", "no fix", "sats", "mode", "HDOP", "PDOP", "VDOP"
+};
+
+static const NMEAHandler gateHandlers[] = {
+    { NMEA_GGA, nmeaParseGGA },
+    { NMEA_RMC, nmeaParseRMC },
+    { NMEA_GSA, nmeaParseGSA },
+    { NMEA_GSV, nmeaParseGSV },
+};
+
+static const char * const systemNames[NMEA_SYSTEMS] = {
+    "GPS", "GLONASS", "Galileo", "BeiDou", "other"
+};
+
+typedef struct {
+    uint32_t frames;            // GGA and RMC
+    uint32_t sent;
+    uint32_t empty;             // frames without a position, ungated
+    double   sq[2];             // error^2 of fixes sent without / with the gate
+    uint32_t fixes[2];
+    double   max[2];
+    uint32_t epochs[SIM_SKY_INDOOR + 1];
+} GateResult;
+
+/* As the tracker: quality of the parsed state */
+static void qualityOf(const GPSData * d, FixQuality * q) {
+
+    q->quality    = d->status == 'V' ? 0 : d->fixQuality;
+    q->satellites = d->numSatellites;
+    q->fixMode    = d->fixMode;
+    q->hdop       = d->hdop < 600 ? (uint16_t)(d->hdop * 100 + 0.5) : 60000;
+    q->pdop       = d->fixMode == 0 ? FIX_GATE_NO_DOP : d->pdop < 600 ? (uint16_t)(d->pdop * 100 + 0.5) : 60000;
+    q->vdop       = d->fixMode == 0 ? FIX_GATE_NO_DOP : d->vdop < 600 ? (uint16_t)(d->vdop * 100 + 0.5) : 60000;
+}
+
+/* One sentence through parser and gate. Returns -1 unless it is a GGA or RMC, else whether
+ * the gate sends it */
+static int gateSentence(GPSData * data, FixGate * gate, char * line) {
+
+    FixQuality q;
+
+    if (nmeaReceiveSentence(data, line))
+        return -1;
+    nmeaParse(data);
+    if (data->nmeaData.msgType != NMEA_GGA && data->nmeaData.msgType != NMEA_RMC)
+        return -1;
+
+    if (data->nmeaData.msgType == NMEA_RMC && data->status != 'A')
+        data->fixQuality = 0;
+
+    uint32_t hhmmss = (uint32_t)data->time;
+    uint32_t timeMs = ((hhmmss / 10000) * 3600 + (hhmmss / 100 % 100) * 60 + hhmmss % 100) * 1000;
+
+    qualityOf(data, &q);
+    return fixGateCheck(gate, &q, timeMs);
+}
+
+static void runSimulated(SimTrackKind kind, uint32_t seconds, uint32_t seed, FixGate * gate, GateResult * r) {
+
+    SimTrack track;
+    SimSky sky;
+    GPSData data;
+    FixGateConfig config;
+    uint32_t s;
+    uint8_t k;
+
+    memset(r, 0, sizeof(*r));
+    simTrackInit(&track, kind, seed);
+    simSkyInit(&sky, seed * 31 + 7);
+    nmeaDataInit(&data);
+    fixGateDefaultConfig(&config);
+    fixGateInit(gate, &config);
+
+    for (s = 0; s < seconds; ++s) {
+
+        SimFix fix;
+        SimNmeaEpoch e;
+        char lines[4][SIM_NMEA_MAX_LENGTH];
+
+        simTrackStep(&track, &fix);
+        simSkyStep(&sky, &e.sky);
+        ++r->epochs[e.sky.kind];
+
+        double east  = fix.trueEast + (fix.measEast - fix.trueEast) * e.sky.errorScale;
+        double north = fix.trueNorth + (fix.measNorth - fix.trueNorth) * e.sky.errorScale;
+        double speed = hypot(fix.velEast, fix.velNorth);
+
+        e.timeMs = (43200 + s) % 86400 * 1000;
+        e.day = 19;
+        e.month = 9;
+        e.year = 2026;
+        e.altM = 41.2;
+        e.speedKn = speed / 0.514444;
+        e.courseDeg = fmod(atan2(fix.velEast, fix.velNorth) * 180 / M_PI + 360, 360);
+        simTrackToLatLon(east, north, &e.latE7, &e.lonE7);
+
+        /* The order of a u-blox module: RMC, VTG, GGA, GSA */
+        simNmeaRMC(&e, "GN", lines[0]);
+        simNmeaVTG(&e, "GN", lines[1]);
+        simNmeaGGA(&e, "GN", lines[2]);
+        simNmeaGSA(&e, "GN", lines[3]);
+
+        for (k = 0; k < 4; ++k) {
+
+            int verdict = gateSentence(&data, gate, lines[k]);
+            if (verdict < 0)
+                continue;
+
+            ++r->frames;
+            if (e.sky.quality == 0) {
+                ++r->empty;
+                continue;
+            }
+
+            double err = hypot(east - fix.trueEast, north - fix.trueNorth);
+            uint8_t w;
+            for (w = 0; w < 2; ++w) {
+                if (w == 1 && !verdict)
+                    break;
+                r->sq[w] += err * err;
+                ++r->fixes[w];
+                if (err > r->max[w])
+                    r->max[w] = err;
+            }
+            r->sent += verdict;
+        }
+    }
+}
+
+static void printReasons(const FixGate * gate) {
+
+    uint8_t i;
+
+    for (i = 1; i < FIX_GATE_REASONS; ++i)
+        printf(" %s %u", reasonNames[i], gate->rejected[i]);
+    printf(", forced %u\n", gate->forced);
+}
+
+static int runLog(const char * path) {
+
+    FILE * f = fopen(path, "r");
+    char line[256];
+    GPSData data;
+    FixGate gate;
+    FixGateConfig config;
+    NMEASystemSummary systems[NMEA_SYSTEMS];
+    uint32_t frames = 0, sent = 0;
+    uint8_t i;
+
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    nmeaDataInit(&data);
+    fixGateDefaultConfig(&config);
+    fixGateInit(&gate, &config);
+
+    while (fgets(line, sizeof(line), f)) {
+        int verdict = gateSentence(&data, &gate, line);
+        if (verdict < 0)
+            continue;
+        ++frames;
+        sent += verdict;
+    }
+    fclose(f);
+
+    printf("# %s, default FixGateConfig\n", path);
+    printf("GGA/RMC frames %u, sent %u, saved %.1f%%\nrejected:", frames, sent,
+           frames ? 100.0 * (frames - sent) / frames : 0.0);
+    printReasons(&gate);
+
+    /* Constellations at the end of the log */
+    nmeaSystemSummary(&data, systems);
+    for (i = 0; i < NMEA_SYSTEMS; ++i)
+        if (systems[i].inView || systems[i].used)
+            printf("%-8s in view %2u, tracked %2u, used %2u, mean SNR %u dB-Hz\n", systemNames[i],
+                   systems[i].inView, systems[i].tracked, systems[i].used, systems[i].meanSnr);
+
+    return 0;
+}
+
+int main(int argc, char * argv[]) {
+
+    static const struct {
+        const char * name;
+        SimTrackKind kind;
+    } profiles[] = {
+        { "walk",  SIM_TRACK_WALK },
+        { "drive", SIM_TRACK_DRIVE },
+    };
+    uint32_t seconds, seed, k;
+
+    nmeaRegisterHandlers(gateHandlers, sizeof(gateHandlers) / sizeof(gateHandlers[0]));
+
+    if (argc > 2 && strcmp(argv[1], "-f") == 0)
+        return runLog(argv[2]);
+
+    seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 14400;
+    seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    if (seconds == 0 || seconds > 86400 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds up to 86400] [seed]\n       %s -f log.nmea\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    printf("# %u s per track, seed %u, default FixGateConfig, errors of the fixes sent\n", seconds, seed);
+    printf("%-6s %5s %5s %5s %7s %7s %7s %7s %8s %8s %8s %8s\n", "track", "open", "urban", "indoor",
+           "frames", "empty", "sent", "saved", "rms", "max", "gate rms", "gate max");
+
+    for (k = 0; k < sizeof(profiles) / sizeof(profiles[0]); ++k) {
+
+        GateResult r;
+        FixGate gate;
+
+        runSimulated(profiles[k].kind, seconds, seed + k, &gate, &r);
+
+        printf("%-6s %4.0f%% %4.0f%% %5.0f%% %7u %7u %7u %6.1f%% %7.1fm %7.1fm %7.1fm %7.1fm\n", profiles[k].name,
+               100.0 * r.epochs[SIM_SKY_OPEN] / seconds, 100.0 * r.epochs[SIM_SKY_URBAN] / seconds,
+               100.0 * r.epochs[SIM_SKY_INDOOR] / seconds, r.frames, r.empty, r.sent,
+               100.0 * (r.frames - r.sent) / r.frames, sqrt(r.sq[0] / r.fixes[0]), r.max[0],
+               r.fixes[1] ? sqrt(r.sq[1] / r.fixes[1]) : 0.0, r.max[1]);
+        printf("       rejected:");
+        printReasons(&gate);
+    }
+
+    return 0;
+}
@@ -0,0 +1,289 @@
+//
+//  hopBench.c
+//  Delivered fixes per second of ALOHA trackers spread over PHY_CHANNELS channels
+//  (channelHop.c), for 1 to 8 channels and two kinds of gateway
+//
+//  The trackers are macBench.c's aloha: UTC-aligned GGA and RMC, the frame echoed on the
+//  UART, sent right away, then ALOHA_SLEEP_US asleep. Each frame goes on the channel
+//  hopChannel() gives its node ID and sequence number. The gateways:
+//
+//    per-channel   one receiver per channel, listening all the time: a frame gets through
+//                  unless another on its channel overlaps it
+//    scan          the one radio of rfPacketRx.c, scanning the channels in turn. On each it
+//                  programs the synthesizer (PHY_FS_US) and senses for PHY_SENSE_US; an RX
+//                  started while a frame still has the extra preamble of the scan left to
+//                  go locks on and stays until the frame ends. A busy channel with nothing
+//                  to lock on costs the RX timeout, a quiet one nothing more.
+//
+//  The scan gateway's trackers send the preamble phyScanPreambleLength() gives, the
+//  per-channel gateway's the one of a single channel. With one channel both are plain RX.
+//  Carrier sense is taken as reaching every frame, and there is no capture effect.
+//
+//  usage: hopBench [seconds] [seed]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channelHop.h"
+#include "channelSim.h"
+#include "packetCodec.h"
+
+#define MAX_NODES           32
+#define GATEWAY             MAX_NODES       // event source id of the gateway
+#define WARMUP_US           120000000ULL    // trackers power up first
+#define ALOHA_SLEEP_US      500000ULL       // PACKET_INTERVAL in rfPacketTx.c
+#define NO_EPOCH            0xFFFFFFFF
+#define NO_TX               0xFFFFFFFF
+
+typedef enum {
+    HOP_BENCH_PER_CHANNEL,
+    HOP_BENCH_SCAN,
+    HOP_BENCH_COUNT
+} HopBenchGateway;
+
+static const char * const hopBenchNames[HOP_BENCH_COUNT] = { "per-channel", "scan" };
+
+typedef enum {
+    EV_NODE_START,
+    EV_SENTENCE,    // arg: epoch << 1 | sentence
+    EV_TX_START,    // arg: epoch << 1 | sentence
+    EV_TX_END,      // arg: medium id
+    EV_READY,
+    EV_SENSE_END    // arg: channel
+} BenchEventType;
+
+typedef struct {
+    uint8_t  started;
+    uint8_t  ready;             // not printing, sending or sleeping
+    uint16_t seq;
+    uint32_t txEpoch;
+    uint32_t heardId;           // scan: the frame the gateway locked on
+    uint32_t lastDelivered;     // epoch of the last delivered fix
+} BenchNode;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t lost;
+    uint32_t missed;            // scan: no collision, but the gateway was elsewhere
+    uint32_t fixes;
+} BenchResult;
+
+typedef struct {
+    HopBenchGateway gateway;
+    uint8_t         channels;
+    uint16_t        numNodes;
+    uint64_t        endUs;
+    uint32_t        rng;
+    PhyProfile      phy;
+    uint64_t        lockUs;     // preamble left over the scan's own: an RX started later misses the frame
+    SimEventQueue   queue;
+    SimMedium       medium;
+    BenchNode       nodes[MAX_NODES];
+    BenchResult     result;
+} Bench;
+
+static uint8_t scanning(const Bench * b) {
+
+    return b->gateway == HOP_BENCH_SCAN && b->channels > 1;
+}
+
+static void onTxStart(Bench * b, uint16_t n, uint64_t t, uint32_t arg) {
+
+    BenchNode * node = &b->nodes[n];
+    uint8_t length = PKT_HEADER_LENGTH + simSentenceLength(arg & 1);
+    uint8_t channel = hopChannel((uint8_t)(n + 1), node->seq++, b->channels);
+
+    node->txEpoch = arg >> 1;
+    uint32_t id = simMediumTransmit(&b->medium, n, channel, t, simAirtimeUs(length));
+    simQueuePush(&b->queue, t + simAirtimeUs(length), n, EV_TX_END, id);
+}
+
+static void onTxEnd(Bench * b, uint16_t n, uint64_t t, uint32_t id) {
+
+    BenchNode * node = &b->nodes[n];
+    uint8_t collided = simMediumCollided(&b->medium, id);
+    uint8_t missed = !collided && scanning(b) && node->heardId != id;
+    uint8_t lost = collided || missed;
+
+    if (t >= WARMUP_US && t < b->endUs) {
+        ++b->result.sent;
+        b->result.lost += lost;
+        b->result.missed += missed;
+        if (!lost && node->txEpoch != node->lastDelivered)
+            ++b->result.fixes;
+    }
+
+    if (!lost)
+        node->lastDelivered = node->txEpoch;
+
+    simQueuePush(&b->queue, t + ALOHA_SLEEP_US, n, EV_READY, 0);
+
+    if (t > 1000000)
+        simMediumPrune(&b->medium, t - 1000000);
+}
+
+static void onSentence(Bench * b, uint16_t n, uint64_t t, uint32_t arg) {
+
+    BenchNode * node = &b->nodes[n];
+    uint32_t epoch = arg >> 1;
+    uint8_t sentence = arg & 1;
+    uint8_t length = PKT_HEADER_LENGTH + simSentenceLength(sentence);
+
+    /* Next sentence from the module */
+    if (sentence == 0)
+        simQueuePush(&b->queue, t + (uint64_t)SIM_RMC_LENGTH * SIM_UART_BYTE_US, n, EV_SENTENCE, arg | 1);
+    else
+        simQueuePush(&b->queue, simSentenceDoneUs(epoch + 1, 0, &b->rng), n, EV_SENTENCE, (epoch + 1) << 1);
+
+    if (!node->started || !node->ready)
+        return;
+
+    /* The frame is echoed on the 4800 baud UART before it goes on the air */
+    node->ready = 0;
+    simQueuePush(&b->queue, t + (uint64_t)(length + 2) * SIM_UART_BYTE_US, n, EV_TX_START, arg);
+}
+
+/* The scan gateway has sensed the channel and starts RX on it now, or moves on */
+static void onSenseEnd(Bench * b, uint64_t t, uint8_t channel) {
+
+    const SimTx * lock = NULL;
+    uint64_t senseStart = t - phySenseUs(&b->phy);
+    uint64_t next = t;
+    uint8_t busy = 0;
+    uint32_t i;
+
+    for (i = 0; i < b->medium.count; ++i) {
+
+        const SimTx * tx = &b->medium.tx[i];
+
+        if (tx->channel != channel || tx->start >= t || tx->end <= senseStart)
+            continue;
+        busy = 1;
+        if (t - tx->start <= b->lockUs && (lock == NULL || tx->start < lock->start))
+            lock = tx;
+    }
+
+    if (lock != NULL) {
+        b->nodes[lock->src].heardId = lock->id;
+        next = lock->end;
+    }
+    else if (busy)
+        next = t + simSyncUs();
+
+    channel = (uint8_t)((channel + 1) % b->channels);
+    simQueuePush(&b->queue, next + PHY_FS_US + phySenseUs(&b->phy), GATEWAY, EV_SENSE_END, channel);
+}
+
+static void benchRun(Bench * b, HopBenchGateway gateway, uint8_t channels, uint16_t numNodes,
+                     uint32_t seconds, uint32_t seed) {
+
+    const PhyProfile * base = &phyProfiles[PHY_PROFILE];
+
+    memset(b, 0, sizeof(*b));
+    b->gateway = gateway;
+    b->channels = channels;
+    b->numNodes = numNodes;
+    b->endUs = WARMUP_US + (uint64_t)seconds * 1000000ULL;
+    b->rng = seed;
+
+    b->phy = *base;
+    if (scanning(b)) {
+        b->phy.preambleLength = phyScanPreambleLength(base, channels);
+        b->lockUs = (uint64_t)(b->phy.preambleLength - base->preambleLength) * 8 * phyBitNs(base) / 1000;
+    }
+    simSetPhy(&b->phy);
+
+    simQueueInit(&b->queue, 1024);
+    simMediumInit(&b->medium, 256);
+
+    uint16_t n;
+    for (n = 0; n < numNodes; ++n) {
+        b->nodes[n].ready = 1;
+        b->nodes[n].seq = (uint16_t)simRandom(&b->rng);
+        b->nodes[n].heardId = NO_TX;
+        b->nodes[n].lastDelivered = NO_EPOCH;
+        simQueuePush(&b->queue, simRandomBelow(&b->rng, 5000000), n, EV_NODE_START, 0);
+        simQueuePush(&b->queue, simSentenceDoneUs(0, 0, &b->rng), n, EV_SENTENCE, 0);
+    }
+
+    if (scanning(b))
+        simQueuePush(&b->queue, PHY_FS_US + phySenseUs(&b->phy), GATEWAY, EV_SENSE_END, 0);
+
+    SimEvent ev;
+
+    while (simQueuePop(&b->queue, &ev) == 0 && ev.time < b->endUs) {
+
+        switch (ev.type) {
+
+            case EV_NODE_START:
+                b->nodes[ev.node].started = 1;
+                break;
+            case EV_SENTENCE:
+                onSentence(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_TX_START:
+                onTxStart(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_TX_END:
+                onTxEnd(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_READY:
+                b->nodes[ev.node].ready = 1;
+                break;
+            case EV_SENSE_END:
+                onSenseEnd(b, ev.time, (uint8_t)ev.arg);
+                break;
+
+        }
+    }
+
+    simQueueFree(&b->queue);
+    simMediumFree(&b->medium);
+    simSetPhy(base);
+}
+
+int main(int argc, char * argv[]) {
+
+    static const uint8_t channelCounts[] = { 1, 2, 4, 8 };
+    static const uint16_t nodeCounts[] = { 1, 2, 4, 8, 16, 32 };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 600;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    const PhyProfile * phy = &phyProfiles[PHY_PROFILE];
+    static Bench bench;
+    uint32_t g, c, i;
+
+    if (seconds == 0 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# %u s measured after %llu s warm-up, %s PHY, aloha trackers\n",
+           seconds, (unsigned long long)(WARMUP_US / 1000000), phy->name);
+    printf("%-12s %8s %6s %9s %10s %8s %8s\n",
+           "gateway", "channels", "nodes", "preamble", "fixes/s", "loss%", "missed%");
+
+    for (g = 0; g < HOP_BENCH_COUNT; ++g) {
+        for (c = 0; c < sizeof(channelCounts) / sizeof(channelCounts[0]); ++c) {
+
+            /* More channels than the longest preamble spans */
+            if (g == HOP_BENCH_SCAN && phyScanPreambleLength(phy, channelCounts[c]) > PHY_MAX_PREAMBLE_LENGTH)
+                continue;
+
+            for (i = 0; i < sizeof(nodeCounts) / sizeof(nodeCounts[0]); ++i) {
+
+                benchRun(&bench, (HopBenchGateway)g, channelCounts[c], nodeCounts[i], seconds, seed);
+
+                const BenchResult * r = &bench.result;
+                printf("%-12s %8u %6u %9u %10.3f %8.1f %8.1f\n", hopBenchNames[g], channelCounts[c],
+                       nodeCounts[i], bench.phy.preambleLength,
+                       (double)r->fixes / seconds,
+                       r->sent ? 100.0 * r->lost / r->sent : 0.0,
+                       r->sent ? 100.0 * r->missed / r->sent : 0.0);
+            }
+        }
+    }
+
+    return 0;
+}
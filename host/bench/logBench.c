@@ -0,0 +1,390 @@
+//
+//  logBench.c
+//  Store-and-forward fix log (fixLog.c) on the file backed flash model: wear and write
+//  amplification of the log itself, then how fast a backlog drains once the gateway is back
+//
+//  Wear: repeated outages of outageS seconds at one fix per second, each followed by a full
+//  drain. The first outage reboots a third of the way in (the flash is remounted from the file).
+//  Page batching (a 256 byte RAM page) is compared with programming every record on its own.
+//  Write amplification is bytes programmed per byte of record data.
+//
+//  Drain: the MAC_MODE_CSMA + MAC_ACK + FIX_LOG tracker loop of rfPacketTx.c on a single
+//  tracker, no contention. Every fix the fresh frame goes out first, then LOG frames of
+//  batch records each are sent back to back for FIX_LOG_DRAIN_US. Frames and ACKs are lost
+//  with a fixed link error rate.
+//
+//  usage: logBench [outageS] [seed]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arqMac.h"
+#include "channelSim.h"
+#include "csmaMac.h"
+#include "fixLog.h"
+#include "flashSim.h"
+#include "packetCodec.h"
+
+#define FLASH_FILE          "logBench.flash"
+#define FLASH_SIZE          (32 * 4096)     // Board_NVSEXTERNAL region of the LaunchPad
+#define SECTOR_SIZE         4096
+#define PAGE_SIZE           256
+#define WEAR_CYCLES         20
+#define MAX_BATCH           7               // FIX_LOG_BATCH: 98 byte payload / 14
+#define DRAIN_US            500000ULL       // FIX_LOG_DRAIN_US in rfPacketTx.c
+#define ECHO_BYTES          (SIM_GGA_LENGTH + 2)
+#define CS_TURNAROUND_US    150
+#define RX_TURNAROUND_US    150
+#define GW_TURNAROUND_US    3000
+#define MAX_DRAIN_S         36000
+
+typedef struct {
+    uint32_t records;
+    uint32_t programs;
+    uint32_t programmedBytes;
+    uint32_t erases;
+    uint32_t minErase;
+    uint32_t maxErase;
+    uint32_t dropped;
+    uint32_t lostOnReboot;
+    uint32_t violations;
+    uint64_t busyUs;
+} WearResult;
+
+typedef struct {
+    uint32_t seconds;           // from the gateway coming back until the log is empty
+    uint32_t drained;           // records consumed from flash
+    uint32_t received;          // records the gateway got, duplicates included
+    uint32_t logFrames;
+    uint32_t liveFixes;         // fresh fixes delivered while draining
+} DrainResult;
+
+typedef struct {
+    SimFlash    sim;
+    FixLogFlash flash;
+    FixLog      log;
+    ArqNode     arq;
+    ArqGateway  gateway;
+    CsmaConfig  csma;
+    uint32_t    linkLossPpm;
+    uint32_t    rng;
+    uint64_t    t;
+    uint16_t    seq;
+    DrainResult result;
+} Bench;
+
+static void fixAt(uint32_t second, FixRecord * rec) {
+
+    rec->timeMs = (second % 86400) * 1000;
+    rec->latE7  = 453000000 + (int32_t)(second * 37);
+    rec->lonE7  = -755000000 - (int32_t)(second * 21);
+    rec->altM   = (int16_t)(80 + second % 20);
+}
+
+static uint8_t attach(Bench * b, uint16_t pageSize, uint8_t blank) {
+
+    if (blank)
+        remove(FLASH_FILE);
+
+    if (simFlashOpen(&b->sim, FLASH_FILE, FLASH_SIZE, SECTOR_SIZE))
+        return 1;
+
+    b->flash.ctx        = &b->sim;
+    b->flash.size       = FLASH_SIZE;
+    b->flash.sectorSize = SECTOR_SIZE;
+    b->flash.pageSize   = pageSize;
+    b->flash.read       = simFlashRead;
+    b->flash.write      = simFlashWrite;
+    b->flash.erase      = simFlashErase;
+
+    return fixLogMount(&b->log, &b->flash);
+}
+
+/***** Wear *****/
+
+static uint8_t drainAll(FixLog * log) {
+
+    FixRecord recs[MAX_BATCH];
+    uint8_t n;
+
+    while ((n = fixLogPeek(log, recs, MAX_BATCH)) > 0) {
+        if (fixLogConsume(log, n))
+            return 1;
+    }
+
+    return 0;
+}
+
+static uint8_t wearRun(Bench * b, uint16_t pageSize, uint32_t outageS, WearResult * r) {
+
+    FixRecord rec;
+    uint32_t second = 0;
+    uint32_t cycle, i;
+
+    memset(r, 0, sizeof(*r));
+
+    if (attach(b, pageSize, 1))
+        return 1;
+
+    for (cycle = 0; cycle < WEAR_CYCLES; ++cycle) {
+
+        for (i = 0; i < outageS; ++i, ++second) {
+
+            /* Reset a third of the way into the first outage: whatever sat in the page
+             * buffer is gone */
+            if (cycle == 0 && i == outageS / 3) {
+                uint32_t before = b->log.count;
+                FixLog old = b->log;
+
+                simFlashClose(&b->sim);
+                if (attach(b, pageSize, 0))
+                    return 1;
+
+                r->lostOnReboot = before - b->log.count;
+                r->records    += old.appended;
+                r->programs   += old.programs;
+                r->programmedBytes += old.programmedBytes;
+                r->erases     += old.erases;
+                r->dropped    += old.dropped;
+            }
+
+            fixAt(second, &rec);
+            if (fixLogAppend(&b->log, &rec))
+                return 1;
+        }
+
+        if (drainAll(&b->log))
+            return 1;
+    }
+
+    r->records    += b->log.appended;
+    r->programs   += b->log.programs;
+    r->programmedBytes += b->log.programmedBytes;
+    r->erases     += b->log.erases;
+    r->dropped    += b->log.dropped;
+    r->violations  = b->sim.violations;
+    r->busyUs      = b->sim.busyUs;
+    r->minErase    = 0xFFFFFFFF;
+
+    for (i = 0; i < FLASH_SIZE / SECTOR_SIZE; ++i) {
+        if (b->sim.eraseCount[i] < r->minErase)
+            r->minErase = b->sim.eraseCount[i];
+        if (b->sim.eraseCount[i] > r->maxErase)
+            r->maxErase = b->sim.eraseCount[i];
+    }
+
+    simFlashClose(&b->sim);
+
+    return 0;
+}
+
+/***** Drain *****/
+
+static uint8_t linkLost(Bench * b) {
+
+    return simRandomBelow(&b->rng, 1000000) < b->linkLossPpm;
+}
+
+/* One transmission of a retry buffer entry and its ACK window */
+static void sendEntry(Bench * b, uint8_t slot) {
+
+    const ArqEntry * e = &b->arq.entry[slot];
+    PacketHeader hdr;
+
+    b->t += csmaBackoffUs(&b->csma, 0, simRandom(&b->rng)) + b->csma.senseUs + CS_TURNAROUND_US;
+    b->t += simAirtimeUs(e->length) + RX_TURNAROUND_US;
+
+    pktDecodeHeader(&hdr, e->frame, e->length);
+    if (hdr.type == PKT_TYPE_LOG)
+        ++b->result.logFrames;
+
+    if (linkLost(b)) {
+        b->t += b->arq.cfg.rxWindowUs;
+        return;
+    }
+
+    if (arqGatewayReceive(&b->gateway, hdr.nodeId, hdr.seq)) {
+        if (hdr.type == PKT_TYPE_LOG)
+            b->result.received += (e->length - PKT_HEADER_LENGTH) / FIX_RECORD_WIRE_LENGTH;
+        else
+            ++b->result.liveFixes;
+    }
+
+    if (linkLost(b)) {
+        b->t += b->arq.cfg.rxWindowUs;
+        return;
+    }
+
+    uint8_t ack[PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH];
+    arqGatewayBuildAck(&b->gateway, hdr.nodeId, ARQ_NO_RSSI, ack, sizeof(ack));
+    pktDecodeHeader(&hdr, ack, sizeof(ack));
+    arqNodeOnAck(&b->arq, hdr.seq, ack + PKT_HEADER_LENGTH, ARQ_ACK_PAYLOAD_LENGTH);
+
+    b->t += GW_TURNAROUND_US + simAirtimeUs(sizeof(ack));
+}
+
+static void sendRound(Bench * b) {
+
+    uint8_t slot;
+
+    arqNodeStartRound(&b->arq);
+
+    while ((slot = arqNodeNext(&b->arq)) != ARQ_NONE) {
+        sendEntry(b, slot);
+        arqNodeSent(&b->arq, slot);
+    }
+}
+
+static void queueFrame(Bench * b, uint8_t type, uint8_t payloadLength) {
+
+    uint8_t frame[ARQ_MAX_FRAME_LENGTH];
+    PacketHeader hdr;
+
+    hdr.type   = type;
+    hdr.flags  = 0;
+    hdr.nodeId = 1;
+    hdr.seq    = b->seq++;
+
+    memset(frame, 0, sizeof(frame));
+    pktEncodeHeader(&hdr, frame);
+    arqNodeQueue(&b->arq, frame, (uint8_t)(PKT_HEADER_LENGTH + payloadLength));
+}
+
+static uint8_t drainRun(Bench * b, uint8_t batch, uint32_t linkLossPpm, uint32_t backlog, uint32_t seed) {
+
+    FixRecord recs[MAX_BATCH];
+    ArqConfig arqCfg;
+    uint32_t epoch;
+    uint16_t logSeq = 0;
+    uint8_t inFlight = 0;
+
+    memset(&b->result, 0, sizeof(b->result));
+    b->linkLossPpm = linkLossPpm;
+    b->rng = seed;
+    b->seq = 0;
+
+    if (attach(b, PAGE_SIZE, 1))
+        return 1;
+
+    for (epoch = 0; epoch < backlog; ++epoch) {
+        fixAt(epoch, &recs[0]);
+        if (fixLogAppend(&b->log, &recs[0]))
+            return 1;
+    }
+
+    arqDefaultConfig(&arqCfg);
+    arqNodeInit(&b->arq, &arqCfg);
+    arqGatewayInit(&b->gateway);
+    csmaDefaultConfig(&b->csma);
+
+    for (epoch = 0; b->log.count > 0 && epoch < MAX_DRAIN_S; ++epoch) {
+
+        uint64_t ready = simSentenceDoneUs(epoch, 0, &b->rng) + (uint64_t)ECHO_BYTES * SIM_UART_BYTE_US;
+        if (b->t < ready)
+            b->t = ready;
+
+        /* The fresh fix first, then the backlog for FIX_LOG_DRAIN_US */
+        queueFrame(b, PKT_TYPE_DATA, SIM_GGA_LENGTH);
+        sendRound(b);
+
+        uint64_t start = b->t;
+
+        while (arqNodeLinkUp(&b->arq) && b->t - start < DRAIN_US) {
+
+            if (inFlight && arqNodeAcked(&b->arq, logSeq)) {
+                fixLogConsume(&b->log, inFlight);
+                b->result.drained += inFlight;
+                inFlight = 0;
+            }
+            else if (inFlight && !arqNodePending(&b->arq, logSeq)) {
+                inFlight = 0;
+            }
+
+            if (!inFlight) {
+                inFlight = fixLogPeek(&b->log, recs, batch);
+                if (inFlight == 0)
+                    break;
+                logSeq = b->seq;
+                queueFrame(b, PKT_TYPE_LOG, (uint8_t)(inFlight * FIX_RECORD_WIRE_LENGTH));
+            }
+
+            sendRound(b);
+        }
+
+        /* The last batch is consumed on the next pass, once its ACK is in */
+        if (inFlight && arqNodeAcked(&b->arq, logSeq)) {
+            fixLogConsume(&b->log, inFlight);
+            b->result.drained += inFlight;
+            inFlight = 0;
+        }
+    }
+
+    b->result.seconds = epoch;
+    simFlashClose(&b->sim);
+
+    return 0;
+}
+
+int main(int argc, char * argv[]) {
+
+    static const uint16_t pageSizes[] = { FIXLOG_SLOT_SIZE, PAGE_SIZE };
+    static const uint8_t batches[]    = { 1, 3, MAX_BATCH };
+    static const uint32_t linkLoss[]  = { 0, 100000, 300000 };
+    uint32_t outageS = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 3600;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    static Bench bench;
+    uint32_t i, p;
+
+    if (outageS == 0 || seed == 0) {
+        fprintf(stderr, "usage: %s [outageS] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# wear: %u outages of %u s, %u KB ring of %u sectors, reboot a third of the way into the first\n",
+           WEAR_CYCLES, outageS, FLASH_SIZE / 1024, FLASH_SIZE / SECTOR_SIZE);
+    printf("%-6s %9s %10s %8s %8s %10s %11s %8s %8s\n",
+           "page", "records", "prog/rec", "wamp", "erases", "min/max", "busy ms/rec", "dropped", "reboot");
+
+    for (i = 0; i < sizeof(pageSizes) / sizeof(pageSizes[0]); ++i) {
+
+        WearResult r;
+
+        if (wearRun(&bench, pageSizes[i], outageS, &r) || r.violations) {
+            fprintf(stderr, "flash failure at page size %u\n", pageSizes[i]);
+            return 1;
+        }
+
+        printf("%-6u %9u %10.3f %8.3f %8u %4u/%-5u %11.3f %8u %8u\n", pageSizes[i], r.records,
+               (double)r.programs / r.records,
+               (double)r.programmedBytes / ((double)r.records * FIX_RECORD_WIRE_LENGTH),
+               r.erases, r.minErase, r.maxErase, r.busyUs / 1000.0 / r.records, r.dropped, r.lostOnReboot);
+    }
+
+    printf("\n# drain: %u s backlog, csma + ack 3 tries/40 ms, %u ms of backlog per fix\n",
+           outageS, (uint32_t)(DRAIN_US / 1000));
+    printf("%-6s %6s %10s %10s %10s %10s %8s\n",
+           "batch", "per%", "drain s", "rec/s", "frames", "dup%", "live%");
+
+    for (p = 0; p < sizeof(linkLoss) / sizeof(linkLoss[0]); ++p) {
+        for (i = 0; i < sizeof(batches) / sizeof(batches[0]); ++i) {
+
+            if (drainRun(&bench, batches[i], linkLoss[p], outageS, seed)) {
+                fprintf(stderr, "flash failure\n");
+                return 1;
+            }
+
+            const DrainResult * r = &bench.result;
+
+            printf("%-6u %6.0f %10u %10.2f %10u %10.2f %8.1f\n", batches[i], linkLoss[p] / 10000.0,
+                   r->seconds, r->seconds ? (double)r->drained / r->seconds : 0.0, r->logFrames,
+                   r->drained ? 100.0 * (r->received - r->drained) / r->drained : 0.0,
+                   r->seconds ? 100.0 * r->liveFixes / r->seconds : 0.0);
+        }
+    }
+
+    remove(FLASH_FILE);
+
+    return 0;
+}
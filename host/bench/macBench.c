@@ -0,0 +1,392 @@
+//
+//  macBench.c
+//  Delivered fixes per second versus tracker count, for each medium access scheme
+//
+//  Every tracker produces a GGA and an RMC sentence per second, aligned to the UTC second
+//  as real GPS modules are. The schemes compared:
+//
+//    aloha   today's firmware: print the frame on the UART, send it right away with
+//            TRIG_NOW, then sleep PACKET_INTERVAL; sentences arriving meanwhile are lost
+//    tdma    tdmaMac.c: trackers join through the join slots and send their latest
+//            sentence in their own slot, one per superframe
+//    csma    csmaMac.c: like aloha, but every frame waits a random backoff and a clear
+//            carrier sense first; the sense-to-transmit gap is the RF core turnaround
+//
+//  A fix counts as delivered once per tracker and epoch, whichever sentence carried it.
+//  Frames take the airtime of the PHY profile given (phyProfile.h), PHY_PROFILE if none;
+//  TDMA slots and the beacon are sized for it.
+//
+//  usage: macBench [seconds] [seed] [long-range | 50kbps | high-rate]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channelSim.h"
+#include "csmaMac.h"
+#include "packetCodec.h"
+#include "tdmaMac.h"
+
+#define MAX_NODES           32
+#define GATEWAY             MAX_NODES       // medium source id of the gateway
+#define WARMUP_US           120000000ULL    // trackers power up and join first
+#define ALOHA_SLEEP_US      500000ULL       // PACKET_INTERVAL in rfPacketTx.c
+#define NO_EPOCH            0xFFFFFFFF
+#define CS_TURNAROUND_US    150             // CMD_PROP_CS end to CMD_PROP_TX start on the RF core
+
+typedef enum {
+    MAC_BENCH_ALOHA,
+    MAC_BENCH_TDMA,
+    MAC_BENCH_CSMA,
+    MAC_BENCH_COUNT
+} MacBenchMode;
+
+static const char * const macBenchNames[MAC_BENCH_COUNT] = { "aloha", "tdma", "csma" };
+
+typedef enum {
+    EV_NODE_START,
+    EV_SENTENCE,    // arg: epoch << 1 | sentence
+    EV_TX_START,    // arg: epoch << 1 | sentence
+    EV_TX_END,      // arg: medium id
+    EV_READY,
+    EV_BEACON,
+    EV_BEACON_END,  // arg: medium id
+    EV_SLOT,        // arg: 1 for a JOIN frame
+    EV_SENSE        // arg: epoch << 1 | sentence
+} BenchEventType;
+
+typedef struct {
+    uint8_t  started;
+    uint8_t  ready;             // aloha: not printing, sending or sleeping
+    uint8_t  staged;            // a sentence waits for the next transmission
+    uint32_t stagedEpoch;
+    uint8_t  stagedLength;
+    uint8_t  txJoin;            // the frame on the air is a JOIN
+    uint32_t txEpoch;
+    uint8_t  txLength;
+    uint32_t lastDelivered;     // epoch of the last delivered fix
+    uint8_t  csmaAttempt;
+    TdmaNode tdma;
+} BenchNode;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t lost;
+    uint32_t fixes;
+    uint32_t dropped;           // csma: channel busy on every attempt
+    uint64_t airtimeUs;
+    uint64_t goodAirtimeUs;     // airtime of frames that got through
+    uint32_t joined;
+} BenchResult;
+
+typedef struct {
+    MacBenchMode  mode;
+    uint16_t      numNodes;
+    uint64_t      endUs;
+    uint32_t      rng;
+    SimEventQueue queue;
+    SimMedium     medium;
+    BenchNode     nodes[MAX_NODES];
+    BenchResult   result;
+    TdmaGateway   gateway;
+    CsmaConfig    csma;
+    uint32_t      frameUs;
+    uint8_t       beacon[PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS)];
+    uint8_t       beaconLength;
+    uint64_t      beaconStart;
+} Bench;
+
+static uint8_t inWindow(const Bench * b, uint64_t t) {
+
+    return t >= WARMUP_US && t < b->endUs;
+}
+
+static void transmitFrame(Bench * b, uint16_t n, uint64_t t, uint8_t length) {
+
+    uint32_t id = simMediumTransmit(&b->medium, n, 0, t, simAirtimeUs(length));
+    simQueuePush(&b->queue, t + simAirtimeUs(length), n, EV_TX_END, id);
+    b->nodes[n].txLength = length;
+}
+
+static void onTxEnd(Bench * b, uint16_t n, uint64_t t, uint32_t id) {
+
+    BenchNode * node = &b->nodes[n];
+    uint8_t lost = simMediumCollided(&b->medium, id);
+
+    if (node->txJoin) {
+        if (!lost)
+            tdmaGatewayJoin(&b->gateway, n + 1);
+        node->txJoin = 0;
+    }
+    else {
+        if (b->mode == MAC_BENCH_TDMA && !lost)
+            tdmaGatewayHeard(&b->gateway, n + 1);
+
+        if (inWindow(b, t)) {
+            ++b->result.sent;
+            b->result.lost += lost;
+            if (!lost && node->txEpoch != node->lastDelivered)
+                ++b->result.fixes;
+            if (!lost)
+                b->result.goodAirtimeUs += simAirtimeUs(node->txLength);
+        }
+
+        if (!lost)
+            node->lastDelivered = node->txEpoch;
+    }
+
+    if (b->mode != MAC_BENCH_TDMA)
+        simQueuePush(&b->queue, t + ALOHA_SLEEP_US, n, EV_READY, 0);
+
+    if (t > 1000000)
+        simMediumPrune(&b->medium, t - 1000000);
+}
+
+static void onSentence(Bench * b, uint16_t n, uint64_t t, uint32_t arg) {
+
+    BenchNode * node = &b->nodes[n];
+    uint32_t epoch = arg >> 1;
+    uint8_t sentence = arg & 1;
+    uint8_t length = PKT_HEADER_LENGTH + simSentenceLength(sentence);
+
+    /* Next sentence from the module */
+    if (sentence == 0)
+        simQueuePush(&b->queue, t + (uint64_t)SIM_RMC_LENGTH * SIM_UART_BYTE_US, n, EV_SENTENCE, arg | 1);
+    else
+        simQueuePush(&b->queue, simSentenceDoneUs(epoch + 1, 0, &b->rng), n, EV_SENTENCE, (epoch + 1) << 1);
+
+    if (!node->started)
+        return;
+
+    if (b->mode != MAC_BENCH_TDMA) {
+        if (node->ready) {
+            node->ready = 0;
+            node->csmaAttempt = 0;
+            /* The frame is echoed on the 4800 baud UART before it goes on the air */
+            t += (uint64_t)(length + 2) * SIM_UART_BYTE_US;
+            if (b->mode == MAC_BENCH_CSMA)
+                simQueuePush(&b->queue, t + csmaBackoffUs(&b->csma, 0, simRandom(&b->rng)), n, EV_SENSE, arg);
+            else
+                simQueuePush(&b->queue, t, n, EV_TX_START, arg);
+        }
+    }
+    else {
+        node->staged = 1;
+        node->stagedEpoch = epoch;
+        node->stagedLength = length;
+    }
+}
+
+static void onBeacon(Bench * b, uint64_t t) {
+
+    if (t > 0)
+        tdmaGatewayEndFrame(&b->gateway);
+
+    b->beaconLength = tdmaGatewayBuildBeacon(&b->gateway, b->beacon, sizeof(b->beacon));
+    b->beaconStart = t;
+
+    uint32_t id = simMediumTransmit(&b->medium, GATEWAY, 0, t, simAirtimeUs(b->beaconLength));
+    simQueuePush(&b->queue, t + simAirtimeUs(b->beaconLength), GATEWAY, EV_BEACON_END, id);
+    simQueuePush(&b->queue, t + b->frameUs, GATEWAY, EV_BEACON, 0);
+}
+
+static void onBeaconEnd(Bench * b, uint32_t id) {
+
+    uint8_t lost = simMediumCollided(&b->medium, id);
+    uint16_t n;
+
+    for (n = 0; n < b->numNodes; ++n) {
+
+        BenchNode * node = &b->nodes[n];
+        if (!node->started)
+            continue;
+
+        if (lost || tdmaNodeOnBeacon(&node->tdma, b->beacon + PKT_HEADER_LENGTH,
+                                     b->beaconLength - PKT_HEADER_LENGTH)) {
+            tdmaNodeBeaconMissed(&node->tdma);
+            continue;
+        }
+
+        if (node->tdma.slot != TDMA_NO_SLOT) {
+            if (node->staged)
+                simQueuePush(&b->queue, b->beaconStart + tdmaSlotOffsetUs(&node->tdma.cfg, node->tdma.slot),
+                             n, EV_SLOT, 0);
+        }
+        else {
+            uint8_t slot = tdmaNodeJoinSlot(&node->tdma, simRandom(&b->rng));
+            if (slot != TDMA_NO_SLOT)
+                simQueuePush(&b->queue, b->beaconStart + tdmaSlotOffsetUs(&node->tdma.cfg, slot), n, EV_SLOT, 1);
+        }
+    }
+}
+
+static void onSlot(Bench * b, uint16_t n, uint64_t t, uint32_t join) {
+
+    BenchNode * node = &b->nodes[n];
+
+    if (join) {
+        node->txJoin = 1;
+        transmitFrame(b, n, t, PKT_HEADER_LENGTH);
+        return;
+    }
+
+    node->txEpoch = node->stagedEpoch;
+    node->staged = 0;
+    transmitFrame(b, n, t, node->stagedLength);
+}
+
+static void onSense(Bench * b, uint16_t n, uint64_t t, uint32_t arg) {
+
+    BenchNode * node = &b->nodes[n];
+    uint64_t senseEnd = t + b->csma.senseUs;
+
+    if (!simMediumBusy(&b->medium, 0, t, senseEnd)) {
+        simQueuePush(&b->queue, senseEnd + CS_TURNAROUND_US, n, EV_TX_START, arg);
+        return;
+    }
+
+    if (++node->csmaAttempt >= b->csma.maxAttempts) {
+        if (inWindow(b, t))
+            ++b->result.dropped;
+        simQueuePush(&b->queue, senseEnd + ALOHA_SLEEP_US, n, EV_READY, 0);
+        return;
+    }
+
+    simQueuePush(&b->queue, senseEnd + csmaBackoffUs(&b->csma, node->csmaAttempt, simRandom(&b->rng)),
+                 n, EV_SENSE, arg);
+}
+
+static void benchRun(Bench * b, MacBenchMode mode, uint16_t numNodes, uint32_t seconds, uint32_t seed) {
+
+    memset(b, 0, sizeof(*b));
+    b->mode = mode;
+    b->numNodes = numNodes;
+    b->endUs = WARMUP_US + (uint64_t)seconds * 1000000ULL;
+    b->rng = seed;
+
+    simQueueInit(&b->queue, 1024);
+    simMediumInit(&b->medium, 256);
+    csmaDefaultConfig(&b->csma);
+    b->csma.backoffUnitUs = (uint16_t)((simSyncUs() + 999) / 1000 * 1000);
+
+    /* Gateway sized for the deployment: one data slot per tracker, slots long enough
+     * for the longest NMEA sentence */
+    TdmaFrameConfig cfg;
+    tdmaDefaultConfig(&cfg);
+    cfg.numSlots = (uint8_t)numNodes;
+    cfg.slotMs   = (uint16_t)((simAirtimeUs(PKT_HEADER_LENGTH + 82) + 2 * TDMA_GUARD_US + 999) / 1000);
+    cfg.beaconMs = (uint16_t)((simAirtimeUs(PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(numNodes))
+                               + 2 * TDMA_GUARD_US + 999) / 1000);
+    tdmaGatewayInit(&b->gateway, &cfg);
+    b->frameUs = tdmaFrameLengthUs(&cfg);
+
+    uint16_t n;
+    for (n = 0; n < numNodes; ++n) {
+        b->nodes[n].ready = 1;
+        b->nodes[n].lastDelivered = NO_EPOCH;
+        tdmaNodeInit(&b->nodes[n].tdma, n + 1);
+        simQueuePush(&b->queue, simRandomBelow(&b->rng, 5000000), n, EV_NODE_START, 0);
+        simQueuePush(&b->queue, simSentenceDoneUs(0, 0, &b->rng), n, EV_SENTENCE, 0);
+    }
+
+    if (mode == MAC_BENCH_TDMA)
+        simQueuePush(&b->queue, 0, GATEWAY, EV_BEACON, 0);
+
+    uint64_t airtimeAtWarmup = 0;
+    uint8_t warm = 0;
+    SimEvent ev;
+
+    while (simQueuePop(&b->queue, &ev) == 0 && ev.time < b->endUs) {
+
+        if (!warm && ev.time >= WARMUP_US) {
+            airtimeAtWarmup = b->medium.airtimeUs;
+            warm = 1;
+        }
+
+        switch (ev.type) {
+
+            case EV_NODE_START:
+                b->nodes[ev.node].started = 1;
+                break;
+            case EV_SENTENCE:
+                onSentence(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_TX_START:
+                b->nodes[ev.node].txEpoch = ev.arg >> 1;
+                transmitFrame(b, ev.node, ev.time, PKT_HEADER_LENGTH + simSentenceLength(ev.arg & 1));
+                break;
+            case EV_TX_END:
+                onTxEnd(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_READY:
+                b->nodes[ev.node].ready = 1;
+                break;
+            case EV_BEACON:
+                onBeacon(b, ev.time);
+                break;
+            case EV_BEACON_END:
+                onBeaconEnd(b, ev.arg);
+                break;
+            case EV_SLOT:
+                onSlot(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_SENSE:
+                onSense(b, ev.node, ev.time, ev.arg);
+                break;
+
+        }
+    }
+
+    b->result.airtimeUs = b->medium.airtimeUs - airtimeAtWarmup;
+
+    for (n = 0; n < numNodes; ++n)
+        b->result.joined += b->nodes[n].tdma.slot != TDMA_NO_SLOT;
+
+    simQueueFree(&b->queue);
+    simMediumFree(&b->medium);
+}
+
+int main(int argc, char * argv[]) {
+
+    static const uint16_t nodeCounts[] = { 1, 2, 4, 8, 16, 24, 32 };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 600;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    const PhyProfile * phy = argc > 3 ? NULL : &phyProfiles[PHY_PROFILE];
+    static Bench bench;
+    uint32_t m, i;
+
+    for (i = 0; i < PHY_NUM_PROFILES && phy == NULL; ++i)
+        if (strcmp(argv[3], phyProfiles[i].name) == 0)
+            phy = &phyProfiles[i];
+
+    if (seconds == 0 || seed == 0 || phy == NULL) {
+        fprintf(stderr, "usage: %s [seconds] [seed] [long-range | 50kbps | high-rate]\n", argv[0]);
+        return 1;
+    }
+    simSetPhy(phy);
+
+    printf("# %u s measured after %llu s warm-up, %s PHY, airtime %llu us per GGA frame\n",
+           seconds, (unsigned long long)(WARMUP_US / 1000000), phy->name,
+           (unsigned long long)simAirtimeUs(PKT_HEADER_LENGTH + SIM_GGA_LENGTH));
+    printf("%-6s %6s %10s %8s %8s %8s %8s %8s\n",
+           "mac", "nodes", "fixes/s", "loss%", "drop%", "util%", "good%", "joined");
+
+    for (m = 0; m < MAC_BENCH_COUNT; ++m) {
+        for (i = 0; i < sizeof(nodeCounts) / sizeof(nodeCounts[0]); ++i) {
+
+            benchRun(&bench, (MacBenchMode)m, nodeCounts[i], seconds, seed);
+
+            const BenchResult * r = &bench.result;
+            printf("%-6s %6u %10.3f %8.1f %8.1f %8.1f %8.1f %8u\n", macBenchNames[m], nodeCounts[i],
+                   (double)r->fixes / seconds,
+                   r->sent ? 100.0 * r->lost / r->sent : 0.0,
+                   r->sent + r->dropped ? 100.0 * r->dropped / (r->sent + r->dropped) : 0.0,
+                   100.0 * (double)r->airtimeUs / ((double)seconds * 1e6),
+                   100.0 * (double)r->goodAirtimeUs / ((double)seconds * 1e6),
+                   m == MAC_BENCH_TDMA ? r->joined : nodeCounts[i]);
+        }
+    }
+
+    return 0;
+}
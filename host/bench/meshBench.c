@@ -0,0 +1,343 @@
+//
+//  meshBench.c
+//  Delivery and latency of trackers' fixes over a chain of relays (meshRelay.c), for 1 to 4
+//  radio hops and two hold times
+//
+//  The root gateway (level 0) and the relays of levels 1 to levels - 1 stand in a line,
+//  each in range of its neighbours only. Around every one of them is a ring of
+//  RING_TRACKERS trackers, heard by that station alone, so the fixes of ring k cross k
+//  relays. A tracker sends one FIX frame a second once the RMC is complete, after a random
+//  delay of up to SPREAD_US that stands in for the MAC spreading the ring's trackers.
+//  Relays run rfPacketRx.c's loop: RX until the next RELAY frame is due, then send it
+//  without carrier sense. Nothing is acknowledged or sent again.
+//
+//  A frame is lost at a station when another it hears overlaps it, or when the station
+//  was sending itself. There is no capture effect. Latency runs from the tracker's TX
+//  start to the end of the frame that brings the fix to the root.
+//
+//  usage: meshBench [seconds] [seed]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channelSim.h"
+#include "fixEpoch.h"
+#include "meshRelay.h"
+#include "packetCodec.h"
+
+#define MAX_LEVELS          4
+#define RING_TRACKERS       4
+#define MAX_TRACKERS        (MAX_LEVELS * RING_TRACKERS)
+#define STATION(level)      (MAX_TRACKERS + (level))    // medium source id of a station
+#define WARMUP_US           60000000ULL
+#define SPREAD_US           800000ULL
+#define DRAIN_US            10000000ULL     // frames sent before the end still arrive
+#define IN_FLIGHT           256             // frames kept by medium id
+#define TX_EPOCHS           64              // TX starts kept per tracker, for the latency
+#define BUCKET_MS           10
+#define NUM_BUCKETS         1000
+
+typedef enum {
+    EV_FIX,         // arg: epoch
+    EV_TX_END,      // arg: medium id
+    EV_RELAY_CHECK
+} BenchEventType;
+
+typedef struct {
+    uint64_t txStart[TX_EPOCHS];
+} BenchTracker;
+
+typedef struct {
+    uint8_t    sending;
+    MeshRelay  relay;
+} BenchStation;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t delivered;
+    uint64_t latencyMsSum;
+    uint32_t latency[NUM_BUCKETS];
+} BenchRing;
+
+typedef struct {
+    uint8_t       levels;
+    uint64_t      endUs;
+    uint32_t      rng;
+    SimEventQueue queue;
+    SimMedium     medium;
+    BenchTracker  trackers[MAX_TRACKERS];
+    BenchStation  stations[MAX_LEVELS];
+    MeshDedup     rootSeen;
+    uint8_t       frames[IN_FLIGHT][MESH_MAX_FRAME_LENGTH];
+    uint8_t       lengths[IN_FLIGHT];
+    BenchRing     rings[MAX_LEVELS];
+    uint32_t      relayFrames;
+    uint32_t      relayEntries;
+} Bench;
+
+/* Level of the station that hears src best: a tracker's own, a station's own */
+static uint8_t levelOf(uint16_t src) {
+
+    return src < MAX_TRACKERS ? (uint8_t)(src / RING_TRACKERS) : (uint8_t)(src - MAX_TRACKERS);
+}
+
+/* 1 if the station at level hears src: trackers of its ring, the stations next to it */
+static uint8_t hears(uint8_t level, uint16_t src) {
+
+    uint8_t other = levelOf(src);
+
+    if (src < MAX_TRACKERS)
+        return other == level;
+    return other + 1 == level || level + 1 == other;
+}
+
+/* 1 if the station at level gets transmission tx: nothing else it hears overlaps it, and
+ * it was not sending itself */
+static uint8_t received(const Bench * b, uint8_t level, const SimTx * tx) {
+
+    uint32_t i;
+
+    for (i = 0; i < b->medium.count; ++i) {
+
+        const SimTx * other = &b->medium.tx[i];
+
+        if (other->id == tx->id || other->start >= tx->end || other->end <= tx->start)
+            continue;
+        if (other->src == STATION(level) || hears(level, other->src))
+            return 0;
+    }
+    return 1;
+}
+
+static const SimTx * findTx(const Bench * b, uint32_t id) {
+
+    uint32_t i;
+
+    for (i = 0; i < b->medium.count; ++i) {
+        if (b->medium.tx[i].id == id)
+            return &b->medium.tx[i];
+    }
+    return NULL;
+}
+
+static void transmit(Bench * b, uint16_t src, uint64_t t, const uint8_t * frame, uint8_t length) {
+
+    uint32_t id = simMediumTransmit(&b->medium, src, 0, t, simAirtimeUs(length));
+
+    memcpy(b->frames[id % IN_FLIGHT], frame, length);
+    b->lengths[id % IN_FLIGHT] = length;
+    simQueuePush(&b->queue, t + simAirtimeUs(length), src, EV_TX_END, id);
+}
+
+/* A tracker's frame made it to the root, directly or relayed */
+static void rootTake(Bench * b, uint64_t t, const uint8_t * frame, uint8_t length) {
+
+    PacketHeader hdr;
+
+    if (pktDecodeHeader(&hdr, frame, length) || hdr.type != PKT_TYPE_FIX ||
+        meshDedupCheck(&b->rootSeen, hdr.nodeId, hdr.seq))
+        return;
+
+    uint16_t n = hdr.nodeId - 1;
+    uint64_t start = b->trackers[n].txStart[hdr.seq % TX_EPOCHS];
+    BenchRing * ring = &b->rings[levelOf(n)];
+
+    if (start < WARMUP_US || start >= b->endUs)
+        return;
+
+    uint64_t latencyMs = (t - start) / 1000;
+    ++ring->delivered;
+    ring->latencyMsSum += latencyMs;
+    ++ring->latency[latencyMs / BUCKET_MS < NUM_BUCKETS ? latencyMs / BUCKET_MS : NUM_BUCKETS - 1];
+}
+
+static void onFix(Bench * b, uint16_t n, uint64_t t, uint32_t epoch) {
+
+    BenchTracker * tracker = &b->trackers[n];
+    uint8_t frame[PKT_HEADER_LENGTH + FIX_EPOCH_WIRE_LENGTH];
+    PacketHeader hdr;
+
+    hdr.type   = PKT_TYPE_FIX;
+    hdr.flags  = 0;
+    hdr.nodeId = (uint8_t)(n + 1);
+    hdr.seq    = (uint16_t)epoch;
+    memset(frame + pktEncodeHeader(&hdr, frame), 0, FIX_EPOCH_WIRE_LENGTH);
+
+    tracker->txStart[epoch % TX_EPOCHS] = t;
+    if (t >= WARMUP_US && t < b->endUs)
+        ++b->rings[levelOf(n)].sent;
+    transmit(b, n, t, frame, sizeof(frame));
+
+    simQueuePush(&b->queue, simSentenceDoneUs(epoch + 1, 1, &b->rng) + simRandomBelow(&b->rng, SPREAD_US),
+                 n, EV_FIX, epoch + 1);
+}
+
+/* A relay sends its RELAY frame if it is due and the radio is free */
+static void onRelayCheck(Bench * b, uint8_t level, uint64_t t) {
+
+    BenchStation * station = &b->stations[level];
+    uint8_t frame[MESH_MAX_FRAME_LENGTH];
+
+    if (station->sending || meshRelayWaitMs(&station->relay, (uint32_t)(t / 1000)) != 0)
+        return;
+
+    uint32_t forwarded = station->relay.forwarded;
+    uint8_t length = meshRelayBuild(&station->relay, frame, sizeof(frame));
+
+    if (t >= WARMUP_US && t < b->endUs) {
+        ++b->relayFrames;
+        b->relayEntries += station->relay.forwarded - forwarded;
+    }
+    station->sending = 1;
+    transmit(b, STATION(level), t, frame, length);
+}
+
+static void onTxEnd(Bench * b, uint16_t src, uint64_t t, uint32_t id) {
+
+    const SimTx * tx = findTx(b, id);
+    const uint8_t * frame = b->frames[id % IN_FLIGHT];
+    uint8_t length = b->lengths[id % IN_FLIGHT];
+    uint8_t level;
+
+    for (level = 0; level < b->levels; ++level) {
+
+        if (!hears(level, src) || !received(b, level, tx))
+            continue;
+
+        if (level > 0) {
+            BenchStation * station = &b->stations[level];
+            uint32_t waitMs;
+
+            meshRelayAccept(&station->relay, frame, length, (uint32_t)(t / 1000), simRandom(&b->rng));
+            waitMs = meshRelayWaitMs(&station->relay, (uint32_t)(t / 1000));
+            if (waitMs != MESH_FOREVER)
+                simQueuePush(&b->queue, t + (uint64_t)waitMs * 1000, STATION(level), EV_RELAY_CHECK, 0);
+            continue;
+        }
+
+        /* The root */
+        if (src < MAX_TRACKERS) {
+            rootTake(b, t, frame, length);
+        }
+        else {
+            MeshEntry entry;
+            uint8_t offset = 0;
+
+            while (meshNextEntry(frame, length, &offset, &entry) == 0)
+                rootTake(b, t, entry.frame, entry.length);
+        }
+    }
+
+    /* The relay's queue may hold more than one frame's worth */
+    if (src >= MAX_TRACKERS) {
+        b->stations[levelOf(src)].sending = 0;
+        simQueuePush(&b->queue, t, src, EV_RELAY_CHECK, 0);
+    }
+
+    if (t > 1000000)
+        simMediumPrune(&b->medium, t - 1000000);
+}
+
+static void benchRun(Bench * b, uint8_t levels, uint16_t holdMs, uint32_t seconds, uint32_t seed) {
+
+    MeshConfig cfg;
+    uint16_t n;
+    uint8_t level;
+
+    memset(b, 0, sizeof(*b));
+    b->levels = levels;
+    b->endUs = WARMUP_US + (uint64_t)seconds * 1000000ULL;
+    b->rng = seed;
+
+    simQueueInit(&b->queue, 1024);
+    simMediumInit(&b->medium, IN_FLIGHT);
+    meshDedupInit(&b->rootSeen);
+
+    meshDefaultConfig(&cfg);
+    cfg.holdMs = holdMs;
+    for (level = 1; level < levels; ++level)
+        meshRelayInit(&b->stations[level].relay, &cfg, (uint8_t)(0xF0 | level), level);
+
+    for (n = 0; n < levels * RING_TRACKERS; ++n)
+        simQueuePush(&b->queue, simSentenceDoneUs(0, 1, &b->rng) + simRandomBelow(&b->rng, SPREAD_US), n, EV_FIX, 0);
+
+    SimEvent ev;
+
+    while (simQueuePop(&b->queue, &ev) == 0 && ev.time < b->endUs + DRAIN_US) {
+
+        switch (ev.type) {
+
+            case EV_FIX:
+                if (ev.time < b->endUs)
+                    onFix(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_TX_END:
+                onTxEnd(b, ev.node, ev.time, ev.arg);
+                break;
+            case EV_RELAY_CHECK:
+                onRelayCheck(b, levelOf(ev.node), ev.time);
+                break;
+
+        }
+    }
+
+    simQueueFree(&b->queue);
+    simMediumFree(&b->medium);
+}
+
+/* Latency below which 95 % of the ring's delivered fixes arrived */
+static uint32_t p95Ms(const BenchRing * ring) {
+
+    uint32_t count = 0;
+    uint32_t i;
+
+    for (i = 0; i < NUM_BUCKETS; ++i) {
+        count += ring->latency[i];
+        if (count * 100ULL >= ring->delivered * 95ULL)
+            return (i + 1) * BUCKET_MS;
+    }
+    return NUM_BUCKETS * BUCKET_MS;
+}
+
+int main(int argc, char * argv[]) {
+
+    static const uint16_t holds[] = { 250, 1000 };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 600;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    static Bench bench;
+    uint32_t h;
+    uint8_t levels, k;
+
+    if (seconds == 0 || seed == 0) {
+        fprintf(stderr, "usage: %s [seconds] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# %u s measured after %llu s warm-up, %s PHY, %u trackers a station, jitter %u ms\n",
+           seconds, (unsigned long long)(WARMUP_US / 1000000), phyProfiles[PHY_PROFILE].name,
+           RING_TRACKERS, MESH_DEFAULT_JITTER_MS);
+    printf("%7s %6s %5s %10s %8s %8s %10s %9s\n",
+           "hold_ms", "levels", "hops", "delivery%", "mean_ms", "p95_ms", "relayTx/s", "entries");
+
+    for (h = 0; h < sizeof(holds) / sizeof(holds[0]); ++h) {
+        for (levels = 1; levels <= MAX_LEVELS; ++levels) {
+
+            benchRun(&bench, levels, holds[h], seconds, seed);
+
+            for (k = 0; k < levels; ++k) {
+
+                const BenchRing * r = &bench.rings[k];
+                printf("%7u %6u %5u %10.1f %8.0f %8u %10.2f %9.2f\n", holds[h], levels, k + 1,
+                       r->sent ? 100.0 * r->delivered / r->sent : 0.0,
+                       r->delivered ? (double)r->latencyMsSum / r->delivered : 0.0,
+                       r->delivered ? p95Ms(r) : 0,
+                       (double)bench.relayFrames / seconds,
+                       bench.relayFrames ? (double)bench.relayEntries / bench.relayFrames : 0.0);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+//
+//  nmeaBench.c
+//  NMEA sentence classification and parsing (gpsParser.c): cost per sentence
+//
+//  The input is one second of what a multi-constellation module puts out by default: RMC,
+//  VTG, GGA, two GSA, GSV series for GPS, GLONASS and Galileo, GLL and ZDA, all with the
+//  $GN talker where it applies, and a proprietary sentence. Classification is timed three
+//  ways:
+//
+//      prefix      memcmp() of the first 6 bytes against every talker and formatter pair,
+//                  the way nmeaReceiveSentence() matched "$GPGGA" & co. before, extended to
+//                  5 talkers
+//      formatter   memcmp() of the 3 formatter bytes against each formatter
+//      switch      nmeaClassify(): the formatter packed into an integer, one switch
+//
+//  Parsing is timed per sentence type with every parser registered, checksum included.
+//
+//  usage: nmeaBench [iterations]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC    1
+#endif
+
+#include "gpsParser.h"
+
+static const char * const bodies[] = {
+    "GNRMC,123519.00,A,4530.10200,N,07334.03800,W,12.415,84.40,190926,,,A",
+    "GNVTG,84.40,T,,M,12.415,N,22.992,K,A",
+    "GNGGA,123519.00,4530.10200,N,07334.03800,W,1,14,0.78,41.2,M,-32.9,M,,",
+    "GNGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.42,0.78,1.19,1",
+    "GNGSA,A,3,65,66,75,76,88,,,,,,,,1.42,0.78,1.19,2",
+    "GPGSV,3,1,11,02,42,141,38,05,63,247,41,12,27,063,33,15,11,305,29",
+    "GPGSV,3,2,11,18,08,214,22,24,55,095,43,25,36,279,40,29,70,170,45",
+    "GPGSV,3,3,11,31,04,331,,32,02,024,,46,34,212,",
+    "GLGSV,2,1,07,65,45,036,39,66,22,330,31,75,51,096,42,76,12,150,28",
+    "GLGSV,2,2,07,86,09,010,,87,14,291,,88,38,302,36",
+    "GAGSV,1,1,04,04,31,110,35,09,44,245,38,24,18,061,30,31,62,300,41,7",
+    "GNGLL,4530.10200,N,07334.03800,W,123519.00,A,A",
+    "GNZDA,123519.00,19,09,2026,00,00",
+    "PUBX,00,123519.00,4530.10200,N,07334.03800,W,82.2,G3,2.1,2.0,0.007,77.52,0.007,,0.92,1.19,0.77,9,0,0",
+};
+
+#define NUM_SENTENCES   (sizeof(bodies) / sizeof(bodies[0]))
+
+static const char talkers[][3] = { "GP", "GL", "GA", "GB", "GN" };
+static const char formatters[][4] = { "GGA", "GSA", "RMC", "GSV", "VTG", "GLL", "ZDA" };
+
+#define NUM_TALKERS     (sizeof(talkers) / sizeof(talkers[0]))
+#define NUM_FORMATTERS  (sizeof(formatters) / sizeof(formatters[0]))
+
+static const NMEAHandler allHandlers[] = {
+    { NMEA_GGA, nmeaParseGGA },
+    { NMEA_GSA, nmeaParseGSA },
+    { NMEA_RMC, nmeaParseRMC },
+    { NMEA_GSV, nmeaParseGSV },
+    { NMEA_VTG, nmeaParseVTG },
+    { NMEA_GLL, nmeaParseGLL },
+    { NMEA_ZDA, nmeaParseZDA },
+};
+
+static char sentences[NUM_SENTENCES][SENTENCE_LENGTH + 8];
+
+static uint64_t nowNs(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t cycleCount(void) {
+
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static NMEAType classifyPrefix(const char * sentence) {
+
+    char prefix[7];
+    uint32_t t, f;
+
+    for (t = 0; t < NUM_TALKERS; ++t)
+        for (f = 0; f < NUM_FORMATTERS; ++f) {
+            prefix[0] = '$';
+            memcpy(prefix + 1, talkers[t], 2);
+            memcpy(prefix + 3, formatters[f], 3);
+            if (memcmp(sentence, prefix, 6) == 0)
+                return (NMEAType)f;
+        }
+
+    return NMEA_UNKNOWN;
+}
+
+static NMEAType classifyFormatter(const char * sentence) {
+
+    uint32_t f;
+
+    if (sentence[1] == 'P')
+        return NMEA_UNKNOWN;
+
+    for (f = 0; f < NUM_FORMATTERS; ++f)
+        if (memcmp(sentence + 3, formatters[f], 3) == 0)
+            return (NMEAType)f;
+
+    return NMEA_UNKNOWN;
+}
+
+static NMEAType classifySwitch(const char * sentence) {
+
+    return nmeaClassify(sentence, NULL);
+}
+
+static void timeClassifier(const char * name, NMEAType (*classify)(const char *), uint32_t iterations) {
+
+    volatile uint32_t sink = 0;
+    uint32_t i, k;
+
+    uint64_t c0 = cycleCount();
+    uint64_t t0 = nowNs();
+    for (i = 0; i < iterations; ++i)
+        for (k = 0; k < NUM_SENTENCES; ++k)
+            sink += classify(sentences[k]);
+    uint64_t t1 = nowNs();
+    uint64_t c1 = cycleCount();
+
+    double n = (double)iterations * NUM_SENTENCES;
+    printf("%-10s %8.1f %8.1f\n", name, (t1 - t0) / n, (c1 - c0) / n);
+    (void)sink;
+}
+
+int main(int argc, char * argv[]) {
+
+    uint32_t iterations = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+    uint32_t i, k;
+    GPSData data;
+
+    if (iterations == 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    for (k = 0; k < NUM_SENTENCES; ++k) {
+        uint8_t checksum = 0;
+        const char * c;
+        for (c = bodies[k]; *c; ++c)
+            checksum ^= (uint8_t)*c;
+        snprintf(sentences[k], sizeof(sentences[k]), "$%s*%02X\r\n", bodies[k], checksum);
+    }
+
+    /* The three must agree */
+    for (k = 0; k < NUM_SENTENCES; ++k) {
+        NMEAType type = classifySwitch(sentences[k]);
+        if (type != classifyPrefix(sentences[k]) || type != classifyFormatter(sentences[k])) {
+            fprintf(stderr, "classifiers disagree on %s", sentences[k]);
+            return 1;
+        }
+    }
+
+    printf("# %u iterations over %u sentences\n", iterations, (unsigned)NUM_SENTENCES);
+    printf("%-10s %8s %8s\n", "classify", "ns/sent", "cyc/sent");
+    timeClassifier("prefix", classifyPrefix, iterations);
+    timeClassifier("formatter", classifyFormatter, iterations);
+    timeClassifier("switch", classifySwitch, iterations);
+
+    /* Receive and parse, by type */
+    nmeaRegisterHandlers(allHandlers, sizeof(allHandlers) / sizeof(allHandlers[0]));
+    nmeaDataInit(&data);
+
+    printf("\n%-10s %8s %8s\n", "parse", "ns/sent", "cyc/sent");
+    for (k = 0; k < NUM_SENTENCES; ++k) {
+
+        char buf[SENTENCE_LENGTH + 8];
+        uint32_t repeat = iterations / 10 + 1;
+        uint64_t ns = 0, cycles = 0;
+        uint8_t failed = 0;
+
+        for (i = 0; i < repeat; ++i) {
+            strcpy(buf, sentences[k]);
+            uint64_t c0 = cycleCount();
+            uint64_t t0 = nowNs();
+            failed |= nmeaReceiveSentence(&data, buf) | nmeaParse(&data);
+            uint64_t t1 = nowNs();
+            uint64_t c1 = cycleCount();
+            ns += t1 - t0;
+            cycles += c1 - c0;
+        }
+
+        printf("%.5s%-5s %8.1f %8.1f%s\n", sentences[k] + 1, "", (double)ns / repeat, (double)cycles / repeat,
+               failed ? "  (no parser)" : "");
+    }
+
+    /* One clean pass for the decoded summary */
+    nmeaDataInit(&data);
+    for (k = 0; k < NUM_SENTENCES; ++k) {
+        char buf[SENTENCE_LENGTH + 8];
+        strcpy(buf, sentences[k]);
+        if (nmeaReceiveSentence(&data, buf) == 0)
+            nmeaParse(&data);
+    }
+
+    printf("\n# decoded: %02u.%02u.%u %06.0f  %.5f%c %.5f%c  quality %u, %u in use, %u in view, "
+           "fix %uD, PDOP %.2f HDOP %.2f VDOP %.2f, %.3f kn %.1f deg\n",
+           data.day, data.month, data.year, data.time, data.latitude, data.latDirection,
+           data.longitude, data.longDirection, data.fixQuality, data.numSatellites, data.numInView,
+           data.fixMode, data.pdop, data.hdop, data.vdop, data.groundSpeed, data.trueCourse);
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+//
+//  powerBench.c
+//  Tracker energy per delivered fix with closed-loop TX power control (txPower.c) against
+//  static maximum power
+//
+//  The MAC_ACK tracker loop of rfPacketTx.c: every second the latest GGA frame joins the
+//  retry buffer and each unacknowledged frame goes out once, then the ACK window. The
+//  gateway answers every frame it hears with the RSSI it measured, and the tracker feeds
+//  that to the controller, or counts a miss when the window closes empty.
+//
+//  Trackers sit at random distances from the gateway, 100 m to 3 km, with the path loss of
+//  adrBench.c: log-distance (25 dB at 1 m, exponent 3) and 4 dB of shadowing drawn per
+//  frame, either way. The gateway sends ACKs at +14 dBm. A frame arrives if its RSSI
+//  reaches the sensitivity of PHY_PROFILE. There is no capture effect in the channel model,
+//  so power decides whether a frame reaches the gateway, not whether it collides, and the
+//  trackers are run one link at a time. Mean TX power stands in for the interference
+//  they cause.
+//
+//  Energy counts the tracker radio only: TX airtime at the supply current of its level
+//  (txPowerLevels[]) and the ACK window at SIM_RX_UA, until the ACK or for all of it.
+//
+//  usage: powerBench [seconds] [seed]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arqMac.h"
+#include "channelSim.h"
+#include "packetCodec.h"
+#include "txPower.h"
+
+#define NUM_NODES           32
+#define WARMUP_S            60              // the power levels settle first
+#define GATEWAY_DBM         14
+#define PATH_LOSS_1M_DB     25.0
+#define PATH_LOSS_EXPONENT  3.0
+#define SHADOWING_DB        4.0
+#define MIN_DISTANCE_M      100.0
+#define MAX_DISTANCE_M      3000.0
+#define PI                  3.14159265358979
+#define STATIC_MAX          0               // target margin that means no control
+
+typedef struct {
+    double         pathLossDb;
+    ArqNode        arq;
+    TxPowerControl txp;
+} BenchNode;
+
+typedef struct {
+    uint32_t fixes;             // delivered, each epoch once
+    uint32_t epochs;
+    uint32_t frames;
+    uint32_t acked;             // frames answered
+    int64_t  dbmSum;            // over frames
+    uint64_t txUaUs;            // TX supply current times airtime
+    uint64_t rxUs;
+} BenchResult;
+
+typedef struct {
+    uint32_t    rng;
+    int8_t      targetMarginDb;
+    BenchNode   nodes[NUM_NODES];
+    ArqGateway  gateway;
+    BenchResult result;
+} Bench;
+
+static double uniform(uint32_t * rng) {
+
+    return (simRandom(rng) + 0.5) / 4294967296.0;
+}
+
+static double gaussian(uint32_t * rng) {
+
+    return sqrt(-2.0 * log(uniform(rng))) * cos(2.0 * PI * uniform(rng));
+}
+
+/* RSSI of one frame sent at txDbm between tracker n and the gateway, either way */
+static int8_t frameRssi(Bench * b, uint16_t n, int8_t txDbm) {
+
+    double rssi = txDbm - b->nodes[n].pathLossDb + SHADOWING_DB * gaussian(&b->rng);
+
+    return (int8_t)(rssi < -128 ? -128 : rssi > 0 ? 0 : floor(rssi));
+}
+
+/* One frame of tracker n and its ACK window */
+static void sendFrame(Bench * b, uint16_t n, uint8_t slot, uint8_t measured) {
+
+    BenchNode * node = &b->nodes[n];
+    const TxPowerLevel * level = txpLevel(&node->txp);
+    int8_t sensitivity = phyProfiles[PHY_PROFILE].sensitivityDbm;
+    uint8_t answered = 0;
+    PacketHeader hdr;
+
+    pktDecodeHeader(&hdr, node->arq.entry[slot].frame, node->arq.entry[slot].length);
+
+    if (measured) {
+        ++b->result.frames;
+        b->result.dbmSum += level->dbm;
+        b->result.txUaUs += (uint64_t)level->supplyUa * simAirtimeUs(node->arq.entry[slot].length);
+    }
+
+    int8_t rssi = frameRssi(b, n, level->dbm);
+
+    if (rssi >= sensitivity) {
+        uint32_t epoch = hdr.seq;
+
+        if (arqGatewayReceive(&b->gateway, hdr.nodeId, hdr.seq) && measured && epoch >= WARMUP_S)
+            ++b->result.fixes;
+
+        if (frameRssi(b, n, GATEWAY_DBM) >= sensitivity) {
+            uint8_t ack[PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH];
+            PacketHeader ackHdr;
+
+            arqGatewayBuildAck(&b->gateway, hdr.nodeId, rssi, ack, sizeof(ack));
+            pktDecodeHeader(&ackHdr, ack, sizeof(ack));
+            arqNodeOnAck(&node->arq, ackHdr.seq, ack + PKT_HEADER_LENGTH, ARQ_ACK_PAYLOAD_LENGTH);
+            answered = 1;
+            if (measured) {
+                ++b->result.acked;
+                b->result.rxUs += ARQ_GATEWAY_TURNAROUND_US + simAirtimeUs(sizeof(ack));
+            }
+        }
+    }
+
+    if (!answered && measured)
+        b->result.rxUs += node->arq.cfg.rxWindowUs;
+
+    arqNodeSent(&node->arq, slot);
+
+    if (b->targetMarginDb == STATIC_MAX)
+        return;
+    if (answered)
+        txpReport(&node->txp, node->arq.ackRssi);
+    else
+        txpMissed(&node->txp);
+}
+
+static void benchRun(Bench * b, int8_t targetMarginDb, uint32_t seconds, uint32_t seed) {
+
+    ArqConfig cfg;
+    uint16_t n;
+
+    memset(b, 0, sizeof(*b));
+    b->rng = seed;
+    b->targetMarginDb = targetMarginDb;
+    arqDefaultConfig(&cfg);
+    arqGatewayInit(&b->gateway);
+
+    for (n = 0; n < NUM_NODES; ++n) {
+        /* Uniform over the area of the ring around the gateway */
+        double r2 = MIN_DISTANCE_M * MIN_DISTANCE_M +
+                    uniform(&b->rng) * (MAX_DISTANCE_M * MAX_DISTANCE_M - MIN_DISTANCE_M * MIN_DISTANCE_M);
+        b->nodes[n].pathLossDb = PATH_LOSS_1M_DB + 10.0 * PATH_LOSS_EXPONENT * log10(sqrt(r2));
+        arqNodeInit(&b->nodes[n].arq, &cfg);
+        txpInit(&b->nodes[n].txp, phyProfiles[PHY_PROFILE].sensitivityDbm, targetMarginDb);
+    }
+
+    /* The sequence number of a frame is its fix epoch */
+    uint32_t epoch;
+    for (epoch = 0; epoch < WARMUP_S + seconds; ++epoch) {
+
+        uint8_t measured = epoch >= WARMUP_S;
+
+        for (n = 0; n < NUM_NODES; ++n) {
+
+            BenchNode * node = &b->nodes[n];
+            uint8_t frame[PKT_HEADER_LENGTH + SIM_GGA_LENGTH];
+            PacketHeader hdr;
+            uint8_t slot;
+
+            hdr.type   = PKT_TYPE_DATA;
+            hdr.flags  = 0;
+            hdr.nodeId = (uint8_t)(n + 1);
+            hdr.seq    = (uint16_t)epoch;
+            memset(frame + pktEncodeHeader(&hdr, frame), 'G', SIM_GGA_LENGTH);
+            arqNodeQueue(&node->arq, frame, sizeof(frame));
+
+            arqNodeStartRound(&node->arq);
+            while ((slot = arqNodeNext(&node->arq)) != ARQ_NONE)
+                sendFrame(b, n, slot, measured);
+        }
+        if (measured)
+            b->result.epochs += NUM_NODES;
+    }
+}
+
+int main(int argc, char * argv[]) {
+
+    static const int8_t targets[] = { STATIC_MAX, 15, TXP_DEFAULT_TARGET_MARGIN_DB, 5 };
+    uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 3600;
+    uint32_t seed    = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+    static Bench bench;
+    uint32_t i;
+
+    if (seconds == 0 || seed == 0 || seconds > 65535 - WARMUP_S) {
+        fprintf(stderr, "usage: %s [seconds] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# %u trackers %.0f m to %.0f m out, %u s measured after %u s warm-up, PHY %s\n",
+           NUM_NODES, MIN_DISTANCE_M, MAX_DISTANCE_M, seconds, WARMUP_S, phyProfiles[PHY_PROFILE].name);
+    printf("%-8s %10s %8s %8s %10s %10s\n", "power", "fixes/s", "loss%", "acked%", "mean dBm", "mJ/fix");
+
+    for (i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i) {
+
+        char name[16];
+        benchRun(&bench, targets[i], seconds, seed);
+
+        const BenchResult * res = &bench.result;
+        uint64_t energyNj = (res->txUaUs + res->rxUs * SIM_RX_UA) * SIM_SUPPLY_MV / 1000000;
+
+        if (targets[i] == STATIC_MAX)
+            snprintf(name, sizeof(name), "max");
+        else
+            snprintf(name, sizeof(name), "txp %d", targets[i]);
+
+        printf("%-8s %10.3f %8.2f %8.1f %10.1f %10.3f\n", name,
+               (double)res->fixes / seconds,
+               res->epochs ? 100.0 * (res->epochs - res->fixes) / res->epochs : 0.0,
+               res->frames ? 100.0 * res->acked / res->frames : 0.0,
+               res->frames ? (double)res->dbmSum / res->frames : 0.0,
+               res->fixes ? (double)energyNj / res->fixes / 1e6 : 0.0);
+    }
+
+    return 0;
+}
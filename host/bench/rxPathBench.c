@@ -0,0 +1,222 @@
+//
+//  rxPathBench.c
+//  Gateway receive path of DATA frames: memory traffic and time per packet, before and
+//  after the frame is decoded in the RF data entry
+//
+//  Frames are what a tracker sends: the packetCodec.h header, then a GGA or RMC sentence of
+//  nmeaSim.h with CR LF. Each one sits in an RX data entry laid out as the RF core writes
+//  it: length byte, payload, status byte. Two receive paths up to the parsers:
+//
+//      copy        the gateway before: the RF callback copies payload and status byte into
+//                  packet[], the handler looks for '$', '\n' and '*' over all of packet[]
+//                  and nmeaReceiveSentence() copies the sentence into GPSData
+//      view        nmeaReceiveView() on the payload in the entry, within its length
+//
+//  Traffic is counted from where each step stopped: bytes a copy reads and writes, bytes a
+//  search or the checksum reads. The parsers run the same on both and are left out.
+//
+//  usage: rxPathBench [frames] [iterations]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gpsParser.h"
+#include "nmeaSim.h"
+#include "packetCodec.h"
+
+#define MAX_LENGTH          102     // as the gateway's RX command
+#define NUM_APPENDED_BYTES  2
+#define ENTRY_LENGTH        (1 + MAX_LENGTH + 1)
+
+typedef struct {
+    uint8_t  data[ENTRY_LENGTH];    // length, payload, status
+    uint8_t  starOffset;            // of the '*' in the payload, put back after a view
+} Entry;
+
+typedef struct {
+    uint32_t copies;
+    uint64_t copied;                // read and written by copies
+    uint64_t scanned;               // read by searches and the checksum
+} Traffic;
+
+static uint8_t packet[MAX_LENGTH + NUM_APPENDED_BYTES - 1];
+
+static uint64_t nowNs(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Bytes memchr() read to return found, or all of length */
+static uint32_t searched(const void * from, const void * found, uint32_t length) {
+
+    return found != NULL ? (uint32_t)((const uint8_t *)found - (const uint8_t *)from) + 1 : length;
+}
+
+/* The gateway before: callback copy, three searches over packet[], copy into GPSData.
+ * Counted into t unless it is NULL */
+static uint8_t receiveCopy(const Entry * entry, GPSData * data, Traffic * t) {
+
+    uint8_t length = entry->data[0];
+    uint32_t area = sizeof(packet) - PKT_HEADER_LENGTH;
+
+    memcpy(packet, entry->data + 1, length + 1);
+
+    uint8_t * sentence = packet + PKT_HEADER_LENGTH;
+    char * begin    = memchr(sentence, '$', area);
+    char * end      = memchr(sentence, '\n', area);
+    char * checksum = memchr(sentence, '*', area);
+    if (!begin || !end || !checksum)
+        return 1;
+    *(end + 1) = '\0';
+
+    if (t != NULL) {
+        /* nmeaReceiveSentence(): strchr '$', strlen, strcpy, strchr '*', checksum */
+        uint32_t n = (uint32_t)strlen(begin);
+        uint32_t star = (uint32_t)(checksum - begin);
+        t->copies += 2;
+        t->copied += 2 * (length + 1) + 2 * (n + 1);
+        t->scanned += searched(sentence, begin, area) + searched(sentence, end, area) +
+                      searched(sentence, checksum, area);
+        t->scanned += 1 + (n + 1) + (star + 1) + star + 2;
+    }
+
+    return nmeaReceiveSentence(data, begin);
+}
+
+/* The gateway now: the sentence is checked where it lies */
+static uint8_t receiveView(const Entry * entry, GPSData * data, Traffic * t) {
+
+    uint8_t length = entry->data[0];
+    char * payload = (char *)entry->data + 1 + PKT_HEADER_LENGTH;
+    uint8_t status = nmeaReceiveView(data, payload, length - PKT_HEADER_LENGTH);
+
+    /* memchr '$', memchr '*', checksum and its digits */
+    const char * begin = memchr(payload, '$', length - PKT_HEADER_LENGTH);
+    uint32_t star = (uint32_t)(entry->starOffset - (begin - payload));
+    t->scanned += (uint32_t)(begin - payload) + 1 + (star + 1) + star + 2;
+
+    return status;
+}
+
+static void buildFrames(Entry * entries, uint32_t count) {
+
+    SimSky sky;
+    SimNmeaEpoch e;
+    PacketHeader hdr;
+    char line[SIM_NMEA_MAX_LENGTH];
+    uint32_t i;
+
+    simSkyInit(&sky, 0x39);
+    memset(&e, 0, sizeof(e));
+    e.day = 19;
+    e.month = 10;
+    e.year = 2026;
+    e.latE7 = 455017000;
+    e.lonE7 = -735673000;
+    e.altM = 41.2;
+    e.speedKn = 22.0;
+    e.courseDeg = 90.0;
+
+    hdr.type = PKT_TYPE_DATA;
+    hdr.flags = 0;
+    hdr.nodeId = 1;
+
+    for (i = 0; i < count; ++i) {
+
+        Entry * entry = &entries[i];
+        uint8_t n;
+
+        if (i % 2 == 0) {
+            simSkyStep(&sky, &e.sky);
+            e.timeMs = (43200 + i / 2) % 86400 * 1000;
+            e.lonE7 += 1450;
+            n = simNmeaGGA(&e, "GN", line);
+        }
+        else
+            n = simNmeaRMC(&e, "GN", line);
+
+        hdr.seq = (uint16_t)i;
+        memset(entry->data, 0xA5, sizeof(entry->data));
+        entry->data[0] = (uint8_t)(PKT_HEADER_LENGTH + n);
+        pktEncodeHeader(&hdr, entry->data + 1);
+        memcpy(entry->data + 1 + PKT_HEADER_LENGTH, line, n);
+        entry->data[1 + PKT_HEADER_LENGTH + n] = 0x80;      // status: CRC ok
+        entry->starOffset = (uint8_t)((char *)memchr(line, '*', n) - line);
+    }
+}
+
+static void restore(Entry * entry) {
+
+    entry->data[1 + PKT_HEADER_LENGTH + entry->starOffset] = '*';
+}
+
+int main(int argc, char * argv[]) {
+
+    uint32_t count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000;
+    uint32_t iterations = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 200;
+    Traffic copy = { 0 }, view = { 0 };
+    uint64_t payloadBytes = 0, copyNs = 0, viewNs = 0, t0;
+    uint32_t i, k, mismatches = 0;
+    GPSData a, b;
+
+    if (count == 0 || iterations == 0) {
+        fprintf(stderr, "usage: %s [frames] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    Entry * entries = malloc(count * sizeof(Entry));
+    if (entries == NULL)
+        return 1;
+    buildFrames(entries, count);
+
+    /* Counted pass; both must parse the same */
+    nmeaDataInit(&a);
+    nmeaDataInit(&b);
+    for (i = 0; i < count; ++i) {
+        payloadBytes += entries[i].data[0];
+        uint8_t failedCopy = receiveCopy(&entries[i], &a, &copy) || nmeaParse(&a);
+        uint8_t failedView = receiveView(&entries[i], &b, &view) || nmeaParse(&b);
+        restore(&entries[i]);
+        if (failedCopy || failedView || a.nmeaData.msgType != b.nmeaData.msgType || a.time != b.time ||
+            a.latitude != b.latitude || a.longitude != b.longitude)
+            ++mismatches;
+    }
+
+    /* Timed passes, receive only */
+    for (k = 0; k < iterations; ++k) {
+        t0 = nowNs();
+        for (i = 0; i < count; ++i)
+            receiveCopy(&entries[i], &a, NULL);
+        copyNs += nowNs() - t0;
+
+        t0 = nowNs();
+        for (i = 0; i < count; ++i) {
+            nmeaReceiveView(&a, (char *)entries[i].data + 1 + PKT_HEADER_LENGTH,
+                            entries[i].data[0] - PKT_HEADER_LENGTH);
+            restore(&entries[i]);
+        }
+        viewNs += nowNs() - t0;
+    }
+
+    double n = count;
+    double timed = (double)count * iterations;
+    printf("# %u DATA frames (GGA, RMC), payload %.1f B mean, %u iterations\n", count, payloadBytes / n,
+           iterations);
+    printf("%-6s %8s %10s %10s %10s %8s\n", "path", "copies", "copied B", "scanned B", "traffic B", "ns");
+    printf("%-6s %8.1f %10.1f %10.1f %10.1f %8.1f\n", "copy", copy.copies / n, copy.copied / n,
+           copy.scanned / n, (copy.copied + copy.scanned) / n, copyNs / timed);
+    printf("%-6s %8.1f %10.1f %10.1f %10.1f %8.1f\n", "view", view.copies / n, view.copied / n,
+           view.scanned / n, (view.copied + view.scanned) / n, viewNs / timed);
+
+    free(entries);
+    if (mismatches) {
+        printf("%u frames decoded differently\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
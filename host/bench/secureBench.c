@@ -0,0 +1,253 @@
+//
+//  secureBench.c
+//  Cost of sealed frames (secureLink.c): CPU time per seal and open with the software
+//  AES-CCM stand-in, and the airtime the MIC and the epoch announcements add
+//
+//  Runs the FIPS-197 AES check and the CCM vectors of secureSelfTest() first, the same
+//  vectors the firmware runs against the crypto core at boot, then a round of protocol
+//  checks: tampering, replays, retransmissions, sequence wrap and a gateway restart.
+//
+//  usage: secureBench [iterations]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "channelSim.h"
+#include "packetCodec.h"
+#include "secureLink.h"
+#include "softCcm.h"
+
+#define MAX_FRAME       102     // MAX_LENGTH of the gateway
+#define NODE_ID         7
+
+typedef struct {
+    const char * name;
+    uint8_t      payloadLength;
+} FrameKind;
+
+static const uint8_t networkKey[SECURE_KEY_LENGTH] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static SoftCcm txCcm, rxCcm;
+static const SecureCipher txCipher = { &txCcm, softCcmSetKey, softCcmEncrypt, softCcmDecrypt };
+static const SecureCipher rxCipher = { &rxCcm, softCcmSetKey, softCcmEncrypt, softCcmDecrypt };
+
+static uint64_t nowNs(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint8_t buildFrame(uint8_t * buf, uint16_t seq, uint8_t payloadLength) {
+
+    PacketHeader hdr;
+    uint8_t i;
+
+    hdr.type   = PKT_TYPE_DATA;
+    hdr.flags  = 0;
+    hdr.nodeId = NODE_ID;
+    hdr.seq    = seq;
+
+    if (payloadLength > MAX_FRAME - PKT_HEADER_LENGTH)
+        payloadLength = MAX_FRAME - PKT_HEADER_LENGTH;
+
+    pktEncodeHeader(&hdr, buf);
+    for (i = 0; i < payloadLength; ++i)
+        buf[PKT_HEADER_LENGTH + i] = (uint8_t)('A' + (seq + i) % 26);
+
+    return PKT_HEADER_LENGTH + payloadLength;
+}
+
+/* Seals a fresh frame and opens it at the gateway. Returns the gateway's verdict. */
+static SecureStatus roundTrip(SecureNode * node, SecureGateway * gw, uint16_t seq, uint8_t * sealed,
+                              uint8_t * sealedLength) {
+
+    uint8_t plain[MAX_FRAME];
+    uint8_t buf[MAX_FRAME];
+    uint8_t length = buildFrame(plain, seq, 72);
+
+    memcpy(buf, plain, length);
+    *sealedLength = secureSeal(node, buf, length, MAX_FRAME);
+    if (*sealedLength == 0)
+        return SECURE_REJECTED;
+    memcpy(sealed, buf, *sealedLength);
+
+    uint8_t openLength = *sealedLength;
+    SecureStatus status = secureOpen(gw, buf, &openLength);
+
+    if (status != SECURE_REJECTED && (openLength != length || memcmp(buf, plain, length)))
+        return SECURE_REJECTED;
+
+    return status;
+}
+
+static SecureStatus replay(SecureGateway * gw, const uint8_t * sealed, uint8_t length) {
+
+    uint8_t buf[MAX_FRAME];
+
+    memcpy(buf, sealed, length);
+    return secureOpen(gw, buf, &length);
+}
+
+static int check(const char * what, int ok) {
+
+    printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int protocolChecks(void) {
+
+    static SecureNode node;
+    static SecureGateway gw;
+    uint8_t sealed[MAX_FRAME], first[MAX_FRAME], buf[MAX_FRAME];
+    uint8_t sealedLength, firstLength, length;
+    uint16_t seq;
+    int failed = 0;
+
+    secureNodeInit(&node, &txCipher, networkKey, 1);
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+
+    failed |= check("first frame announces the epoch and opens",
+                    roundTrip(&node, &gw, 100, first, &firstLength) == SECURE_NEW &&
+                    (first[0] >> 4) == (PKT_FLAG_SECURE | PKT_FLAG_EPOCH));
+
+    failed |= check("retransmission comes back as duplicate", replay(&gw, first, firstLength) == SECURE_DUPLICATE);
+
+    memcpy(buf, first, firstLength);
+    buf[firstLength - 10] ^= 0x20;
+    length = firstLength;
+    failed |= check("flipped payload bit is rejected", secureOpen(&gw, buf, &length) == SECURE_REJECTED);
+
+    memcpy(buf, first, firstLength);
+    buf[1] = NODE_ID + 1;
+    length = firstLength;
+    failed |= check("spoofed node id is rejected", secureOpen(&gw, buf, &length) == SECURE_REJECTED);
+
+    uint8_t ok = 1;
+    for (seq = 101; seq < 140; ++seq)
+        ok &= roundTrip(&node, &gw, seq, sealed, &sealedLength) == SECURE_NEW;
+    failed |= check("frames without epoch open once it is known", ok);
+
+    failed |= check("replay older than the window is rejected", replay(&gw, first, firstLength) == SECURE_REJECTED);
+
+    /* Out of order within the window: hold one back, deliver it late */
+    uint8_t late[MAX_FRAME], lateLength;
+    length = buildFrame(late, 140, 72);
+    lateLength = secureSeal(&node, late, length, MAX_FRAME);
+    roundTrip(&node, &gw, 141, sealed, &sealedLength);
+    failed |= check("late frame inside the window is accepted once",
+                    replay(&gw, late, lateLength) == SECURE_NEW && replay(&gw, late, lateLength) == SECURE_DUPLICATE);
+
+    uint16_t epoch = node.epoch;
+    failed |= check("sequence wrap starts a new epoch",
+                    roundTrip(&node, &gw, 0, sealed, &sealedLength) == SECURE_NEW && node.epoch == epoch + 1);
+
+    /* A restarted gateway waits for the next announcement */
+    for (seq = 1; seq <= SECURE_EPOCH_ANNOUNCE; ++seq)
+        roundTrip(&node, &gw, seq, sealed, &sealedLength);
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+    uint8_t rejected = 0, accepted = 0;
+    for (seq = SECURE_EPOCH_ANNOUNCE + 1; seq <= SECURE_EPOCH_ANNOUNCE + 2 * SECURE_EPOCH_INTERVAL; ++seq) {
+        if (roundTrip(&node, &gw, seq, sealed, &sealedLength) == SECURE_NEW)
+            ++accepted;
+        else if (!accepted)
+            ++rejected;
+    }
+    failed |= check("restarted gateway resyncs within the interval",
+                    rejected > 0 && rejected <= SECURE_EPOCH_INTERVAL && accepted == 2 * SECURE_EPOCH_INTERVAL - rejected);
+
+    return failed;
+}
+
+int main(int argc, char * argv[]) {
+
+    static const FrameKind kinds[] = {
+        { "GGA",      72 },
+        { "RMC",      70 },
+        { "LOG x6",   6 * 14 },
+        { "short",    16 },
+    };
+    static const uint8_t aesKey[16] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+    };
+    static const uint8_t aesPlain[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+    };
+    static const uint8_t aesCipher[16] = {
+        0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+    };
+    uint32_t iterations = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+    static SecureNode node;
+    static SecureGateway gw;
+    uint8_t block[16];
+    uint32_t k, n;
+
+    if (iterations == 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    softCcmSetKey(&txCcm, aesKey);
+    softAesEncryptBlock(&txCcm, aesPlain, block);
+
+    int failed = check("FIPS-197 AES-128 block", memcmp(block, aesCipher, 16) == 0);
+    failed |= check("NIST SP 800-38C CCM vectors (secureSelfTest)", secureSelfTest(&txCipher) == 0);
+    failed |= protocolChecks();
+
+    if (failed)
+        return 1;
+
+    printf("\n# %u frames per row, software AES-CCM, airtime at %u ns/bit\n", iterations, phyBitNs(simPhy()));
+    printf("%-8s %6s %10s %10s %12s %12s %8s\n",
+           "frame", "bytes", "seal ns", "open ns", "airtime us", "+airtime us", "+air%");
+
+    for (k = 0; k < sizeof(kinds) / sizeof(kinds[0]); ++k) {
+
+        uint8_t plain[MAX_FRAME], buf[MAX_FRAME];
+        uint8_t length = buildFrame(plain, 0, kinds[k].payloadLength);
+        uint64_t sealNs = 0, openNs = 0;
+        uint32_t sealedBytes = 0;
+
+        secureNodeInit(&node, &txCipher, networkKey, 1);
+        secureGatewayInit(&gw, &rxCipher, networkKey);
+
+        for (n = 0; n < iterations; ++n) {
+
+            uint8_t sealedLength, openLength;
+            uint64_t t0, t1, t2;
+
+            memcpy(buf, plain, length);
+            buf[2] = (uint8_t)(n >> 8);
+            buf[3] = (uint8_t)(n);
+
+            t0 = nowNs();
+            sealedLength = secureSeal(&node, buf, length, MAX_FRAME);
+            t1 = nowNs();
+            openLength = sealedLength;
+            if (sealedLength == 0 || secureOpen(&gw, buf, &openLength) != SECURE_NEW) {
+                fprintf(stderr, "round trip failed\n");
+                return 1;
+            }
+            t2 = nowNs();
+
+            sealNs += t1 - t0;
+            openNs += t2 - t1;
+            sealedBytes += sealedLength;
+        }
+
+        double plainUs  = (double)simAirtimeUs(length);
+        double sealedUs = ((double)sealedBytes / iterations + PHY_OVERHEAD_OF(simPhy()->preambleLength))
+                          * 8 * phyBitNs(simPhy()) / 1000;
+
+        printf("%-8s %6u %10.0f %10.0f %12.0f %12.0f %8.1f\n", kinds[k].name, length,
+               (double)sealNs / iterations, (double)openNs / iterations, plainUs,
+               sealedUs - plainUs, 100.0 * (sealedUs - plainUs) / plainUs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+//
+//  fuzz.h
+//  Fuzz harnesses of what the firmwares take from outside: the receiver's bytes, frames
+//  off the air and the RX entries the RF core writes them into
+//
+//  Each harness is one LLVMFuzzerTestOneInput(), built either with libFuzzer
+//  (MAPLESEED_FUZZ, clang) or with fuzzMain.c, which runs it on files and directories of
+//  inputs: the seed corpus in host/fuzz/corpus under ctest, crashes found elsewhere, or the
+//  input AFL passes. A harness aborts when an oracle fails; the sanitizers catch the rest.
+//
+
+#ifndef fuzz_h
+#define fuzz_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Aborts with the condition and its line if cond does not hold, as a crash the fuzzer keeps.
+#define FUZZ_ASSERT(cond)   ((cond) ? (void)0 : fuzzFailed(__FILE__, __LINE__, #cond))
+
+void fuzzFailed(const char * file, int line, const char * cond);
+
+/// The harness: one input, returns 0.
+int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size);
+
+/* fuzzFrame.c: the frame decoders of both firmwares */
+
+/// Gateway and tracker state back to boot. Call at the start of every input.
+void fuzzFrameInit(void);
+
+/// A frame off the air (header and payload, without length and status byte) through what
+/// the gateway and, for BEACON and ACK frames, the tracker do with it. Decoded in place,
+/// as the gateway does: the frame may be changed.
+void fuzzFrame(uint8_t * frame, uint8_t length);
+
+/// frame sealed by a tracker (secureLink.h), to reach what comes after secureOpen(). Returns
+/// the sealed length, 0 if it does not fit into maxLength.
+uint8_t fuzzFrameSeal(uint8_t * frame, uint8_t length, uint8_t maxLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* fuzz_h */
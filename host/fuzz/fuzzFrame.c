@@ -0,0 +1,281 @@
+//
+//  fuzzFrame.c
+//  The frame decoders of both firmwares, as the fuzz harnesses drive them
+//
+//  fuzzFrame() follows handlePacket() in rfPacketRx.c: header, TDMA slot bookkeeping,
+//  secureOpen() of sealed frames, the ACK, then the decoder of each frame type with the
+//  gateway's output buffers at their firmware sizes. BEACON and ACK frames also go to the
+//  tracker's tdmaNodeOnBeacon() and arqNodeOnAck(). Decoded records are encoded and decoded
+//  again, which must give the same values. Every frame also goes to a relay, whose RELAY
+//  frames must parse back into what it took; the frames of a RELAY frame go through the
+//  gateway as if heard directly.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arqMac.h"
+#include "fixEpoch.h"
+#include "fixLog.h"
+#include "fuzz.h"
+#include "geoFence.h"
+#include "gpsParser.h"
+#include "meshRelay.h"
+#include "metrics.h"
+#include "packetCodec.h"
+#include "secureLink.h"
+#include "softCcm.h"
+#include "tdmaMac.h"
+
+#define TELEMETRY_LINE_LENGTH   400     // telemetryLine of rfPacketRx.c
+
+static const uint8_t networkKey[SECURE_KEY_LENGTH] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static SoftCcm txCcm, rxCcm;
+static const SecureCipher txCipher = { &txCcm, softCcmSetKey, softCcmEncrypt, softCcmDecrypt };
+static const SecureCipher rxCipher = { &rxCcm, softCcmSetKey, softCcmEncrypt, softCcmDecrypt };
+
+static const NMEAHandler allParsers[] = {
+    { NMEA_GGA, nmeaParseGGA }, { NMEA_GSA, nmeaParseGSA }, { NMEA_RMC, nmeaParseRMC },
+    { NMEA_GSV, nmeaParseGSV }, { NMEA_VTG, nmeaParseVTG }, { NMEA_GLL, nmeaParseGLL },
+    { NMEA_ZDA, nmeaParseZDA }
+};
+
+/* Gateway */
+static GPSData data;
+static TdmaGateway tdmaGateway;
+static ArqGateway arqGateway;
+static SecureGateway secureGateway;
+static char msgParsed[NMEA_STRING_LENGTH];
+static char telemetryLine[TELEMETRY_LINE_LENGTH];
+static MetricsSnapshot snapshot, again;
+static MeshDedup meshSeen;
+
+/* Relay */
+static MeshRelay meshRelay;
+static uint8_t relayFrame[MESH_MAX_FRAME_LENGTH];
+
+/* Tracker */
+static TdmaNode tdmaNode;
+static ArqNode arqNode;
+static SecureNode secureNode;
+
+void fuzzFailed(const char * file, int line, const char * cond) {
+
+    fprintf(stderr, "%s:%d: %s\n", file, line, cond);
+    abort();
+}
+
+void fuzzFrameInit(void) {
+
+    TdmaFrameConfig tdmaConfig;
+    ArqConfig arqConfig;
+    MeshConfig meshConfig;
+
+    nmeaDataInit(&data);
+    nmeaRegisterHandlers(allParsers, sizeof(allParsers) / sizeof(allParsers[0]));
+    tdmaDefaultConfig(&tdmaConfig);
+    tdmaGatewayInit(&tdmaGateway, &tdmaConfig);
+    arqGatewayInit(&arqGateway);
+    secureGatewayInit(&secureGateway, &rxCipher, networkKey);
+    meshDedupInit(&meshSeen);
+
+    meshDefaultConfig(&meshConfig);
+    meshRelayInit(&meshRelay, &meshConfig, 0xF1, 1);
+
+    tdmaNodeInit(&tdmaNode, 1);
+    arqDefaultConfig(&arqConfig);
+    arqNodeInit(&arqNode, &arqConfig);
+    secureNodeInit(&secureNode, &txCipher, networkKey, 1);
+}
+
+uint8_t fuzzFrameSeal(uint8_t * frame, uint8_t length, uint8_t maxLength) {
+
+    return secureSeal(&secureNode, frame, length, maxLength);
+}
+
+/* Field by field, the padding is not part of it */
+static int sameSnapshot(const MetricsSnapshot * a, const MetricsSnapshot * b) {
+
+    return a->flags == b->flags && a->uptimeS == b->uptimeS &&
+           memcmp(a->counters, b->counters, sizeof(a->counters)) == 0 &&
+           memcmp(a->gauges, b->gauges, sizeof(a->gauges)) == 0 &&
+           memcmp(a->histograms, b->histograms, sizeof(a->histograms)) == 0;
+}
+
+static void telemetry(const PacketHeader * hdr, const uint8_t * payload, uint8_t length) {
+
+    uint8_t record[METRICS_RECORD_MAX_LENGTH];
+
+    if (metricsDecode(&snapshot, payload, length))
+        return;
+
+    int n = sprintf(telemetryLine, "telemetry\tnode:\t%u\t", hdr->nodeId);
+    uint16_t formatted = metricsFormat(&snapshot, telemetryLine + n, sizeof(telemetryLine) - n - 2);
+    FUZZ_ASSERT(formatted < sizeof(telemetryLine) - n - 2);
+    FUZZ_ASSERT(formatted == strlen(telemetryLine + n));
+
+    /* Every value fits a record of the largest size */
+    uint8_t recordLength = metricsEncode(&snapshot, record, sizeof(record));
+    FUZZ_ASSERT(!(record[1] & METRICS_TRUNCATED) || (snapshot.flags & METRICS_TRUNCATED));
+    FUZZ_ASSERT(metricsDecode(&again, record, recordLength) == 0);
+    FUZZ_ASSERT(sameSnapshot(&snapshot, &again));
+}
+
+static void fixRecords(const uint8_t * payload, uint8_t length) {
+
+    FixRecord rec, back;
+    uint8_t wire[FIX_RECORD_WIRE_LENGTH];
+
+    while (length >= FIX_RECORD_WIRE_LENGTH) {
+        memset(&rec, 0, sizeof(rec));
+        memset(&back, 0, sizeof(back));
+        fixRecordDecode(&rec, payload);
+        fixRecordEncode(&rec, wire);
+        fixRecordDecode(&back, wire);
+        FUZZ_ASSERT(memcmp(&rec, &back, sizeof(rec)) == 0);
+        payload += FIX_RECORD_WIRE_LENGTH;
+        length -= FIX_RECORD_WIRE_LENGTH;
+    }
+}
+
+static void fenceEvents(const uint8_t * payload, uint8_t length) {
+
+    GeoFenceEvent event, back;
+    uint8_t wire[GEOFENCE_EVENT_WIRE_LENGTH];
+
+    if (length < FIX_RECORD_WIRE_LENGTH)
+        return;
+    fixRecords(payload, FIX_RECORD_WIRE_LENGTH);
+    payload += FIX_RECORD_WIRE_LENGTH;
+    length -= FIX_RECORD_WIRE_LENGTH;
+
+    while (length >= GEOFENCE_EVENT_WIRE_LENGTH) {
+        memset(&event, 0, sizeof(event));
+        memset(&back, 0, sizeof(back));
+        geoFenceEventDecode(&event, payload);
+        geoFenceEventEncode(&event, wire);
+        geoFenceEventDecode(&back, wire);
+        FUZZ_ASSERT(memcmp(&event, &back, sizeof(event)) == 0);
+        payload += GEOFENCE_EVENT_WIRE_LENGTH;
+        length -= GEOFENCE_EVENT_WIRE_LENGTH;
+    }
+}
+
+static void epochFix(const uint8_t * payload, uint8_t length) {
+
+    EpochFix e, back;
+    uint8_t wire[FIX_EPOCH_WIRE_LENGTH];
+
+    if (length < FIX_EPOCH_WIRE_LENGTH)
+        return;
+    memset(&e, 0, sizeof(e));
+    memset(&back, 0, sizeof(back));
+    fixEpochDecode(&e, payload);
+    fixEpochEncode(&e, wire);
+    fixEpochDecode(&back, wire);
+    FUZZ_ASSERT(memcmp(&e, &back, sizeof(e)) == 0);
+}
+
+/* The frame as a relay takes it, before the gateway opens it; sent on right away */
+static void relay(const uint8_t * frame, uint8_t length) {
+
+    MeshEntry entry;
+
+    meshRelayAccept(&meshRelay, frame, length, 0, 0);
+    FUZZ_ASSERT(meshRelay.count <= MESH_QUEUE_ENTRIES);
+
+    while (meshRelayWaitMs(&meshRelay, 0) != MESH_FOREVER) {
+
+        uint32_t forwarded = meshRelay.forwarded;
+        uint8_t n = meshRelayBuild(&meshRelay, relayFrame, sizeof(relayFrame));
+        uint8_t offset = 0, entries = 0;
+
+        FUZZ_ASSERT(n > MESH_RELAY_HEADER_LENGTH && n <= sizeof(relayFrame));
+        while (meshNextEntry(relayFrame, n, &offset, &entry) == 0) {
+            FUZZ_ASSERT(entry.hops >= 1 && entry.ttl < 0x0F);
+            ++entries;
+        }
+        FUZZ_ASSERT(offset == n && entries == meshRelay.forwarded - forwarded);
+    }
+}
+
+void fuzzFrame(uint8_t * frame, uint8_t length) {
+
+    PacketHeader hdr;
+    uint8_t ack[PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH];
+    uint8_t isNew = 1;
+    MeshEntry entry;
+    uint8_t offset = 0;
+
+    if (pktDecodeHeader(&hdr, frame, length))
+        return;
+    FUZZ_ASSERT(length >= PKT_HEADER_LENGTH);
+
+    relay(frame, length);
+
+    /* Root: the frames it carries, each once */
+    if (hdr.type == PKT_TYPE_RELAY) {
+        while (meshNextEntry(frame, length, &offset, &entry) == 0) {
+            FUZZ_ASSERT(entry.frame + entry.length <= frame + length);
+            if (!meshDedupCheck(&meshSeen, entry.nodeId, entry.seq))
+                fuzzFrame((uint8_t *)entry.frame, entry.length);
+        }
+        return;
+    }
+
+    /* Tracker */
+    if (hdr.type == PKT_TYPE_BEACON)
+        tdmaNodeOnBeacon(&tdmaNode, frame + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH);
+    else if (hdr.type == PKT_TYPE_ACK)
+        arqNodeOnAck(&arqNode, hdr.seq, frame + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH);
+
+    /* Gateway */
+    switch (hdr.type) {
+        case PKT_TYPE_JOIN:
+            tdmaGatewayJoin(&tdmaGateway, hdr.nodeId);
+            break;
+        case PKT_TYPE_LEAVE:
+            tdmaGatewayLeave(&tdmaGateway, hdr.nodeId);
+            break;
+        case PKT_TYPE_DATA:
+        case PKT_TYPE_FIX:
+            tdmaGatewayHeard(&tdmaGateway, hdr.nodeId);
+            break;
+    }
+
+    if ((hdr.type == PKT_TYPE_DATA || hdr.type == PKT_TYPE_LOG || hdr.type == PKT_TYPE_FIX ||
+         hdr.type == PKT_TYPE_TELEMETRY) && (hdr.flags & PKT_FLAG_SECURE)) {
+        uint8_t sealed = length;
+        SecureStatus status = secureOpen(&secureGateway, frame, &length);
+        if (status == SECURE_REJECTED)
+            return;
+        FUZZ_ASSERT(length <= sealed && length >= PKT_HEADER_LENGTH);
+        isNew = status == SECURE_NEW;
+    }
+    if (hdr.type == PKT_TYPE_DATA || hdr.type == PKT_TYPE_LOG || hdr.type == PKT_TYPE_FIX) {
+        isNew &= arqGatewayReceive(&arqGateway, hdr.nodeId, hdr.seq);
+        FUZZ_ASSERT(arqGatewayBuildAck(&arqGateway, hdr.nodeId, ARQ_NO_RSSI,
+                                       ack, sizeof(ack)) <= sizeof(ack));
+    }
+
+    const uint8_t * payload = frame + PKT_HEADER_LENGTH;
+    uint8_t payloadLength = length - PKT_HEADER_LENGTH;
+
+    if (hdr.type == PKT_TYPE_DATA && isNew && payloadLength > 0) {
+        if (nmeaReceiveView(&data, (char *)frame + PKT_HEADER_LENGTH, payloadLength) == 0)
+            nmeaParse(&data);
+        nmeaToString(&data, msgParsed);
+    }
+
+    if (hdr.type == PKT_TYPE_TELEMETRY && isNew)
+        telemetry(&hdr, payload, payloadLength);
+    else if (hdr.type == PKT_TYPE_FIX && isNew)
+        epochFix(payload, payloadLength);
+    else if (hdr.type == PKT_TYPE_LOG && isNew && (hdr.flags & PKT_FLAG_FENCE))
+        fenceEvents(payload, payloadLength);
+    else if (hdr.type == PKT_TYPE_LOG && isNew)
+        fixRecords(payload, payloadLength);
+}
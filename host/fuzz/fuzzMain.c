@@ -0,0 +1,103 @@
+//
+//  fuzzMain.c
+//  Runs a fuzz harness on inputs from files, without libFuzzer
+//
+//  Each argument is a file or a directory of files, each file one input; options starting
+//  with '-' are skipped, so a libFuzzer command line replays its corpus. Without files the
+//  input is read from stdin. This is what ctest runs on the seed corpus, what reproduces a
+//  crash from a libFuzzer or AFL run, and what AFL itself runs (afl-fuzz ... -- harness @@).
+//
+//  usage: harness [file | directory]...
+//
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "fuzz.h"
+
+#define FUZZ_MAX_INPUT   (1 << 20)
+
+static uint8_t input[FUZZ_MAX_INPUT];
+static unsigned runs;
+
+static int runStream(FILE * f) {
+
+    size_t size = fread(input, 1, sizeof(input), f);
+
+    if (ferror(f))
+        return 1;
+
+    /* A copy of exactly its size, so reading past the input is caught */
+    uint8_t * data = malloc(size ? size : 1);
+    memcpy(data, input, size);
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    ++runs;
+
+    return 0;
+}
+
+static int runFile(const char * path) {
+
+    FILE * f = fopen(path, "rb");
+
+    if (f == NULL) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    int failed = runStream(f);
+    fclose(f);
+
+    return failed;
+}
+
+static int runPath(const char * path) {
+
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return runFile(path);
+
+    DIR * dir = opendir(path);
+    struct dirent * e;
+    char file[4096];
+    int failed = 0;
+
+    if (dir == NULL) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    while ((e = readdir(dir)) != NULL) {
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        failed |= runPath(file);
+    }
+    closedir(dir);
+
+    return failed;
+}
+
+int main(int argc, char * argv[]) {
+
+    int i, failed = 0, files = 0;
+
+    for (i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-')
+            continue;
+        failed |= runPath(argv[i]);
+        ++files;
+    }
+    if (files == 0)
+        failed |= runStream(stdin);
+
+    printf("%u inputs\n", runs);
+    return failed || runs == 0;
+}
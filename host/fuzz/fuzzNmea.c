@@ -0,0 +1,115 @@
+//
+//  fuzzNmea.c
+//  Fuzz harness of the sentence parser (gpsParser.c) and the tracker's GNSS input
+//  (gnssInput.c), NMEA and UBX
+//
+//  The input is checked in place within its length, as the gateway does with a frame's
+//  payload, and as a string, as the tracker does with a UART line; each is parsed by every
+//  parser and formatted into a buffer of NMEA_STRING_LENGTH. A sentence that passes must
+//  lie within the input and carry the checksum of its text. Then the input is fed byte by
+//  byte to both GNSS backends, which must not complete more fixes than they promise.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuzz.h"
+#include "gnssInput.h"
+#include "gpsParser.h"
+
+static const NMEAHandler allParsers[] = {
+    { NMEA_GGA, nmeaParseGGA }, { NMEA_GSA, nmeaParseGSA }, { NMEA_RMC, nmeaParseRMC },
+    { NMEA_GSV, nmeaParseGSV }, { NMEA_VTG, nmeaParseVTG }, { NMEA_GLL, nmeaParseGLL },
+    { NMEA_ZDA, nmeaParseZDA }
+};
+
+static GPSData data;
+static GnssInput input;
+
+static int8_t hexValue(char c) {
+
+    if (c >= '0' && c <= '9')
+        return (int8_t)(c - '0');
+    if (c >= 'A' && c <= 'F')
+        return (int8_t)(c - 'A' + 10);
+    if (c >= 'a' && c <= 'f')
+        return (int8_t)(c - 'a' + 10);
+    return -1;
+}
+
+/* The sentence that passed: '$' to the '*' the parser cut at, within buf */
+static void checkAccepted(const char * buf, size_t length) {
+
+    const char * text = data.nmeaData.text;
+    uint8_t checksum = 0;
+    size_t n = strlen(text);
+
+    FUZZ_ASSERT(text[0] == '$' && n < SENTENCE_LENGTH);
+    FUZZ_ASSERT(text >= buf && text + n + 3 <= buf + length);
+    for (size_t i = 1; i < n; ++i)
+        checksum ^= (uint8_t)text[i];
+    FUZZ_ASSERT(hexValue(text[n + 1]) == checksum >> 4 && hexValue(text[n + 2]) == (checksum & 0x0F));
+}
+
+static void parseAndFormat(void) {
+
+    char * line = malloc(NMEA_STRING_LENGTH);
+
+    nmeaParse(&data);
+    nmeaToString(&data, line);
+
+    NMEASystemSummary summary[NMEA_SYSTEMS];
+    nmeaSystemSummary(&data, summary);
+    FUZZ_ASSERT(data.numInView <= NMEA_MAX_SATELLITES && data.numUsed <= NMEA_MAX_USED);
+
+    free(line);
+}
+
+static void feed(const GnssBackend * backend, const uint8_t * bytes, size_t size) {
+
+    EpochFix fixes[GNSS_INPUT_MAX_FIXES];
+    uint32_t nowMs = 0;
+
+    gnssInputInit(&input, backend);
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t n = gnssInputPush(&input, bytes[i], nowMs, fixes);
+        FUZZ_ASSERT(n <= GNSS_INPUT_MAX_FIXES);
+        for (uint8_t k = 0; k < n; ++k)
+            FUZZ_ASSERT((fixes[k].have & ~(FIX_EPOCH_POSITION | FIX_EPOCH_ALTITUDE | FIX_EPOCH_MOTION)) == 0);
+        nowMs += 1 + bytes[i] % 64;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t * bytes, size_t size) {
+
+    /* In place, exactly as long as the input, as a frame's payload of up to 255 bytes */
+    size_t viewLength = size < 255 ? size : 255;
+    char * view = malloc(viewLength ? viewLength : 1);
+    memcpy(view, bytes, viewLength);
+
+    nmeaDataInit(&data);
+    nmeaRegisterHandlers(allParsers, sizeof(allParsers) / sizeof(allParsers[0]));
+    if (nmeaReceiveView(&data, view, (uint8_t)viewLength) == 0) {
+        checkAccepted(view, viewLength);
+        parseAndFormat();
+    }
+    else {
+        FUZZ_ASSERT(data.nmeaData.msgType == NMEA_UNKNOWN);
+    }
+    free(view);
+
+    /* As a string, as a UART line */
+    char * line = malloc(size + 1);
+    memcpy(line, bytes, size);
+    line[size] = '\0';
+    if (nmeaReceiveSentence(&data, line) == 0) {
+        checkAccepted(data.nmeaData.sentence, sizeof(data.nmeaData.sentence));
+        parseAndFormat();
+    }
+    free(line);
+
+    feed(&gnssNmeaBackend, bytes, size);
+    feed(&gnssUbxBackend, bytes, size);
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+//
+//  fuzzPacket.c
+//  Fuzz harness of the frame decoders: a run of frames off the air through the gateway and
+//  tracker (fuzzFrame.c)
+//
+//  Input: records of
+//
+//      byte 0      options: FUZZ_PACKET_SEAL seals the frame as a tracker would first
+//      byte 1      frame length
+//      then        the frame, header and payload, cut short at the end of the input
+//
+//  State carries over from frame to frame within an input, as it does on the gateway:
+//  slots, ACK windows and the replay window.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuzz.h"
+#include "secureLink.h"
+
+#define FUZZ_PACKET_SEAL    0x01
+
+#define SEAL_ROOM           (SECURE_EPOCH_LENGTH + SECURE_MIC_LENGTH)
+
+int LLVMFuzzerTestOneInput(const uint8_t * bytes, size_t size) {
+
+    const uint8_t * end = bytes + size;
+
+    fuzzFrameInit();
+
+    while (end - bytes >= 2) {
+        uint8_t options = bytes[0];
+        uint8_t length = bytes[1];
+        bytes += 2;
+        if (length > end - bytes)
+            length = (uint8_t)(end - bytes);
+
+        /* Exactly as long as the frame, so reading past it is caught */
+        uint8_t room = (options & FUZZ_PACKET_SEAL) && length <= 255 - SEAL_ROOM ? SEAL_ROOM : 0;
+        uint8_t * frame = malloc(length + room ? length + room : 1);
+        memcpy(frame, bytes, length);
+        bytes += length;
+
+        if (room) {
+            uint8_t sealed = fuzzFrameSeal(frame, length, (uint8_t)(length + room));
+            if (sealed)
+                length = sealed;
+        }
+        fuzzFrame(frame, length);
+        free(frame);
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+//
+//  fuzzRxEntry.c
+//  Fuzz harness of the gateway's RX entry handling: frames written into the RX queue as
+//  the RF core does and read back out of it into the frame decoders (fuzzFrame.c)
+//
+//  Input: a pool byte, then records of
+//
+//      byte 0      when the gateway reads: FUZZ_READ_END after the frame, FUZZ_READ_ENTRY
+//                  after each entry the RF core finishes during it
+//      byte 1      frame length, the RF core's length byte
+//      then        the frame, cut short at the end of the input
+//
+//  Pool byte, bit 7 clear: partial read entries (RFQueue_definePartialQueue(), rxStream.h)
+//  filled by the model of the RF core in rfCoreSim.c; 2 to 5 entries (bits 0..1) of 16 to
+//  256 data bytes (bits 2..5), and an assembly buffer of 64 bytes instead of 257 if bit 6
+//  is set. The RF core's PROP_ERROR_RXFULL is handled as rfPacketRx.c does, with a flush.
+//  Bit 7 set: general entries (RFQueue_defineQueue()), 2 to 5 (bits 0..1) of the gateway's
+//  102 byte frames, or 255 if bit 6 is set; a frame that finds no entry pending is lost.
+//
+//  Every frame the gateway gets must be one that was sent, whole, and in order.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "RFQueue.h"
+#include "fuzz.h"
+#include "rfCoreSim.h"
+
+#define FUZZ_READ_END       0x01
+#define FUZZ_READ_ENTRY     0x02
+
+#define FUZZ_POOL_GENERAL   0x80
+#define FUZZ_POOL_SMALL     0x40
+
+#define NUM_APPENDED_BYTES  2       // length byte and status byte
+#define STATUS_CRC_OK       0x80
+#define MAX_FRAMES          1024
+
+typedef struct {
+    const uint8_t * bytes;          // the frame, without length and status byte
+    uint8_t         length;
+} Sent;
+
+static Sent sent[MAX_FRAMES];
+static uint16_t numSent, nextSent;
+
+/* Must be a frame sent after the one handed out last; the frames between were lost */
+static void expect(const uint8_t * frame, uint8_t length) {
+
+    while (nextSent < numSent) {
+        const Sent * s = &sent[nextSent++];
+        if (s->length == length && memcmp(s->bytes, frame, length) == 0)
+            return;
+    }
+    FUZZ_ASSERT(!"a frame that was not sent, or out of order");
+}
+
+static void handlePackets(RxStream * stream) {
+
+    const uint8_t * frame;
+    uint16_t n;
+
+    while ((n = rxStreamPacket(stream, &frame)) > 0) {
+        FUZZ_ASSERT(n == frame[0] + NUM_APPENDED_BYTES && frame[n - 1] == STATUS_CRC_OK);
+        expect(frame + 1, frame[0]);
+        fuzzFrame((uint8_t *)frame + 1, frame[0]);
+    }
+}
+
+static void runPartial(uint8_t pool, const uint8_t * bytes, const uint8_t * end) {
+
+    uint8_t numEntries = 2 + (pool & 0x03);
+    uint16_t dataSize = (uint16_t)(16 + 16 * ((pool >> 2) & 0x0F));
+    uint16_t bufLength = (uint16_t)RF_QUEUE_PARTIAL_ENTRY_BUFFER_SIZE(numEntries, dataSize);
+    uint16_t assemblyLength = (pool & FUZZ_POOL_SMALL) ? 64 : 255 + NUM_APPENDED_BYTES;
+    uint8_t * buf = malloc(bufLength);         // aligned to at least a pointer
+    uint8_t * assembly = malloc(assemblyLength);
+    dataQueue_t queue;
+    RxStream stream;
+    SimRfCore core;
+
+    FUZZ_ASSERT(RFQueue_definePartialQueue(&queue, &stream, buf, bufLength, numEntries, dataSize,
+                                           assembly, assemblyLength) == 0);
+    simRfCoreInit(&core, queue.pCurrEntry);
+
+    while (end - bytes >= 2 && numSent < MAX_FRAMES) {
+        uint8_t ctl = bytes[0];
+        uint8_t length = bytes[1];
+        bytes += 2;
+        if (length > end - bytes)
+            length = (uint8_t)(end - bytes);
+        sent[numSent].bytes = bytes;
+        sent[numSent++].length = length;
+
+        /* Length byte, frame, status byte, as the RF core writes them */
+        uint16_t i;
+        for (i = 0; i < length + NUM_APPENDED_BYTES; ++i) {
+            uint8_t byte = i == 0 ? length : i <= length ? bytes[i - 1] : STATUS_CRC_OK;
+            uint32_t entries = core.entries;
+            if (!simRfCoreByte(&core, byte, i == 0)) {
+                /* PROP_ERROR_RXFULL: flush, restart RX, the rest of the frame is lost */
+                RFQueue_flushPartialQueue(&queue, &stream);
+                simRfCoreRestart(&core, queue.pCurrEntry);
+                break;
+            }
+            if ((ctl & FUZZ_READ_ENTRY) && core.entries != entries)
+                handlePackets(&stream);
+        }
+        if (i == length + NUM_APPENDED_BYTES)
+            simRfCoreEnd(&core);
+        if (ctl & FUZZ_READ_END)
+            handlePackets(&stream);
+        bytes += length;
+    }
+    handlePackets(&stream);
+
+    free(assembly);
+    free(buf);
+}
+
+static void runGeneral(uint8_t pool, const uint8_t * bytes, const uint8_t * end) {
+
+    uint8_t numEntries = 2 + (pool & 0x03);
+    uint8_t maxLength = (pool & FUZZ_POOL_SMALL) ? 255 : 102;
+    uint16_t entryLength = maxLength + NUM_APPENDED_BYTES;
+    uint16_t bufLength = (uint16_t)RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(numEntries, maxLength, NUM_APPENDED_BYTES);
+    uint8_t * buf = malloc(bufLength);
+    dataQueue_t queue;
+
+    FUZZ_ASSERT(RFQueue_defineQueue(&queue, buf, bufLength, numEntries, entryLength) == 0);
+    rfc_dataEntryGeneral_t * coreEntry = (rfc_dataEntryGeneral_t *)queue.pCurrEntry;
+
+    while (end - bytes >= 2 && numSent < MAX_FRAMES) {
+        uint8_t ctl = bytes[0];
+        uint8_t length = bytes[1];
+        bytes += 2;
+        if (length > end - bytes)
+            length = (uint8_t)(end - bytes);
+
+        /* Longer than the RX command takes, or no entry free: the RF core drops it */
+        if (length <= maxLength && coreEntry->status == DATA_ENTRY_PENDING) {
+            sent[numSent].bytes = bytes;
+            sent[numSent++].length = length;
+            uint8_t * data = (uint8_t *)coreEntry + RF_QUEUE_DATA_ENTRY_HEADER_SIZE;
+            data[0] = length;
+            memcpy(data + 1, bytes, length);
+            data[1 + length] = STATUS_CRC_OK;
+            coreEntry->status = DATA_ENTRY_FINISHED;
+            coreEntry = (rfc_dataEntryGeneral_t *)coreEntry->pNextEntry;
+        }
+        bytes += length;
+
+        /* As the RF callback: the frame at &data, its length byte first */
+        while ((ctl & (FUZZ_READ_END | FUZZ_READ_ENTRY)) &&
+               RFQueue_getDataEntry()->status == DATA_ENTRY_FINISHED) {
+            rfc_dataEntryGeneral_t * entry = RFQueue_getDataEntry();
+            uint8_t packetLength = *(uint8_t *)(&entry->data);
+            uint8_t * packet = (uint8_t *)(&entry->data + 1);
+            expect(packet, packetLength);
+            fuzzFrame(packet, packetLength);
+            RFQueue_nextEntry();
+        }
+    }
+
+    free(buf);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t * bytes, size_t size) {
+
+    if (size == 0)
+        return 0;
+
+    fuzzFrameInit();
+    numSent = 0;
+    nextSent = 0;
+
+    if (bytes[0] & FUZZ_POOL_GENERAL)
+        runGeneral(bytes[0], bytes + 1, bytes + size);
+    else
+        runPartial(bytes[0], bytes + 1, bytes + size);
+
+    return 0;
+}
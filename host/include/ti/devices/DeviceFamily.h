@@ -0,0 +1,15 @@
+//
+//  DeviceFamily.h
+//  Host stand-in of the SDK's ti/devices/DeviceFamily.h: the device family is the CC13x0
+//
+//  Only what the common modules include is here, so RFQueue.c builds on the host.
+//
+
+#ifndef DeviceFamily_h
+#define DeviceFamily_h
+
+#define DeviceFamily_CC13X0
+#define DeviceFamily_DIRECTORY          cc13x0
+#define DeviceFamily_constructPath(x)   <ti/devices/cc13x0/x>
+
+#endif /* DeviceFamily_h */
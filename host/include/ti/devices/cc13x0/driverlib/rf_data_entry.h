@@ -0,0 +1,73 @@
+//
+//  rf_data_entry.h
+//  Host stand-in of the CC13x0 driverlib's RF core data entries and queue
+//
+//  The fields are those of the SDK header, in its order; pointers are the host's width, so
+//  the data of an entry starts at 12 rather than 8 on a 64 bit host. Code that steps over
+//  entries uses offsetof() and sizeof(uint8_t *) and holds on both.
+//
+
+#ifndef rf_data_entry_h
+#define rf_data_entry_h
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t * pCurrEntry;       // entry the RF core uses next, NULL if none
+    uint8_t * pLastEntry;       // NULL for a circular queue
+} dataQueue_t;
+
+typedef struct {
+    uint8_t * pNextEntry;
+    uint8_t   status;           // DATA_ENTRY_*
+    struct {
+        uint8_t type:2;         // DATA_ENTRY_TYPE_*
+        uint8_t lenSz:2;
+        uint8_t irqIntv:4;
+    } config;
+    uint16_t  length;
+} rfc_dataEntry_t;
+
+typedef struct {
+    uint8_t * pNextEntry;
+    uint8_t   status;
+    struct {
+        uint8_t type:2;
+        uint8_t lenSz:2;
+        uint8_t irqIntv:4;
+    } config;
+    uint16_t  length;
+    uint8_t   data;             // first byte of the data
+} rfc_dataEntryGeneral_t;
+
+typedef struct {
+    uint8_t * pNextEntry;
+    uint8_t   status;
+    struct {
+        uint8_t type:2;
+        uint8_t lenSz:2;
+        uint8_t irqIntv:4;
+    } config;
+    uint16_t  length;
+    struct {
+        uint16_t numElements:13;
+        uint16_t bEntryOpen:1;
+        uint16_t bFirstCont:1;
+        uint16_t bLastCont:1;
+    } pktStatus;
+    uint16_t  nextIndex;
+    uint8_t   rxData;           // first byte of the data
+} rfc_dataEntryPartial_t;
+
+#define DATA_ENTRY_PENDING              0
+#define DATA_ENTRY_ACTIVE               1
+#define DATA_ENTRY_BUSY                 2
+#define DATA_ENTRY_FINISHED             3
+#define DATA_ENTRY_UNFINISHED           4
+
+#define DATA_ENTRY_TYPE_GEN             0
+#define DATA_ENTRY_TYPE_MULTI           1
+#define DATA_ENTRY_TYPE_PTR             2
+#define DATA_ENTRY_TYPE_PARTIAL         3
+
+#endif /* rf_data_entry_h */
@@ -0,0 +1,239 @@
+//
+//  channelSim.c
+//  Discrete event model of the shared radio channel
+//
+
+#include "channelSim.h"
+#include <stdlib.h>
+#include <string.h>
+
+/***** Random numbers *****/
+
+uint32_t simRandom(uint32_t * state) {
+
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+uint32_t simRandomBelow(uint32_t * state, uint32_t bound) {
+
+    return bound ? simRandom(state) % bound : 0;
+}
+
+/***** Event queue *****/
+
+static uint8_t simEventBefore(const SimEvent * a, const SimEvent * b) {
+
+    if (a->time != b->time)
+        return a->time < b->time;
+
+    return a->order < b->order;
+}
+
+void simQueueInit(SimEventQueue * q, uint32_t capacity) {
+
+    q->heap = malloc(capacity * sizeof(SimEvent));
+    q->count = 0;
+    q->capacity = capacity;
+    q->nextOrder = 0;
+}
+
+void simQueueFree(SimEventQueue * q) {
+
+    free(q->heap);
+    q->heap = NULL;
+    q->count = q->capacity = 0;
+}
+
+void simQueuePush(SimEventQueue * q, uint64_t time, uint16_t node, uint8_t type, uint32_t arg) {
+
+    if (q->count == q->capacity) {
+        q->capacity *= 2;
+        q->heap = realloc(q->heap, q->capacity * sizeof(SimEvent));
+    }
+
+    SimEvent ev;
+    ev.time  = time;
+    ev.order = q->nextOrder++;
+    ev.node  = node;
+    ev.type  = type;
+    ev.arg   = arg;
+
+    uint32_t i = q->count++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!simEventBefore(&ev, &q->heap[parent]))
+            break;
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+    q->heap[i] = ev;
+}
+
+uint8_t simQueuePop(SimEventQueue * q, SimEvent * ev) {
+
+    if (q->count == 0)
+        return 1;
+
+    *ev = q->heap[0];
+
+    SimEvent last = q->heap[--q->count];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= q->count)
+            break;
+        if (child + 1 < q->count && simEventBefore(&q->heap[child + 1], &q->heap[child]))
+            ++child;
+        if (!simEventBefore(&q->heap[child], &last))
+            break;
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    q->heap[i] = last;
+
+    return 0;
+}
+
+/***** Shared medium *****/
+
+void simMediumInit(SimMedium * m, uint32_t capacity) {
+
+    m->tx = malloc(capacity * sizeof(SimTx));
+    m->count = 0;
+    m->capacity = capacity;
+    m->nextId = 0;
+    m->airtimeUs = 0;
+}
+
+void simMediumFree(SimMedium * m) {
+
+    free(m->tx);
+    m->tx = NULL;
+    m->count = m->capacity = 0;
+}
+
+uint32_t simMediumTransmit(SimMedium * m, uint16_t src, uint8_t channel, uint64_t start, uint64_t durationUs) {
+
+    if (m->count == m->capacity) {
+        m->capacity *= 2;
+        m->tx = realloc(m->tx, m->capacity * sizeof(SimTx));
+    }
+
+    SimTx * tx = &m->tx[m->count++];
+    tx->id      = m->nextId++;
+    tx->start   = start;
+    tx->end     = start + durationUs;
+    tx->src     = src;
+    tx->channel = channel;
+
+    m->airtimeUs += durationUs;
+
+    return tx->id;
+}
+
+static const SimTx * simMediumFind(const SimMedium * m, uint32_t id) {
+
+    uint32_t i;
+    for (i = 0; i < m->count; ++i) {
+        if (m->tx[i].id == id)
+            return &m->tx[i];
+    }
+
+    return NULL;
+}
+
+uint8_t simMediumCollided(const SimMedium * m, uint32_t id) {
+
+    const SimTx * tx = simMediumFind(m, id);
+    if (tx == NULL)
+        return 1;
+
+    uint32_t i;
+    for (i = 0; i < m->count; ++i) {
+
+        const SimTx * other = &m->tx[i];
+
+        if (other->id == id || other->channel != tx->channel)
+            continue;
+
+        if (other->start < tx->end && tx->start < other->end)
+            return 1;
+    }
+
+    return 0;
+}
+
+uint8_t simMediumBusy(const SimMedium * m, uint8_t channel, uint64_t from, uint64_t to) {
+
+    uint32_t i;
+    for (i = 0; i < m->count; ++i) {
+        if (m->tx[i].channel == channel && m->tx[i].start < to && from < m->tx[i].end)
+            return 1;
+    }
+
+    return 0;
+}
+
+void simMediumPrune(SimMedium * m, uint64_t horizon) {
+
+    uint32_t i, kept = 0;
+    for (i = 0; i < m->count; ++i) {
+        if (m->tx[i].end >= horizon)
+            m->tx[kept++] = m->tx[i];
+    }
+
+    m->count = kept;
+}
+
+/***** Radio and GPS timing *****/
+
+static const PhyProfile * phy = &phyProfiles[PHY_PROFILE];
+
+void simSetPhy(const PhyProfile * p) {
+
+    phy = p;
+}
+
+const PhyProfile * simPhy(void) {
+
+    return phy;
+}
+
+uint64_t simAirtimeUs(uint8_t payloadLength) {
+
+    return phyAirtimeUs(phy, payloadLength);
+}
+
+uint64_t simSyncUs(void) {
+
+    return phySyncUs(phy);
+}
+
+uint8_t simSentenceLength(uint8_t sentence) {
+
+    return sentence == 0 ? SIM_GGA_LENGTH : SIM_RMC_LENGTH;
+}
+
+uint64_t simEnergyNj(uint64_t txUs, uint64_t rxUs) {
+
+    /* uA * us * mV = fJ */
+    return (txUs * SIM_TX_UA + rxUs * SIM_RX_UA) * SIM_SUPPLY_MV / 1000000;
+}
+
+uint64_t simSentenceDoneUs(uint32_t epoch, uint8_t sentence, uint32_t * rng) {
+
+    /* The module starts its burst shortly after the second; the RMC follows the GGA */
+    uint64_t t = (uint64_t)epoch * SIM_FIX_PERIOD_US + 20000 + simRandomBelow(rng, 30000);
+
+    t += (uint64_t)SIM_GGA_LENGTH * SIM_UART_BYTE_US;
+    if (sentence)
+        t += (uint64_t)SIM_RMC_LENGTH * SIM_UART_BYTE_US;
+
+    return t;
+}
@@ -0,0 +1,106 @@
+//
+//  channelSim.h
+//  Discrete event model of the shared radio channel, for host benchmarks of the MAC layers
+//
+//  Time is kept in microseconds. A transmission is lost at the gateway when any other
+//  transmission on the same channel overlaps it; there is no capture effect.
+//
+
+#ifndef channelSim_h
+#define channelSim_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "phyProfile.h"
+
+/* GPS output model: the module emits GGA then RMC once per second at 4800 baud,
+ * aligned to the UTC second on every tracker */
+#define SIM_FIX_PERIOD_US       1000000ULL
+#define SIM_UART_BYTE_US        2083        // 10 bits at 4800 baud
+#define SIM_GGA_LENGTH          72
+#define SIM_RMC_LENGTH          70
+#define SIM_SENTENCES_PER_FIX   2
+
+/* Radio model: frames take the airtime of a PHY profile (phyProfile.h), PHY_PROFILE
+ * unless simSetPhy() picks another */
+
+/* Radio supply current of the CC1310 at 3.0 V (datasheet, TX at +10 dBm) */
+#define SIM_SUPPLY_MV           3000
+#define SIM_TX_UA               13400
+#define SIM_RX_UA               5400
+
+typedef struct {
+    uint64_t time;
+    uint32_t order;     // insertion order, keeps events at the same time FIFO
+    uint16_t node;
+    uint8_t  type;
+    uint32_t arg;
+} SimEvent;
+
+typedef struct {
+    SimEvent * heap;
+    uint32_t   count;
+    uint32_t   capacity;
+    uint32_t   nextOrder;
+} SimEventQueue;
+
+typedef struct {
+    uint32_t id;
+    uint64_t start;
+    uint64_t end;
+    uint16_t src;
+    uint8_t  channel;
+} SimTx;
+
+typedef struct {
+    SimTx *  tx;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t nextId;
+    uint64_t airtimeUs;     // sum of all transmissions, for channel utilisation
+} SimMedium;
+
+/* Random numbers (xorshift32), state must not be 0 */
+uint32_t simRandom(uint32_t * state);
+uint32_t simRandomBelow(uint32_t * state, uint32_t bound);
+
+/* Event queue (binary min-heap) */
+void simQueueInit(SimEventQueue * q, uint32_t capacity);
+void simQueueFree(SimEventQueue * q);
+void simQueuePush(SimEventQueue * q, uint64_t time, uint16_t node, uint8_t type, uint32_t arg);
+/// Returns 0 and fills ev with the earliest event, 1 if the queue is empty.
+uint8_t simQueuePop(SimEventQueue * q, SimEvent * ev);
+
+/* Shared medium */
+void simMediumInit(SimMedium * m, uint32_t capacity);
+void simMediumFree(SimMedium * m);
+/// Puts a transmission on the air and returns its id.
+uint32_t simMediumTransmit(SimMedium * m, uint16_t src, uint8_t channel, uint64_t start, uint64_t durationUs);
+/// 1 if another transmission on the same channel overlapped transmission id.
+uint8_t simMediumCollided(const SimMedium * m, uint32_t id);
+/// 1 if any transmission on the channel is on the air during [from, to).
+uint8_t simMediumBusy(const SimMedium * m, uint8_t channel, uint64_t from, uint64_t to);
+/// Forgets transmissions that ended before horizon.
+void simMediumPrune(SimMedium * m, uint64_t horizon);
+
+/* Radio and GPS timing */
+void simSetPhy(const PhyProfile * phy);
+const PhyProfile * simPhy(void);
+uint64_t simAirtimeUs(uint8_t payloadLength);
+/// Preamble and sync word, after which a receiver keeps the frame.
+uint64_t simSyncUs(void);
+uint8_t simSentenceLength(uint8_t sentence);
+/// Radio energy in nanojoules for the given time in TX and in RX (including carrier sense).
+uint64_t simEnergyNj(uint64_t txUs, uint64_t rxUs);
+/// Time the tracker has the given sentence (0 = GGA, 1 = RMC) of fix epoch complete.
+uint64_t simSentenceDoneUs(uint32_t epoch, uint8_t sentence, uint32_t * rng);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* channelSim_h */
@@ -0,0 +1,147 @@
+//
+//  flashSim.c
+//  File backed model of the SPI NOR flash
+//
+
+#include "flashSim.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t simFlashBlank(SimFlash * f) {
+
+    uint8_t blank[256];
+    uint32_t done;
+
+    memset(blank, 0xFF, sizeof(blank));
+
+    if (fseek(f->file, 0, SEEK_SET))
+        return 1;
+
+    for (done = 0; done < f->size; done += sizeof(blank)) {
+        if (fwrite(blank, 1, sizeof(blank), f->file) != sizeof(blank))
+            return 1;
+    }
+
+    return fflush(f->file) != 0;
+}
+
+uint8_t simFlashOpen(SimFlash * f, const char * path, uint32_t size, uint32_t sectorSize) {
+
+    memset(f, 0, sizeof(*f));
+
+    if (sectorSize == 0 || size % sectorSize || size % 256)
+        return 1;
+
+    f->size = size;
+    f->sectorSize = sectorSize;
+    f->eraseCount = calloc(size / sectorSize, sizeof(uint32_t));
+    if (f->eraseCount == NULL)
+        return 1;
+
+    f->file = fopen(path, "r+b");
+
+    long existing = -1;
+    if (f->file != NULL && fseek(f->file, 0, SEEK_END) == 0)
+        existing = ftell(f->file);
+
+    if (existing != (long)size) {
+        if (f->file != NULL)
+            fclose(f->file);
+        f->file = fopen(path, "w+b");
+        if (f->file == NULL || simFlashBlank(f)) {
+            simFlashClose(f);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void simFlashClose(SimFlash * f) {
+
+    if (f->file != NULL)
+        fclose(f->file);
+    free(f->eraseCount);
+    f->file = NULL;
+    f->eraseCount = NULL;
+}
+
+uint8_t simFlashRead(void * ctx, uint32_t offset, void * buf, uint32_t length) {
+
+    SimFlash * f = ctx;
+
+    if (offset > f->size || length > f->size - offset || fseek(f->file, (long)offset, SEEK_SET))
+        return 1;
+
+    return fread(buf, 1, length, f->file) != length;
+}
+
+uint8_t simFlashWrite(void * ctx, uint32_t offset, const void * buf, uint32_t length) {
+
+    SimFlash * f = ctx;
+    const uint8_t * in = buf;
+    uint8_t old[256];
+
+    if (offset > f->size || length > f->size - offset)
+        return 1;
+
+    ++f->programs;
+    f->programmedBytes += length;
+    f->busyUs += SIM_FLASH_PROGRAM_US;
+
+    while (length > 0) {
+
+        /* One page program never crosses a page boundary */
+        uint32_t chunk = 256 - offset % 256;
+        uint32_t i;
+
+        if (chunk > length)
+            chunk = length;
+
+        if (simFlashRead(f, offset, old, chunk))
+            return 1;
+
+        for (i = 0; i < chunk; ++i) {
+            if (in[i] & ~old[i])
+                ++f->violations;
+            old[i] &= in[i];
+        }
+
+        if (fseek(f->file, (long)offset, SEEK_SET) || fwrite(old, 1, chunk, f->file) != chunk)
+            return 1;
+
+        offset += chunk;
+        in += chunk;
+        length -= chunk;
+    }
+
+    return fflush(f->file) != 0;
+}
+
+uint8_t simFlashErase(void * ctx, uint32_t offset, uint32_t length) {
+
+    SimFlash * f = ctx;
+    uint8_t blank[256];
+    uint32_t done;
+
+    if (offset % f->sectorSize || length % f->sectorSize || offset > f->size || length > f->size - offset)
+        return 1;
+
+    memset(blank, 0xFF, sizeof(blank));
+
+    for (done = 0; done < length; done += f->sectorSize) {
+        ++f->erases;
+        ++f->eraseCount[(offset + done) / f->sectorSize];
+        f->busyUs += SIM_FLASH_ERASE_US;
+    }
+
+    if (fseek(f->file, (long)offset, SEEK_SET))
+        return 1;
+
+    for (done = 0; done < length; done += sizeof(blank)) {
+        if (fwrite(blank, 1, sizeof(blank), f->file) != sizeof(blank))
+            return 1;
+    }
+
+    return fflush(f->file) != 0;
+}
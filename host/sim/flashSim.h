@@ -0,0 +1,49 @@
+//
+//  flashSim.h
+//  File backed model of the LaunchPad's SPI NOR flash, for host runs of fixLog.c
+//
+//  Programming can only clear bits (the stored byte becomes old & new) and erase works on
+//  whole sectors. The read, write and erase functions match the FixLogFlash callbacks with
+//  a SimFlash as context.
+//
+
+#ifndef flashSim_h
+#define flashSim_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* MX25R8035F typical timings */
+#define SIM_FLASH_PROGRAM_US    850     // page program, independent of the byte count
+#define SIM_FLASH_ERASE_US      40000   // 4 KB sector erase
+
+typedef struct {
+    FILE *     file;
+    uint32_t   size;
+    uint32_t   sectorSize;
+    uint32_t * eraseCount;      // per sector
+    uint32_t   programs;
+    uint32_t   programmedBytes;
+    uint32_t   erases;
+    uint32_t   violations;      // programs that tried to turn a 0 bit back into 1
+    uint64_t   busyUs;          // time the device spent programming and erasing
+} SimFlash;
+
+/// Opens the backing file, creating a blank (all 0xFF) one if it does not exist or has a
+/// different size. Returns 0 on success.
+uint8_t simFlashOpen(SimFlash * f, const char * path, uint32_t size, uint32_t sectorSize);
+void simFlashClose(SimFlash * f);
+
+uint8_t simFlashRead(void * ctx, uint32_t offset, void * buf, uint32_t length);
+uint8_t simFlashWrite(void * ctx, uint32_t offset, const void * buf, uint32_t length);
+uint8_t simFlashErase(void * ctx, uint32_t offset, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* flashSim_h */
@@ -0,0 +1,319 @@
+//
+//  gnssModuleSim.c
+//  Stand-in for a u-blox GNSS module
+//
+
+#include "gnssModuleSim.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DAY_MS          86400000UL
+#define EPOCH_MAX       1024            // bytes of one epoch, everything enabled
+
+static const char * const nmeaIds[] = { "GGA", "GLL", "GSA", "GSV", "RMC", "VTG" };
+
+static double byteUs(uint32_t baud) {
+
+    return 10e6 / baud;
+}
+
+static void putLe16(uint8_t * buf, uint16_t v) {
+
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static void putLe32(uint8_t * buf, uint32_t v) {
+
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+    buf[2] = (uint8_t)(v >> 16);
+    buf[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getLe32(const uint8_t * buf) {
+
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+void simGnssInit(SimGnssModule * m, uint32_t baud, uint32_t seed) {
+
+    memset(m, 0, sizeof(*m));
+    m->baud = baud;
+    m->acceptsConfig = 1;
+    m->nmeaOn = SIM_GNSS_NMEA_DEFAULT;
+    m->outProto = UBX_PROTO_UBX | UBX_PROTO_NMEA;
+    m->startTimeMs = (14 * 3600 + 2 * 60 + 10) * 1000;
+    ubxFramerInit(&m->framer, m->framerBuf, sizeof(m->framerBuf));
+
+    simSkyInit(&m->sky, seed);
+    m->epoch.day = 19;
+    m->epoch.month = 10;
+    m->epoch.year = 2026;
+    m->epoch.latE7 = 455017000;
+    m->epoch.lonE7 = -735673000;
+    m->epoch.altM = 41.2;
+    m->epoch.speedKn = 22.0;
+    m->epoch.courseDeg = 90.0;
+}
+
+uint64_t simGnssEpochUs(const SimGnssModule * m, uint32_t timeMs) {
+
+    return (uint64_t)((timeMs + DAY_MS - m->startTimeMs) % DAY_MS / 1000) * 1000000;
+}
+
+/***** Output *****/
+
+static uint16_t navPvt(const SimNmeaEpoch * e, uint8_t * out) {
+
+    uint8_t p[UBX_NAV_PVT_LENGTH];
+    uint32_t s = e->timeMs / 1000;
+    uint8_t fixType = e->sky.quality == 0 ? 0 : e->sky.quality == 6 ? 1 : e->sky.fixMode == 2 ? 2 : 3;
+
+    memset(p, 0, sizeof(p));
+    putLe32(p, e->timeMs);                  // iTOW, any time of week will do
+    putLe16(p + 4, e->year);
+    p[6]  = e->month;
+    p[7]  = e->day;
+    p[8]  = (uint8_t)(s / 3600);
+    p[9]  = (uint8_t)(s / 60 % 60);
+    p[10] = (uint8_t)(s % 60);
+    p[11] = 0x07;                           // date and time valid and resolved
+    p[20] = fixType;
+    p[21] = (uint8_t)((fixType ? 0x01 : 0) | (e->sky.quality == 2 ? 0x02 : 0));
+    p[23] = e->sky.satellites;
+    if (fixType) {
+        putLe32(p + 24, (uint32_t)e->lonE7);
+        putLe32(p + 28, (uint32_t)e->latE7);
+        putLe32(p + 36, (uint32_t)(int32_t)(e->altM * 1000));
+        putLe32(p + 60, (uint32_t)(int32_t)(e->speedKn * 514.444));
+        putLe32(p + 64, (uint32_t)(int32_t)(e->courseDeg * 1e5));
+    }
+    putLe16(p + 76, fixType ? (uint16_t)(e->sky.pdop * 100 + 0.5) : 9999);
+
+    return ubxBuild(UBX_NAV, UBX_NAV_PVT, p, sizeof(p), out);
+}
+
+static uint16_t navDop(const SimNmeaEpoch * e, uint8_t * out) {
+
+    uint8_t p[UBX_NAV_DOP_LENGTH];
+    uint8_t fix = e->sky.quality != 0;
+
+    memset(p, 0, sizeof(p));
+    putLe32(p, e->timeMs);
+    putLe16(p + 6, fix ? (uint16_t)(e->sky.pdop * 100 + 0.5) : 9999);
+    putLe16(p + 10, fix ? (uint16_t)(e->sky.vdop * 100 + 0.5) : 9999);
+    putLe16(p + 12, fix ? (uint16_t)(e->sky.hdop * 100 + 0.5) : 9999);
+
+    return ubxBuild(UBX_NAV, UBX_NAV_DOP, p, sizeof(p), out);
+}
+
+/* Appends to the transmit queue, at once if it is idle at atUs. Returns 0 if it does not fit. */
+static uint8_t queue(SimGnssModule * m, const uint8_t * data, uint16_t length, double atUs) {
+
+    uint16_t i;
+
+    if (m->txCount + length > SIM_GNSS_TX_BUFFER)
+        return 0;
+    if (m->txCount == 0)
+        m->headDoneUs = atUs + byteUs(m->baud);
+    for (i = 0; i < length; ++i)
+        m->tx[(m->txHead + m->txCount++) % SIM_GNSS_TX_BUFFER] = data[i];
+
+    return 1;
+}
+
+static void queueEpoch(SimGnssModule * m) {
+
+    SimNmeaEpoch * e = &m->epoch;
+    uint8_t out[EPOCH_MAX];
+    uint16_t n = 0;
+    uint8_t i;
+    double dueUs = m->epochs * 1e6 + SIM_GNSS_DELAY_US;
+
+    simSkyStep(&m->sky, &e->sky);
+    e->timeMs = (m->startTimeMs + m->epochs * 1000) % DAY_MS;
+    e->lonE7 += 1450;                       // about 11 m east
+    ++m->epochs;
+
+    if (m->outProto & UBX_PROTO_NMEA) {
+        if (m->nmeaOn & SIM_GNSS_RMC)
+            n += simNmeaRMC(e, "GN", (char *)out + n);
+        if (m->nmeaOn & SIM_GNSS_VTG)
+            n += simNmeaVTG(e, "GN", (char *)out + n);
+        if (m->nmeaOn & SIM_GNSS_GGA)
+            n += simNmeaGGA(e, "GN", (char *)out + n);
+        if (m->nmeaOn & SIM_GNSS_GSA)
+            n += simNmeaGSA(e, "GN", (char *)out + n);
+        for (i = 0; (m->nmeaOn & SIM_GNSS_GSV) && i < SIM_NMEA_GSV_COUNT; ++i)
+            n += simNmeaGSV(e, i, (char *)out + n);
+        if (m->nmeaOn & SIM_GNSS_GLL)
+            n += simNmeaGLL(e, "GN", (char *)out + n);
+    }
+    if (m->outProto & UBX_PROTO_UBX) {
+        if (m->ubxOn & SIM_GNSS_NAV_DOP)
+            n += navDop(e, out + n);
+        if (m->ubxOn & SIM_GNSS_NAV_PVT)
+            n += navPvt(e, out + n);
+    }
+
+    if (n > 0 && !queue(m, out, n, dueUs))
+        ++m->dropped;
+}
+
+uint16_t simGnssRead(SimGnssModule * m, uint32_t hostBaud, uint8_t * buf, uint16_t max, uint32_t us) {
+
+    uint64_t end = m->nowUs + us;
+    uint16_t n = 0;
+    uint8_t byte;
+
+    while (n < max) {
+        /* Epochs due before the next byte is through, or before the read ends */
+        while (m->epochs * 1e6 + SIM_GNSS_DELAY_US <= (m->txCount ? m->headDoneUs : (double)end))
+            queueEpoch(m);
+
+        if (m->txCount == 0 || m->headDoneUs > end) {
+            m->nowUs = end;
+            return n;
+        }
+
+        byte = m->tx[m->txHead];
+        m->txHead = (uint16_t)((m->txHead + 1) % SIM_GNSS_TX_BUFFER);
+        --m->txCount;
+        /* What arrived while the host was writing is delivered from its driver's buffer */
+        if (m->headDoneUs > m->nowUs)
+            m->nowUs = (uint64_t)m->headDoneUs;
+        m->headDoneUs += byteUs(m->baud);
+
+        /* At the wrong rate a byte is framing garbage, never a '$' or a UBX sync */
+        buf[n++] = hostBaud == m->baud ? byte : (uint8_t)(byte * 37 + 11) | 0x80;
+    }
+
+    return n;
+}
+
+/***** Commands *****/
+
+static void setBaud(SimGnssModule * m, uint32_t baud) {
+
+    if (baud == 0)
+        return;
+    m->baud = baud;
+    m->txCount = 0;
+}
+
+static void setNmea(SimGnssModule * m, uint8_t id, uint8_t rate) {
+
+    if (id >= sizeof(nmeaIds) / sizeof(nmeaIds[0]))
+        return;
+    if (rate)
+        m->nmeaOn |= (uint8_t)(1 << id);
+    else
+        m->nmeaOn &= (uint8_t)~(1 << id);
+}
+
+/* $PUBX,40,id,ddc,uart1,uart2,usb,spi,reserved and $PUBX,41,port,inProto,outProto,baud,autobauding */
+static void pubx(SimGnssModule * m, char * sentence) {
+
+    char * f[10];
+    uint8_t n = 0, i;
+    char * p = sentence;
+
+    while (n < sizeof(f) / sizeof(f[0]) && (p = strchr(p, ',')) != NULL) {
+        *p++ = '\0';
+        f[n++] = p;
+    }
+
+    if (n >= 5 && strcmp(f[0], "40") == 0) {
+        for (i = 0; i < sizeof(nmeaIds) / sizeof(nmeaIds[0]); ++i) {
+            if (strcmp(f[1], nmeaIds[i]) == 0)
+                setNmea(m, i, (uint8_t)atoi(f[3]));
+        }
+        ++m->commands;
+    }
+    else if (n >= 6 && strcmp(f[0], "41") == 0 && atoi(f[1]) == 1) {
+        m->outProto = (uint16_t)strtol(f[3], NULL, 16);
+        ++m->commands;
+        setBaud(m, (uint32_t)atol(f[4]));
+    }
+}
+
+static void nmeaByte(SimGnssModule * m, uint8_t byte) {
+
+    uint8_t checksum = 0;
+    uint8_t i;
+    char * star;
+
+    if (byte == '$')
+        m->lineLength = 0;
+    if (byte != '\n') {
+        if (m->lineLength < sizeof(m->line) - 1)
+            m->line[m->lineLength++] = (char)byte;
+        return;
+    }
+
+    m->line[m->lineLength] = '\0';
+    m->lineLength = 0;
+    star = strchr(m->line, '*');
+    if (m->line[0] != '$' || star == NULL)
+        return;
+    for (i = 1; m->line + i < star; ++i)
+        checksum ^= (uint8_t)m->line[i];
+    if (strtol(star + 1, NULL, 16) != checksum)
+        return;
+
+    *star = '\0';
+    if (strncmp(m->line, "$PUBX,", 6) == 0)
+        pubx(m, m->line + 5);
+}
+
+static void ubxFrame(SimGnssModule * m, const UbxFrame * frame) {
+
+    uint8_t ack[2 + UBX_OVERHEAD];
+    uint8_t id[2];
+    uint32_t baud = 0;
+
+    if (frame->msgClass != UBX_CFG)
+        return;
+
+    if (frame->id == UBX_CFG_MSG && frame->length == UBX_CFG_MSG_LENGTH) {
+        if (frame->payload[0] == UBX_NMEA)
+            setNmea(m, frame->payload[1], frame->payload[2]);
+        else if (frame->payload[0] == UBX_NAV && frame->payload[1] == UBX_NAV_DOP)
+            m->ubxOn = (uint8_t)(frame->payload[2] ? m->ubxOn | SIM_GNSS_NAV_DOP : m->ubxOn & ~SIM_GNSS_NAV_DOP);
+        else if (frame->payload[0] == UBX_NAV && frame->payload[1] == UBX_NAV_PVT)
+            m->ubxOn = (uint8_t)(frame->payload[2] ? m->ubxOn | SIM_GNSS_NAV_PVT : m->ubxOn & ~SIM_GNSS_NAV_PVT);
+    }
+    else if (frame->id == UBX_CFG_PRT && frame->length == UBX_CFG_PRT_LENGTH && frame->payload[0] == 1) {
+        baud = getLe32(frame->payload + 8);
+        m->outProto = (uint16_t)(frame->payload[14] | (frame->payload[15] << 8));
+    }
+    else
+        return;
+
+    ++m->commands;
+    id[0] = frame->msgClass;
+    id[1] = frame->id;
+    queue(m, ack, ubxBuild(UBX_ACK, UBX_ACK_ACK, id, sizeof(id), ack), (double)m->nowUs);
+    setBaud(m, baud);
+}
+
+void simGnssWrite(SimGnssModule * m, uint32_t hostBaud, const uint8_t * data, uint16_t length) {
+
+    UbxFrame frame;
+    uint16_t i;
+
+    /* Epochs due by now go out with the configuration they were due under */
+    while (m->epochs * 1e6 + SIM_GNSS_DELAY_US <= (double)m->nowUs)
+        queueEpoch(m);
+
+    m->nowUs += (uint64_t)(length * byteUs(hostBaud));
+    if (hostBaud != m->baud || !m->acceptsConfig)
+        return;
+
+    for (i = 0; i < length; ++i) {
+        nmeaByte(m, data[i]);
+        if (ubxFramerPush(&m->framer, data[i], &frame))
+            ubxFrame(m, &frame);
+    }
+}
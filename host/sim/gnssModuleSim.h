@@ -0,0 +1,89 @@
+//
+//  gnssModuleSim.h
+//  Stand-in for a u-blox GNSS module on the other end of a UART, for the host tests
+//
+//  Once a second, SIM_GNSS_DELAY_US after the top of the second, the module queues the
+//  output of an epoch (nmeaSim.h sky and a straight drive): the NMEA sentences enabled, in
+//  u-blox order RMC, VTG, GGA, GSA, GSV, GLL, and the UBX NAV-DOP and NAV-PVT enabled. It
+//  sends them at its own baud rate; an epoch that does not fit in the transmit buffer is
+//  dropped. Read at another baud rate, every byte arrives as framing garbage.
+//
+//  Bytes written to it at its rate are taken as commands: PUBX,40 and PUBX,41, and UBX
+//  CFG-MSG and CFG-PRT, which are answered with an ACK-ACK. A new baud rate takes effect
+//  at once and what was still queued is lost. A module with acceptsConfig 0 ignores them,
+//  as a receiver of another make would.
+//
+//  Time is virtual, in us: it moves on as the host reads and writes.
+//
+
+#ifndef gnssModuleSim_h
+#define gnssModuleSim_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "nmeaSim.h"
+#include "ubxProtocol.h"
+
+#define SIM_GNSS_DELAY_US       50000   // from the top of the second to the first byte
+#define SIM_GNSS_TX_BUFFER      2048
+
+// Output of an epoch, in nmeaOn
+#define SIM_GNSS_GGA            0x01
+#define SIM_GNSS_GLL            0x02
+#define SIM_GNSS_GSA            0x04
+#define SIM_GNSS_GSV            0x08
+#define SIM_GNSS_RMC            0x10
+#define SIM_GNSS_VTG            0x20
+#define SIM_GNSS_NMEA_DEFAULT   0x3F
+
+// In ubxOn
+#define SIM_GNSS_NAV_DOP        0x01
+#define SIM_GNSS_NAV_PVT        0x02
+
+typedef struct {
+    uint32_t baud;
+    uint8_t  acceptsConfig;
+    uint8_t  nmeaOn;
+    uint8_t  ubxOn;
+    uint16_t outProto;          // UBX_PROTO_UBX | UBX_PROTO_NMEA
+    /* Time */
+    uint64_t nowUs;
+    uint32_t startTimeMs;       // UTC time of day at nowUs 0
+    uint32_t epochs;            // queued so far, the next one is due at epochs s + delay
+    /* Transmit queue; the head byte is on the line until headDoneUs */
+    uint8_t  tx[SIM_GNSS_TX_BUFFER];
+    uint16_t txHead, txCount;
+    double   headDoneUs;
+    uint32_t dropped;           // epochs that did not fit
+    /* Commands */
+    char      line[SIM_NMEA_MAX_LENGTH];
+    uint8_t   lineLength;
+    UbxFramer framer;
+    uint8_t   framerBuf[4 + UBX_CFG_PRT_LENGTH];
+    uint32_t  commands;         // taken
+    /* Epoch content */
+    SimSky       sky;
+    SimNmeaEpoch epoch;
+} SimGnssModule;
+
+/// Factory state at baud: default NMEA set, no UBX. seed must not be 0.
+void simGnssInit(SimGnssModule * m, uint32_t baud, uint32_t seed);
+
+/// What the host reads at hostBaud within us, up to max bytes; returns once max bytes have
+/// arrived or us has passed, with the number read.
+uint16_t simGnssRead(SimGnssModule * m, uint32_t hostBaud, uint8_t * buf, uint16_t max, uint32_t us);
+
+/// Host sending at hostBaud; takes the time the bytes need on the line.
+void simGnssWrite(SimGnssModule * m, uint32_t hostBaud, const uint8_t * data, uint16_t length);
+
+/// Virtual time of the top of the second of the epoch at timeMs (UTC time of day), in us.
+uint64_t simGnssEpochUs(const SimGnssModule * m, uint32_t timeMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* gnssModuleSim_h */
@@ -0,0 +1,263 @@
+//
+//  nmeaSim.c
+//  Simulated NMEA output for the host benchmarks and tests
+//
+
+#include "nmeaSim.h"
+#include "channelSim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double uniform(uint32_t * rng) {
+
+    return (simRandom(rng) + 0.5) / 4294967296.0;
+}
+
+static double between(uint32_t * rng, double lo, double hi) {
+
+    return lo + (hi - lo) * uniform(rng);
+}
+
+/* Random walk of a value, kept within [lo, hi] */
+static double wander(uint32_t * rng, double value, double step, double lo, double hi) {
+
+    value += between(rng, -step, step);
+    if (value < lo)
+        value = lo;
+    if (value > hi)
+        value = hi;
+    return value;
+}
+
+/***** Sky *****/
+
+static void enter(SimSky * sky, SimSkyKind kind) {
+
+    SimSkyState * s = &sky->state;
+
+    s->kind = kind;
+    switch (kind) {
+        case SIM_SKY_OPEN:
+            sky->left = 120 + simRandomBelow(&sky->rng, 1080);
+            s->satellites = 11;
+            s->hdop = 0.9;
+            break;
+        case SIM_SKY_URBAN:
+            sky->left = 60 + simRandomBelow(&sky->rng, 540);
+            s->satellites = 7;
+            s->hdop = 2.0;
+            break;
+        case SIM_SKY_INDOOR:
+            sky->left = 30 + simRandomBelow(&sky->rng, 870);
+            s->satellites = 4;
+            s->hdop = 6.0;
+            break;
+    }
+}
+
+void simSkyInit(SimSky * sky, uint32_t seed) {
+
+    memset(sky, 0, sizeof(*sky));
+    sky->rng = seed;
+    enter(sky, SIM_SKY_OPEN);
+}
+
+void simSkyStep(SimSky * sky, SimSkyState * state) {
+
+    SimSkyState * s = &sky->state;
+    uint32_t r;
+
+    if (sky->left == 0) {
+        r = simRandomBelow(&sky->rng, 10);
+        switch (s->kind) {
+            case SIM_SKY_OPEN:
+                enter(sky, r < 7 ? SIM_SKY_URBAN : SIM_SKY_INDOOR);
+                break;
+            case SIM_SKY_URBAN:
+                enter(sky, r < 6 ? SIM_SKY_OPEN : SIM_SKY_INDOOR);
+                break;
+            case SIM_SKY_INDOOR:
+                enter(sky, r < 4 ? SIM_SKY_OPEN : SIM_SKY_URBAN);
+                break;
+        }
+    }
+    --sky->left;
+
+    switch (s->kind) {
+        case SIM_SKY_OPEN:
+            s->satellites = (uint8_t)wander(&sky->rng, s->satellites, 1.5, 9, 14);
+            s->hdop = wander(&sky->rng, s->hdop, 0.05, 0.6, 1.2);
+            s->quality = simRandomBelow(&sky->rng, 10) < 2 ? 2 : 1;
+            s->errorScale = 1.0;
+            break;
+        case SIM_SKY_URBAN:
+            s->satellites = (uint8_t)wander(&sky->rng, s->satellites, 1.5, 4, 9);
+            s->hdop = wander(&sky->rng, s->hdop, 0.3, 1.2, 5.0);
+            s->quality = 1;
+            s->errorScale = 1.5 * s->hdop;
+            break;
+        case SIM_SKY_INDOOR:
+            s->satellites = (uint8_t)wander(&sky->rng, s->satellites, 1.5, 0, 5);
+            s->hdop = wander(&sky->rng, s->hdop, 1.0, 3.0, 15.0);
+            s->quality = s->satellites < 3 ? 0 : simRandomBelow(&sky->rng, 4) ? 1 : 6;
+            s->errorScale = 2.0 * s->hdop;
+            break;
+    }
+
+    s->fixMode = s->quality == 0 ? 1 : s->satellites >= 4 && s->kind != SIM_SKY_INDOOR ? 3 : 2;
+    s->pdop = s->hdop * 1.6;
+    s->vdop = s->hdop * 1.3;
+
+    *state = *s;
+}
+
+/***** Sentences *****/
+
+/* "$" talker body "*hh\r\n" */
+static uint8_t finish(char * out, const char * talker, const char * body) {
+
+    uint8_t checksum = 0;
+    int n = sprintf(out, "$%s%s", talker, body);
+    int i;
+
+    for (i = 1; i < n; ++i)
+        checksum ^= (uint8_t)out[i];
+
+    return (uint8_t)(n + sprintf(out + n, "*%02X\r\n", checksum));
+}
+
+static int formatTime(char * out, uint32_t timeMs) {
+
+    uint32_t s = timeMs / 1000;
+
+    return sprintf(out, "%02u%02u%02u.%02u", s / 3600, s / 60 % 60, s % 60, timeMs % 1000 / 10);
+}
+
+/* ddmm.mmmmm,N or dddmm.mmmmm,E */
+static int formatDegrees(char * out, int32_t e7, uint8_t degDigits, char pos, char neg) {
+
+    uint32_t a = e7 < 0 ? (uint32_t)-e7 : (uint32_t)e7;
+    uint32_t deg = a / 10000000;
+    uint32_t minE5 = (uint32_t)(((uint64_t)(a % 10000000) * 60 + 50) / 100);
+
+    if (minE5 >= 6000000) {
+        ++deg;
+        minE5 -= 6000000;
+    }
+
+    return sprintf(out, "%0*u%02u.%05u,%c", degDigits, deg, minE5 / 100000, minE5 % 100000,
+                   e7 < 0 ? neg : pos);
+}
+
+uint8_t simNmeaGGA(const SimNmeaEpoch * e, const char * talker, char * out) {
+
+    char body[SIM_NMEA_MAX_LENGTH];
+    int n = sprintf(body, "GGA,");
+
+    n += formatTime(body + n, e->timeMs);
+    if (e->sky.quality == 0) {
+        sprintf(body + n, ",,,,,0,%02u,99.99,,,,,,", e->sky.satellites);
+        return finish(out, talker, body);
+    }
+
+    body[n++] = ',';
+    n += formatDegrees(body + n, e->latE7, 2, 'N', 'S');
+    body[n++] = ',';
+    n += formatDegrees(body + n, e->lonE7, 3, 'E', 'W');
+    sprintf(body + n, ",%u,%02u,%.2f,%.1f,M,-32.9,M,,", e->sky.quality, e->sky.satellites, e->sky.hdop,
+            e->altM);
+
+    return finish(out, talker, body);
+}
+
+uint8_t simNmeaRMC(const SimNmeaEpoch * e, const char * talker, char * out) {
+
+    char body[SIM_NMEA_MAX_LENGTH];
+    int n = sprintf(body, "RMC,");
+
+    n += formatTime(body + n, e->timeMs);
+    if (e->sky.quality == 0) {
+        sprintf(body + n, ",V,,,,,,,%02u%02u%02u,,,N", e->day, e->month, e->year % 100);
+        return finish(out, talker, body);
+    }
+
+    n += sprintf(body + n, ",A,");
+    n += formatDegrees(body + n, e->latE7, 2, 'N', 'S');
+    body[n++] = ',';
+    n += formatDegrees(body + n, e->lonE7, 3, 'E', 'W');
+    sprintf(body + n, ",%.3f,%.2f,%02u%02u%02u,,,%c", e->speedKn, e->courseDeg, e->day, e->month,
+            e->year % 100, e->sky.quality == 6 ? 'E' : e->sky.quality == 2 ? 'D' : 'A');
+
+    return finish(out, talker, body);
+}
+
+uint8_t simNmeaGSA(const SimNmeaEpoch * e, const char * talker, char * out) {
+
+    char body[SIM_NMEA_MAX_LENGTH];
+    int n = sprintf(body, "GSA,A,%u", e->sky.fixMode);
+    uint8_t i;
+
+    /* GPS numbers 2, 5, 8, ... for the satellites in use */
+    for (i = 0; i < 12; ++i)
+        n += i < e->sky.satellites ? sprintf(body + n, ",%02u", 2 + 3 * i) : sprintf(body + n, ",");
+
+    if (e->sky.quality == 0)
+        sprintf(body + n, ",99.99,99.99,99.99,1");
+    else
+        sprintf(body + n, ",%.2f,%.2f,%.2f,1", e->sky.pdop, e->sky.hdop, e->sky.vdop);
+
+    return finish(out, talker, body);
+}
+
+uint8_t simNmeaVTG(const SimNmeaEpoch * e, const char * talker, char * out) {
+
+    char body[SIM_NMEA_MAX_LENGTH];
+
+    if (e->sky.quality == 0)
+        sprintf(body, "VTG,,T,,M,,N,,K,N");
+    else
+        sprintf(body, "VTG,%.2f,T,,M,%.3f,N,%.3f,K,A", e->courseDeg, e->speedKn, e->speedKn * 1.852);
+
+    return finish(out, talker, body);
+}
+
+uint8_t simNmeaGLL(const SimNmeaEpoch * e, const char * talker, char * out) {
+
+    char body[SIM_NMEA_MAX_LENGTH];
+    int n;
+
+    if (e->sky.quality == 0) {
+        n = sprintf(body, "GLL,,,,,");
+        n += formatTime(body + n, e->timeMs);
+        sprintf(body + n, ",V,N");
+        return finish(out, talker, body);
+    }
+
+    n = sprintf(body, "GLL,");
+    n += formatDegrees(body + n, e->latE7, 2, 'N', 'S');
+    body[n++] = ',';
+    n += formatDegrees(body + n, e->lonE7, 3, 'E', 'W');
+    body[n++] = ',';
+    n += formatTime(body + n, e->timeMs);
+    sprintf(body + n, ",A,%c", e->sky.quality == 6 ? 'E' : e->sky.quality == 2 ? 'D' : 'A');
+
+    return finish(out, talker, body);
+}
+
+uint8_t simNmeaGSV(const SimNmeaEpoch * e, uint8_t index, char * out) {
+
+    char body[SIM_NMEA_MAX_LENGTH];
+    int n = sprintf(body, "GSV,%u,%u,%02u", SIM_NMEA_GSV_COUNT, index + 1, SIM_NMEA_IN_VIEW);
+    uint8_t i;
+
+    /* The satellites in use of GSA first, with a signal while there is a fix */
+    for (i = (uint8_t)(4 * index); i < 4 * index + 4 && i < SIM_NMEA_IN_VIEW; ++i) {
+        n += sprintf(body + n, ",%02u,%02u,%03u,", 2 + 3 * i, 10 + 7 * i % 80, 40 * i % 360);
+        if (i < e->sky.satellites)
+            n += sprintf(body + n, "%02u", 30 + 11 * i % 17);
+    }
+    sprintf(body + n, ",1");
+
+    return finish(out, "GP", body);
+}
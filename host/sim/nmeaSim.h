@@ -0,0 +1,80 @@
+//
+//  nmeaSim.h
+//  Simulated NMEA output for the host benchmarks and tests: a sky model that moves between
+//  open sky, urban canyon and indoors, and GGA, RMC, GSA, VTG, GSV and GLL sentences as a
+//  multi-constellation receiver formats them
+//
+//  Open sky: 9 to 14 satellites, HDOP 0.6 to 1.2. Urban: 4 to 9 satellites, HDOP 1.2 to 5,
+//  and position noise growing with the HDOP. Indoors: mostly no fix, else 3 to 5
+//  satellites, a 2D fix or dead reckoning and HDOP up to 15. Each lasts from half a minute
+//  to 20 minutes.
+//
+
+#ifndef nmeaSim_h
+#define nmeaSim_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SIM_NMEA_MAX_LENGTH     96      // a sentence with CR LF and terminator
+#define SIM_NMEA_IN_VIEW        8       // GPS satellites in GSV
+#define SIM_NMEA_GSV_COUNT      ((SIM_NMEA_IN_VIEW + 3) / 4)
+
+typedef enum {
+    SIM_SKY_OPEN,
+    SIM_SKY_URBAN,
+    SIM_SKY_INDOOR
+} SimSkyKind;
+
+typedef struct {
+    SimSkyKind kind;
+    uint8_t  quality;       // GGA fix quality
+    uint8_t  satellites;
+    uint8_t  fixMode;       // GSA
+    double   hdop, pdop, vdop;
+    double   errorScale;    // position noise relative to open sky
+} SimSkyState;
+
+typedef struct {
+    uint32_t    rng;
+    uint32_t    left;       // s until the sky changes
+    SimSkyState state;
+} SimSky;
+
+typedef struct {
+    uint32_t    timeMs;     // UTC time of day
+    uint8_t     day, month;
+    uint16_t    year;
+    int32_t     latE7, lonE7;
+    double      altM;
+    double      speedKn;
+    double      courseDeg;
+    SimSkyState sky;
+} SimNmeaEpoch;
+
+/// seed must not be 0. Starts under open sky.
+void simSkyInit(SimSky * sky, uint32_t seed);
+
+/// Moves on by one second.
+void simSkyStep(SimSky * sky, SimSkyState * state);
+
+/// The sentences of an epoch with talker (e.g. "GN"), ending in CR LF, in out (at least
+/// SIM_NMEA_MAX_LENGTH bytes). Return the length. Without a fix the position fields are
+/// empty, as a receiver leaves them.
+uint8_t simNmeaGGA(const SimNmeaEpoch * e, const char * talker, char * out);
+uint8_t simNmeaRMC(const SimNmeaEpoch * e, const char * talker, char * out);
+uint8_t simNmeaGSA(const SimNmeaEpoch * e, const char * talker, char * out);
+uint8_t simNmeaVTG(const SimNmeaEpoch * e, const char * talker, char * out);
+uint8_t simNmeaGLL(const SimNmeaEpoch * e, const char * talker, char * out);
+
+/// GSV sentence index (0 to SIM_NMEA_GSV_COUNT - 1) of the GPS satellites in view.
+uint8_t simNmeaGSV(const SimNmeaEpoch * e, uint8_t index, char * out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* nmeaSim_h */
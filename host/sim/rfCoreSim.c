@@ -0,0 +1,116 @@
+//
+//  rfCoreSim.c
+//  Model of the RF core filling partial read RX entries
+//
+
+#include "rfCoreSim.h"
+#include <string.h>
+
+static uint16_t room(const RxStreamEntry * e) {
+
+    return (uint16_t)(e->length - 4);
+}
+
+/* Pending to active, or 0 if the reader still holds it */
+static uint8_t take(RxStreamEntry * e) {
+
+    if (e->status != RX_STREAM_PENDING)
+        return 0;
+
+    e->status = RX_STREAM_ACTIVE;
+    e->pktStatus = 0;
+    e->nextIndex = 0;
+    return 1;
+}
+
+static void openElement(SimRfCore * c, uint8_t continued) {
+
+    RxStreamEntry * e = c->entry;
+
+    if (continued)
+        e->pktStatus |= RX_STREAM_FIRST_CONT;
+    e->pktStatus = (uint16_t)((e->pktStatus & ~RX_STREAM_NUM_ELEMENTS) |
+                              ((e->pktStatus & RX_STREAM_NUM_ELEMENTS) + 1) | RX_STREAM_ENTRY_OPEN);
+    c->element = e->nextIndex;
+    e->nextIndex += RX_STREAM_LEN_SZ;
+}
+
+static void closeElement(SimRfCore * c, uint8_t continues) {
+
+    RxStreamEntry * e = c->entry;
+    uint16_t length = (uint16_t)(e->nextIndex - c->element - RX_STREAM_LEN_SZ);
+
+    e->data[c->element] = (uint8_t)length;
+    e->data[c->element + 1] = (uint8_t)(length >> 8);
+    e->pktStatus &= ~RX_STREAM_ENTRY_OPEN;
+    if (continues)
+        e->pktStatus |= RX_STREAM_LAST_CONT;
+}
+
+static void finish(SimRfCore * c) {
+
+    c->entry->status = RX_STREAM_FINISHED;
+    c->entry = (RxStreamEntry *)c->entry->pNextEntry;
+    ++c->entries;
+}
+
+static uint8_t stop(SimRfCore * c) {
+
+    c->rxFull = 1;
+    if (c->inPacket)
+        ++c->cut;
+    c->inPacket = 0;
+    return 0;
+}
+
+void simRfCoreInit(SimRfCore * c, uint8_t * firstEntry) {
+
+    memset(c, 0, sizeof(*c));
+    c->entry = (RxStreamEntry *)firstEntry;
+}
+
+uint8_t simRfCoreByte(SimRfCore * c, uint8_t byte, uint8_t first) {
+
+    if (c->rxFull)
+        return 0;
+
+    if (first) {
+        simRfCoreEnd(c);
+        c->inPacket = 1;
+        if (c->entry->status != RX_STREAM_ACTIVE && !take(c->entry))
+            return stop(c);
+        openElement(c, 0);
+    }
+    else if (!c->inPacket)
+        return 1;
+    else if (c->entry->nextIndex == room(c->entry)) {
+        closeElement(c, 1);
+        finish(c);
+        if (!take(c->entry))
+            return stop(c);
+        openElement(c, 1);
+    }
+
+    c->entry->data[c->entry->nextIndex++] = byte;
+    return 1;
+}
+
+void simRfCoreEnd(SimRfCore * c) {
+
+    if (!c->inPacket)
+        return;
+
+    closeElement(c, 0);
+    c->inPacket = 0;
+    ++c->packets;
+
+    if (room(c->entry) - c->entry->nextIndex < RX_STREAM_LEN_SZ + 1)
+        finish(c);
+}
+
+void simRfCoreRestart(SimRfCore * c, uint8_t * entry) {
+
+    c->entry = (RxStreamEntry *)entry;
+    c->inPacket = 0;
+    c->rxFull = 0;
+}
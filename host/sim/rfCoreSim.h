@@ -0,0 +1,51 @@
+//
+//  rfCoreSim.h
+//  Model of the RF core writing received packets into a queue of partial read entries
+//  (rxStream.h), for the host tests
+//
+//  A packet is written byte by byte as it comes off the air: into the entry the core is
+//  on, which it takes over (pending to active) at the first byte it writes there. Each
+//  packet opens an element with its length indicator; an element is closed, its length
+//  written, when the packet ends or the entry is full. A full entry is finished and the
+//  core moves on to the next one, which has to be pending: if the reader still holds it,
+//  reception stops with PROP_ERROR_RXFULL and the packet is cut. An entry with no room
+//  left for another element is finished at the end of a packet.
+//
+
+#ifndef rfCoreSim_h
+#define rfCoreSim_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "rxStream.h"
+
+typedef struct {
+    RxStreamEntry * entry;      // the queue's current entry
+    uint16_t  element;          // in entry->data, of the open element's length indicator
+    uint8_t   inPacket;
+    uint8_t   rxFull;           // stopped, until simRfCoreRestart()
+    /* Statistics */
+    uint32_t  packets;          // written whole
+    uint32_t  cut;              // stopped by PROP_ERROR_RXFULL
+    uint32_t  entries;          // finished
+} SimRfCore;
+
+void simRfCoreInit(SimRfCore * c, uint8_t * firstEntry);
+
+/// The next byte of a packet, first marks a new one. Returns 0 once reception has stopped.
+uint8_t simRfCoreByte(SimRfCore * c, uint8_t byte, uint8_t first);
+
+/// The packet is complete.
+void simRfCoreEnd(SimRfCore * c);
+
+/// A new RX command after PROP_ERROR_RXFULL, at entry (from rxStreamFlush()).
+void simRfCoreRestart(SimRfCore * c, uint8_t * entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* rfCoreSim_h */
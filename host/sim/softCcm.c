@@ -0,0 +1,235 @@
+//
+//  softCcm.c
+//  Software AES-128 CCM, the host stand-in for the CC1310 crypto core
+//
+
+#include "softCcm.h"
+#include <string.h>
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/***** AES-128 *****/
+
+static uint8_t xtime(uint8_t x) {
+
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+uint8_t softCcmSetKey(void * ctx, const uint8_t * key) {
+
+    SoftCcm * ccm = ctx;
+    uint8_t * w = ccm->roundKey;
+    uint8_t rcon = 0x01;
+    uint8_t i;
+
+    memcpy(w, key, 16);
+
+    for (i = 16; i < 176; i += 4) {
+
+        uint8_t t0 = w[i - 4], t1 = w[i - 3], t2 = w[i - 2], t3 = w[i - 1];
+
+        if (i % 16 == 0) {
+            uint8_t r = t0;
+            t0 = (uint8_t)(sbox[t1] ^ rcon);
+            t1 = sbox[t2];
+            t2 = sbox[t3];
+            t3 = sbox[r];
+            rcon = xtime(rcon);
+        }
+
+        w[i]     = w[i - 16] ^ t0;
+        w[i + 1] = w[i - 15] ^ t1;
+        w[i + 2] = w[i - 14] ^ t2;
+        w[i + 3] = w[i - 13] ^ t3;
+    }
+
+    return 0;
+}
+
+void softAesEncryptBlock(const SoftCcm * ccm, const uint8_t * in, uint8_t * out) {
+
+    uint8_t s[16];
+    uint8_t round, i;
+
+    for (i = 0; i < 16; ++i)
+        s[i] = in[i] ^ ccm->roundKey[i];
+
+    for (round = 1; round <= 10; ++round) {
+
+        uint8_t t[16];
+
+        /* SubBytes and ShiftRows, the state is column major */
+        for (i = 0; i < 16; ++i)
+            t[i] = sbox[s[(i + 4 * (i % 4)) % 16]];
+
+        /* MixColumns, except in the last round */
+        for (i = 0; i < 16; i += 4) {
+
+            if (round == 10) {
+                memcpy(s + i, t + i, 4);
+                continue;
+            }
+
+            uint8_t a0 = t[i], a1 = t[i + 1], a2 = t[i + 2], a3 = t[i + 3];
+            uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+
+            s[i]     = a0 ^ all ^ xtime(a0 ^ a1);
+            s[i + 1] = a1 ^ all ^ xtime(a1 ^ a2);
+            s[i + 2] = a2 ^ all ^ xtime(a2 ^ a3);
+            s[i + 3] = a3 ^ all ^ xtime(a3 ^ a0);
+        }
+
+        for (i = 0; i < 16; ++i)
+            s[i] ^= ccm->roundKey[16 * round + i];
+    }
+
+    memcpy(out, s, 16);
+}
+
+/***** CCM *****/
+
+/* CBC-MAC over B0, the associated data and the plain payload */
+static void ccmMac(const SoftCcm * ccm, const uint8_t * nonce, uint8_t nonceLength,
+                   const uint8_t * aad, uint8_t aadLength, const uint8_t * data, uint8_t length,
+                   uint8_t micLength, uint8_t * tag) {
+
+    uint8_t block[16];
+    uint16_t i;
+    uint8_t n;
+
+    memset(block, 0, sizeof(block));
+    block[0] = (uint8_t)((aadLength ? 0x40 : 0) | (((micLength - 2) / 2) << 3) | (14 - nonceLength));
+    memcpy(block + 1, nonce, nonceLength);
+    block[15] = length;
+    softAesEncryptBlock(ccm, block, tag);
+
+    if (aadLength) {
+
+        /* Length prefix, then the data, zero padded */
+        tag[1] ^= aadLength;
+        n = 2;
+
+        for (i = 0; i < aadLength; ++i) {
+            tag[n++] ^= aad[i];
+            if (n == 16) {
+                softAesEncryptBlock(ccm, tag, tag);
+                n = 0;
+            }
+        }
+
+        if (n != 0)
+            softAesEncryptBlock(ccm, tag, tag);
+    }
+
+    for (i = 0; i < length; i += 16) {
+
+        uint8_t chunk = length - i < 16 ? length - i : 16;
+
+        for (n = 0; n < chunk; ++n)
+            tag[n] ^= data[i + n];
+        softAesEncryptBlock(ccm, tag, tag);
+    }
+}
+
+/* Counter block index encrypted: block 0 masks the tag, blocks 1.. the payload */
+static void ccmStream(const SoftCcm * ccm, const uint8_t * nonce, uint8_t nonceLength, uint8_t index,
+                      uint8_t * out) {
+
+    uint8_t ctr[16];
+
+    memset(ctr, 0, sizeof(ctr));
+    ctr[0] = (uint8_t)(14 - nonceLength);
+    memcpy(ctr + 1, nonce, nonceLength);
+    ctr[15] = index;
+    softAesEncryptBlock(ccm, ctr, out);
+}
+
+static void ccmCtr(const SoftCcm * ccm, const uint8_t * nonce, uint8_t nonceLength,
+                   uint8_t * data, uint8_t length) {
+
+    uint8_t stream[16];
+    uint16_t i;
+    uint8_t n;
+
+    for (i = 0; i < length; i += 16) {
+
+        uint8_t chunk = length - i < 16 ? length - i : 16;
+
+        ccmStream(ccm, nonce, nonceLength, (uint8_t)(i / 16 + 1), stream);
+        for (n = 0; n < chunk; ++n)
+            data[i + n] ^= stream[n];
+    }
+}
+
+static uint8_t badParams(uint8_t nonceLength, uint8_t micLength) {
+
+    return nonceLength < 7 || nonceLength > 13 || micLength < 4 || micLength > 16 || (micLength & 1);
+}
+
+uint8_t softCcmEncrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                       const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                       uint8_t * mic, uint8_t micLength) {
+
+    const SoftCcm * ccm = ctx;
+    uint8_t tag[16];
+    uint8_t s0[16];
+    uint8_t n;
+
+    if (badParams(nonceLength, micLength))
+        return 1;
+
+    ccmMac(ccm, nonce, nonceLength, aad, aadLength, data, length, micLength, tag);
+    ccmStream(ccm, nonce, nonceLength, 0, s0);
+    for (n = 0; n < micLength; ++n)
+        mic[n] = tag[n] ^ s0[n];
+
+    ccmCtr(ccm, nonce, nonceLength, data, length);
+
+    return 0;
+}
+
+uint8_t softCcmDecrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                       const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                       const uint8_t * mic, uint8_t micLength) {
+
+    const SoftCcm * ccm = ctx;
+    uint8_t tag[16];
+    uint8_t s0[16];
+    uint8_t diff = 0;
+    uint8_t n;
+
+    if (badParams(nonceLength, micLength))
+        return 1;
+
+    /* Counter mode is its own inverse; the MAC is over the plain text */
+    ccmCtr(ccm, nonce, nonceLength, data, length);
+    ccmMac(ccm, nonce, nonceLength, aad, aadLength, data, length, micLength, tag);
+    ccmStream(ccm, nonce, nonceLength, 0, s0);
+
+    for (n = 0; n < micLength; ++n)
+        diff |= (uint8_t)(tag[n] ^ s0[n] ^ mic[n]);
+
+    if (diff) {
+        ccmCtr(ccm, nonce, nonceLength, data, length);
+        return 1;
+    }
+
+    return 0;
+}
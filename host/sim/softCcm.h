@@ -0,0 +1,41 @@
+//
+//  softCcm.h
+//  Software AES-128 CCM (RFC 3610 / NIST SP 800-38C), the host stand-in for the CC1310
+//  crypto core behind SecureCipher
+//
+//  Nonces of 7 to 13 bytes and even MIC lengths of 4 to 16 bytes, like the hardware.
+//
+
+#ifndef softCcm_h
+#define softCcm_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t roundKey[176];
+} SoftCcm;
+
+/// Expands the key; ctx is a SoftCcm. Returns 0.
+uint8_t softCcmSetKey(void * ctx, const uint8_t * key);
+
+uint8_t softCcmEncrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                       const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                       uint8_t * mic, uint8_t micLength);
+
+/// Returns 0 if the MIC matches. data is left encrypted otherwise.
+uint8_t softCcmDecrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                       const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                       const uint8_t * mic, uint8_t micLength);
+
+/// One AES-128 block encryption, for the FIPS-197 check.
+void softAesEncryptBlock(const SoftCcm * ccm, const uint8_t * in, uint8_t * out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* softCcm_h */
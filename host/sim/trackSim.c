@@ -0,0 +1,123 @@
+//
+//  trackSim.c
+//  Simulated GPS tracks for the host benchmarks
+//
+
+#include "trackSim.h"
+#include "channelSim.h"
+#include <math.h>
+#include <string.h>
+
+#define M_PER_DEG_LAT   111133.0
+#define M_PER_DEG_LON   111320.0
+#define BIAS_SIGMA_M    2.5
+#define BIAS_TAU_S      60.0
+#define WHITE_SIGMA_M   1.5
+#define SPEED_SIGMA_MS  0.15
+#define JUMP_PPM        10000           // chance per epoch that multipath starts
+#define PI              3.14159265358979
+
+static double uniform(uint32_t * rng) {
+
+    return (simRandom(rng) + 0.5) / 4294967296.0;
+}
+
+static double gaussian(uint32_t * rng) {
+
+    return sqrt(-2.0 * log(uniform(rng))) * cos(2.0 * PI * uniform(rng));
+}
+
+/* Next leg of the trajectory: a stop, a straight or a bend */
+static void newLeg(SimTrack * t) {
+
+    double cruise = t->kind == SIM_TRACK_WALK ? 1.4 : 8.0 + 8.0 * uniform(&t->rng);
+    uint32_t r = simRandomBelow(&t->rng, 10);
+
+    t->turnRate = 0;
+
+    if (t->kind == SIM_TRACK_PARKED || r < 2) {
+        t->speed = 0;
+        t->legLeft = 20 + simRandomBelow(&t->rng, 60);
+    }
+    else if (r < 6) {
+        t->speed = cruise;
+        t->legLeft = 20 + simRandomBelow(&t->rng, 60);
+    }
+    else {
+        /* A quarter turn either way */
+        t->speed = t->kind == SIM_TRACK_WALK ? cruise : cruise / 2;
+        t->legLeft = 6 + simRandomBelow(&t->rng, 10);
+        t->turnRate = (r & 1 ? 1 : -1) * (PI / 2) / t->legLeft;
+    }
+}
+
+void simTrackInit(SimTrack * t, SimTrackKind kind, uint32_t seed) {
+
+    memset(t, 0, sizeof(*t));
+    t->kind = kind;
+    t->rng = seed;
+    t->heading = 2 * PI * uniform(&t->rng);
+}
+
+void simTrackStep(SimTrack * t, SimFix * fix) {
+
+    double decay = exp(-1.0 / BIAS_TAU_S);
+
+    /* Truth moves on */
+    if (t->legLeft == 0)
+        newLeg(t);
+    --t->legLeft;
+    t->heading += t->turnRate;
+    t->east  += t->speed * sin(t->heading);
+    t->north += t->speed * cos(t->heading);
+
+    /* Receiver errors */
+    t->biasEast  = t->biasEast * decay + BIAS_SIGMA_M * sqrt(1 - decay * decay) * gaussian(&t->rng);
+    t->biasNorth = t->biasNorth * decay + BIAS_SIGMA_M * sqrt(1 - decay * decay) * gaussian(&t->rng);
+
+    if (t->jumpLeft == 0 && simRandomBelow(&t->rng, 1000000) < JUMP_PPM) {
+        double size = 30 + 90 * uniform(&t->rng), angle = 2 * PI * uniform(&t->rng);
+        t->jumpEast = size * sin(angle);
+        t->jumpNorth = size * cos(angle);
+        t->jumpLeft = 1 + simRandomBelow(&t->rng, 3);
+    }
+
+    fix->trueEast  = t->east;
+    fix->trueNorth = t->north;
+    fix->measEast  = t->east + t->biasEast + WHITE_SIGMA_M * gaussian(&t->rng);
+    fix->measNorth = t->north + t->biasNorth + WHITE_SIGMA_M * gaussian(&t->rng);
+    fix->jumped    = t->jumpLeft > 0;
+
+    if (fix->jumped) {
+        fix->measEast += t->jumpEast;
+        fix->measNorth += t->jumpNorth;
+        --t->jumpLeft;
+    }
+
+    fix->velEast  = t->speed * sin(t->heading) + SPEED_SIGMA_MS * gaussian(&t->rng);
+    fix->velNorth = t->speed * cos(t->heading) + SPEED_SIGMA_MS * gaussian(&t->rng);
+}
+
+void simTrackToLatLon(double east, double north, int32_t * latE7, int32_t * lonE7) {
+
+    *latE7 = (int32_t)lround((SIM_TRACK_BASE_LAT + north / M_PER_DEG_LAT) * 1e7);
+    *lonE7 = (int32_t)lround((SIM_TRACK_BASE_LON +
+                              east / (M_PER_DEG_LON * cos(SIM_TRACK_BASE_LAT * PI / 180))) * 1e7);
+}
+
+void simTrackFromLatLon(int32_t latE7, int32_t lonE7, double * east, double * north) {
+
+    *north = (latE7 / 1e7 - SIM_TRACK_BASE_LAT) * M_PER_DEG_LAT;
+    *east  = (lonE7 / 1e7 - SIM_TRACK_BASE_LON) * M_PER_DEG_LON * cos(SIM_TRACK_BASE_LAT * PI / 180);
+}
+
+void simTrackSpeedCourse(double velEast, double velNorth, uint16_t * speedCmS, uint16_t * courseCdeg) {
+
+    double course = atan2(velEast, velNorth) * 180 / PI;
+
+    if (course < 0)
+        course += 360;
+
+    *speedCmS   = (uint16_t)lround(hypot(velEast, velNorth) * 100);
+    *courseCdeg = (uint16_t)(lround(course * 100) % 36000);
+}
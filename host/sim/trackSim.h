@@ -0,0 +1,67 @@
+//
+//  trackSim.h
+//  Simulated GPS tracks for the host benchmarks: a ground truth trajectory sampled once per
+//  second and what a receiver reports for it
+//
+//  The trajectory is a sequence of legs: stops, straights and quarter turns, at walking or
+//  driving speed. The receiver adds a slowly wandering bias (first order Gauss-Markov,
+//  tau 60 s) and white noise to the position, multipath jumps of 30 to 120 m that last
+//  1 to 3 epochs, and white noise to the velocity.
+//
+
+#ifndef trackSim_h
+#define trackSim_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SIM_TRACK_BASE_LAT      45.5017     // degrees, where every track starts
+#define SIM_TRACK_BASE_LON      -73.5673
+
+typedef enum {
+    SIM_TRACK_PARKED,
+    SIM_TRACK_WALK,
+    SIM_TRACK_DRIVE
+} SimTrackKind;
+
+typedef struct {
+    double   trueEast, trueNorth;   // m from the start
+    double   measEast, measNorth;   // as reported
+    double   velEast, velNorth;     // m/s, as reported
+    uint8_t  jumped;                // the position is off by a multipath jump
+} SimFix;
+
+typedef struct {
+    SimTrackKind kind;
+    uint32_t rng;
+    double   east, north;           // m
+    double   heading;               // rad, clockwise from north
+    double   speed;                 // m/s
+    double   turnRate;              // rad/s
+    uint32_t legLeft;               // s until the next leg
+    double   biasEast, biasNorth;
+    double   jumpEast, jumpNorth;
+    uint32_t jumpLeft;
+} SimTrack;
+
+/// seed must not be 0.
+void simTrackInit(SimTrack * t, SimTrackKind kind, uint32_t seed);
+
+/// Moves on by one second and reports the fix.
+void simTrackStep(SimTrack * t, SimFix * fix);
+
+/// m east and north of the start to degrees * 1e7, and back.
+void simTrackToLatLon(double east, double north, int32_t * latE7, int32_t * lonE7);
+void simTrackFromLatLon(int32_t latE7, int32_t lonE7, double * east, double * north);
+
+/// Speed over ground in cm/s and course in 0.01 degrees of a velocity in m/s.
+void simTrackSpeedCourse(double velEast, double velNorth, uint16_t * speedCmS, uint16_t * courseCdeg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* trackSim_h */
@@ -0,0 +1,230 @@
+//
+//  adaptiveRateTest.c
+//  Tests of the per slot rates of the TDMA superframe (tdmaMac.c) and of the gateway's
+//  adaptive data rate (adaptiveRate.c)
+//
+//  With every slot at PHY_PROFILE the layout is the one TDMA always had. Faster slots are
+//  grouped after the join slots behind a PHY switch, no two slots overlap, and the rates
+//  reach the tracker in the beacon so both sides place every slot at the same offset.
+//  A strong link steps up one profile at a time, a fading one steps down, and a silent
+//  owner or a new one starts over at PHY_PROFILE.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "adaptiveRate.h"
+#include "check.h"
+#include "packetCodec.h"
+#include "phyProfile.h"
+#include "tdmaMac.h"
+
+/* Every slot, join slots included, inside the superframe and clear of every other one */
+static void checkLayout(const TdmaFrameConfig * cfg) {
+
+    uint8_t total = cfg->numSlots + cfg->numJoinSlots;
+    uint32_t frameUs = tdmaFrameLengthUs(cfg);
+    uint8_t i, j;
+
+    for (i = 0; i < total; ++i) {
+        uint32_t start = tdmaSlotOffsetUs(cfg, i);
+        uint32_t end = start + tdmaSlotMs(cfg, i < cfg->numSlots ? cfg->rate[i] : PHY_PROFILE) * 1000UL;
+        CHECK(start >= cfg->beaconMs * 1000UL && end <= frameUs);
+        for (j = 0; j < total; ++j) {
+            uint32_t other = tdmaSlotOffsetUs(cfg, j);
+            CHECK(i == j || other >= end || other < start);
+        }
+    }
+}
+
+static void testBaseLayout(void) {
+
+    TdmaFrameConfig cfg;
+    uint8_t i;
+
+    tdmaDefaultConfig(&cfg);
+    for (i = 0; i < cfg.numSlots + cfg.numJoinSlots; ++i)
+        CHECK(tdmaSlotOffsetUs(&cfg, i) == (cfg.beaconMs + (uint32_t)i * cfg.slotMs) * 1000);
+    CHECK(tdmaFrameLengthUs(&cfg) ==
+          (cfg.beaconMs + (uint32_t)(cfg.numSlots + cfg.numJoinSlots) * cfg.slotMs) * 1000);
+    CHECK(tdmaRateEndUs(&cfg, PHY_PROFILE) == tdmaFrameLengthUs(&cfg));
+    for (i = PHY_PROFILE + 1; i < PHY_NUM_PROFILES; ++i)
+        CHECK(tdmaRateEndUs(&cfg, i) == 0);
+    checkLayout(&cfg);
+}
+
+static void testSlotMs(void) {
+
+    TdmaFrameConfig cfg;
+    uint8_t rate;
+
+    tdmaDefaultConfig(&cfg);
+    CHECK(tdmaSlotMs(&cfg, PHY_PROFILE) == cfg.slotMs);
+    for (rate = PHY_PROFILE + 1; rate < PHY_NUM_PROFILES; ++rate) {
+        /* Holds the frames slotMs holds, in less time */
+        CHECK(tdmaSlotMs(&cfg, rate) < tdmaSlotMs(&cfg, rate - 1));
+        CHECK(tdmaSlotMs(&cfg, rate) * 1000UL >= phyAirtimeUs(&phyProfiles[rate], TDMA_MAX_FRAME_LENGTH)
+                                                 + 2 * TDMA_GUARD_US);
+    }
+}
+
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
+
+static void testGroupedLayout(void) {
+
+    TdmaFrameConfig cfg;
+    uint32_t base = 0, fast = 0;
+
+    tdmaDefaultConfig(&cfg);
+    cfg.rate[1] = PHY_PROFILE_HIGH_RATE;
+    cfg.rate[3] = PHY_PROFILE_HIGH_RATE;
+    cfg.rate[2] = PHY_PROFILE_50KBPS;
+
+    /* beacon | 0 4 5 .. joins | switch | 2 | switch | 1 3 | switch */
+    CHECK(tdmaSlotOffsetUs(&cfg, 0) == cfg.beaconMs * 1000UL);
+    CHECK(tdmaSlotOffsetUs(&cfg, 4) == (cfg.beaconMs + cfg.slotMs) * 1000UL);
+    CHECK(tdmaSlotOffsetUs(&cfg, cfg.numSlots) == (cfg.beaconMs + (cfg.numSlots - 3UL) * cfg.slotMs) * 1000);
+    base = tdmaRateEndUs(&cfg, PHY_PROFILE);
+    CHECK(base == (cfg.beaconMs + (cfg.numSlots - 3UL + cfg.numJoinSlots) * cfg.slotMs) * 1000);
+    CHECK(tdmaSlotOffsetUs(&cfg, 2) == base + TDMA_PHY_SWITCH_US);
+    fast = tdmaSlotOffsetUs(&cfg, 2) + tdmaSlotMs(&cfg, PHY_PROFILE_50KBPS) * 1000UL;
+    CHECK(tdmaRateEndUs(&cfg, PHY_PROFILE_50KBPS) == fast);
+    CHECK(tdmaSlotOffsetUs(&cfg, 1) == fast + TDMA_PHY_SWITCH_US);
+    CHECK(tdmaSlotOffsetUs(&cfg, 3) == tdmaSlotOffsetUs(&cfg, 1) + tdmaSlotMs(&cfg, PHY_PROFILE_HIGH_RATE) * 1000UL);
+    CHECK(tdmaFrameLengthUs(&cfg) == tdmaRateEndUs(&cfg, PHY_PROFILE_HIGH_RATE) + TDMA_PHY_SWITCH_US);
+    checkLayout(&cfg);
+
+    /* Shorter than with every slot at PHY_PROFILE */
+    TdmaFrameConfig slow;
+    tdmaDefaultConfig(&slow);
+    CHECK(tdmaFrameLengthUs(&cfg) < tdmaFrameLengthUs(&slow));
+
+    /* No slot left at PHY_PROFILE and no join slots: the first group follows the switch */
+    memset(cfg.rate, PHY_PROFILE_HIGH_RATE, sizeof(cfg.rate));
+    cfg.numJoinSlots = 0;
+    CHECK(tdmaRateEndUs(&cfg, PHY_PROFILE) == 0);
+    CHECK(tdmaSlotOffsetUs(&cfg, 0) == cfg.beaconMs * 1000UL + TDMA_PHY_SWITCH_US);
+    checkLayout(&cfg);
+}
+
+static void testBeaconRates(void) {
+
+    TdmaFrameConfig cfg;
+    TdmaGateway gw;
+    TdmaNode node;
+    PacketHeader hdr;
+    uint8_t buf[PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS)];
+    uint8_t i, length;
+
+    tdmaDefaultConfig(&cfg);
+    cfg.numSlots = 7;
+    tdmaGatewayInit(&gw, &cfg);
+    for (i = 0; i < cfg.numSlots; ++i) {
+        CHECK(tdmaGatewayJoin(&gw, (uint8_t)(10 + i)) == i);
+        gw.cfg.rate[i] = (uint8_t)(i % PHY_NUM_PROFILES);
+    }
+
+    length = tdmaGatewayBuildBeacon(&gw, buf, sizeof(buf));
+    CHECK(length == PKT_HEADER_LENGTH + 6 + 7 + 2);
+    CHECK(pktDecodeHeader(&hdr, buf, length) == 0 && hdr.type == PKT_TYPE_BEACON);
+
+    tdmaNodeInit(&node, 15);
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH) == 0);
+    CHECK(node.slot == 5 && node.cfg.rate[5] == 5 % PHY_NUM_PROFILES);
+    CHECK(memcmp(node.cfg.rate, gw.cfg.rate, cfg.numSlots) == 0);
+    for (i = 0; i < cfg.numSlots + cfg.numJoinSlots; ++i)
+        CHECK(tdmaSlotOffsetUs(&node.cfg, i) == tdmaSlotOffsetUs(&gw.cfg, i));
+    CHECK(tdmaFrameLengthUs(&node.cfg) == tdmaFrameLengthUs(&gw.cfg));
+
+    /* A rate that is no profile, or a rate map cut short */
+    buf[length - 1] |= 0x03 << 4;
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH) == 1);
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH - 1) == 1);
+}
+
+/* One superframe in which the owner of slot 0 is heard at rssi, or not if rssi is 0 */
+static void frame(AdrGateway * adr, TdmaGateway * gw, int8_t rssi) {
+
+    if (rssi != 0)
+        adrGatewayHeard(adr, tdmaGatewayHeard(gw, gw->owner[0]), rssi);
+    adrGatewayEndFrame(adr, gw);
+    tdmaGatewayEndFrame(gw);
+}
+
+static void testAdr(void) {
+
+    TdmaFrameConfig cfg;
+    TdmaGateway gw;
+    AdrGateway adr;
+    uint8_t i;
+
+    tdmaDefaultConfig(&cfg);
+    tdmaGatewayInit(&gw, &cfg);
+    adrGatewayInit(&adr, PHY_NUM_PROFILES - 1);
+    adrGatewayJoin(&adr, &gw, tdmaGatewayJoin(&gw, 7));
+
+    /* Not enough margin over the 50 kbps sensitivity: stays */
+    for (i = 0; i < 3 * ADR_UP_FRAMES; ++i)
+        frame(&adr, &gw, PHY_50KBPS_SENSITIVITY + ADR_UP_MARGIN_DB - 2);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_LONG_RANGE);
+
+    /* Strong link: one profile per ADR_UP_FRAMES frames */
+    for (i = 0; i < ADR_UP_FRAMES; ++i)
+        frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + 20);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_50KBPS);
+    for (i = 0; i < ADR_UP_FRAMES - 1; ++i)
+        frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + 20);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_50KBPS);
+    frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + 20);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_HIGH_RATE);
+
+    /* Fading below the margin of the high rate profile: steps down */
+    for (i = 0; i < 16 && gw.cfg.rate[0] == PHY_PROFILE_HIGH_RATE; ++i)
+        frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + ADR_DOWN_MARGIN_DB - 3);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_50KBPS);
+
+    /* Silent owner: back to PHY_PROFILE after ADR_FALLBACK_MISSES superframes */
+    for (i = 0; i < ADR_FALLBACK_MISSES - 1; ++i)
+        frame(&adr, &gw, 0);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_50KBPS);
+    frame(&adr, &gw, 0);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_LONG_RANGE);
+
+    /* Up again, then the slot goes to another tracker, which starts over */
+    for (i = 0; i < ADR_UP_FRAMES; ++i)
+        frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + 20);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_50KBPS);
+    tdmaGatewayLeave(&gw, 7);
+    adrGatewayJoin(&adr, &gw, tdmaGatewayJoin(&gw, 8));
+    frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + 20);
+    CHECK(gw.owner[0] == 8 && gw.cfg.rate[0] == PHY_PROFILE_LONG_RANGE);
+
+    /* A tracker that re-joins its own slot, having lost the beacons, also starts over */
+    for (i = 0; i < ADR_UP_FRAMES; ++i)
+        frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + 20);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_50KBPS);
+    adrGatewayJoin(&adr, &gw, tdmaGatewayJoin(&gw, 8));
+    frame(&adr, &gw, 0);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_LONG_RANGE);
+
+    /* Capped */
+    adrGatewayInit(&adr, PHY_PROFILE_50KBPS);
+    for (i = 0; i < 4 * ADR_UP_FRAMES; ++i)
+        frame(&adr, &gw, PHY_HIGH_RATE_SENSITIVITY + 20);
+    CHECK(gw.cfg.rate[0] == PHY_PROFILE_50KBPS);
+}
+
+#endif
+
+int main(void) {
+
+    testBaseLayout();
+    testSlotMs();
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE
+    testGroupedLayout();
+    testBeaconRates();
+    testAdr();
+#endif
+
+    return checkReport();
+}
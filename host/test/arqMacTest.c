@@ -0,0 +1,221 @@
+//
+//  arqMacTest.c
+//  Tests of acknowledged delivery (arqMac.c)
+//
+//  The gateway takes every sequence number once, in any order within the bitmap, across
+//  the 16 bit wrap too, and its ACK reports only frames it received: nothing from before
+//  the first frame of a tracker it just met, nothing a jump ahead left behind. The tracker
+//  frees exactly the frames an ACK reports and keeps the others waiting. Its retry buffer
+//  sends each waiting frame once a round, newest first, gives a frame up after maxTries and
+//  pushes the oldest out when full; unanswered frames in a row mean the link is down.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arqMac.h"
+#include "check.h"
+#include "packetCodec.h"
+
+#define NODE_ID         7
+#define FRAME_LENGTH    (PKT_HEADER_LENGTH + 8)
+
+static uint8_t dataFrame(uint8_t * frame, uint16_t seq) {
+
+    PacketHeader hdr = { PKT_TYPE_DATA, 0, NODE_ID, seq };
+
+    memset(frame + pktEncodeHeader(&hdr, frame), (uint8_t)seq, FRAME_LENGTH - PKT_HEADER_LENGTH);
+    return FRAME_LENGTH;
+}
+
+/* The gateway's ACK for NODE_ID, handed to the tracker */
+static void deliverAck(const ArqGateway * gw, ArqNode * node) {
+
+    uint8_t ack[PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH];
+    PacketHeader hdr;
+
+    CHECK(arqGatewayBuildAck(gw, NODE_ID, ARQ_NO_RSSI, ack, sizeof(ack)) == sizeof(ack));
+    CHECK(pktDecodeHeader(&hdr, ack, sizeof(ack)) == 0 && hdr.type == PKT_TYPE_ACK);
+    CHECK(arqNodeOnAck(node, hdr.seq, ack + PKT_HEADER_LENGTH, ARQ_ACK_PAYLOAD_LENGTH) == 0);
+}
+
+static void testGateway(void) {
+
+    ArqGateway gw;
+    ArqConfig cfg;
+    ArqNode node;
+
+    arqDefaultConfig(&cfg);
+    arqNodeInit(&node, &cfg);
+    arqGatewayInit(&gw);
+    CHECK(arqGatewayReceive(&gw, PKT_GATEWAY_ID, 1) == 0);
+    CHECK(arqGatewayBuildAck(&gw, NODE_ID, ARQ_NO_RSSI, NULL, 0) == 0);
+
+    /* The first frame heard claims nothing before it */
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 50) == 1);
+    deliverAck(&gw, &node);
+    CHECK(node.lastNewest == 50 && node.lastBitmap == 0);
+    CHECK(arqNodeAcked(&node, 50) && !arqNodeAcked(&node, 49) && !arqNodeAcked(&node, 34));
+
+    /* 51 lost, 52 comes: 51 is not reported until it arrives, once */
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 52) == 1);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 52) == 0);
+    deliverAck(&gw, &node);
+    CHECK(node.lastNewest == 52 && node.lastBitmap == 0x0002);
+    CHECK(!arqNodeAcked(&node, 51) && arqNodeAcked(&node, 50) && !arqNodeAcked(&node, 53));
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 51) == 1);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 51) == 0);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 50) == 0);
+    deliverAck(&gw, &node);
+    CHECK(node.lastBitmap == 0x0003 && arqNodeAcked(&node, 51));
+
+    /* A jump past the bitmap leaves 50..52 unreported, the holes before 80 are not claimed */
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 80) == 1);
+    deliverAck(&gw, &node);
+    CHECK(node.lastNewest == 80 && node.lastBitmap == 0);
+    CHECK(!arqNodeAcked(&node, 52) && !arqNodeAcked(&node, 79));
+
+    /* The oldest the bitmap holds, then anything older is a tracker that restarted */
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 80 - ARQ_BITMAP_BITS) == 1);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 80 - ARQ_BITMAP_BITS) == 0);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 80 - ARQ_BITMAP_BITS - 1) == 1);
+    deliverAck(&gw, &node);
+    CHECK(node.lastNewest == 80 - ARQ_BITMAP_BITS - 1 && node.lastBitmap == 0);
+}
+
+static void testWrap(void) {
+
+    ArqGateway gw;
+    ArqConfig cfg;
+    ArqNode node;
+
+    arqDefaultConfig(&cfg);
+    arqNodeInit(&node, &cfg);
+    arqGatewayInit(&gw);
+
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 0xFFFE) == 1);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 0) == 1);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 1) == 1);
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 0xFFFE) == 0);
+    deliverAck(&gw, &node);
+    CHECK(node.lastNewest == 1 && node.lastBitmap == 0x0005);
+    CHECK(arqNodeAcked(&node, 0) && arqNodeAcked(&node, 0xFFFE) && !arqNodeAcked(&node, 0xFFFF));
+
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 0xFFFF) == 1);
+    deliverAck(&gw, &node);
+    CHECK(node.lastBitmap == 0x0007 && arqNodeAcked(&node, 0xFFFF));
+}
+
+static void testRetryBuffer(void) {
+
+    uint8_t frame[ARQ_MAX_FRAME_LENGTH + 1];
+    ArqConfig cfg;
+    ArqNode node;
+    uint8_t slot, round, i;
+
+    arqDefaultConfig(&cfg);
+    arqNodeInit(&node, &cfg);
+
+    /* Too long or no header: not taken */
+    memset(frame, 0, sizeof(frame));
+    dataFrame(frame, 1);
+    CHECK(arqNodeQueue(&node, frame, ARQ_MAX_FRAME_LENGTH + 1) == ARQ_NONE);
+    CHECK(arqNodeQueue(&node, frame, PKT_HEADER_LENGTH - 1) == ARQ_NONE);
+
+    /* A full buffer pushes out the oldest, across the sequence number wrap too */
+    for (i = 0; i <= ARQ_RETRY_SLOTS; ++i)
+        CHECK(arqNodeQueue(&node, frame, dataFrame(frame, (uint16_t)(0xFFFE + i))) != ARQ_NONE);
+    CHECK(node.evicted == 1);
+    CHECK(!arqNodePending(&node, 0xFFFE) && arqNodePending(&node, 0xFFFF));
+    CHECK(arqNodePending(&node, (uint16_t)(0xFFFE + ARQ_RETRY_SLOTS)));
+
+    /* Every round sends each frame once, newest first, until maxTries */
+    for (round = 0; round < cfg.maxTries; ++round) {
+
+        uint16_t expect = (uint16_t)(0xFFFE + ARQ_RETRY_SLOTS);
+
+        arqNodeStartRound(&node);
+        while ((slot = arqNodeNext(&node)) != ARQ_NONE) {
+            CHECK(node.entry[slot].seq == expect);
+            CHECK(node.entry[slot].length == FRAME_LENGTH);
+            CHECK(node.entry[slot].frame[PKT_HEADER_LENGTH] == (uint8_t)expect);
+            arqNodeSent(&node, slot);
+            --expect;
+        }
+        CHECK(expect == 0xFFFE);
+    }
+    CHECK(node.expired == ARQ_RETRY_SLOTS);
+    arqNodeStartRound(&node);
+    CHECK(arqNodeNext(&node) == ARQ_NONE);
+}
+
+static void testLinkLoss(void) {
+
+    uint8_t frame[FRAME_LENGTH];
+    ArqGateway gw;
+    ArqConfig cfg;
+    ArqNode node;
+    uint8_t slot, i;
+
+    arqDefaultConfig(&cfg);
+    cfg.maxTries = 1;
+    arqNodeInit(&node, &cfg);
+    arqGatewayInit(&gw);
+
+    /* Nobody answers */
+    for (i = 0; i < ARQ_LINK_LOSS_FRAMES; ++i) {
+        CHECK(arqNodeLinkUp(&node));
+        slot = arqNodeQueue(&node, frame, dataFrame(frame, i));
+        arqNodeSent(&node, slot);
+    }
+    CHECK(!arqNodeLinkUp(&node));
+
+    /* One ACK brings it back; a frame it freed during its ACK window counts as answered */
+    slot = arqNodeQueue(&node, frame, dataFrame(frame, i));
+    CHECK(arqGatewayReceive(&gw, NODE_ID, i) == 1);
+    deliverAck(&gw, &node);
+    CHECK(arqNodeLinkUp(&node) && node.unanswered == 0);
+    arqNodeSent(&node, slot);
+    CHECK(node.unanswered == 0 && node.acked == 1 && node.expired == ARQ_LINK_LOSS_FRAMES);
+}
+
+/* A restarted gateway must not acknowledge the LOG frame it never received: the tracker
+ * would drop those records from its flash */
+static void testRestartedGateway(void) {
+
+    uint8_t frame[FRAME_LENGTH];
+    ArqGateway gw;
+    ArqConfig cfg;
+    ArqNode node;
+
+    arqDefaultConfig(&cfg);
+    arqNodeInit(&node, &cfg);
+    arqGatewayInit(&gw);
+
+    CHECK(arqNodeQueue(&node, frame, dataFrame(frame, 40)) != ARQ_NONE);
+    CHECK(arqNodeQueue(&node, frame, dataFrame(frame, 41)) != ARQ_NONE);
+
+    /* 40 is lost, 41 is the first frame the gateway hears */
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 41) == 1);
+    deliverAck(&gw, &node);
+    CHECK(!arqNodeAcked(&node, 40) && arqNodePending(&node, 40));
+    CHECK(arqNodeAcked(&node, 41) && !arqNodePending(&node, 41));
+    CHECK(node.acked == 1);
+
+    /* Its retransmission gets it in */
+    CHECK(arqGatewayReceive(&gw, NODE_ID, 40) == 1);
+    deliverAck(&gw, &node);
+    CHECK(arqNodeAcked(&node, 40) && !arqNodePending(&node, 40));
+    CHECK(node.acked == 2);
+}
+
+int main(void) {
+
+    testGateway();
+    testWrap();
+    testRetryBuffer();
+    testLinkLoss();
+    testRestartedGateway();
+
+    return checkReport();
+}
@@ -0,0 +1,115 @@
+//
+//  channelHopTest.c
+//  Tests of the channel sequence (channelHop.c) and the scan preamble (phyProfile.c)
+//
+//  The channel of a frame depends on nothing but its node ID and sequence number, stays in
+//  range and spreads evenly; the channels sit in the band at their spacing and CMD_FS gets
+//  their frequency; the constant expressions of the scan agree with the runtime ones and
+//  the preamble covers a scan round.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "channelHop.h"
+#include "check.h"
+#include "phyProfile.h"
+
+static void testSequence(void) {
+
+    uint32_t count[HOP_MAX_CHANNELS];
+    uint32_t repeats = 0;
+    uint8_t channels, ch;
+    uint32_t seq;
+
+    CHECK(hopChannel(7, 100, 4) == hopChannel(7, 100, 4));
+    CHECK(hopChannel(7, 100, 1) == 0);
+    CHECK(hopChannel(7, 100, 0) == 0);
+
+    for (channels = 2; channels <= HOP_MAX_CHANNELS; ++channels) {
+
+        memset(count, 0, sizeof(count));
+        for (seq = 0; seq < 8000; ++seq) {
+            ch = hopChannel((uint8_t)(seq % 40 + 1), (uint16_t)(seq / 40), channels);
+            CHECK(ch < channels);
+            ++count[ch % HOP_MAX_CHANNELS];
+        }
+
+        /* Within 15 % of the even share on every channel */
+        for (ch = 0; ch < channels; ++ch)
+            CHECK(count[ch] * channels > 8000 * 85 / 100 && count[ch] * channels < 8000 * 115 / 100);
+    }
+
+    /* Two trackers that met do not follow each other */
+    for (seq = 0; seq < 1000; ++seq) {
+        if (hopChannel(3, (uint16_t)seq, 8) == hopChannel(4, (uint16_t)seq, 8) &&
+            hopChannel(3, (uint16_t)(seq + 1), 8) == hopChannel(4, (uint16_t)(seq + 1), 8))
+            ++repeats;
+    }
+    CHECK(repeats < 1000 / 64 * 2);
+}
+
+static void testFrequencies(void) {
+
+    uint16_t frequency, fractFreq;
+    uint8_t ch;
+
+    for (ch = 0; ch < HOP_MAX_CHANNELS; ++ch) {
+
+        uint32_t khz = hopChannelKhz(ch);
+
+        /* The whole channel inside 433.05 - 434.79 MHz */
+        CHECK(khz - HOP_SPACING_KHZ / 2 >= 433050 && khz + HOP_SPACING_KHZ / 2 <= 434790);
+        if (ch > 0)
+            CHECK(khz - hopChannelKhz(ch - 1) == HOP_SPACING_KHZ);
+
+        /* Back from the CMD_FS fields to within a kHz */
+        hopFsFrequency(ch, &frequency, &fractFreq);
+        CHECK(frequency == 433 || frequency == 434);
+        CHECK(khz - (frequency * 1000UL + fractFreq * 1000UL / 65536) <= 1);
+    }
+
+    /* 433.4 MHz */
+    hopFsFrequency(1, &frequency, &fractFreq);
+    CHECK(frequency == 433 && fractFreq == 0x6666);
+}
+
+static void testScan(void) {
+
+    const PhyProfile * phy = phyProfileGet(PHY_PROFILE);
+    uint8_t id, channels;
+
+    CHECK(phySenseUs(phy) == PHY_SENSE_US);
+    CHECK(phyScanUs(phy, PHY_CHANNELS) == PHY_SCAN_US);
+    CHECK(phyScanPreambleLength(phy, PHY_CHANNELS) == PHY_PREAMBLE_LENGTH);
+
+    for (id = 0; id < PHY_NUM_PROFILES; ++id) {
+
+        phy = phyProfileGet(id);
+        CHECK(phyScanPreambleLength(phy, 1) == phy->preambleLength);
+
+        /* The extra preamble lasts a scan round, and not a byte more */
+        for (channels = 2; channels <= HOP_MAX_CHANNELS; ++channels) {
+            uint32_t extra = phyScanPreambleLength(phy, channels) - phy->preambleLength;
+            uint32_t byteNs = 8 * phyBitNs(phy);
+
+            CHECK(extra * byteNs >= phyScanUs(phy, channels) * 1000);
+            CHECK((extra - 1) * byteNs < phyScanUs(phy, channels) * 1000);
+        }
+    }
+
+    /* Long range scans all eight channels in 8 bytes of preamble, 50 kbps only four in 30 */
+    CHECK(phySenseUs(&phyProfiles[PHY_PROFILE_LONG_RANGE]) == 800);
+    CHECK(phyScanPreambleLength(&phyProfiles[PHY_PROFILE_LONG_RANGE], 8) == 8);
+    CHECK(phyScanPreambleLength(&phyProfiles[PHY_PROFILE_50KBPS], 4) <= PHY_MAX_PREAMBLE_LENGTH);
+    CHECK(phyScanPreambleLength(&phyProfiles[PHY_PROFILE_50KBPS], 8) > PHY_MAX_PREAMBLE_LENGTH);
+}
+
+int main(void) {
+
+    testSequence();
+    testFrequencies();
+    testScan();
+
+    return checkReport();
+}
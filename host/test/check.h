@@ -0,0 +1,30 @@
+//
+//  check.h
+//  What the tests in host/test share: CHECK() and the verdict their main() ends with
+//
+//  A failing CHECK prints its file, line and condition and counts a failure; the test
+//  carries on. Include it in the test's .c only, each test is one program.
+//
+
+#ifndef check_h
+#define check_h
+
+#include <stdio.h>
+
+static unsigned failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures; \
+        } \
+    } while (0)
+
+/// Prints "passed" or "FAILED". Returns the exit status of the test.
+static int checkReport(void) {
+
+    printf("%s\n", failures ? "FAILED" : "passed");
+    return failures != 0;
+}
+
+#endif /* check_h */
@@ -0,0 +1,74 @@
+//
+//  csmaMacTest.c
+//  Tests of the CSMA backoff (csmaMac.c)
+//
+//  The backoff is a whole number of units below 2^BE, BE starts at minBe, grows by one an
+//  attempt and stops at maxBe, also for attempt counts that would wrap it around.
+//
+
+#include <stdio.h>
+
+#include "check.h"
+#include "csmaMac.h"
+
+static void testDefaults(void) {
+
+    CsmaConfig cfg;
+
+    csmaDefaultConfig(&cfg);
+    CHECK(cfg.rssiThresholdDbm == CSMA_DEFAULT_RSSI_THRESHOLD_DBM);
+    CHECK(cfg.senseUs == CSMA_DEFAULT_SENSE_US);
+    CHECK(cfg.minBe == CSMA_DEFAULT_MIN_BE && cfg.maxBe == CSMA_DEFAULT_MAX_BE);
+    CHECK(cfg.maxAttempts == CSMA_DEFAULT_MAX_ATTEMPTS);
+
+    /* A unit covers preamble and sync word, in whole milliseconds */
+    CHECK(cfg.backoffUnitUs >= PHY_SYNC_US && cfg.backoffUnitUs % 1000 == 0);
+}
+
+static void testBackoff(void) {
+
+    CsmaConfig cfg;
+    uint32_t random = 1;
+    uint8_t attempt;
+    uint16_t i;
+
+    csmaDefaultConfig(&cfg);
+
+    for (attempt = 0; attempt < 10; ++attempt) {
+
+        uint8_t be = cfg.minBe + attempt > cfg.maxBe ? cfg.maxBe : cfg.minBe + attempt;
+        uint32_t top = ((1UL << be) - 1) * cfg.backoffUnitUs;
+        uint32_t longest = 0;
+
+        CHECK(csmaBackoffUs(&cfg, attempt, 0) == 0);
+        CHECK(csmaBackoffUs(&cfg, attempt, 0xFFFFFFFF) == top);
+
+        for (i = 0; i < 1000; ++i) {
+            uint32_t us;
+
+            random = random * 1103515245 + 12345;
+            us = csmaBackoffUs(&cfg, attempt, random);
+            CHECK(us % cfg.backoffUnitUs == 0 && us <= top);
+            if (us > longest)
+                longest = us;
+        }
+        /* Spread over the whole range, not a few units of it */
+        CHECK(longest > top / 2);
+    }
+
+    /* An attempt count that would wrap BE around stays at maxBe */
+    CHECK(csmaBackoffUs(&cfg, 255, 0xFFFFFFFF) == ((1UL << cfg.maxBe) - 1) * cfg.backoffUnitUs);
+
+    /* maxBe below minBe: maxBe wins */
+    cfg.minBe = 5;
+    cfg.maxBe = 2;
+    CHECK(csmaBackoffUs(&cfg, 0, 0xFFFFFFFF) == 3UL * cfg.backoffUnitUs);
+}
+
+int main(void) {
+
+    testDefaults();
+    testBackoff();
+
+    return checkReport();
+}
@@ -0,0 +1,388 @@
+//
+//  epochTest.c
+//  Tests of the epoch assembler (fixEpoch.c)
+//
+//  The streams in data/ are NMEA output in the sentence order of three kinds of receiver:
+//  a multi-constellation one at 1 Hz (RMC, VTG, GGA, GSA, GSV, GLL), a GPS-only one that
+//  starts without a fix and loses an RMC (GGA, GSA, RMC), and a 5 Hz one behind a buffering
+//  bridge that lets an RMC trail the GGA of the next epoch, repeats one late and crosses
+//  midnight. Each line reaches the assembler the way the tracker hands it over: parsed by
+//  gpsParser.c, timed on a local clock that starts each new second on time and then
+//  advances by the line's time on a 9600 baud UART.
+//
+//  usage: epochTest <data directory>
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "fixEpoch.h"
+#include "gpsParser.h"
+#include "nmeaSim.h"
+#include "trackSim.h"
+#include "channelSim.h"
+
+#define DAY_MS          86400000UL
+#define UART_BYTE_US    1042        // 10 bits at 9600 baud
+
+typedef struct {
+    uint32_t sentences;         // GGA and RMC, what the tracker sent before
+    uint32_t count;
+    EpochFix epochs[16];
+} Emitted;
+
+static int32_t degreesE7(double value, char direction) {
+
+    double degrees = (int32_t)(value / 100);
+    degrees += (value - degrees * 100) / 60;
+
+    int32_t e7 = (int32_t)(degrees * 1e7 + 0.5);
+    return (direction == 'S' || direction == 'W') ? -e7 : e7;
+}
+
+/* As the tracker: what a parsed GGA or RMC contributes */
+static void partOf(const GPSData * d, EpochFix * part) {
+
+    uint32_t hhmmss = (uint32_t)d->time;
+    uint8_t gga = d->nmeaData.msgType == NMEA_GGA;
+
+    memset(part, 0, sizeof(*part));
+    part->sources    = gga ? FIX_EPOCH_GGA : FIX_EPOCH_RMC;
+    part->fix.timeMs = ((hhmmss / 10000) * 3600 + (hhmmss / 100 % 100) * 60 + hhmmss % 100) * 1000 +
+                       (uint32_t)((d->time - hhmmss) * 1000 + 0.5);
+
+    if ((d->latDirection == 'N' || d->latDirection == 'S') &&
+        (d->longDirection == 'E' || d->longDirection == 'W')) {
+        part->fix.latE7 = degreesE7(d->latitude, d->latDirection);
+        part->fix.lonE7 = degreesE7(d->longitude, d->longDirection);
+        part->have |= FIX_EPOCH_POSITION;
+    }
+
+    if (gga) {
+        part->quality    = d->fixQuality;
+        part->satellites = d->numSatellites;
+        part->hdop       = (uint16_t)(d->hdop * 100 + 0.5);
+        if (part->have & FIX_EPOCH_POSITION) {
+            part->fix.altM = (int16_t)d->altitude;
+            part->have |= FIX_EPOCH_ALTITUDE;
+        }
+    }
+    else if (d->status == 'A') {
+        part->quality    = 1;
+        part->speedCmS   = (uint16_t)(d->groundSpeed * 51.4444 + 0.5);
+        part->courseCdeg = (uint16_t)(d->trueCourse * 100 + 0.5);
+        part->have |= FIX_EPOCH_MOTION;
+    }
+}
+
+static void collect(Emitted * em, const EpochFix * out, uint8_t n) {
+
+    uint8_t i;
+
+    for (i = 0; i < n; ++i) {
+        if (em->count < sizeof(em->epochs) / sizeof(em->epochs[0]))
+            em->epochs[em->count] = out[i];
+        ++em->count;
+    }
+}
+
+/* Runs a stream through parser and assembler, flushing at the end */
+static uint8_t runStream(const char * dir, const char * name, FixEpoch * a, Emitted * em) {
+
+    char path[512], line[128];
+    EpochFix part, out[FIX_EPOCH_MAX_OUT];
+    FixEpochConfig config;
+    GPSData data;
+    FILE * f;
+    uint32_t nowUs = 0, firstMs = 0, newestMs = 0;
+    uint8_t started = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if ((f = fopen(path, "r")) == NULL) {
+        perror(path);
+        ++failures;
+        return 1;
+    }
+
+    memset(em, 0, sizeof(*em));
+    fixEpochDefaultConfig(&config);
+    fixEpochInit(a, &config);
+
+    while (fgets(line, sizeof(line), f)) {
+
+        nmeaDataInit(&data);
+        if (nmeaReceiveSentence(&data, line) || nmeaParse(&data) ||
+            (data.nmeaData.msgType != NMEA_GGA && data.nmeaData.msgType != NMEA_RMC)) {
+            nowUs += strlen(line) * UART_BYTE_US;
+            continue;
+        }
+        partOf(&data, &part);
+
+        /* A new second starts on time; the line arrives once it is through the UART */
+        if (!started) {
+            started = 1;
+            firstMs = newestMs = part.fix.timeMs;
+        }
+        uint32_t sinceFirst = (part.fix.timeMs + DAY_MS - firstMs) % DAY_MS;
+        if (sinceFirst > (newestMs + DAY_MS - firstMs) % DAY_MS) {
+            newestMs = part.fix.timeMs;
+            if (nowUs < sinceFirst * 1000)
+                nowUs = sinceFirst * 1000;
+        }
+        nowUs += strlen(line) * UART_BYTE_US;
+
+        ++em->sentences;
+        collect(em, out, fixEpochPush(a, &part, nowUs / 1000, out));
+    }
+    fclose(f);
+
+    collect(em, out, fixEpochFlush(a, out));
+    return 0;
+}
+
+static void testUbloxDrive(const char * dir) {
+
+    FixEpoch a;
+    Emitted em;
+    uint32_t i;
+
+    if (runStream(dir, "ubloxDrive.nmea", &a, &em))
+        return;
+
+    CHECK(em.sentences == 8);
+    CHECK(em.count == 4);
+    CHECK(a.complete == 4 && a.timedOut == 0 && a.displaced == 0 && a.late == 0);
+
+    for (i = 0; i < 4 && i < em.count; ++i) {
+        const EpochFix * e = &em.epochs[i];
+        CHECK(e->fix.timeMs == (12 * 3600 + 35 * 60 + 19 + i) * 1000);
+        CHECK(e->have == (FIX_EPOCH_POSITION | FIX_EPOCH_ALTITUDE | FIX_EPOCH_MOTION));
+        CHECK(e->sources == (FIX_EPOCH_GGA | FIX_EPOCH_RMC));
+        CHECK(e->quality == 1 && e->satellites == 14 && e->hdop == 78);
+        CHECK(e->fix.altM == 41);
+        CHECK(e->speedCmS == 639 && e->courseCdeg == 8440);
+    }
+    CHECK(em.epochs[0].fix.latE7 == 455017000 && em.epochs[0].fix.lonE7 == -735673000);
+}
+
+static void testGpsColdStart(const char * dir) {
+
+    FixEpoch a;
+    Emitted em;
+    uint32_t i;
+
+    if (runStream(dir, "gpsColdStart.nmea", &a, &em))
+        return;
+
+    CHECK(em.sentences == 13);
+    CHECK(em.count == 7);
+    CHECK(a.complete == 6 && a.timedOut == 1 && a.late == 0);
+
+    /* No fix yet: still one epoch a second, without a position */
+    for (i = 0; i < 3; ++i) {
+        CHECK(em.epochs[i].quality == 0);
+        CHECK(em.epochs[i].have == 0);
+    }
+
+    /* The lost RMC: the GGA goes out on its own once the wait is over */
+    CHECK(em.epochs[5].fix.timeMs == (9 * 3600 + 50 * 60 + 5) * 1000);
+    CHECK(em.epochs[5].sources == FIX_EPOCH_GGA);
+    CHECK(em.epochs[5].have == (FIX_EPOCH_POSITION | FIX_EPOCH_ALTITUDE));
+    CHECK(em.epochs[5].quality == 1 && em.epochs[5].fix.altM == 23);
+
+    CHECK(em.epochs[6].have == (FIX_EPOCH_POSITION | FIX_EPOCH_ALTITUDE | FIX_EPOCH_MOTION));
+    CHECK(em.epochs[6].speedCmS == 27 && em.epochs[6].courseCdeg == 21130);
+}
+
+static void testBridge5Hz(const char * dir) {
+
+    static const uint32_t times[] = {
+        DAY_MS - 600, DAY_MS - 400, DAY_MS - 200, 0, 200, 400
+    };
+    FixEpoch a;
+    Emitted em;
+    uint32_t i;
+
+    if (runStream(dir, "bridge5Hz.nmea", &a, &em))
+        return;
+
+    CHECK(em.sentences == 13);
+    CHECK(em.count == 6);
+    CHECK(a.complete == 6 && a.timedOut == 0 && a.displaced == 0 && a.late == 1);
+
+    /* In time order across midnight, each with its own RMC */
+    for (i = 0; i < 6 && i < em.count; ++i) {
+        CHECK(em.epochs[i].fix.timeMs == times[i]);
+        CHECK(em.epochs[i].sources == (FIX_EPOCH_GGA | FIX_EPOCH_RMC));
+        CHECK(em.epochs[i].quality == 2 && em.epochs[i].fix.altM == (int16_t)(12 + i));
+        CHECK(em.epochs[i].speedCmS == 159 && em.epochs[i].courseCdeg == 4500);
+    }
+}
+
+static void part(EpochFix * p, uint8_t source, uint32_t timeMs) {
+
+    memset(p, 0, sizeof(*p));
+    p->sources = source;
+    p->fix.timeMs = timeMs;
+    p->fix.latE7 = 455017000;
+    p->fix.lonE7 = -735673000;
+    p->have = FIX_EPOCH_POSITION;
+    p->quality = 1;
+}
+
+static void testOrdering(void) {
+
+    FixEpochConfig config;
+    FixEpoch a;
+    EpochFix p, out[FIX_EPOCH_MAX_OUT];
+    uint8_t n;
+
+    fixEpochDefaultConfig(&config);
+    fixEpochInit(&a, &config);
+
+    /* A newer epoch completing first pushes the older one out ahead of it */
+    part(&p, FIX_EPOCH_GGA, 1000);
+    CHECK(fixEpochPush(&a, &p, 0, out) == 0);
+    part(&p, FIX_EPOCH_GGA, 2000);
+    CHECK(fixEpochPush(&a, &p, 100, out) == 0);
+    part(&p, FIX_EPOCH_RMC, 2000);
+    n = fixEpochPush(&a, &p, 200, out);
+    CHECK(n == 2 && out[0].fix.timeMs == 1000 && out[1].fix.timeMs == 2000);
+    CHECK(a.displaced == 1 && a.complete == 1);
+
+    /* Its RMC is now late */
+    part(&p, FIX_EPOCH_RMC, 1000);
+    CHECK(fixEpochPush(&a, &p, 300, out) == 0 && a.late == 1);
+
+    /* With both slots taken, a third epoch pushes the oldest out */
+    part(&p, FIX_EPOCH_GGA, 3000);
+    fixEpochPush(&a, &p, 400, out);
+    part(&p, FIX_EPOCH_GGA, 4000);
+    fixEpochPush(&a, &p, 500, out);
+    part(&p, FIX_EPOCH_GGA, 5000);
+    n = fixEpochPush(&a, &p, 600, out);
+    CHECK(n == 1 && out[0].fix.timeMs == 3000 && a.displaced == 2);
+
+    /* Nothing more arrives: the wait runs out */
+    CHECK(fixEpochPoll(&a, 900, out) == 0);
+    n = fixEpochPoll(&a, 1100, out);
+    CHECK(n == 2 && out[0].fix.timeMs == 4000 && out[1].fix.timeMs == 5000 && a.timedOut == 2);
+    CHECK(fixEpochFlush(&a, out) == 0);
+
+    /* A duplicate of the same type adds nothing */
+    part(&p, FIX_EPOCH_GGA, 6000);
+    fixEpochPush(&a, &p, 2000, out);
+    p.fix.altM = 99;
+    p.have |= FIX_EPOCH_ALTITUDE;
+    fixEpochPush(&a, &p, 2010, out);
+    n = fixEpochFlush(&a, out);
+    CHECK(n == 1 && !(out[0].have & FIX_EPOCH_ALTITUDE));
+}
+
+static void testWire(void) {
+
+    EpochFix e, d;
+    uint8_t buf[FIX_EPOCH_WIRE_LENGTH];
+
+    memset(&e, 0, sizeof(e));
+    e.fix.timeMs  = DAY_MS - 1;
+    e.fix.latE7   = -337000000;
+    e.fix.lonE7   = 1512000000;
+    e.fix.altM    = -12;
+    e.speedCmS    = 3105;
+    e.courseCdeg  = 35999;
+    e.hdop        = 9999;
+    e.quality     = 4;
+    e.satellites  = 31;
+    e.have        = FIX_EPOCH_POSITION | FIX_EPOCH_MOTION;
+    e.sources     = FIX_EPOCH_GGA;
+
+    fixEpochEncode(&e, buf);
+    fixEpochDecode(&d, buf);
+    CHECK(d.fix.timeMs == e.fix.timeMs && d.fix.latE7 == e.fix.latE7 && d.fix.lonE7 == e.fix.lonE7);
+    CHECK(d.fix.altM == e.fix.altM && d.speedCmS == e.speedCmS && d.courseCdeg == e.courseCdeg);
+    CHECK(d.hdop == e.hdop && d.quality == e.quality && d.satellites == e.satellites);
+    CHECK(d.have == e.have && d.sources == 0);
+}
+
+/* An hour of simulated 1 Hz output with sentences lost at random: every epoch goes out
+ * once, in order, and the frames are halved */
+static void testSimulated(void) {
+
+    SimTrack track;
+    SimSky sky;
+    FixEpochConfig config;
+    FixEpoch a;
+    EpochFix p, out[FIX_EPOCH_MAX_OUT];
+    GPSData data;
+    uint32_t rng = 12345, sentences = 0, epochs = 0, lastMs = 0, s, i;
+    uint8_t n, k;
+
+    simTrackInit(&track, SIM_TRACK_DRIVE, 3);
+    simSkyInit(&sky, 5);
+    fixEpochDefaultConfig(&config);
+    fixEpochInit(&a, &config);
+
+    for (s = 0; s < 3600; ++s) {
+
+        SimFix fix;
+        SimNmeaEpoch e;
+        char lines[2][SIM_NMEA_MAX_LENGTH];
+
+        simTrackStep(&track, &fix);
+        simSkyStep(&sky, &e.sky);
+        e.timeMs = (43200 + s) * 1000;
+        e.day = 19;
+        e.month = 9;
+        e.year = 2026;
+        e.altM = 41.2;
+        e.speedKn = hypot(fix.velEast, fix.velNorth) / 0.514444;
+        e.courseDeg = fmod(atan2(fix.velEast, fix.velNorth) * 180 / M_PI + 360, 360);
+        simTrackToLatLon(fix.measEast, fix.measNorth, &e.latE7, &e.lonE7);
+
+        simNmeaRMC(&e, "GN", lines[0]);
+        simNmeaGGA(&e, "GN", lines[1]);
+
+        for (k = 0; k < 2; ++k) {
+            if (simRandomBelow(&rng, 100) < 2)
+                continue;
+            nmeaDataInit(&data);
+            if (nmeaReceiveSentence(&data, lines[k]) || nmeaParse(&data))
+                continue;
+            partOf(&data, &p);
+            ++sentences;
+
+            n = fixEpochPush(&a, &p, s * 1000 + 100 + k * 80, out);
+            for (i = 0; i < n; ++i, ++epochs) {
+                CHECK(out[i].fix.timeMs > lastMs);
+                lastMs = out[i].fix.timeMs;
+            }
+        }
+    }
+    epochs += fixEpochFlush(&a, out);
+
+    /* An epoch is only missing if both of its sentences were lost */
+    CHECK(epochs <= 3600 && epochs >= 3595);
+    CHECK(a.late == 0);
+    printf("simulated hour: %u GGA/RMC frames before, %u merged, %.1f%%; %u waited out\n",
+           sentences, epochs, 100.0 * epochs / sentences, a.timedOut);
+}
+
+int main(int argc, char * argv[]) {
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <data directory>\n", argv[0]);
+        return 2;
+    }
+
+    testUbloxDrive(argv[1]);
+    testGpsColdStart(argv[1]);
+    testBridge5Hz(argv[1]);
+    testOrdering();
+    testWire();
+    testSimulated();
+
+    return checkReport();
+}
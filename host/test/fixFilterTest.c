@@ -0,0 +1,235 @@
+//
+//  fixFilterTest.c
+//  Tests of the fix filter (fixFilter.c) on synthetic tracks
+//
+//  A parked tracker with receiver noise is held close to where it is and only sent every
+//  maxSilenceS; whenever a fix is suppressed, the last one sent, extrapolated at its
+//  velocity, is within toleranceCm of the filtered position. A jump fails the gate and
+//  leaves the state alone, velocity of its epoch included, until maxRejects of them in a
+//  row restart the filter there. A turn is sent within seconds; long gaps restart the
+//  filter, midnight does not.
+//
+
+#include <stdio.h>
+
+#include "check.h"
+#include "fixFilter.h"
+#include "geoPlane.h"
+
+#define ORIGIN_LAT_E7   455000000
+#define ORIGIN_LON_E7   -735000000
+#define NOISE_CM        300
+#define DAY_MS          86400000UL
+
+static GeoPlane plane;
+static uint32_t seed = 1;
+
+/* Uniform in -NOISE_CM..NOISE_CM */
+static int32_t noiseCm(void) {
+
+    seed = seed * 1103515245 + 12345;
+    return (int32_t)((seed >> 8) % (2 * NOISE_CM + 1)) - NOISE_CM;
+}
+
+/* A GGA at east, north cm from the origin */
+static FixMeasurement gga(uint32_t timeMs, int64_t east, int64_t north) {
+
+    FixMeasurement m;
+
+    m.timeMs = timeMs;
+    geoUnproject(&plane, east, north, &m.latE7, &m.lonE7);
+    m.speedCmS = FIX_FILTER_NO_SPEED;
+    m.courseCdeg = 0;
+    return m;
+}
+
+static FixMeasurement rmc(uint32_t timeMs, int64_t east, int64_t north, uint16_t speedCmS, uint16_t courseCdeg) {
+
+    FixMeasurement m = gga(timeMs, east, north);
+
+    m.speedCmS = speedCmS;
+    m.courseCdeg = courseCdeg;
+    return m;
+}
+
+/* Filtered position, cm from the origin */
+static void filtered(const FixFilter * f, int64_t * east, int64_t * north) {
+
+    int32_t latE7, lonE7;
+
+    fixFilterPosition(f, &latE7, &lonE7);
+    geoProject(&plane, latE7, lonE7, east, north);
+}
+
+static int64_t distance2(int64_t east0, int64_t north0, int64_t east1, int64_t north1) {
+
+    return (east1 - east0) * (east1 - east0) + (north1 - north0) * (north1 - north0);
+}
+
+/* What the gateway draws between fixes: the last one sent, moved on at its velocity */
+typedef struct {
+    uint32_t timeMs;
+    int64_t  east;
+    int64_t  north;
+    int32_t  velEast;
+    int32_t  velNorth;
+} Sent;
+
+/* Checks a verdict against the dead reckoning bound, keeps track of what was sent */
+static void follow(const FixFilter * f, FixFilterVerdict verdict, Sent * sent) {
+
+    int64_t east, north, tolerance = f->config.toleranceCm + 10;
+
+    filtered(f, &east, &north);
+
+    if (verdict == FIX_FILTER_SEND) {
+        sent->timeMs   = f->timeMs;
+        sent->east     = east;
+        sent->north    = north;
+        sent->velEast  = f->east.vel;
+        sent->velNorth = f->north.vel;
+    }
+    else if (verdict == FIX_FILTER_SUPPRESS) {
+        int64_t dtMs = (f->timeMs + DAY_MS - sent->timeMs) % DAY_MS;
+
+        CHECK(dtMs < (int64_t)f->config.maxSilenceS * 1000);
+        CHECK(distance2(sent->east + sent->velEast * dtMs / 1000, sent->north + sent->velNorth * dtMs / 1000,
+                        east, north) <= tolerance * tolerance);
+    }
+}
+
+static void testParked(void) {
+
+    FixFilterConfig cfg;
+    FixFilter f;
+    Sent sent = { 0 };
+    FixMeasurement m;
+    int64_t east, north;
+    int32_t velEast, velNorth;
+    uint32_t t;
+    uint8_t i;
+
+    fixFilterDefaultConfig(&cfg);
+    fixFilterInit(&f, &cfg);
+
+    /* Two minutes parked: the first fix, then one every maxSilenceS */
+    for (t = 0; t <= 120; ++t) {
+        FixFilterVerdict verdict;
+
+        m = gga(t * 1000, noiseCm(), noiseCm());
+        verdict = fixFilterUpdate(&f, &m);
+
+        CHECK(verdict == (t % cfg.maxSilenceS == 0 ? FIX_FILTER_SEND : FIX_FILTER_SUPPRESS));
+        follow(&f, verdict, &sent);
+    }
+    CHECK(f.sent == 5 && f.suppressed == 116 && f.restarts == 1);
+    filtered(&f, &east, &north);
+    CHECK(distance2(0, 0, east, north) < 150 * 150);
+
+    /* A multipath jump of 500 m is gated, its RMC's velocity too */
+    velEast = f.east.vel;
+    velNorth = f.north.vel;
+    m = gga(121000, 50000, 0);
+    CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_OUTLIER);
+    m = rmc(121000, 50000, 0, 3000, 9000);
+    CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_DUPLICATE);
+    CHECK(f.outliers == 1 && f.east.vel == velEast && f.north.vel == velNorth);
+    filtered(&f, &east, &north);
+    CHECK(distance2(0, 0, east, north) < 150 * 150);
+
+    /* The next good fix goes in as if nothing happened */
+    m = gga(122000, noiseCm(), noiseCm());
+    CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_SUPPRESS);
+    CHECK(f.rejects == 0);
+
+    /* The tracker really moved: maxRejects fixes there restart the filter on them */
+    for (i = 1; i <= cfg.maxRejects; ++i) {
+        m = gga(122000 + i * 1000, 50000 + noiseCm(), noiseCm());
+        CHECK(fixFilterUpdate(&f, &m) == (i < cfg.maxRejects ? FIX_FILTER_OUTLIER : FIX_FILTER_SEND));
+    }
+    CHECK(f.restarts == 2 && f.outliers == 1 + cfg.maxRejects - 1);
+    filtered(&f, &east, &north);
+    CHECK(distance2(50000, 0, east, north) < 2 * NOISE_CM * NOISE_CM);
+}
+
+static void testDriving(void) {
+
+    FixFilterConfig cfg;
+    FixFilter f;
+    Sent sent = { 0 };
+    int64_t east = 0, north = 0, fe, fn;
+    uint32_t t, turn = 0, sentBefore = 0;
+
+    fixFilterDefaultConfig(&cfg);
+    fixFilterInit(&f, &cfg);
+
+    /* 10 m/s east for a minute, then north: GGA and RMC every second */
+    for (t = 0; t < 90; ++t) {
+
+        uint16_t course = t < 60 ? 9000 : 0;
+        FixMeasurement m;
+        FixFilterVerdict verdict;
+
+        if (t < 60)
+            east = 1000 * (int64_t)t;
+        else
+            north = 1000 * (int64_t)(t - 59);
+
+        m = gga(t * 1000, east + noiseCm(), north + noiseCm());
+        verdict = fixFilterUpdate(&f, &m);
+        CHECK(verdict != FIX_FILTER_OUTLIER && verdict != FIX_FILTER_DUPLICATE);
+        follow(&f, verdict, &sent);
+
+        m = rmc(t * 1000, east, north, 1000, course);
+        CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_DUPLICATE);
+
+        if (t == 59)
+            sentBefore = f.sent;
+        if (t >= 60 && !turn && f.sent > sentBefore)
+            turn = t;
+    }
+
+    /* Straight on, the velocity carries the track: a fix every maxSilenceS after settling */
+    CHECK(sentBefore <= 6);
+    CHECK(turn >= 60 && turn <= 63);
+    CHECK(f.outliers == 0 && f.restarts == 1);
+
+    filtered(&f, &fe, &fn);
+    CHECK(distance2(east, north, fe, fn) < 300 * 300);
+    CHECK(f.north.vel > 900 && f.north.vel < 1100 && f.east.vel > -100 && f.east.vel < 100);
+}
+
+static void testGaps(void) {
+
+    FixFilterConfig cfg;
+    FixFilter f;
+    FixMeasurement m;
+
+    fixFilterDefaultConfig(&cfg);
+    fixFilterInit(&f, &cfg);
+
+    /* Midnight is one second like any other */
+    m = gga(DAY_MS - 2000, 0, 0);
+    CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_SEND);
+    m = gga(DAY_MS - 1000, 100, 0);
+    CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_SUPPRESS);
+    m = gga(0, 200, 0);
+    CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_SUPPRESS);
+    CHECK(f.restarts == 1);
+
+    /* A longer gap than FIX_FILTER_MAX_GAP_MS starts over, wherever the fix is */
+    m = gga(FIX_FILTER_MAX_GAP_MS + 1, 900000, 0);
+    CHECK(fixFilterUpdate(&f, &m) == FIX_FILTER_SEND);
+    CHECK(f.restarts == 2 && f.outliers == 0);
+}
+
+int main(void) {
+
+    geoPlaneInit(&plane, ORIGIN_LAT_E7, ORIGIN_LON_E7);
+
+    testParked();
+    testDriving();
+    testGaps();
+
+    return checkReport();
+}
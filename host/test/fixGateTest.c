@@ -0,0 +1,127 @@
+//
+//  fixGateTest.c
+//  Tests of the fix quality gate (fixGate.c)
+//
+//  Each threshold rejects a fix just past it and passes one right on it, in the order the
+//  verdicts are listed; unknown DOPs and fix modes and zero thresholds are not checked.
+//  A failing fix is let through once nothing has passed for maxSilenceS, across midnight
+//  too, but never one without a fix.
+//
+
+#include <stdio.h>
+
+#include "check.h"
+#include "fixGate.h"
+
+#define DAY_MS  86400000UL
+
+/* A fix right on the default thresholds */
+static FixQuality marginal(void) {
+
+    FixQuality q = { 1, 5, 3, 250, 400, 900 };
+
+    return q;
+}
+
+static void testThresholds(void) {
+
+    FixGateConfig cfg;
+    FixQuality q;
+
+    fixGateDefaultConfig(&cfg);
+    q = marginal();
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_PASS);
+
+    /* One step past each threshold */
+    q.quality = 0;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_NO_FIX);
+    q = marginal();
+    q.satellites = 4;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_SATELLITES);
+    q = marginal();
+    q.fixMode = 2;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_FIX_MODE);
+    q = marginal();
+    q.hdop = 251;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_HDOP);
+    q = marginal();
+    q.pdop = 401;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_PDOP);
+    q = marginal();
+    cfg.maxVdop = 899;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_VDOP);
+
+    /* The first failing threshold is the verdict */
+    q = (FixQuality){ 1, 3, 2, 999, 999, 999 };
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_SATELLITES);
+    q.satellites = 5;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_FIX_MODE);
+    q.fixMode = 3;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_HDOP);
+
+    /* Unknown DOPs and fix mode are not held against a fix */
+    q = (FixQuality){ 2, 5, 0, FIX_GATE_NO_DOP, FIX_GATE_NO_DOP, FIX_GATE_NO_DOP };
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_PASS);
+
+    /* Zero thresholds are not checked */
+    q = (FixQuality){ 1, 0, 1, 9999, 9999, 9999 };
+    cfg.minSatellites = 0;
+    cfg.minFixMode = 0;
+    cfg.maxHdop = cfg.maxPdop = cfg.maxVdop = 0;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_PASS);
+
+    /* Estimated fixes only if asked for, quality 0 never */
+    q.quality = 6;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_NO_FIX);
+    cfg.acceptEstimated = 1;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_PASS);
+    q.quality = 0;
+    CHECK(fixGateJudge(&cfg, &q) == FIX_GATE_NO_FIX);
+}
+
+static void testSilence(void) {
+
+    FixGateConfig cfg;
+    FixGate gate;
+    FixQuality good = marginal(), poor = marginal(), none = marginal();
+    uint32_t start = DAY_MS - 100000, t;
+
+    poor.hdop = 900;
+    none.quality = 0;
+    fixGateDefaultConfig(&cfg);
+    fixGateInit(&gate, &cfg);
+
+    /* Poor fixes from the start, across midnight: the first one through after maxSilenceS */
+    for (t = 0; t < cfg.maxSilenceS; ++t)
+        CHECK(!fixGateCheck(&gate, &poor, (start + t * 1000) % DAY_MS));
+    CHECK(fixGateCheck(&gate, &poor, (start + t * 1000) % DAY_MS));
+    CHECK(gate.forced == 1 && gate.passed == 0 && gate.rejected[FIX_GATE_HDOP] == cfg.maxSilenceS + 1u);
+
+    /* A good fix restarts the count like a forced one */
+    start += t * 1000;
+    CHECK(!fixGateCheck(&gate, &poor, (start + 1000) % DAY_MS));
+    CHECK(fixGateCheck(&gate, &good, (start + 2000) % DAY_MS));
+    CHECK(!fixGateCheck(&gate, &poor, (start + 2000 + cfg.maxSilenceS * 1000UL - 1) % DAY_MS));
+    CHECK(fixGateCheck(&gate, &poor, (start + 2000 + cfg.maxSilenceS * 1000UL) % DAY_MS));
+
+    /* Without a fix there is nothing to force through */
+    start += 2000 + cfg.maxSilenceS * 1000UL;
+    CHECK(!fixGateCheck(&gate, &none, (start + 10 * cfg.maxSilenceS * 1000UL) % DAY_MS));
+    CHECK(gate.forced == 2 && gate.passed == 1 && gate.rejected[FIX_GATE_NO_FIX] == 1);
+    CHECK(gate.checked == cfg.maxSilenceS + 6u);
+
+    /* maxSilenceS 0: never forced */
+    cfg.maxSilenceS = 0;
+    fixGateInit(&gate, &cfg);
+    CHECK(!fixGateCheck(&gate, &poor, 0));
+    CHECK(!fixGateCheck(&gate, &poor, DAY_MS / 2));
+    CHECK(gate.forced == 0);
+}
+
+int main(void) {
+
+    testThresholds();
+    testSilence();
+
+    return checkReport();
+}
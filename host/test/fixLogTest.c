@@ -0,0 +1,265 @@
+//
+//  fixLogTest.c
+//  Tests of the store-and-forward log (fixLog.c) on a RAM flash
+//
+//  The flash is 4 sectors of 256 bytes with 64 byte pages: 15 records a sector, 4 a page.
+//  Power fails in the middle of a page program and between a sector erase and its header;
+//  the log mounts again after both. The ring wraps past its oldest sector, whole and
+//  partly consumed, and records come back from peek until they are consumed, across
+//  mounts too. No program ever sets a bit the flash has cleared.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "fixLog.h"
+
+#define SECTOR_SIZE         256
+#define NUM_SECTORS         4
+#define PAGE_SIZE           64
+#define FLASH_SIZE          (NUM_SECTORS * SECTOR_SIZE)
+#define RECORDS_PER_SECTOR  (SECTOR_SIZE / FIXLOG_SLOT_SIZE - 1)
+#define RING_RECORDS        (NUM_SECTORS * RECORDS_PER_SECTOR)
+
+typedef struct {
+    uint8_t  bytes[FLASH_SIZE];
+    int32_t  tearAfter;         // bytes programmed before the power fails, -1 never
+    uint32_t violations;        // programs that tried to turn a 0 bit back into 1
+} RamFlash;
+
+static RamFlash ram;
+
+static uint8_t ramRead(void * ctx, uint32_t offset, void * buf, uint32_t length) {
+
+    RamFlash * f = ctx;
+
+    if (offset > FLASH_SIZE || length > FLASH_SIZE - offset)
+        return 1;
+
+    memcpy(buf, f->bytes + offset, length);
+    return 0;
+}
+
+/* Programming only clears bits, and stops where the power fails */
+static uint8_t ramWrite(void * ctx, uint32_t offset, const void * buf, uint32_t length) {
+
+    RamFlash * f = ctx;
+    const uint8_t * b = buf;
+    uint32_t i;
+
+    if (offset > FLASH_SIZE || length > FLASH_SIZE - offset)
+        return 1;
+
+    for (i = 0; i < length; ++i) {
+        if (f->tearAfter == 0)
+            return 1;
+        if (f->tearAfter > 0)
+            --f->tearAfter;
+        if (b[i] & ~f->bytes[offset + i])
+            ++f->violations;
+        f->bytes[offset + i] &= b[i];
+    }
+    return 0;
+}
+
+static uint8_t ramErase(void * ctx, uint32_t offset, uint32_t length) {
+
+    RamFlash * f = ctx;
+
+    if (offset % SECTOR_SIZE || length % SECTOR_SIZE || offset > FLASH_SIZE || length > FLASH_SIZE - offset)
+        return 1;
+
+    memset(f->bytes + offset, 0xFF, length);
+    return 0;
+}
+
+static const FixLogFlash flash = { &ram, FLASH_SIZE, SECTOR_SIZE, PAGE_SIZE, ramRead, ramWrite, ramErase };
+
+static void blankFlash(void) {
+
+    memset(ram.bytes, 0xFF, sizeof(ram.bytes));
+    ram.tearAfter = -1;
+    ram.violations = 0;
+}
+
+/* Record i, told apart by every field */
+static FixRecord record(uint32_t i) {
+
+    FixRecord rec;
+
+    rec.timeMs = i * 1000;
+    rec.latE7  = 455000000 + (int32_t)i;
+    rec.lonE7  = -735000000 - (int32_t)i;
+    rec.altM   = (int16_t)(40 + i);
+    return rec;
+}
+
+static uint8_t isRecord(const FixRecord * rec, uint32_t i) {
+
+    FixRecord want = record(i);
+
+    return rec->timeMs == want.timeMs && rec->latE7 == want.latE7 && rec->lonE7 == want.lonE7 &&
+           rec->altM == want.altM;
+}
+
+static void appendRange(FixLog * log, uint32_t first, uint32_t last) {
+
+    uint32_t i;
+
+    for (i = first; i <= last; ++i) {
+        FixRecord rec = record(i);
+        CHECK(fixLogAppend(log, &rec) == 0);
+    }
+}
+
+/* Every record the log holds is first..last in order */
+static void checkRange(FixLog * log, uint32_t first, uint32_t last) {
+
+    FixRecord recs[RING_RECORDS];
+    uint32_t i;
+
+    CHECK(log->count == last - first + 1);
+    CHECK(fixLogPeek(log, recs, RING_RECORDS) == last - first + 1);
+    for (i = first; i <= last; ++i)
+        CHECK(isRecord(&recs[i - first], i));
+}
+
+static void testTorn(void) {
+
+    FixLog log;
+    FixRecord recs[RING_RECORDS], rec;
+    uint32_t i;
+
+    blankFlash();
+    CHECK(fixLogMount(&log, &flash) == 0);
+    CHECK(log.count == 0 && log.headSector == 0 && log.headSlot == 1);
+
+    /* Records 4 to 7 fill the second page, the power fails 24 bytes into it: record 4 is
+     * whole, record 5 has its state and CRC and part of its fix */
+    appendRange(&log, 1, 3);
+    ram.tearAfter = 24;
+    appendRange(&log, 4, 6);
+    rec = record(7);
+    CHECK(fixLogAppend(&log, &rec) == 1);
+
+    ram.tearAfter = -1;
+    CHECK(fixLogMount(&log, &flash) == 0);
+    CHECK(log.count == 5);
+    CHECK(log.headSector == 0 && log.headSlot == 6);
+    CHECK(log.tailSector == 0 && log.tailSlot == 1);
+
+    /* The torn record keeps its place as an all zero fix */
+    CHECK(fixLogPeek(&log, recs, RING_RECORDS) == 5);
+    for (i = 1; i <= 4; ++i)
+        CHECK(isRecord(&recs[i - 1], i));
+    CHECK(recs[4].timeMs == 0 && recs[4].latE7 == 0 && recs[4].lonE7 == 0 && recs[4].altM == 0);
+
+    /* Appending goes on after it, up to a full sector */
+    appendRange(&log, 8, 17);
+    CHECK(log.count == RECORDS_PER_SECTOR);
+
+    /* The power fails after the next sector is erased, before its header is written */
+    ram.tearAfter = 0;
+    rec = record(18);
+    CHECK(fixLogAppend(&log, &rec) == 1);
+
+    ram.tearAfter = -1;
+    CHECK(fixLogMount(&log, &flash) == 0);
+    CHECK(log.count == RECORDS_PER_SECTOR);
+    CHECK(log.headSector == 0 && log.headSlot == RECORDS_PER_SECTOR + 1);
+
+    rec = record(19);
+    CHECK(fixLogAppend(&log, &rec) == 0);
+    CHECK(log.headSector == 1 && log.headLap == 2);
+    CHECK(log.count == RECORDS_PER_SECTOR + 1);
+    CHECK(fixLogPeek(&log, recs, RING_RECORDS) == RECORDS_PER_SECTOR + 1);
+    CHECK(isRecord(&recs[5], 8) && isRecord(&recs[14], 17) && isRecord(&recs[15], 19));
+
+    CHECK(ram.violations == 0);
+}
+
+static void testWrap(void) {
+
+    FixLog log;
+
+    blankFlash();
+    CHECK(fixLogMount(&log, &flash) == 0);
+
+    appendRange(&log, 1, RING_RECORDS);
+    CHECK(log.count == RING_RECORDS && log.dropped == 0);
+    CHECK(log.erases == NUM_SECTORS);
+
+    /* With 5 of the oldest sector consumed, the next record drops its other 10 */
+    CHECK(fixLogConsume(&log, 5) == 0);
+    appendRange(&log, RING_RECORDS + 1, RING_RECORDS + 1);
+    CHECK(log.dropped == RECORDS_PER_SECTOR - 5);
+    CHECK(log.headSector == 0 && log.tailSector == 1 && log.tailSlot == 1);
+    checkRange(&log, RECORDS_PER_SECTOR + 1, RING_RECORDS + 1);
+
+    /* Two more whole sectors go */
+    appendRange(&log, RING_RECORDS + 2, 100);
+    CHECK(log.dropped == 3 * RECORDS_PER_SECTOR - 5);
+    CHECK(log.erases == NUM_SECTORS + 3);
+    CHECK(log.headSector == 2 && log.tailSector == 3);
+    checkRange(&log, 46, 100);
+
+    /* The sector of the latest lap is the head, the ring is walked from the one after it */
+    CHECK(fixLogMount(&log, &flash) == 0);
+    CHECK(log.headSector == 2 && log.headSlot == 11 && log.headLap == NUM_SECTORS + 3);
+    CHECK(log.tailSector == 3 && log.tailSlot == 1);
+    checkRange(&log, 46, 100);
+
+    CHECK(ram.violations == 0);
+}
+
+static void testConsumeReplay(void) {
+
+    FixLog log;
+    FixRecord recs[RING_RECORDS], rec;
+
+    blankFlash();
+    CHECK(fixLogMount(&log, &flash) == 0);
+    appendRange(&log, 1, 10);
+
+    /* Peeking consumes nothing: without an ACK the same batch goes out again. Records
+     * still in the page buffer are programmed first. */
+    CHECK(fixLogPeek(&log, recs, 4) == 4);
+    CHECK(isRecord(&recs[0], 1) && isRecord(&recs[3], 4));
+    CHECK(log.pageFlushed == log.pageFill);
+    CHECK(fixLogPeek(&log, recs, 4) == 4);
+    CHECK(isRecord(&recs[0], 1) && isRecord(&recs[3], 4));
+    CHECK(log.count == 10);
+
+    CHECK(fixLogConsume(&log, 4) == 0);
+    checkRange(&log, 5, 10);
+
+    /* The consumed marks are on the flash */
+    CHECK(fixLogMount(&log, &flash) == 0);
+    CHECK(log.tailSector == 0 && log.tailSlot == 5);
+    checkRange(&log, 5, 10);
+
+    /* Consuming more than there is stops at the head */
+    CHECK(fixLogConsume(&log, 20) == 0);
+    CHECK(log.count == 0);
+    CHECK(fixLogPeek(&log, recs, RING_RECORDS) == 0);
+
+    CHECK(fixLogMount(&log, &flash) == 0);
+    CHECK(log.count == 0);
+    CHECK(log.tailSector == log.headSector && log.tailSlot == log.headSlot && log.headSlot == 11);
+
+    rec = record(11);
+    CHECK(fixLogAppend(&log, &rec) == 0);
+    checkRange(&log, 11, 11);
+
+    CHECK(ram.violations == 0);
+}
+
+int main(void) {
+
+    testTorn();
+    testWrap();
+    testConsumeReplay();
+
+    return checkReport();
+}
@@ -0,0 +1,335 @@
+//
+//  geoFenceTest.c
+//  Tests of the geofences (geoFence.c): shapes, grid index and events
+//
+//  Circles and polygons, a concave one among them, contain what they should. Over a few
+//  thousand points the grid index finds exactly the fences a test of every fence finds,
+//  with far fewer box tests, and refuses an entries buffer that is too small. A fence is
+//  entered and left after confirmFixes fixes in a row, a fix wandering across the edge
+//  raises nothing, a dwell comes once, heartbeats fill the silence, and no more than
+//  GEOFENCE_MAX_INSIDE fences are followed.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "geoFence.h"
+#include "geoPlane.h"
+
+#define ORIGIN_LAT_E7   515000000
+#define ORIGIN_LON_E7   -1200000
+#define NUM_FENCES      60
+#define NUM_POINTS      4000
+#define MAX_ENTRIES     (NUM_FENCES * GEOFENCE_GRID * GEOFENCE_GRID)
+
+static GeoPlane plane;
+static GeoFence fences[NUM_FENCES];
+static GeoPoint vertices[NUM_FENCES * 6];
+static GeoFenceBox boxes[NUM_FENCES];
+static uint16_t entries[MAX_ENTRIES];
+static uint32_t seed = 1;
+
+static uint32_t nextRandom(void) {
+
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static GeoPoint pointAt(int64_t east, int64_t north) {
+
+    GeoPoint p;
+
+    geoUnproject(&plane, east, north, &p.latE7, &p.lonE7);
+    return p;
+}
+
+static FixRecord fixAt(uint32_t timeS, int64_t east, int64_t north) {
+
+    GeoPoint p = pointAt(east, north);
+    FixRecord fix;
+
+    fix.timeMs = timeS * 1000;
+    fix.latE7 = p.latE7;
+    fix.lonE7 = p.lonE7;
+    fix.altM = 0;
+    return fix;
+}
+
+/* Fence i: a circle, a triangle, a square or an L, somewhere in a 20 km square */
+static void addFence(GeoFenceSet * set, uint32_t * numVertices) {
+
+    uint16_t i = set->numFences++;
+    int64_t east = (int64_t)(nextRandom() % 2000000) - 1000000;
+    int64_t north = (int64_t)(nextRandom() % 2000000) - 1000000;
+    int64_t size = 5000 + nextRandom() % 200000;
+    GeoPoint * v = &vertices[*numVertices];
+
+    fences[i].id = (uint16_t)(1000 + i);
+    fences[i].first = *numVertices;
+    fences[i].shape = GEOFENCE_POLYGON;
+    fences[i].radiusCm = 0;
+
+    switch (i % 4) {
+    case 0:
+        fences[i].shape = GEOFENCE_CIRCLE;
+        fences[i].numVertices = 0;
+        fences[i].radiusCm = (uint32_t)size;
+        v[0] = pointAt(east, north);
+        *numVertices += 1;
+        break;
+    case 1:
+        fences[i].numVertices = 3;
+        v[0] = pointAt(east, north);
+        v[1] = pointAt(east + size, north + size / 3);
+        v[2] = pointAt(east + size / 4, north + size);
+        *numVertices += 3;
+        break;
+    case 2:
+        fences[i].numVertices = 4;
+        v[0] = pointAt(east, north);
+        v[1] = pointAt(east, north + size);
+        v[2] = pointAt(east + size, north + size);
+        v[3] = pointAt(east + size, north);
+        *numVertices += 4;
+        break;
+    default:
+        fences[i].numVertices = 6;
+        v[0] = pointAt(east, north);
+        v[1] = pointAt(east + size, north);
+        v[2] = pointAt(east + size, north + size / 2);
+        v[3] = pointAt(east + size / 2, north + size / 2);
+        v[4] = pointAt(east + size / 2, north + size);
+        v[5] = pointAt(east, north + size);
+        *numVertices += 6;
+        break;
+    }
+}
+
+static uint8_t contains(const GeoFenceSet * set, uint16_t index, int64_t east, int64_t north) {
+
+    GeoPoint p = pointAt(east, north);
+
+    return geoFenceContains(set, index, p.latE7, p.lonE7);
+}
+
+static void testShapes(void) {
+
+    GeoFenceSet set = { fences, 2, vertices };
+
+    /* An L 1 km across, its notch to the north east, and a circle of 100 m */
+    fences[0] = (GeoFence){ 1, GEOFENCE_POLYGON, 6, 0, 0 };
+    fences[1] = (GeoFence){ 2, GEOFENCE_CIRCLE, 0, 6, 10000 };
+    vertices[0] = pointAt(0, 0);
+    vertices[1] = pointAt(100000, 0);
+    vertices[2] = pointAt(100000, 50000);
+    vertices[3] = pointAt(50000, 50000);
+    vertices[4] = pointAt(50000, 100000);
+    vertices[5] = pointAt(0, 100000);
+    vertices[6] = pointAt(-200000, 0);
+
+    CHECK(contains(&set, 0, 25000, 75000) && contains(&set, 0, 75000, 25000));
+    CHECK(!contains(&set, 0, 75000, 75000) && !contains(&set, 0, 51000, 51000));
+    CHECK(!contains(&set, 0, -100, 50000) && !contains(&set, 0, 50000, 100100));
+
+    CHECK(contains(&set, 1, -200000, 9900) && contains(&set, 1, -207000, -7000));
+    CHECK(!contains(&set, 1, -208000, -8000) && !contains(&set, 1, -189900, 0));
+}
+
+static void testIndex(void) {
+
+    GeoFenceSet set = { fences, 0, vertices };
+    GeoFenceConfig cfg;
+    GeoFencer g;
+    uint32_t numVertices = 0, size, tests = 0;
+    uint16_t found[NUM_FENCES], expect[NUM_FENCES];
+    uint16_t p, i;
+    uint8_t n, m;
+
+    geoFenceDefaultConfig(&cfg);
+
+    /* No fences: nothing to index, nothing found */
+    CHECK(geoFenceIndexSize(&set) == 0);
+    CHECK(geoFenceInit(&g, &cfg, &set, boxes, entries, 0) == 0);
+    CHECK(geoFenceLookup(&g, ORIGIN_LAT_E7, ORIGIN_LON_E7, found, NUM_FENCES) == 0);
+
+    seed = 7;
+    while (set.numFences < NUM_FENCES)
+        addFence(&set, &numVertices);
+
+    size = geoFenceIndexSize(&set);
+    CHECK(size >= NUM_FENCES && size <= MAX_ENTRIES);
+    CHECK(geoFenceInit(&g, &cfg, &set, boxes, entries, size - 1) == 1);
+    CHECK(geoFenceInit(&g, &cfg, &set, boxes, entries, size) == 0);
+
+    /* The index finds what testing every fence finds, in the same order */
+    for (p = 0; p < NUM_POINTS; ++p) {
+
+        GeoPoint point = pointAt((int64_t)(nextRandom() % 2600000) - 1300000,
+                                 (int64_t)(nextRandom() % 2600000) - 1300000);
+
+        m = 0;
+        for (i = 0; i < NUM_FENCES; ++i)
+            if (geoFenceContains(&set, i, point.latE7, point.lonE7))
+                expect[m++] = i;
+        tests += NUM_FENCES;
+
+        n = geoFenceLookup(&g, point.latE7, point.lonE7, found, NUM_FENCES);
+        CHECK(n == m && memcmp(found, expect, m * sizeof(found[0])) == 0);
+
+        /* max caps the answer */
+        if (m > 1)
+            CHECK(geoFenceLookup(&g, point.latE7, point.lonE7, found, 1) == 1 && found[0] == expect[0]);
+    }
+    CHECK(g.boxTests * 4 < tests);
+}
+
+static void testEvents(void) {
+
+    GeoFenceSet set = { fences, 2, vertices };
+    GeoFenceEvent events[GEOFENCE_MAX_EVENTS];
+    GeoFenceConfig cfg;
+    GeoFencer g;
+    FixRecord fix;
+    uint32_t t;
+    uint8_t n;
+
+    /* A circle of 100 m at the origin, a square of 100 m north east of it, overlapping */
+    fences[0] = (GeoFence){ 11, GEOFENCE_CIRCLE, 0, 0, 10000 };
+    fences[1] = (GeoFence){ 12, GEOFENCE_POLYGON, 4, 1, 0 };
+    vertices[0] = pointAt(0, 0);
+    vertices[1] = pointAt(5000, 5000);
+    vertices[2] = pointAt(5000, 15000);
+    vertices[3] = pointAt(15000, 15000);
+    vertices[4] = pointAt(15000, 5000);
+
+    geoFenceDefaultConfig(&cfg);
+    CHECK(geoFenceInit(&g, &cfg, &set, boxes, entries, MAX_ENTRIES) == 0);
+
+    /* Nothing reported yet: a heartbeat */
+    fix = fixAt(0, -50000, 0);
+    CHECK(geoFenceCheck(&g, &fix, events) == 1);
+    CHECK(events[0].type == GEOFENCE_HEARTBEAT && events[0].fenceId == GEOFENCE_NO_FENCE);
+    fix = fixAt(1, -50000, 0);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+
+    /* Across the edge and back: nothing */
+    fix = fixAt(2, -9000, 0);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    fix = fixAt(3, -11000, 0);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    CHECK(g.numMembers == 0);
+
+    /* Two fixes in a row inside: entered */
+    fix = fixAt(4, -9000, 0);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    fix = fixAt(5, -8000, 0);
+    CHECK(geoFenceCheck(&g, &fix, events) == 1);
+    CHECK(events[0].type == GEOFENCE_ENTER && events[0].fenceId == 11);
+
+    /* Into the overlap, out again for one fix, back: entered the square, still in the circle */
+    fix = fixAt(6, 7000, 7000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    fix = fixAt(7, 7000, 7000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 1);
+    CHECK(events[0].type == GEOFENCE_ENTER && events[0].fenceId == 12);
+    fix = fixAt(8, 20000, 20000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    fix = fixAt(9, 7000, 7000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+
+    /* Dwell, once per fence, counted from each enter */
+    for (t = 10; t < 5u + cfg.dwellS; ++t) {
+        fix = fixAt(t, 7000, 7000);
+        CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    }
+    fix = fixAt(5 + cfg.dwellS, 7000, 7000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 1);
+    CHECK(events[0].type == GEOFENCE_DWELL && events[0].fenceId == 11);
+    fix = fixAt(6 + cfg.dwellS, 7000, 7000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    fix = fixAt(7 + cfg.dwellS, 7000, 7000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 1);
+    CHECK(events[0].type == GEOFENCE_DWELL && events[0].fenceId == 12);
+
+    /* Quiet until the heartbeat is due */
+    for (t = 8 + cfg.dwellS; t < 7u + cfg.dwellS + cfg.heartbeatS; t += 10) {
+        fix = fixAt(t, 7000, 7000);
+        CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    }
+    fix = fixAt(7 + cfg.dwellS + cfg.heartbeatS, 7000, 7000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 1 && events[0].type == GEOFENCE_HEARTBEAT);
+
+    /* Out of both: two exits on the second fix outside */
+    t = 8 + cfg.dwellS + cfg.heartbeatS;
+    fix = fixAt(t, 50000, 50000);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+    fix = fixAt(t + 1, 50000, 50000);
+    n = geoFenceCheck(&g, &fix, events);
+    CHECK(n == 2 && events[0].type == GEOFENCE_EXIT && events[1].type == GEOFENCE_EXIT);
+    CHECK(events[0].fenceId + events[1].fenceId == 11 + 12);
+    CHECK(g.numMembers == 0 && g.events == 8);
+}
+
+static void testManyFences(void) {
+
+    GeoFenceSet set = { fences, GEOFENCE_MAX_INSIDE + 2, vertices };
+    GeoFenceEvent events[GEOFENCE_MAX_EVENTS];
+    uint8_t bytes[GEOFENCE_EVENT_WIRE_LENGTH];
+    GeoFenceEvent decoded;
+    uint16_t found[GEOFENCE_MAX_INSIDE + 2];
+    GeoFenceConfig cfg;
+    GeoFencer g;
+    FixRecord fix;
+    uint8_t n, i;
+
+    /* Circles around one centre, entered at once with confirmFixes 1 */
+    vertices[0] = pointAt(0, 0);
+    for (i = 0; i < set.numFences; ++i)
+        fences[i] = (GeoFence){ (uint16_t)(0x0100 + i), GEOFENCE_CIRCLE, 0, 0, 1000 + 1000UL * i };
+
+    geoFenceDefaultConfig(&cfg);
+    cfg.confirmFixes = 1;
+    cfg.heartbeatS = 0;
+    CHECK(geoFenceInit(&g, &cfg, &set, boxes, entries, MAX_ENTRIES) == 0);
+    CHECK(geoFenceLookup(&g, vertices[0].latE7, vertices[0].lonE7, found, sizeof(found) / sizeof(found[0]))
+          == GEOFENCE_MAX_INSIDE + 2);
+
+    fix = fixAt(0, 0, 0);
+    n = geoFenceCheck(&g, &fix, events);
+    CHECK(n == GEOFENCE_MAX_INSIDE && g.numMembers == GEOFENCE_MAX_INSIDE);
+    for (i = 0; i < n; ++i)
+        CHECK(events[i].type == GEOFENCE_ENTER);
+
+    /* Leaving the small ones frees slots for the others */
+    fix = fixAt(1, 8500, 0);
+    n = geoFenceCheck(&g, &fix, events);
+    CHECK(n == 8 + 2 && g.numMembers == 2);
+    for (i = 0; i < 8; ++i)
+        CHECK(events[i].type == GEOFENCE_EXIT);
+    CHECK(events[8].type == GEOFENCE_ENTER && events[9].type == GEOFENCE_ENTER);
+
+    /* Nothing to report and no heartbeat */
+    fix = fixAt(2, 8500, 0);
+    CHECK(geoFenceCheck(&g, &fix, events) == 0);
+
+    /* Wire format */
+    events[0].fenceId = 0x1234;
+    events[0].type = GEOFENCE_DWELL;
+    geoFenceEventEncode(&events[0], bytes);
+    CHECK(bytes[0] == 0x12 && bytes[1] == 0x34 && bytes[2] == GEOFENCE_DWELL);
+    geoFenceEventDecode(&decoded, bytes);
+    CHECK(decoded.fenceId == 0x1234 && decoded.type == GEOFENCE_DWELL);
+}
+
+int main(void) {
+
+    geoPlaneInit(&plane, ORIGIN_LAT_E7, ORIGIN_LON_E7);
+
+    testShapes();
+    testIndex();
+    testEvents();
+    testManyFences();
+
+    return checkReport();
+}
@@ -0,0 +1,240 @@
+//
+//  gnssBaudTest.c
+//  Tests of the boot time receiver configuration (gnssBaud.c) against the simulated
+//  u-blox module of gnssModuleSim.c
+//
+//  A factory module at 4800 baud sends RMC, VTG, GGA, GSA, 2 GSV and GLL, about 430 bytes,
+//  most of a second. The fix of an epoch is complete with its GGA, so its latency (from
+//  the top of the second to the byte that completes it at the tracker) is printed before
+//  and after the module is moved to 38400 baud with only what each backend decodes. Then:
+//  a module that kept its configuration, one at another rate, one that ignores the
+//  commands and one that sends nothing.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "gnssBaud.h"
+#include "gnssInput.h"
+#include "gnssModuleSim.h"
+
+#define MEASURE_S       120
+#define SEED            0x6A55
+
+typedef struct {
+    SimGnssModule module;
+    uint32_t      baud;         // of the tracker's UART
+} Link;
+
+typedef struct {
+    uint32_t fixes;
+    double   meanMs;
+    double   maxMs;
+} Latency;
+
+static uint32_t linkNowMs(void * ctx) {
+
+    return (uint32_t)(((Link *)ctx)->module.nowUs / 1000);
+}
+
+static void linkSetBaud(void * ctx, uint32_t baud) {
+
+    ((Link *)ctx)->baud = baud;
+}
+
+static void linkWrite(void * ctx, const uint8_t * data, uint16_t length) {
+
+    Link * l = ctx;
+    simGnssWrite(&l->module, l->baud, data, length);
+}
+
+static uint16_t linkRead(void * ctx, uint8_t * buf, uint16_t max, uint16_t timeoutMs) {
+
+    Link * l = ctx;
+    return simGnssRead(&l->module, l->baud, buf, max, (uint32_t)timeoutMs * 1000);
+}
+
+static void linkInit(Link * l, GnssUart * uart, uint32_t moduleBaud) {
+
+    simGnssInit(&l->module, moduleBaud, SEED);
+    l->baud = 4800;
+
+    uart->nowMs   = linkNowMs;
+    uart->setBaud = linkSetBaud;
+    uart->write   = linkWrite;
+    uart->read    = linkRead;
+    uart->ctx     = l;
+}
+
+/* Reads byte by byte, as the tracker does, for seconds */
+static void measure(Link * l, const GnssBackend * backend, uint32_t seconds, Latency * lat) {
+
+    static GnssInput in;
+    EpochFix fixes[GNSS_INPUT_MAX_FIXES];
+    uint64_t end = l->module.nowUs + (uint64_t)seconds * 1000000;
+    uint8_t byte, i, n;
+    double sumMs = 0;
+
+    memset(lat, 0, sizeof(*lat));
+    gnssInputInit(&in, backend);
+    while (l->module.nowUs < end) {
+        if (simGnssRead(&l->module, l->baud, &byte, 1, 100000) == 0)
+            continue;
+        n = gnssInputPush(&in, byte, (uint32_t)(l->module.nowUs / 1000), fixes);
+        for (i = 0; i < n; ++i) {
+            double ms = (l->module.nowUs - simGnssEpochUs(&l->module, fixes[i].fix.timeMs)) / 1000.0;
+            sumMs += ms;
+            if (ms > lat->maxMs)
+                lat->maxMs = ms;
+            ++lat->fixes;
+        }
+    }
+    if (lat->fixes)
+        lat->meanMs = sumMs / lat->fixes;
+}
+
+static void printLatency(const char * what, const Latency * lat) {
+
+    printf("%-28s %3u fixes/%us  latency mean %5.1f ms  max %5.1f ms\n", what, (unsigned)lat->fixes,
+           MEASURE_S, lat->meanMs, lat->maxMs);
+}
+
+static void testFactory(const GnssBackend * backend) {
+
+    static GnssInput in;
+    static GnssBaud b;
+    GnssBaudConfig config;
+    GnssUart uart;
+    Link link;
+    Latency before, after;
+    char what[40];
+
+    linkInit(&link, &uart, 4800);
+    gnssInputInit(&in, backend);
+    gnssBaudDefaultConfig(&config);
+
+    measure(&link, &gnssNmeaBackend, MEASURE_S, &before);
+    CHECK(before.fixes >= MEASURE_S - 1);
+    CHECK(link.module.dropped == 0);
+
+    CHECK(gnssBaudNegotiate(&b, &config, &uart, &in) == GNSS_BAUD_CONFIGURED);
+    CHECK(b.baud == 38400 && link.baud == 38400 && link.module.baud == 38400);
+    CHECK(b.tried == 2);                // 38400, then 4800
+    CHECK(link.module.commands == b.commands);
+
+    measure(&link, backend, MEASURE_S, &after);
+    CHECK(after.fixes >= MEASURE_S - 1);
+    CHECK(after.meanMs < before.meanMs / 3);
+    CHECK(after.maxMs < before.maxMs);
+
+    if (backend->protocol == GNSS_PROTOCOL_NMEA) {
+        CHECK(link.module.nmeaOn == (SIM_GNSS_GGA | SIM_GNSS_GSA | SIM_GNSS_RMC));
+        CHECK(link.module.outProto == UBX_PROTO_NMEA);
+    }
+    else {
+        CHECK(link.module.ubxOn == (SIM_GNSS_NAV_DOP | SIM_GNSS_NAV_PVT));
+        CHECK(link.module.nmeaOn == 0);
+        CHECK(link.module.outProto == UBX_PROTO_UBX);
+    }
+
+    printLatency("4800 baud, factory NMEA", &before);
+    snprintf(what, sizeof(what), "38400 baud, %s", backend->name);
+    printLatency(what, &after);
+    printf("%-28s %u rates tried, %u commands, %u ms\n", "", b.tried, b.commands, (unsigned)b.elapsedMs);
+}
+
+/* Our reset, not the module's: it is found at once */
+static void testKeptConfiguration(void) {
+
+    static GnssInput in;
+    static GnssBaud b;
+    GnssBaudConfig config;
+    GnssUart uart;
+    Link link;
+
+    linkInit(&link, &uart, 4800);
+    gnssInputInit(&in, &gnssNmeaBackend);
+    gnssBaudDefaultConfig(&config);
+
+    CHECK(gnssBaudNegotiate(&b, &config, &uart, &in) == GNSS_BAUD_CONFIGURED);
+    link.baud = 4800;
+    CHECK(gnssBaudNegotiate(&b, &config, &uart, &in) == GNSS_BAUD_CONFIGURED);
+    CHECK(b.tried == 1);
+    CHECK(link.baud == 38400);
+    CHECK(b.elapsedMs < 2 * config.listenMs);
+}
+
+static void testOtherRate(void) {
+
+    static GnssInput in;
+    static GnssBaud b;
+    GnssBaudConfig config;
+    GnssUart uart;
+    Link link;
+
+    linkInit(&link, &uart, 9600);
+    gnssInputInit(&in, &gnssUbxBackend);
+    gnssBaudDefaultConfig(&config);
+
+    CHECK(gnssBaudNegotiate(&b, &config, &uart, &in) == GNSS_BAUD_CONFIGURED);
+    CHECK(b.tried == 3);                // 38400, 4800, 9600
+    CHECK(link.baud == 38400 && link.module.baud == 38400);
+}
+
+/* Another make of receiver: the commands go nowhere, it is left where it answers */
+static void testIgnored(void) {
+
+    static GnssInput in;
+    static GnssBaud b;
+    GnssBaudConfig config;
+    GnssUart uart;
+    Link link;
+    Latency lat;
+
+    linkInit(&link, &uart, 4800);
+    link.module.acceptsConfig = 0;
+    gnssInputInit(&in, &gnssNmeaBackend);
+    gnssBaudDefaultConfig(&config);
+
+    CHECK(gnssBaudNegotiate(&b, &config, &uart, &in) == GNSS_BAUD_UNCHANGED);
+    CHECK(b.baud == 4800 && link.baud == 4800);
+    CHECK(b.tried == 4);                // 38400, 4800, and after the commands again
+    CHECK(link.module.nmeaOn == SIM_GNSS_NMEA_DEFAULT);
+
+    measure(&link, &gnssNmeaBackend, 10, &lat);
+    CHECK(lat.fixes >= 9);
+}
+
+static void testSilent(void) {
+
+    static GnssInput in;
+    static GnssBaud b;
+    GnssBaudConfig config;
+    GnssUart uart;
+    Link link;
+
+    linkInit(&link, &uart, 4800);
+    link.module.outProto = 0;
+    link.module.acceptsConfig = 0;
+    gnssInputInit(&in, &gnssNmeaBackend);
+    gnssBaudDefaultConfig(&config);
+
+    CHECK(gnssBaudNegotiate(&b, &config, &uart, &in) == GNSS_BAUD_SILENT);
+    CHECK(b.baud == 0 && link.baud == 4800);
+    CHECK(b.tried == GNSS_BAUD_RATES);
+    CHECK(b.commands == 0);
+    CHECK(b.elapsedMs >= GNSS_BAUD_RATES * config.listenMs);
+}
+
+int main(void) {
+
+    testFactory(&gnssNmeaBackend);
+    testFactory(&gnssUbxBackend);
+    testKeptConfiguration();
+    testOtherRate();
+    testIgnored();
+    testSilent();
+
+    return checkReport();
+}
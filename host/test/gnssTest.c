@@ -0,0 +1,378 @@
+//
+//  gnssTest.c
+//  Tests of the GNSS input layer (gnssInput.c, ubxProtocol.c)
+//
+//  data/gnssDrive.ubx and data/gnssDrive.nmea are the same 40 s of a u-blox receiver: a
+//  second without time, two with time but no fix, two 2D, then a 3D drive. The UBX one is
+//  NAV-DOP and NAV-PVT after the receiver was switched over, with the tail of the last NMEA
+//  sentence ahead of it, an ACK, a NAK, a TXT sentence, a sync pattern in noise and a
+//  NAV-PVT with a flipped bit. The NMEA one is the receiver's default set (RMC, VTG, GGA,
+//  GSA, 3 GSV, GLL), with the RMC and GGA of the same second broken, a broken GSV and a
+//  GSV cut short. Both backends must give the same fixes; the bytes and the CPU time each
+//  takes per fix are printed. A NAV-PVT without the NAV-DOP of its epoch has no HDOP.
+//
+//  usage: gnssTest <data directory>
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "check.h"
+#include "fixGate.h"
+#include "gnssInput.h"
+#include "gpsParser.h"
+#include "ubxProtocol.h"
+
+#define UART_BYTE_US    260         // 10 bits at 38400 baud
+#define START_MS        ((14 * 3600 + 2 * 60 + 10) * 1000UL)
+#define DRIVE_EPOCHS    40
+#define DRIVE_FIXES     38          // no time in the first second, the 31st broken
+#define CPU_ROUNDS      200
+
+typedef struct {
+    uint8_t * data;
+    size_t    length;
+} Capture;
+
+typedef struct {
+    uint32_t count;
+    EpochFix fixes[64];
+} Fixes;
+
+static uint8_t loadCapture(const char * dir, const char * name, Capture * c) {
+
+    char path[512];
+    FILE * f;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        printf("cannot open %s\n", path);
+        ++failures;
+        return 1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    c->length = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    c->data = malloc(c->length);
+    if (c->data == NULL || fread(c->data, 1, c->length, f) != c->length) {
+        fclose(f);
+        printf("cannot read %s\n", path);
+        ++failures;
+        return 1;
+    }
+    fclose(f);
+
+    return 0;
+}
+
+/* Byte by byte, as the UART hands them over */
+static void runCapture(GnssInput * in, const GnssBackend * backend, const Capture * c, Fixes * out) {
+
+    EpochFix fixes[GNSS_INPUT_MAX_FIXES];
+    size_t i;
+    uint8_t j, n;
+
+    gnssInputInit(in, backend);
+    if (out != NULL)
+        out->count = 0;
+
+    for (i = 0; i < c->length; ++i) {
+        n = gnssInputPush(in, c->data[i], (uint32_t)(i * UART_BYTE_US / 1000), fixes);
+        for (j = 0; out != NULL && j < n; ++j) {
+            if (out->count < sizeof(out->fixes) / sizeof(out->fixes[0]))
+                out->fixes[out->count] = fixes[j];
+            ++out->count;
+        }
+    }
+}
+
+static int32_t absDiff(int32_t a, int32_t b) {
+
+    return a > b ? a - b : b - a;
+}
+
+static void testUbx(const Capture * c, Fixes * fx) {
+
+    GnssInput in;
+    const EpochFix * f;
+
+    runCapture(&in, &gnssUbxBackend, c, fx);
+
+    CHECK(in.bytes == c->length);
+    CHECK(in.frames == DRIVE_EPOCHS * 2 - 1 + 2);   // NAV-DOP, NAV-PVT, ACK, NAK
+    CHECK(in.badFrames == 2);                       // the flipped bit, the absurd length
+    CHECK(in.u.ubx.framer.oversize == 1);
+    CHECK(in.acks == 1);
+    CHECK(in.naks == 1);
+    CHECK(fx->count == DRIVE_FIXES);
+    if (fx->count != DRIVE_FIXES)
+        return;
+
+    /* 14:02:11, time but no fix */
+    f = &fx->fixes[0];
+    CHECK(f->fix.timeMs == START_MS + 1000);
+    CHECK(f->quality == 0);
+    CHECK(f->have == 0);
+    CHECK(f->hdop == 9999);
+
+    /* 14:02:13, 2D: no altitude */
+    f = &fx->fixes[2];
+    CHECK(f->fix.timeMs == START_MS + 3000);
+    CHECK(f->quality == 1);
+    CHECK(f->satellites == 4);
+    CHECK(f->have == (FIX_EPOCH_POSITION | FIX_EPOCH_MOTION));
+    CHECK(f->fix.latE7 == 455017000 && f->fix.lonE7 == -735673000);
+
+    /* 14:02:16, 3D and moving */
+    f = &fx->fixes[5];
+    CHECK(f->fix.timeMs == START_MS + 6000);
+    CHECK(f->have == (FIX_EPOCH_POSITION | FIX_EPOCH_ALTITUDE | FIX_EPOCH_MOTION));
+    CHECK(f->satellites == 11);
+    CHECK(f->hdop == 84);
+    CHECK(f->fix.latE7 == 455017110 && f->fix.lonE7 == -735671406);
+    CHECK(f->fix.altM == 41);
+    CHECK(f->speedCmS == 1260);
+    CHECK(f->courseCdeg == 8477);
+
+    /* The broken 14:02:40 is missing */
+    CHECK(fx->fixes[28].fix.timeMs == START_MS + 29000);
+    CHECK(fx->fixes[29].fix.timeMs == START_MS + 31000);
+
+    /* NAV-DOP of the last epoch */
+    CHECK(in.fixMode == 3);
+    CHECK(in.pdop == 137 && in.vdop == 112);
+}
+
+static void testNmea(const Capture * c, Fixes * fx) {
+
+    GnssInput in;
+
+    runCapture(&in, &gnssNmeaBackend, c, fx);
+
+    CHECK(in.bytes == c->length);
+    CHECK(in.frames == DRIVE_EPOCHS * 8 - 4);       // 8 sentences a second, 4 broken
+    CHECK(in.badFrames == 4);
+    CHECK(in.u.nmea.epoch.complete == DRIVE_FIXES);
+    CHECK(fx->count == DRIVE_FIXES);
+
+    /* GSA of the last epoch */
+    CHECK(in.fixMode == 3);
+    CHECK(in.pdop == 137 && in.vdop == 112);
+}
+
+/* NMEA rounds positions to 1e-5 minutes, speeds to 0.001 knots and courses to 0.01 degrees */
+static void testSameFixes(const Fixes * ubx, const Fixes * nmea) {
+
+    uint32_t i;
+
+    CHECK(ubx->count == nmea->count);
+    for (i = 0; i < ubx->count && i < nmea->count; ++i) {
+        const EpochFix * u = &ubx->fixes[i];
+        const EpochFix * n = &nmea->fixes[i];
+
+        CHECK(u->fix.timeMs == n->fix.timeMs);
+        CHECK(u->quality == n->quality);
+        CHECK(u->satellites == n->satellites);
+        CHECK(u->hdop == n->hdop);
+        CHECK((u->have & FIX_EPOCH_POSITION) == (n->have & FIX_EPOCH_POSITION));
+        if (u->have & FIX_EPOCH_POSITION) {
+            CHECK(absDiff(u->fix.latE7, n->fix.latE7) <= 2);
+            CHECK(absDiff(u->fix.lonE7, n->fix.lonE7) <= 2);
+            CHECK(absDiff(u->speedCmS, n->speedCmS) <= 1);
+            if (u->speedCmS > 0)
+                CHECK(absDiff(u->courseCdeg, n->courseCdeg) <= 1);
+        }
+        if (u->have & FIX_EPOCH_ALTITUDE)
+            CHECK(u->fix.altM == n->fix.altM);
+    }
+}
+
+/* Neither backend makes fixes out of the other's protocol */
+static void testCrossed(const Capture * ubx, const Capture * nmea) {
+
+    GnssInput in;
+    Fixes fx;
+
+    runCapture(&in, &gnssUbxBackend, nmea, &fx);
+    CHECK(fx.count == 0);
+    CHECK(in.frames == 0);
+
+    runCapture(&in, &gnssNmeaBackend, ubx, &fx);
+    CHECK(fx.count == 0);
+    CHECK(in.frames == 1);                          // the TXT
+}
+
+/* A NAV-PVT at 14:02:10 with a 3D fix, 8 satellites and PDOP 1.50 */
+static uint16_t navPvt(uint32_t iTow, uint8_t * out) {
+
+    uint8_t p[UBX_NAV_PVT_LENGTH] = { 0 };
+
+    p[0] = (uint8_t)iTow;
+    p[1] = (uint8_t)(iTow >> 8);
+    p[2] = (uint8_t)(iTow >> 16);
+    p[3] = (uint8_t)(iTow >> 24);
+    p[8] = 14;
+    p[9] = 2;
+    p[10] = 10;
+    p[11] = 0x07;                   // date, time, fully resolved
+    p[20] = 3;
+    p[21] = 0x01;                   // gnssFixOK
+    p[23] = 8;
+    p[76] = 150;
+
+    return ubxBuild(UBX_NAV, UBX_NAV_PVT, p, sizeof(p), out);
+}
+
+/* Without the NAV-DOP of its epoch, a NAV-PVT has no HDOP, and the gate does not hold that
+ * against it */
+static void testUbxNoDop(void) {
+
+    GnssInput in;
+    EpochFix fixes[FIX_EPOCH_MAX_OUT];
+    uint8_t frame[8 + UBX_NAV_PVT_LENGTH];
+    uint8_t dop[UBX_NAV_DOP_LENGTH] = { 0 };
+    uint16_t length, i;
+    uint8_t n;
+    FixGateConfig config;
+    FixQuality q;
+
+    gnssInputInit(&in, &gnssUbxBackend);
+    length = navPvt(1000, frame);
+    for (i = 0, n = 0; i < length; ++i)
+        n += gnssInputPush(&in, frame[i], i, fixes);
+    CHECK(n == 1);
+    CHECK(fixes[0].quality == 1 && fixes[0].satellites == 8);
+    CHECK(fixes[0].hdop == GNSS_NO_DOP);
+    CHECK(in.fixMode == 3 && in.pdop == 150 && in.vdop == GNSS_NO_DOP);
+
+    fixGateDefaultConfig(&config);
+    q.quality    = fixes[0].quality;
+    q.satellites = fixes[0].satellites;
+    q.fixMode    = in.fixMode;
+    q.hdop       = fixes[0].hdop;
+    q.pdop       = in.pdop;
+    q.vdop       = in.vdop;
+    CHECK(fixGateJudge(&config, &q) == FIX_GATE_PASS);
+
+    /* The NAV-DOP of another epoch is no better */
+    dop[0] = 0xE8;                  // iTOW 1000 ms
+    dop[1] = 0x03;
+    dop[12] = 0x10;                 // HDOP 100.00
+    dop[13] = 0x27;
+    length = ubxBuild(UBX_NAV, UBX_NAV_DOP, dop, sizeof(dop), frame);
+    for (i = 0, n = 0; i < length; ++i)
+        n += gnssInputPush(&in, frame[i], i, fixes);
+    CHECK(n == 0);
+    length = navPvt(2000, frame);
+    for (i = 0, n = 0; i < length; ++i)
+        n += gnssInputPush(&in, frame[i], i, fixes);
+    CHECK(n == 1);
+    CHECK(fixes[0].hdop == GNSS_NO_DOP);
+}
+
+static void testNmeaCommands(void) {
+
+    GnssInput in;
+    uint8_t out[GNSS_COMMAND_MAX + 1];
+    uint8_t step, length;
+    GPSData data;
+
+    gnssInputInit(&in, &gnssNmeaBackend);
+    for (step = 0; (length = gnssInputCommand(&in, step, 38400, out)) > 0; ++step) {
+        CHECK(length <= GNSS_COMMAND_MAX);
+        CHECK(out[length - 2] == '\r' && out[length - 1] == '\n');
+        out[length - 2] = '\0';
+        CHECK(nmeaReceiveSentence(&data, (char *)out) == 0);
+        CHECK(strncmp((char *)out, "$PUBX,4", 7) == 0);
+    }
+    CHECK(step == 4);
+    CHECK(strcmp((char *)out, "$PUBX,41,1,0003,0002,38400,0*25") == 0);
+}
+
+static void testUbxCommands(void) {
+
+    GnssInput in;
+    uint8_t out[GNSS_COMMAND_MAX];
+    uint8_t buf[4 + UBX_CFG_PRT_LENGTH];
+    uint8_t step, length, i, n;
+    UbxFramer framer;
+    UbxFrame frame;
+
+    gnssInputInit(&in, &gnssUbxBackend);
+    ubxFramerInit(&framer, buf, sizeof(buf));
+    for (step = 0; (length = gnssInputCommand(&in, step, 115200, out)) > 0; ++step) {
+        CHECK(length <= GNSS_COMMAND_MAX);
+        for (i = 0, n = 0; i < length; ++i)
+            n += ubxFramerPush(&framer, out[i], &frame);
+        CHECK(n == 1);
+        CHECK(frame.msgClass == UBX_CFG);
+        if (step < 6) {
+            CHECK(frame.id == UBX_CFG_MSG && frame.payload[0] == UBX_NMEA && frame.payload[2] == 0);
+        }
+        else if (step < 8) {
+            CHECK(frame.id == UBX_CFG_MSG && frame.payload[0] == UBX_NAV && frame.payload[2] == 1);
+        }
+        else {
+            /* Baud rate, in UBX and NMEA, out UBX */
+            CHECK(frame.id == UBX_CFG_PRT && frame.length == UBX_CFG_PRT_LENGTH);
+            CHECK(frame.payload[8] == 0x00 && frame.payload[9] == 0xC2 && frame.payload[10] == 0x01);
+            CHECK(frame.payload[12] == 0x03 && frame.payload[14] == 0x01);
+        }
+    }
+    CHECK(step == 9);
+    CHECK(framer.badChecksums == 0);
+}
+
+/* Bytes and CPU time per fix */
+static void report(const GnssBackend * backend, const Capture * c) {
+
+    GnssInput in;
+    clock_t start = clock();
+    uint32_t round;
+
+    for (round = 0; round < CPU_ROUNDS; ++round)
+        runCapture(&in, backend, c, NULL);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (in.fixes == 0)
+        return;
+    printf("%-5s %6zu bytes %3u fixes %5.0f bytes/fix %7.0f ns/fix %5.1f ns/byte\n",
+           backend->name, c->length, (unsigned)in.fixes, (double)c->length / in.fixes,
+           seconds * 1e9 / CPU_ROUNDS / in.fixes, seconds * 1e9 / CPU_ROUNDS / c->length);
+}
+
+int main(int argc, char * argv[]) {
+
+    Capture ubx, nmea;
+    static Fixes ubxFixes, nmeaFixes;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <data directory>\n", argv[0]);
+        return 2;
+    }
+
+    if (loadCapture(argv[1], "gnssDrive.ubx", &ubx) || loadCapture(argv[1], "gnssDrive.nmea", &nmea)) {
+        printf("FAILED\n");
+        return 1;
+    }
+
+    testUbx(&ubx, &ubxFixes);
+    testNmea(&nmea, &nmeaFixes);
+    testSameFixes(&ubxFixes, &nmeaFixes);
+    testCrossed(&ubx, &nmea);
+    testUbxNoDop();
+    testNmeaCommands();
+    testUbxCommands();
+
+    report(&gnssNmeaBackend, &nmea);
+    report(&gnssUbxBackend, &ubx);
+
+    free(ubx.data);
+    free(nmea.data);
+
+    return checkReport();
+}
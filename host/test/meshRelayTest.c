@@ -0,0 +1,291 @@
+//
+//  meshRelayTest.c
+//  Tests of the relays (meshRelay.c) and the RELAY frames they send
+//
+//  The dedup cache is bounded and forgets the oldest; what a relay takes comes back out of
+//  its RELAY frame byte for byte, with the hops counted up and the TTL down; frames wait
+//  for the hold and its jitter unless a RELAY frame is full; spent TTLs, frames from closer
+//  in and other frame types are not relayed; a full queue drops the oldest; and a
+//  malformed entry ends the parse.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "meshRelay.h"
+#include "packetCodec.h"
+
+#define FIX_LENGTH      (PKT_HEADER_LENGTH + 20)
+
+/* A tracker's FIX frame, its payload filled with the sequence number's low byte */
+static uint8_t trackerFrame(uint8_t * frame, uint8_t nodeId, uint16_t seq) {
+
+    PacketHeader hdr;
+
+    hdr.type   = PKT_TYPE_FIX;
+    hdr.flags  = 0;
+    hdr.nodeId = nodeId;
+    hdr.seq    = seq;
+    memset(frame + pktEncodeHeader(&hdr, frame), (uint8_t)seq, FIX_LENGTH - PKT_HEADER_LENGTH);
+    return FIX_LENGTH;
+}
+
+static void relayInit(MeshRelay * relay, uint8_t level) {
+
+    MeshConfig cfg;
+
+    meshDefaultConfig(&cfg);
+    meshRelayInit(relay, &cfg, (uint8_t)(0xF0 | level), level);
+}
+
+static void testDedup(void) {
+
+    MeshDedup dedup;
+    uint16_t seq;
+
+    meshDedupInit(&dedup);
+    CHECK(meshDedupCheck(&dedup, 7, 100) == 0);
+    CHECK(meshDedupCheck(&dedup, 7, 100) == 1);
+    CHECK(meshDedupCheck(&dedup, 8, 100) == 0);
+    CHECK(meshDedupCheck(&dedup, 7, 101) == 0);
+
+    /* Filled up, the oldest goes first */
+    for (seq = 0; seq < MESH_DEDUP_ENTRIES - 3; ++seq)
+        CHECK(meshDedupCheck(&dedup, 1, seq) == 0);
+    CHECK(dedup.count == MESH_DEDUP_ENTRIES);
+    CHECK(meshDedupCheck(&dedup, 7, 100) == 1);
+    CHECK(meshDedupCheck(&dedup, 2, 0) == 0);
+    CHECK(meshDedupCheck(&dedup, 8, 100) == 1);
+    CHECK(meshDedupCheck(&dedup, 7, 100) == 0);
+    CHECK(dedup.count == MESH_DEDUP_ENTRIES);
+}
+
+static void testRoundTrip(void) {
+
+    uint8_t frames[3][FIX_LENGTH];
+    uint8_t buf[MESH_MAX_FRAME_LENGTH];
+    MeshRelay relay;
+    MeshEntry entry;
+    PacketHeader hdr;
+    uint8_t length, offset = 0, i;
+
+    relayInit(&relay, 2);
+    for (i = 0; i < 3; ++i) {
+        trackerFrame(frames[i], (uint8_t)(i + 1), (uint16_t)(500 + i));
+        CHECK(meshRelayAccept(&relay, frames[i], FIX_LENGTH, 1000, 0) == 1);
+    }
+    CHECK(relay.count == 3);
+
+    length = meshRelayBuild(&relay, buf, sizeof(buf));
+    CHECK(length == MESH_RELAY_HEADER_LENGTH + 3 * (MESH_ENTRY_HEADER_LENGTH + FIX_LENGTH));
+    CHECK(relay.count == 0 && relay.queuedBytes == 0 && relay.forwarded == 3);
+
+    CHECK(pktDecodeHeader(&hdr, buf, length) == 0);
+    CHECK(hdr.type == PKT_TYPE_RELAY && hdr.nodeId == 0xF2 && hdr.seq == 0);
+    CHECK(buf[PKT_HEADER_LENGTH] == 2);
+
+    /* Oldest first, as they came, one hop out with the TTL the relay gives */
+    for (i = 0; i < 3; ++i) {
+        CHECK(meshNextEntry(buf, length, &offset, &entry) == 0);
+        CHECK(entry.hops == 1 && entry.ttl == MESH_DEFAULT_TTL - 1);
+        CHECK(entry.nodeId == i + 1 && entry.seq == 500 + i);
+        CHECK(entry.length == FIX_LENGTH && memcmp(entry.frame, frames[i], FIX_LENGTH) == 0);
+    }
+    CHECK(meshNextEntry(buf, length, &offset, &entry) == 1);
+    CHECK(offset == length);
+
+    /* The next RELAY frame has the next sequence number */
+    CHECK(meshRelayAccept(&relay, frames[0], FIX_LENGTH, 1000, 0) == 0);
+    CHECK(relay.duplicates == 1);
+    trackerFrame(frames[0], 1, 503);
+    CHECK(meshRelayAccept(&relay, frames[0], FIX_LENGTH, 1000, 0) == 1);
+    length = meshRelayBuild(&relay, buf, sizeof(buf));
+    CHECK(pktDecodeHeader(&hdr, buf, length) == 0 && hdr.seq == 1);
+    CHECK(meshRelayBuild(&relay, buf, sizeof(buf)) == 0);
+}
+
+static void testHops(void) {
+
+    uint8_t frame[FIX_LENGTH];
+    uint8_t buf[MESH_MAX_FRAME_LENGTH], again[MESH_MAX_FRAME_LENGTH];
+    MeshRelay outer, inner, closer;
+    MeshEntry entry;
+    uint8_t length, offset = 0;
+
+    relayInit(&outer, 3);
+    relayInit(&inner, 2);
+    relayInit(&closer, 1);
+
+    trackerFrame(frame, 9, 77);
+    meshRelayAccept(&outer, frame, FIX_LENGTH, 0, 0);
+    length = meshRelayBuild(&outer, buf, sizeof(buf));
+
+    /* From further out: one more hop, one less TTL */
+    CHECK(meshRelayAccept(&inner, buf, length, 0, 0) == 1);
+    CHECK(meshRelayAccept(&inner, buf, length, 0, 0) == 0);
+    CHECK(inner.duplicates == 1);
+    length = meshRelayBuild(&inner, again, sizeof(again));
+    CHECK(meshNextEntry(again, length, &offset, &entry) == 0);
+    CHECK(entry.hops == 2 && entry.ttl == MESH_DEFAULT_TTL - 2 && entry.seq == 77);
+
+    /* Not from a relay as close as itself, or closer */
+    CHECK(meshRelayAccept(&outer, again, length, 0, 0) == 0);
+    CHECK(meshRelayAccept(&inner, again, length, 0, 0) == 0);
+    CHECK(outer.count == 0 && inner.count == 0);
+
+    /* Once the TTL is spent the frame goes no further */
+    again[MESH_RELAY_HEADER_LENGTH] = 2 << 4 | 0;
+    CHECK(meshRelayAccept(&closer, again, length, 0, 0) == 0);
+    CHECK(closer.expired == 1 && closer.count == 0);
+
+    /* A relay with no TTL to give relays nothing of its own */
+    MeshConfig cfg;
+    meshDefaultConfig(&cfg);
+    cfg.ttl = 0;
+    meshRelayInit(&closer, &cfg, 0xF1, 1);
+    CHECK(meshRelayAccept(&closer, frame, FIX_LENGTH, 0, 0) == 0);
+    CHECK(closer.expired == 1);
+}
+
+static void testTypes(void) {
+
+    uint8_t frame[PKT_HEADER_LENGTH + 8];
+    MeshRelay relay;
+    PacketHeader hdr;
+    uint8_t type;
+
+    relayInit(&relay, 1);
+    hdr.flags  = 0;
+    hdr.nodeId = 4;
+    hdr.seq    = 9;
+    memset(frame, 0, sizeof(frame));
+
+    for (type = PKT_TYPE_DATA; type <= PKT_TYPE_RELAY; ++type) {
+        hdr.type = type;
+        pktEncodeHeader(&hdr, frame);
+        hdr.seq++;
+        CHECK(meshRelayAccept(&relay, frame, sizeof(frame), 0, 0) ==
+              (type == PKT_TYPE_DATA || type == PKT_TYPE_LOG || type == PKT_TYPE_FIX));
+    }
+    CHECK(relay.count == 3);
+
+    /* Cut short */
+    CHECK(meshRelayAccept(&relay, frame, PKT_HEADER_LENGTH - 1, 0, 0) == 0);
+}
+
+static void testTiming(void) {
+
+    uint8_t frame[FIX_LENGTH];
+    uint8_t buf[MESH_MAX_FRAME_LENGTH];
+    MeshRelay relay;
+    uint16_t seq;
+
+    relayInit(&relay, 1);
+    CHECK(meshRelayWaitMs(&relay, 0) == MESH_FOREVER);
+
+    /* The first frame sets the time, with the jitter drawn from random */
+    trackerFrame(frame, 1, 0);
+    meshRelayAccept(&relay, frame, FIX_LENGTH, 1000, 100);
+    CHECK(meshRelayWaitMs(&relay, 1000) == MESH_DEFAULT_HOLD_MS + 100);
+    trackerFrame(frame, 2, 0);
+    meshRelayAccept(&relay, frame, FIX_LENGTH, 1200, 7);
+    CHECK(meshRelayWaitMs(&relay, 1200) == MESH_DEFAULT_HOLD_MS - 100);
+    CHECK(meshRelayWaitMs(&relay, 1000 + MESH_DEFAULT_HOLD_MS + 100) == 0);
+    CHECK(meshRelayWaitMs(&relay, 5000) == 0);
+    meshRelayBuild(&relay, buf, sizeof(buf));
+    CHECK(meshRelayWaitMs(&relay, 5000) == MESH_FOREVER);
+
+    /* The jitter stays within jitterMs */
+    trackerFrame(frame, 1, 1);
+    meshRelayAccept(&relay, frame, FIX_LENGTH, 0, 0xFFFFFFFF);
+    CHECK(meshRelayWaitMs(&relay, 0) <= MESH_DEFAULT_HOLD_MS + MESH_DEFAULT_JITTER_MS);
+    meshRelayBuild(&relay, buf, sizeof(buf));
+
+    /* As soon as a RELAY frame is full it goes; what did not fit keeps its time */
+    for (seq = 10; relay.count < 4; ++seq) {
+        CHECK(meshRelayWaitMs(&relay, 0) != 0);
+        trackerFrame(frame, 3, seq);
+        meshRelayAccept(&relay, frame, FIX_LENGTH, 0, 0);
+    }
+    CHECK(4 * (MESH_ENTRY_HEADER_LENGTH + FIX_LENGTH) + MESH_RELAY_HEADER_LENGTH > MESH_MAX_FRAME_LENGTH);
+    CHECK(meshRelayWaitMs(&relay, 0) == 0);
+    CHECK(meshRelayBuild(&relay, buf, sizeof(buf)) == MESH_RELAY_HEADER_LENGTH + 3 * (MESH_ENTRY_HEADER_LENGTH + FIX_LENGTH));
+    CHECK(relay.count == 1 && meshRelayWaitMs(&relay, 0) == MESH_DEFAULT_HOLD_MS);
+
+    /* Too short a buffer for the oldest */
+    CHECK(meshRelayBuild(&relay, buf, MESH_RELAY_HEADER_LENGTH + FIX_LENGTH) == 0);
+    CHECK(relay.count == 1);
+}
+
+static void testOverflow(void) {
+
+    uint8_t frame[MESH_MAX_FRAME_LENGTH];
+    uint8_t buf[MESH_MAX_FRAME_LENGTH];
+    MeshRelay relay;
+    MeshEntry entry;
+    uint8_t length, offset = 0;
+    uint16_t seq;
+
+    relayInit(&relay, 1);
+    for (seq = 0; seq < MESH_QUEUE_ENTRIES + 2; ++seq) {
+        trackerFrame(frame, 5, seq);
+        meshRelayAccept(&relay, frame, FIX_LENGTH, 0, 0);
+    }
+    CHECK(relay.count == MESH_QUEUE_ENTRIES && relay.overflows == 2);
+    CHECK(relay.queuedBytes == MESH_QUEUE_ENTRIES * (MESH_ENTRY_HEADER_LENGTH + FIX_LENGTH));
+
+    length = meshRelayBuild(&relay, buf, sizeof(buf));
+    CHECK(meshNextEntry(buf, length, &offset, &entry) == 0 && entry.seq == 2);
+
+    /* Longer than a RELAY frame has room for */
+    trackerFrame(frame, 6, 0);
+    memset(frame + FIX_LENGTH, 0, sizeof(frame) - FIX_LENGTH);
+    CHECK(meshRelayAccept(&relay, frame, MESH_MAX_ENTRY_LENGTH + 1, 0, 0) == 0);
+    CHECK(relay.overflows == 3);
+}
+
+static void testMalformed(void) {
+
+    uint8_t frames[2][FIX_LENGTH];
+    uint8_t buf[MESH_MAX_FRAME_LENGTH];
+    MeshRelay relay;
+    MeshEntry entry;
+    uint8_t length, offset;
+
+    relayInit(&relay, 1);
+    trackerFrame(frames[0], 1, 1);
+    trackerFrame(frames[1], 2, 2);
+    meshRelayAccept(&relay, frames[0], FIX_LENGTH, 0, 0);
+    meshRelayAccept(&relay, frames[1], FIX_LENGTH, 0, 0);
+    length = meshRelayBuild(&relay, buf, sizeof(buf));
+
+    /* Cut short inside the second entry: the first is still good */
+    offset = 0;
+    CHECK(meshNextEntry(buf, length - 1, &offset, &entry) == 0);
+    CHECK(meshNextEntry(buf, length - 1, &offset, &entry) == 1);
+    CHECK(offset == length - 1);
+
+    /* An entry that is not a tracker's frame ends the parse */
+    buf[MESH_RELAY_HEADER_LENGTH + MESH_ENTRY_HEADER_LENGTH] = PKT_TYPE_RELAY;
+    offset = 0;
+    CHECK(meshNextEntry(buf, length, &offset, &entry) == 1);
+    CHECK(offset == length);
+
+    /* Nothing after the header */
+    offset = 0;
+    CHECK(meshNextEntry(buf, MESH_RELAY_HEADER_LENGTH, &offset, &entry) == 1);
+}
+
+int main(void) {
+
+    testDedup();
+    testRoundTrip();
+    testHops();
+    testTypes();
+    testTiming();
+    testOverflow();
+    testMalformed();
+
+    return checkReport();
+}
@@ -0,0 +1,213 @@
+//
+//  metricsTest.c
+//  Tests of the metrics registry and its telemetry record (metrics.c)
+//
+//  A snapshot survives encoding and decoding, a record too long for its room is cut at a
+//  metric and flagged, metrics of a newer firmware are skipped, values land in the buckets
+//  their bounds say, and updates from several threads at once are not lost.
+//
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "metrics.h"
+
+#define THREADS             4
+#define THREAD_UPDATES      100000
+
+/* Field by field, the padding after flags is not part of it */
+static int sameSnapshot(const MetricsSnapshot * a, const MetricsSnapshot * b) {
+
+    return a->flags == b->flags && a->uptimeS == b->uptimeS &&
+           memcmp(a->counters, b->counters, sizeof(a->counters)) == 0 &&
+           memcmp(a->gauges, b->gauges, sizeof(a->gauges)) == 0 &&
+           memcmp(a->histograms, b->histograms, sizeof(a->histograms)) == 0;
+}
+
+static void testRoundTrip(void) {
+
+    static MetricsSnapshot s, d;
+    uint8_t record[METRICS_RECORD_MAX_LENGTH];
+    uint8_t length;
+
+    metricsInit();
+    metricAdd(METRIC_RX_FRAMES, 1234567);
+    metricInc(METRIC_RX_CRC_ERRORS);
+    metricAdd(METRIC_RF_ERRORS, 0xFFFFFFFF);
+    metricSet(METRIC_RF_LAST_ERROR, 0x0801);
+    metricMax(METRIC_RX_QUEUE_HIGH, 3);
+    metricMax(METRIC_RX_QUEUE_HIGH, 2);
+    metricObserve(METRIC_RSSI, -95);
+    metricObserve(METRIC_FRAME_LENGTH, 200);
+    metricsSnapshot(&s, 86400);
+
+    /* Zero metrics take no room: the header, 3 counters, 2 gauges, 2 histograms */
+    length = metricsEncode(&s, record, sizeof(record));
+    CHECK(length == METRICS_HEADER_LENGTH + (1 + 3) + (1 + 1) + (1 + 5) + (1 + 2) + (1 + 1) +
+                    2 * (2 + 1));
+    CHECK(record[0] == METRICS_VERSION && record[1] == 0);
+    CHECK(metricsDecode(&d, record, length) == 0);
+    CHECK(sameSnapshot(&s, &d));
+    CHECK(d.gauges[METRIC_RX_QUEUE_HIGH] == 3);
+
+    /* Every metric at its largest fits METRICS_RECORD_MAX_LENGTH */
+    memset(&s, 0xFF, sizeof(s));
+    s.flags = 0;
+    length = metricsEncode(&s, record, sizeof(record));
+    CHECK(length == METRICS_RECORD_MAX_LENGTH);
+    CHECK(metricsDecode(&d, record, length) == 0);
+    CHECK(sameSnapshot(&s, &d));
+
+    /* Nothing to report: the header alone */
+    memset(&s, 0, sizeof(s));
+    CHECK(metricsEncode(&s, record, sizeof(record)) == METRICS_HEADER_LENGTH);
+}
+
+static void testTruncated(void) {
+
+    static MetricsSnapshot s, d;
+    uint8_t record[METRICS_RECORD_MAX_LENGTH];
+    uint8_t length;
+
+    memset(&s, 0, sizeof(s));
+    s.counters[METRIC_RX_FRAMES] = 1000;        // 1 + 2 bytes
+    s.counters[METRIC_TX_FRAMES] = 5;           // 1 + 1
+    s.gauges[METRIC_LOG_BACKLOG] = 7;           // 1 + 1
+
+    /* Room for the first two: the third is left out whole */
+    length = metricsEncode(&s, record, METRICS_HEADER_LENGTH + 5);
+    CHECK(length == METRICS_HEADER_LENGTH + 5);
+    CHECK(record[1] & METRICS_TRUNCATED);
+    CHECK(metricsDecode(&d, record, length) == 0);
+    CHECK(d.counters[METRIC_RX_FRAMES] == 1000 && d.counters[METRIC_TX_FRAMES] == 5);
+    CHECK(d.gauges[METRIC_LOG_BACKLOG] == 0);
+
+    /* One byte short of the second */
+    length = metricsEncode(&s, record, METRICS_HEADER_LENGTH + 4);
+    CHECK(length == METRICS_HEADER_LENGTH + 3 && (record[1] & METRICS_TRUNCATED));
+
+    CHECK(metricsEncode(&s, record, METRICS_HEADER_LENGTH - 1) == 0);
+}
+
+static void testMalformed(void) {
+
+    static MetricsSnapshot d;
+    const uint8_t header[] = { METRICS_VERSION, 0, 0, 0, 0, 60 };
+    uint8_t record[32];
+
+    /* Metrics of a newer firmware, a counter and a histogram, around one we know */
+    memcpy(record, header, sizeof(header));
+    uint8_t newer[] = { METRIC_KIND_COUNTER << 6 | 63, 0x81, 0x01,
+                        METRIC_KIND_GAUGE << 6 | METRIC_RX_QUEUE_HIGH, 4,
+                        METRIC_KIND_HISTOGRAM << 6 | 40, 0x05, 1, 2,
+                        3 << 6 | 1, 9 };
+    memcpy(record + sizeof(header), newer, sizeof(newer));
+    CHECK(metricsDecode(&d, record, sizeof(header) + sizeof(newer)) == 0);
+    CHECK(d.uptimeS == 60 && d.gauges[METRIC_RX_QUEUE_HIGH] == 4);
+
+    /* Cut inside a varint, or after a histogram's key */
+    CHECK(metricsDecode(&d, record, sizeof(header) + 2) == 1);
+    CHECK(metricsDecode(&d, record, sizeof(header) + 6) == 1);
+
+    /* Another version, a short header */
+    record[0] = METRICS_VERSION + 1;
+    CHECK(metricsDecode(&d, record, sizeof(header)) == 1);
+    CHECK(metricsDecode(&d, header, METRICS_HEADER_LENGTH - 1) == 1);
+
+    /* A varint longer than 32 bits */
+    uint8_t wide[] = { METRICS_VERSION, 0, 0, 0, 0, 0, METRIC_RX_FRAMES, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+    CHECK(metricsDecode(&d, wide, sizeof(wide)) == 1);
+}
+
+static void testBuckets(void) {
+
+    static MetricsSnapshot s;
+
+    metricsInit();
+    metricObserve(METRIC_RSSI, -120);
+    metricObserve(METRIC_RSSI, -110);
+    metricObserve(METRIC_RSSI, -51);
+    metricObserve(METRIC_RSSI, -50);
+    metricObserve(METRIC_RSSI, 10);
+    metricObserve(METRIC_FRAME_LENGTH, 15);
+    metricObserve(METRIC_FRAME_LENGTH, 16);
+    metricObserve(METRIC_FRAME_LENGTH, 127);
+    metricObserve(METRIC_HISTOGRAMS, 0);
+    metricAdd(METRIC_COUNTERS, 1);
+    metricSet(METRIC_GAUGES, 1);
+    metricsSnapshot(&s, 0);
+
+    CHECK(s.histograms[METRIC_RSSI][0] == 1 && s.histograms[METRIC_RSSI][1] == 1);
+    CHECK(s.histograms[METRIC_RSSI][6] == 1 && s.histograms[METRIC_RSSI][7] == 2);
+    CHECK(s.histograms[METRIC_FRAME_LENGTH][0] == 1 && s.histograms[METRIC_FRAME_LENGTH][1] == 1);
+    CHECK(s.histograms[METRIC_FRAME_LENGTH][6] == 1);
+}
+
+static void * updateThread(void * arg) {
+
+    uint32_t i;
+
+    for (i = 0; i < THREAD_UPDATES; ++i) {
+        metricInc(METRIC_RX_FRAMES);
+        metricObserve(METRIC_FRAME_LENGTH, (int32_t)(i % 160));
+        metricMax(METRIC_RX_QUEUE_HIGH, (uint32_t)(uintptr_t)arg * THREAD_UPDATES + i);
+    }
+    return NULL;
+}
+
+/* Threads stand in for the RF callback, HWIs and the task */
+static void testConcurrent(void) {
+
+    static MetricsSnapshot s;
+    pthread_t threads[THREADS];
+    uint32_t i, total = 0;
+    uint8_t b;
+
+    metricsInit();
+    for (i = 0; i < THREADS; ++i)
+        pthread_create(&threads[i], NULL, updateThread, (void *)(uintptr_t)i);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join(threads[i], NULL);
+
+    metricsSnapshot(&s, 0);
+    for (b = 0; b < METRIC_BUCKETS; ++b)
+        total += s.histograms[METRIC_FRAME_LENGTH][b];
+    CHECK(s.counters[METRIC_RX_FRAMES] == THREADS * THREAD_UPDATES);
+    CHECK(total == THREADS * THREAD_UPDATES);
+    CHECK(s.gauges[METRIC_RX_QUEUE_HIGH] == THREADS * THREAD_UPDATES - 1);
+}
+
+static void testFormat(void) {
+
+    static MetricsSnapshot s;
+    char out[400];
+
+    memset(&s, 0, sizeof(s));
+    s.uptimeS = 3600;
+    s.counters[METRIC_RX_FRAMES] = 42;
+    s.gauges[METRIC_RF_LAST_ERROR] = 0x0808;
+    s.histograms[METRIC_RSSI][2] = 5;
+    s.histograms[METRIC_RSSI][3] = 1;
+
+    CHECK(metricsFormat(&s, out, sizeof(out)) == strlen(out));
+    CHECK(strcmp(out, "uptime:\t3600\trx frames:\t42\trf last error:\t0x0808\t"
+                      "rssi:\t0/0/5/1/0/0/0/0") == 0);
+
+    s.flags = METRICS_TRUNCATED;
+    CHECK(metricsFormat(&s, out, 20) == 19);
+    CHECK(strncmp(out, "uptime:\t3600 (trunc", 19) == 0);
+}
+
+int main(void) {
+
+    testRoundTrip();
+    testTruncated();
+    testMalformed();
+    testBuckets();
+    testConcurrent();
+    testFormat();
+
+    return checkReport();
+}
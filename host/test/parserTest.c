@@ -0,0 +1,196 @@
+//
+//  parserTest.c
+//  Unit tests of the NMEA parser and formatter (gpsParser.c)
+//
+//  Sentences are classified whatever their talker, checksums are checked both on a copy
+//  and in place, where nothing past the given length is read, the fields of each
+//  sentence type land where gpsParser.h says, empty fields leave the previous value, and
+//  the gateway's output line is formatted as it always was.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "gpsParser.h"
+
+#define LINE_LENGTH     100
+
+#define NEAR(a, b)  ((a) - (b) < 1e-9 && (b) - (a) < 1e-9)
+
+/* body is the sentence without '$' and checksum; out gets "$body*XX\r\n" */
+static uint8_t sentence(const char * body, char * out) {
+
+    uint8_t checksum = 0;
+    const char * p;
+
+    for (p = body; *p; ++p)
+        checksum ^= (uint8_t)*p;
+    return (uint8_t)snprintf(out, LINE_LENGTH, "$%s*%02X\r\n", body, checksum);
+}
+
+static void testClassify(void) {
+
+    char talker[3];
+
+    CHECK(nmeaClassify("$GPGGA,", talker) == NMEA_GGA && strcmp(talker, "GP") == 0);
+    CHECK(nmeaClassify("$GNRMC,", talker) == NMEA_RMC && strcmp(talker, "GN") == 0);
+    CHECK(nmeaClassify("$GLGSV,", talker) == NMEA_GSV && strcmp(talker, "GL") == 0);
+    CHECK(nmeaClassify("$GAGSA,", NULL) == NMEA_GSA);
+    CHECK(nmeaClassify("$BDGSA,", NULL) == NMEA_GSA);
+    CHECK(nmeaClassify("$GPVTG,", NULL) == NMEA_VTG);
+    CHECK(nmeaClassify("$GPGLL,", NULL) == NMEA_GLL);
+    CHECK(nmeaClassify("$GPZDA,", NULL) == NMEA_ZDA);
+    CHECK(nmeaClassify("$GPTXT,", NULL) == NMEA_UNKNOWN);
+    CHECK(nmeaClassify("$PUBX,00", NULL) == NMEA_UNKNOWN);
+    CHECK(nmeaClassify("GPGGA,", NULL) == NMEA_UNKNOWN);
+    CHECK(nmeaClassify("$GP", NULL) == NMEA_UNKNOWN);
+}
+
+static void testChecksum(void) {
+
+    static GPSData data;
+    char line[LINE_LENGTH];
+    uint8_t n;
+
+    nmeaDataInit(&data);
+    n = sentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", line);
+
+    /* On a copy, with text before the '$' */
+    char noisy[120] = "\xff\x01";
+    strcat(noisy, line);
+    CHECK(nmeaReceiveSentence(&data, noisy) == 0);
+    CHECK(data.nmeaData.msgType == NMEA_GGA);
+    CHECK(strchr(data.nmeaData.sentence, '*') == NULL);
+
+    /* One bit off, the checksum digits in lower case, no checksum at all */
+    line[10] ^= 0x01;
+    CHECK(nmeaReceiveSentence(&data, line) == 1 && data.nmeaData.msgType == NMEA_UNKNOWN);
+    line[10] ^= 0x01;
+    char lower[LINE_LENGTH];
+    strcpy(lower, line);
+    lower[n - 3] = (char)(lower[n - 3] | 0x20);
+    lower[n - 4] = (char)(lower[n - 4] | 0x20);
+    CHECK(nmeaReceiveView(&data, lower, n) == 0);
+    CHECK(nmeaReceiveSentence(&data, "$GPGGA,123519,4807.038,N\r\n") == 1);
+
+    /* Longer than an NMEA sentence may be */
+    char longBody[100];
+    memset(longBody, '0', sizeof(longBody));
+    memcpy(longBody, "GPTXT,", 6);
+    longBody[85] = '\0';
+    n = sentence(longBody, line);
+    CHECK(nmeaReceiveSentence(&data, line) == 1);
+    CHECK(nmeaReceiveView(&data, line, n) == 1);
+}
+
+static void testView(void) {
+
+    static GPSData data;
+    char line[LINE_LENGTH], buf[200];
+    uint8_t n;
+
+    nmeaDataInit(&data);
+    n = sentence("GNRMC,225446.00,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E,A", line);
+
+    /* In place, after noise, not terminated, with the next sentence's start right after it */
+    memset(buf, '$', sizeof(buf));
+    memset(buf, '#', 7);
+    memcpy(buf + 7, line, n);
+    CHECK(nmeaReceiveView(&data, buf, (uint8_t)(7 + n)) == 0);
+    CHECK(data.nmeaData.text == buf + 7 && data.nmeaData.msgType == NMEA_RMC);
+    CHECK(nmeaParse(&data) == 0);
+    CHECK(NEAR(data.time, 225446.0) && data.status == 'A');
+    CHECK(NEAR(data.latitude, 4916.45) && data.latDirection == 'N');
+    CHECK(NEAR(data.longitude, 12311.12) && data.longDirection == 'W');
+    CHECK(NEAR(data.groundSpeed, 0.5) && NEAR(data.trueCourse, 54.7));
+    CHECK(data.day == 19 && data.month == 11 && data.year == 2094);
+
+    /* The checksum cut off by length: nothing past it is looked at */
+    memcpy(buf, line, n);
+    CHECK(nmeaReceiveView(&data, buf, (uint8_t)(n - 3)) == 1);
+    CHECK(nmeaReceiveView(&data, buf, 0) == 1);
+}
+
+static uint8_t parseLine(GPSData * data, const char * body) {
+
+    char line[LINE_LENGTH];
+
+    sentence(body, line);
+    return nmeaReceiveSentence(data, line) || nmeaParse(data);
+}
+
+static void testFields(void) {
+
+    static GPSData data;
+    static const NMEAHandler all[] = {
+        { NMEA_GGA, nmeaParseGGA }, { NMEA_GSA, nmeaParseGSA }, { NMEA_RMC, nmeaParseRMC },
+        { NMEA_GSV, nmeaParseGSV }, { NMEA_VTG, nmeaParseVTG }, { NMEA_GLL, nmeaParseGLL },
+        { NMEA_ZDA, nmeaParseZDA }
+    };
+
+    nmeaDataInit(&data);
+
+    /* Only GGA and RMC until a table is registered */
+    CHECK(parseLine(&data, "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,") == 0);
+    CHECK(NEAR(data.time, 123519.0) && NEAR(data.latitude, 4807.038) && data.latDirection == 'N');
+    CHECK(NEAR(data.longitude, 1131.0) && data.longDirection == 'E');
+    CHECK(data.fixQuality == 1 && data.numSatellites == 8);
+    CHECK(NEAR(data.hdop, 0.9) && NEAR(data.altitude, 545.4));
+    CHECK(parseLine(&data, "GPVTG,054.7,T,034.4,M,005.5,N,010.2,K") == 1);
+
+    nmeaRegisterHandlers(all, sizeof(all) / sizeof(all[0]));
+
+    /* Empty fields keep what was there */
+    CHECK(parseLine(&data, "GPGGA,123520,,,,,0,00,,,M,,M,,") == 0);
+    CHECK(NEAR(data.time, 123520.0) && NEAR(data.latitude, 4807.038) && data.fixQuality == 0);
+
+    CHECK(parseLine(&data, "GNGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1,1") == 0);
+    CHECK(data.fixMode == 3 && data.numUsed == 5 && data.usedPrn[2] == 9);
+    CHECK(data.usedBySystem[NMEA_SYS_GPS] == 5);
+    CHECK(NEAR(data.pdop, 2.5) && NEAR(data.hdop, 1.3) && NEAR(data.vdop, 2.1));
+    CHECK(parseLine(&data, "GNGSA,A,3,65,66,,,,,,,,,,,2.5,1.3,2.1,2") == 0);
+    CHECK(data.usedBySystem[NMEA_SYS_GLONASS] == 2 && data.usedBySystem[NMEA_SYS_GPS] == 5);
+
+    CHECK(parseLine(&data, "GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45") == 0);
+    CHECK(parseLine(&data, "GPGSV,2,2,08,15,11,112,,17,52,058,30,19,09,168,,24,44,283,40") == 0);
+    CHECK(data.numInView == 8 && data.inView[0].prn == 1 && data.inView[0].azimuth == 83);
+    CHECK(data.inView[4].prn == 15 && data.inView[4].snr == 0);
+    NMEASystemSummary summary[NMEA_SYSTEMS];
+    nmeaSystemSummary(&data, summary);
+    CHECK(summary[NMEA_SYS_GPS].inView == 8 && summary[NMEA_SYS_GPS].tracked == 6);
+    CHECK(summary[NMEA_SYS_GPS].meanSnr == (46 + 41 + 39 + 45 + 30 + 40) / 6);
+
+    CHECK(parseLine(&data, "GPVTG,054.7,T,034.4,M,005.5,N,010.2,K") == 0);
+    CHECK(NEAR(data.trueCourse, 54.7) && NEAR(data.groundSpeed, 5.5));
+    CHECK(parseLine(&data, "GPGLL,4916.45,N,12311.12,W,225444,A") == 0);
+    CHECK(NEAR(data.latitude, 4916.45) && data.longDirection == 'W' && data.status == 'A');
+    CHECK(parseLine(&data, "GPZDA,201530.00,04,07,2002,00,00") == 0);
+    CHECK(data.day == 4 && data.month == 7 && data.year == 2002);
+
+    nmeaRegisterHandlers(NULL, 0);
+    CHECK(parseLine(&data, "GPZDA,201530.00,04,07,2002,00,00") == 1);
+}
+
+static void testFormat(void) {
+
+    static GPSData data;
+    char out[160];
+
+    nmeaDataInit(&data);
+    CHECK(parseLine(&data, "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W") == 0);
+    nmeaToString(&data, out);
+    CHECK(strcmp(out, "12:35:19\tlatitude:\t48 7.038000N\tlongitude:\t11 31.000000E\t"
+                      "ground speed:\t22.400000\ttrue course:\t84.400000\r\n") == 0);
+}
+
+int main(void) {
+
+    testClassify();
+    testChecksum();
+    testView();
+    testFields();
+    testFormat();
+
+    return checkReport();
+}
@@ -0,0 +1,101 @@
+//
+//  phyProfileTest.c
+//  Tests of the PHY profiles and the airtime calculator (phyProfile.c)
+//
+//  The constant expressions of the profile in use agree with the runtime calculation for
+//  every frame length, the long range profile gives the airtime the benchmarks always
+//  assumed, faster profiles take less airtime, and the MAC defaults fit the frames.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arqMac.h"
+#include "check.h"
+#include "csmaMac.h"
+#include "phyProfile.h"
+#include "tdmaMac.h"
+
+/* Usable where a constant is needed */
+typedef char phyAirtimeIsConstant[PHY_AIRTIME_US(255) > PHY_SYNC_US ? 1 : -1];
+
+static void testProfileInUse(void) {
+
+    PhyProfile inUse = *phyProfileGet(PHY_PROFILE);
+    const PhyProfile * phy = &inUse;
+    unsigned length;
+
+    /* With the preamble of the channel scan, if any */
+    inUse.preambleLength = phyScanPreambleLength(phy, PHY_CHANNELS);
+
+    CHECK(phyProfileGet(PHY_PROFILE) == &phyProfiles[PHY_PROFILE]);
+    CHECK(phyBitNs(phy) == PHY_BIT_NS);
+    CHECK(phySyncUs(phy) == PHY_SYNC_US);
+    for (length = 0; length <= 255; ++length)
+        CHECK(phyAirtimeUs(phy, (uint8_t)length) == PHY_AIRTIME_US(length));
+}
+
+static void testLongRange(void) {
+
+    const PhyProfile * phy = phyProfileGet(PHY_PROFILE_LONG_RANGE);
+
+    /* 200 us a bit; preamble 2, sync word 4, length 1 and CRC 2 bytes around the payload */
+    CHECK(phyBitNs(phy) == 200000);
+    CHECK(phyAirtimeUs(phy, 0) == 9 * 8 * 200);
+    CHECK(phyAirtimeUs(phy, 4 + 72) == 85 * 8 * 200);
+    CHECK(phySyncUs(phy) == 6 * 8 * 200);
+
+#if PHY_PROFILE == PHY_PROFILE_LONG_RANGE && PHY_CHANNELS == 1
+    CHECK(TDMA_DEFAULT_SLOT_MS == 200);
+    CHECK(CSMA_DEFAULT_BACKOFF_UNIT_US == 10000);
+#endif
+}
+
+static void testFasterProfiles(void) {
+
+    const PhyProfile * slow = phyProfileGet(PHY_PROFILE_LONG_RANGE);
+    const PhyProfile * mid  = phyProfileGet(PHY_PROFILE_50KBPS);
+    const PhyProfile * fast = phyProfileGet(PHY_PROFILE_HIGH_RATE);
+    unsigned length;
+
+    CHECK(phyBitNs(mid) == 20000 && phyBitNs(fast) == 10000);
+    CHECK(phyAirtimeUs(mid, 102) == (102 + 11) * 8 * 20);
+    for (length = 0; length <= 255; ++length) {
+        CHECK(phyAirtimeUs(mid, (uint8_t)length) < phyAirtimeUs(slow, (uint8_t)length));
+        CHECK(phyAirtimeUs(fast, (uint8_t)length) < phyAirtimeUs(mid, (uint8_t)length));
+    }
+
+    /* What the speed costs */
+    CHECK(slow->sensitivityDbm < mid->sensitivityDbm && mid->sensitivityDbm < fast->sensitivityDbm);
+    CHECK(phyProfileGet(PHY_NUM_PROFILES) == NULL);
+    CHECK(strcmp(slow->name, mid->name) != 0 && strcmp(mid->name, fast->name) != 0);
+}
+
+static void testMacDefaults(void) {
+
+    TdmaFrameConfig tdma;
+    CsmaConfig csma;
+    ArqConfig arq;
+
+    tdmaDefaultConfig(&tdma);
+    CHECK(tdma.slotMs * 1000UL >= PHY_AIRTIME_US(TDMA_MAX_FRAME_LENGTH) + 2 * TDMA_GUARD_US);
+    CHECK(tdma.beaconMs * 1000UL >= PHY_AIRTIME_US(PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS))
+                                    + 2 * TDMA_GUARD_US);
+    CHECK(tdma.slotMs % 25 == 0 && tdma.beaconMs % 25 == 0);
+
+    csmaDefaultConfig(&csma);
+    CHECK(csma.backoffUnitUs >= PHY_SYNC_US && csma.backoffUnitUs < PHY_SYNC_US + 1000);
+
+    arqDefaultConfig(&arq);
+    CHECK(arq.rxWindowUs == ARQ_GATEWAY_TURNAROUND_US + PHY_SYNC_US);
+}
+
+int main(void) {
+
+    testProfileInUse();
+    testLongRange();
+    testFasterProfiles();
+    testMacDefaults();
+
+    return checkReport();
+}
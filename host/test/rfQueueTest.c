@@ -0,0 +1,116 @@
+//
+//  rfQueueTest.c
+//  Tests of the RX queue helpers (RFQueue.c) on the host stand-in of rf_data_entry.h
+//
+//  General entries are laid out in a ring, each aligned and RF_QUEUE_DATA_ENTRY_BUFFER_SIZE
+//  apart, a buffer one byte short is refused, and reading walks the ring and hands entries
+//  back pending. Partial read entries come out as the RF core expects them, and a flush
+//  gives every entry back.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "RFQueue.h"
+
+#define NUM_ENTRIES         3
+#define MAX_LENGTH          30
+#define NUM_APPENDED_BYTES  2
+#define PARTIAL_DATA_SIZE   64
+
+static void testGeneral(void) {
+
+    static uint8_t buf[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_ENTRIES, MAX_LENGTH, NUM_APPENDED_BYTES)]
+        __attribute__((aligned(sizeof(uint8_t *))));
+    const size_t stride = sizeof(buf) / NUM_ENTRIES;
+    const uint16_t length = MAX_LENGTH + NUM_APPENDED_BYTES;
+    dataQueue_t queue;
+    uint8_t i, length2;
+
+    CHECK(RFQueue_defineQueue(&queue, buf, sizeof(buf) - 1, NUM_ENTRIES, length) == 1);
+
+    memset(buf, 0xA5, sizeof(buf));
+    CHECK(RFQueue_defineQueue(&queue, buf, sizeof(buf), NUM_ENTRIES, length) == 0);
+    CHECK(queue.pCurrEntry == buf && queue.pLastEntry == NULL);
+    CHECK(stride % RF_QUEUE_ALIGN == 0 && stride >= RF_QUEUE_DATA_ENTRY_HEADER_SIZE + length);
+
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        rfc_dataEntryGeneral_t * e = (rfc_dataEntryGeneral_t *)(buf + i * stride);
+        CHECK(e->status == DATA_ENTRY_PENDING && e->config.type == DATA_ENTRY_TYPE_GEN);
+        CHECK(e->config.lenSz == 0 && e->length == length);
+        CHECK(e->pNextEntry == buf + (i + 1) % NUM_ENTRIES * stride);
+    }
+
+    /* The RF core finishes two, the reader takes them in order and around the ring */
+    CHECK(RFQueue_getDataEntry() == (rfc_dataEntryGeneral_t *)buf);
+    ((rfc_dataEntryGeneral_t *)buf)->status = DATA_ENTRY_FINISHED;
+    ((rfc_dataEntryGeneral_t *)(buf + stride))->status = DATA_ENTRY_FINISHED;
+    CHECK(RFQueue_nextEntry() == DATA_ENTRY_FINISHED);
+    CHECK(((rfc_dataEntryGeneral_t *)buf)->status == DATA_ENTRY_PENDING);
+    CHECK(RFQueue_getDataEntry() == (rfc_dataEntryGeneral_t *)(buf + stride));
+    CHECK(RFQueue_nextEntry() == DATA_ENTRY_PENDING);
+    CHECK(RFQueue_nextEntry() == DATA_ENTRY_PENDING);
+    CHECK(RFQueue_getDataEntry() == (rfc_dataEntryGeneral_t *)buf);
+
+    /* Lengths that end on the alignment still get padding, as on the RF core */
+    for (length2 = 1; length2 <= 2 * RF_QUEUE_ALIGN; ++length2) {
+        size_t size = RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_ENTRIES, length2, 0);
+        CHECK(RFQueue_defineQueue(&queue, buf, (uint16_t)size, NUM_ENTRIES, length2) == 0);
+        CHECK(((rfc_dataEntryGeneral_t *)buf)->pNextEntry == buf + size / NUM_ENTRIES);
+        CHECK(size / NUM_ENTRIES % RF_QUEUE_ALIGN == 0);
+    }
+}
+
+static void testPartial(void) {
+
+    static uint8_t buf[RF_QUEUE_PARTIAL_ENTRY_BUFFER_SIZE(NUM_ENTRIES, PARTIAL_DATA_SIZE)]
+        __attribute__((aligned(sizeof(uint8_t *))));
+    static uint8_t assembly[257];
+    const size_t stride = sizeof(buf) / NUM_ENTRIES;
+    dataQueue_t queue;
+    RxStream stream;
+    uint8_t i;
+
+    CHECK(RFQueue_definePartialQueue(&queue, &stream, buf, sizeof(buf) - 1, NUM_ENTRIES,
+                                     PARTIAL_DATA_SIZE, assembly, sizeof(assembly)) == 1);
+    CHECK(RFQueue_definePartialQueue(&queue, &stream, buf, sizeof(buf), 1,
+                                     PARTIAL_DATA_SIZE, assembly, sizeof(assembly)) == 1);
+    CHECK(RFQueue_definePartialQueue(&queue, &stream, buf, sizeof(buf), NUM_ENTRIES,
+                                     PARTIAL_DATA_SIZE, assembly, sizeof(assembly)) == 0);
+    CHECK(queue.pCurrEntry == buf && queue.pLastEntry == NULL);
+
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        rfc_dataEntryPartial_t * e = (rfc_dataEntryPartial_t *)(buf + i * stride);
+        CHECK(e->status == DATA_ENTRY_PENDING && e->config.type == DATA_ENTRY_TYPE_PARTIAL);
+        CHECK(e->config.lenSz == RX_STREAM_LEN_SZ && e->length == PARTIAL_DATA_SIZE + 4);
+        CHECK(e->pktStatus.numElements == 0 && e->nextIndex == 0);
+        CHECK(e->pNextEntry == buf + (i + 1) % NUM_ENTRIES * stride);
+    }
+
+    /* The RF core ran out of entries in the middle of a packet */
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        rfc_dataEntryPartial_t * e = (rfc_dataEntryPartial_t *)(buf + i * stride);
+        e->status = DATA_ENTRY_FINISHED;
+        e->pktStatus.numElements = 1;
+        e->pktStatus.bFirstCont = i > 0;
+        e->pktStatus.bLastCont = 1;
+        e->nextIndex = PARTIAL_DATA_SIZE;
+    }
+    queue.pCurrEntry = NULL;
+    RFQueue_flushPartialQueue(&queue, &stream);
+    CHECK(queue.pCurrEntry == buf);
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        rfc_dataEntryPartial_t * e = (rfc_dataEntryPartial_t *)(buf + i * stride);
+        CHECK(e->status == DATA_ENTRY_PENDING && e->pktStatus.numElements == 0);
+        CHECK(e->pktStatus.bLastCont == 0 && e->nextIndex == 0);
+    }
+}
+
+int main(void) {
+
+    testGeneral();
+    testPartial();
+
+    return checkReport();
+}
@@ -0,0 +1,296 @@
+//
+//  rxStreamTest.c
+//  Tests of the partial read entry reader (rxStream.c) against the model of the RF core in
+//  rfCoreSim.c
+//
+//  Every packet length from 1 to 255 through a small pool, then timed traffic at 50 kbps:
+//  FIX frames, DATA frames and LOG batches of up to 17 fixes (242 bytes) from a tracker
+//  catching up, read by a gateway that gets to the queue latency after each packet end or
+//  finished entry. For a few pools the packets lost and the share decoded in place are
+//  printed with the RX memory they take, against the two general entries the same packet
+//  size needs. Then a reader that stops reading (PROP_ERROR_RXFULL and a flush) and a
+//  packet too long for the assembly buffer.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "fixEpoch.h"
+#include "packetCodec.h"
+#include "rfCoreSim.h"
+#include "rxStream.h"
+
+#define MAX_LENGTH          255
+#define NUM_APPENDED_BYTES  2       // length byte and status byte
+#define BYTE_US             160     // 50 kbps
+#define GAP_BYTES           12      // preamble, sync word and turnaround between packets
+#define TRAFFIC_PACKETS     20000
+
+// On the RF core: a general entry of RFQueue.h has an 8 byte header and is padded to 4, a
+// partial one a 12 byte header
+#define GENERAL_ENTRY(dataSize)     (8 + (dataSize) + 4 - ((dataSize) + 8) % 4)
+#define PARTIAL_ENTRY(dataSize)     ((12 + (dataSize) + 3) / 4 * 4)
+
+typedef struct {
+    uint8_t   entries;
+    uint16_t  dataSize;
+} Pool;
+
+typedef struct {
+    RxStream  stream;
+    SimRfCore core;
+    uint16_t  nextSeq;          // expected
+    uint32_t  received;
+    uint32_t  corrupt;
+    uint32_t  lost;
+} Rx;
+
+static uint8_t poolBuffer[4096] __attribute__((aligned(8)));
+static uint8_t assembly[1 + MAX_LENGTH + 1];
+static uint32_t rng = 0x2545F491;
+
+static uint32_t nextRandom(void) {
+
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+/* Length byte, payload numbered seq, status byte */
+static uint16_t makePacket(uint8_t * p, uint16_t seq, uint8_t length) {
+
+    uint16_t i;
+
+    p[0] = length;
+    for (i = 1; i <= length; ++i)
+        p[i] = (uint8_t)(seq * 31 + i * 7);
+    if (length >= 2) {
+        p[1] = (uint8_t)(seq >> 8);
+        p[2] = (uint8_t)seq;
+    }
+    p[length + 1] = 0x80;      // CRC ok
+
+    return length + NUM_APPENDED_BYTES;
+}
+
+static void rxInit(Rx * rx, const Pool * pool) {
+
+    memset(rx, 0, sizeof(*rx));
+    CHECK(rxStreamDefine(&rx->stream, poolBuffer, sizeof(poolBuffer), pool->entries, pool->dataSize,
+                         assembly, sizeof(assembly)) == 0);
+    simRfCoreInit(&rx->core, (uint8_t *)rx->stream.first);
+}
+
+/* Everything complete, checked against what was sent */
+static void drain(Rx * rx) {
+
+    const uint8_t * p;
+    uint8_t expected[1 + MAX_LENGTH + 1];
+    uint16_t n;
+
+    while ((n = rxStreamPacket(&rx->stream, &p)) > 0) {
+        uint16_t seq = p[0] >= 2 ? (uint16_t)(p[1] << 8 | p[2]) : rx->nextSeq;
+        if (n != makePacket(expected, seq, p[0]) || memcmp(p, expected, n) != 0 ||
+            (uint16_t)(seq - rx->nextSeq) > 0x8000) {
+            ++rx->corrupt;
+            continue;
+        }
+        rx->lost += (uint16_t)(seq - rx->nextSeq);
+        rx->nextSeq = seq + 1;
+        ++rx->received;
+    }
+}
+
+/* One packet, read at once after each finished entry and at its end. Returns 0 if the RF
+ * core stopped. */
+static uint8_t receive(Rx * rx, uint16_t seq, uint8_t length) {
+
+    uint8_t p[1 + MAX_LENGTH + 1];
+    uint16_t n = makePacket(p, seq, length), i;
+    uint32_t entries;
+
+    for (i = 0; i < n; ++i) {
+        entries = rx->core.entries;
+        if (!simRfCoreByte(&rx->core, p[i], i == 0))
+            return 0;
+        if (rx->core.entries != entries)
+            drain(rx);
+    }
+    simRfCoreEnd(&rx->core);
+    drain(rx);
+
+    return 1;
+}
+
+static void testEveryLength(void) {
+
+    static Rx rx;
+    Pool pool = { 3, 48 };
+    uint16_t length;
+
+    rxInit(&rx, &pool);
+    for (length = 1; length <= MAX_LENGTH; ++length)
+        CHECK(receive(&rx, length - 1, (uint8_t)length));
+
+    CHECK(rx.received == MAX_LENGTH);
+    CHECK(rx.corrupt == 0 && rx.lost == 0);
+    CHECK(rx.stream.broken == 0 && rx.stream.tooLong == 0);
+    CHECK(rx.core.cut == 0);
+    CHECK(rx.stream.spanning > 0 && rx.stream.spanning < MAX_LENGTH);
+}
+
+static uint8_t trafficLength(void) {
+
+    uint32_t r = nextRandom() % 100;
+
+    if (r < 70)
+        return PKT_HEADER_LENGTH + FIX_EPOCH_WIRE_LENGTH;
+    if (r < 90)
+        return (uint8_t)(PKT_HEADER_LENGTH + 60 + nextRandom() % 20);
+    return (uint8_t)(PKT_HEADER_LENGTH + (1 + nextRandom() % 17) * FIX_RECORD_WIRE_LENGTH);
+}
+
+/* Back to back packets; the gateway reads latencyUs after a packet end or finished entry */
+static void runTraffic(Rx * rx, const Pool * pool, uint32_t latencyUs) {
+
+    uint8_t p[1 + MAX_LENGTH + 1];
+    uint64_t nowUs = 0, drainUs = UINT64_MAX;
+    uint32_t k, entries;
+    uint16_t n, i;
+
+    rxInit(rx, pool);
+    rng = 0x2545F491;
+
+    for (k = 0; k < TRAFFIC_PACKETS; ++k) {
+        n = makePacket(p, (uint16_t)k, trafficLength());
+        for (i = 0; i < n + GAP_BYTES; ++i) {
+            nowUs += BYTE_US;
+            if (nowUs >= drainUs) {
+                drain(rx);
+                drainUs = UINT64_MAX;
+            }
+
+            entries = rx->core.entries;
+            if (i < n && !simRfCoreByte(&rx->core, p[i], i == 0)) {
+                /* PROP_ERROR_RXFULL: the gateway flushes and restarts RX */
+                simRfCoreRestart(&rx->core, rxStreamFlush(&rx->stream));
+            }
+            if (i == n - 1)
+                simRfCoreEnd(&rx->core);
+            if ((i == n - 1 || rx->core.entries != entries) && drainUs == UINT64_MAX)
+                drainUs = nowUs + latencyUs;
+        }
+    }
+    drain(rx);
+}
+
+static void testTraffic(void) {
+
+    static const Pool pools[] = { { 2, 32 }, { 2, 64 }, { 3, 48 }, { 4, 64 } };
+    static const uint32_t latencies[] = { 1000, 5000, 20000 };
+    static Rx rx;
+    uint32_t general = 2 * GENERAL_ENTRY(MAX_LENGTH + NUM_APPENDED_BYTES);
+    uint8_t i, j;
+
+    printf("%-10s %6s %6s  %s\n", "pool", "RX B", "vs gen", "lost / in place, at a latency of 1, 5, 20 ms");
+    printf("%-10s %6u %6s  (2 general entries of %u bytes)\n", "general", general, "",
+           MAX_LENGTH + NUM_APPENDED_BYTES);
+
+    for (i = 0; i < sizeof(pools) / sizeof(pools[0]); ++i) {
+        uint32_t bytes = pools[i].entries * PARTIAL_ENTRY(pools[i].dataSize) + (uint32_t)sizeof(assembly);
+        char name[16];
+
+        snprintf(name, sizeof(name), "%u x %u", pools[i].entries, pools[i].dataSize);
+        printf("%-10s %6u %5.0f%% ", name, bytes, 100.0 * bytes / general);
+
+        for (j = 0; j < sizeof(latencies) / sizeof(latencies[0]); ++j) {
+            runTraffic(&rx, &pools[i], latencies[j]);
+            CHECK(rx.corrupt == 0);
+            CHECK(rx.received + rx.lost == TRAFFIC_PACKETS);
+            CHECK(rx.lost == rx.core.cut + (rx.core.packets - rx.received));
+            printf(" %5.2f%% / %3.0f%%", 100.0 * rx.lost / TRAFFIC_PACKETS,
+                   100.0 * (rx.stream.packets - rx.stream.spanning) / rx.stream.packets);
+
+            /* The gateway's pool keeps up with the callback */
+            if (pools[i].entries == 2 && pools[i].dataSize == 64 && latencies[j] <= 5000)
+                CHECK(rx.lost == 0);
+        }
+        printf("\n");
+    }
+}
+
+/* Nobody reads: the RF core stops, the flush drops what was queued, then all is well */
+static void testRxFull(void) {
+
+    static Rx rx;
+    Pool pool = { 3, 48 };
+    uint8_t p[1 + MAX_LENGTH + 1];
+    uint16_t seq = 0, n, i;
+    uint8_t stopped = 0;
+
+    rxInit(&rx, &pool);
+    while (!stopped) {
+        n = makePacket(p, seq++, 40);
+        for (i = 0; i < n && !stopped; ++i)
+            stopped = !simRfCoreByte(&rx.core, p[i], i == 0);
+        if (!stopped)
+            simRfCoreEnd(&rx.core);
+    }
+    CHECK(rx.core.cut == 1);
+    CHECK(simRfCoreByte(&rx.core, 0, 1) == 0);
+
+    /* Half of the first entry read, then the flush */
+    const uint8_t * packet;
+    CHECK(rxStreamPacket(&rx.stream, &packet) > 0);
+    simRfCoreRestart(&rx.core, rxStreamFlush(&rx.stream));
+    CHECK(rxStreamPacket(&rx.stream, &packet) == 0);
+
+    rx.nextSeq = seq;
+    for (i = 0; i < 10; ++i)
+        CHECK(receive(&rx, seq++, (uint8_t)(20 + i * 20)));
+    CHECK(rx.received == 10 && rx.corrupt == 0 && rx.lost == 0);
+}
+
+/* A packet longer than the assembly buffer is dropped whole, the next one is fine */
+static void testTooLong(void) {
+
+    static RxStream stream;
+    static SimRfCore core;
+    uint8_t small[64];
+    uint8_t p[1 + MAX_LENGTH + 1];
+    const uint8_t * packet;
+    uint16_t n, i, k;
+
+    CHECK(rxStreamDefine(&stream, poolBuffer, sizeof(poolBuffer), 4, 32, small, sizeof(small)) == 0);
+    simRfCoreInit(&core, (uint8_t *)stream.first);
+
+    for (k = 0; k < 2; ++k) {
+        n = makePacket(p, k, k == 0 ? 100 : 50);
+        for (i = 0; i < n; ++i) {
+            simRfCoreByte(&core, p[i], i == 0);
+            if (i % 16 == 0)
+                CHECK(k == 1 || rxStreamPacket(&stream, &packet) == 0);
+        }
+        simRfCoreEnd(&core);
+    }
+
+    CHECK(rxStreamPacket(&stream, &packet) == 52);
+    CHECK(packet[0] == 50 && packet[2] == 1);
+    CHECK(stream.tooLong == 1 && stream.packets == 1);
+    CHECK(rxStreamPacket(&stream, &packet) == 0);
+
+    /* A pool that does not fit its buffer */
+    CHECK(rxStreamDefine(&stream, poolBuffer, 100, 4, 32, NULL, 0) == 1);
+}
+
+int main(void) {
+
+    testEveryLength();
+    testTraffic();
+    testRxFull();
+    testTooLong();
+
+    return checkReport();
+}
@@ -0,0 +1,290 @@
+//
+//  secureLinkTest.c
+//  Tests of sealed frames and their replay protection (secureLink.c) with the software
+//  AES-CCM stand-in
+//
+//  The gateway takes a counter once within SECURE_REPLAY_WINDOW, in any order, gives
+//  retransmissions back as duplicates and rejects what is older. A wrapped sequence number
+//  moves the tracker to the next epoch, which it announces; a restarted gateway picks it
+//  up from the next announcement, and a tracker that boots into an old epoch is not
+//  heard. A tracker pushed out of the peer table by others is held to its newest counter
+//  when it comes back. A frame with any bit flipped, cut short, unsealed or sealed under
+//  another key is rejected and leaves the window as it was.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "packetCodec.h"
+#include "secureLink.h"
+#include "softCcm.h"
+
+#define MAX_FRAME       102     // MAX_LENGTH of the gateway
+#define PAYLOAD         20
+#define NODE_ID         7
+#define FRAMES          80
+
+typedef struct {
+    uint8_t buf[MAX_FRAME];
+    uint8_t length;
+} Sealed;
+
+static const uint8_t networkKey[SECURE_KEY_LENGTH] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static SoftCcm txCcm, rxCcm;
+static const SecureCipher txCipher = { &txCcm, softCcmSetKey, softCcmEncrypt, softCcmDecrypt };
+static const SecureCipher rxCipher = { &rxCcm, softCcmSetKey, softCcmEncrypt, softCcmDecrypt };
+
+static uint8_t plainFrame(uint8_t * buf, uint8_t nodeId, uint16_t seq) {
+
+    PacketHeader hdr = { PKT_TYPE_DATA, 0, nodeId, seq };
+    uint8_t i;
+
+    pktEncodeHeader(&hdr, buf);
+    for (i = 0; i < PAYLOAD; ++i)
+        buf[PKT_HEADER_LENGTH + i] = (uint8_t)(seq + i);
+
+    return PKT_HEADER_LENGTH + PAYLOAD;
+}
+
+static void sealAs(SecureNode * node, uint8_t nodeId, uint16_t seq, Sealed * out) {
+
+    out->length = secureSeal(node, out->buf, plainFrame(out->buf, nodeId, seq), MAX_FRAME);
+    CHECK(out->length > 0);
+}
+
+static void seal(SecureNode * node, uint16_t seq, Sealed * out) {
+
+    sealAs(node, NODE_ID, seq, out);
+}
+
+/* Opens a copy of the frame; what comes out must be the plain frame again */
+static SecureStatus openCopy(SecureGateway * gw, const Sealed * frame) {
+
+    uint8_t buf[MAX_FRAME], plain[MAX_FRAME];
+    uint8_t length = frame->length;
+    PacketHeader hdr;
+
+    memcpy(buf, frame->buf, length);
+    SecureStatus status = secureOpen(gw, buf, &length);
+
+    if (status != SECURE_REJECTED) {
+        CHECK(pktDecodeHeader(&hdr, buf, length) == 0);
+        CHECK(length == plainFrame(plain, hdr.nodeId, hdr.seq) && memcmp(buf, plain, length) == 0);
+    }
+    return status;
+}
+
+static void testReplayWindow(void) {
+
+    static SecureNode node;
+    static SecureGateway gw;
+    static Sealed frames[FRAMES];
+    uint16_t i;
+
+    secureNodeInit(&node, &txCipher, networkKey, 1);
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+    for (i = 0; i < FRAMES; ++i)
+        seal(&node, (uint16_t)(100 + i), &frames[i]);
+
+    CHECK(openCopy(&gw, &frames[0]) == SECURE_NEW);
+    CHECK(openCopy(&gw, &frames[0]) == SECURE_DUPLICATE);
+    CHECK(gw.duplicates == 1);
+
+    /* 1 and 2 held back, 3 to 33 in order */
+    for (i = 3; i <= 33; ++i)
+        CHECK(openCopy(&gw, &frames[i]) == SECURE_NEW);
+
+    /* Out of order inside the window: once, then as a duplicate */
+    CHECK(openCopy(&gw, &frames[20]) == SECURE_DUPLICATE);
+    CHECK(openCopy(&gw, &frames[2]) == SECURE_NEW);
+    CHECK(openCopy(&gw, &frames[2]) == SECURE_DUPLICATE);
+
+    /* 1 and 0 are SECURE_REPLAY_WINDOW and more behind 33 */
+    CHECK(openCopy(&gw, &frames[1]) == SECURE_REJECTED);
+    CHECK(openCopy(&gw, &frames[0]) == SECURE_REJECTED);
+    CHECK(gw.rejected == 2);
+
+    /* A jump past the window forgets it, what lies inside the new one is still taken */
+    CHECK(openCopy(&gw, &frames[FRAMES - 1]) == SECURE_NEW);
+    CHECK(openCopy(&gw, &frames[FRAMES - SECURE_REPLAY_WINDOW]) == SECURE_NEW);
+    CHECK(openCopy(&gw, &frames[FRAMES - SECURE_REPLAY_WINDOW - 1]) == SECURE_REJECTED);
+    CHECK(openCopy(&gw, &frames[FRAMES - 1]) == SECURE_DUPLICATE);
+    CHECK(gw.duplicates == 4 && gw.rejected == 3);
+}
+
+static void testEpoch(void) {
+
+    static SecureNode node;
+    static SecureGateway gw;
+    Sealed last, wrapped, frame;
+    uint16_t seq;
+
+    secureNodeInit(&node, &txCipher, networkKey, 5);
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+
+    seal(&node, 0xFFFE, &frame);
+    CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+    seal(&node, 0xFFFF, &last);
+    CHECK(openCopy(&gw, &last) == SECURE_NEW);
+
+    /* The sequence number wraps: epoch 6, announced */
+    seal(&node, 0, &wrapped);
+    CHECK(node.epoch == 6);
+    CHECK((wrapped.buf[0] >> 4) == (PKT_FLAG_SECURE | PKT_FLAG_EPOCH));
+    CHECK(wrapped.buf[PKT_HEADER_LENGTH] == 0 && wrapped.buf[PKT_HEADER_LENGTH + 1] == 6);
+    CHECK(openCopy(&gw, &wrapped) == SECURE_NEW);
+
+    /* The last frames of epoch 5 are right behind it in the window */
+    CHECK(openCopy(&gw, &last) == SECURE_DUPLICATE);
+
+    /* The announcement ends, then comes back every SECURE_EPOCH_INTERVAL-th frame */
+    for (seq = 1; seq < SECURE_EPOCH_ANNOUNCE; ++seq) {
+        seal(&node, seq, &frame);
+        CHECK(frame.buf[0] & (PKT_FLAG_EPOCH << 4));
+        CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+    }
+    for (seq = SECURE_EPOCH_ANNOUNCE; seq < SECURE_EPOCH_ANNOUNCE + SECURE_EPOCH_INTERVAL - 1; ++seq) {
+        seal(&node, seq, &frame);
+        CHECK(!(frame.buf[0] & (PKT_FLAG_EPOCH << 4)));
+        CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+    }
+
+    /* A restarted gateway does not know the epoch until it is announced again */
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+    CHECK(openCopy(&gw, &frame) == SECURE_REJECTED);
+    seal(&node, seq, &frame);
+    CHECK(frame.buf[0] & (PKT_FLAG_EPOCH << 4));
+    CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+
+    /* Booting into the next epoch is heard, booting into an old one is not */
+    secureNodeInit(&node, &txCipher, networkKey, 7);
+    seal(&node, 0, &frame);
+    CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+    secureNodeInit(&node, &txCipher, networkKey, 6);
+    seal(&node, (uint16_t)(seq + 1), &frame);
+    CHECK(openCopy(&gw, &frame) == SECURE_REJECTED);
+
+    /* The key has no epoch left after 0xFFFF */
+    secureNodeInit(&node, &txCipher, networkKey, 0xFFFF);
+    seal(&node, 0xFFFF, &frame);
+    CHECK(secureSeal(&node, frame.buf, plainFrame(frame.buf, NODE_ID, 0), MAX_FRAME) == 0);
+}
+
+static void testForgotten(void) {
+
+    static SecureNode node, others[SECURE_MAX_PEERS];
+    static SecureGateway gw;
+    Sealed announced, late, frame;
+    uint8_t i;
+
+    secureNodeInit(&node, &txCipher, networkKey, 3);
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+    seal(&node, 10, &announced);
+    CHECK(announced.buf[0] & (PKT_FLAG_EPOCH << 4));
+    CHECK(openCopy(&gw, &announced) == SECURE_NEW);
+    seal(&node, 11, &late);
+    seal(&node, 12, &frame);
+    CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+
+    /* SECURE_MAX_PEERS other trackers take every window, the oldest first */
+    for (i = 0; i < SECURE_MAX_PEERS; ++i) {
+        secureNodeInit(&others[i], &txCipher, networkKey, 1);
+        sealAs(&others[i], (uint8_t)(NODE_ID + 1 + i), 1, &frame);
+        CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+    }
+
+    /* Its recorded frames do not bring it back, its next one does */
+    CHECK(openCopy(&gw, &announced) == SECURE_REJECTED);
+    CHECK(openCopy(&gw, &late) == SECURE_REJECTED);
+    seal(&node, 13, &frame);
+    CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+
+    /* Everything up to the counter it was forgotten with counts as seen, 11 too */
+    CHECK(openCopy(&gw, &announced) == SECURE_DUPLICATE);
+    CHECK(openCopy(&gw, &late) == SECURE_DUPLICATE);
+
+    /* A restarted gateway has nothing to hold them to: the limit secureLink.h describes */
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+    CHECK(openCopy(&gw, &announced) == SECURE_NEW);
+}
+
+static void testTampered(void) {
+
+    static SecureNode node;
+    static SecureGateway gw;
+    static SoftCcm otherCcm;
+    static const SecureCipher otherCipher = { &otherCcm, softCcmSetKey, softCcmEncrypt, softCcmDecrypt };
+    static const uint8_t otherKey[SECURE_KEY_LENGTH] = { 1 };
+    SecureNode other;
+    Sealed genuine, frame;
+    uint8_t i, bit;
+    uint16_t seq;
+    uint32_t rejected = 0;
+
+    secureNodeInit(&node, &txCipher, networkKey, 1);
+    secureGatewayInit(&gw, &rxCipher, networkKey);
+    seal(&node, 1, &frame);
+    CHECK(openCopy(&gw, &frame) == SECURE_NEW);
+
+    /* Header, epoch, payload and MIC: any flipped bit, of a frame with the epoch and of
+     * one without */
+    seal(&node, 2, &genuine);
+    CHECK(genuine.buf[0] & (PKT_FLAG_EPOCH << 4));
+    for (i = 0; i < genuine.length; ++i)
+        for (bit = 0; bit < 8; ++bit) {
+            frame = genuine;
+            frame.buf[i] ^= (uint8_t)(1 << bit);
+            CHECK(openCopy(&gw, &frame) == SECURE_REJECTED);
+            ++rejected;
+        }
+    CHECK(openCopy(&gw, &genuine) == SECURE_NEW);
+
+    for (seq = 3; node.announce > 0; ++seq)
+        seal(&node, seq, &genuine);
+    seal(&node, seq, &genuine);
+    CHECK(!(genuine.buf[0] & (PKT_FLAG_EPOCH << 4)));
+    for (i = 0; i < genuine.length; ++i)
+        for (bit = 0; bit < 8; ++bit) {
+            frame = genuine;
+            frame.buf[i] ^= (uint8_t)(1 << bit);
+            CHECK(openCopy(&gw, &frame) == SECURE_REJECTED);
+            ++rejected;
+        }
+
+    /* Cut short, down to the header */
+    for (i = PKT_HEADER_LENGTH; i < genuine.length; ++i) {
+        frame = genuine;
+        frame.length = i;
+        CHECK(openCopy(&gw, &frame) == SECURE_REJECTED);
+        ++rejected;
+    }
+
+    /* Unsealed, and sealed under another key */
+    frame.length = plainFrame(frame.buf, NODE_ID, 5);
+    CHECK(openCopy(&gw, &frame) == SECURE_REJECTED);
+    secureNodeInit(&other, &otherCipher, otherKey, 1);
+    seal(&other, 5, &frame);
+    CHECK(openCopy(&gw, &frame) == SECURE_REJECTED);
+    rejected += 2;
+
+    /* None of them moved the window */
+    CHECK(gw.rejected == rejected);
+    CHECK(gw.duplicates == 0);
+    CHECK(openCopy(&gw, &genuine) == SECURE_NEW);
+}
+
+int main(void) {
+
+    CHECK(secureSelfTest(&txCipher) == 0);
+
+    testReplayWindow();
+    testEpoch();
+    testForgotten();
+    testTampered();
+
+    return checkReport();
+}
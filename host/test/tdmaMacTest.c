@@ -0,0 +1,186 @@
+//
+//  tdmaMacTest.c
+//  Tests of the TDMA slot allocation and of the beacon that carries it (tdmaMac.c)
+//
+//  The gateway hands out each data slot once, gives a tracker the slot it already owns,
+//  turns trackers away when the frame is full, and frees a slot when its owner leaves or
+//  stays silent past TDMA_EXPIRY_FRAMES. The beacon brings layout and slot map to the
+//  tracker intact, malformed ones are refused. A tracker drops its slot after
+//  TDMA_MAX_MISSED_BEACONS, and its JOINs stay in the join slots and back off.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "packetCodec.h"
+#include "tdmaMac.h"
+
+#define MAX_BEACON  (PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS))
+
+static void testJoinLeave(void) {
+
+    TdmaFrameConfig cfg;
+    TdmaGateway gw;
+    uint8_t id;
+
+    tdmaDefaultConfig(&cfg);
+    cfg.numSlots = 4;
+    tdmaGatewayInit(&gw, &cfg);
+
+    /* Reserved ids never get a slot */
+    CHECK(tdmaGatewayJoin(&gw, TDMA_FREE_SLOT) == TDMA_NO_SLOT);
+    CHECK(tdmaGatewayJoin(&gw, PKT_BROADCAST_ID) == TDMA_NO_SLOT);
+
+    /* First come first served, a JOIN again keeps the slot */
+    for (id = 1; id <= 4; ++id)
+        CHECK(tdmaGatewayJoin(&gw, id) == id - 1);
+    CHECK(tdmaGatewayJoin(&gw, 3) == 2);
+    CHECK(tdmaGatewayJoin(&gw, 5) == TDMA_NO_SLOT);
+    CHECK(tdmaGatewayHeard(&gw, 5) == TDMA_NO_SLOT);
+
+    /* A LEAVE frees the slot for the next one */
+    tdmaGatewayLeave(&gw, 2);
+    tdmaGatewayLeave(&gw, 9);
+    CHECK(gw.owner[1] == TDMA_FREE_SLOT);
+    CHECK(tdmaGatewayJoin(&gw, 5) == 1);
+    CHECK(tdmaGatewayHeard(&gw, 5) == 1);
+
+    /* More slots asked for than there are */
+    cfg.numSlots = TDMA_MAX_SLOTS + 1;
+    tdmaGatewayInit(&gw, &cfg);
+    CHECK(gw.cfg.numSlots == TDMA_MAX_SLOTS);
+}
+
+static void testExpiry(void) {
+
+    TdmaFrameConfig cfg;
+    TdmaGateway gw;
+    uint8_t frame;
+
+    tdmaDefaultConfig(&cfg);
+    tdmaGatewayInit(&gw, &cfg);
+    CHECK(tdmaGatewayJoin(&gw, 7) == 0);
+    CHECK(tdmaGatewayJoin(&gw, 8) == 1);
+    gw.cfg.rate[1] = (uint8_t)(PHY_PROFILE + 1) % PHY_NUM_PROFILES;
+
+    /* 7 keeps talking, 8 goes silent */
+    for (frame = 0; frame < TDMA_EXPIRY_FRAMES; ++frame) {
+        tdmaGatewayHeard(&gw, 7);
+        tdmaGatewayEndFrame(&gw);
+    }
+    CHECK(gw.owner[1] == 8);
+
+    tdmaGatewayEndFrame(&gw);
+    CHECK(gw.owner[0] == 7);
+    CHECK(gw.owner[1] == TDMA_FREE_SLOT && gw.cfg.rate[1] == PHY_PROFILE);
+    CHECK(tdmaGatewayHeard(&gw, 8) == TDMA_NO_SLOT);
+}
+
+static void testBeacon(void) {
+
+    uint8_t buf[MAX_BEACON];
+    TdmaFrameConfig cfg;
+    TdmaGateway gw;
+    TdmaNode node, other;
+    PacketHeader hdr;
+    uint8_t length, i;
+
+    tdmaDefaultConfig(&cfg);
+    cfg.numSlots = 6;
+    cfg.numJoinSlots = 3;
+    tdmaGatewayInit(&gw, &cfg);
+    CHECK(tdmaGatewayJoin(&gw, 20) == 0);
+    CHECK(tdmaGatewayJoin(&gw, 21) == 1);
+    CHECK(tdmaGatewayJoin(&gw, 22) == 2);
+    tdmaGatewayLeave(&gw, 21);
+    for (i = 0; i < cfg.numSlots; ++i)
+        gw.cfg.rate[i] = (uint8_t)(i % PHY_NUM_PROFILES);
+
+    CHECK(tdmaGatewayBuildBeacon(&gw, buf, PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(6) - 1) == 0);
+    length = tdmaGatewayBuildBeacon(&gw, buf, sizeof(buf));
+    CHECK(length == PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(6));
+    CHECK(pktDecodeHeader(&hdr, buf, length) == 0);
+    CHECK(hdr.type == PKT_TYPE_BEACON && hdr.nodeId == PKT_GATEWAY_ID && hdr.seq == 0);
+
+    /* Layout, rates and slot map arrive as sent */
+    tdmaNodeInit(&node, 22);
+    node.joinAttempts = 3;
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH) == 0);
+    CHECK(node.synced && node.slot == 2 && node.joinAttempts == 0);
+    CHECK(node.cfg.slotMs == cfg.slotMs && node.cfg.beaconMs == cfg.beaconMs);
+    CHECK(node.cfg.numSlots == 6 && node.cfg.numJoinSlots == 3);
+    for (i = 0; i < TDMA_MAX_SLOTS; ++i)
+        CHECK(node.cfg.rate[i] == (i < 6 ? i % PHY_NUM_PROFILES : PHY_PROFILE));
+    for (i = 0; i <= 6 + 3; ++i)
+        CHECK(tdmaSlotOffsetUs(&node.cfg, i) == tdmaSlotOffsetUs(&gw.cfg, i));
+
+    tdmaNodeInit(&other, 21);
+    CHECK(tdmaNodeOnBeacon(&other, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH) == 0);
+    CHECK(other.synced && other.slot == TDMA_NO_SLOT);
+
+    /* Cut short, too many slots, no slot length: refused, the tracker keeps what it had */
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH - 1) == 1);
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, TDMA_BEACON_PAYLOAD_LENGTH(0) - 1) == 1);
+    buf[PKT_HEADER_LENGTH + 4] = TDMA_MAX_SLOTS + 1;
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH) == 1);
+    buf[PKT_HEADER_LENGTH + 4] = 6;
+    buf[PKT_HEADER_LENGTH] = buf[PKT_HEADER_LENGTH + 1] = 0;
+    CHECK(tdmaNodeOnBeacon(&node, buf + PKT_HEADER_LENGTH, length - PKT_HEADER_LENGTH) == 1);
+    CHECK(node.slot == 2 && node.cfg.numSlots == 6);
+
+    /* Beacons missed: the slot goes with the sync */
+    for (i = 1; i < TDMA_MAX_MISSED_BEACONS; ++i)
+        tdmaNodeBeaconMissed(&node);
+    CHECK(node.synced && node.slot == 2);
+    tdmaNodeBeaconMissed(&node);
+    CHECK(!node.synced && node.slot == TDMA_NO_SLOT);
+}
+
+static void testJoinSlots(void) {
+
+    TdmaNode node;
+    uint32_t random = 12345;
+    uint16_t sent = 0, beacon;
+    uint8_t backoff, k;
+
+    tdmaNodeInit(&node, 9);
+    node.cfg.numSlots = 10;
+    node.cfg.numJoinSlots = 3;
+
+    /* A join slot after every backoff; the next backoff stays below 2^attempts */
+    for (beacon = 0; beacon < 200; ++beacon) {
+
+        uint8_t attemptsBefore = node.joinAttempts;
+        uint8_t slot;
+
+        random = random * 1103515245 + 12345;
+        slot = tdmaNodeJoinSlot(&node, random);
+        ++sent;
+        CHECK(slot >= 10 && slot < 13);
+        CHECK(node.joinBackoff < (1u << attemptsBefore));
+        CHECK(node.joinAttempts <= TDMA_MAX_JOIN_BACKOFF);
+
+        /* Sits out exactly the backoff */
+        backoff = node.joinBackoff;
+        for (k = 0; k < backoff; ++k)
+            CHECK(tdmaNodeJoinSlot(&node, random) == TDMA_NO_SLOT);
+        beacon += backoff;
+    }
+    CHECK(sent > 200 / (1u << TDMA_MAX_JOIN_BACKOFF));
+    CHECK(node.joinAttempts == TDMA_MAX_JOIN_BACKOFF);
+
+    /* No join slots, no JOIN */
+    node.cfg.numJoinSlots = 0;
+    CHECK(tdmaNodeJoinSlot(&node, random) == TDMA_NO_SLOT);
+}
+
+int main(void) {
+
+    testJoinLeave();
+    testExpiry();
+    testBeacon();
+    testJoinSlots();
+
+    return checkReport();
+}
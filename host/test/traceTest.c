@@ -0,0 +1,214 @@
+//
+//  traceTest.c
+//  Tests of the trace ring (trace.c) on the host clock
+//
+//  The ring keeps the last TRACE_RING_SIZE records in order, a record being written is left
+//  out of the dump, and records from several threads at once all arrive whole. Then the
+//  gateway's receive path of DATA frames (nmeaSim.h sentences parsed in place and
+//  formatted) is traced like the firmware does; given a file, its dump is written there
+//  between lines of text, as a UART capture has it, for host/tools/traceTool.c.
+//
+//  usage: traceTest [capture]
+//
+
+#define TRACE_ENABLED 1
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "gpsParser.h"
+#include "nmeaSim.h"
+#include "trace.h"
+
+#define THREADS             4
+#define THREAD_RECORDS      100000
+#define FRAMES              40
+
+typedef struct {
+    uint8_t   data[TRACE_HEADER_LENGTH + TRACE_RING_SIZE * TRACE_RECORD_LENGTH];
+    uint16_t  length;
+} Dump;
+
+static void dumpWrite(void * ctx, const uint8_t * data, uint16_t length) {
+
+    Dump * d = ctx;
+
+    if (d->length + length > sizeof(d->data))
+        return;
+    memcpy(d->data + d->length, data, length);
+    d->length += length;
+}
+
+static void fileWrite(void * ctx, const uint8_t * data, uint16_t length) {
+
+    fwrite(data, 1, length, (FILE *)ctx);
+}
+
+static uint32_t getU32(const uint8_t * p) {
+
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+/* Every record of the dump: consecutive indices ending before head, the time not going
+ * back by more than skew. Returns how many. */
+static uint16_t checkDump(const Dump * d, uint32_t skew) {
+
+    uint32_t head = getU32(d->data + 8);
+    uint16_t n = (uint16_t)((d->length - TRACE_HEADER_LENGTH) / TRACE_RECORD_LENGTH), i;
+    const uint8_t * r = d->data + TRACE_HEADER_LENGTH;
+    uint32_t last = getU32(r);
+
+    CHECK(getU32(d->data) == TRACE_MAGIC && getU32(d->data + 4) == TRACE_HZ);
+    for (i = 0; i < n; ++i, r += TRACE_RECORD_LENGTH) {
+        uint16_t seq = (uint16_t)(r[4] << 8 | r[5]);
+        CHECK(seq == (uint16_t)(head - n + i));
+        CHECK(r[6] < TRACE_POINTS && r[7] <= TRACE_KIND_MARK);
+        CHECK((int32_t)(getU32(r) - last) >= -(int32_t)skew);
+        last = getU32(r);
+    }
+    return n;
+}
+
+static void testRing(void) {
+
+    static Dump d;
+    uint32_t i;
+
+    /* Fewer than the ring holds */
+    traceInit();
+    for (i = 0; i < 10; ++i)
+        TRACE_MARK(TRACE_RF_DONE);
+    d.length = 0;
+    CHECK(traceDump(dumpWrite, &d) == 10);
+    CHECK(checkDump(&d, 0) == 10);
+    CHECK(d.data[12] == 0 && d.data[13] == 10);
+
+    /* Wrapped: the last TRACE_RING_SIZE, oldest first */
+    for (i = 0; i < 3 * TRACE_RING_SIZE + 5; ++i)
+        traceRecord(i % TRACE_POINTS, i % 2);
+    d.length = 0;
+    CHECK(traceDump(dumpWrite, &d) == TRACE_RING_SIZE);
+    CHECK(checkDump(&d, 0) == TRACE_RING_SIZE);
+    CHECK(d.data[TRACE_HEADER_LENGTH + 6] == (2 * TRACE_RING_SIZE + 5) % TRACE_POINTS);
+
+    /* A writer stopped between taking its index and finishing: left out */
+    uint32_t busy = traceRing.head - 7;
+    traceRing.records[busy % TRACE_RING_SIZE].seq = (uint16_t)~busy;
+    d.length = 0;
+    CHECK(traceDump(dumpWrite, &d) == TRACE_RING_SIZE - 1);
+}
+
+static void * recordThread(void * arg) {
+
+    uint32_t i;
+
+    for (i = 0; i < THREAD_RECORDS; ++i)
+        traceRecord((uint8_t)(uintptr_t)arg, TRACE_KIND_MARK);
+    return NULL;
+}
+
+/* Threads stand in for the callback and the task: no index is lost or given twice, and a
+ * dump taken while they write has only whole records */
+static void testConcurrent(void) {
+
+    static Dump d;
+    pthread_t threads[THREADS];
+    uint32_t i;
+
+    traceInit();
+    for (i = 0; i < THREADS; ++i)
+        pthread_create(&threads[i], NULL, recordThread, (void *)(uintptr_t)i);
+    /* At least one dump, should the threads be halfway before it */
+    do {
+        d.length = 0;
+        traceDump(dumpWrite, &d);
+        const uint8_t * r = d.data + TRACE_HEADER_LENGTH;
+        for (; r < d.data + d.length; r += TRACE_RECORD_LENGTH)
+            CHECK(r[6] < THREADS && r[7] == TRACE_KIND_MARK);
+    } while (traceRing.head < THREADS * THREAD_RECORDS / 2);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join(threads[i], NULL);
+
+    CHECK(traceRing.head == THREADS * THREAD_RECORDS);
+    d.length = 0;
+    CHECK(traceDump(dumpWrite, &d) == TRACE_RING_SIZE);
+}
+
+/* The gateway's DATA frame path, traced as rfPacketRx.c does */
+static void traceReceivePath(void) {
+
+    SimSky sky;
+    SimNmeaEpoch e;
+    GPSData data;
+    char line[SIM_NMEA_MAX_LENGTH];
+    char out[120];
+    uint32_t i;
+
+    simSkyInit(&sky, 0x41);
+    memset(&e, 0, sizeof(e));
+    e.day = 19;
+    e.month = 10;
+    e.year = 2026;
+    e.latE7 = 455017000;
+    e.lonE7 = -735673000;
+    e.altM = 41.2;
+    nmeaDataInit(&data);
+
+    for (i = 0; i < FRAMES; ++i) {
+        uint8_t n;
+        if (i % 2 == 0) {
+            simSkyStep(&sky, &e.sky);
+            e.timeMs = (43200 + i / 2) * 1000;
+            n = simNmeaGGA(&e, "GN", line);
+        }
+        else
+            n = simNmeaRMC(&e, "GN", line);
+
+        TRACE_BEGIN(TRACE_RX_CALLBACK);
+        TRACE_BEGIN(TRACE_RX_FRAME);
+        TRACE_BEGIN(TRACE_NMEA_PARSE);
+        uint8_t failed = nmeaReceiveView(&data, line, n) || nmeaParse(&data);
+        TRACE_END(TRACE_NMEA_PARSE);
+        TRACE_BEGIN(TRACE_FORMAT);
+        nmeaToString(&data, out);
+        TRACE_END(TRACE_FORMAT);
+        TRACE_BEGIN(TRACE_UART_WRITE);
+        TRACE_END(TRACE_UART_WRITE);
+        TRACE_END(TRACE_RX_FRAME);
+        TRACE_END(TRACE_RX_CALLBACK);
+        CHECK(!failed);
+    }
+}
+
+static void testReceivePath(const char * capture) {
+
+    static Dump d;
+
+    traceInit();
+    traceReceivePath();
+    d.length = 0;
+    CHECK(traceDump(dumpWrite, &d) == TRACE_RING_SIZE);
+    CHECK(checkDump(&d, 0) == TRACE_RING_SIZE);
+
+    if (capture == NULL)
+        return;
+    FILE * f = fopen(capture, "wb");
+    CHECK(f != NULL);
+    if (f == NULL)
+        return;
+    fprintf(f, "12:00:00\tlatitude:\t45.5017000N\tlongitude:\t73.5673000W\r\n");
+    traceDump(fileWrite, f);
+    fprintf(f, "12:00:01\tlatitude:\t45.5017000N\tlongitude:\t73.5674450W\r\n");
+    fclose(f);
+}
+
+int main(int argc, char * argv[]) {
+
+    testRing();
+    testConcurrent();
+    testReceivePath(argc > 1 ? argv[1] : NULL);
+
+    return checkReport();
+}
@@ -0,0 +1,184 @@
+//
+//  trackCompressTest.c
+//  Tests of the track compression (trackCompress.c) against its error bound
+//
+//  Every fix of a bending, zigzagging track across midnight is redrawn from the vertices,
+//  interpolated by time, within toleranceCm. A straight track gets a vertex every window
+//  fixes, a parked one every maxGapS; repeated fixes are ignored and the flush ends the
+//  track on its newest fix.
+//
+
+#include <stdio.h>
+
+#include "check.h"
+#include "geoPlane.h"
+#include "trackCompress.h"
+
+#define ORIGIN_LAT_E7   -337000000
+#define ORIGIN_LON_E7   1511000000
+#define DAY_MS          86400000UL
+#define TRACK_FIXES     1200
+#define MAX_VERTICES    TRACK_FIXES
+
+static GeoPlane plane;
+static FixRecord track[TRACK_FIXES];
+static FixRecord vertices[MAX_VERTICES];
+
+static FixRecord fixAt(uint32_t timeMs, int64_t east, int64_t north) {
+
+    FixRecord fix;
+
+    fix.timeMs = timeMs % DAY_MS;
+    geoUnproject(&plane, east, north, &fix.latE7, &fix.lonE7);
+    fix.altM = 0;
+    return fix;
+}
+
+/* Pushes the track through a compressor, flush included; returns the number of vertices */
+static uint16_t compress(const TrackCompressConfig * cfg, const FixRecord * fixes, uint16_t count) {
+
+    TrackCompressor c;
+    uint16_t n = 0, i;
+
+    trackCompressInit(&c, cfg);
+    for (i = 0; i < count; ++i)
+        if (trackCompressPush(&c, &fixes[i], &vertices[n]))
+            ++n;
+    if (trackCompressFlush(&c, &vertices[n]))
+        ++n;
+    CHECK(!trackCompressFlush(&c, &vertices[n]));
+    CHECK(c.fixes == count && c.vertices == n);
+
+    return n;
+}
+
+static uint32_t elapsedMs(uint32_t from, uint32_t to) {
+
+    return (to + DAY_MS - from) % DAY_MS;
+}
+
+/* Largest distance of a fix from the track redrawn by the vertices, cm squared */
+static int64_t worstError2(const FixRecord * fixes, uint16_t count, uint16_t numVertices) {
+
+    int64_t worst = 0;
+    uint16_t v = 0, i;
+
+    for (i = 0; i < count; ++i) {
+
+        GeoPlane local;
+        int64_t endEast, endNorth, east, north, span, t;
+
+        /* The segment through this fix, on a plane around its start */
+        while (v + 1 < numVertices && elapsedMs(fixes[0].timeMs, vertices[v + 1].timeMs) <
+                                      elapsedMs(fixes[0].timeMs, fixes[i].timeMs))
+            ++v;
+        if (fixes[i].timeMs == vertices[v].timeMs)
+            continue;
+
+        CHECK(v + 1 < numVertices);
+        geoPlaneInit(&local, vertices[v].latE7, vertices[v].lonE7);
+        geoProject(&local, vertices[v + 1].latE7, vertices[v + 1].lonE7, &endEast, &endNorth);
+        geoProject(&local, fixes[i].latE7, fixes[i].lonE7, &east, &north);
+        span = elapsedMs(vertices[v].timeMs, vertices[v + 1].timeMs);
+        t = elapsedMs(vertices[v].timeMs, fixes[i].timeMs);
+        east  -= endEast * t / span;
+        north -= endNorth * t / span;
+
+        if (east * east + north * north > worst)
+            worst = east * east + north * north;
+    }
+
+    return worst;
+}
+
+static void testErrorBound(void) {
+
+    TrackCompressConfig cfg;
+    uint32_t start = DAY_MS - 600000;
+    int64_t east = 0, north = 0;
+    uint16_t tolerance, numVertices, i;
+
+    /* 8 m/s along a parabola, then zigzagging, then round a square */
+    for (i = 0; i < TRACK_FIXES; ++i) {
+        if (i < 400) {
+            east  = 800 * (int64_t)i;
+            north = 3 * (int64_t)i * i;
+        }
+        else if (i < 800) {
+            north += 800;
+            east  += (i / 4) % 2 ? 300 : -300;
+        }
+        else {
+            east  += (i / 50) % 4 == 0 ? 800 : (i / 50) % 4 == 2 ? -800 : 0;
+            north += (i / 50) % 4 == 1 ? 800 : (i / 50) % 4 == 3 ? -800 : 0;
+        }
+        track[i] = fixAt(start + i * 1000UL, east, north);
+    }
+
+    trackCompressDefaultConfig(&cfg);
+    for (tolerance = 100; tolerance <= 5000; tolerance *= 5) {
+
+        int64_t bound = tolerance + 5;
+
+        cfg.toleranceCm = tolerance;
+        numVertices = compress(&cfg, track, TRACK_FIXES);
+
+        /* The first fix and the last are vertices, and a looser bound needs fewer */
+        CHECK(vertices[0].timeMs == track[0].timeMs);
+        CHECK(vertices[numVertices - 1].timeMs == track[TRACK_FIXES - 1].timeMs);
+        CHECK(numVertices < TRACK_FIXES / (tolerance < 500 ? 2 : 4));
+        CHECK(worstError2(track, TRACK_FIXES, numVertices) <= bound * bound);
+    }
+}
+
+static void testSpacing(void) {
+
+    TrackCompressConfig cfg;
+    TrackCompressor c;
+    FixRecord vertex;
+    uint16_t numVertices, i;
+
+    trackCompressDefaultConfig(&cfg);
+
+    /* A straight line at constant speed: a vertex every window fixes */
+    for (i = 0; i < 200; ++i)
+        track[i] = fixAt(i * 1000UL, 1500 * (int64_t)i, -700 * (int64_t)i);
+    numVertices = compress(&cfg, track, 200);
+    for (i = 1; i + 1 < numVertices; ++i)
+        CHECK(vertices[i].timeMs - vertices[i - 1].timeMs == cfg.window * 1000UL);
+
+    /* Parked with a shorter maxGapS: a vertex before maxGapS is up */
+    cfg.maxGapS = 10;
+    for (i = 0; i < 200; ++i)
+        track[i] = fixAt(i * 1000UL, 0, 0);
+    numVertices = compress(&cfg, track, 200);
+    for (i = 1; i < numVertices; ++i)
+        CHECK(vertices[i].timeMs - vertices[i - 1].timeMs < cfg.maxGapS * 1000UL);
+    CHECK(numVertices >= 200 / cfg.maxGapS);
+
+    /* A window larger than the compressor holds is cut down to it */
+    cfg.window = TRACK_COMPRESS_MAX_WINDOW + 1;
+    trackCompressInit(&c, &cfg);
+    CHECK(c.config.window == TRACK_COMPRESS_MAX_WINDOW);
+
+    /* The same fix again, e.g. from GGA and RMC, is not a fix */
+    trackCompressDefaultConfig(&cfg);
+    trackCompressInit(&c, &cfg);
+    CHECK(!trackCompressFlush(&c, &vertex));
+    CHECK(trackCompressPush(&c, &track[0], &vertex) && vertex.timeMs == track[0].timeMs);
+    CHECK(!trackCompressPush(&c, &track[0], &vertex));
+    CHECK(!trackCompressPush(&c, &track[1], &vertex));
+    CHECK(!trackCompressPush(&c, &track[1], &vertex));
+    CHECK(c.fixes == 2 && c.count == 1);
+    CHECK(trackCompressFlush(&c, &vertex) && vertex.timeMs == track[1].timeMs);
+}
+
+int main(void) {
+
+    geoPlaneInit(&plane, ORIGIN_LAT_E7, ORIGIN_LON_E7);
+
+    testErrorBound();
+    testSpacing();
+
+    return checkReport();
+}
@@ -0,0 +1,165 @@
+//
+//  txPowerTest.c
+//  Tests of the TX power controller (txPower.c) and the RSSI the ACK carries (arqMac.c)
+//
+//  The level table is ordered, levels are picked to cover what is asked, the controller
+//  steps up by the shortfall at once and down in bounded steps, holds inside its
+//  hysteresis, falls back to maximum power after the misses, and the RSSI makes it from
+//  the gateway's ACK to the tracker.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arqMac.h"
+#include "check.h"
+#include "packetCodec.h"
+#include "txPower.h"
+
+#define SENSITIVITY     -110
+#define TARGET          10
+
+/* RSSI that leaves the given margin over SENSITIVITY */
+#define AT_MARGIN(db)   ((int8_t)(SENSITIVITY + (db)))
+
+static void testTable(void) {
+
+    uint8_t i;
+
+    for (i = 1; i < TXP_NUM_LEVELS; ++i) {
+        CHECK(txPowerLevels[i].dbm < txPowerLevels[i - 1].dbm);
+        CHECK(txPowerLevels[i].supplyUa < txPowerLevels[i - 1].supplyUa);
+    }
+
+    /* The level the radio setup starts with */
+    CHECK(txPowerLevels[TXP_MAX_LEVEL].txPower == 0x913F);
+
+    CHECK(txpLevelFor(127) == TXP_MAX_LEVEL);
+    CHECK(txpLevelFor(15) == TXP_MAX_LEVEL);
+    CHECK(txPowerLevels[txpLevelFor(11)].dbm == 12);
+    CHECK(txPowerLevels[txpLevelFor(10)].dbm == 10);
+    CHECK(txPowerLevels[txpLevelFor(-5)].dbm == 0);
+    CHECK(txpLevelFor(-128) == TXP_NUM_LEVELS - 1);
+}
+
+static void testSteps(void) {
+
+    TxPowerControl ctl;
+
+    txpInit(&ctl, SENSITIVITY, TARGET);
+    CHECK(ctl.level == TXP_MAX_LEVEL && txpLevel(&ctl)->dbm == 15);
+
+    /* Inside the hysteresis nothing moves */
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET)) == 0);
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET + TXP_HYSTERESIS_DB)) == 0);
+    CHECK(ctl.level == TXP_MAX_LEVEL);
+
+    /* Down by the excess, to a level that still covers it: 15 - 4 = 11, so 12 */
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET + 4)) == 1);
+    CHECK(txpLevel(&ctl)->dbm == 12);
+
+    /* At most TXP_MAX_STEP_DOWN_DB a report however strong the link */
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET + 40)) == 1);
+    CHECK(txpLevel(&ctl)->dbm == 6);
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET + 40)) == 1);
+    CHECK(txpLevel(&ctl)->dbm == 0);
+
+    /* The 10 dB step at the bottom only once the excess covers all of it */
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET + 8)) == 0);
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET + 10)) == 1);
+    CHECK(txpLevel(&ctl)->dbm == -10);
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET + 40)) == 0);
+
+    /* Up by the whole shortfall at once: -10 + 13 = 3, so 4 */
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET - 13)) == 1);
+    CHECK(txpLevel(&ctl)->dbm == 4);
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET - 20)) == 1);
+    CHECK(ctl.level == TXP_MAX_LEVEL);
+    CHECK(txpReport(&ctl, AT_MARGIN(TARGET - 20)) == 0);
+}
+
+static void testTargets(void) {
+
+    TxPowerControl nearTarget, farTarget;
+    uint8_t i;
+
+    /* A link with 20 dB of margin at maximum power settles lower for a tracker that
+     * asks for less */
+    txpInit(&nearTarget, SENSITIVITY, 5);
+    txpInit(&farTarget, SENSITIVITY, 15);
+    for (i = 0; i < 10; ++i) {
+        txpReport(&nearTarget, AT_MARGIN(20 - 15 + txpLevel(&nearTarget)->dbm));
+        txpReport(&farTarget, AT_MARGIN(20 - 15 + txpLevel(&farTarget)->dbm));
+    }
+    CHECK(txpLevel(&nearTarget)->dbm == 0);
+    CHECK(txpLevel(&farTarget)->dbm == 10);
+}
+
+static void testFallback(void) {
+
+    TxPowerControl ctl;
+    uint8_t i;
+
+    txpInit(&ctl, SENSITIVITY, TARGET);
+    txpReport(&ctl, AT_MARGIN(TARGET + 40));
+    txpReport(&ctl, AT_MARGIN(TARGET + 40));
+    CHECK(txpLevel(&ctl)->dbm == 4);
+
+    /* A report in between starts the count over */
+    CHECK(txpMissed(&ctl) == 0);
+    CHECK(txpMissed(&ctl) == 0);
+    txpReport(&ctl, AT_MARGIN(TARGET));
+    for (i = 1; i < TXP_FALLBACK_MISSES; ++i)
+        CHECK(txpMissed(&ctl) == 0);
+    CHECK(txpLevel(&ctl)->dbm == 4);
+
+    CHECK(txpMissed(&ctl) == 1);
+    CHECK(ctl.level == TXP_MAX_LEVEL);
+    for (i = 0; i < 2 * TXP_FALLBACK_MISSES; ++i)
+        CHECK(txpMissed(&ctl) == 0);
+}
+
+static void testAckRssi(void) {
+
+    uint8_t frame[PKT_HEADER_LENGTH + 8];
+    uint8_t ack[PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH];
+    ArqGateway gw;
+    ArqConfig cfg;
+    ArqNode node;
+    PacketHeader hdr;
+
+    arqDefaultConfig(&cfg);
+    arqNodeInit(&node, &cfg);
+    arqGatewayInit(&gw);
+    CHECK(node.ackRssi == ARQ_NO_RSSI);
+
+    hdr.type   = PKT_TYPE_DATA;
+    hdr.flags  = 0;
+    hdr.nodeId = 7;
+    hdr.seq    = 100;
+    memset(frame + pktEncodeHeader(&hdr, frame), 'G', 8);
+    CHECK(arqNodeQueue(&node, frame, sizeof(frame)) != ARQ_NONE);
+    CHECK(arqGatewayReceive(&gw, 7, 100) == 1);
+
+    CHECK(arqGatewayBuildAck(&gw, 7, -97, ack, sizeof(ack)) == sizeof(ack));
+    CHECK(arqGatewayBuildAck(&gw, 7, -97, ack, sizeof(ack) - 1) == 0);
+    CHECK(pktDecodeHeader(&hdr, ack, sizeof(ack)) == 0 && hdr.type == PKT_TYPE_ACK && hdr.seq == 100);
+
+    /* Cut short, the ACK is refused and the RSSI not taken */
+    CHECK(arqNodeOnAck(&node, hdr.seq, ack + PKT_HEADER_LENGTH, ARQ_ACK_PAYLOAD_LENGTH - 1) == 1);
+    CHECK(node.ackRssi == ARQ_NO_RSSI && !arqNodeAcked(&node, 100));
+
+    CHECK(arqNodeOnAck(&node, hdr.seq, ack + PKT_HEADER_LENGTH, ARQ_ACK_PAYLOAD_LENGTH) == 0);
+    CHECK(node.ackRssi == -97 && arqNodeAcked(&node, 100) && node.acked == 1);
+}
+
+int main(void) {
+
+    testTable();
+    testSteps();
+    testTargets();
+    testFallback();
+    testAckRssi();
+
+    return checkReport();
+}
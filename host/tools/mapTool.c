@@ -0,0 +1,294 @@
+//
+//  mapTool.c
+//  Memory budget of a firmware from its TI ARM linker .map file: the flash and SRAM each
+//  library and object takes, and what is left
+//
+//  The module summary gives code, read-only and read-write data of every object, grouped
+//  by directory or library. Flash is code plus read-only data, SRAM is read-write data; the
+//  system stack (.stack, where HWIs and SWIs run) is listed on its own. The HeapMem
+//  primary heap is not in the summary, its size comes from the __primary_heap_start__
+//  and __primary_heap_end__ symbols. Task stacks, the main thread's included, are taken
+//  from that heap at run time.
+//
+//  Given the bytes that must stay free, it fails if either region has less, so it can run
+//  as a post-build step.
+//
+//  usage: mapTool firmware.map [sramReserve] [flashReserve]
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_LENGTH     512
+#define MAX_MODULES     256
+#define NAME_LENGTH     48
+
+typedef struct {
+    char      name[NAME_LENGTH];
+    uint32_t  code;
+    uint32_t  roData;
+    uint32_t  rwData;
+    uint8_t   group;        // a library or directory: the modules after it are its own
+} Module;
+
+typedef struct {
+    char      name[16];
+    uint32_t  length;
+    uint32_t  used;
+} Region;
+
+typedef struct {
+    Region    flash;
+    Region    sram;
+    Module    modules[MAX_MODULES];
+    uint16_t  numModules;
+    uint32_t  stack;
+    uint32_t  linkerCode;
+    uint32_t  linkerRoData;
+    uint32_t  heapStart;
+    uint32_t  heapEnd;
+} MapInfo;
+
+typedef enum {
+    SECTION_NONE,
+    SECTION_MEMORY,
+    SECTION_MODULES,
+    SECTION_SYMBOLS
+} Section;
+
+/* The three numbers ending the line, cut off it */
+static uint8_t trailingNumbers(char * line, uint32_t * a, uint32_t * b, uint32_t * c) {
+
+    uint32_t v[3];
+    int8_t i;
+    char * end = line + strlen(line);
+
+    for (i = 2; i >= 0; --i) {
+        while (end > line && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r'))
+            --end;
+        char * start = end;
+        while (start > line && start[-1] >= '0' && start[-1] <= '9')
+            --start;
+        if (start == end || (start > line && start[-1] != ' ' && start[-1] != '\t'))
+            return 1;
+        v[i] = (uint32_t)strtoul(start, NULL, 10);
+        end = start;
+    }
+
+    while (end > line && (end[-1] == ' ' || end[-1] == '\t'))
+        --end;
+    *end = '\0';
+    *a = v[0];
+    *b = v[1];
+    *c = v[2];
+    return 0;
+}
+
+/* A library or directory by its last part, a directory with its parent */
+static void groupName(const char * path, char * out) {
+
+    size_t n = strlen(path);
+    uint8_t parts = 1;
+
+    if (n > 1 && path[n - 1] == '/') {
+        --n;
+        parts = 2;
+    }
+    const char * start = path + n;
+    while (start > path) {
+        if (start[-1] == '/' && --parts == 0)
+            break;
+        --start;
+    }
+    snprintf(out, NAME_LENGTH, "%.*s", (int)(path + n - start), start);
+}
+
+static void addModule(MapInfo * map, const char * name, uint32_t code, uint32_t roData,
+                      uint32_t rwData, uint8_t group) {
+
+    if (map->numModules == MAX_MODULES)
+        return;
+    Module * m = &map->modules[map->numModules++];
+    if (group)
+        groupName(name, m->name);
+    else
+        snprintf(m->name, sizeof(m->name), "%s", name);
+    m->code = code;
+    m->roData = roData;
+    m->rwData = rwData;
+    m->group = group;
+}
+
+static void parseModuleLine(MapInfo * map, char * line) {
+
+    uint32_t code, roData, rwData;
+    char * p = line;
+
+    while (*p == ' ')
+        ++p;
+    if (*p == '\0' || *p == '\r' || *p == '\n' || *p == '+' || strncmp(p, "Module", 6) == 0 ||
+        strncmp(p, "------", 6) == 0)
+        return;
+
+    if (trailingNumbers(p, &code, &roData, &rwData)) {
+        /* No sizes: the path of a group */
+        p[strcspn(p, "\r\n")] = '\0';
+        addModule(map, p, 0, 0, 0, 1);
+        return;
+    }
+    if (strcmp(p, "Total:") == 0 || strcmp(p, "Grand Total:") == 0)
+        return;
+    if (strcmp(p, "Stack:") == 0)
+        map->stack = rwData;
+    else if (strcmp(p, "Linker Generated:") == 0) {
+        map->linkerCode = code;
+        map->linkerRoData = roData;
+    }
+    else
+        addModule(map, p, code, roData, rwData, 0);
+}
+
+static uint8_t parseMap(FILE * f, MapInfo * map) {
+
+    char line[LINE_LENGTH];
+    Section section = SECTION_NONE;
+
+    memset(map, 0, sizeof(*map));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, "MEMORY CONFIGURATION", 20) == 0) {
+            section = SECTION_MEMORY;
+            continue;
+        }
+        if (strncmp(line, "MODULE SUMMARY", 14) == 0) {
+            section = SECTION_MODULES;
+            continue;
+        }
+        if (strncmp(line, "GLOBAL SYMBOLS", 14) == 0) {
+            section = SECTION_SYMBOLS;
+            continue;
+        }
+
+        if (section == SECTION_MEMORY) {
+            Region r;
+            uint32_t origin;
+            if (sscanf(line, " %15s %x %x %x", r.name, &origin, &r.length, &r.used) != 4)
+                continue;
+            if (strcmp(r.name, "FLASH") == 0)
+                map->flash = r;
+            else if (strcmp(r.name, "SRAM") == 0)
+                map->sram = r;
+        }
+        else if (section == SECTION_MODULES) {
+            /* The next section's title, at the start of the line */
+            if (line[0] != ' ' && line[0] != '\r' && line[0] != '\n') {
+                section = SECTION_NONE;
+                continue;
+            }
+            parseModuleLine(map, line);
+        }
+        else if (section == SECTION_SYMBOLS) {
+            uint32_t address;
+            char name[64];
+            if (sscanf(line, "%x %63s", &address, name) != 2)
+                continue;
+            if (strcmp(name, "__primary_heap_start__") == 0)
+                map->heapStart = address;
+            else if (strcmp(name, "__primary_heap_end__") == 0)
+                map->heapEnd = address;
+        }
+    }
+
+    return map->flash.length == 0 || map->sram.length == 0 || map->numModules == 0;
+}
+
+static void printRegion(const Region * r) {
+
+    printf("%-8s %7u of %7u bytes used (%5.1f%%), %7u free\n", r->name, r->used, r->length,
+           100.0 * r->used / r->length, r->length - r->used);
+}
+
+static void printRow(const char * indent, const char * name, uint32_t flash, uint32_t sram,
+                     const MapInfo * map) {
+
+    printf("%s%-*s %8u %5.1f%% %8u %5.1f%%\n", indent, (int)(40 - strlen(indent)), name,
+           flash, 100.0 * flash / map->flash.length, sram, 100.0 * sram / map->sram.length);
+}
+
+static void printBudget(const MapInfo * map) {
+
+    uint32_t heap = map->heapEnd > map->heapStart ? map->heapEnd - map->heapStart : 0;
+    uint32_t flashTotal = map->linkerCode + map->linkerRoData, sramTotal = map->stack + heap;
+    uint16_t i, j;
+
+    printRegion(&map->flash);
+    printRegion(&map->sram);
+    printf("\n%-40s %8s %6s %8s %6s\n", "module", "flash", "", "sram", "");
+
+    for (i = 0; i < map->numModules; i = j) {
+        const Module * g = &map->modules[i];
+        uint32_t flash = 0, sram = 0;
+
+        /* A group's own total first, then its modules */
+        for (j = i + (g->group ? 1 : 0); j < map->numModules && !map->modules[j].group; ++j) {
+            flash += map->modules[j].code + map->modules[j].roData;
+            sram += map->modules[j].rwData;
+        }
+        if (g->group)
+            printRow("", g->name, flash, sram, map);
+        for (j = i + (g->group ? 1 : 0); j < map->numModules && !map->modules[j].group; ++j) {
+            const Module * m = &map->modules[j];
+            printRow("  ", m->name, m->code + m->roData, m->rwData, map);
+        }
+        flashTotal += flash;
+        sramTotal += sram;
+    }
+
+    printRow("", "linker generated", map->linkerCode + map->linkerRoData, 0, map);
+    printRow("", "system stack (.stack)", 0, map->stack, map);
+    printRow("", "heap (main task stack, drivers)", 0, heap, map);
+    printRow("", "total", flashTotal, sramTotal, map);
+}
+
+int main(int argc, char * argv[]) {
+
+    static MapInfo map;
+    uint32_t sramReserve = 0, flashReserve = 0;
+    uint8_t over = 0;
+
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "usage: %s firmware.map [sramReserve] [flashReserve]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2)
+        sramReserve = (uint32_t)strtoul(argv[2], NULL, 0);
+    if (argc > 3)
+        flashReserve = (uint32_t)strtoul(argv[3], NULL, 0);
+
+    FILE * f = fopen(argv[1], "r");
+    if (f == NULL) {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    uint8_t failed = parseMap(f, &map);
+    fclose(f);
+    if (failed) {
+        fprintf(stderr, "%s: no memory configuration or module summary in %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    printBudget(&map);
+
+    if (map.sram.length - map.sram.used < sramReserve) {
+        printf("over budget: %u bytes of SRAM free, %u reserved\n",
+               map.sram.length - map.sram.used, sramReserve);
+        over = 1;
+    }
+    if (map.flash.length - map.flash.used < flashReserve) {
+        printf("over budget: %u bytes of flash free, %u reserved\n",
+               map.flash.length - map.flash.used, flashReserve);
+        over = 1;
+    }
+    return over;
+}
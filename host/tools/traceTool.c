@@ -0,0 +1,300 @@
+//
+//  traceTool.c
+//  Reads a trace ring dump (trace.h) out of a UART capture and prints the latency of every
+//  trace point as a histogram; optionally writes the spans as a Chrome trace timeline
+//  (chrome://tracing, ui.perfetto.dev)
+//
+//  The capture may hold the firmware's text output around the dump, the last dump in it
+//  is read. Times are unwrapped in record order and converted with the dump's clock rate.
+//  Begin and end of a point pair up innermost first, so a point that nests in itself or is
+//  preempted by its own callback still pairs right; begins without their end (the frame
+//  was dropped, or it was still running) and ends whose begin was overwritten are counted
+//  as unpaired.
+//
+//  usage: traceTool capture [trace.json]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define MAX_DEPTH   8       // open begins of one point
+#define BUCKETS     16      // latency histogram, powers of 2 from 1 us
+
+static const char * const pointNames[TRACE_POINTS] = {
+    "rx callback",
+    "rx frame",
+    "nmea parse",
+    "format",
+    "uart write",
+    "rf cmd",
+    "rf done",
+    "tx select",
+    "tx build"
+};
+
+typedef struct {
+    uint64_t  time;         // unwrapped, ticks
+    uint8_t   point;
+    uint8_t   kind;
+} Event;
+
+typedef struct {
+    uint64_t  begin;
+    uint64_t  length;       // ticks
+    uint8_t   point;
+} Span;
+
+typedef struct {
+    uint64_t  open[MAX_DEPTH];
+    uint8_t   depth;
+    uint32_t  marks;
+    uint32_t  unpaired;
+} PointState;
+
+static uint32_t getU32(const uint8_t * p) {
+
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint8_t * readFile(const char * path, size_t * size) {
+
+    FILE * f = fopen(path, "rb");
+    uint8_t * data = NULL;
+    size_t n = 0, room = 0, got;
+
+    if (f == NULL)
+        return NULL;
+    do {
+        if (n == room) {
+            room = room ? room * 2 : 65536;
+            uint8_t * grown = realloc(data, room);
+            if (grown == NULL) {
+                free(data);
+                fclose(f);
+                return NULL;
+            }
+            data = grown;
+        }
+        got = fread(data + n, 1, room - n, f);
+        n += got;
+    } while (got > 0);
+
+    fclose(f);
+    *size = n;
+    return data;
+}
+
+/* The last dump header in the capture */
+static const uint8_t * findDump(const uint8_t * data, size_t size) {
+
+    const uint8_t * found = NULL;
+    size_t i;
+
+    for (i = 0; i + TRACE_HEADER_LENGTH <= size; ++i)
+        if (getU32(data + i) == TRACE_MAGIC)
+            found = data + i;
+    return found;
+}
+
+static double toUs(uint64_t ticks, uint32_t hz) {
+
+    return (double)ticks * 1e6 / hz;
+}
+
+static int compareLength(const void * a, const void * b) {
+
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void printPoint(uint8_t point, uint64_t * lengths, uint32_t count, const PointState * state,
+                       uint32_t hz) {
+
+    uint32_t hist[BUCKETS] = { 0 }, most = 0, i;
+    uint64_t sum = 0;
+    uint8_t b;
+
+    if (count == 0) {
+        if (state->marks > 0)
+            printf("%-12s %7u marks\n", pointNames[point], state->marks);
+        return;
+    }
+
+    qsort(lengths, count, sizeof(lengths[0]), compareLength);
+    for (i = 0; i < count; ++i) {
+        double us = toUs(lengths[i], hz);
+        sum += lengths[i];
+        for (b = 0; b < BUCKETS - 1 && us >= (double)(1u << b); ++b)
+            ;
+        if (++hist[b] > most)
+            most = hist[b];
+    }
+
+    printf("%-12s %7u %10.1f %10.1f %10.1f %10.1f %10.1f", pointNames[point], count,
+           toUs(lengths[0], hz), toUs(sum / count, hz), toUs(lengths[count / 2], hz),
+           toUs(lengths[(uint32_t)(count * 0.99)], hz), toUs(lengths[count - 1], hz));
+    if (state->unpaired > 0)
+        printf("  (%u unpaired)", state->unpaired);
+    printf("\n");
+
+    for (b = 0; b < BUCKETS; ++b) {
+        if (hist[b] == 0)
+            continue;
+        if (b == 0)
+            printf("%14s <%7u us %7u ", "", 1u, hist[b]);
+        else if (b == BUCKETS - 1)
+            printf("%14s>=%7u us %7u ", "", 1u << (b - 1), hist[b]);
+        else
+            printf("%14s <%7u us %7u ", "", 1u << b, hist[b]);
+        for (i = 0; i < (hist[b] * 40 + most - 1) / most; ++i)
+            putchar('#');
+        putchar('\n');
+    }
+}
+
+static uint8_t writeChromeTrace(const char * path, const Span * spans, uint32_t numSpans,
+                                const Event * events, uint32_t numEvents, uint32_t hz) {
+
+    FILE * f = fopen(path, "w");
+    uint32_t i;
+    uint8_t p;
+
+    if (f == NULL)
+        return 1;
+
+    /* A row per point, so spans preempting each other need not nest */
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (p = 0; p < TRACE_POINTS; ++p)
+        fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+                p, pointNames[p]);
+    for (i = 0; i < numEvents; ++i)
+        if (events[i].kind == TRACE_KIND_MARK)
+            fprintf(f, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u},\n",
+                    pointNames[events[i].point], toUs(events[i].time, hz), events[i].point);
+    for (i = 0; i < numSpans; ++i)
+        fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+                pointNames[spans[i].point], toUs(spans[i].begin, hz), toUs(spans[i].length, hz),
+                spans[i].point, i + 1 < numSpans ? "," : "");
+    fprintf(f, "]}\n");
+
+    return fclose(f) != 0;
+}
+
+int main(int argc, char * argv[]) {
+
+    size_t size;
+    uint8_t * data;
+    const uint8_t * dump;
+    uint32_t hz, head, available, numEvents = 0, numSpans = 0, i;
+    uint16_t listed;
+    uint64_t now = 0;
+    uint32_t last = 0;
+    PointState state[TRACE_POINTS];
+    uint8_t p;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s capture [trace.json]\n", argv[0]);
+        return 1;
+    }
+
+    data = readFile(argv[1], &size);
+    if (data == NULL) {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    dump = findDump(data, size);
+    if (dump == NULL) {
+        fprintf(stderr, "%s: no trace dump in %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    hz = getU32(dump + 4);
+    head = getU32(dump + 8);
+    listed = (uint16_t)(dump[12] << 8 | dump[13]);
+    available = (uint32_t)((data + size - dump - TRACE_HEADER_LENGTH) / TRACE_RECORD_LENGTH);
+    if (hz == 0) {
+        fprintf(stderr, "%s: bad trace dump header\n", argv[0]);
+        return 1;
+    }
+
+    Event * events = malloc((listed + 1) * sizeof(Event));
+    Span * spans = malloc((listed + 1) * sizeof(Span));
+    uint64_t * lengths = malloc((listed + 1) * sizeof(uint64_t));
+    if (events == NULL || spans == NULL || lengths == NULL)
+        return 1;
+
+    /* Records are in index order; those skipped by the dump leave gaps in seq, and the
+     * text after the dump ends it before listed records if some were skipped */
+    const uint8_t * r = dump + TRACE_HEADER_LENGTH;
+    uint16_t prevSeq = (uint16_t)(head - listed - 1);
+    for (i = 0; i < listed && i < available; ++i, r += TRACE_RECORD_LENGTH) {
+        uint32_t time = getU32(r);
+        uint16_t seq = (uint16_t)(r[4] << 8 | r[5]);
+        if (r[6] >= TRACE_POINTS || r[7] > TRACE_KIND_MARK || (uint16_t)(seq - prevSeq - 1) >= listed)
+            break;
+        prevSeq = seq;
+
+        /* Records of a context that preempted another may be a little older */
+        now = numEvents == 0 ? time : now + (int64_t)(int32_t)(time - last);
+        last = time;
+        events[numEvents].time = now;
+        events[numEvents].point = r[6];
+        events[numEvents].kind = r[7];
+        ++numEvents;
+    }
+
+    memset(state, 0, sizeof(state));
+    for (i = 0; i < numEvents; ++i) {
+        PointState * s = &state[events[i].point];
+        switch (events[i].kind) {
+            case TRACE_KIND_BEGIN:
+                if (s->depth == MAX_DEPTH) {
+                    ++s->unpaired;
+                    break;
+                }
+                s->open[s->depth++] = events[i].time;
+                break;
+            case TRACE_KIND_END:
+                if (s->depth == 0) {
+                    ++s->unpaired;
+                    break;
+                }
+                --s->depth;
+                spans[numSpans].begin = s->open[s->depth];
+                spans[numSpans].length = events[i].time - s->open[s->depth];
+                spans[numSpans].point = events[i].point;
+                ++numSpans;
+                break;
+            default:
+                ++s->marks;
+        }
+    }
+    for (p = 0; p < TRACE_POINTS; ++p)
+        state[p].unpaired += state[p].depth;
+
+    printf("%u of %u records, %.3f ms at %u Hz\n", numEvents, listed,
+           numEvents ? toUs(events[numEvents - 1].time - events[0].time, hz) / 1000 : 0.0, hz);
+    printf("%-12s %7s %10s %10s %10s %10s %10s\n", "point", "spans", "min us", "mean us", "p50 us",
+           "p99 us", "max us");
+    for (p = 0; p < TRACE_POINTS; ++p) {
+        uint32_t count = 0;
+        for (i = 0; i < numSpans; ++i)
+            if (spans[i].point == p)
+                lengths[count++] = spans[i].length;
+        printPoint(p, lengths, count, &state[p], hz);
+    }
+
+    if (argc == 3 && writeChromeTrace(argv[2], spans, numSpans, events, numEvents, hz)) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], argv[2]);
+        return 1;
+    }
+
+    free(events);
+    free(spans);
+    free(lengths);
+    free(data);
+    return numEvents == 0;
+}
@@ -32,13 +32,22 @@
 
 /***** Includes *****/
 /* Standard C Libraries */
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 /* TI Drivers */
 #include <ti/drivers/rf/RF.h>
 #include <ti/drivers/PIN.h>
+#include <ti/drivers/Power.h>
 #include <ti/drivers/UART.h>
+#include <ti/drivers/AESCCM.h>
+#include <ti/drivers/cryptoutils/cryptokey/CryptoKeyPlaintext.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <xdc/runtime/Memory.h>
 /* Driverlib Header files */
 #include DeviceFamily_constructPath(driverlib/rf_prop_mailbox.h)
 
@@ -48,23 +57,118 @@
 
 /* Application Header files */
 #include "RFQueue.h"
+#include "fixEpoch.h"
+#include "fixLog.h"
+#include "geoFence.h"
+#include "macConfig.h"
+#include "metrics.h"
+#include "packetCodec.h"
 #include "smartrf_settings/smartrf_settings.h"
+#include "trace.h"
+#if MAC_MODE == MAC_MODE_TDMA
+#include "tdmaMac.h"
+#endif
+#if MAC_ADR
+#include "adaptiveRate.h"
+#endif
+#if MAC_ACK
+#include "arqMac.h"
+#endif
+#if SECURE_LINK
+#include "secureLink.h"
+#endif
+#if PHY_CHANNELS > 1
+#include "channelHop.h"
+#endif
+#include "meshRelay.h"
 
 /***** Defines *****/
 
+/* Receive into a small pool of partial read entries that packets of up to 255 bytes stream
+ * through (rxStream.h), rather than into two entries of the longest packet */
+//#define RX_PARTIAL
+
+/* Frames handled in mainThread, once RX has ended, rather than in the RF callback */
+#define RX_IN_MAIN  (MAC_ACK || SECURE_LINK || MESH_LEVEL)
+
+#if MESH_LEVEL && (MESH_NODE_ID < PKT_RELAY_ID_FIRST || MESH_NODE_ID > PKT_RELAY_ID_LAST)
+#error "MESH_NODE_ID goes from PKT_RELAY_ID_FIRST to PKT_RELAY_ID_LAST, trackers may take any other id"
+#endif
+
+/* A root gateway relays can reach: they keep to one channel and do not use TDMA */
+#define MESH_ROOT   (MESH_LEVEL == 0 && MAC_MODE != MAC_MODE_TDMA && PHY_CHANNELS == 1)
+
+#if defined(RX_PARTIAL) && RX_IN_MAIN
+#error "RX_PARTIAL needs MAC_ACK, SECURE_LINK and MESH_LEVEL off, their frames are only read once RX has ended"
+#endif
+#if defined(RX_PARTIAL) && PHY_CHANNELS > 1
+#error "RX_PARTIAL needs PHY_CHANNELS 1, the scan ends RX after every frame"
+#endif
+
 /* Packet RX Configuration */
 #define DATA_ENTRY_HEADER_SIZE 8  /* Constant header size of a Generic Data Entry */
+#ifdef RX_PARTIAL
+#define MAX_LENGTH             255 /* Max length byte the radio will accept */
+#define NUM_DATA_ENTRIES       2
+#define RX_ENTRY_DATA          64  /* Data bytes of a partial read entry */
+#else
 #define MAX_LENGTH             102 /* Max length byte the radio will accept */
 #define NUM_DATA_ENTRIES       2  /* NOTE: Only two data entries supported at the moment */
+#endif
 #define NUM_APPENDED_BYTES     2  /* The Data Entries data field will contain:
                                    * 1 Header byte (RF_cmdPropRx.rxConf.bIncludeHdr = 0x1)
                                    * Max 30 payload bytes
                                    * 1 status byte (RF_cmdPropRx.rxConf.bAppendStatus = 0x1) */
 
+#ifdef RX_PARTIAL
+#define RX_BUFFER_SIZE  RF_QUEUE_PARTIAL_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES, RX_ENTRY_DATA)
+/* A packet ended, or an entry filled up in the middle of one */
+#define RX_EVENTS       (RF_EventRxOk | RF_EventRxEntryDone)
+#else
+#define RX_BUFFER_SIZE  RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES, MAX_LENGTH, NUM_APPENDED_BYTES)
+#define RX_EVENTS       RF_EventRxEntryDone
+#endif
+
+/* The gateway's metrics go out on the UART at most this often, after a frame */
+#define METRICS_PERIOD_S    60
+
 
 
 /***** Prototypes *****/
 static void callback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e);
+static void handlePacket(void);
+static void handleFrame(void);
+static void printLogRecords(const uint8_t * payload, uint8_t length, const char * tag);
+static void printFenceEvents(const uint8_t * payload, uint8_t length);
+static void printEpochFix(const uint8_t * payload, uint8_t length);
+static void writeLine(const char * line, size_t length);
+static void printTelemetry(const PacketHeader * hdr, const uint8_t * payload, uint8_t length);
+static void metricsEmitIfDue(void);
+static void memoryStacksSample(void);
+static void memoryHeapSample(void);
+static void rxStatisticsSync(uint8_t restart);
+static void rfStatusMetric(uint16_t status);
+static void txStatusMetric(uint16_t status);
+#if MAC_ADR
+static void phySelectFast(uint8_t rate);
+#endif
+#if TRACE_ENABLED
+static void traceButtonCallback(PIN_Handle handle, PIN_Id pinId);
+static void traceDumpIfRequested(void);
+#endif
+#ifdef RX_PARTIAL
+static uint8_t rxRecover(void);
+#endif
+#if PHY_CHANNELS > 1
+static void hopScanInit(uint8_t stopOnFrame);
+static uint16_t hopScan(void);
+#endif
+#if MESH_LEVEL
+static void meshRelayService(void);
+#endif
+#if MESH_ROOT
+static void handleRelay(void);
+#endif
 
 /***** Variable declarations *****/
 static RF_Object rfObject;
@@ -84,21 +188,14 @@ UART_Params uartParams;
 #if defined(__TI_COMPILER_VERSION__)
 #pragma DATA_ALIGN (rxDataEntryBuffer, 4);
 static uint8_t
-rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
-                                                  MAX_LENGTH,
-                                                  NUM_APPENDED_BYTES)];
+rxDataEntryBuffer[RX_BUFFER_SIZE];
 #elif defined(__IAR_SYSTEMS_ICC__)
 #pragma data_alignment = 4
 static uint8_t
-rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
-                                                  MAX_LENGTH,
-                                                  NUM_APPENDED_BYTES)];
+rxDataEntryBuffer[RX_BUFFER_SIZE];
 #elif defined(__GNUC__)
 static uint8_t
-rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
-                                                  MAX_LENGTH,
-                                                  NUM_APPENDED_BYTES)]
-                                                  __attribute__((aligned(4)));
+rxDataEntryBuffer[RX_BUFFER_SIZE] __attribute__((aligned(4)));
 #else
 #error This compiler is not supported.
 #endif
@@ -107,10 +204,89 @@ rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
 static dataQueue_t dataQueue;
 static rfc_dataEntryGeneral_t* currentDataEntry;
 static uint8_t packetLength;
-static uint8_t* packetDataPointer;
 
+/* The frame is decoded where the RF core wrote it, the entry is handed back afterwards */
+static uint8_t* packet;
+
+/* The RF core counts what it flushes or drops here, rxStatisticsSync() adds it to the metrics */
+static rfc_propRxOutput_t rxStatistics;
+
+/* Snapshot being printed, and its line */
+static MetricsSnapshot metricsSnapshotBuffer;
+static char telemetryLine[400];
+
+/* Last samples of the stacks and the heap, for the memory line */
+static Task_Handle mainTask;
+static Task_Stat mainTaskStat;
+static Task_Stat idleTaskStat;
+static Hwi_StackInfo systemStack;
+static Memory_Stats heapStats;
+
+#ifdef RX_PARTIAL
+/* Reader of the entries; frames spanning two are put together in rxAssembly */
+static RxStream rxStream;
+static uint8_t rxAssembly[MAX_LENGTH + NUM_APPENDED_BYTES];
+#endif
+
+#if MAC_MODE == MAC_MODE_TDMA
+/* Slot map and superframe of the trackers we serve */
+static TdmaGateway tdmaGateway;
+static uint8_t beaconPacket[PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS)];
+#endif
+
+#if MAC_ADR
+/* Rate of every slot, and the second RF client that receives the slots above PHY_PROFILE */
+static AdrGateway adrGateway;
+static RF_Object rfObjectFast;
+static RF_Handle rfHandleFast;
+static uint8_t   fastRate = PHY_NUM_PROFILES;   /* profile RF_cmdPropRadioDivSetupFast is set to */
+#endif
+
+#if MAC_ACK
+/* What every tracker got through, for the ACKs and to drop retransmissions */
+static ArqGateway arqGateway;
+static uint8_t ackPacket[PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH];
+#endif
+
+#if RX_IN_MAIN
+static volatile uint8_t packetPending;
+#endif
+
+#if MESH_LEVEL
+/* Relay: the trackers' frames around it, sent on toward the root */
+static MeshRelay meshRelay;
+static uint8_t relayPacket[MESH_MAX_FRAME_LENGTH];
+#endif
+
+#if MESH_ROOT
+/* Root: frames heard directly and over relays, printed once */
+static MeshDedup meshSeen;
+static uint8_t relayedHops;     /* of the frame being handled, 0 if heard directly */
+#endif
+
+#if PHY_CHANNELS > 1
+/* The scan ring, CMD_FS -> CMD_PROP_CS -> CMD_PROP_RX per channel (channelHop.h) */
+static rfc_CMD_FS_t hopFs[PHY_CHANNELS];
+static rfc_CMD_PROP_CS_t hopCs[PHY_CHANNELS];
+static rfc_CMD_PROP_RX_t hopRx[PHY_CHANNELS];
+static uint8_t hopNext;     /* channel the next scan starts on */
+#endif
 
-static uint8_t packet[MAX_LENGTH + NUM_APPENDED_BYTES - 1]; /* The length byte is stored in a separate variable */
+#if TRACE_ENABLED
+/* BTN-1 was pressed: the trace ring goes out over the UART after the next frame */
+static volatile uint8_t traceDumpRequested;
+#endif
+
+#if SECURE_LINK
+/* Frames are opened on the crypto core, in mainThread rather than the RF callback */
+static AESCCM_Handle aesccmHandle;
+static CryptoKey secureKey;
+static uint8_t secureKeyMaterial[SECURE_KEY_LENGTH];
+static uint8_t secureScratch[MAX_LENGTH];
+static SecureCipher secureCipher;
+static SecureGateway secureGateway;
+static const uint8_t networkKey[SECURE_KEY_LENGTH] = SECURE_NETWORK_KEY;
+#endif
 
 /*
  * Application LED pin configuration table:
@@ -119,6 +295,9 @@ static uint8_t packet[MAX_LENGTH + NUM_APPENDED_BYTES - 1]; /* The length byte i
 PIN_Config pinTable[] =
 {
     Board_PIN_LED2 | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
+#if TRACE_ENABLED
+    Board_PIN_BUTTON0 | PIN_INPUT_EN | PIN_PULLUP | PIN_IRQ_NEGEDGE,
+#endif
 	PIN_TERMINATE
 };
 
@@ -131,17 +310,108 @@ char msg_parsed [120];
 /***** Function definitions *****/
 
 
+/* Microseconds since boot. Clock_getTicks() wraps after 11.9 hours at 10 us a tick, so this
+ * has to be called more often than that, as every frame does. */
+static uint64_t uptimeUs(void)
+{
+    static uint32_t lastTicks;
+    static uint64_t elapsedUs;
+    uint32_t ticks = Clock_getTicks();
+
+    elapsedUs += (uint64_t)(uint32_t)(ticks - lastTicks) * Clock_tickPeriod;
+    lastTicks = ticks;
+    return elapsedUs;
+}
+
+static uint32_t uptimeS(void)
+{
+    return (uint32_t)(uptimeUs() / 1000000);
+}
+
+#if MESH_LEVEL
+static uint32_t uptimeMs(void)
+{
+    return (uint32_t)(uptimeUs() / 1000);
+}
+#endif
+
 /* msg parser */
 /* Parsing a GPGGA msg into a form of {hr:min:sec latitude: [deg] [min]   longtitude: [deg] [min]} */
-/* interfaces with the gpsParser.h library */
-static void GPS_parse_full(char * msg, char * result)
+/* interfaces with the gpsParser.h library; the sentence is read in place, within length */
+static void GPS_parse_full(char * msg, uint8_t length, char * result)
 {
     memset(msg_parsed, '\0', sizeof(msg_parsed));
-    nmeaReceiveSentence(&data, msg);
-    nmeaParse(&data);
+    TRACE_BEGIN(TRACE_NMEA_PARSE);
+    if (nmeaReceiveView(&data, msg, length))
+        metricInc(METRIC_BAD_SENTENCES);
+    else
+    {
+        metricInc(METRIC_SENTENCES);
+        if (nmeaParse(&data))
+            metricInc(METRIC_PARSE_ERRORS);
+    }
+    TRACE_END(TRACE_NMEA_PARSE);
+    TRACE_BEGIN(TRACE_FORMAT);
     nmeaToString(&data, result);
+    TRACE_END(TRACE_FORMAT);
 }
 
+#if SECURE_LINK
+/* SecureCipher on the AESCCM driver, polling like on the tracker */
+static uint8_t aesccmSetKey(void * ctx, const uint8_t * key)
+{
+    memcpy(secureKeyMaterial, key, SECURE_KEY_LENGTH);
+    return CryptoKeyPlaintext_initKey(&secureKey, secureKeyMaterial, SECURE_KEY_LENGTH) !=
+           CryptoKey_STATUS_SUCCESS;
+}
+
+static uint8_t aesccmRun(void * ctx, uint8_t encrypt, const uint8_t * nonce, uint8_t nonceLength,
+                         const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                         uint8_t * mic, uint8_t micLength)
+{
+    AESCCM_Operation operation;
+    int_fast16_t status;
+
+    AESCCM_Operation_init(&operation);
+    operation.key         = &secureKey;
+    operation.aad         = (uint8_t*)aad;
+    operation.aadLength   = aadLength;
+    operation.input       = data;
+    operation.output      = secureScratch;
+    operation.inputLength = length;
+    operation.nonce       = (uint8_t*)nonce;
+    operation.nonceLength = nonceLength;
+    operation.mac         = mic;
+    operation.macLength   = micLength;
+
+    if (encrypt)
+        status = AESCCM_oneStepEncrypt((AESCCM_Handle)ctx, &operation);
+    else
+        status = AESCCM_oneStepDecrypt((AESCCM_Handle)ctx, &operation);
+
+    if (status != AESCCM_STATUS_SUCCESS)
+        return 1;
+
+    memcpy(data, secureScratch, length);
+    return 0;
+}
+
+/* Only the boot self test encrypts on the gateway */
+static uint8_t aesccmEncrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                             const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                             uint8_t * mic, uint8_t micLength)
+{
+    return aesccmRun(ctx, 1, nonce, nonceLength, aad, aadLength, data, length, mic, micLength);
+}
+
+static uint8_t aesccmDecrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                             const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                             const uint8_t * mic, uint8_t micLength)
+{
+    return aesccmRun(ctx, 0, nonce, nonceLength, aad, aadLength, data, length, (uint8_t*)mic, micLength);
+}
+#endif
+
 void *mainThread(void *arg0)
 {
     RF_Params rfParams;
@@ -171,11 +441,33 @@ void *mainThread(void *arg0)
         while(1);
     }
 
+    metricsInit();
+    uptimeS();
+    mainTask = Task_self();
+
+#if TRACE_ENABLED
+    /* The cycle counter stops while the CPU sleeps: stay awake */
+    Power_disablePolicy();
+    traceInit();
+    PIN_registerIntCb(ledPinHandle, &traceButtonCallback);
+#endif
+
+#ifdef RX_PARTIAL
+    if( RFQueue_definePartialQueue(&dataQueue,
+                                   &rxStream,
+                                   rxDataEntryBuffer,
+                                   sizeof(rxDataEntryBuffer),
+                                   NUM_DATA_ENTRIES,
+                                   RX_ENTRY_DATA,
+                                   rxAssembly,
+                                   sizeof(rxAssembly)))
+#else
     if( RFQueue_defineQueue(&dataQueue,
                             rxDataEntryBuffer,
                             sizeof(rxDataEntryBuffer),
                             NUM_DATA_ENTRIES,
                             MAX_LENGTH + NUM_APPENDED_BYTES))
+#endif
     {
         /* Failed to allocate space for all data entries */
         while(1);
@@ -190,6 +482,8 @@ void *mainThread(void *arg0)
     RF_cmdPropRx.rxConf.bAutoFlushCrcErr = 1;
     /* Implement packet length filtering to avoid PROP_ERROR_RXBUF */
     RF_cmdPropRx.maxPktLen = MAX_LENGTH;
+    /* Count what is flushed: CRC errors, ignored frames, no free entry */
+    RF_cmdPropRx.pOutput = (uint8_t*)&rxStatistics;
     RF_cmdPropRx.pktConf.bRepeatOk = 1;
     RF_cmdPropRx.pktConf.bRepeatNok = 1;
 
@@ -202,14 +496,180 @@ void *mainThread(void *arg0)
 
     /* Set the frequency */
     RF_postCmd(rfHandle, (RF_Op*)&RF_cmdFs, RF_PriorityNormal, NULL, 0);
+
+#if MAC_ADR
+    /* The driver switches between the clients, each with its own setup and frequency */
+    rfHandleFast = RF_open(&rfObjectFast, &RF_propFast, (RF_RadioSetup*)&RF_cmdPropRadioDivSetupFast, &rfParams);
+    RF_postCmd(rfHandleFast, (RF_Op*)&RF_cmdFs, RF_PriorityNormal, NULL, 0);
+#endif
     
     /* Initialize GPSData struct */
     nmeaDataInit(&data);
 
+#if MESH_LEVEL
+    MeshConfig meshConfig;
+    meshDefaultConfig(&meshConfig);
+    meshRelayInit(&meshRelay, &meshConfig, MESH_NODE_ID, MESH_LEVEL);
+#endif
+#if MESH_ROOT
+    meshDedupInit(&meshSeen);
+#endif
+
+    /* The drivers and this task's stack are all the heap holds from here on */
+    memoryHeapSample();
+
+#if PHY_CHANNELS > 1
+    /* Stop at every good frame where it is answered or opened outside the RF callback */
+    hopScanInit(RX_IN_MAIN);
+#endif
+
+#if SECURE_LINK
+    AESCCM_Params aesccmParams;
+
+    AESCCM_init();
+    AESCCM_Params_init(&aesccmParams);
+    aesccmParams.returnBehavior = AESCCM_RETURN_BEHAVIOR_POLLING;
+    aesccmHandle = AESCCM_open(Board_AESCCM0, &aesccmParams);
+
+    secureCipher.ctx = aesccmHandle;
+    secureCipher.setKey = aesccmSetKey;
+    secureCipher.encrypt = aesccmEncrypt;
+    secureCipher.decrypt = aesccmDecrypt;
+
+    if (aesccmHandle == NULL || secureSelfTest(&secureCipher) ||
+        secureGatewayInit(&secureGateway, &secureCipher, networkKey))
+    {
+        while(1);
+    }
+#endif
+
+#if MAC_MODE == MAC_MODE_TDMA
+    TdmaFrameConfig tdmaConfig;
+    tdmaDefaultConfig(&tdmaConfig);
+    tdmaGatewayInit(&tdmaGateway, &tdmaConfig);
+#if MAC_ADR
+    adrGatewayInit(&adrGateway, PHY_NUM_PROFILES - 1);
+#endif
+
+    uint32_t beaconTime  = RF_getCurrentTime() + RAT_US(10000);
+
+    /* Beacons go out on absolute radio times; a late one is sent right away */
+    RF_cmdPropTx.pPkt = beaconPacket;
+    RF_cmdPropTx.startTrigger.triggerType = TRIG_ABSTIME;
+    RF_cmdPropTx.startTrigger.pastTrig = 1;
+    RF_cmdPropRx.endTrigger.triggerType = TRIG_ABSTIME;
+
+    while(1)
+    {
+        RF_cmdPropTx.pktLen = tdmaGatewayBuildBeacon(&tdmaGateway, beaconPacket, sizeof(beaconPacket));
+        RF_cmdPropTx.startTime = beaconTime;
+        TRACE_BEGIN(TRACE_RF_CMD);
+        RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropTx, RF_PriorityNormal, NULL, 0);
+        TRACE_END(TRACE_RF_CMD);
+        txStatusMetric(((volatile RF_Op*)&RF_cmdPropTx)->status);
+
+        /* The superframe the beacon just announced */
+        uint32_t frameStart = beaconTime;
+        beaconTime += RAT_US(tdmaFrameLengthUs(&tdmaGateway.cfg));
+#if MAC_ADR
+        /* One RX per group of slots at a rate, on the client of its PHY */
+        uint8_t rate;
+        for (rate = PHY_PROFILE; rate < PHY_NUM_PROFILES; ++rate)
+        {
+            uint32_t groupEnd = tdmaRateEndUs(&tdmaGateway.cfg, rate);
+            RF_Handle handle = rfHandle;
+
+            if (groupEnd == 0)
+                continue;
+            if (rate != PHY_PROFILE)
+            {
+                phySelectFast(rate);
+                handle = rfHandleFast;
+            }
+            RF_cmdPropRx.endTime = frameStart + RAT_US(groupEnd);
+            if ((int32_t)(RF_cmdPropRx.endTime - (beaconTime - RAT_US(TDMA_GUARD_US))) > 0)
+                RF_cmdPropRx.endTime = beaconTime - RAT_US(TDMA_GUARD_US);
+            RF_runCmd(handle, (RF_Op*)&RF_cmdPropRx, RF_PriorityNormal,
+                      &callback, RX_EVENTS);
+            rfStatusMetric(((volatile RF_Op*)&RF_cmdPropRx)->status);
+            rxStatisticsSync(1);
+#ifdef RX_PARTIAL
+            rxRecover();
+#endif
+        }
+
+        adrGatewayEndFrame(&adrGateway, &tdmaGateway);
+#else
+        /* Listen for the rest of the superframe, stopping in time for the next beacon */
+        RF_cmdPropRx.endTime = beaconTime - RAT_US(TDMA_GUARD_US);
+        RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropRx, RF_PriorityNormal,
+                  &callback, RX_EVENTS);
+        rfStatusMetric(((volatile RF_Op*)&RF_cmdPropRx)->status);
+        rxStatisticsSync(1);
+#ifdef RX_PARTIAL
+        rxRecover();
+#endif
+#endif
+
+        tdmaGatewayEndFrame(&tdmaGateway);
+        memoryHeapSample();
+    }
+#elif RX_IN_MAIN
+#if MAC_ACK
+    arqGatewayInit(&arqGateway);
+
+    RF_cmdPropTx.pPkt = ackPacket;
+    RF_cmdPropTx.startTrigger.triggerType = TRIG_NOW;
+#endif
+    /* Leave RX after every good frame: its ACK goes out while the tracker listens, and
+     * it is opened outside the RF callback */
+    RF_cmdPropRx.pktConf.bRepeatOk = 0;
+
+    while(1)
+    {
+#if MESH_LEVEL
+        /* RELAY frames that are due go out first; RX ends when the next one is */
+        meshRelayService();
+#endif
+        packetPending = 0;
+#if PHY_CHANNELS > 1
+        /* The ACK goes out on the channel the frame came in on, still programmed */
+        rfStatusMetric(hopScan());
+#else
+        RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropRx, RF_PriorityNormal,
+                  &callback, RX_EVENTS);
+        rfStatusMetric(((volatile RF_Op*)&RF_cmdPropRx)->status);
+#endif
+
+        if (packetPending)
+        {
+            handlePacket();
+            RFQueue_nextEntry();
+        }
+        rxStatisticsSync(1);
+        memoryHeapSample();
+    }
+#else
     /* Enter RX mode and stay forever in RX */
+#if PHY_CHANNELS > 1
+    /* The ring never ends: every frame is read in the callback */
+    RF_EventMask terminationReason = RF_runCmd(rfHandle, (RF_Op*)&hopFs[0],
+                                               RF_PriorityNormal, &callback,
+                                               RX_EVENTS);
+#else
     RF_EventMask terminationReason = RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropRx,
                                                RF_PriorityNormal, &callback,
-                                               RF_EventRxEntryDone);
+                                               RX_EVENTS);
+#endif
+#ifdef RX_PARTIAL
+    while (rxRecover())
+    {
+        rfStatusMetric(PROP_ERROR_RXFULL);
+        rxStatisticsSync(1);
+        terminationReason = RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropRx,
+                                      RF_PriorityNormal, &callback, RX_EVENTS);
+    }
+#endif
 
     switch(terminationReason)
     {
@@ -290,10 +750,144 @@ void *mainThread(void *arg0)
 
     while(1){
     }
+#endif
+}
+
+#if PHY_CHANNELS > 1
+/* Build the scan ring from RF_cmdFs and RF_cmdPropRx as set up for one channel. With
+ * stopOnFrame the ring stops after a good frame, otherwise it runs forever. */
+static void hopScanInit(uint8_t stopOnFrame)
+{
+    uint8_t i;
+
+    for (i = 0; i < PHY_CHANNELS; ++i)
+    {
+        hopFs[i] = RF_cmdFs;
+        hopFsFrequency(i, &hopFs[i].frequency, &hopFs[i].fractFreq);
+        hopFs[i].startTrigger.triggerType = TRIG_NOW;
+        hopFs[i].condition.rule = COND_ALWAYS;
+        hopFs[i].pNextOp = (rfc_radioOp_t*)&hopCs[i];
+
+        memset(&hopCs[i], 0, sizeof(hopCs[i]));
+        hopCs[i].commandNo = CMD_PROP_CS;
+        hopCs[i].startTrigger.triggerType = TRIG_NOW;
+        /* Quiet: past the RX, to the next channel */
+        hopCs[i].condition.rule = COND_SKIP_ON_FALSE;
+        hopCs[i].condition.nSkip = 2;
+        hopCs[i].csConf.bEnaRssi = 0x1;
+        hopCs[i].csConf.busyOp = 0x1;   // end as soon as the channel is busy
+        hopCs[i].csConf.idleOp = 0x0;   // keep sensing while idle, until csEndTime
+        hopCs[i].rssiThr = phyProfiles[PHY_PROFILE].sensitivityDbm + HOP_SENSE_MARGIN_DB;
+        hopCs[i].numRssiBusy = 0x1;
+        hopCs[i].csEndTrigger.triggerType = TRIG_REL_START;
+        hopCs[i].csEndTime = RAT_US(PHY_SENSE_US);
+        hopCs[i].pNextOp = (rfc_radioOp_t*)&hopRx[i];
+
+        /* One frame, or none if no sync word comes in time */
+        hopRx[i] = RF_cmdPropRx;
+        hopRx[i].startTrigger.triggerType = TRIG_NOW;
+        hopRx[i].pktConf.bRepeatOk = 0;
+        hopRx[i].pktConf.bRepeatNok = 0;
+        hopRx[i].pktConf.endType = 0;
+        hopRx[i].endTrigger.triggerType = TRIG_REL_START;
+        hopRx[i].endTime = RAT_US(HOP_RX_TIMEOUT_US);
+        hopRx[i].condition.rule = stopOnFrame ? COND_STOP_ON_TRUE : COND_ALWAYS;
+        hopRx[i].pNextOp = (rfc_radioOp_t*)&hopFs[(i + 1) % PHY_CHANNELS];
+    }
+}
+
+/* Run the ring from hopNext until it stops, after a good frame or on an error. Returns the
+ * status of the RX it stopped at; the next scan starts on the channel after it. */
+static uint16_t hopScan(void)
+{
+    uint16_t status = IDLE;
+    uint8_t i;
+
+    for (i = 0; i < PHY_CHANNELS; ++i)
+        hopRx[i].status = IDLE;
+
+    RF_runCmd(rfHandle, (RF_Op*)&hopFs[hopNext], RF_PriorityNormal, &callback, RX_EVENTS);
+
+    for (i = 0; i < PHY_CHANNELS; ++i)
+    {
+        if (hopRx[i].status == PROP_DONE_OK || hopRx[i].status >= PROP_ERROR_PAR)
+        {
+            status = hopRx[i].status;
+            hopNext = (i + 1) % PHY_CHANNELS;
+        }
+    }
+    return status;
+}
+#endif
+
+#ifdef RX_PARTIAL
+/* Out of pending entries the RF core ends RX with PROP_ERROR_RXFULL: what is queued is
+ * dropped. Returns 1 if it did, for RX to go on. */
+static uint8_t rxRecover(void)
+{
+    if (((volatile RF_Op*)&RF_cmdPropRx)->status != PROP_ERROR_RXFULL)
+        return 0;
+
+    RFQueue_flushPartialQueue(&dataQueue, &rxStream);
+    return 1;
+}
+
+/* Every frame complete in the queue, in its entry or put together in rxAssembly; each
+ * stays valid until the next one is read */
+static void handlePackets(void)
+{
+    const uint8_t * frame;
+    uint16_t n;
+
+    while ((n = rxStreamPacket(&rxStream, &frame)) > 0)
+    {
+        /* Length byte, payload, status byte */
+        if (n != frame[0] + NUM_APPENDED_BYTES)
+            continue;
+
+        packetLength = frame[0];
+        packet = (uint8_t*)frame + 1;
+        handlePacket();
+    }
+}
+#endif
+
+/* Entries the RF core has finished and the gateway not yet read */
+static uint8_t rxQueueWaiting(void)
+{
+#ifdef RX_PARTIAL
+    rfc_dataEntry_t* first = (rfc_dataEntry_t*)rxStream.entry;
+#else
+    rfc_dataEntry_t* first = (rfc_dataEntry_t*)RFQueue_getDataEntry();
+#endif
+    rfc_dataEntry_t* entry = first;
+    uint8_t waiting = 0;
+
+    do
+    {
+        if (entry->status == DATA_ENTRY_FINISHED)
+            ++waiting;
+        entry = (rfc_dataEntry_t*)entry->pNextEntry;
+    } while (entry != first);
+
+    return waiting;
 }
 
 void callback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e)
 {
+    TRACE_BEGIN(TRACE_RX_CALLBACK);
+    if (e & RX_EVENTS)
+        metricMax(METRIC_RX_QUEUE_HIGH, rxQueueWaiting());
+#ifdef RX_PARTIAL
+    if (e & RX_EVENTS)
+    {
+        /* Toggle pin to indicate RX */
+        PIN_setOutputValue(ledPinHandle, Board_PIN_LED2,
+                           !PIN_getOutputValue(Board_PIN_LED2));
+
+        handlePackets();
+    }
+#else
     if (e & RF_EventRxEntryDone)
     {
         /* Toggle pin to indicate RX */
@@ -306,29 +900,452 @@ void callback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e)
         /* Handle the packet data, located at &currentDataEntry->data:
          * - Length is the first byte with the current configuration
          * - Data starts from the second byte */
-        packetLength      = *(uint8_t*) (&currentDataEntry->data);
-        packetDataPointer =  (uint8_t*) (&currentDataEntry->data + 1);
+        packetLength = *(uint8_t*) (&currentDataEntry->data);
+        packet       =  (uint8_t*) (&currentDataEntry->data + 1);
+
+#if RX_IN_MAIN
+        /* Handled by mainThread: the ACK goes out before the slow UART output. RX has
+         * ended, the entry is released there once the frame is decoded */
+        packetPending = 1;
+#else
+        handlePacket();
+        RFQueue_nextEntry();
+#endif
+    }
+#endif
+    TRACE_END(TRACE_RX_CALLBACK);
+    metricsEmitIfDue();
+#if TRACE_ENABLED
+    traceDumpIfRequested();
+#endif
+}
+
+/* Fixes of a LOG frame, one line per fix: stored while out of range or track vertices */
+static void printLogRecords(const uint8_t * payload, uint8_t length, const char * tag)
+{
+    FixRecord rec;
+
+    while (length >= FIX_RECORD_WIRE_LENGTH)
+    {
+        TRACE_BEGIN(TRACE_FORMAT);
+        fixRecordDecode(&rec, payload);
+        payload += FIX_RECORD_WIRE_LENGTH;
+        length -= FIX_RECORD_WIRE_LENGTH;
+
+        uint32_t s = rec.timeMs / 1000;
+        uint32_t lat = rec.latE7 < 0 ? -rec.latE7 : rec.latE7;
+        uint32_t lon = rec.lonE7 < 0 ? -rec.lonE7 : rec.lonE7;
+
+        int n = sprintf(msg_parsed, "%02lu:%02lu:%02lu\tlatitude:\t%lu.%07lu%c\tlongitude:\t%lu.%07lu%c\t"
+                        "altitude:\t%d\t(%s)\r\n",
+                        (unsigned long)(s / 3600), (unsigned long)(s / 60 % 60), (unsigned long)(s % 60),
+                        (unsigned long)(lat / 10000000), (unsigned long)(lat % 10000000),
+                        rec.latE7 < 0 ? 'S' : 'N',
+                        (unsigned long)(lon / 10000000), (unsigned long)(lon % 10000000),
+                        rec.lonE7 < 0 ? 'W' : 'E', rec.altM, tag);
+        TRACE_END(TRACE_FORMAT);
+
+        writeLine(msg_parsed, n);
+    }
+}
+
+/* Fix of a geofence report, then one line per event */
+static void printFenceEvents(const uint8_t * payload, uint8_t length)
+{
+    static const char * const eventNames[] = { "enter", "exit", "dwell", "heartbeat" };
+    GeoFenceEvent event;
+
+    if (length < FIX_RECORD_WIRE_LENGTH)
+        return;
+    printLogRecords(payload, FIX_RECORD_WIRE_LENGTH, "fence");
+    payload += FIX_RECORD_WIRE_LENGTH;
+    length -= FIX_RECORD_WIRE_LENGTH;
+
+    while (length >= GEOFENCE_EVENT_WIRE_LENGTH)
+    {
+        geoFenceEventDecode(&event, payload);
+        payload += GEOFENCE_EVENT_WIRE_LENGTH;
+        length -= GEOFENCE_EVENT_WIRE_LENGTH;
+
+        if (event.type > GEOFENCE_HEARTBEAT)
+            continue;
+
+        TRACE_BEGIN(TRACE_FORMAT);
+        int n = event.type == GEOFENCE_HEARTBEAT ?
+                sprintf(msg_parsed, "\t%s\r\n", eventNames[event.type]) :
+                sprintf(msg_parsed, "\tfence %u\t%s\r\n", event.fenceId, eventNames[event.type]);
+        TRACE_END(TRACE_FORMAT);
+
+        writeLine(msg_parsed, n);
+    }
+}
 
-        /* Copy the payload + the status byte to the packet variable */
-        memcpy(packet, packetDataPointer, (packetLength + 1));
+/* Merged fix of a FIX frame: the fix line, then quality, speed and course */
+static void printEpochFix(const uint8_t * payload, uint8_t length)
+{
+    EpochFix e;
+    int n;
+
+    if (length < FIX_EPOCH_WIRE_LENGTH)
+        return;
+    fixEpochDecode(&e, payload);
+
+    if (!(e.have & FIX_EPOCH_POSITION))
+    {
+        uint32_t s = e.fix.timeMs / 1000;
+        n = sprintf(msg_parsed, "%02lu:%02lu:%02lu\tno fix\tsatellites:\t%u\r\n",
+                    (unsigned long)(s / 3600), (unsigned long)(s / 60 % 60), (unsigned long)(s % 60),
+                    e.satellites);
+        writeLine(msg_parsed, n);
+        return;
+    }
+    printLogRecords(payload, FIX_RECORD_WIRE_LENGTH, "fix");
 
-        /* Find the start and end of message; make sure a checksum is present */
-        char * packet_msg_begin = memchr(packet, '$', sizeof(packet));
-        char * packet_msg_end   = memchr(packet, '\n', sizeof(packet));
-        char * checksum_present = memchr(packet, '*', sizeof(packet));
+    TRACE_BEGIN(TRACE_FORMAT);
+    n = sprintf(msg_parsed, "\tquality:\t%u\tsatellites:\t%u", e.quality, e.satellites);
+    if (e.hdop != FIX_EPOCH_NO_DOP)
+        n += sprintf(msg_parsed + n, "\tHDOP:\t%u.%02u", e.hdop / 100, e.hdop % 100);
+    if (e.have & FIX_EPOCH_MOTION)
+        n += sprintf(msg_parsed + n, "\tspeed:\t%u.%02u m/s\tcourse:\t%u.%02u", e.speedCmS / 100,
+                     e.speedCmS % 100, e.courseCdeg / 100, e.courseCdeg % 100);
+    n += sprintf(msg_parsed + n, "\r\n");
+    TRACE_END(TRACE_FORMAT);
 
-        /* As long as we found the start, end, and checksum, try to parse the msg */
-        if (packet_msg_begin && packet_msg_end && checksum_present) {
+    writeLine(msg_parsed, n);
+}
 
-            /* Make sure there's a null terminator */
-            *(packet_msg_end + 1) = '\0';
-            GPS_parse_full(packet_msg_begin, msg_parsed);
+/* Frame at packet / packetLength, in the data entry */
+static void handlePacket(void)
+{
+    TRACE_BEGIN(TRACE_RX_FRAME);
+
+    metricInc(METRIC_RX_FRAMES);
+    metricObserve(METRIC_FRAME_LENGTH, packetLength);
+    metricObserve(METRIC_RSSI, rxStatistics.lastRssi);
+
+    handleFrame();
+
+    TRACE_END(TRACE_RX_FRAME);
+}
 
-            /* Only print if we've received new usable data */
-            if (data.nmeaData.msgType == GPRMC || data.nmeaData.msgType == GPGGA)
-                UART_write(uart, msg_parsed, sizeof(msg_parsed));
+/* Slot bookkeeping, relaying, ACK, then parse and print the frame at packet / packetLength:
+ * the one received, or one a RELAY frame carries */
+static void handleFrame(void)
+{
+    PacketHeader hdr;
+    if (pktDecodeHeader(&hdr, packet, packetLength))
+    {
+        metricInc(METRIC_RX_REJECTED);
+        hdr.type = 0;
+    }
+
+#if MAC_MODE == MAC_MODE_TDMA
+    switch (hdr.type)
+    {
+        case PKT_TYPE_JOIN:
+            /* The grant goes out with the next beacon, at PHY_PROFILE */
+#if MAC_ADR
+            adrGatewayJoin(&adrGateway, &tdmaGateway, tdmaGatewayJoin(&tdmaGateway, hdr.nodeId));
+#else
+            tdmaGatewayJoin(&tdmaGateway, hdr.nodeId);
+#endif
+            break;
+        case PKT_TYPE_LEAVE:
+            tdmaGatewayLeave(&tdmaGateway, hdr.nodeId);
+            break;
+        case PKT_TYPE_DATA:
+        case PKT_TYPE_FIX:
+#if MAC_ADR
+            /* RSSI of this frame, frozen on sync found */
+            adrGatewayHeard(&adrGateway, tdmaGatewayHeard(&tdmaGateway, hdr.nodeId), rxStatistics.lastRssi);
+#else
+            tdmaGatewayHeard(&tdmaGateway, hdr.nodeId);
+#endif
+            break;
+    }
+#endif
+
+#if MESH_LEVEL
+    /* Sent on as it came, before it is opened: the root checks the seal */
+    meshRelayAccept(&meshRelay, packet, packetLength, uptimeMs(), RF_getCurrentTime());
+#endif
+#if MESH_ROOT
+    if (hdr.type == PKT_TYPE_RELAY)
+    {
+        handleRelay();
+        return;
+    }
+#endif
+
+    uint8_t isNew = 1;
+#if SECURE_LINK
+    /* Forged, replayed or unsealed frames get no ACK and are not printed */
+    if (hdr.type == PKT_TYPE_DATA || hdr.type == PKT_TYPE_LOG || hdr.type == PKT_TYPE_FIX ||
+        hdr.type == PKT_TYPE_TELEMETRY)
+    {
+        SecureStatus status = secureOpen(&secureGateway, packet, &packetLength);
+        if (status == SECURE_REJECTED)
+        {
+            metricInc(METRIC_RX_REJECTED);
+            return;
         }
+        isNew = status == SECURE_NEW;
+    }
+#endif
+#if MAC_ACK
+    if (hdr.type == PKT_TYPE_DATA || hdr.type == PKT_TYPE_LOG || hdr.type == PKT_TYPE_FIX)
+    {
+        isNew &= arqGatewayReceive(&arqGateway, hdr.nodeId, hdr.seq);
 
-        RFQueue_nextEntry();
+        /* Retransmissions are acknowledged again, their first ACK may have been lost.
+         * The RSSI lets the tracker turn its power down to what the link needs. */
+        RF_cmdPropTx.pktLen = arqGatewayBuildAck(&arqGateway, hdr.nodeId, rxStatistics.lastRssi,
+                                                 ackPacket, sizeof(ackPacket));
+#if MESH_ROOT
+        /* The relay acknowledged it, the tracker does not hear the root */
+        if (relayedHops)
+            RF_cmdPropTx.pktLen = 0;
+#endif
+        if (RF_cmdPropTx.pktLen)
+        {
+            TRACE_BEGIN(TRACE_RF_CMD);
+            RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropTx, RF_PriorityNormal, NULL, 0);
+            TRACE_END(TRACE_RF_CMD);
+            txStatusMetric(((volatile RF_Op*)&RF_cmdPropTx)->status);
+        }
     }
+#endif
+#if MESH_ROOT
+    /* Heard directly and over a relay, or over two relays */
+    if (hdr.type == PKT_TYPE_DATA || hdr.type == PKT_TYPE_LOG || hdr.type == PKT_TYPE_FIX)
+        isNew &= !meshDedupCheck(&meshSeen, hdr.nodeId, hdr.seq);
+#endif
+
+    /* The sentence is looked for, checked and parsed within the payload, where it lies */
+    if (hdr.type == PKT_TYPE_DATA && isNew && packetLength > PKT_HEADER_LENGTH) {
+
+        GPS_parse_full((char *)packet + PKT_HEADER_LENGTH, packetLength - PKT_HEADER_LENGTH, msg_parsed);
+
+        /* Only print if we've received new usable data */
+        if (data.nmeaData.msgType == NMEA_RMC || data.nmeaData.msgType == NMEA_GGA)
+            writeLine(msg_parsed, sizeof(msg_parsed));
+    }
+
+    if (hdr.type == PKT_TYPE_TELEMETRY && isNew)
+        printTelemetry(&hdr, packet + PKT_HEADER_LENGTH, packetLength - PKT_HEADER_LENGTH);
+    else if (hdr.type == PKT_TYPE_FIX && isNew)
+        printEpochFix(packet + PKT_HEADER_LENGTH, packetLength - PKT_HEADER_LENGTH);
+    else if (hdr.type == PKT_TYPE_LOG && isNew && (hdr.flags & PKT_FLAG_FENCE))
+        printFenceEvents(packet + PKT_HEADER_LENGTH, packetLength - PKT_HEADER_LENGTH);
+    else if (hdr.type == PKT_TYPE_LOG && isNew)
+        printLogRecords(packet + PKT_HEADER_LENGTH, packetLength - PKT_HEADER_LENGTH,
+                        (hdr.flags & PKT_FLAG_TRACK) ? "track" : "logged");
+}
+
+#if MESH_ROOT
+/* Each tracker frame of a RELAY frame, handled in place as if it was heard directly */
+static void handleRelay(void)
+{
+    uint8_t * relayFrame = packet;
+    uint8_t relayLength = packetLength;
+    uint8_t offset = 0;
+    MeshEntry entry;
+
+    while (meshNextEntry(relayFrame, relayLength, &offset, &entry) == 0)
+    {
+        packet = (uint8_t*)entry.frame;
+        packetLength = entry.length;
+        relayedHops = entry.hops;
+        handleFrame();
+    }
+
+    packet = relayFrame;
+    packetLength = relayLength;
+    relayedHops = 0;
 }
+#endif
+
+#if MESH_LEVEL
+/* Send the RELAY frames that are due, then have RX end when the next one is. No carrier
+ * sense: the jitter keeps neighbouring relays apart. */
+static void meshRelayService(void)
+{
+    uint32_t waitMs;
+
+    while ((waitMs = meshRelayWaitMs(&meshRelay, uptimeMs())) == 0)
+    {
+        RF_cmdPropTx.pktLen = meshRelayBuild(&meshRelay, relayPacket, sizeof(relayPacket));
+        RF_cmdPropTx.pPkt = relayPacket;
+        RF_cmdPropTx.startTrigger.triggerType = TRIG_NOW;
+
+        TRACE_BEGIN(TRACE_RF_CMD);
+        RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropTx, RF_PriorityNormal, NULL, 0);
+        TRACE_END(TRACE_RF_CMD);
+        txStatusMetric(((volatile RF_Op*)&RF_cmdPropTx)->status);
+    }
+#if MAC_ACK
+    RF_cmdPropTx.pPkt = ackPacket;
+#endif
+
+    if (waitMs == MESH_FOREVER)
+    {
+        RF_cmdPropRx.endTrigger.triggerType = TRIG_NEVER;
+    }
+    else
+    {
+        RF_cmdPropRx.endTrigger.triggerType = TRIG_REL_START;
+        RF_cmdPropRx.endTime = RAT_MS(waitMs);
+    }
+}
+#endif
+
+/* A tracker's metrics, on one line */
+static void printTelemetry(const PacketHeader * hdr, const uint8_t * payload, uint8_t length)
+{
+    if (metricsDecode(&metricsSnapshotBuffer, payload, length))
+        return;
+
+    int n = sprintf(telemetryLine, "telemetry\tnode:\t%u\t", hdr->nodeId);
+    n += metricsFormat(&metricsSnapshotBuffer, telemetryLine + n, sizeof(telemetryLine) - n - 2);
+    n += sprintf(telemetryLine + n, "\r\n");
+
+    writeLine(telemetryLine, n);
+}
+
+/* The gateway's own metrics, every METRICS_PERIOD_S */
+static void metricsEmitIfDue(void)
+{
+    static uint32_t lastS;
+    uint32_t nowS = uptimeS();
+
+    if (nowS - lastS < METRICS_PERIOD_S)
+        return;
+    lastS = nowS;
+
+    rxStatisticsSync(0);
+    memoryStacksSample();
+    metricsSnapshot(&metricsSnapshotBuffer, nowS);
+
+    int n = sprintf(telemetryLine, "telemetry\tgateway\t");
+    n += metricsFormat(&metricsSnapshotBuffer, telemetryLine + n, sizeof(telemetryLine) - n - 2);
+    n += sprintf(telemetryLine + n, "\r\n");
+
+    writeLine(telemetryLine, n);
+
+    /* Used of each stack and the heap, against its size */
+    n = sprintf(telemetryLine, "memory\tmain stack:\t%u/%u\tidle stack:\t%u/%u\tsystem stack:\t%u/%u\t"
+                "heap:\t%lu/%lu\tlargest free:\t%lu\r\n",
+                (unsigned)mainTaskStat.used, (unsigned)mainTaskStat.stackSize,
+                (unsigned)idleTaskStat.used, (unsigned)idleTaskStat.stackSize,
+                (unsigned)systemStack.hwiStackPeak, (unsigned)systemStack.hwiStackSize,
+                (unsigned long)(heapStats.totalSize - heapStats.totalFreeSize),
+                (unsigned long)heapStats.totalSize, (unsigned long)heapStats.largestFreeSize);
+
+    writeLine(telemetryLine, n);
+}
+
+/* Stack high-water marks, from the 0xBE the kernel fills stacks with (release.cfg). The
+ * RF callbacks run on the system stack, with HWIs and SWIs. */
+static void memoryStacksSample(void)
+{
+    Task_stat(mainTask, &mainTaskStat);
+    Task_stat(Task_getIdleTask(), &idleTaskStat);
+    Hwi_getStackInfo(&systemStack, TRUE);
+    metricMax(METRIC_MAIN_STACK_PEAK, mainTaskStat.used);
+    metricMax(METRIC_SYSTEM_STACK_PEAK, systemStack.hwiStackPeak);
+}
+
+/* The heap in use. Its gate is a mutex: task context only, so not from metricsEmitIfDue() */
+static void memoryHeapSample(void)
+{
+    Memory_getStats(NULL, &heapStats);
+    metricMax(METRIC_HEAP_PEAK, heapStats.totalSize - heapStats.totalFreeSize);
+}
+
+/* Adds what the RF core counted in rxStatistics since the last call. With restart, between
+ * RX commands, its counts start over for the next one. */
+static void rxStatisticsSync(uint8_t restart)
+{
+    static rfc_propRxOutput_t seen;
+
+    metricAdd(METRIC_RX_CRC_ERRORS, (uint16_t)(rxStatistics.nRxNok - seen.nRxNok));
+    metricAdd(METRIC_RX_IGNORED, (uint8_t)(rxStatistics.nRxIgnored - seen.nRxIgnored));
+    metricAdd(METRIC_RX_OVERFLOWS, (uint8_t)(rxStatistics.nRxBufFull - seen.nRxBufFull));
+    seen = rxStatistics;
+
+    if (restart)
+    {
+        memset(&rxStatistics, 0, sizeof(rxStatistics));
+        memset(&seen, 0, sizeof(seen));
+    }
+}
+
+/* An RF command that ended in error */
+static void rfStatusMetric(uint16_t status)
+{
+    if (status >= PROP_ERROR_PAR)
+    {
+        metricInc(METRIC_RF_ERRORS);
+        metricSet(METRIC_RF_LAST_ERROR, status);
+    }
+}
+
+/* A TX command that ended */
+static void txStatusMetric(uint16_t status)
+{
+    metricInc(METRIC_TX_FRAMES);
+    if (status != PROP_DONE_OK)
+        metricInc(METRIC_TX_FAILED);
+    rfStatusMetric(status);
+}
+
+#if MAC_ADR
+/* Sets the modulation of the second RF client to a profile above PHY_PROFILE; the RF
+ * driver runs the setup again before the next command of that client */
+static void phySelectFast(uint8_t rate)
+{
+    const PhyProfile * phy = &phyProfiles[rate];
+
+    if (rate == fastRate)
+        return;
+
+    RF_cmdPropRadioDivSetupFast.modulation.deviation = phy->deviation;
+    RF_cmdPropRadioDivSetupFast.symbolRate.rateWord = phy->rateWord;
+    RF_cmdPropRadioDivSetupFast.rxBw = phy->rxBw;
+    RF_cmdPropRadioDivSetupFast.preamConf.nPreamBytes = phy->preambleLength;
+    RF_cmdPropRadioDivSetupFast.formatConf.fecMode = phy->fecMode;
+    RF_control(rfHandleFast, RF_CTRL_UPDATE_SETUP_CMD, NULL);
+    fastRate = rate;
+}
+#endif
+
+/* Output line, timed as TRACE_UART_WRITE */
+static void writeLine(const char * line, size_t length)
+{
+    TRACE_BEGIN(TRACE_UART_WRITE);
+    UART_write(uart, line, length);
+    TRACE_END(TRACE_UART_WRITE);
+}
+
+#if TRACE_ENABLED
+static void traceButtonCallback(PIN_Handle handle, PIN_Id pinId)
+{
+    if (pinId == Board_PIN_BUTTON0)
+        traceDumpRequested = 1;
+}
+
+static void traceUartWrite(void * ctx, const uint8_t * data, uint16_t length)
+{
+    UART_write(uart, data, length);
+}
+
+/* The ring in binary between the text lines, for host/tools/traceTool.c */
+static void traceDumpIfRequested(void)
+{
+    if (!traceDumpRequested)
+        return;
+
+    traceDumpRequested = 0;
+    traceDump(traceUartWrite, NULL);
+}
+#endif
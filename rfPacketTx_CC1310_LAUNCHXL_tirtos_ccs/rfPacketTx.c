@@ -33,68 +33,1413 @@
 /***** Includes *****/
 /* Standard C Libraries */
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 /* TI Drivers */
 #include <ti/drivers/rf/RF.h>
 #include <ti/drivers/PIN.h>
 #include <ti/drivers/pin/PINCC26XX.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/dpl/HwiP.h>
 
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/UART.h>
+#include <ti/drivers/TRNG.h>
+#include <ti/drivers/cryptoutils/cryptokey/CryptoKeyPlaintext.h>
+#include <ti/drivers/NVS.h>
+#include <ti/drivers/AESCCM.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <xdc/runtime/Memory.h>
 /* Driverlib Header files */
 #include DeviceFamily_constructPath(driverlib/rf_prop_mailbox.h)
+#include DeviceFamily_constructPath(inc/hw_types.h)
+#include DeviceFamily_constructPath(inc/hw_memmap.h)
+#include DeviceFamily_constructPath(inc/hw_fcfg1.h)
+
+/* Board Header files */
+#include "Board.h"
+#include "smartrf_settings/smartrf_settings.h"
+
+/* Application Header files */
+#include "macConfig.h"
+#include "packetCodec.h"
+#if MAC_MODE == MAC_MODE_TDMA || MAC_ACK
+#include "RFQueue.h"
+#endif
+#if MAC_MODE == MAC_MODE_TDMA
+#include "tdmaMac.h"
+#elif MAC_MODE == MAC_MODE_CSMA
+#include "csmaMac.h"
+#endif
+#if MAC_ACK
+#include "arqMac.h"
+#endif
+#if TX_POWER_CONTROL
+#include "txPower.h"
+#endif
+#if PHY_CHANNELS > 1
+#include "channelHop.h"
+#endif
+#include "fixEpoch.h"
+#include "fixFilter.h"
+#include "fixGate.h"
+#include "fixLog.h"
+#include "geoFence.h"
+#include "gnssBaud.h"
+#include "gnssInput.h"
+#include "gpsParser.h"
+#include "metrics.h"
+#include "trace.h"
+#include "trackCompress.h"
+#if SECURE_LINK
+#include "secureLink.h"
+#endif
+
+/***** Defines *****/
+
+/* Do power measurement */
+//#define POWER_MEASUREMENT
+
+/* Node id of this tracker; derived from the IEEE address when not defined */
+//#define NODE_ID             0x01
+
+/* Keep fixes on the external flash while no gateway answers, send them when it is back */
+//#define FIX_LOG
+
+/* Do not send fixes the receiver reports as poor: too few satellites, 2D, high DOP (fixGate.h) */
+//#define FIX_GATE
+
+/* Send the GGA and RMC of each second as one FIX frame (fixEpoch.h) */
+//#define EPOCH_MERGE
+
+/* With EPOCH_MERGE: read the receiver's UBX NAV-PVT in place of NMEA (gnssInput.h) */
+//#define GNSS_UBX
+
+/* With EPOCH_MERGE: at startup, find the receiver's baud rate, turn off the output that is
+ * not decoded and move it to GNSS_BAUD (u-blox receivers; gnssBaud.h) */
+//#define GNSS_CONFIGURE
+
+/* Smooth fixes, drop outliers and those the gateway can extrapolate (fixFilter.h) */
+//#define FIX_FILTER
+
+/* Send only the vertices of the simplified track, as one record LOG frames (trackCompress.h) */
+//#define TRACK_COMPRESS
+
+/* Send only geofence enter, exit and dwell events and a heartbeat (geoFence.h) */
+//#define GEOFENCE
+
+/* Packet TX Configuration */
+#define PAYLOAD_LENGTH      102
+#if SECURE_LINK
+#define SENTENCE_MAX_LENGTH (PAYLOAD_LENGTH - PKT_HEADER_LENGTH - SECURE_MAX_OVERHEAD)
+#else
+#define SENTENCE_MAX_LENGTH (PAYLOAD_LENGTH - PKT_HEADER_LENGTH)
+#endif
+#ifdef POWER_MEASUREMENT
+#define PACKET_INTERVAL     5  /* For power measurement set packet interval to 5s */
+#else
+#define PACKET_INTERVAL     500000  /* Set packet interval to 500us or 0.5ms */
+#endif
+
+/* A TELEMETRY frame with the metrics goes out this often */
+#define METRICS_PERIOD_S    60
+
+/* GNSS receiver UART */
+#define GNSS_BAUD_DEFAULT   4800    /* GPS Sensor uses 4800 Baudrate */
+#define GNSS_BAUD           38400   /* after GNSS_CONFIGURE */
+#define GNSS_READ_TIMEOUT_MS 10     /* UART reads return this often while rates are tried */
+
+#if MAC_MODE == MAC_MODE_TDMA
+/* Beacon RX Configuration */
+#define RX_MAX_LENGTH       (PKT_HEADER_LENGTH + TDMA_BEACON_PAYLOAD_LENGTH(TDMA_MAX_SLOTS))
+#define NUM_DATA_ENTRIES    2
+#define NUM_APPENDED_BYTES  6  /* The Data Entries data field will contain:
+                                * 1 Header byte (RF_cmdPropRx.rxConf.bIncludeHdr = 0x1)
+                                * Max RX_MAX_LENGTH payload bytes
+                                * 4 timestamp bytes (RF_cmdPropRx.rxConf.bAppendTimestamp = 0x1)
+                                * 1 status byte (RF_cmdPropRx.rxConf.bAppendStatus = 0x1) */
+#elif MAC_ACK
+/* ACK RX Configuration */
+#define RX_MAX_LENGTH       (PKT_HEADER_LENGTH + ARQ_ACK_PAYLOAD_LENGTH)
+#define NUM_DATA_ENTRIES    2
+#define NUM_APPENDED_BYTES  2  /* 1 header byte, 1 status byte */
+#endif
+
+#if defined(NODE_ID) && (NODE_ID == PKT_GATEWAY_ID || NODE_ID == PKT_BROADCAST_ID || \
+                         (NODE_ID >= PKT_RELAY_ID_FIRST && NODE_ID <= PKT_RELAY_ID_LAST))
+#error "NODE_ID is reserved, trackers take neither the gateway, broadcast nor relay ids"
+#endif
+
+#ifdef FIX_LOG
+#if !MAC_ACK
+#error "FIX_LOG needs MAC_ACK to know which stored fixes reached the gateway"
+#endif
+#define FIX_LOG_BATCH       (SENTENCE_MAX_LENGTH / FIX_RECORD_WIRE_LENGTH)
+#define FIX_LOG_DRAIN_US    500000  /* backlog sent per fix, in place of the PACKET_INTERVAL sleep */
+#define FIX_LOG_PAGE_SIZE   256     /* program page of the SPI flash */
+#endif
+
+#if defined(EPOCH_MERGE) + defined(FIX_FILTER) + defined(TRACK_COMPRESS) + defined(GEOFENCE) > 1
+#error "EPOCH_MERGE, FIX_FILTER, TRACK_COMPRESS and GEOFENCE all pick the fixes that are sent, define only one"
+#endif
+#if (defined(GNSS_UBX) || defined(GNSS_CONFIGURE)) && !defined(EPOCH_MERGE)
+#error "GNSS_UBX and GNSS_CONFIGURE need EPOCH_MERGE, the FIX frame is what the input layer gives"
+#endif
+#if (defined(FIX_GATE) || defined(FIX_FILTER) || defined(TRACK_COMPRESS) || defined(GEOFENCE)) && \
+    MAC_MODE == MAC_MODE_TDMA
+#error "FIX_GATE, FIX_FILTER, TRACK_COMPRESS and GEOFENCE need MAC_MODE_ALOHA or MAC_MODE_CSMA, a silent TDMA slot expires"
+#endif
+#if defined(GEOFENCE) && \
+    FIX_RECORD_WIRE_LENGTH + GEOFENCE_MAX_EVENTS * GEOFENCE_EVENT_WIRE_LENGTH > SENTENCE_MAX_LENGTH
+#error "GEOFENCE_MAX_EVENTS events do not fit into a frame"
+#endif
+
+/***** Prototypes *****/
+#if MAC_MODE == MAC_MODE_TDMA
+static void tdmaListenForBeacon(void);
+static void tdmaRxCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e);
+static void tdmaTxCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e);
+#endif
+#if MAC_ACK
+static void arqRxCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e);
+
+/* Every transmission ends in the ACK window, its RX entries go to arqRxCallback */
+#define TX_CALLBACK         &arqRxCallback
+#define TX_CALLBACK_EVENTS  RF_EventRxEntryDone
+#else
+#define TX_CALLBACK         NULL
+#define TX_CALLBACK_EVENTS  0
+#endif
+#if PHY_CHANNELS > 1
+static RF_Op* hopChain(RF_Op* chain);
+
+/* Every frame goes out on its own channel: the chain that sends it starts with CMD_FS */
+#define TX_CHAIN(op)        hopChain(op)
+#else
+#define TX_CHAIN(op)        (op)
+#endif
+
+/***** Variable declarations *****/
+static RF_Object rfObject;
+static RF_Handle rfHandle;
+
+/* Pin driver handle */
+static PIN_Handle ledPinHandle;
+static PIN_State ledPinState;
+
+static uint8_t packet[PAYLOAD_LENGTH];
+static uint8_t packetLength;
+static uint16_t seqNumber;
+static uint8_t nodeId;
+
+#if !SECURE_LINK
+/* TELEMETRY frames are numbered apart, the gateway's ARQ window only sees DATA, LOG and FIX */
+static uint16_t telemetrySeq;
+#endif
+static uint32_t telemetryDueS = METRICS_PERIOD_S;
+static Task_Handle mainTask;
+
+/* True random numbers for backoff and seeding */
+static TRNG_Handle trngHandle;
+
+#if TRACE_ENABLED
+/* BTN-1 was pressed: the trace ring goes out over the UART after the next frame */
+static volatile uint8_t traceDumpRequested;
+#endif
+
+#if MAC_MODE == MAC_MODE_TDMA || MAC_ACK
+/* Buffer which contains all Data Entries for receiving beacons or ACKs.
+ * Pragmas are needed to make sure this buffer is 4 byte aligned (requirement from the RF Core) */
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_ALIGN (rxDataEntryBuffer, 4);
+static uint8_t
+rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
+                                                  RX_MAX_LENGTH,
+                                                  NUM_APPENDED_BYTES)];
+#elif defined(__IAR_SYSTEMS_ICC__)
+#pragma data_alignment = 4
+static uint8_t
+rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
+                                                  RX_MAX_LENGTH,
+                                                  NUM_APPENDED_BYTES)];
+#elif defined(__GNUC__)
+static uint8_t
+rxDataEntryBuffer[RF_QUEUE_DATA_ENTRY_BUFFER_SIZE(NUM_DATA_ENTRIES,
+                                                  RX_MAX_LENGTH,
+                                                  NUM_APPENDED_BYTES)]
+                                                  __attribute__((aligned(4)));
+#else
+#error This compiler is not supported.
+#endif
+
+static dataQueue_t dataQueue;
+#endif
+
+#if MAC_MODE == MAC_MODE_TDMA
+static TdmaNode tdmaNode;
+static uint32_t beaconTime;     /* RAT time the last beacon was received */
+static uint8_t  beaconSeen;     /* set by the RX callback during a beacon window */
+
+/* The latest frame waits in packet[] for our slot, slotPacket is the copy owned by the RF core */
+static uint8_t  slotPacket[PAYLOAD_LENGTH];
+static uint32_t randomState;
+
+#if MAC_ADR
+/* Second RF client for a slot at a profile above PHY_PROFILE, the beacon stays on rfHandle */
+static RF_Object rfObjectFast;
+static RF_Handle rfHandleFast;
+static uint8_t   fastRate = PHY_NUM_PROFILES;   /* profile RF_cmdPropRadioDivSetupFast is set to */
+#endif
+
+#elif MAC_MODE == MAC_MODE_CSMA
+static CsmaConfig csmaConfig;
+
+/* Listen before talk chain, run on the RF core without CPU involvement:
+ * CMD_NOP (random backoff) -> CMD_PROP_CS -> CMD_PROP_TX, stopping at the CS if the channel is busy */
+static rfc_CMD_NOP_t RF_cmdNop =
+{
+    .commandNo = CMD_NOP,
+    .status = 0x0000,
+    .pNextOp = 0, // set to &RF_cmdPropCs in mainThread
+    .startTime = 0x00000000,
+    .startTrigger.triggerType = TRIG_ABSTIME,
+    .startTrigger.bEnaCmd = 0x0,
+    .startTrigger.triggerNo = 0x0,
+    .startTrigger.pastTrig = 0x1,
+    .condition.rule = COND_ALWAYS,
+    .condition.nSkip = 0x0,
+};
+
+static rfc_CMD_PROP_CS_t RF_cmdPropCs =
+{
+    .commandNo = CMD_PROP_CS,
+    .status = 0x0000,
+    .pNextOp = 0, // set to &RF_cmdPropTx in mainThread
+    .startTime = 0x00000000,
+    .startTrigger.triggerType = TRIG_NOW,
+    .startTrigger.bEnaCmd = 0x0,
+    .startTrigger.triggerNo = 0x0,
+    .startTrigger.pastTrig = 0x0,
+    .condition.rule = COND_STOP_ON_TRUE, // busy channel ends the chain
+    .condition.nSkip = 0x0,
+    .csFsConf.bFsOffIdle = 0x0,
+    .csFsConf.bFsOffBusy = 0x0,
+    .csConf.bEnaRssi = 0x1,
+    .csConf.bEnaCorr = 0x0,
+    .csConf.operation = 0x0,
+    .csConf.busyOp = 0x1,   // end as soon as the channel is busy
+    .csConf.idleOp = 0x0,   // keep sensing while idle, until csEndTime
+    .csConf.timeoutRes = 0x0,
+    .rssiThr = CSMA_DEFAULT_RSSI_THRESHOLD_DBM,
+    .numRssiIdle = 0x0,
+    .numRssiBusy = 0x1,
+    .corrPeriod = 0x0000,
+    .corrConfig.numCorrInv = 0x0,
+    .corrConfig.numCorrBusy = 0x0,
+    .csEndTrigger.triggerType = TRIG_REL_START,
+    .csEndTrigger.bEnaCmd = 0x0,
+    .csEndTrigger.triggerNo = 0x0,
+    .csEndTrigger.pastTrig = 0x0,
+    .csEndTime = RAT_US(CSMA_DEFAULT_SENSE_US),
+};
+#endif
+
+#if MAC_ACK
+/* Sent frames wait here until the gateway acknowledges them */
+static ArqNode arqNode;
+#endif
+
+#if PHY_CHANNELS > 1
+/* Heads the TX chain, a copy of RF_cmdFs tuned to the channel of each frame */
+static rfc_CMD_FS_t hopFs;
+#endif
+
+#if TX_POWER_CONTROL
+/* TX power level, steered by the RSSI in the gateway's ACKs */
+static TxPowerControl txPowerControl;
+#endif
+
+#ifdef FIX_LOG
+/* Append log on the external SPI flash, NVS region Board_NVSEXTERNAL */
+static NVS_Handle nvsHandle;
+static FixLogFlash fixLogFlash;
+static FixLog fixLog;
+
+/* Records of the LOG frame waiting in the retry buffer, 0 if none */
+static uint8_t  logInFlight;
+static uint16_t logSeq;
+#endif
+
+#if defined(FIX_LOG) || defined(FIX_FILTER) || defined(TRACK_COMPRESS) || defined(GEOFENCE)
+static GPSData gpsData;
+#endif
+
+#ifdef EPOCH_MERGE
+static GnssInput gnssInput;
+#endif
+
+#ifdef GNSS_CONFIGURE
+static GnssBaud gnssBaud;
+
+/* The receiver's UART for gnssBaudNegotiate(), reopened at each rate */
+typedef struct
+{
+    UART_Handle * uart;
+    UART_Params * params;
+} GnssUartCtx;
+#endif
+
+#ifdef FIX_GATE
+static FixGate fixGate;
+#ifndef EPOCH_MERGE
+/* Quality state built from every sentence, GSA included; kept apart from gpsData, which
+ * is cleared for each fix */
+static GPSData gateData;
+static const NMEAHandler gateHandlers[] = {
+    { NMEA_GGA, nmeaParseGGA },
+    { NMEA_RMC, nmeaParseRMC },
+    { NMEA_GSA, nmeaParseGSA },
+};
+#endif
+#endif
+
+#ifdef FIX_FILTER
+static FixFilter fixFilter;
+#endif
+
+#ifdef TRACK_COMPRESS
+static TrackCompressor trackCompressor;
+#endif
+
+#ifdef GEOFENCE
+/* Example fences, replace with your own. Being const they stay in flash; the index takes
+ * 16 bytes per fence and 2 per grid entry of RAM */
+static const GeoPoint fenceVertices[] = {
+    /* 1: polygon */
+    { 455010000, -735690000 }, { 455010000, -735650000 }, { 455040000, -735650000 },
+    { 455040000, -735690000 },
+    /* 2: circle centre */
+    { 455090000, -735580000 },
+};
+static const GeoFence fenceTable[] = {
+    { 1, GEOFENCE_POLYGON, 4, 0, 0 },
+    { 2, GEOFENCE_CIRCLE,  0, 4, 15000 },
+};
+static const GeoFenceSet fenceSet = {
+    fenceTable, sizeof(fenceTable) / sizeof(fenceTable[0]), fenceVertices
+};
+#define FENCE_INDEX_ENTRIES 512
+
+static GeoFencer geoFencer;
+static GeoFenceBox fenceBoxes[sizeof(fenceTable) / sizeof(fenceTable[0])];
+static uint16_t fenceEntries[FENCE_INDEX_ENTRIES];
+#endif
+
+#if SECURE_LINK
+/* Frames are sealed on the crypto core; the epoch lives in Board_NVSINTERNAL */
+static AESCCM_Handle aesccmHandle;
+static CryptoKey secureKey;
+static uint8_t secureKeyMaterial[SECURE_KEY_LENGTH];
+static uint8_t secureScratch[PAYLOAD_LENGTH];
+static SecureCipher secureCipher;
+static SecureNode secureNode;
+static NVS_Handle epochNvsHandle;
+static const uint8_t networkKey[SECURE_KEY_LENGTH] = SECURE_NETWORK_KEY;
+#endif
+
+/*
+ * Application LED pin configuration table:
+ *   - All LEDs board LEDs are off.
+ */
+PIN_Config pinTable[] =
+{
+    Board_PIN_LED1 | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
+#if TRACE_ENABLED
+    Board_PIN_BUTTON0 | PIN_INPUT_EN | PIN_PULLUP | PIN_IRQ_NEGEDGE,
+#endif
+#ifdef POWER_MEASUREMENT
+#if defined(Board_CC1350_LAUNCHXL)
+    Board_DIO30_SWPWR | PIN_GPIO_OUTPUT_EN | PIN_GPIO_HIGH | PIN_PUSHPULL | PIN_DRVSTR_MAX,
+#endif
+#endif
+    PIN_TERMINATE
+};
+
+/********************** GPS Sensor Connection **********************/
+/********* GND - GND, 3V3 - 3V3, TX - DIO2, WUP - DIO22, PWR - DIO24  *********/
+
+
+/***** Function definitions *****/
+
+/* Node id from the low byte of the factory IEEE address, keeping clear of the reserved ids */
+static uint8_t macNodeId(void)
+{
+#ifdef NODE_ID
+    return NODE_ID;
+#else
+    return pktTrackerId((uint8_t)HWREG(FCFG1_BASE + FCFG1_O_MAC_15_4_0));
+#endif
+}
+
+/* Frame a sentence into packet[] */
+static void macBuildDataFrame(const char * sentence, uint8_t length)
+{
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_DATA;
+    hdr.flags  = 0;
+    hdr.nodeId = nodeId;
+    hdr.seq    = seqNumber++;
+
+    if (length > SENTENCE_MAX_LENGTH)
+        length = SENTENCE_MAX_LENGTH;
+
+    pktEncodeHeader(&hdr, packet);
+    memcpy(packet + PKT_HEADER_LENGTH, sentence, length);
+    packetLength = PKT_HEADER_LENGTH + length;
+}
+
+#ifdef EPOCH_MERGE
+/* Frame a merged fix into packet[] */
+static void macBuildFixFrame(const EpochFix * epoch)
+{
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_FIX;
+    hdr.flags  = 0;
+    hdr.nodeId = nodeId;
+    hdr.seq    = seqNumber++;
+
+    pktEncodeHeader(&hdr, packet);
+    fixEpochEncode(epoch, packet + PKT_HEADER_LENGTH);
+    packetLength = PKT_HEADER_LENGTH + FIX_EPOCH_WIRE_LENGTH;
+}
+#endif
+
+#ifdef TRACK_COMPRESS
+/* Frame a track vertex into packet[] */
+static void macBuildTrackFrame(const FixRecord * vertex)
+{
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_LOG;
+    hdr.flags  = PKT_FLAG_TRACK;
+    hdr.nodeId = nodeId;
+    hdr.seq    = seqNumber++;
+
+    pktEncodeHeader(&hdr, packet);
+    fixRecordEncode(vertex, packet + PKT_HEADER_LENGTH);
+    packetLength = PKT_HEADER_LENGTH + FIX_RECORD_WIRE_LENGTH;
+}
+#endif
+
+#ifdef GEOFENCE
+/* Frame a fix and the geofence events it raised into packet[] */
+static void macBuildFenceFrame(const FixRecord * fix, const GeoFenceEvent * events, uint8_t numEvents)
+{
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_LOG;
+    hdr.flags  = PKT_FLAG_FENCE;
+    hdr.nodeId = nodeId;
+    hdr.seq    = seqNumber++;
+
+    pktEncodeHeader(&hdr, packet);
+    fixRecordEncode(fix, packet + PKT_HEADER_LENGTH);
+    packetLength = PKT_HEADER_LENGTH + FIX_RECORD_WIRE_LENGTH;
+
+    while (numEvents--)
+    {
+        geoFenceEventEncode(events++, packet + packetLength);
+        packetLength += GEOFENCE_EVENT_WIRE_LENGTH;
+    }
+}
+#endif
+
+/* Seconds since boot. Clock_getTicks() wraps after 11.9 hours at 10 us a tick, so this has to
+ * be called more often than that, as every sentence does. */
+static uint32_t uptimeS(void)
+{
+    static uint32_t lastTicks;
+    static uint64_t uptimeUs;
+    uint32_t ticks = Clock_getTicks();
+
+    uptimeUs += (uint64_t)(uint32_t)(ticks - lastTicks) * Clock_tickPeriod;
+    lastTicks = ticks;
+    return (uint32_t)(uptimeUs / 1000000);
+}
+
+/* Once every METRICS_PERIOD_S */
+static uint8_t telemetryDue(void)
+{
+    uint32_t nowS = uptimeS();
+
+    if ((int32_t)(nowS - telemetryDueS) < 0)
+        return 0;
+    telemetryDueS = nowS + METRICS_PERIOD_S;
+    return 1;
+}
+
+/* Stack high-water marks, from the 0xBE the kernel fills stacks with (release.cfg), and the
+ * heap in use. The heap's gate is a mutex: task context only. */
+static void memorySample(void)
+{
+    Task_Stat taskStat;
+    Hwi_StackInfo systemStack;
+    Memory_Stats heapStats;
+
+    Task_stat(mainTask, &taskStat);
+    metricMax(METRIC_MAIN_STACK_PEAK, taskStat.used);
+    Hwi_getStackInfo(&systemStack, TRUE);
+    metricMax(METRIC_SYSTEM_STACK_PEAK, systemStack.hwiStackPeak);
+    Memory_getStats(NULL, &heapStats);
+    metricMax(METRIC_HEAP_PEAK, heapStats.totalSize - heapStats.totalFreeSize);
+}
+
+/* Frame a snapshot of the metrics into packet[]. Module statistics are copied in with it. */
+static void macBuildTelemetryFrame(void)
+{
+    static MetricsSnapshot snapshot;
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_TELEMETRY;
+    hdr.flags  = 0;
+    hdr.nodeId = nodeId;
+#if SECURE_LINK
+    /* Sealed frames share one frame counter, a nonce must never repeat. The ARQ window
+     * gives up on the gap. */
+    hdr.seq    = seqNumber++;
+#else
+    hdr.seq    = telemetrySeq++;
+#endif
+
+    metricsSnapshot(&snapshot, uptimeS());
+#ifdef EPOCH_MERGE
+    snapshot.counters[METRIC_SENTENCES] = gnssInput.frames;
+    snapshot.counters[METRIC_BAD_SENTENCES] = gnssInput.badFrames;
+#endif
+#ifdef FIX_LOG
+    snapshot.gauges[METRIC_LOG_BACKLOG] = fixLog.count;
+#endif
+
+    pktEncodeHeader(&hdr, packet);
+    packetLength = PKT_HEADER_LENGTH +
+                   metricsEncode(&snapshot, packet + PKT_HEADER_LENGTH, SENTENCE_MAX_LENGTH);
+}
+
+/* A TX command that ended */
+static void txStatusMetric(uint16_t status, uint8_t length)
+{
+    metricInc(METRIC_TX_FRAMES);
+    metricObserve(METRIC_FRAME_LENGTH, length);
+    if (status != PROP_DONE_OK)
+        metricInc(METRIC_TX_FAILED);
+    if (status >= PROP_ERROR_PAR)
+    {
+        metricInc(METRIC_RF_ERRORS);
+        metricSet(METRIC_RF_LAST_ERROR, status);
+    }
+}
+
+#if SECURE_LINK
+/* SecureCipher on the AESCCM driver, polling: the crypto core is done long before a
+ * semaphore round trip would be */
+static uint8_t aesccmSetKey(void * ctx, const uint8_t * key)
+{
+    memcpy(secureKeyMaterial, key, SECURE_KEY_LENGTH);
+    return CryptoKeyPlaintext_initKey(&secureKey, secureKeyMaterial, SECURE_KEY_LENGTH) !=
+           CryptoKey_STATUS_SUCCESS;
+}
+
+static uint8_t aesccmRun(void * ctx, uint8_t encrypt, const uint8_t * nonce, uint8_t nonceLength,
+                         const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                         uint8_t * mic, uint8_t micLength)
+{
+    AESCCM_Operation operation;
+    int_fast16_t status;
+
+    AESCCM_Operation_init(&operation);
+    operation.key         = &secureKey;
+    operation.aad         = (uint8_t*)aad;
+    operation.aadLength   = aadLength;
+    operation.input       = data;
+    operation.output      = secureScratch;
+    operation.inputLength = length;
+    operation.nonce       = (uint8_t*)nonce;
+    operation.nonceLength = nonceLength;
+    operation.mac         = mic;
+    operation.macLength   = micLength;
+
+    if (encrypt)
+        status = AESCCM_oneStepEncrypt((AESCCM_Handle)ctx, &operation);
+    else
+        status = AESCCM_oneStepDecrypt((AESCCM_Handle)ctx, &operation);
+
+    if (status != AESCCM_STATUS_SUCCESS)
+        return 1;
+
+    memcpy(data, secureScratch, length);
+    return 0;
+}
+
+static uint8_t aesccmEncrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                             const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                             uint8_t * mic, uint8_t micLength)
+{
+    return aesccmRun(ctx, 1, nonce, nonceLength, aad, aadLength, data, length, mic, micLength);
+}
+
+static uint8_t aesccmDecrypt(void * ctx, const uint8_t * nonce, uint8_t nonceLength,
+                             const uint8_t * aad, uint8_t aadLength, uint8_t * data, uint8_t length,
+                             const uint8_t * mic, uint8_t micLength)
+{
+    return aesccmRun(ctx, 0, nonce, nonceLength, aad, aadLength, data, length, (uint8_t*)mic, micLength);
+}
+
+static void secureStoreEpoch(void)
+{
+    uint32_t stored = secureNode.epoch;
+    NVS_write(epochNvsHandle, 0, &stored, sizeof(stored), NVS_WRITE_ERASE | NVS_WRITE_POST_VERIFY);
+}
+
+/* Seal the frame in packet[] in place */
+static void macSeal(void)
+{
+    uint16_t epoch = secureNode.epoch;
+
+    packetLength = secureSeal(&secureNode, packet, packetLength, PAYLOAD_LENGTH);
+
+    /* Only when all epochs of the key are used up: it needs a new key */
+    if (packetLength == 0)
+    {
+        while(1);
+    }
+
+    /* The sequence number wrapped: the new epoch must survive a reset */
+    if (secureNode.epoch != epoch)
+        secureStoreEpoch();
+}
+#endif
+
+static uint32_t macTrngRandom(void)
+{
+    uint32_t value = 0;
+    CryptoKey entropy;
+
+    CryptoKeyPlaintext_initBlankKey(&entropy, (uint8_t*)&value, sizeof(value));
+    TRNG_generateEntropy(trngHandle, &entropy);
+
+    return value;
+}
+
+#if PHY_CHANNELS > 1
+/* Tune hopFs to the channel of the frame RF_cmdPropTx points to and put it ahead of chain.
+ * In CSMA it runs ahead of the backoff, so the sense and the TX need no retune. */
+static RF_Op* hopChain(RF_Op* chain)
+{
+    PacketHeader hdr;
+
+    pktDecodeHeader(&hdr, RF_cmdPropTx.pPkt, RF_cmdPropTx.pktLen);
+    hopFsFrequency(hopChannel(hdr.nodeId, hdr.seq, PHY_CHANNELS), &hopFs.frequency, &hopFs.fractFreq);
+    hopFs.pNextOp = (rfc_radioOp_t*)chain;
+
+    return (RF_Op*)&hopFs;
+}
+#endif
+
+#if MAC_MODE == MAC_MODE_CSMA
+/* Send packet[] once the channel is clear. Every attempt waits a fresh random backoff
+ * and then runs the NOP -> CS -> TX chain; RF_cmdPropTx.status stays IDLE if the
+ * channel was busy on every attempt. */
+static RF_EventMask csmaTransmit(void)
+{
+    RF_EventMask terminationReason = RF_EventLastCmdDone;
+    uint8_t attempt;
+
+    for (attempt = 0; attempt < csmaConfig.maxAttempts; ++attempt)
+    {
+        uint32_t backoff = csmaBackoffUs(&csmaConfig, attempt, macTrngRandom());
+
+        RF_cmdPropTx.status = IDLE;
+        RF_cmdNop.startTime = RF_getCurrentTime() + RAT_US(backoff);
+
+        terminationReason = RF_runCmd(rfHandle, TX_CHAIN((RF_Op*)&RF_cmdNop),
+                                      RF_PriorityNormal, TX_CALLBACK, TX_CALLBACK_EVENTS);
+
+        if (((volatile RF_Op*)&RF_cmdPropTx)->status != IDLE)
+            break;
+    }
+
+    return terminationReason;
+}
+#endif
+
+#if MAC_MODE != MAC_MODE_TDMA
+/* Send the frame RF_cmdPropTx points to and check how it went */
+static void macTransmit(void)
+{
+#if MAC_MODE == MAC_MODE_CSMA
+    RF_EventMask terminationReason = csmaTransmit();
+#else
+    RF_EventMask terminationReason = RF_runCmd(rfHandle, TX_CHAIN((RF_Op*)&RF_cmdPropTx),
+                                               RF_PriorityNormal, TX_CALLBACK, TX_CALLBACK_EVENTS);
+#endif
+
+    switch(terminationReason)
+    {
+        case RF_EventLastCmdDone:
+            // A stand-alone radio operation command or the last radio
+            // operation command in a chain finished.
+            break;
+        case RF_EventCmdCancelled:
+            // Command cancelled before it was started; it can be caused
+            // by RF_cancelCmd() or RF_flushCmd().
+            break;
+        case RF_EventCmdAborted:
+            // Abrupt command termination caused by RF_cancelCmd() or
+            // RF_flushCmd().
+            break;
+        case RF_EventCmdStopped:
+            // Graceful command termination caused by RF_cancelCmd() or
+            // RF_flushCmd().
+            break;
+        default:
+            // Uncaught error event
+            while(1);
+    }
+
+    uint32_t cmdStatus = ((volatile RF_Op*)&RF_cmdPropTx)->status;
+    txStatusMetric(cmdStatus, RF_cmdPropTx.pktLen);
+    switch(cmdStatus)
+    {
+        case PROP_DONE_OK:
+            // Packet transmitted successfully
+            break;
+        case PROP_DONE_STOPPED:
+            // received CMD_STOP while transmitting packet and finished
+            // transmitting packet
+            break;
+        case PROP_DONE_ABORT:
+            // Received CMD_ABORT while transmitting packet
+            break;
+        case PROP_ERROR_PAR:
+            // Observed illegal parameter
+            break;
+        case PROP_ERROR_NO_SETUP:
+            // Command sent without setting up the radio in a supported
+            // mode using CMD_PROP_RADIO_SETUP or CMD_RADIO_SETUP
+            break;
+        case PROP_ERROR_NO_FS:
+            // Command sent without the synthesizer being programmed
+            break;
+        case PROP_ERROR_TXUNF:
+            // TX underflow observed during operation
+            break;
+#if MAC_MODE == MAC_MODE_CSMA
+        case IDLE:
+            // Channel busy on every carrier sense attempt, the
+            // sentence is dropped
+            break;
+#endif
+        default:
+            // Uncaught error event - these could come from the
+            // pool of states defined in rf_mailbox.h
+            while(1);
+    }
+}
+#endif
+
+#if MAC_ACK
+static void arqRxCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e)
+{
+    if (e & RF_EventRxEntryDone)
+    {
+        rfc_dataEntryGeneral_t* entry = RFQueue_getDataEntry();
+
+        uint8_t  length = *(uint8_t*)(&entry->data);
+        uint8_t* frame  =  (uint8_t*)(&entry->data + 1);
+        PacketHeader hdr;
+
+        /* ACKs for other trackers share the channel, only ours count */
+        if (pktDecodeHeader(&hdr, frame, length) == 0 && hdr.type == PKT_TYPE_ACK &&
+            hdr.nodeId == nodeId)
+        {
+            arqNodeOnAck(&arqNode, hdr.seq, frame + PKT_HEADER_LENGTH,
+                         length - PKT_HEADER_LENGTH);
+        }
+
+        RFQueue_nextEntry();
+    }
+}
+
+#if TX_POWER_CONTROL
+/* Switch to the controller's level: now, and for every later setup of the radio */
+static void txPowerApply(void)
+{
+    const TxPowerLevel * level = txpLevel(&txPowerControl);
+    rfc_CMD_SET_TX_POWER_t setTxPower = { .commandNo = CMD_SET_TX_POWER };
+
+    setTxPower.txPower = level->txPower;
+    RF_runImmediateCmd(rfHandle, (uint32_t*)&setTxPower);
+
+    RF_cmdPropRadioDivSetup.txPower = level->txPower;
+    RF_control(rfHandle, RF_CTRL_UPDATE_SETUP_CMD, NULL);
+}
+
+/* A frame's ACK window closed: report what the ACK said, or that there was none */
+static void txPowerAfterWindow(void)
+{
+    uint8_t changed;
+
+    if (arqNode.unanswered == 0)
+        changed = arqNode.ackRssi != ARQ_NO_RSSI && txpReport(&txPowerControl, arqNode.ackRssi);
+    else
+        changed = txpMissed(&txPowerControl);
+
+    if (changed)
+        txPowerApply();
+}
+#endif
+
+/* One transmit opportunity: every frame still waiting for its ACK goes out once */
+static void arqSendRound(void)
+{
+    uint8_t slot;
+
+    arqNodeStartRound(&arqNode);
+
+    while ((slot = arqNodeNext(&arqNode)) != ARQ_NONE)
+    {
+        RF_cmdPropTx.pPkt = arqNode.entry[slot].frame;
+        RF_cmdPropTx.pktLen = arqNode.entry[slot].length;
+        macTransmit();
+        arqNodeSent(&arqNode, slot);
+#if TX_POWER_CONTROL
+        txPowerAfterWindow();
+#endif
+    }
+}
+#endif
+
+#ifdef FIX_LOG
+static uint8_t nvsRead(void * ctx, uint32_t offset, void * buf, uint32_t length)
+{
+    return NVS_read((NVS_Handle)ctx, offset, buf, length) != NVS_STATUS_SUCCESS;
+}
+
+static uint8_t nvsWrite(void * ctx, uint32_t offset, const void * buf, uint32_t length)
+{
+    /* Plain page program, the log never writes over programmed bits */
+    return NVS_write((NVS_Handle)ctx, offset, (void*)buf, length, 0) != NVS_STATUS_SUCCESS;
+}
+
+static uint8_t nvsErase(void * ctx, uint32_t offset, uint32_t length)
+{
+    return NVS_erase((NVS_Handle)ctx, offset, length) != NVS_STATUS_SUCCESS;
+}
+#endif
+
+#if defined(FIX_LOG) || defined(FIX_FILTER) || defined(TRACK_COMPRESS) || defined(GEOFENCE)
+/* NMEA ddmm.mmmm to degrees * 1e7 */
+static int32_t fixDegreesE7(double value, char direction)
+{
+    double degrees = (int32_t)(value / 100);
+    degrees += (value - degrees * 100) / 60;
+
+    int32_t e7 = (int32_t)(degrees * 1e7 + 0.5);
+    return (direction == 'S' || direction == 'W') ? -e7 : e7;
+}
+
+/* Parse a GGA or RMC sentence into gpsData. Returns 0 if it carried a position. */
+static uint8_t fixParseSentence(const char * sentence, uint8_t length)
+{
+    char buf[SENTENCE_LENGTH];
+
+    if (length >= sizeof(buf) || memchr(sentence, '*', length) == NULL)
+        return 1;
+
+    memcpy(buf, sentence, length);
+    buf[length] = '\0';
+
+    nmeaDataInit(&gpsData);
+    if (nmeaReceiveSentence(&gpsData, buf) || nmeaParse(&gpsData) ||
+        (gpsData.nmeaData.msgType != NMEA_GGA && gpsData.nmeaData.msgType != NMEA_RMC))
+        return 1;
+
+    /* Empty position fields while the receiver has no fix */
+    if ((gpsData.latDirection != 'N' && gpsData.latDirection != 'S') ||
+        (gpsData.longDirection != 'E' && gpsData.longDirection != 'W'))
+        return 1;
+
+    return 0;
+}
+
+/* UTC time of day of the parsed sentence */
+static uint32_t fixTimeMs(void)
+{
+    uint32_t hhmmss = (uint32_t)gpsData.time;
+
+    return ((hhmmss / 10000) * 3600 + (hhmmss / 100 % 100) * 60 + hhmmss % 100) * 1000 +
+           (uint32_t)((gpsData.time - hhmmss) * 1000 + 0.5);
+}
+#endif
+
+#ifdef EPOCH_MERGE
+/* Milliseconds on the system clock, for the epoch wait */
+static uint32_t epochClockMs(void)
+{
+    return (uint32_t)((uint64_t)Clock_getTicks() * Clock_tickPeriod / 1000);
+}
+#endif
+
+#ifdef GNSS_CONFIGURE
+static uint32_t gnssUartNowMs(void * ctx)
+{
+    return epochClockMs();
+}
+
+static void gnssUartSetBaud(void * ctx, uint32_t baud)
+{
+    GnssUartCtx * c = ctx;
+
+    UART_close(*c->uart);
+    c->params->baudRate = baud;
+    *c->uart = UART_open(Board_UART0, c->params);
+    if (*c->uart == NULL)
+    {
+        while(1);
+    }
+}
+
+static void gnssUartWrite(void * ctx, const uint8_t * data, uint16_t length)
+{
+    UART_write(*((GnssUartCtx *)ctx)->uart, data, length);
+}
+
+/* Each UART_read returns after GNSS_READ_TIMEOUT_MS at the latest */
+static uint16_t gnssUartRead(void * ctx, uint8_t * buf, uint16_t max, uint16_t timeoutMs)
+{
+    GnssUartCtx * c = ctx;
+    uint32_t start = epochClockMs();
+    uint16_t n = 0;
+    int_fast32_t r;
+
+    while (n < max && epochClockMs() - start < timeoutMs)
+    {
+        r = UART_read(*c->uart, buf + n, max - n);
+        if (r > 0)
+        {
+            n += r;
+        }
+    }
+    return n;
+}
+#endif
+
+#if defined(FIX_LOG) || defined(TRACK_COMPRESS) || defined(GEOFENCE)
+/* Compact record of a GGA sentence. Returns 0 if it carried a position. */
+static uint8_t fixFromSentence(const char * sentence, uint8_t length, FixRecord * rec)
+{
+    if (fixParseSentence(sentence, length) || gpsData.nmeaData.msgType != NMEA_GGA)
+        return 1;
+
+    rec->timeMs = fixTimeMs();
+    rec->latE7  = fixDegreesE7(gpsData.latitude, gpsData.latDirection);
+    rec->lonE7  = fixDegreesE7(gpsData.longitude, gpsData.longDirection);
+    rec->altM   = (int16_t)gpsData.altitude;
+
+    return 0;
+}
+#endif
+
+#ifdef FIX_LOG
+
+/* Put the oldest records into a LOG frame and hand it to the retry buffer.
+ * Returns the number of records, 0 if the log is empty. */
+static uint8_t fixLogQueueBatch(void)
+{
+    FixRecord records[FIX_LOG_BATCH];
+    uint8_t n = fixLogPeek(&fixLog, records, FIX_LOG_BATCH);
+    uint8_t i;
+
+    if (n == 0)
+        return 0;
+
+    PacketHeader hdr;
+    hdr.type   = PKT_TYPE_LOG;
+    hdr.flags  = 0;
+    hdr.nodeId = nodeId;
+    hdr.seq    = seqNumber++;
+
+    packetLength = pktEncodeHeader(&hdr, packet);
+    for (i = 0; i < n; ++i)
+    {
+        fixRecordEncode(&records[i], packet + packetLength);
+        packetLength += FIX_RECORD_WIRE_LENGTH;
+    }
+#if SECURE_LINK
+    macSeal();
+#endif
+
+    arqNodeQueue(&arqNode, packet, packetLength);
+    logSeq = hdr.seq;
+    logInFlight = n;
+
+    return n;
+}
+
+/* Send the backlog back to back for up to FIX_LOG_DRAIN_US, as fast as the MAC and the
+ * ACKs let us. Records leave the flash only once the gateway acknowledged their frame. */
+static void fixLogDrain(void)
+{
+    uint32_t start = RF_getCurrentTime();
+
+    while (arqNodeLinkUp(&arqNode) &&
+           RF_getCurrentTime() - start < RAT_US(FIX_LOG_DRAIN_US))
+    {
+        if (logInFlight && arqNodeAcked(&arqNode, logSeq))
+        {
+            fixLogConsume(&fixLog, logInFlight);
+            logInFlight = 0;
+        }
+        else if (logInFlight && !arqNodePending(&arqNode, logSeq))
+        {
+            /* Given up after maxTries, the records are still on flash */
+            logInFlight = 0;
+        }
+
+        if (!logInFlight && fixLogQueueBatch() == 0)
+            break;
+
+        arqSendRound();
+    }
+}
+#endif
+
+#ifdef FIX_GATE
+#ifdef EPOCH_MERGE
+/* Returns 1 for an epoch the gate lets through. Fix mode and DOPs are the input layer's latest. */
+static uint8_t fixGateEpoch(const EpochFix * epoch)
+{
+    FixQuality q;
+
+    q.quality    = epoch->quality;
+    q.satellites = epoch->satellites;
+    q.fixMode    = gnssInput.fixMode;
+    q.hdop       = epoch->hdop;
+    q.pdop       = gnssInput.pdop;
+    q.vdop       = gnssInput.vdop;
+
+    return fixGateCheck(&fixGate, &q, epoch->fix.timeMs);
+}
+#else
+/* DOP in hundredths, FIX_GATE_NO_DOP without a GSA */
+static uint16_t gateDop(double dop)
+{
+    if (gateData.fixMode == 0)
+        return FIX_GATE_NO_DOP;
+    return dop < 600 ? (uint16_t)(dop * 100 + 0.5) : 60000;
+}
+
+/* Every sentence updates the quality state. Returns 1 for a GGA or RMC the gate lets through. */
+static uint8_t fixGateSentence(char * sentence)
+{
+    FixQuality q;
+
+    if (nmeaReceiveSentence(&gateData, sentence) || nmeaParse(&gateData) ||
+        (gateData.nmeaData.msgType != NMEA_GGA && gateData.nmeaData.msgType != NMEA_RMC))
+        return 0;
+
+    /* A void RMC has no fix, whatever the last GGA said */
+    q.quality    = (gateData.nmeaData.msgType == NMEA_RMC && gateData.status != 'A') ? 0 : gateData.fixQuality;
+    q.satellites = gateData.numSatellites;
+    q.fixMode    = gateData.fixMode;
+    q.hdop       = gateData.hdop < 600 ? (uint16_t)(gateData.hdop * 100 + 0.5) : 60000;
+    q.pdop       = gateDop(gateData.pdop);
+    q.vdop       = gateDop(gateData.vdop);
+
+    uint32_t hhmmss = (uint32_t)gateData.time;
+    return fixGateCheck(&fixGate, &q, ((hhmmss / 10000) * 3600 + (hhmmss / 100 % 100) * 60 + hhmmss % 100) * 1000);
+}
+#endif
+#endif
+
+#ifdef FIX_FILTER
+/* Degrees * 1e7 as the NMEA fields [d]ddmm.mmmm,H. Returns the length. */
+static uint8_t fixFormatDegrees(char * out, int32_t e7, uint8_t degreeDigits, char positive, char negative)
+{
+    uint32_t value = e7 < 0 ? -e7 : e7;
+    uint32_t degrees = value / 10000000;
+    uint32_t minutes = ((value % 10000000) * 6 + 50) / 100;    /* 1e-4 minutes */
+
+    if (minutes == 600000)
+    {
+        ++degrees;
+        minutes = 0;
+    }
 
-/* Board Header files */
-#include "Board.h"
-#include "smartrf_settings/smartrf_settings.h"
+    return sprintf(out, "%0*lu%02lu.%04lu,%c", degreeDigits, (unsigned long)degrees,
+                   (unsigned long)(minutes / 10000), (unsigned long)(minutes % 10000),
+                   e7 < 0 ? negative : positive);
+}
 
-/***** Defines *****/
+/* Start of the given comma separated field, NULL if the sentence has fewer */
+static const char * fixField(const char * sentence, const char * end, uint8_t field)
+{
+    while (field > 0 && sentence < end)
+    {
+        if (*sentence++ == ',')
+            --field;
+    }
 
-/* Do power measurement */
-//#define POWER_MEASUREMENT
+    return field ? NULL : sentence;
+}
 
-/* Packet TX Configuration */
-#define PAYLOAD_LENGTH      102
-#ifdef POWER_MEASUREMENT
-#define PACKET_INTERVAL     5  /* For power measurement set packet interval to 5s */
-#else
-#define PACKET_INTERVAL     500000  /* Set packet interval to 500us or 0.5ms */
+/* Put a position into the parsed GGA or RMC sentence and redo the checksum. The sentence
+ * is left alone if the result would be longer than NMEA allows. */
+static void fixSetSentencePosition(char * sentence, uint8_t * length, int32_t latE7, int32_t lonE7)
+{
+    char out[SENTENCE_LENGTH + 24];     /* the position fields take at most 24 */
+    uint8_t latField = gpsData.nmeaData.msgType == NMEA_GGA ? 2 : 3;
+    const char * end = memchr(sentence, '*', *length);
+    const char * lat = end ? fixField(sentence, end, latField) : NULL;
+    const char * rest = end ? fixField(sentence, end, latField + 4) : NULL;
+    uint8_t checksum = 0;
+    uint8_t n, i;
+
+    if (lat == NULL || rest == NULL)
+        return;
+    --rest;     /* keeps the comma ending the longitude */
+
+    n = lat - sentence;
+    memcpy(out, sentence, n);
+    n += fixFormatDegrees(out + n, latE7, 2, 'N', 'S');
+    out[n++] = ',';
+    n += fixFormatDegrees(out + n, lonE7, 3, 'E', 'W');
+
+    /* Rest of the fields, then *hh and CR LF */
+    if (n + (end - rest) + 5 > SENTENCE_LENGTH - 1)
+        return;
+    memcpy(out + n, rest, end - rest);
+    n += end - rest;
+
+    for (i = 1; i < n; ++i)
+        checksum ^= out[i];
+    n += sprintf(out + n, "*%02X\r\n", checksum);
+
+    memcpy(sentence, out, n);
+    *length = n;
+}
+
+/* Run the fix of a sentence through the filter. Returns 1 if the sentence should be sent,
+ * it then carries the filtered position. Sentences without a fix are sent as they are. */
+static uint8_t fixFilterSentence(char * sentence, uint8_t * length)
+{
+    FixMeasurement m;
+    int32_t latE7, lonE7;
+
+    if (fixParseSentence(sentence, *length))
+        return 1;
+
+    m.timeMs     = fixTimeMs();
+    m.latE7      = fixDegreesE7(gpsData.latitude, gpsData.latDirection);
+    m.lonE7      = fixDegreesE7(gpsData.longitude, gpsData.longDirection);
+    m.speedCmS   = FIX_FILTER_NO_SPEED;
+    m.courseCdeg = 0;
+
+    if (gpsData.nmeaData.msgType == NMEA_RMC && gpsData.groundSpeed < 1000)
+    {
+        m.speedCmS   = (uint16_t)(gpsData.groundSpeed * 51.444 + 0.5);     /* knots */
+        m.courseCdeg = (uint16_t)(gpsData.trueCourse * 100 + 0.5) % 36000;
+    }
+
+    if (fixFilterUpdate(&fixFilter, &m) != FIX_FILTER_SEND)
+        return 0;
+
+    fixFilterPosition(&fixFilter, &latE7, &lonE7);
+    fixSetSentencePosition(sentence, length, latE7, lonE7);
+    return 1;
+}
 #endif
 
-/***** Prototypes *****/
+#if MAC_MODE == MAC_MODE_TDMA
+static uint32_t macRandom(void)
+{
+    /* xorshift32, only used to spread JOIN frames over the join slots */
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
 
-/***** Variable declarations *****/
-static RF_Object rfObject;
-static RF_Handle rfHandle;
+/* Listen for the next beacon, starting TDMA_GUARD_US before it is due.
+ * Without sync, listen until a beacon arrives. */
+static void tdmaListenForBeacon(void)
+{
+    beaconSeen = 0;
 
-/* Pin driver handle */
-static PIN_Handle ledPinHandle;
-static PIN_State ledPinState;
+    if (tdmaNode.synced)
+    {
+        uint32_t window = RAT_US(TDMA_GUARD_US) * (tdmaNode.missedBeacons + 1);
+        uint32_t due = beaconTime + RAT_US(tdmaFrameLengthUs(&tdmaNode.cfg))
+                                    * (tdmaNode.missedBeacons + 1);
 
-static uint8_t packet[PAYLOAD_LENGTH];
-static uint16_t seqNumber;
+        RF_cmdPropRx.startTrigger.triggerType = TRIG_ABSTIME;
+        RF_cmdPropRx.startTrigger.pastTrig = 1;
+        RF_cmdPropRx.startTime = due - window;
+        RF_cmdPropRx.endTrigger.triggerType = TRIG_ABSTIME;
+        RF_cmdPropRx.endTime = due + window + RAT_US(tdmaNode.cfg.beaconMs * 1000UL);
+    }
+    else
+    {
+        RF_cmdPropRx.startTrigger.triggerType = TRIG_NOW;
+        RF_cmdPropRx.endTrigger.triggerType = TRIG_NEVER;
+    }
 
-/*
- * Application LED pin configuration table:
- *   - All LEDs board LEDs are off.
- */
-PIN_Config pinTable[] =
+    RF_postCmd(rfHandle, (RF_Op*)&RF_cmdPropRx, RF_PriorityNormal,
+               &tdmaRxCallback, RF_EventRxEntryDone);
+}
+
+#if MAC_ADR
+/* Sets the modulation of the second RF client to a profile above PHY_PROFILE; the RF
+ * driver runs the setup again before the next command of that client */
+static void phySelectFast(uint8_t rate)
 {
-    Board_PIN_LED1 | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
-#ifdef POWER_MEASUREMENT
-#if defined(Board_CC1350_LAUNCHXL)
-    Board_DIO30_SWPWR | PIN_GPIO_OUTPUT_EN | PIN_GPIO_HIGH | PIN_PUSHPULL | PIN_DRVSTR_MAX,
+    const PhyProfile * phy = &phyProfiles[rate];
+
+    if (rate == fastRate)
+        return;
+
+    RF_cmdPropRadioDivSetupFast.modulation.deviation = phy->deviation;
+    RF_cmdPropRadioDivSetupFast.symbolRate.rateWord = phy->rateWord;
+    RF_cmdPropRadioDivSetupFast.rxBw = phy->rxBw;
+    RF_cmdPropRadioDivSetupFast.preamConf.nPreamBytes = phy->preambleLength;
+    RF_cmdPropRadioDivSetupFast.formatConf.fecMode = phy->fecMode;
+    RF_control(rfHandleFast, RF_CTRL_UPDATE_SETUP_CMD, NULL);
+    fastRate = rate;
+}
 #endif
+
+/* Queue the transmission for this superframe: the latest sentence in our own slot,
+ * or a JOIN frame in a random join slot while we have none */
+static void tdmaScheduleSlot(void)
+{
+    uint8_t slot = tdmaNode.slot;
+    uint8_t length = 0;
+
+    if (slot != TDMA_NO_SLOT)
+    {
+        uintptr_t key = HwiP_disable();
+        length = packetLength;
+        memcpy(slotPacket, packet, length);
+        packetLength = 0;
+        HwiP_restore(key);
+    }
+    else
+    {
+        PacketHeader hdr;
+        hdr.type   = PKT_TYPE_JOIN;
+        hdr.flags  = 0;
+        hdr.nodeId = nodeId;
+        hdr.seq    = 0;
+
+        slot = tdmaNodeJoinSlot(&tdmaNode, macRandom());
+        length = pktEncodeHeader(&hdr, slotPacket);
+    }
+
+    if (length == 0 || slot == TDMA_NO_SLOT)
+        return;
+
+    RF_cmdPropTx.pPkt = slotPacket;
+    RF_cmdPropTx.pktLen = length;
+    RF_cmdPropTx.startTrigger.triggerType = TRIG_ABSTIME;
+    /* A late slot is skipped rather than spilling into the neighbour's slot */
+    RF_cmdPropTx.startTrigger.pastTrig = 0;
+    RF_cmdPropTx.startTime = beaconTime + RAT_US(tdmaSlotOffsetUs(&tdmaNode.cfg, slot));
+
+    RF_Handle handle = rfHandle;
+#if MAC_ADR
+    /* At the rate the beacon gave our slot; JOIN frames always at PHY_PROFILE */
+    if (slot < tdmaNode.cfg.numSlots && tdmaNode.cfg.rate[slot] != PHY_PROFILE)
+    {
+        phySelectFast(tdmaNode.cfg.rate[slot]);
+        handle = rfHandleFast;
+    }
 #endif
-    PIN_TERMINATE
-};
 
-/********************** GPS Sensor Connection **********************/
-/********* GND - GND, 3V3 - 3V3, TX - DIO2, WUP - DIO22, PWR - DIO24  *********/
+    TRACE_BEGIN(TRACE_RF_CMD);
+    RF_postCmd(handle, (RF_Op*)&RF_cmdPropTx, RF_PriorityNormal,
+               &tdmaTxCallback, 0);
+}
+
+static void tdmaRxCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e)
+{
+    if (e & RF_EventRxEntryDone)
+    {
+        rfc_dataEntryGeneral_t* entry = RFQueue_getDataEntry();
 
+        /* Length byte, frame, then the 4 byte RX timestamp and the status byte */
+        uint8_t  length = *(uint8_t*)(&entry->data);
+        uint8_t* frame  =  (uint8_t*)(&entry->data + 1);
+        PacketHeader hdr;
 
-/***** Function definitions *****/
+        if (pktDecodeHeader(&hdr, frame, length) == 0 && hdr.type == PKT_TYPE_BEACON &&
+            tdmaNodeOnBeacon(&tdmaNode, frame + PKT_HEADER_LENGTH,
+                             length - PKT_HEADER_LENGTH) == 0)
+        {
+            /* All slot times are taken relative to the beacon as this node saw it,
+             * the constant preamble/sync delay is absorbed by the slot guard time */
+            memcpy(&beaconTime, frame + length, sizeof(beaconTime));
+            beaconSeen = 1;
+        }
+
+        RFQueue_nextEntry();
+    }
+
+    if (e & RF_EventLastCmdDone)
+    {
+        if (beaconSeen)
+        {
+            tdmaScheduleSlot();
+        }
+        else if (tdmaNode.synced)
+        {
+            tdmaNodeBeaconMissed(&tdmaNode);
+        }
+
+        tdmaListenForBeacon();
+    }
+}
+
+static void tdmaTxCallback(RF_Handle h, RF_CmdHandle ch, RF_EventMask e)
+{
+    if (e & RF_EventLastCmdDone)
+    {
+        TRACE_END(TRACE_RF_CMD);
+        TRACE_MARK(TRACE_RF_DONE);
+        txStatusMetric(((volatile RF_Op*)&RF_cmdPropTx)->status, RF_cmdPropTx.pktLen);
+    }
+#ifndef POWER_MEASUREMENT
+    if ((e & RF_EventLastCmdDone) &&
+        ((volatile RF_Op*)&RF_cmdPropTx)->status == PROP_DONE_OK)
+    {
+        PIN_setOutputValue(ledPinHandle, Board_PIN_LED1,!PIN_getOutputValue(Board_PIN_LED1));
+    }
+#endif
+}
+#endif
+
+#if TRACE_ENABLED
+static void traceButtonCallback(PIN_Handle handle, PIN_Id pinId)
+{
+    if (pinId == Board_PIN_BUTTON0)
+        traceDumpRequested = 1;
+}
+
+static void traceUartWrite(void * ctx, const uint8_t * data, uint16_t length)
+{
+    UART_write((UART_Handle)ctx, data, length);
+}
+#endif
 
 void *mainThread(void *arg0)
 {
@@ -104,7 +1449,9 @@ void *mainThread(void *arg0)
     RF_Params rfParams;
     RF_Params_init(&rfParams);
     char message[100];
+#if !defined(EPOCH_MERGE) && !defined(TRACK_COMPRESS) && !defined(GEOFENCE)
     const char  newline[] = "\r\n";
+#endif
     char        input;
     uint8_t count = 0;
 
@@ -118,6 +1465,16 @@ void *mainThread(void *arg0)
         while(1);
     }
 
+#if TRACE_ENABLED
+    /* The cycle counter stops while the CPU sleeps: stay awake */
+    Power_disablePolicy();
+    traceInit();
+    PIN_registerIntCb(ledPinHandle, &traceButtonCallback);
+#endif
+    metricsInit();
+    uptimeS();
+    mainTask = Task_self();
+
     /* Configure the LED pin */
     GPIO_setConfig(Board_GPIO_LED0, GPIO_CFG_OUT_STD | GPIO_CFG_OUT_LOW);
     /* initialize DIO12, DIO22 as output */
@@ -133,7 +1490,7 @@ void *mainThread(void *arg0)
     uartParams.readDataMode = UART_DATA_BINARY;
     uartParams.readReturnMode = UART_RETURN_FULL;
     uartParams.readEcho = UART_ECHO_OFF;
-    uartParams.baudRate = 4800;     //GPS Sensor uses 4800 Baudrate
+    uartParams.baudRate = GNSS_BAUD_DEFAULT;
 
     uart = UART_open(Board_UART0, &uartParams);
 
@@ -157,10 +1514,211 @@ void *mainThread(void *arg0)
 #endif
 #endif
 
+    nodeId = macNodeId();
+
+    TRNG_init();
+    trngHandle = TRNG_open(Board_TRNG0, NULL);
+    if (trngHandle == NULL)
+    {
+        while(1);
+    }
+
+#if SECURE_LINK
+    AESCCM_Params aesccmParams;
+    uint32_t storedEpoch;
+
+    AESCCM_init();
+    AESCCM_Params_init(&aesccmParams);
+    aesccmParams.returnBehavior = AESCCM_RETURN_BEHAVIOR_POLLING;
+    aesccmHandle = AESCCM_open(Board_AESCCM0, &aesccmParams);
+
+    secureCipher.ctx = aesccmHandle;
+    secureCipher.setKey = aesccmSetKey;
+    secureCipher.encrypt = aesccmEncrypt;
+    secureCipher.decrypt = aesccmDecrypt;
+
+    /* Same vectors as the host stand-in; a crypto core that fails them never sends */
+    if (aesccmHandle == NULL || secureSelfTest(&secureCipher))
+    {
+        while(1);
+    }
+
+    /* Every boot is a new epoch, so no frame counter is ever used twice */
+    NVS_init();
+    epochNvsHandle = NVS_open(Board_NVSINTERNAL, NULL);
+    if (epochNvsHandle == NULL ||
+        NVS_read(epochNvsHandle, 0, &storedEpoch, sizeof(storedEpoch)) != NVS_STATUS_SUCCESS)
+    {
+        while(1);
+    }
+    if (storedEpoch > 0xFFFF)
+        storedEpoch = 0;    /* erased */
+    if (storedEpoch == 0xFFFF)
+    {
+        /* Every epoch of this key was used, it needs a new key */
+        while(1);
+    }
+
+    if (secureNodeInit(&secureNode, &secureCipher, networkKey, (uint16_t)(storedEpoch + 1)))
+    {
+        while(1);
+    }
+    secureStoreEpoch();
+#endif
+
     RF_cmdPropTx.pktLen = PAYLOAD_LENGTH;
     RF_cmdPropTx.pPkt = packet;
     RF_cmdPropTx.startTrigger.triggerType = TRIG_NOW;
 
+#if MAC_MODE == MAC_MODE_TDMA
+    if( RFQueue_defineQueue(&dataQueue,
+                            rxDataEntryBuffer,
+                            sizeof(rxDataEntryBuffer),
+                            NUM_DATA_ENTRIES,
+                            RX_MAX_LENGTH + NUM_APPENDED_BYTES))
+    {
+        /* Failed to allocate space for all data entries */
+        while(1);
+    }
+
+    /* Modify CMD_PROP_RX command for beacon reception */
+    RF_cmdPropRx.pQueue = &dataQueue;
+    RF_cmdPropRx.rxConf.bAutoFlushIgnored = 1;
+    RF_cmdPropRx.rxConf.bAutoFlushCrcErr = 1;
+    /* The beacon timestamp is the time base for our slot */
+    RF_cmdPropRx.rxConf.bAppendTimestamp = 1;
+    RF_cmdPropRx.maxPktLen = RX_MAX_LENGTH;
+    /* End the command after the first good packet */
+    RF_cmdPropRx.pktConf.bRepeatOk = 0;
+    RF_cmdPropRx.pktConf.bRepeatNok = 1;
+
+    tdmaNodeInit(&tdmaNode, nodeId);
+
+#elif MAC_MODE == MAC_MODE_CSMA
+    csmaDefaultConfig(&csmaConfig);
+    RF_cmdNop.pNextOp = (rfc_radioOp_t*)&RF_cmdPropCs;
+    RF_cmdPropCs.pNextOp = (rfc_radioOp_t*)&RF_cmdPropTx;
+    RF_cmdPropCs.rssiThr = csmaConfig.rssiThresholdDbm;
+    RF_cmdPropCs.csEndTime = RAT_US(csmaConfig.senseUs);
+#endif
+
+#if MAC_ACK
+    ArqConfig arqConfig;
+    arqDefaultConfig(&arqConfig);
+    arqNodeInit(&arqNode, &arqConfig);
+#if TX_POWER_CONTROL
+    txpInit(&txPowerControl, phyProfiles[PHY_PROFILE].sensitivityDbm, TX_POWER_TARGET_MARGIN_DB);
+#endif
+
+    if( RFQueue_defineQueue(&dataQueue,
+                            rxDataEntryBuffer,
+                            sizeof(rxDataEntryBuffer),
+                            NUM_DATA_ENTRIES,
+                            RX_MAX_LENGTH + NUM_APPENDED_BYTES))
+    {
+        /* Failed to allocate space for all data entries */
+        while(1);
+    }
+
+    /* ACK window chained after every transmission: ends after the first good frame
+     * or rxWindowUs after it started, whichever comes first */
+    RF_cmdPropRx.pQueue = &dataQueue;
+    RF_cmdPropRx.rxConf.bAutoFlushIgnored = 1;
+    RF_cmdPropRx.rxConf.bAutoFlushCrcErr = 1;
+    RF_cmdPropRx.maxPktLen = RX_MAX_LENGTH;
+    RF_cmdPropRx.pktConf.bRepeatOk = 0;
+    RF_cmdPropRx.pktConf.bRepeatNok = 1;
+    RF_cmdPropRx.startTrigger.triggerType = TRIG_NOW;
+    RF_cmdPropRx.endTrigger.triggerType = TRIG_REL_START;
+    RF_cmdPropRx.endTime = RAT_US(arqNode.cfg.rxWindowUs);
+
+    /* No window if the frame did not go out */
+    RF_cmdPropTx.pNextOp = (rfc_radioOp_t*)&RF_cmdPropRx;
+    RF_cmdPropTx.condition.rule = COND_STOP_ON_FALSE;
+#endif
+
+#ifdef FIX_LOG
+    NVS_Attrs nvsAttrs;
+
+    /* Opening the region wakes the flash Board_initHook put to sleep */
+    NVS_init();
+    nvsHandle = NVS_open(Board_NVSEXTERNAL, NULL);
+    if (nvsHandle == NULL)
+    {
+        while(1);
+    }
+    NVS_getAttrs(nvsHandle, &nvsAttrs);
+
+    fixLogFlash.ctx = nvsHandle;
+    fixLogFlash.size = nvsAttrs.regionSize;
+    fixLogFlash.sectorSize = nvsAttrs.sectorSize;
+    fixLogFlash.pageSize = FIX_LOG_PAGE_SIZE;
+    fixLogFlash.read = nvsRead;
+    fixLogFlash.write = nvsWrite;
+    fixLogFlash.erase = nvsErase;
+
+    /* Picks up whatever was logged before a reset */
+    if (fixLogMount(&fixLog, &fixLogFlash))
+    {
+        while(1);
+    }
+#endif
+
+#ifdef FIX_GATE
+    FixGateConfig fixGateConfig;
+    fixGateDefaultConfig(&fixGateConfig);
+    fixGateInit(&fixGate, &fixGateConfig);
+#ifndef EPOCH_MERGE
+    nmeaRegisterHandlers(gateHandlers, sizeof(gateHandlers) / sizeof(gateHandlers[0]));
+    nmeaDataInit(&gateData);
+#endif
+#endif
+
+#ifdef EPOCH_MERGE
+#ifdef GNSS_UBX
+    gnssInputInit(&gnssInput, &gnssUbxBackend);
+#else
+    gnssInputInit(&gnssInput, &gnssNmeaBackend);
+#endif
+#ifdef GNSS_CONFIGURE
+    /* Reads time out while the rates are tried; whichever the receiver answers at, or
+     * GNSS_BAUD_DEFAULT if it never does, is kept and reads block again */
+    GnssUartCtx gnssUartCtx = { &uart, &uartParams };
+    GnssUart gnssUart = { gnssUartNowMs, gnssUartSetBaud, gnssUartWrite, gnssUartRead, &gnssUartCtx };
+    GnssBaudConfig gnssBaudConfig;
+    gnssBaudDefaultConfig(&gnssBaudConfig);
+    gnssBaudConfig.defaultBaud = GNSS_BAUD_DEFAULT;
+    gnssBaudConfig.targetBaud  = GNSS_BAUD;
+
+    uartParams.readTimeout = GNSS_READ_TIMEOUT_MS * 1000 / Clock_tickPeriod;
+    gnssUartSetBaud(&gnssUartCtx, GNSS_BAUD_DEFAULT);
+    gnssBaudNegotiate(&gnssBaud, &gnssBaudConfig, &gnssUart, &gnssInput);
+    uartParams.readTimeout = UART_WAIT_FOREVER;
+    gnssUartSetBaud(&gnssUartCtx, uartParams.baudRate);
+#endif
+#endif
+
+#ifdef FIX_FILTER
+    FixFilterConfig fixFilterConfig;
+    fixFilterDefaultConfig(&fixFilterConfig);
+    fixFilterInit(&fixFilter, &fixFilterConfig);
+#endif
+
+#ifdef TRACK_COMPRESS
+    TrackCompressConfig trackCompressConfig;
+    trackCompressDefaultConfig(&trackCompressConfig);
+    trackCompressInit(&trackCompressor, &trackCompressConfig);
+#endif
+
+#ifdef GEOFENCE
+    GeoFenceConfig geoFenceConfig;
+    geoFenceDefaultConfig(&geoFenceConfig);
+    if (geoFenceInit(&geoFencer, &geoFenceConfig, &fenceSet, fenceBoxes, fenceEntries, FENCE_INDEX_ENTRIES))
+    {
+        while(1);
+    }
+#endif
+
     /* Request access to the radio */
 #if defined(DeviceFamily_CC26X0R2)
     rfHandle = RF_open(&rfObject, &RF_prop, (RF_RadioSetup*)&RF_cmdPropRadioSetup, &rfParams);
@@ -171,103 +1729,256 @@ void *mainThread(void *arg0)
     /* Set the frequency */
     RF_postCmd(rfHandle, (RF_Op*)&RF_cmdFs, RF_PriorityNormal, NULL, 0);
 
+#if PHY_CHANNELS > 1
+    hopFs = RF_cmdFs;
+    hopFs.startTrigger.triggerType = TRIG_NOW;
+    hopFs.condition.rule = COND_ALWAYS;
+#endif
+
+#if MAC_ADR
+    /* The driver switches between the clients, each with its own setup and frequency */
+    rfHandleFast = RF_open(&rfObjectFast, &RF_propFast, (RF_RadioSetup*)&RF_cmdPropRadioDivSetupFast, &rfParams);
+    RF_postCmd(rfHandleFast, (RF_Op*)&RF_cmdFs, RF_PriorityNormal, NULL, 0);
+#endif
+
+#if MAC_MODE == MAC_MODE_TDMA
+    /* From here on the RF callbacks run the superframe on their own */
+    randomState = macTrngRandom() | 1;
+    tdmaListenForBeacon();
+#endif
+
     while(1)
     {
-        UART_read(uart, &input, 1);
+        if (UART_read(uart, &input, 1) != 1)
+        {
+            /* Overrun, framing or parity error */
+            metricInc(METRIC_UART_ERRORS);
+            continue;
+        }
+#ifdef EPOCH_MERGE
+        /* The input layer frames sentences or UBX frames and hands back merged fixes.
+         * Should one byte end two epochs, the newer one is sent. */
+        EpochFix epochs[GNSS_INPUT_MAX_FIXES];
+        uint8_t numEpochs = gnssInputPush(&gnssInput, input, epochClockMs(), epochs);
+        if (numEpochs == 0)
+            continue;
+        TRACE_BEGIN(TRACE_TX_SELECT);
+        const EpochFix * epoch = &epochs[numEpochs - 1];
+#ifdef FIX_GATE
+        if (!fixGateEpoch(epoch))
+        {
+            TRACE_END(TRACE_TX_SELECT);
+            continue;
+        }
+#endif
+#else
         message[count] = input;
         ++count;
-        if (input == '\n')
+        if (input != '\n' && count == sizeof(message) - 1)
         {
-             // Once we finish a line, check if msg is GGA or RMC
-
-            if ( (message[3] == 'G' && message[4] == 'G' && message[5] == 'A') ||
-                     (message[3] == 'R' && message[4] == 'M' && message[5] == 'C')   )
-            {
-
-                uint8_t i = 0;
-                packet[0] = (uint8_t)(seqNumber >> 8);
-                packet[1] = (uint8_t)(seqNumber ++);
-                for (i = 2; i < PAYLOAD_LENGTH; i++){
-                    packet[i] = message[i-2];
-                }
-                /* print the raw message via UART */
-                UART_write(uart, packet,sizeof(packet));
-                UART_write(uart, newline,sizeof(newline));
-                /* Send packet */
-                RF_EventMask terminationReason = RF_runCmd(rfHandle, (RF_Op*)&RF_cmdPropTx,
-                                                           RF_PriorityNormal, NULL, 0);
-
-                switch(terminationReason)
-                {
-                    case RF_EventLastCmdDone:
-                        // A stand-alone radio operation command or the last radio
-                        // operation command in a chain finished.
-                        break;
-                    case RF_EventCmdCancelled:
-                        // Command cancelled before it was started; it can be caused
-                    // by RF_cancelCmd() or RF_flushCmd().
-                        break;
-                    case RF_EventCmdAborted:
-                        // Abrupt command termination caused by RF_cancelCmd() or
-                        // RF_flushCmd().
-                        break;
-                    case RF_EventCmdStopped:
-                        // Graceful command termination caused by RF_cancelCmd() or
-                        // RF_flushCmd().
-                        break;
-                    default:
-                        // Uncaught error event
-                        while(1);
-                }
-
-                uint32_t cmdStatus = ((volatile RF_Op*)&RF_cmdPropTx)->status;
-                switch(cmdStatus)
-                {
-                    case PROP_DONE_OK:
-                        // Packet transmitted successfully
-                        break;
-                    case PROP_DONE_STOPPED:
-                        // received CMD_STOP while transmitting packet and finished
-                        // transmitting packet
-                        break;
-                    case PROP_DONE_ABORT:
-                        // Received CMD_ABORT while transmitting packet
-                        break;
-                    case PROP_ERROR_PAR:
-                        // Observed illegal parameter
-                        break;
-                    case PROP_ERROR_NO_SETUP:
-                        // Command sent without setting up the radio in a supported
-                        // mode using CMD_PROP_RADIO_SETUP or CMD_RADIO_SETUP
-                        break;
-                    case PROP_ERROR_NO_FS:
-                        // Command sent without the synthesizer being programmed
-                        break;
-                    case PROP_ERROR_TXUNF:
-                        // TX underflow observed during operation
-                        break;
-                    default:
-                        // Uncaught error event - these could come from the
-                        // pool of states defined in rf_mailbox.h
-                        while(1);
-                }
-
-        #ifndef POWER_MEASUREMENT
-                PIN_setOutputValue(ledPinHandle, Board_PIN_LED1,!PIN_getOutputValue(Board_PIN_LED1));
-        #endif
-                /* Power down the radio */
-                RF_yield(rfHandle);
-
-        #ifdef POWER_MEASUREMENT
-                /* Sleep for PACKET_INTERVAL s */
-                sleep(PACKET_INTERVAL);
-        #else
-                /* Sleep for PACKET_INTERVAL us */
-                usleep(PACKET_INTERVAL);
-        #endif
+            /* Longer than any NMEA sentence: drop it */
+            metricInc(METRIC_UART_DROPPED);
+            count = 0;
+            continue;
         }
-        count = 0;
+        if (input != '\n')
+            continue;
+        TRACE_BEGIN(TRACE_TX_SELECT);
+        metricInc(METRIC_SENTENCES);
+
+        /* Once we finish a line, check if msg is GGA or RMC, whatever the talker */
+        message[count] = '\0';
+#ifdef FIX_GATE
+        /* Fed every sentence, GSA included, before the fixes it judges */
+        uint8_t gatePassed = fixGateSentence(message);
+#endif
+        NMEAType type = nmeaClassify(message, NULL);
+        if (type != NMEA_GGA && type != NMEA_RMC)
+        {
+            TRACE_END(TRACE_TX_SELECT);
+            count = 0;
+            continue;
+        }
+#ifdef FIX_GATE
+        if (!gatePassed)
+        {
+            TRACE_END(TRACE_TX_SELECT);
+            count = 0;
+            continue;
+        }
+#endif
+#ifdef FIX_FILTER
+        /* Outliers and fixes the gateway can extrapolate are not sent */
+        if (!fixFilterSentence(message, &count))
+        {
+            TRACE_END(TRACE_TX_SELECT);
+            count = 0;
+            continue;
+        }
+#endif
+#ifdef TRACK_COMPRESS
+        /* GGA fixes feed the simplifier, only the vertices it settles on go out */
+        FixRecord trackFix, vertex;
+        if (fixFromSentence(message, count, &trackFix) ||
+            !trackCompressPush(&trackCompressor, &trackFix, &vertex))
+        {
+            TRACE_END(TRACE_TX_SELECT);
+            count = 0;
+            continue;
+        }
+#endif
+#ifdef GEOFENCE
+        /* Fixes that raise no event and are not due for a heartbeat are not sent */
+        FixRecord fenceFix;
+        GeoFenceEvent fenceEvents[GEOFENCE_MAX_EVENTS];
+        uint8_t numFenceEvents = 0;
+        if (fixFromSentence(message, count, &fenceFix) == 0)
+            numFenceEvents = geoFenceCheck(&geoFencer, &fenceFix, fenceEvents);
+        if (numFenceEvents == 0)
+        {
+            TRACE_END(TRACE_TX_SELECT);
+            count = 0;
+            continue;
+        }
+#endif
+#endif /* EPOCH_MERGE */
+        TRACE_END(TRACE_TX_SELECT);
+
+#if MAC_MODE == MAC_MODE_TDMA
+        /* Replace whatever still waits for our slot with the latest sentence */
+        TRACE_BEGIN(TRACE_TX_BUILD);
+        uintptr_t key = HwiP_disable();
+#ifdef EPOCH_MERGE
+        macBuildFixFrame(epoch);
+#elif defined(TRACK_COMPRESS)
+        macBuildTrackFrame(&vertex);
+#elif defined(GEOFENCE)
+        macBuildFenceFrame(&fenceFix, fenceEvents, numFenceEvents);
+#else
+        macBuildDataFrame(message, count);
+#endif
+        HwiP_restore(key);
+        TRACE_END(TRACE_TX_BUILD);
+
+#if !defined(EPOCH_MERGE) && !defined(TRACK_COMPRESS) && !defined(GEOFENCE)
+        /* print the raw message via UART */
+        TRACE_BEGIN(TRACE_UART_WRITE);
+        UART_write(uart, packet, packetLength);
+        UART_write(uart, newline,sizeof(newline));
+        TRACE_END(TRACE_UART_WRITE);
+#endif
+
+        /* Once a period the metrics take the slot instead, the next fix is not far behind */
+        if (telemetryDue())
+        {
+            memorySample();
+            key = HwiP_disable();
+            macBuildTelemetryFrame();
+            HwiP_restore(key);
+        }
+#else
+        TRACE_BEGIN(TRACE_TX_BUILD);
+#ifdef EPOCH_MERGE
+        macBuildFixFrame(epoch);
+#elif defined(TRACK_COMPRESS)
+        macBuildTrackFrame(&vertex);
+#elif defined(GEOFENCE)
+        macBuildFenceFrame(&fenceFix, fenceEvents, numFenceEvents);
+#else
+        macBuildDataFrame(message, count);
+#endif
+        TRACE_END(TRACE_TX_BUILD);
+
+#if !defined(EPOCH_MERGE) && !defined(TRACK_COMPRESS) && !defined(GEOFENCE)
+        /* print the raw message via UART */
+        TRACE_BEGIN(TRACE_UART_WRITE);
+        UART_write(uart, packet, packetLength);
+        UART_write(uart, newline,sizeof(newline));
+        TRACE_END(TRACE_UART_WRITE);
+#endif
+#if SECURE_LINK
+        TRACE_BEGIN(TRACE_TX_BUILD);
+        macSeal();
+        TRACE_END(TRACE_TX_BUILD);
+#endif
+#if MAC_ACK
+#ifdef FIX_LOG
+        /* No gateway: keep the fix on flash. The frame still goes out, its ACK
+         * tells us when the gateway is back */
+#ifdef EPOCH_MERGE
+        if (!arqNodeLinkUp(&arqNode) && (epoch->have & FIX_EPOCH_POSITION))
+            fixLogAppend(&fixLog, &epoch->fix);
+#elif defined(TRACK_COMPRESS)
+        if (!arqNodeLinkUp(&arqNode))
+            fixLogAppend(&fixLog, &vertex);
+#else
+        FixRecord fix;
+        if (!arqNodeLinkUp(&arqNode) && fixFromSentence(message, count, &fix) == 0)
+            fixLogAppend(&fixLog, &fix);
+#endif
+#endif
+        /* Send the new frame, then whatever the gateway is still missing */
+        arqNodeQueue(&arqNode, packet, packetLength);
+        TRACE_BEGIN(TRACE_RF_CMD);
+        arqSendRound();
+        TRACE_END(TRACE_RF_CMD);
+#else
+        /* Send packet */
+        RF_cmdPropTx.pktLen = packetLength;
+        TRACE_BEGIN(TRACE_RF_CMD);
+        macTransmit();
+        TRACE_END(TRACE_RF_CMD);
+#endif
+
+        /* Once a period the metrics follow, not acknowledged */
+        if (telemetryDue())
+        {
+            memorySample();
+            macBuildTelemetryFrame();
+#if SECURE_LINK
+            macSeal();
+#endif
+            RF_cmdPropTx.pPkt = packet;
+            RF_cmdPropTx.pktLen = packetLength;
+            macTransmit();
         }
 
+#ifndef POWER_MEASUREMENT
+        PIN_setOutputValue(ledPinHandle, Board_PIN_LED1,!PIN_getOutputValue(Board_PIN_LED1));
+#endif
+        uint8_t drained = 0;
+#ifdef FIX_LOG
+        /* Gateway is back: the backlog goes out in the time we would sleep */
+        if (fixLog.count > 0 && arqNodeLinkUp(&arqNode))
+        {
+            fixLogDrain();
+            drained = 1;
+        }
+#endif
+
+        /* Power down the radio */
+        RF_yield(rfHandle);
+
+        if (!drained)
+        {
+#ifdef POWER_MEASUREMENT
+            /* Sleep for PACKET_INTERVAL s */
+            sleep(PACKET_INTERVAL);
+#else
+            /* Sleep for PACKET_INTERVAL us */
+            usleep(PACKET_INTERVAL);
+#endif
+        }
+#endif
+#if TRACE_ENABLED
+        /* The ring in binary, for host/tools/traceTool.c. It goes to the receiver too,
+         * which drops it as it does any input it cannot frame */
+        if (traceDumpRequested)
+        {
+            traceDumpRequested = 0;
+            traceDump(traceUartWrite, uart);
+        }
+#endif
+        count = 0;
     }
 }